@@ -0,0 +1,997 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiChunkStore.cpp - Content addressed store that deduplicates chunks of
+		sectors across a library of cdi images.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiChunkStore.h"
+#include "CdiEdcEcc.h"
+#include "../IO/LzCodec.h"
+#include "../ISO/Iso9660.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace DiskJuggler
+{
+	/*
+		Description: Rotates a 64 bit value left.
+	*/
+	static inline ULONGLONG RotateLeft64(ULONGLONG qwValue, int iShift)
+	{
+		return (qwValue << iShift) | (qwValue >> (64 - iShift));
+	}
+
+	/*
+		Description: Final avalanche step of the chunk hash.
+	*/
+	static inline ULONGLONG FinalMix64(ULONGLONG qwValue)
+	{
+		qwValue ^= qwValue >> 33;
+		qwValue *= 0xFF51AFD7ED558CCDULL;
+		qwValue ^= qwValue >> 33;
+		qwValue *= 0xC4CEB9FE1A85EC53ULL;
+		qwValue ^= qwValue >> 33;
+		return qwValue;
+	}
+
+	CdiChunkHash ComputeChunkHash(const BYTE *pbData, DWORD dwSize)
+	{
+		// MurmurHash3 x64 128 bit, with a seed of 0.
+		const ULONGLONG c1 = 0x87C37B91114253D5ULL;
+		const ULONGLONG c2 = 0x4CF5AD432745937FULL;
+		ULONGLONG h1 = 0, h2 = 0;
+
+		// Mix in the data 16 bytes at a time.
+		DWORD dwBlockCount = dwSize / 16;
+		for (DWORD i = 0; i < dwBlockCount; i++)
+		{
+			ULONGLONG k1, k2;
+			memcpy(&k1, &pbData[i * 16], sizeof(k1));
+			memcpy(&k2, &pbData[(i * 16) + 8], sizeof(k2));
+
+			k1 *= c1;
+			k1 = RotateLeft64(k1, 31);
+			k1 *= c2;
+			h1 ^= k1;
+			h1 = RotateLeft64(h1, 27);
+			h1 += h2;
+			h1 = (h1 * 5) + 0x52DCE729;
+
+			k2 *= c2;
+			k2 = RotateLeft64(k2, 33);
+			k2 *= c1;
+			h2 ^= k2;
+			h2 = RotateLeft64(h2, 31);
+			h2 += h1;
+			h2 = (h2 * 5) + 0x38495AB5;
+		}
+
+		// Mix in the remaining bytes, padded with zeros.
+		DWORD dwTailSize = dwSize & 15;
+		if (dwTailSize > 0)
+		{
+			ULONGLONG k[2] = { 0, 0 };
+			memcpy(k, &pbData[dwBlockCount * 16], dwTailSize);
+
+			if (dwTailSize > 8)
+			{
+				k[1] *= c2;
+				k[1] = RotateLeft64(k[1], 33);
+				k[1] *= c1;
+				h2 ^= k[1];
+			}
+
+			k[0] *= c1;
+			k[0] = RotateLeft64(k[0], 31);
+			k[0] *= c2;
+			h1 ^= k[0];
+		}
+
+		// Finalize.
+		h1 ^= dwSize;
+		h2 ^= dwSize;
+		h1 += h2;
+		h2 += h1;
+		h1 = FinalMix64(h1);
+		h2 = FinalMix64(h2);
+		h1 += h2;
+		h2 += h1;
+
+		CdiChunkHash sHash = { h1, h2 };
+		return sHash;
+	}
+
+	//-----------------------------------------------------
+	// CdiChunkStore
+	//-----------------------------------------------------
+	CdiChunkStore::CdiChunkStore(DWORD dwThreadCount)
+	{
+		// Initialize fields.
+		this->m_bWrite = false;
+		this->m_dwThreadCount = dwThreadCount;
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = std::thread::hardware_concurrency();
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = 1;
+
+		this->m_pPackFile = nullptr;
+		this->m_qwPackSize = 0;
+		this->m_bIndexDirty = false;
+		memset(&this->m_sStats, 0, sizeof(this->m_sStats));
+	}
+
+	CdiChunkStore::~CdiChunkStore()
+	{
+		// Write out the index and close the pack file.
+		Close();
+	}
+
+	bool CdiChunkStore::Open(CString sFolder, bool bWrite)
+	{
+		CString sPackFile = sFolder + "\\" CDI_STORE_PACK_FILE;
+
+		this->m_sFolder = sFolder;
+		this->m_bWrite = bWrite;
+		memset(&this->m_sStats, 0, sizeof(this->m_sStats));
+
+		// Create the store folder if it doesn't exist yet.
+		if (bWrite == true && CreateDirectory(sFolder, NULL) == 0 && GetLastError() != ERROR_ALREADY_EXISTS)
+		{
+			printf("CdiChunkStore::Open(): failed to create store folder %s!\n", sFolder);
+			return false;
+		}
+
+		// Open the pack file, when adding images start a new one if there isn't one yet.
+		this->m_pPackFile = IO::OpenFileDevice(sPackFile, (bWrite == true ? IO::BlockDeviceAccess::ReadWrite : IO::BlockDeviceAccess::ReadOnly));
+		if (this->m_pPackFile == nullptr && bWrite == true)
+		{
+			CdiStorePackHeader sHeader = { CDI_STORE_PACK_MAGIC, CDI_STORE_VERSION };
+			this->m_pPackFile = IO::OpenFileDevice(sPackFile, IO::BlockDeviceAccess::CreateAlways);
+			if (this->m_pPackFile != nullptr && this->m_pPackFile->WriteAt(0, &sHeader, sizeof(sHeader)) == false)
+			{
+				delete this->m_pPackFile;
+				this->m_pPackFile = nullptr;
+			}
+		}
+
+		if (this->m_pPackFile == nullptr)
+		{
+			printf("CdiChunkStore::Open(): could not open pack file %s!\n", sPackFile);
+			return false;
+		}
+
+		// Check the pack is one we can read.
+		CdiStorePackHeader sHeader = { };
+		if (this->m_pPackFile->Size() < sizeof(sHeader) || this->m_pPackFile->ReadAt(0, &sHeader, sizeof(sHeader)) == false ||
+			sHeader.dwMagic != CDI_STORE_PACK_MAGIC || sHeader.dwVersion != CDI_STORE_VERSION)
+		{
+			printf("CdiChunkStore::Open(): %s is not a supported pack file!\n", sPackFile);
+			Close();
+			return false;
+		}
+
+		// Load the index, if it is missing start from an empty one.
+		if (LoadIndex() == false)
+		{
+			this->m_vChunks.clear();
+			this->m_mChunkMap.clear();
+			this->m_qwPackSize = sizeof(CdiStorePackHeader);
+		}
+
+		// Chunks added after the index was last written are picked up from the pack.
+		if (this->m_qwPackSize != this->m_pPackFile->Size())
+		{
+			if (ScanPack() == false)
+			{
+				Close();
+				return false;
+			}
+
+			this->m_bIndexDirty = true;
+		}
+
+		return true;
+	}
+
+	bool CdiChunkStore::Close()
+	{
+		bool bResult = true;
+
+		// Write out the index if chunks were added, after everything they point to is on disk.
+		if (this->m_pPackFile != nullptr)
+		{
+			if (this->m_bWrite == true && this->m_bIndexDirty == true)
+				bResult = (this->m_pPackFile->Flush() == true && SaveIndex() == true);
+
+			delete this->m_pPackFile;
+			this->m_pPackFile = nullptr;
+		}
+
+		this->m_vChunks.clear();
+		this->m_mChunkMap.clear();
+		this->m_qwPackSize = 0;
+		this->m_bIndexDirty = false;
+		return bResult;
+	}
+
+	bool CdiChunkStore::LoadIndex()
+	{
+		CdiStoreIndexHeader sHeader = { };
+		std::vector<CdiStoreIndexEntry> vEntries;
+		ULONGLONG qwPackFileSize = this->m_pPackFile->Size();
+		bool bResult = false;
+
+		// Open the index file, it not being there just means the index has to be rebuilt.
+		IO::BlockDevice *pIndexFile = IO::OpenFileDevice(this->m_sFolder + "\\" CDI_STORE_INDEX_FILE, IO::BlockDeviceAccess::ReadOnly);
+		if (pIndexFile == nullptr)
+			return false;
+
+		// Check the index covers no more than what is in the pack, the pack is only ever appended to.
+		ULONGLONG qwFileSize = pIndexFile->Size();
+		if (qwFileSize < sizeof(sHeader) || pIndexFile->ReadAt(0, &sHeader, sizeof(sHeader)) == false ||
+			sHeader.dwMagic != CDI_STORE_INDEX_MAGIC || sHeader.dwVersion != CDI_STORE_VERSION ||
+			sHeader.qwPackSize < sizeof(CdiStorePackHeader) || sHeader.qwPackSize > qwPackFileSize ||
+			qwFileSize - sizeof(sHeader) != (ULONGLONG)sHeader.dwChunkCount * sizeof(CdiStoreIndexEntry) || qwFileSize > 0x7FFFFFFF)
+			goto Cleanup;
+
+		// Read the entries and check they weren't damaged.
+		vEntries.resize(sHeader.dwChunkCount);
+		if (pIndexFile->ReadAt(sizeof(sHeader), vEntries.data(), (DWORD)(qwFileSize - sizeof(sHeader))) == false ||
+			ComputeEdc(0, (const BYTE*)vEntries.data(), (DWORD)(qwFileSize - sizeof(sHeader))) != sHeader.dwIndexHash)
+			goto Cleanup;
+
+		// Check every chunk lies inside of the part of the pack the index covers.
+		for (size_t i = 0; i < vEntries.size(); i++)
+		{
+			const CdiStoreIndexEntry *pEntry = &vEntries[i];
+			if (pEntry->bType > CdiChunkType::ChunkLz || pEntry->dwPayloadSize > CDI_STORE_MAX_PAYLOAD_SIZE ||
+				pEntry->dwSize > pEntry->dwPayloadSize || (pEntry->bType == CdiChunkType::ChunkStored && pEntry->dwSize != pEntry->dwPayloadSize) ||
+				pEntry->qwOffset < sizeof(CdiStorePackHeader) + sizeof(CdiStoreChunkRecord) || pEntry->qwOffset > sHeader.qwPackSize ||
+				pEntry->dwSize > sHeader.qwPackSize - pEntry->qwOffset)
+				goto Cleanup;
+		}
+
+		// Build the lookup map.
+		this->m_vChunks.clear();
+		this->m_mChunkMap.clear();
+		for (size_t i = 0; i < vEntries.size(); i++)
+			AddChunkEntry(&vEntries[i]);
+
+		this->m_qwPackSize = sHeader.qwPackSize;
+		bResult = true;
+
+	Cleanup:
+		// Close the index file.
+		delete pIndexFile;
+		return bResult;
+	}
+
+	bool CdiChunkStore::ScanPack()
+	{
+		ULONGLONG qwPackFileSize = this->m_pPackFile->Size();
+		ULONGLONG qwOffset = this->m_qwPackSize;
+
+		// Walk the chunk records until the end of the pack or a record that is damaged.
+		while (qwPackFileSize - qwOffset >= sizeof(CdiStoreChunkRecord))
+		{
+			CdiStoreChunkRecord sRecord;
+			if (this->m_pPackFile->ReadAt(qwOffset, &sRecord, sizeof(sRecord)) == false)
+			{
+				printf("CdiChunkStore::ScanPack(): failed to read the pack file!\n");
+				return false;
+			}
+
+			if (sRecord.bType > CdiChunkType::ChunkLz || sRecord.dwPayloadSize > CDI_STORE_MAX_PAYLOAD_SIZE ||
+				sRecord.dwSize > sRecord.dwPayloadSize || (sRecord.bType == CdiChunkType::ChunkStored && sRecord.dwSize != sRecord.dwPayloadSize) ||
+				sRecord.dwSize > qwPackFileSize - qwOffset - sizeof(sRecord))
+				break;
+
+			CdiStoreIndexEntry sEntry = { sRecord.sHash, qwOffset + sizeof(sRecord), sRecord.dwSize, sRecord.dwPayloadSize, sRecord.bType };
+			AddChunkEntry(&sEntry);
+
+			// Next record.
+			qwOffset += sizeof(sRecord) + sRecord.dwSize;
+		}
+
+		// Anything after the last good record is overwritten by the next chunk added.
+		if (qwOffset != qwPackFileSize)
+			printf("CdiChunkStore::ScanPack(): ignoring %lld bytes of damaged data at the end of the pack!\n", qwPackFileSize - qwOffset);
+
+		this->m_qwPackSize = qwOffset;
+		return true;
+	}
+
+	bool CdiChunkStore::SaveIndex()
+	{
+		CdiStoreIndexHeader sHeader = { };
+		DWORD dwEntriesSize = (DWORD)(this->m_vChunks.size() * sizeof(CdiStoreIndexEntry));
+		bool bResult = false;
+
+		// Fill in the header.
+		sHeader.dwMagic = CDI_STORE_INDEX_MAGIC;
+		sHeader.dwVersion = CDI_STORE_VERSION;
+		sHeader.qwPackSize = this->m_qwPackSize;
+		sHeader.dwChunkCount = (DWORD)this->m_vChunks.size();
+		sHeader.dwIndexHash = ComputeEdc(0, (const BYTE*)this->m_vChunks.data(), dwEntriesSize);
+
+		// Write the header followed by the entries.
+		IO::BlockDevice *pIndexFile = IO::OpenFileDevice(this->m_sFolder + "\\" CDI_STORE_INDEX_FILE, IO::BlockDeviceAccess::CreateAlways);
+		if (pIndexFile != nullptr)
+		{
+			bResult = (pIndexFile->WriteAt(0, &sHeader, sizeof(sHeader)) == true &&
+				pIndexFile->WriteAt(sizeof(sHeader), this->m_vChunks.data(), dwEntriesSize) == true && pIndexFile->Flush() == true);
+			delete pIndexFile;
+		}
+
+		if (bResult == false)
+			printf("CdiChunkStore::SaveIndex(): failed to write the index of store %s!\n", this->m_sFolder);
+		else
+			this->m_bIndexDirty = false;
+
+		return bResult;
+	}
+
+	void CdiChunkStore::AddChunkEntry(const CdiStoreIndexEntry *pEntry)
+	{
+		// If a chunk somehow got stored twice the first copy is used.
+		this->m_mChunkMap.insert(std::make_pair(pEntry->sHash, (DWORD)this->m_vChunks.size()));
+		this->m_vChunks.push_back(*pEntry);
+	}
+
+	void CdiChunkStore::FindFileBoundaries(CdiFileHandle *pCdiFile, std::vector<DWORD> *pvBoundaries)
+	{
+		// Loop through all of the data tracks and parse the file system on each of them.
+		pvBoundaries->clear();
+		ArrayView<CdiSession> sessionCollection = pCdiFile->GetSessions();
+		for (size_t i = 0; i < sessionCollection.size(); i++)
+		{
+			for (DWORD x = 0; x < sessionCollection[i]->wTrackCount; x++)
+			{
+				const CdiTrack *pTrack = &sessionCollection[i]->psTracks[x];
+				if (pTrack->eMode == CdiTrackMode::Audio || pTrack->dwLength == 0)
+					continue;
+
+				CdiTrackHandle *pTrackHandle = pCdiFile->OpenTrackHandle((DWORD)i, x);
+				if (pTrackHandle == nullptr)
+					continue;
+
+				// Tracks without a file system are just split into fixed size chunks.
+				ISO::ISO9660 *pIsoHandle = new ISO::ISO9660();
+				if (pIsoHandle->LoadISOFromCDI(pTrackHandle, false) == true)
+				{
+					std::vector<BYTE> vRecords;
+					DWORD dwEntryCount = 0;
+					pIsoHandle->ExportDirectoryRecords(&vRecords, &dwEntryCount);
+
+					// Each record is the index of its parent followed by the directory entry, the extents of files
+					// and directories start and end on a chunk boundary.
+					for (size_t dwPosition = 0; dwPosition + sizeof(DWORD) + ISO9660_DIR_ENTRY_MIN_SIZE <= vRecords.size(); )
+					{
+						const ISO::ISO9660_DirectoryEntry *pEntry = (const ISO::ISO9660_DirectoryEntry*)&vRecords[dwPosition + sizeof(DWORD)];
+						if (pEntry->bEntryLength == 0)
+							break;
+
+						pvBoundaries->push_back(pEntry->dwExtentLBA.LE);
+						pvBoundaries->push_back(pEntry->dwExtentLBA.LE + ((pEntry->dwExtentSize.LE + ISO9660_SECTOR_SIZE - 1) / ISO9660_SECTOR_SIZE));
+						dwPosition += sizeof(DWORD) + pEntry->bEntryLength;
+					}
+				}
+
+				delete pIsoHandle;
+				pCdiFile->CloseTrackHandle(pTrackHandle);
+			}
+		}
+
+		// Sort the boundaries and drop the duplicates.
+		std::sort(pvBoundaries->begin(), pvBoundaries->end());
+		pvBoundaries->erase(std::unique(pvBoundaries->begin(), pvBoundaries->end()), pvBoundaries->end());
+	}
+
+	void CdiChunkStore::SplitExtent(const CdiCompressedExtent *pExtent, const std::vector<DWORD> &vBoundaries, std::vector<ChunkJob> *pvJobs)
+	{
+		DWORD dwUnitCount = (DWORD)((pExtent->qwSize + pExtent->dwUnitSize - 1) / pExtent->dwUnitSize);
+
+		// Only track sectors have LBAs the file boundaries can fall on.
+		bool bTrack = (pExtent->bMode != CDI_COMPRESSED_NO_TRACK);
+		std::vector<DWORD>::const_iterator itBoundary = std::upper_bound(vBoundaries.begin(), vBoundaries.end(), pExtent->dwFirstLBA);
+
+		for (DWORD dwUnit = 0; dwUnit < dwUnitCount; )
+		{
+			// End the chunk at the next file boundary or once it is full.
+			DWORD dwEnd = (dwUnitCount - dwUnit < CDI_STORE_MAX_CHUNK_SECTORS ? dwUnitCount : dwUnit + CDI_STORE_MAX_CHUNK_SECTORS);
+			if (bTrack == true)
+			{
+				while (itBoundary != vBoundaries.end() && *itBoundary <= pExtent->dwFirstLBA + dwUnit)
+					itBoundary++;
+				if (itBoundary != vBoundaries.end() && *itBoundary - pExtent->dwFirstLBA < dwEnd)
+					dwEnd = *itBoundary - pExtent->dwFirstLBA;
+			}
+
+			ChunkJob sJob;
+			sJob.pExtent = pExtent;
+			sJob.dwFirstUnit = dwUnit;
+			sJob.dwUnitCount = dwEnd - dwUnit;
+			sJob.pbInput = nullptr;
+			sJob.dwInputSize = (DWORD)(pExtent->qwSize - (ULONGLONG)dwUnit * pExtent->dwUnitSize < (ULONGLONG)sJob.dwUnitCount * pExtent->dwUnitSize ?
+				pExtent->qwSize - (ULONGLONG)dwUnit * pExtent->dwUnitSize : (ULONGLONG)sJob.dwUnitCount * pExtent->dwUnitSize);
+			sJob.bNew = false;
+			sJob.bStored = false;
+			sJob.bMismatch = false;
+			sJob.bType = CdiChunkType::ChunkStored;
+			pvJobs->push_back(sJob);
+
+			dwUnit = dwEnd;
+		}
+	}
+
+	void CdiChunkStore::EncodeChunks(ChunkJob *psJobs, DWORD dwJobCount, bool bCompress)
+	{
+		for (DWORD i = 0; i < dwJobCount; i++)
+		{
+			ChunkJob *pJob = &psJobs[i];
+
+			if (bCompress == false)
+			{
+				// Build the payload and hash it.
+				DWORD dwZeroSectors, dwRegeneratedSectors;
+				EncodeSectorRun(pJob->pExtent, pJob->dwFirstUnit, pJob->pbInput, pJob->dwInputSize, &pJob->vPayload,
+					&dwZeroSectors, &dwRegeneratedSectors);
+				pJob->sHash = ComputeChunkHash(pJob->vPayload.data(), (DWORD)pJob->vPayload.size());
+			}
+			else if (pJob->bStored == true)
+			{
+				// The hash is not collision resistant, so make sure the stored chunk really is the same before the
+				// image is pointed at it.
+				std::vector<BYTE> vStored;
+				pJob->bMismatch = (ReadChunk(pJob->sHash, &vStored) == false || vStored.size() != pJob->vPayload.size() ||
+					memcmp(vStored.data(), pJob->vPayload.data(), vStored.size()) != 0);
+			}
+			else if (pJob->bNew == true)
+			{
+				// Compress the payload, if it doesn't get any smaller store it as is.
+				DWORD dwPayloadSize = (DWORD)pJob->vPayload.size();
+				pJob->vOutput.resize(dwPayloadSize);
+				DWORD dwCompressedSize = IO::LzCompress(pJob->vPayload.data(), dwPayloadSize, pJob->vOutput.data(), dwPayloadSize - 1);
+				if (dwCompressedSize != 0)
+				{
+					pJob->bType = CdiChunkType::ChunkLz;
+					pJob->vOutput.resize(dwCompressedSize);
+				}
+				else
+				{
+					pJob->bType = CdiChunkType::ChunkStored;
+					memcpy(pJob->vOutput.data(), pJob->vPayload.data(), dwPayloadSize);
+				}
+			}
+		}
+	}
+
+	void CdiChunkStore::RunEncodeJobs(ChunkJob *psJobs, DWORD dwJobCount, bool bCompress)
+	{
+		// Split the chunks across the worker threads, this thread takes the first run.
+		DWORD dwThreadCount = (dwJobCount < this->m_dwThreadCount ? dwJobCount : this->m_dwThreadCount);
+		DWORD dwJobsPerThread = (dwJobCount + dwThreadCount - 1) / dwThreadCount;
+		std::vector<std::thread> vWorkers;
+		for (DWORD dwFirst = dwJobsPerThread; dwFirst < dwJobCount; dwFirst += dwJobsPerThread)
+		{
+			DWORD dwCount = (dwJobCount - dwFirst < dwJobsPerThread ? dwJobCount - dwFirst : dwJobsPerThread);
+			vWorkers.push_back(std::thread(&CdiChunkStore::EncodeChunks, this, &psJobs[dwFirst], dwCount, bCompress));
+		}
+
+		EncodeChunks(psJobs, (dwJobsPerThread < dwJobCount ? dwJobsPerThread : dwJobCount), bCompress);
+		for (size_t i = 0; i < vWorkers.size(); i++)
+			vWorkers[i].join();
+	}
+
+	bool CdiChunkStore::AddImage(CString sImageFile, CString sManifestFile)
+	{
+		IO::BlockDevice *pImageFile = nullptr;
+		IO::BlockDevice *pManifestFile = nullptr;
+		CdiFileHandle sCdiFile;
+		CdiStoreManifestHeader sHeader = { };
+		std::vector<CdiCompressedExtent> vExtents;
+		std::vector<DWORD> vBoundaries;
+		std::vector<ChunkJob> vJobs;
+		std::vector<CdiStoreChunkRef> vChunkRefs;
+		std::unordered_map<CdiChunkHash, DWORD, CdiChunkHashHasher> mBatchChunks;
+		std::vector<BYTE> vInput;
+		std::vector<BYTE> vIndex;
+		ULONGLONG qwImageSize = 0;
+		ULONGLONG qwStoredBytes = 0;
+		ULONGLONG qwNewChunkCount = 0;
+		DWORD dwBatchChunks = this->m_dwThreadCount * CDI_STORE_CHUNKS_PER_THREAD;
+		auto tStart = std::chrono::steady_clock::now();
+		bool bResult = false;
+
+		if (this->m_pPackFile == nullptr || this->m_bWrite == false)
+		{
+			printf("CdiChunkStore::AddImage(): store is not open for adding images!\n");
+			return false;
+		}
+
+		// Open the image for reading the raw data.
+		pImageFile = IO::OpenFileDevice(sImageFile, IO::BlockDeviceAccess::ReadOnly);
+		if (pImageFile == nullptr)
+		{
+			printf("CdiChunkStore::AddImage(): could not open image %s!\n", sImageFile);
+			return false;
+		}
+
+		if (CdiCompressedDevice::IsCompressedImage(pImageFile) == true || CdiStoreDevice::IsManifest(pImageFile) == true)
+		{
+			printf("CdiChunkStore::AddImage(): image %s has to be unpacked first!\n", sImageFile);
+			goto Cleanup;
+		}
+		qwImageSize = pImageFile->Size();
+
+		// Parse the image to find where the tracks and files are and split it into chunks.
+		if (sCdiFile.Open(sImageFile, false, false) == false || BuildImageExtents(&sCdiFile, qwImageSize, &vExtents) == false)
+			goto Cleanup;
+		FindFileBoundaries(&sCdiFile, &vBoundaries);
+		sCdiFile.Close();
+
+		for (size_t i = 0; i < vExtents.size(); i++)
+		{
+			vExtents[i].dwFirstHunk = (DWORD)vJobs.size();
+			SplitExtent(&vExtents[i], vBoundaries, &vJobs);
+		}
+
+		// Add the chunks a batch at a time: read the batch, encode and hash it in parallel, look up which chunks are
+		// new, compress those in parallel and append them to the pack in order.
+		pImageFile->Advise(0, qwImageSize, IO::BlockDeviceAccessHint::Sequential);
+		vInput.resize((SIZE_T)dwBatchChunks * CDI_STORE_MAX_CHUNK_SIZE);
+		vChunkRefs.resize(vJobs.size());
+		for (size_t i = 0; i < vJobs.size(); )
+		{
+			// Chunks are contiguous so the batch is read in one go.
+			ChunkJob *psJobs = &vJobs[i];
+			DWORD dwJobCount = (DWORD)(vJobs.size() - i < dwBatchChunks ? vJobs.size() - i : dwBatchChunks);
+			ULONGLONG qwBatchOffset = psJobs[0].pExtent->qwOffset + (ULONGLONG)psJobs[0].dwFirstUnit * psJobs[0].pExtent->dwUnitSize;
+			DWORD dwBatchSize = 0;
+			for (DWORD x = 0; x < dwJobCount; x++)
+			{
+				psJobs[x].pbInput = &vInput[dwBatchSize];
+				dwBatchSize += psJobs[x].dwInputSize;
+			}
+
+			if (pImageFile->ReadAt(qwBatchOffset, vInput.data(), dwBatchSize) == false)
+			{
+				printf("CdiChunkStore::AddImage(): failed to read image %s!\n", sImageFile);
+				goto Cleanup;
+			}
+
+			// Build and hash the payloads.
+			RunEncodeJobs(psJobs, dwJobCount, false);
+
+			// Look up which chunks aren't stored yet, chunks repeated within the batch are only stored once.
+			mBatchChunks.clear();
+			for (DWORD x = 0; x < dwJobCount; x++)
+			{
+				psJobs[x].bStored = (this->m_mChunkMap.find(psJobs[x].sHash) != this->m_mChunkMap.end());
+				psJobs[x].bNew = false;
+				psJobs[x].bMismatch = false;
+				if (psJobs[x].bStored == false)
+				{
+					// A repeat of an earlier chunk in the batch has to have the same payload as it.
+					auto sResult = mBatchChunks.insert(std::make_pair(psJobs[x].sHash, x));
+					psJobs[x].bNew = sResult.second;
+					if (sResult.second == false)
+						psJobs[x].bMismatch = (psJobs[x].vPayload != psJobs[sResult.first->second].vPayload);
+				}
+			}
+
+			// Compress the new chunks and check the ones already stored.
+			RunEncodeJobs(psJobs, dwJobCount, true);
+
+			// Append the new chunks to the pack in order.
+			for (DWORD x = 0; x < dwJobCount; x++)
+			{
+				ChunkJob *pJob = &psJobs[x];
+				if (pJob->bMismatch == true)
+				{
+					printf("CdiChunkStore::AddImage(): chunk %016llx%016llx of image %s does not match the stored chunk with the same hash!\n",
+						pJob->sHash.qwHigh, pJob->sHash.qwLow, sImageFile);
+					goto Cleanup;
+				}
+
+				if (pJob->bNew == true)
+				{
+					CdiStoreChunkRecord sRecord = { pJob->sHash, (DWORD)pJob->vOutput.size(), (DWORD)pJob->vPayload.size(), pJob->bType };
+					if (this->m_pPackFile->WriteAt(this->m_qwPackSize, &sRecord, sizeof(sRecord)) == false ||
+						this->m_pPackFile->WriteAt(this->m_qwPackSize + sizeof(sRecord), pJob->vOutput.data(), sRecord.dwSize) == false)
+					{
+						printf("CdiChunkStore::AddImage(): failed to write to the pack file!\n");
+						goto Cleanup;
+					}
+
+					CdiStoreIndexEntry sEntry = { sRecord.sHash, this->m_qwPackSize + sizeof(sRecord), sRecord.dwSize, sRecord.dwPayloadSize, sRecord.bType };
+					AddChunkEntry(&sEntry);
+					this->m_qwPackSize += sizeof(sRecord) + sRecord.dwSize;
+					this->m_bIndexDirty = true;
+
+					qwStoredBytes += sizeof(sRecord) + sRecord.dwSize;
+					qwNewChunkCount++;
+				}
+
+				CdiStoreChunkRef *pChunkRef = &vChunkRefs[i + x];
+				pChunkRef->sHash = pJob->sHash;
+				pChunkRef->dwFirstUnit = pJob->dwFirstUnit;
+				pChunkRef->dwUnitCount = pJob->dwUnitCount;
+
+				// Free the buffers of the chunk.
+				std::vector<BYTE>().swap(pJob->vPayload);
+				std::vector<BYTE>().swap(pJob->vOutput);
+			}
+
+			i += dwJobCount;
+		}
+
+		// Make sure every chunk the manifest points to is on disk before writing it.
+		if (this->m_pPackFile->Flush() == false)
+		{
+			printf("CdiChunkStore::AddImage(): failed to write to the pack file!\n");
+			goto Cleanup;
+		}
+
+		// Write the manifest: the header followed by the extent and chunk reference tables.
+		vIndex.resize((vExtents.size() * sizeof(CdiCompressedExtent)) + (vChunkRefs.size() * sizeof(CdiStoreChunkRef)));
+		memcpy(vIndex.data(), vExtents.data(), vExtents.size() * sizeof(CdiCompressedExtent));
+		memcpy(&vIndex[vExtents.size() * sizeof(CdiCompressedExtent)], vChunkRefs.data(), vChunkRefs.size() * sizeof(CdiStoreChunkRef));
+
+		sHeader.dwMagic = CDI_STORE_MANIFEST_MAGIC;
+		sHeader.dwVersion = CDI_STORE_VERSION;
+		sHeader.qwImageSize = qwImageSize;
+		sHeader.dwExtentCount = (DWORD)vExtents.size();
+		sHeader.dwChunkCount = (DWORD)vChunkRefs.size();
+		sHeader.dwIndexHash = ComputeEdc(0, vIndex.data(), (DWORD)vIndex.size());
+
+		pManifestFile = IO::OpenFileDevice(sManifestFile, IO::BlockDeviceAccess::CreateAlways);
+		if (pManifestFile == nullptr || pManifestFile->WriteAt(0, &sHeader, sizeof(sHeader)) == false ||
+			pManifestFile->WriteAt(sizeof(sHeader), vIndex.data(), (DWORD)vIndex.size()) == false || pManifestFile->Flush() == false)
+		{
+			printf("CdiChunkStore::AddImage(): failed to write manifest %s!\n", sManifestFile);
+			goto Cleanup;
+		}
+
+		// Update the statistics.
+		this->m_sStats.qwImageBytes += qwImageSize;
+		this->m_sStats.qwStoredBytes += qwStoredBytes;
+		this->m_sStats.qwChunkCount += vJobs.size();
+		this->m_sStats.qwNewChunkCount += qwNewChunkCount;
+		this->m_sStats.dSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+		bResult = true;
+
+	Cleanup:
+		// Close the files.
+		if (pImageFile != nullptr)
+			delete pImageFile;
+		if (pManifestFile != nullptr)
+			delete pManifestFile;
+
+		return bResult;
+	}
+
+	bool CdiChunkStore::ReadChunk(const CdiChunkHash &sHash, std::vector<BYTE> *pvPayload)
+	{
+		// Find the chunk.
+		auto itChunk = this->m_mChunkMap.find(sHash);
+		if (itChunk == this->m_mChunkMap.end())
+		{
+			printf("CdiChunkStore::ReadChunk(): chunk %016llx%016llx is missing from the store!\n", sHash.qwHigh, sHash.qwLow);
+			return false;
+		}
+		const CdiStoreIndexEntry *pEntry = &this->m_vChunks[itChunk->second];
+
+		// Read the chunk and decompress the payload.
+		std::vector<BYTE> vData(pEntry->dwSize);
+		if (this->m_pPackFile->ReadAt(pEntry->qwOffset, vData.data(), pEntry->dwSize) == false)
+		{
+			printf("CdiChunkStore::ReadChunk(): failed to read chunk %016llx%016llx!\n", sHash.qwHigh, sHash.qwLow);
+			return false;
+		}
+
+		if (pEntry->bType == CdiChunkType::ChunkLz)
+		{
+			pvPayload->resize(pEntry->dwPayloadSize);
+			if (IO::LzDecompress(vData.data(), pEntry->dwSize, pvPayload->data(), pEntry->dwPayloadSize) == false)
+			{
+				printf("CdiChunkStore::ReadChunk(): chunk %016llx%016llx is corrupt!\n", sHash.qwHigh, sHash.qwLow);
+				return false;
+			}
+		}
+		else
+			pvPayload->swap(vData);
+
+		// Check the payload is the one that was stored.
+		if (!(ComputeChunkHash(pvPayload->data(), (DWORD)pvPayload->size()) == sHash))
+		{
+			printf("CdiChunkStore::ReadChunk(): chunk %016llx%016llx is corrupt!\n", sHash.qwHigh, sHash.qwLow);
+			return false;
+		}
+
+		return true;
+	}
+
+	ULONGLONG CdiChunkStore::PackSize()
+	{
+		return this->m_qwPackSize;
+	}
+
+	DWORD CdiChunkStore::ChunkCount()
+	{
+		return (DWORD)this->m_vChunks.size();
+	}
+
+	void CdiChunkStore::GetStats(CdiStoreStats *pStats)
+	{
+		*pStats = this->m_sStats;
+	}
+
+	//-----------------------------------------------------
+	// CdiStoreDevice
+	//-----------------------------------------------------
+	CdiStoreDevice::CdiStoreDevice(DWORD dwCacheChunks) : m_sStore(1)
+	{
+		// Initialize fields.
+		this->m_pFile = nullptr;
+		memset(&this->m_sHeader, 0, sizeof(this->m_sHeader));
+		this->m_dwCacheChunks = dwCacheChunks;
+	}
+
+	CdiStoreDevice::~CdiStoreDevice()
+	{
+		// Close the manifest file.
+		if (this->m_pFile != nullptr)
+			delete this->m_pFile;
+	}
+
+	bool CdiStoreDevice::IsManifest(IO::BlockDevice *pDevice)
+	{
+		// Check the file starts with the manifest magic.
+		DWORD dwMagic = 0;
+		return pDevice->Size() >= sizeof(CdiStoreManifestHeader) && pDevice->ReadAt(0, &dwMagic, sizeof(dwMagic)) == true &&
+			dwMagic == CDI_STORE_MANIFEST_MAGIC;
+	}
+
+	bool CdiStoreDevice::Open(IO::BlockDevice *pFile, CString sManifestFile)
+	{
+		// Read the header and check it is a manifest we can read.
+		ULONGLONG qwFileSize = pFile->Size();
+		if (qwFileSize < sizeof(CdiStoreManifestHeader) || pFile->ReadAt(0, &this->m_sHeader, sizeof(CdiStoreManifestHeader)) == false)
+		{
+			printf("CdiStoreDevice::Open(): failed to read the manifest header!\n");
+			return false;
+		}
+
+		if (this->m_sHeader.dwMagic != CDI_STORE_MANIFEST_MAGIC || this->m_sHeader.dwVersion != CDI_STORE_VERSION)
+		{
+			printf("CdiStoreDevice::Open(): unsupported manifest version %d!\n", this->m_sHeader.dwVersion);
+			return false;
+		}
+
+		// The tables fill the rest of the file.
+		ULONGLONG qwIndexSize = ((ULONGLONG)this->m_sHeader.dwExtentCount * sizeof(CdiCompressedExtent)) +
+			((ULONGLONG)this->m_sHeader.dwChunkCount * sizeof(CdiStoreChunkRef));
+		if (qwIndexSize != qwFileSize - sizeof(CdiStoreManifestHeader) || qwIndexSize > 0x7FFFFFFF)
+		{
+			printf("CdiStoreDevice::Open(): manifest is truncated!\n");
+			return false;
+		}
+
+		// Read the tables and check they weren't damaged.
+		std::vector<BYTE> vIndex((SIZE_T)qwIndexSize);
+		if (pFile->ReadAt(sizeof(CdiStoreManifestHeader), vIndex.data(), (DWORD)qwIndexSize) == false ||
+			ComputeEdc(0, vIndex.data(), (DWORD)qwIndexSize) != this->m_sHeader.dwIndexHash)
+		{
+			printf("CdiStoreDevice::Open(): manifest is corrupt!\n");
+			return false;
+		}
+
+		this->m_vExtents.resize(this->m_sHeader.dwExtentCount);
+		this->m_vChunks.resize(this->m_sHeader.dwChunkCount);
+		memcpy(this->m_vExtents.data(), vIndex.data(), this->m_vExtents.size() * sizeof(CdiCompressedExtent));
+		memcpy(this->m_vChunks.data(), &vIndex[this->m_vExtents.size() * sizeof(CdiCompressedExtent)], this->m_vChunks.size() * sizeof(CdiStoreChunkRef));
+		if (ValidateIndex() == false)
+		{
+			printf("CdiStoreDevice::Open(): manifest is corrupt!\n");
+			return false;
+		}
+
+		// The store is the folder the manifest is in.
+		CString sFolder = ".";
+		int iSeparator = sManifestFile.ReverseFind('\\');
+		if (sManifestFile.ReverseFind('/') > iSeparator)
+			iSeparator = sManifestFile.ReverseFind('/');
+		if (iSeparator != -1)
+			sFolder = sManifestFile.Left(iSeparator);
+
+		if (this->m_sStore.Open(sFolder, false) == false)
+		{
+			printf("CdiStoreDevice::Open(): failed to open store %s!\n", sFolder);
+			return false;
+		}
+
+		// Take ownership of the file.
+		this->m_pFile = pFile;
+		return true;
+	}
+
+	bool CdiStoreDevice::ValidateIndex()
+	{
+		// Check the extents cover the whole image in order and their chunks cover each extent in order.
+		ULONGLONG qwOffset = 0;
+		DWORD dwChunk = 0;
+		for (size_t i = 0; i < this->m_vExtents.size(); i++)
+		{
+			const CdiCompressedExtent *pExtent = &this->m_vExtents[i];
+			if (pExtent->qwOffset != qwOffset || pExtent->qwSize == 0 || pExtent->qwSize > this->m_sHeader.qwImageSize - qwOffset ||
+				pExtent->dwFirstHunk != dwChunk)
+				return false;
+
+			// Units are either track sectors or raw data.
+			if (pExtent->dwUnitSize != CdiSectorSize::Size_2048 && pExtent->dwUnitSize != CdiSectorSize::Size_2336 &&
+				pExtent->dwUnitSize != CdiSectorSize::Size_2352 && pExtent->dwUnitSize != CdiSectorSize::Size_2368 &&
+				pExtent->dwUnitSize != CdiSectorSize::Size_2448)
+				return false;
+			if (pExtent->bMode > CdiTrackMode::Mode2 && pExtent->bMode != CDI_COMPRESSED_NO_TRACK)
+				return false;
+
+			ULONGLONG qwUnitCount = (pExtent->qwSize + pExtent->dwUnitSize - 1) / pExtent->dwUnitSize;
+			for (ULONGLONG qwUnit = 0; qwUnit < qwUnitCount; dwChunk++)
+			{
+				if (dwChunk >= this->m_vChunks.size())
+					return false;
+
+				const CdiStoreChunkRef *pChunkRef = &this->m_vChunks[dwChunk];
+				if (pChunkRef->dwFirstUnit != qwUnit || pChunkRef->dwUnitCount == 0 || pChunkRef->dwUnitCount > CDI_STORE_MAX_CHUNK_SECTORS ||
+					pChunkRef->dwUnitCount > qwUnitCount - qwUnit)
+					return false;
+
+				qwUnit += pChunkRef->dwUnitCount;
+			}
+
+			qwOffset += pExtent->qwSize;
+		}
+
+		return qwOffset == this->m_sHeader.qwImageSize && dwChunk == this->m_vChunks.size();
+	}
+
+	DWORD CdiStoreDevice::FindChunk(ULONGLONG qwOffset, const CdiCompressedExtent **ppExtent)
+	{
+		// Find the last extent starting at or before the offset.
+		auto itExtent = std::upper_bound(this->m_vExtents.begin(), this->m_vExtents.end(), qwOffset,
+			[](ULONGLONG qwValue, const CdiCompressedExtent &sExtent) { return qwValue < sExtent.qwOffset; });
+		const CdiCompressedExtent *pExtent = &*(itExtent - 1);
+
+		// Find the last chunk of the extent starting at or before the unit.
+		DWORD dwUnit = (DWORD)((qwOffset - pExtent->qwOffset) / pExtent->dwUnitSize);
+		DWORD dwLastChunk = (itExtent == this->m_vExtents.end() ? (DWORD)this->m_vChunks.size() : itExtent->dwFirstHunk);
+		auto itChunk = std::upper_bound(this->m_vChunks.begin() + pExtent->dwFirstHunk, this->m_vChunks.begin() + dwLastChunk, dwUnit,
+			[](DWORD dwValue, const CdiStoreChunkRef &sChunkRef) { return dwValue < sChunkRef.dwFirstUnit; });
+
+		*ppExtent = pExtent;
+		return (DWORD)(itChunk - this->m_vChunks.begin()) - 1;
+	}
+
+	bool CdiStoreDevice::DecodeChunk(DWORD dwChunk, const CdiCompressedExtent *pExtent, std::vector<BYTE> *pvOutput)
+	{
+		const CdiStoreChunkRef *pChunkRef = &this->m_vChunks[dwChunk];
+
+		// Get the size of the chunk, the last unit of an extent may be partial.
+		ULONGLONG qwChunkOffset = (ULONGLONG)pChunkRef->dwFirstUnit * pExtent->dwUnitSize;
+		ULONGLONG qwChunkSize = (ULONGLONG)pChunkRef->dwUnitCount * pExtent->dwUnitSize;
+		DWORD dwChunkSize = (DWORD)(pExtent->qwSize - qwChunkOffset < qwChunkSize ? pExtent->qwSize - qwChunkOffset : qwChunkSize);
+		pvOutput->resize(dwChunkSize);
+
+		// Read the payload from the store and rebuild the sectors from it.
+		std::vector<BYTE> vPayload;
+		if (this->m_sStore.ReadChunk(pChunkRef->sHash, &vPayload) == false)
+			return false;
+
+		if (DecodeSectorRun(pExtent, pChunkRef->dwFirstUnit, vPayload.data(), (DWORD)vPayload.size(), pvOutput->data(), dwChunkSize) == false)
+		{
+			printf("CdiStoreDevice::DecodeChunk(): chunk %d is corrupt!\n", dwChunk);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool CdiStoreDevice::ReadAt(ULONGLONG qwOffset, PVOID pBuffer, DWORD dwSize)
+	{
+		PBYTE pbBuffer = (PBYTE)pBuffer;
+
+		// Reads past the end of the image fail the same as they would on the image itself.
+		if (qwOffset > this->m_sHeader.qwImageSize || dwSize > this->m_sHeader.qwImageSize - qwOffset)
+			return false;
+
+		std::vector<BYTE> vChunk;
+		while (dwSize > 0)
+		{
+			// Find the chunk containing the offset.
+			const CdiCompressedExtent *pExtent;
+			DWORD dwChunk = FindChunk(qwOffset, &pExtent);
+			const CdiStoreChunkRef *pChunkRef = &this->m_vChunks[dwChunk];
+			ULONGLONG qwChunkStart = pExtent->qwOffset + (ULONGLONG)pChunkRef->dwFirstUnit * pExtent->dwUnitSize;
+			DWORD dwChunkOffset = (DWORD)(qwOffset - qwChunkStart);
+
+			// Get the number of bytes to copy out of this chunk, stopping at the end of the chunk or the extent.
+			ULONGLONG qwChunkEnd = qwChunkStart + (ULONGLONG)pChunkRef->dwUnitCount * pExtent->dwUnitSize;
+			if (qwChunkEnd > pExtent->qwOffset + pExtent->qwSize)
+				qwChunkEnd = pExtent->qwOffset + pExtent->qwSize;
+			DWORD dwCopySize = (DWORD)(qwChunkEnd - qwOffset < dwSize ? qwChunkEnd - qwOffset : dwSize);
+
+			// Check if the chunk is already cached.
+			bool bCached = false;
+			{
+				std::lock_guard<std::mutex> lock(this->m_Lock);
+
+				auto itEntry = this->m_mCacheMap.find(dwChunk);
+				if (itEntry != this->m_mCacheMap.end())
+				{
+					memcpy(pbBuffer, &itEntry->second->vData[dwChunkOffset], dwCopySize);
+					this->m_lCache.splice(this->m_lCache.begin(), this->m_lCache, itEntry->second);
+					bCached = true;
+				}
+			}
+
+			if (bCached == false)
+			{
+				// Decode the chunk without holding the lock so other threads can keep reading.
+				if (DecodeChunk(dwChunk, pExtent, &vChunk) == false)
+					return false;
+				memcpy(pbBuffer, &vChunk[dwChunkOffset], dwCopySize);
+
+				// Add the chunk to the cache, unless another thread beat us to it.
+				std::lock_guard<std::mutex> lock(this->m_Lock);
+				if (this->m_dwCacheChunks > 0 && this->m_mCacheMap.find(dwChunk) == this->m_mCacheMap.end())
+				{
+					// Evict the least recently used chunk if the cache is full.
+					if (this->m_lCache.size() >= this->m_dwCacheChunks)
+					{
+						this->m_mCacheMap.erase(this->m_lCache.back().dwChunk);
+						this->m_lCache.pop_back();
+					}
+
+					this->m_lCache.push_front(CachedChunk());
+					this->m_lCache.front().dwChunk = dwChunk;
+					this->m_lCache.front().vData.swap(vChunk);
+					this->m_mCacheMap[dwChunk] = this->m_lCache.begin();
+				}
+			}
+
+			// Next chunk.
+			pbBuffer += dwCopySize;
+			qwOffset += dwCopySize;
+			dwSize -= dwCopySize;
+		}
+
+		return true;
+	}
+
+	bool CdiStoreDevice::WriteAt(ULONGLONG qwOffset, const void *pBuffer, DWORD dwSize)
+	{
+		// Images in a store are read only.
+		(void)qwOffset;
+		(void)pBuffer;
+		(void)dwSize;
+		printf("CdiStoreDevice::WriteAt(): images in a chunk store can't be written to!\n");
+		return false;
+	}
+
+	ULONGLONG CdiStoreDevice::Size()
+	{
+		return this->m_sHeader.qwImageSize;
+	}
+
+	ULONGLONG CdiStoreDevice::ModifiedTime()
+	{
+		return this->m_pFile->ModifiedTime();
+	}
+};
\ No newline at end of file
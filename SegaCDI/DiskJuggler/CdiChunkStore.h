@@ -0,0 +1,398 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiChunkStore.h - Content addressed store that deduplicates chunks of
+		sectors across a library of cdi images.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "../IO/BlockDevice.h"
+#include "CdiFileHandle.h"
+#include "CdiCompressedImage.h"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace DiskJuggler
+{
+	// Files of the store, and the extension of the image manifests written next to them.
+	#define CDI_STORE_PACK_FILE					"chunks.pak"
+	#define CDI_STORE_INDEX_FILE				"chunks.idx"
+	#define CDI_STORE_MANIFEST_EXTENSION		".cdm"
+
+	// 'CSPK', 'CSIX' and 'CDMF', and the version of the store layout.
+	#define CDI_STORE_PACK_MAGIC				0x4B505343
+	#define CDI_STORE_INDEX_MAGIC				0x58495343
+	#define CDI_STORE_MANIFEST_MAGIC			0x464D4443
+	#define CDI_STORE_VERSION					1
+
+	// Most sectors in a chunk. Data tracks are split at the start and end of every file in their ISO9660 file
+	// system so each file lands in chunks of its own, everything else is split into chunks of this many sectors.
+	#define CDI_STORE_MAX_CHUNK_SECTORS			32
+
+	// Largest chunk, and largest payload of a chunk: one sector type byte per sector followed by the sector data.
+	#define CDI_STORE_MAX_CHUNK_SIZE			(CDI_STORE_MAX_CHUNK_SECTORS * CdiSectorSize::Size_2448)
+	#define CDI_STORE_MAX_PAYLOAD_SIZE			(CDI_STORE_MAX_CHUNK_SECTORS + CDI_STORE_MAX_CHUNK_SIZE)
+
+	// Default number of decoded chunks kept in memory by CdiStoreDevice.
+	#define CDI_STORE_DEFAULT_CACHE_CHUNKS		64
+
+	// Number of chunks each thread encodes per batch.
+	#define CDI_STORE_CHUNKS_PER_THREAD			16
+
+	/*
+		128 bit hash of a chunk payload, chunks are stored and looked up by it.
+	*/
+	struct CdiChunkHash
+	{
+		ULONGLONG qwLow;
+		ULONGLONG qwHigh;
+
+		bool operator==(const CdiChunkHash &sOther) const
+		{
+			return this->qwLow == sOther.qwLow && this->qwHigh == sOther.qwHigh;
+		}
+	};
+
+	/*
+		Hash function for using CdiChunkHash as a key, the hash is already well mixed.
+	*/
+	struct CdiChunkHashHasher
+	{
+		size_t operator()(const CdiChunkHash &sHash) const
+		{
+			return (size_t)sHash.qwLow;
+		}
+	};
+
+	/*
+		How a chunk is stored in the pack file.
+	*/
+	enum CdiChunkType : BYTE
+	{
+		ChunkStored,			// Payload is stored uncompressed
+		ChunkLz					// Payload is compressed with LzCompress()
+	};
+
+#pragma pack(push, 1)
+	struct CdiStorePackHeader
+	{
+		/* 0x00 */ DWORD dwMagic;				// CDI_STORE_PACK_MAGIC
+		/* 0x04 */ DWORD dwVersion;				// CDI_STORE_VERSION
+	};
+
+	/*
+		Chunks are appended to the pack file as this record followed by the chunk data, so the index can always be
+		rebuilt by walking the pack.
+	*/
+	struct CdiStoreChunkRecord
+	{
+		/* 0x00 */ CdiChunkHash sHash;			// Hash of the chunk payload
+		/* 0x10 */ DWORD dwSize;				// Size of the chunk data following the record
+		/* 0x14 */ DWORD dwPayloadSize;			// Size of the chunk payload once decompressed
+		/* 0x18 */ BYTE bType;					// CdiChunkType
+	};
+
+	struct CdiStoreIndexHeader
+	{
+		/* 0x00 */ DWORD dwMagic;				// CDI_STORE_INDEX_MAGIC
+		/* 0x04 */ DWORD dwVersion;				// CDI_STORE_VERSION
+		/* 0x08 */ ULONGLONG qwPackSize;		// Size of the pack covered by the index, records past it are scanned on open
+		/* 0x10 */ DWORD dwChunkCount;			// Number of entries following the header
+		/* 0x14 */ DWORD dwIndexHash;			// EDC of the entries
+	};
+
+	struct CdiStoreIndexEntry
+	{
+		/* 0x00 */ CdiChunkHash sHash;			// Hash of the chunk payload
+		/* 0x10 */ ULONGLONG qwOffset;			// Offset of the chunk data in the pack file
+		/* 0x18 */ DWORD dwSize;				// Size of the chunk data
+		/* 0x1C */ DWORD dwPayloadSize;			// Size of the chunk payload once decompressed
+		/* 0x20 */ BYTE bType;					// CdiChunkType
+	};
+
+	/*
+		Manifest layout: the header, the extent table and the chunk reference table. The extents are the same as
+		the ones of a compressed container, except dwFirstHunk is the index of the first chunk reference of the extent.
+	*/
+	struct CdiStoreManifestHeader
+	{
+		/* 0x00 */ DWORD dwMagic;				// CDI_STORE_MANIFEST_MAGIC
+		/* 0x04 */ DWORD dwVersion;				// CDI_STORE_VERSION
+		/* 0x08 */ ULONGLONG qwImageSize;		// Size of the image
+		/* 0x10 */ DWORD dwExtentCount;			// Number of entries in the extent table
+		/* 0x14 */ DWORD dwChunkCount;			// Number of entries in the chunk reference table
+		/* 0x18 */ DWORD dwIndexHash;			// EDC of the extent and chunk reference tables
+	};
+
+	struct CdiStoreChunkRef
+	{
+		/* 0x00 */ CdiChunkHash sHash;			// Hash of the chunk payload
+		/* 0x10 */ DWORD dwFirstUnit;			// Index of the first unit of the chunk in its extent
+		/* 0x14 */ DWORD dwUnitCount;			// Number of units in the chunk
+	};
+#pragma pack(pop)
+
+	struct CdiStoreStats
+	{
+		ULONGLONG qwImageBytes;			// Size of the images added to the store
+		ULONGLONG qwStoredBytes;		// Number of bytes appended to the pack file for them
+		ULONGLONG qwChunkCount;			// Number of chunks the images were split into
+		ULONGLONG qwNewChunkCount;		// Number of those chunks that weren't in the store yet
+		double dSeconds;				// Time spent adding the images
+	};
+
+	/*
+		Description: Hashes a chunk payload.
+	*/
+	CdiChunkHash ComputeChunkHash(const BYTE *pbData, DWORD dwSize);
+
+	//-----------------------------------------------------
+	// CdiChunkStore
+	//-----------------------------------------------------
+	/*
+		Folder of chunks shared by many images. Images are split into chunks that are encoded the same way as the
+		hunks of a compressed container, then stored once under the hash of their payload. Each image gets a
+		manifest listing the chunks it is made of, so identical files in region variants or rebuilds of the same
+		game are only stored once.
+	*/
+	class CdiChunkStore
+	{
+	protected:
+		/*
+			Chunk of an image being added to the store.
+		*/
+		struct ChunkJob
+		{
+			const CdiCompressedExtent *pExtent;	// Extent the chunk belongs to
+			DWORD dwFirstUnit;					// Index of the first unit of the chunk in the extent
+			DWORD dwUnitCount;					// Number of units in the chunk
+			const BYTE *pbInput;				// Chunk data
+			DWORD dwInputSize;					// Size of the chunk data
+			std::vector<BYTE> vPayload;			// Payload of the chunk
+			CdiChunkHash sHash;					// Hash of the payload
+			bool bNew;							// True if the chunk has to be added to the pack
+			bool bStored;						// True if a chunk with the same hash is already in the pack
+			bool bMismatch;						// True if the chunk with the same hash has a different payload
+			std::vector<BYTE> vOutput;			// Chunk data to append to the pack
+			BYTE bType;							// CdiChunkType of the output
+		};
+
+		CString		m_sFolder;				// Store folder
+		bool		m_bWrite;				// True if the store was opened for adding images
+		DWORD		m_dwThreadCount;		// Number of threads used to encode chunks
+
+		IO::BlockDevice		*m_pPackFile;	// Pack file
+		ULONGLONG			m_qwPackSize;	// End of the last valid chunk record in the pack
+		bool				m_bIndexDirty;	// True if the index file has to be rewritten
+
+		std::vector<CdiStoreIndexEntry>		m_vChunks;		// Every chunk in the pack
+		std::unordered_map<CdiChunkHash, DWORD, CdiChunkHashHasher>	m_mChunkMap;	// Lookup from hash to entry
+
+		CdiStoreStats		m_sStats;
+
+		/*
+			Description: Loads the index file, checking it matches the pack file.
+
+			Returns: True if the index was loaded, false if it is missing or corrupt.
+		*/
+		bool LoadIndex();
+
+		/*
+			Description: Adds the chunk records in the pack file past the end of the index to it. A damaged record at
+				the end of the pack, from an interrupted write, is dropped along with anything after it.
+
+			Returns: True if the pack could be read, false otherwise.
+		*/
+		bool ScanPack();
+
+		/*
+			Description: Writes the index file.
+		*/
+		bool SaveIndex();
+
+		/*
+			Description: Adds a chunk entry to the lookup map.
+		*/
+		void AddChunkEntry(const CdiStoreIndexEntry *pEntry);
+
+		/*
+			Description: Splits an extent into chunks, breaking data tracks at the file boundaries.
+
+			Parameters:
+				pExtent: Extent to split.
+				vBoundaries: Sorted LBAs files start and end at.
+				pvJobs: Receives the chunks.
+		*/
+		void SplitExtent(const CdiCompressedExtent *pExtent, const std::vector<DWORD> &vBoundaries, std::vector<ChunkJob> *pvJobs);
+
+		/*
+			Description: Finds the LBAs the files of every ISO9660 file system in the image start and end at.
+		*/
+		void FindFileBoundaries(CdiFileHandle *pCdiFile, std::vector<DWORD> *pvBoundaries);
+
+		/*
+			Description: Builds and hashes the payloads of a run of chunks, or compresses the new ones and compares
+				the ones already in the pack against the stored payload, run on each of the worker threads.
+		*/
+		void EncodeChunks(ChunkJob *psJobs, DWORD dwJobCount, bool bCompress);
+
+		/*
+			Description: Runs EncodeChunks() over a batch of chunks on the worker threads.
+		*/
+		void RunEncodeJobs(ChunkJob *psJobs, DWORD dwJobCount, bool bCompress);
+
+	public:
+		/*
+			Parameters:
+				dwThreadCount: Number of threads used to encode chunks, 0 uses one per processor.
+		*/
+		CdiChunkStore(DWORD dwThreadCount = 0);
+		~CdiChunkStore();
+
+		/*
+			Description: Opens a store, creating it if it doesn't exist and bWrite is true.
+
+			Parameters:
+				sFolder: Store folder.
+				bWrite: True to add images to the store, false to only read chunks from it.
+
+			Returns: True if the store was opened, false otherwise.
+		*/
+		bool Open(CString sFolder, bool bWrite);
+
+		/*
+			Description: Writes out the index and closes the store.
+
+			Returns: True if the index was written, false otherwise.
+		*/
+		bool Close();
+
+		/*
+			Description: Adds an image to the store and writes its manifest, replacing any existing file. A chunk
+				whose hash is already in the store is only shared if the payloads are the same, if they differ the
+				image can't be added.
+
+			Parameters:
+				sImageFile: Image to add.
+				sManifestFile: Manifest file to create.
+
+			Returns: True if the image was added, false otherwise.
+		*/
+		bool AddImage(CString sImageFile, CString sManifestFile);
+
+		/*
+			Description: Reads the payload of a chunk and checks it against its hash.
+
+			Parameters:
+				sHash: Hash of the chunk.
+				pvPayload: Receives the payload.
+
+			Returns: True if the chunk was read, false if it isn't in the store or is corrupt.
+		*/
+		bool ReadChunk(const CdiChunkHash &sHash, std::vector<BYTE> *pvPayload);
+
+		/*
+			Description: Gets the size of the pack file and the number of chunks in the store.
+		*/
+		ULONGLONG PackSize();
+		DWORD ChunkCount();
+
+		/*
+			Description: Gets the statistics of the images added since the store was opened.
+		*/
+		void GetStats(CdiStoreStats *pStats);
+	};
+
+	//-----------------------------------------------------
+	// CdiStoreDevice
+	//-----------------------------------------------------
+	/*
+		Read only block device presenting an image stored in a chunk store. Chunks are read from the store and
+		decoded on demand and the most recently used ones are cached, the device can be read from multiple threads
+		at once.
+	*/
+	class CdiStoreDevice : public IO::BlockDevice
+	{
+	protected:
+		struct CachedChunk
+		{
+			DWORD dwChunk;					// Index of the chunk reference
+			std::vector<BYTE> vData;		// Decoded chunk
+		};
+
+		IO::BlockDevice				*m_pFile;			// Manifest file
+		CdiChunkStore				m_sStore;			// Store the chunks are read from
+		CdiStoreManifestHeader		m_sHeader;			// Manifest header
+		std::vector<CdiCompressedExtent>	m_vExtents;	// Extent table
+		std::vector<CdiStoreChunkRef>		m_vChunks;	// Chunk reference table
+
+		// Decoded chunk cache.
+		std::list<CachedChunk>		m_lCache;			// Cached chunks, most recently used first
+		std::unordered_map<DWORD, std::list<CachedChunk>::iterator>	m_mCacheMap;	// Lookup from chunk index to entry
+		std::mutex					m_Lock;				// Protects the cache
+		DWORD						m_dwCacheChunks;	// Maximum number of chunks to cache
+
+		/*
+			Description: Checks the extent and chunk reference tables describe a valid image.
+		*/
+		bool ValidateIndex();
+
+		/*
+			Description: Finds the chunk containing an offset in the image.
+
+			Parameters:
+				qwOffset: Offset in the image.
+				ppExtent: Receives the extent containing the offset.
+
+			Returns: Index of the chunk reference.
+		*/
+		DWORD FindChunk(ULONGLONG qwOffset, const CdiCompressedExtent **ppExtent);
+
+		/*
+			Description: Reads and decodes a chunk.
+
+			Parameters:
+				dwChunk: Index of the chunk reference.
+				pExtent: Extent the chunk belongs to.
+				pvOutput: Receives the decoded chunk.
+
+			Returns: True if the chunk was decoded, false if it could not be read or is corrupt.
+		*/
+		bool DecodeChunk(DWORD dwChunk, const CdiCompressedExtent *pExtent, std::vector<BYTE> *pvOutput);
+
+	public:
+		/*
+			Parameters:
+				dwCacheChunks: Number of decoded chunks to keep in memory.
+		*/
+		CdiStoreDevice(DWORD dwCacheChunks = CDI_STORE_DEFAULT_CACHE_CHUNKS);
+		~CdiStoreDevice();
+
+		/*
+			Description: Checks if a device starts with the manifest magic.
+		*/
+		static bool IsManifest(IO::BlockDevice *pDevice);
+
+		/*
+			Description: Reads a manifest and opens the store it belongs to, which is the folder the manifest is in.
+
+			Parameters:
+				pFile: Manifest file, the device takes ownership of it if it was opened.
+				sManifestFile: Path of the manifest file.
+
+			Returns: True if the manifest was opened, false otherwise.
+		*/
+		bool Open(IO::BlockDevice *pFile, CString sManifestFile);
+
+		bool ReadAt(ULONGLONG qwOffset, PVOID pBuffer, DWORD dwSize);
+		bool WriteAt(ULONGLONG qwOffset, const void *pBuffer, DWORD dwSize);
+		ULONGLONG Size();
+		ULONGLONG ModifiedTime();
+	};
+};
\ No newline at end of file
@@ -0,0 +1,822 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiCompressedImage.cpp - Seekable compressed container for cdi images, split
+		into independently compressed hunks with an index at the tail.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiCompressedImage.h"
+#include "CdiEdcEcc.h"
+#include "../IO/LzCodec.h"
+#include <algorithm>
+#include <thread>
+
+namespace DiskJuggler
+{
+	/*
+		Description: Gets the part of a data sector that has to be stored when the rest of it is regenerated: the
+			subheader and user data of mode 2 sectors or the user data of mode 1 sectors, everything up to the EDC.
+
+		Parameters:
+			dwSectorSize: Size of the sector in the image.
+			eMode: Mode of the track the sector belongs to.
+			bSubmode: Submode byte of the subheader, selects between mode 2 form 1 and form 2.
+			pdwOffset: Receives the offset of the data in the sector.
+			pdwSize: Receives the size of the data.
+	*/
+	static void GetSectorPayload(DWORD dwSectorSize, CdiTrackMode eMode, BYTE bSubmode, DWORD *pdwOffset, DWORD *pdwSize)
+	{
+		// 2336 byte sectors start at the subheader, raw sectors have the sync pattern and header in front of it.
+		DWORD dwBase = (dwSectorSize == CdiSectorSize::Size_2336 ? CD_SUBHEADER_OFFSET : 0);
+		*pdwOffset = CD_SUBHEADER_OFFSET - dwBase;
+
+		if (eMode == CdiTrackMode::Mode1)
+			*pdwSize = CD_MODE1_EDC_OFFSET - CD_SUBHEADER_OFFSET;
+		else if ((bSubmode & CD_SUBMODE_FORM2) != 0)
+			*pdwSize = CD_MODE2_FORM2_EDC_OFFSET - CD_SUBHEADER_OFFSET;
+		else
+			*pdwSize = CD_MODE2_FORM1_EDC_OFFSET - CD_SUBHEADER_OFFSET;
+	}
+
+	/*
+		Description: Rebuilds a data sector from the data kept by GetSectorPayload() followed by any subchannel data.
+
+		Parameters:
+			pbSector: Buffer that receives the sector.
+			dwSectorSize: Size of the sector in the image.
+			eMode: Mode of the track the sector belongs to.
+			dwLBA: LBA of the sector.
+			pbPayload: Stored data of the sector.
+			dwPayloadSize: Number of bytes available at pbPayload.
+			pdwUsed: Receives the number of bytes of pbPayload used.
+
+		Returns: True if the sector was rebuilt, false if pbPayload is too short.
+	*/
+	static bool RebuildSector(PBYTE pbSector, DWORD dwSectorSize, CdiTrackMode eMode, DWORD dwLBA, const BYTE *pbPayload, DWORD dwPayloadSize, DWORD *pdwUsed)
+	{
+		// Work out how much of the sector is stored, the submode is the third byte of the subheader.
+		DWORD dwOffset, dwSize;
+		BYTE bSubmode = (eMode == CdiTrackMode::Mode2 && dwPayloadSize > 2 ? pbPayload[2] : 0);
+		GetSectorPayload(dwSectorSize, eMode, bSubmode, &dwOffset, &dwSize);
+
+		DWORD dwSubchannelSize = (dwSectorSize > CD_RAW_SECTOR_SIZE ? dwSectorSize - CD_RAW_SECTOR_SIZE : 0);
+		if (dwSize + dwSubchannelSize > dwPayloadSize)
+			return false;
+
+		// Place the stored data and rebuild everything else.
+		memset(pbSector, 0, dwSectorSize);
+		memcpy(&pbSector[dwOffset], pbPayload, dwSize);
+		memcpy(&pbSector[CD_RAW_SECTOR_SIZE], &pbPayload[dwSize], dwSubchannelSize);
+		RegenerateSectors(pbSector, (CdiSectorSize)dwSectorSize, eMode, dwLBA, 1, RegenerateHeader | RegenerateEdcEcc);
+
+		*pdwUsed = dwSize + dwSubchannelSize;
+		return true;
+	}
+
+	/*
+		Description: Checks if every byte of a block is zero.
+	*/
+	static bool IsZeroBlock(const BYTE *pbData, DWORD dwSize)
+	{
+		for (DWORD i = 0; i < dwSize; i++)
+		{
+			if (pbData[i] != 0)
+				return false;
+		}
+
+		return true;
+	}
+
+	/*
+		Description: Gets the number of units in a hunk, the last unit of an extent may be partial.
+	*/
+	static inline DWORD HunkUnitCount(DWORD dwHunkSize, DWORD dwUnitSize)
+	{
+		return (dwHunkSize + dwUnitSize - 1) / dwUnitSize;
+	}
+
+	bool BuildImageExtents(CdiFileHandle *pCdiFile, ULONGLONG qwImageSize, std::vector<CdiCompressedExtent> *pvExtents)
+	{
+		// Create an extent for every track that has sectors in the image.
+		std::vector<CdiCompressedExtent> vTracks;
+		ArrayView<CdiSession> sessionCollection = pCdiFile->GetSessions();
+		for (size_t i = 0; i < sessionCollection.size(); i++)
+		{
+			for (DWORD x = 0; x < sessionCollection[i]->wTrackCount; x++)
+			{
+				const CdiTrack *pTrack = &sessionCollection[i]->psTracks[x];
+				const CdiTrackOffsetInfo *pOffsetInfo = pCdiFile->GetTrackOffsetInfo((DWORD)i, x);
+				if (pOffsetInfo == nullptr || pTrack->dwPregapLength + pTrack->dwLength == 0)
+					continue;
+
+				CdiCompressedExtent sExtent = { };
+				sExtent.qwOffset = pOffsetInfo->qwPregapOffset;
+				sExtent.qwSize = (ULONGLONG)(pTrack->dwPregapLength + pTrack->dwLength) * pOffsetInfo->dwSectorStride;
+				sExtent.dwUnitSize = pOffsetInfo->dwSectorStride;
+				sExtent.dwFirstLBA = pTrack->dwLba - pTrack->dwPregapLength;
+				sExtent.bMode = (BYTE)pTrack->eMode;
+				vTracks.push_back(sExtent);
+			}
+		}
+
+		std::sort(vTracks.begin(), vTracks.end(),
+			[](const CdiCompressedExtent &sFirst, const CdiCompressedExtent &sSecond) { return sFirst.qwOffset < sSecond.qwOffset; });
+
+		// Lay the tracks out in order and fill the space between them with raw extents.
+		pvExtents->clear();
+		ULONGLONG qwOffset = 0;
+		for (size_t i = 0; i <= vTracks.size(); i++)
+		{
+			ULONGLONG qwNextOffset = (i < vTracks.size() ? vTracks[i].qwOffset : qwImageSize);
+			if (qwNextOffset < qwOffset || (i < vTracks.size() && vTracks[i].qwSize > qwImageSize - qwNextOffset))
+			{
+				printf("BuildImageExtents(): tracks overlap or run past the end of the image!\n");
+				return false;
+			}
+
+			if (qwNextOffset > qwOffset)
+			{
+				CdiCompressedExtent sExtent = { };
+				sExtent.qwOffset = qwOffset;
+				sExtent.qwSize = qwNextOffset - qwOffset;
+				sExtent.dwUnitSize = CDI_COMPRESSED_RAW_UNIT_SIZE;
+				sExtent.bMode = CDI_COMPRESSED_NO_TRACK;
+				pvExtents->push_back(sExtent);
+			}
+
+			if (i < vTracks.size())
+			{
+				pvExtents->push_back(vTracks[i]);
+				qwOffset = vTracks[i].qwOffset + vTracks[i].qwSize;
+			}
+		}
+
+		return true;
+	}
+
+	DWORD EncodeSectorRun(const CdiCompressedExtent *pExtent, DWORD dwUnitIndex, const BYTE *pbInput, DWORD dwInputSize,
+		std::vector<BYTE> *pvPayload, DWORD *pdwZeroSectors, DWORD *pdwRegeneratedSectors)
+	{
+		DWORD dwUnitCount = HunkUnitCount(dwInputSize, pExtent->dwUnitSize);
+		bool bRegenerate = (pExtent->bMode != CDI_COMPRESSED_NO_TRACK &&
+			CanVerifySectors((CdiSectorSize)pExtent->dwUnitSize, (CdiTrackMode)pExtent->bMode) == true);
+
+		// Build the payload: the type of each sector followed by the data that has to be stored for it.
+		pvPayload->resize(dwUnitCount + dwInputSize);
+		BYTE bSector[CdiSectorSize::Size_2448];
+		DWORD dwPosition = dwUnitCount;
+		*pdwZeroSectors = 0;
+		*pdwRegeneratedSectors = 0;
+		for (DWORD i = 0; i < dwUnitCount; i++)
+		{
+			const BYTE *pbUnit = &pbInput[(SIZE_T)i * pExtent->dwUnitSize];
+			DWORD dwUnitSize = (dwInputSize - i * pExtent->dwUnitSize < pExtent->dwUnitSize ? dwInputSize - i * pExtent->dwUnitSize : pExtent->dwUnitSize);
+
+			// Sectors that are all zeros don't need to be stored at all.
+			if (IsZeroBlock(pbUnit, dwUnitSize) == true)
+			{
+				(*pvPayload)[i] = CdiHunkSectorType::SectorZero;
+				(*pdwZeroSectors)++;
+				continue;
+			}
+
+			// Data sectors only need their user data stored if rebuilding the rest gives back the exact sector.
+			if (bRegenerate == true && dwUnitSize == pExtent->dwUnitSize)
+			{
+				DWORD dwOffset, dwSize, dwUsed;
+				CdiTrackMode eMode = (CdiTrackMode)pExtent->bMode;
+				GetSectorPayload(dwUnitSize, eMode, pbUnit[(dwUnitSize == CdiSectorSize::Size_2336 ? 0 : CD_SUBHEADER_OFFSET) + 2], &dwOffset, &dwSize);
+
+				DWORD dwSubchannelSize = (dwUnitSize > CD_RAW_SECTOR_SIZE ? dwUnitSize - CD_RAW_SECTOR_SIZE : 0);
+				memcpy(&(*pvPayload)[dwPosition], &pbUnit[dwOffset], dwSize);
+				memcpy(&(*pvPayload)[dwPosition + dwSize], &pbUnit[CD_RAW_SECTOR_SIZE], dwSubchannelSize);
+
+				if (RebuildSector(bSector, dwUnitSize, eMode, pExtent->dwFirstLBA + dwUnitIndex + i, &(*pvPayload)[dwPosition],
+					dwSize + dwSubchannelSize, &dwUsed) == true && memcmp(bSector, pbUnit, dwUnitSize) == 0)
+				{
+					(*pvPayload)[i] = CdiHunkSectorType::SectorRegenerated;
+					dwPosition += dwUsed;
+					(*pdwRegeneratedSectors)++;
+					continue;
+				}
+			}
+
+			// Store the whole sector.
+			(*pvPayload)[i] = CdiHunkSectorType::SectorStored;
+			memcpy(&(*pvPayload)[dwPosition], pbUnit, dwUnitSize);
+			dwPosition += dwUnitSize;
+		}
+
+		pvPayload->resize(dwPosition);
+		return dwPosition;
+	}
+
+	bool DecodeSectorRun(const CdiCompressedExtent *pExtent, DWORD dwUnitIndex, const BYTE *pbPayload, DWORD dwPayloadSize, PBYTE pbOutput, DWORD dwOutputSize)
+	{
+		// The payload starts with the type of each sector followed by the data stored for them.
+		DWORD dwUnitCount = HunkUnitCount(dwOutputSize, pExtent->dwUnitSize);
+		DWORD dwPosition = dwUnitCount;
+		if (dwPayloadSize < dwUnitCount)
+			return false;
+
+		for (DWORD i = 0; i < dwUnitCount; i++)
+		{
+			PBYTE pbUnit = &pbOutput[(SIZE_T)i * pExtent->dwUnitSize];
+			DWORD dwUnitSize = (dwOutputSize - i * pExtent->dwUnitSize < pExtent->dwUnitSize ? dwOutputSize - i * pExtent->dwUnitSize : pExtent->dwUnitSize);
+			DWORD dwAvailable = dwPayloadSize - dwPosition;
+
+			bool bValid = true;
+			switch (pbPayload[i])
+			{
+			case CdiHunkSectorType::SectorStored:
+				{
+					bValid = (dwUnitSize <= dwAvailable);
+					if (bValid == true)
+					{
+						memcpy(pbUnit, &pbPayload[dwPosition], dwUnitSize);
+						dwPosition += dwUnitSize;
+					}
+					break;
+				}
+			case CdiHunkSectorType::SectorZero:
+				{
+					memset(pbUnit, 0, dwUnitSize);
+					break;
+				}
+			case CdiHunkSectorType::SectorRegenerated:
+				{
+					// Only whole data sectors are regenerated.
+					DWORD dwUsed = 0;
+					bValid = (pExtent->bMode != CDI_COMPRESSED_NO_TRACK && dwUnitSize == pExtent->dwUnitSize &&
+						CanVerifySectors((CdiSectorSize)dwUnitSize, (CdiTrackMode)pExtent->bMode) == true &&
+						RebuildSector(pbUnit, dwUnitSize, (CdiTrackMode)pExtent->bMode, pExtent->dwFirstLBA + dwUnitIndex + i,
+							&pbPayload[dwPosition], dwAvailable, &dwUsed) == true);
+					dwPosition += dwUsed;
+					break;
+				}
+			default:
+				bValid = false;
+				break;
+			}
+
+			if (bValid == false)
+				return false;
+		}
+
+		// Every byte of the payload should have been used.
+		return dwPosition == dwPayloadSize;
+	}
+
+	//-----------------------------------------------------
+	// CdiCompressedDevice
+	//-----------------------------------------------------
+	CdiCompressedDevice::CdiCompressedDevice(DWORD dwCacheHunks)
+	{
+		// Initialize fields.
+		this->m_pFile = nullptr;
+		memset(&this->m_sHeader, 0, sizeof(this->m_sHeader));
+		this->m_dwCacheHunks = dwCacheHunks;
+		this->m_qwHits = 0;
+		this->m_qwMisses = 0;
+	}
+
+	CdiCompressedDevice::~CdiCompressedDevice()
+	{
+		// Close the container file.
+		if (this->m_pFile != nullptr)
+			delete this->m_pFile;
+	}
+
+	bool CdiCompressedDevice::IsCompressedImage(IO::BlockDevice *pDevice)
+	{
+		// Check the file starts with the container magic.
+		DWORD dwMagic = 0;
+		return pDevice->Size() >= sizeof(CdiCompressedHeader) && pDevice->ReadAt(0, &dwMagic, sizeof(dwMagic)) == true &&
+			dwMagic == CDI_COMPRESSED_MAGIC;
+	}
+
+	bool CdiCompressedDevice::Open(IO::BlockDevice *pFile)
+	{
+		// Read the header and check it is a container we can read.
+		ULONGLONG qwFileSize = pFile->Size();
+		if (qwFileSize < sizeof(CdiCompressedHeader) || pFile->ReadAt(0, &this->m_sHeader, sizeof(CdiCompressedHeader)) == false)
+		{
+			printf("CdiCompressedDevice::Open(): failed to read the container header!\n");
+			return false;
+		}
+
+		if (this->m_sHeader.dwMagic != CDI_COMPRESSED_MAGIC || this->m_sHeader.dwVersion != CDI_COMPRESSED_VERSION ||
+			this->m_sHeader.dwHunkSectors != CDI_COMPRESSED_HUNK_SECTORS)
+		{
+			printf("CdiCompressedDevice::Open(): unsupported container version %d!\n", this->m_sHeader.dwVersion);
+			return false;
+		}
+
+		// The index is at the tail of the file, check it fills the rest of the file exactly.
+		ULONGLONG qwIndexSize = ((ULONGLONG)this->m_sHeader.dwExtentCount * sizeof(CdiCompressedExtent)) +
+			((ULONGLONG)this->m_sHeader.dwHunkCount * sizeof(CdiCompressedHunk));
+		if (this->m_sHeader.qwIndexOffset < sizeof(CdiCompressedHeader) || this->m_sHeader.qwIndexOffset > qwFileSize ||
+			qwIndexSize != qwFileSize - this->m_sHeader.qwIndexOffset || qwIndexSize > 0x7FFFFFFF)
+		{
+			printf("CdiCompressedDevice::Open(): container index is truncated!\n");
+			return false;
+		}
+
+		// Read the index and check it wasn't damaged.
+		std::vector<BYTE> vIndex((SIZE_T)qwIndexSize);
+		if (pFile->ReadAt(this->m_sHeader.qwIndexOffset, vIndex.data(), (DWORD)qwIndexSize) == false ||
+			ComputeEdc(0, vIndex.data(), (DWORD)qwIndexSize) != this->m_sHeader.dwIndexHash)
+		{
+			printf("CdiCompressedDevice::Open(): container index is corrupt!\n");
+			return false;
+		}
+
+		this->m_vExtents.resize(this->m_sHeader.dwExtentCount);
+		this->m_vHunks.resize(this->m_sHeader.dwHunkCount);
+		memcpy(this->m_vExtents.data(), vIndex.data(), this->m_vExtents.size() * sizeof(CdiCompressedExtent));
+		memcpy(this->m_vHunks.data(), &vIndex[this->m_vExtents.size() * sizeof(CdiCompressedExtent)], this->m_vHunks.size() * sizeof(CdiCompressedHunk));
+		if (ValidateIndex() == false)
+		{
+			printf("CdiCompressedDevice::Open(): container index is corrupt!\n");
+			return false;
+		}
+
+		// Take ownership of the file.
+		this->m_pFile = pFile;
+		return true;
+	}
+
+	bool CdiCompressedDevice::ValidateIndex()
+	{
+		// Check the extents cover the whole image in order and their hunks add up to the hunk table.
+		ULONGLONG qwOffset = 0;
+		DWORD dwHunkCount = 0;
+		for (size_t i = 0; i < this->m_vExtents.size(); i++)
+		{
+			const CdiCompressedExtent *pExtent = &this->m_vExtents[i];
+			if (pExtent->qwOffset != qwOffset || pExtent->qwSize == 0 || pExtent->qwSize > this->m_sHeader.qwImageSize - qwOffset ||
+				pExtent->dwFirstHunk != dwHunkCount)
+				return false;
+
+			// Units are either track sectors or raw data.
+			if (pExtent->dwUnitSize != CdiSectorSize::Size_2048 && pExtent->dwUnitSize != CdiSectorSize::Size_2336 &&
+				pExtent->dwUnitSize != CdiSectorSize::Size_2352 && pExtent->dwUnitSize != CdiSectorSize::Size_2368 &&
+				pExtent->dwUnitSize != CdiSectorSize::Size_2448)
+				return false;
+			if (pExtent->bMode > CdiTrackMode::Mode2 && pExtent->bMode != CDI_COMPRESSED_NO_TRACK)
+				return false;
+
+			ULONGLONG qwHunkSize = (ULONGLONG)pExtent->dwUnitSize * CDI_COMPRESSED_HUNK_SECTORS;
+			ULONGLONG qwExtentHunks = (pExtent->qwSize + qwHunkSize - 1) / qwHunkSize;
+			if (qwExtentHunks > this->m_vHunks.size() - dwHunkCount)
+				return false;
+
+			qwOffset += pExtent->qwSize;
+			dwHunkCount += (DWORD)qwExtentHunks;
+		}
+
+		if (qwOffset != this->m_sHeader.qwImageSize || dwHunkCount != this->m_vHunks.size())
+			return false;
+
+		// Check every hunk lies between the header and the index.
+		for (size_t i = 0; i < this->m_vHunks.size(); i++)
+		{
+			const CdiCompressedHunk *pHunk = &this->m_vHunks[i];
+			if (pHunk->bType == CdiHunkType::HunkZero)
+				continue;
+
+			if (pHunk->bType > CdiHunkType::HunkLz || pHunk->dwPayloadSize > CDI_COMPRESSED_MAX_PAYLOAD_SIZE ||
+				pHunk->dwSize > pHunk->dwPayloadSize || (pHunk->bType == CdiHunkType::HunkStored && pHunk->dwSize != pHunk->dwPayloadSize) ||
+				pHunk->qwOffset < sizeof(CdiCompressedHeader) || pHunk->qwOffset > this->m_sHeader.qwIndexOffset ||
+				pHunk->dwSize > this->m_sHeader.qwIndexOffset - pHunk->qwOffset)
+				return false;
+		}
+
+		return true;
+	}
+
+	const CdiCompressedExtent *CdiCompressedDevice::FindExtent(ULONGLONG qwOffset)
+	{
+		// Find the last extent starting at or before the offset.
+		auto itExtent = std::upper_bound(this->m_vExtents.begin(), this->m_vExtents.end(), qwOffset,
+			[](ULONGLONG qwValue, const CdiCompressedExtent &sExtent) { return qwValue < sExtent.qwOffset; });
+		return &*(itExtent - 1);
+	}
+
+	bool CdiCompressedDevice::DecodeHunk(DWORD dwHunk, const CdiCompressedExtent *pExtent, std::vector<BYTE> *pvOutput)
+	{
+		const CdiCompressedHunk *pHunk = &this->m_vHunks[dwHunk];
+
+		// Get the size of the hunk, the last hunk of an extent may be short.
+		DWORD dwUnitIndex = (dwHunk - pExtent->dwFirstHunk) * CDI_COMPRESSED_HUNK_SECTORS;
+		ULONGLONG qwHunkOffset = (ULONGLONG)dwUnitIndex * pExtent->dwUnitSize;
+		DWORD dwHunkSize = (DWORD)(pExtent->qwSize - qwHunkOffset < (ULONGLONG)pExtent->dwUnitSize * CDI_COMPRESSED_HUNK_SECTORS ?
+			pExtent->qwSize - qwHunkOffset : (ULONGLONG)pExtent->dwUnitSize * CDI_COMPRESSED_HUNK_SECTORS);
+		pvOutput->resize(dwHunkSize);
+
+		// Hunks that are all zeros aren't stored.
+		if (pHunk->bType == CdiHunkType::HunkZero)
+		{
+			memset(pvOutput->data(), 0, dwHunkSize);
+			return true;
+		}
+
+		// Read the hunk and decompress the payload.
+		std::vector<BYTE> vData(pHunk->dwSize);
+		std::vector<BYTE> vPayload;
+		if (this->m_pFile->ReadAt(pHunk->qwOffset, vData.data(), pHunk->dwSize) == false)
+		{
+			printf("CdiCompressedDevice::DecodeHunk(): failed to read hunk %d!\n", dwHunk);
+			return false;
+		}
+
+		if (pHunk->bType == CdiHunkType::HunkLz)
+		{
+			vPayload.resize(pHunk->dwPayloadSize);
+			if (IO::LzDecompress(vData.data(), pHunk->dwSize, vPayload.data(), pHunk->dwPayloadSize) == false)
+			{
+				printf("CdiCompressedDevice::DecodeHunk(): hunk %d is corrupt!\n", dwHunk);
+				return false;
+			}
+		}
+		else
+			vPayload.swap(vData);
+
+		// Rebuild the sectors from the payload.
+		if (DecodeSectorRun(pExtent, dwUnitIndex, vPayload.data(), (DWORD)vPayload.size(), pvOutput->data(), dwHunkSize) == false)
+		{
+			printf("CdiCompressedDevice::DecodeHunk(): hunk %d is corrupt!\n", dwHunk);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool CdiCompressedDevice::ReadAt(ULONGLONG qwOffset, PVOID pBuffer, DWORD dwSize)
+	{
+		PBYTE pbBuffer = (PBYTE)pBuffer;
+
+		// Reads past the end of the image fail the same as they would on the uncompressed image.
+		if (qwOffset > this->m_sHeader.qwImageSize || dwSize > this->m_sHeader.qwImageSize - qwOffset)
+			return false;
+
+		std::vector<BYTE> vHunk;
+		while (dwSize > 0)
+		{
+			// Find the hunk containing the offset.
+			const CdiCompressedExtent *pExtent = FindExtent(qwOffset);
+			ULONGLONG qwHunkSize = (ULONGLONG)pExtent->dwUnitSize * CDI_COMPRESSED_HUNK_SECTORS;
+			DWORD dwHunk = pExtent->dwFirstHunk + (DWORD)((qwOffset - pExtent->qwOffset) / qwHunkSize);
+			DWORD dwHunkOffset = (DWORD)((qwOffset - pExtent->qwOffset) % qwHunkSize);
+
+			// Get the number of bytes to copy out of this hunk, stopping at the end of the hunk or the extent.
+			ULONGLONG qwHunkEnd = pExtent->qwOffset + (dwHunk - pExtent->dwFirstHunk + 1) * qwHunkSize;
+			if (qwHunkEnd > pExtent->qwOffset + pExtent->qwSize)
+				qwHunkEnd = pExtent->qwOffset + pExtent->qwSize;
+			DWORD dwCopySize = (DWORD)(qwHunkEnd - qwOffset < dwSize ? qwHunkEnd - qwOffset : dwSize);
+
+			// Check if the hunk is already cached.
+			bool bCached = false;
+			{
+				std::lock_guard<std::mutex> lock(this->m_Lock);
+
+				auto itEntry = this->m_mCacheMap.find(dwHunk);
+				if (itEntry != this->m_mCacheMap.end())
+				{
+					memcpy(pbBuffer, &itEntry->second->vData[dwHunkOffset], dwCopySize);
+					this->m_lCache.splice(this->m_lCache.begin(), this->m_lCache, itEntry->second);
+					this->m_qwHits++;
+					bCached = true;
+				}
+			}
+
+			if (bCached == false)
+			{
+				// Decompress the hunk without holding the lock so other threads can keep reading.
+				if (DecodeHunk(dwHunk, pExtent, &vHunk) == false)
+					return false;
+				memcpy(pbBuffer, &vHunk[dwHunkOffset], dwCopySize);
+
+				// Add the hunk to the cache, unless another thread beat us to it.
+				std::lock_guard<std::mutex> lock(this->m_Lock);
+				this->m_qwMisses++;
+				if (this->m_dwCacheHunks > 0 && this->m_mCacheMap.find(dwHunk) == this->m_mCacheMap.end())
+				{
+					// Evict the least recently used hunk if the cache is full.
+					if (this->m_lCache.size() >= this->m_dwCacheHunks)
+					{
+						this->m_mCacheMap.erase(this->m_lCache.back().dwHunk);
+						this->m_lCache.pop_back();
+					}
+
+					this->m_lCache.push_front(CachedHunk());
+					this->m_lCache.front().dwHunk = dwHunk;
+					this->m_lCache.front().vData.swap(vHunk);
+					this->m_mCacheMap[dwHunk] = this->m_lCache.begin();
+				}
+			}
+
+			// Next hunk.
+			pbBuffer += dwCopySize;
+			qwOffset += dwCopySize;
+			dwSize -= dwCopySize;
+		}
+
+		return true;
+	}
+
+	bool CdiCompressedDevice::WriteAt(ULONGLONG qwOffset, const void *pBuffer, DWORD dwSize)
+	{
+		// Compressed images are read only.
+		(void)qwOffset;
+		(void)pBuffer;
+		(void)dwSize;
+		printf("CdiCompressedDevice::WriteAt(): compressed images can't be written to!\n");
+		return false;
+	}
+
+	ULONGLONG CdiCompressedDevice::Size()
+	{
+		return this->m_sHeader.qwImageSize;
+	}
+
+	ULONGLONG CdiCompressedDevice::ModifiedTime()
+	{
+		return this->m_pFile->ModifiedTime();
+	}
+
+	void CdiCompressedDevice::GetCacheStats(CdiCompressedCacheStats *pStats)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		pStats->qwHits = this->m_qwHits;
+		pStats->qwMisses = this->m_qwMisses;
+		pStats->dwCachedHunks = (DWORD)this->m_lCache.size();
+	}
+
+	//-----------------------------------------------------
+	// CdiImageCompressor
+	//-----------------------------------------------------
+	CdiImageCompressor::CdiImageCompressor(DWORD dwThreadCount)
+	{
+		// Initialize fields.
+		this->m_dwThreadCount = dwThreadCount;
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = std::thread::hardware_concurrency();
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = 1;
+
+		this->m_qwImageSize = 0;
+		this->m_qwCompressedSize = 0;
+		this->m_qwZeroSectors = 0;
+		this->m_qwRegeneratedSectors = 0;
+	}
+
+	bool CdiImageCompressor::BuildExtents(CdiFileHandle *pCdiFile, ULONGLONG qwImageSize)
+	{
+		// Split the image into extents.
+		if (BuildImageExtents(pCdiFile, qwImageSize, &this->m_vExtents) == false)
+			return false;
+
+		// Number the hunks of each extent.
+		ULONGLONG qwHunkCount = 0;
+		for (size_t i = 0; i < this->m_vExtents.size(); i++)
+		{
+			ULONGLONG qwHunkSize = (ULONGLONG)this->m_vExtents[i].dwUnitSize * CDI_COMPRESSED_HUNK_SECTORS;
+			this->m_vExtents[i].dwFirstHunk = (DWORD)qwHunkCount;
+			qwHunkCount += (this->m_vExtents[i].qwSize + qwHunkSize - 1) / qwHunkSize;
+		}
+
+		if (qwHunkCount > 0xFFFFFFFF)
+		{
+			printf("CdiImageCompressor::BuildExtents(): image is too large!\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	void CdiImageCompressor::CompressHunk(HunkJob *pJob)
+	{
+		// Build the payload of the hunk.
+		std::vector<BYTE> vPayload;
+		DWORD dwPosition = EncodeSectorRun(pJob->pExtent, pJob->dwUnitIndex, pJob->pbInput, pJob->dwInputSize, &vPayload,
+			&pJob->dwZeroSectors, &pJob->dwRegeneratedSectors);
+
+		memset(&pJob->sHunk, 0, sizeof(pJob->sHunk));
+		pJob->vOutput.clear();
+
+		// Hunks that are all zeros aren't stored.
+		if (pJob->dwZeroSectors == HunkUnitCount(pJob->dwInputSize, pJob->pExtent->dwUnitSize))
+		{
+			pJob->sHunk.bType = CdiHunkType::HunkZero;
+			return;
+		}
+
+		// Compress the payload, if it doesn't get any smaller store it as is.
+		pJob->sHunk.dwPayloadSize = dwPosition;
+		pJob->vOutput.resize(dwPosition);
+		DWORD dwCompressedSize = IO::LzCompress(vPayload.data(), dwPosition, pJob->vOutput.data(), dwPosition - 1);
+		if (dwCompressedSize != 0)
+		{
+			pJob->sHunk.bType = CdiHunkType::HunkLz;
+			pJob->vOutput.resize(dwCompressedSize);
+		}
+		else
+		{
+			pJob->sHunk.bType = CdiHunkType::HunkStored;
+			memcpy(pJob->vOutput.data(), vPayload.data(), dwPosition);
+		}
+		pJob->sHunk.dwSize = (DWORD)pJob->vOutput.size();
+	}
+
+	void CdiImageCompressor::CompressHunks(HunkJob *psJobs, DWORD dwJobCount)
+	{
+		for (DWORD i = 0; i < dwJobCount; i++)
+			CompressHunk(&psJobs[i]);
+	}
+
+	bool CdiImageCompressor::Compress(CString sImageFile, CString sOutputFile)
+	{
+		IO::BlockDevice *pImageFile = nullptr;
+		IO::BlockDevice *pOutputFile = nullptr;
+		CdiFileHandle sCdiFile;
+		CdiCompressedHeader sHeader = { };
+		std::vector<CdiCompressedHunk> vHunks;
+		std::vector<HunkJob> vJobs;
+		std::vector<BYTE> vInput;
+		std::vector<BYTE> vIndex;
+		ULONGLONG qwOutputOffset = sizeof(CdiCompressedHeader);
+		DWORD dwBatchHunks = this->m_dwThreadCount * CDI_COMPRESSOR_HUNKS_PER_THREAD;
+		bool bResult = false;
+
+		this->m_qwImageSize = 0;
+		this->m_qwCompressedSize = 0;
+		this->m_qwZeroSectors = 0;
+		this->m_qwRegeneratedSectors = 0;
+
+		// Open the image for reading the raw data.
+		pImageFile = IO::OpenFileDevice(sImageFile, IO::BlockDeviceAccess::ReadOnly);
+		if (pImageFile == nullptr)
+		{
+			printf("CdiImageCompressor::Compress(): could not open image %s!\n", sImageFile);
+			return false;
+		}
+
+		if (CdiCompressedDevice::IsCompressedImage(pImageFile) == true)
+		{
+			printf("CdiImageCompressor::Compress(): image %s is already compressed!\n", sImageFile);
+			goto Cleanup;
+		}
+		this->m_qwImageSize = pImageFile->Size();
+
+		// Parse the image to find where the tracks are and split it into extents.
+		if (sCdiFile.Open(sImageFile, false, false) == false || BuildExtents(&sCdiFile, this->m_qwImageSize) == false)
+			goto Cleanup;
+		sCdiFile.Close();
+
+		// Create the container, the header is written once the index is.
+		pOutputFile = IO::OpenFileDevice(sOutputFile, IO::BlockDeviceAccess::CreateAlways);
+		if (pOutputFile == nullptr)
+		{
+			printf("CdiImageCompressor::Compress(): failed to create %s!\n", sOutputFile);
+			goto Cleanup;
+		}
+		if (pOutputFile->WriteAt(0, &sHeader, sizeof(sHeader)) == false)
+			goto Cleanup;
+
+		// Compress the hunks a batch at a time: read the batch, compress its hunks in parallel and write them out in order.
+		pImageFile->Advise(0, this->m_qwImageSize, IO::BlockDeviceAccessHint::Sequential);
+		vJobs.resize(dwBatchHunks);
+		vInput.resize((SIZE_T)dwBatchHunks * CDI_COMPRESSED_MAX_HUNK_SIZE);
+		for (size_t i = 0, dwUnitIndex = 0; i < this->m_vExtents.size(); )
+		{
+			// Fill the batch with the next hunks in the image, hunks are contiguous so they are read in one go.
+			ULONGLONG qwBatchOffset = this->m_vExtents[i].qwOffset + (ULONGLONG)dwUnitIndex * this->m_vExtents[i].dwUnitSize;
+			DWORD dwBatchSize = 0;
+			DWORD dwJobCount = 0;
+			while (dwJobCount < dwBatchHunks && i < this->m_vExtents.size())
+			{
+				const CdiCompressedExtent *pExtent = &this->m_vExtents[i];
+				ULONGLONG qwHunkOffset = (ULONGLONG)dwUnitIndex * pExtent->dwUnitSize;
+				ULONGLONG qwHunkSize = (ULONGLONG)pExtent->dwUnitSize * CDI_COMPRESSED_HUNK_SECTORS;
+
+				HunkJob *pJob = &vJobs[dwJobCount++];
+				pJob->pExtent = pExtent;
+				pJob->dwUnitIndex = (DWORD)dwUnitIndex;
+				pJob->dwInputSize = (DWORD)(pExtent->qwSize - qwHunkOffset < qwHunkSize ? pExtent->qwSize - qwHunkOffset : qwHunkSize);
+				pJob->pbInput = &vInput[dwBatchSize];
+				dwBatchSize += pJob->dwInputSize;
+
+				// Move to the next hunk, and the next extent at the end of this one.
+				dwUnitIndex += CDI_COMPRESSED_HUNK_SECTORS;
+				if ((ULONGLONG)dwUnitIndex * pExtent->dwUnitSize >= pExtent->qwSize)
+				{
+					i++;
+					dwUnitIndex = 0;
+				}
+			}
+
+			if (pImageFile->ReadAt(qwBatchOffset, vInput.data(), dwBatchSize) == false)
+			{
+				printf("CdiImageCompressor::Compress(): failed to read image %s!\n", sImageFile);
+				goto Cleanup;
+			}
+
+			// Split the hunks across the worker threads, this thread takes the first run.
+			DWORD dwThreadCount = (dwJobCount < this->m_dwThreadCount ? dwJobCount : this->m_dwThreadCount);
+			DWORD dwJobsPerThread = (dwJobCount + dwThreadCount - 1) / dwThreadCount;
+			std::vector<std::thread> vWorkers;
+			for (DWORD dwFirst = dwJobsPerThread; dwFirst < dwJobCount; dwFirst += dwJobsPerThread)
+			{
+				DWORD dwCount = (dwJobCount - dwFirst < dwJobsPerThread ? dwJobCount - dwFirst : dwJobsPerThread);
+				vWorkers.push_back(std::thread(&CdiImageCompressor::CompressHunks, this, &vJobs[dwFirst], dwCount));
+			}
+
+			CompressHunks(vJobs.data(), (dwJobsPerThread < dwJobCount ? dwJobsPerThread : dwJobCount));
+			for (size_t x = 0; x < vWorkers.size(); x++)
+				vWorkers[x].join();
+
+			// Write the hunks out in order.
+			for (DWORD x = 0; x < dwJobCount; x++)
+			{
+				HunkJob *pJob = &vJobs[x];
+				if (pJob->sHunk.bType != CdiHunkType::HunkZero)
+				{
+					pJob->sHunk.qwOffset = qwOutputOffset;
+					if (pOutputFile->WriteAt(qwOutputOffset, pJob->vOutput.data(), pJob->sHunk.dwSize) == false)
+					{
+						printf("CdiImageCompressor::Compress(): failed to write to %s!\n", sOutputFile);
+						goto Cleanup;
+					}
+					qwOutputOffset += pJob->sHunk.dwSize;
+				}
+
+				vHunks.push_back(pJob->sHunk);
+				this->m_qwZeroSectors += pJob->dwZeroSectors;
+				this->m_qwRegeneratedSectors += pJob->dwRegeneratedSectors;
+			}
+		}
+
+		// Write the index at the tail of the container.
+		vIndex.resize((this->m_vExtents.size() * sizeof(CdiCompressedExtent)) + (vHunks.size() * sizeof(CdiCompressedHunk)));
+		memcpy(vIndex.data(), this->m_vExtents.data(), this->m_vExtents.size() * sizeof(CdiCompressedExtent));
+		memcpy(&vIndex[this->m_vExtents.size() * sizeof(CdiCompressedExtent)], vHunks.data(), vHunks.size() * sizeof(CdiCompressedHunk));
+		if (pOutputFile->WriteAt(qwOutputOffset, vIndex.data(), (DWORD)vIndex.size()) == false)
+		{
+			printf("CdiImageCompressor::Compress(): failed to write to %s!\n", sOutputFile);
+			goto Cleanup;
+		}
+
+		// Write the header now the index is in place.
+		sHeader.dwMagic = CDI_COMPRESSED_MAGIC;
+		sHeader.dwVersion = CDI_COMPRESSED_VERSION;
+		sHeader.qwImageSize = this->m_qwImageSize;
+		sHeader.qwIndexOffset = qwOutputOffset;
+		sHeader.dwExtentCount = (DWORD)this->m_vExtents.size();
+		sHeader.dwHunkCount = (DWORD)vHunks.size();
+		sHeader.dwHunkSectors = CDI_COMPRESSED_HUNK_SECTORS;
+		sHeader.dwIndexHash = ComputeEdc(0, vIndex.data(), (DWORD)vIndex.size());
+		if (pOutputFile->WriteAt(0, &sHeader, sizeof(sHeader)) == false || pOutputFile->Flush() == false)
+		{
+			printf("CdiImageCompressor::Compress(): failed to write to %s!\n", sOutputFile);
+			goto Cleanup;
+		}
+
+		this->m_qwCompressedSize = qwOutputOffset + vIndex.size();
+		bResult = true;
+
+	Cleanup:
+		// Close the files.
+		if (pImageFile != nullptr)
+			delete pImageFile;
+		if (pOutputFile != nullptr)
+			delete pOutputFile;
+
+		return bResult;
+	}
+
+	ULONGLONG CdiImageCompressor::ImageSize()
+	{
+		return this->m_qwImageSize;
+	}
+
+	ULONGLONG CdiImageCompressor::CompressedSize()
+	{
+		return this->m_qwCompressedSize;
+	}
+
+	ULONGLONG CdiImageCompressor::ZeroSectors()
+	{
+		return this->m_qwZeroSectors;
+	}
+
+	ULONGLONG CdiImageCompressor::RegeneratedSectors()
+	{
+		return this->m_qwRegeneratedSectors;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,331 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiCompressedImage.h - Seekable compressed container for cdi images, split
+		into independently compressed hunks with an index at the tail.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "../IO/BlockDevice.h"
+#include "CdiFileHandle.h"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace DiskJuggler
+{
+	// Extension of compressed images.
+	#define CDI_COMPRESSED_EXTENSION			".cdz"
+
+	// 'CDZI', and the version of the container layout.
+	#define CDI_COMPRESSED_MAGIC				0x495A4443
+	#define CDI_COMPRESSED_VERSION				1
+
+	// Number of sectors in each hunk. Hunks are the unit of compression and of random access, a read only ever
+	// has to decompress the hunks it touches.
+	#define CDI_COMPRESSED_HUNK_SECTORS			16
+
+	// Size of the units data outside of any track (ie: the session descriptor) is split into.
+	#define CDI_COMPRESSED_RAW_UNIT_SIZE		2048
+
+	// Largest hunk, and largest payload of a hunk: one sector type byte per sector followed by the sector data.
+	#define CDI_COMPRESSED_MAX_HUNK_SIZE		(CDI_COMPRESSED_HUNK_SECTORS * CdiSectorSize::Size_2448)
+	#define CDI_COMPRESSED_MAX_PAYLOAD_SIZE		(CDI_COMPRESSED_HUNK_SECTORS + CDI_COMPRESSED_MAX_HUNK_SIZE)
+
+	// Default number of decompressed hunks kept in memory by CdiCompressedDevice.
+	#define CDI_COMPRESSED_DEFAULT_CACHE_HUNKS	64
+
+	// Number of hunks each thread compresses per batch.
+	#define CDI_COMPRESSOR_HUNKS_PER_THREAD		16
+
+	// Mode stored for extents that don't belong to a track.
+	#define CDI_COMPRESSED_NO_TRACK				0xFF
+
+	/*
+		How a hunk is stored in the container.
+	*/
+	enum CdiHunkType : BYTE
+	{
+		HunkZero,				// Every byte of the hunk is zero, nothing is stored
+		HunkStored,				// Payload is stored uncompressed
+		HunkLz					// Payload is compressed with LzCompress()
+	};
+
+	/*
+		How each sector of a hunk is stored in the hunk payload.
+	*/
+	enum CdiHunkSectorType : BYTE
+	{
+		SectorStored,			// Whole sector is stored
+		SectorZero,				// Every byte of the sector is zero, nothing is stored
+		SectorRegenerated		// Only the subheader, user data and subchannel are stored, the sync pattern, header
+								// and EDC/ECC are rebuilt with RegenerateSectors()
+	};
+
+#pragma pack(push, 1)
+	struct CdiCompressedHeader
+	{
+		/* 0x00 */ DWORD dwMagic;				// CDI_COMPRESSED_MAGIC
+		/* 0x04 */ DWORD dwVersion;				// CDI_COMPRESSED_VERSION
+		/* 0x08 */ ULONGLONG qwImageSize;		// Size of the uncompressed image
+		/* 0x10 */ ULONGLONG qwIndexOffset;		// File offset of the extent table, followed by the hunk table
+		/* 0x18 */ DWORD dwExtentCount;			// Number of entries in the extent table
+		/* 0x1C */ DWORD dwHunkCount;			// Number of entries in the hunk table
+		/* 0x20 */ DWORD dwHunkSectors;			// CDI_COMPRESSED_HUNK_SECTORS
+		/* 0x24 */ DWORD dwIndexHash;			// EDC of the extent and hunk tables
+	};
+
+	/*
+		Run of the image split into hunks of CDI_COMPRESSED_HUNK_SECTORS units each. Extents cover the whole
+		image in order, each track is its own extent so hunks never straddle tracks.
+	*/
+	struct CdiCompressedExtent
+	{
+		/* 0x00 */ ULONGLONG qwOffset;			// Offset of the extent in the image
+		/* 0x08 */ ULONGLONG qwSize;			// Size of the extent in bytes
+		/* 0x10 */ DWORD dwUnitSize;			// Sector size of the track, CDI_COMPRESSED_RAW_UNIT_SIZE outside of tracks
+		/* 0x14 */ DWORD dwFirstHunk;			// Index of the first hunk of the extent
+		/* 0x18 */ DWORD dwFirstLBA;			// LBA of the first sector, including the pregap
+		/* 0x1C */ BYTE bMode;					// CdiTrackMode of the track or CDI_COMPRESSED_NO_TRACK
+		/* 0x1D */ BYTE bReserved[3];
+	};
+
+	struct CdiCompressedHunk
+	{
+		/* 0x00 */ ULONGLONG qwOffset;			// File offset of the hunk data
+		/* 0x08 */ DWORD dwSize;				// Size of the hunk data in the file
+		/* 0x0C */ DWORD dwPayloadSize;			// Size of the hunk payload once decompressed
+		/* 0x10 */ BYTE bType;					// CdiHunkType
+	};
+#pragma pack(pop)
+
+	struct CdiCompressedCacheStats
+	{
+		ULONGLONG qwHits;				// Number of hunk lookups that were found in the cache
+		ULONGLONG qwMisses;				// Number of hunks that had to be decompressed
+		DWORD dwCachedHunks;			// Number of hunks currently cached
+	};
+
+	/*
+		Description: Splits an image into extents, one for each track and one for each run of data between tracks.
+			The first hunk of each extent is left as 0.
+
+		Parameters:
+			pCdiFile: Image to split.
+			qwImageSize: Size of the image.
+			pvExtents: Receives the extents, in image order.
+
+		Returns: True if the tracks could be laid out, false if they overlap or run past the end of the image.
+	*/
+	bool BuildImageExtents(CdiFileHandle *pCdiFile, ULONGLONG qwImageSize, std::vector<CdiCompressedExtent> *pvExtents);
+
+	/*
+		Description: Builds the payload of a run of sectors: one CdiHunkSectorType per sector followed by the data
+			that has to be stored for each of them. Data sectors that are regenerated only keep data that doesn't
+			depend on their LBA, so identical runs give identical payloads wherever they are in the image.
+
+		Parameters:
+			pExtent: Extent the sectors belong to.
+			dwUnitIndex: Index of the first sector in the extent.
+			pbInput: Sectors to encode.
+			dwInputSize: Size of the sectors, the last one may be partial.
+			pvPayload: Receives the payload.
+			pdwZeroSectors: Receives the number of sectors that were dropped for being all zeros.
+			pdwRegeneratedSectors: Receives the number of sectors that only kept their user data.
+
+		Returns: The size of the payload.
+	*/
+	DWORD EncodeSectorRun(const CdiCompressedExtent *pExtent, DWORD dwUnitIndex, const BYTE *pbInput, DWORD dwInputSize,
+		std::vector<BYTE> *pvPayload, DWORD *pdwZeroSectors, DWORD *pdwRegeneratedSectors);
+
+	/*
+		Description: Rebuilds a run of sectors from a payload built by EncodeSectorRun().
+
+		Parameters:
+			pExtent: Extent the sectors belong to.
+			dwUnitIndex: Index of the first sector in the extent.
+			pbPayload: Payload of the run.
+			dwPayloadSize: Size of the payload.
+			pbOutput: Buffer that receives the sectors.
+			dwOutputSize: Size of the sectors.
+
+		Returns: True if the sectors were rebuilt, false if the payload is corrupt.
+	*/
+	bool DecodeSectorRun(const CdiCompressedExtent *pExtent, DWORD dwUnitIndex, const BYTE *pbPayload, DWORD dwPayloadSize,
+		PBYTE pbOutput, DWORD dwOutputSize);
+
+	//-----------------------------------------------------
+	// CdiCompressedDevice
+	//-----------------------------------------------------
+	/*
+		Read only block device presenting the uncompressed image stored in a compressed container. Hunks are
+		decompressed on demand and the most recently used ones are cached, the device can be read from multiple
+		threads at once.
+	*/
+	class CdiCompressedDevice : public IO::BlockDevice
+	{
+	protected:
+		struct CachedHunk
+		{
+			DWORD dwHunk;					// Index of the hunk
+			std::vector<BYTE> vData;		// Decompressed hunk
+		};
+
+		IO::BlockDevice				*m_pFile;			// Container file
+		CdiCompressedHeader			m_sHeader;			// Container header
+		std::vector<CdiCompressedExtent>	m_vExtents;	// Extent table
+		std::vector<CdiCompressedHunk>		m_vHunks;	// Hunk table
+
+		// Decompressed hunk cache.
+		std::list<CachedHunk>		m_lCache;			// Cached hunks, most recently used first
+		std::unordered_map<DWORD, std::list<CachedHunk>::iterator>	m_mCacheMap;	// Lookup from hunk index to entry
+		std::mutex					m_Lock;				// Protects the cache
+		DWORD						m_dwCacheHunks;		// Maximum number of hunks to cache
+		ULONGLONG					m_qwHits;
+		ULONGLONG					m_qwMisses;
+
+		/*
+			Description: Finds the extent containing an offset in the image.
+		*/
+		const CdiCompressedExtent *FindExtent(ULONGLONG qwOffset);
+
+		/*
+			Description: Reads and decompresses a hunk.
+
+			Parameters:
+				dwHunk: Index of the hunk.
+				pExtent: Extent the hunk belongs to.
+				pvOutput: Receives the decompressed hunk.
+
+			Returns: True if the hunk was decompressed, false if it could not be read or is corrupt.
+		*/
+		bool DecodeHunk(DWORD dwHunk, const CdiCompressedExtent *pExtent, std::vector<BYTE> *pvOutput);
+
+		/*
+			Description: Checks the extent and hunk tables describe a valid container.
+		*/
+		bool ValidateIndex();
+
+	public:
+		/*
+			Parameters:
+				dwCacheHunks: Number of decompressed hunks to keep in memory.
+		*/
+		CdiCompressedDevice(DWORD dwCacheHunks = CDI_COMPRESSED_DEFAULT_CACHE_HUNKS);
+		~CdiCompressedDevice();
+
+		/*
+			Description: Checks if a device starts with the compressed container magic.
+		*/
+		static bool IsCompressedImage(IO::BlockDevice *pDevice);
+
+		/*
+			Description: Reads the header and index of a compressed container.
+
+			Parameters:
+				pFile: Container file, the device takes ownership of it if it was opened.
+
+			Returns: True if the container was opened, false otherwise.
+		*/
+		bool Open(IO::BlockDevice *pFile);
+
+		bool ReadAt(ULONGLONG qwOffset, PVOID pBuffer, DWORD dwSize);
+		bool WriteAt(ULONGLONG qwOffset, const void *pBuffer, DWORD dwSize);
+		ULONGLONG Size();
+		ULONGLONG ModifiedTime();
+
+		/*
+			Description: Gets the statistics of the decompressed hunk cache.
+		*/
+		void GetCacheStats(CdiCompressedCacheStats *pStats);
+	};
+
+	//-----------------------------------------------------
+	// CdiImageCompressor
+	//-----------------------------------------------------
+	/*
+		Writes a cdi image to a compressed container. Every track is split into hunks that are compressed in
+		parallel, sectors that are all zeros are dropped and data sectors whose sync pattern, header and EDC/ECC
+		can be rebuilt exactly only keep their user data.
+	*/
+	class CdiImageCompressor
+	{
+	protected:
+		/*
+			Hunk being compressed.
+		*/
+		struct HunkJob
+		{
+			const CdiCompressedExtent *pExtent;	// Extent the hunk belongs to
+			DWORD dwUnitIndex;					// Index of the first unit of the hunk in the extent
+			const BYTE *pbInput;				// Uncompressed hunk
+			DWORD dwInputSize;					// Size of the uncompressed hunk
+			std::vector<BYTE> vOutput;			// Hunk data to write to the container
+			CdiCompressedHunk sHunk;			// Hunk table entry, the offset is filled in when written
+			DWORD dwZeroSectors;				// Number of sectors that were dropped
+			DWORD dwRegeneratedSectors;			// Number of sectors that only kept their user data
+		};
+
+		DWORD		m_dwThreadCount;		// Number of threads used to compress hunks
+		std::vector<CdiCompressedExtent>	m_vExtents;		// Extents of the image being compressed
+
+		// Statistics.
+		ULONGLONG	m_qwImageSize;
+		ULONGLONG	m_qwCompressedSize;
+		ULONGLONG	m_qwZeroSectors;
+		ULONGLONG	m_qwRegeneratedSectors;
+
+		/*
+			Description: Splits the image into extents and numbers their hunks.
+
+			Returns: True if the image could be split, false otherwise.
+		*/
+		bool BuildExtents(CdiFileHandle *pCdiFile, ULONGLONG qwImageSize);
+
+		/*
+			Description: Builds and compresses the payload of a hunk.
+		*/
+		void CompressHunk(HunkJob *pJob);
+
+		/*
+			Description: Compresses a run of hunks, run on each of the worker threads.
+		*/
+		void CompressHunks(HunkJob *psJobs, DWORD dwJobCount);
+
+	public:
+		/*
+			Parameters:
+				dwThreadCount: Number of threads used to compress hunks, 0 uses one per processor.
+		*/
+		CdiImageCompressor(DWORD dwThreadCount = 0);
+
+		/*
+			Description: Compresses an image into a new container, replacing any existing file.
+
+			Parameters:
+				sImageFile: Image to compress.
+				sOutputFile: Container file to create.
+
+			Returns: True if the image was compressed, false otherwise.
+		*/
+		bool Compress(CString sImageFile, CString sOutputFile);
+
+		/*
+			Description: Gets the size of the image and of the container written by the last call to Compress().
+		*/
+		ULONGLONG ImageSize();
+		ULONGLONG CompressedSize();
+
+		/*
+			Description: Gets the number of sectors that were dropped for being all zeros, and the number of
+				sectors that only kept their user data, by the last call to Compress().
+		*/
+		ULONGLONG ZeroSectors();
+		ULONGLONG RegeneratedSectors();
+	};
+};
\ No newline at end of file
@@ -0,0 +1,595 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiDatFile.cpp - Reference DAT files images and tracks are checked against.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiDatFile.h"
+#include <string.h>
+
+namespace DiskJuggler
+{
+	// Size of a rom nobody has set yet.
+	#define CDI_DAT_UNKNOWN_SIZE		0xFFFFFFFFFFFFFFFFULL
+
+	/*
+		Description: Checks if a character is white space.
+	*/
+	static inline bool IsSpace(CHAR c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	/*
+		Description: Checks if a string of a given length is the same as a null terminated string.
+	*/
+	static bool MatchesString(const CHAR *psString, DWORD dwLength, LPCSTR psOther)
+	{
+		return strlen(psOther) == dwLength && memcmp(psString, psOther, dwLength) == 0;
+	}
+
+	/*
+		Description: Decodes the character references in XML text, only the ones that fit in a single byte are
+			supported.
+	*/
+	static CString DecodeXmlText(const CHAR *psText, DWORD dwLength)
+	{
+		CString sResult;
+		for (DWORD i = 0; i < dwLength; i++)
+		{
+			if (psText[i] != '&')
+			{
+				sResult += psText[i];
+				continue;
+			}
+
+			// Find the end of the reference, leave it as it is if there is none.
+			DWORD dwEnd = i + 1;
+			while (dwEnd < dwLength && dwEnd - i < 10 && psText[dwEnd] != ';')
+				dwEnd++;
+			if (dwEnd >= dwLength || psText[dwEnd] != ';')
+			{
+				sResult += psText[i];
+				continue;
+			}
+
+			const CHAR *psName = &psText[i + 1];
+			DWORD dwNameLength = dwEnd - i - 1;
+			if (MatchesString(psName, dwNameLength, "amp"))
+				sResult += '&';
+			else if (MatchesString(psName, dwNameLength, "lt"))
+				sResult += '<';
+			else if (MatchesString(psName, dwNameLength, "gt"))
+				sResult += '>';
+			else if (MatchesString(psName, dwNameLength, "quot"))
+				sResult += '"';
+			else if (MatchesString(psName, dwNameLength, "apos"))
+				sResult += '\'';
+			else if (dwNameLength > 1 && psName[0] == '#')
+			{
+				// Numeric reference, decimal or hex.
+				DWORD dwValue = (DWORD)strtoul(CString(psName + (psName[1] == 'x' ? 2 : 1), dwNameLength - (psName[1] == 'x' ? 2 : 1)),
+					nullptr, (psName[1] == 'x' ? 16 : 10));
+				sResult += (CHAR)(dwValue < 256 ? dwValue : '?');
+			}
+			else
+			{
+				sResult += psText[i];
+				continue;
+			}
+
+			i = dwEnd;
+		}
+
+		return sResult;
+	}
+
+	/*
+		Description: Reads the name and attributes of an XML tag.
+
+		Parameters:
+			psData, dwSize: XML data.
+			pdwPosition: Position of the '<' of the tag, receives the position after the tag.
+			psName: Receives the name of the tag, starting with '/' for closing tags.
+			pvAttributes: Receives the name and value of each attribute.
+	*/
+	static void ReadXmlTag(const CHAR *psData, DWORD dwSize, DWORD *pdwPosition, CString *psName, std::vector<std::pair<CString, CString>> *pvAttributes)
+	{
+		DWORD i = *pdwPosition + 1;
+		pvAttributes->clear();
+
+		// Read the tag name.
+		DWORD dwStart = i;
+		while (i < dwSize && IsSpace(psData[i]) == false && psData[i] != '>' && (psData[i] != '/' || i == dwStart))
+			i++;
+		*psName = CString(&psData[dwStart], (int)(i - dwStart));
+
+		// Read the attributes until the end of the tag.
+		while (i < dwSize && psData[i] != '>')
+		{
+			if (IsSpace(psData[i]) == true || psData[i] == '/')
+			{
+				i++;
+				continue;
+			}
+
+			// Read the attribute name and skip to the value.
+			dwStart = i;
+			while (i < dwSize && IsSpace(psData[i]) == false && psData[i] != '=' && psData[i] != '>')
+				i++;
+			CString sKey(&psData[dwStart], (int)(i - dwStart));
+			while (i < dwSize && IsSpace(psData[i]) == true)
+				i++;
+			if (i >= dwSize || psData[i] != '=')
+				continue;
+			i++;
+			while (i < dwSize && IsSpace(psData[i]) == true)
+				i++;
+			if (i >= dwSize || (psData[i] != '"' && psData[i] != '\''))
+				continue;
+
+			// Read the quoted value.
+			CHAR cQuote = psData[i++];
+			dwStart = i;
+			while (i < dwSize && psData[i] != cQuote)
+				i++;
+			pvAttributes->push_back(std::make_pair(sKey, DecodeXmlText(&psData[dwStart], i - dwStart)));
+			if (i < dwSize)
+				i++;
+		}
+
+		*pdwPosition = (i < dwSize ? i + 1 : dwSize);
+	}
+
+	/*
+		Description: Reads the next token of a clrmamepro DAT, a parenthesis, a quoted string or a word.
+
+		Parameters:
+			psData, dwSize: DAT data.
+			pdwPosition: Position to read from, receives the position after the token.
+			psToken: Receives the token, without the quotes.
+			pbQuoted: Receives a boolean indicating if the token was quoted.
+
+		Returns: True if a token was read, false at the end of the data.
+	*/
+	static bool ReadClrMameProToken(const CHAR *psData, DWORD dwSize, DWORD *pdwPosition, CString *psToken, bool *pbQuoted)
+	{
+		DWORD i = *pdwPosition;
+		while (i < dwSize && IsSpace(psData[i]) == true)
+			i++;
+		if (i >= dwSize)
+		{
+			*pdwPosition = dwSize;
+			return false;
+		}
+
+		DWORD dwStart = i;
+		*pbQuoted = (psData[i] == '"');
+		if (*pbQuoted == true)
+		{
+			// Quoted string, runs to the closing quote.
+			dwStart = ++i;
+			while (i < dwSize && psData[i] != '"')
+				i++;
+			*psToken = CString(&psData[dwStart], (int)(i - dwStart));
+			*pdwPosition = (i < dwSize ? i + 1 : dwSize);
+			return true;
+		}
+
+		// Parentheses are tokens on their own, anything else runs to the next space or parenthesis.
+		if (psData[i] == '(' || psData[i] == ')')
+			i++;
+		else
+		{
+			while (i < dwSize && IsSpace(psData[i]) == false && psData[i] != '(' && psData[i] != ')')
+				i++;
+		}
+
+		*psToken = CString(&psData[dwStart], (int)(i - dwStart));
+		*pdwPosition = i;
+		return true;
+	}
+
+	/*
+		Description: Builds the index key of a digest from its first 8 bytes.
+	*/
+	static inline ULONGLONG DigestKey(const BYTE *pbDigest)
+	{
+		ULONGLONG qwKey;
+		memcpy(&qwKey, pbDigest, sizeof(qwKey));
+		return qwKey;
+	}
+
+	/*
+		Description: Builds the index key of a CRC32 and size.
+	*/
+	static inline ULONGLONG CrcKey(DWORD dwCrc32, ULONGLONG qwSize)
+	{
+		return ((ULONGLONG)dwCrc32 << 32) ^ qwSize;
+	}
+
+	CdiDatFile::CdiDatFile()
+	{
+		// Initialize fields.
+		this->m_dwSkippedRoms = 0;
+	}
+
+	bool CdiDatFile::Load(CString sFileName)
+	{
+		IO::BlockDevice *pDatFile = nullptr;
+		std::vector<CHAR> vData;
+		ULONGLONG qwFileSize = 0;
+		DWORD dwStart = 0;
+
+		// Read the whole file into memory.
+		pDatFile = IO::OpenFileDevice(sFileName, IO::BlockDeviceAccess::ReadOnly);
+		if (pDatFile == nullptr)
+		{
+			printf("CdiDatFile::Load(): could not open DAT file %s!\n", sFileName);
+			return false;
+		}
+
+		qwFileSize = pDatFile->Size();
+		if (qwFileSize > CDI_DAT_MAX_FILE_SIZE)
+		{
+			printf("CdiDatFile::Load(): DAT file %s is too large!\n", sFileName);
+			delete pDatFile;
+			return false;
+		}
+
+		vData.resize((size_t)qwFileSize + 1);
+		if (qwFileSize > 0 && pDatFile->ReadAt(0, vData.data(), (DWORD)qwFileSize) == false)
+		{
+			printf("CdiDatFile::Load(): failed to read DAT file %s!\n", sFileName);
+			delete pDatFile;
+			return false;
+		}
+		delete pDatFile;
+
+		// XML DATs start with a tag, anything else is parsed as a clrmamepro DAT.
+		while (dwStart < qwFileSize && (IsSpace(vData[dwStart]) == true || (BYTE)vData[dwStart] >= 0x80))
+			dwStart++;
+		if (dwStart < qwFileSize && vData[dwStart] == '<')
+			ParseXml(vData.data(), (DWORD)qwFileSize);
+		else
+			ParseClrMamePro(vData.data(), (DWORD)qwFileSize);
+
+		if (this->m_vRoms.size() == 0)
+		{
+			printf("CdiDatFile::Load(): no roms found in DAT file %s!\n", sFileName);
+			return false;
+		}
+
+		return true;
+	}
+
+	void CdiDatFile::ParseXml(const CHAR *psData, DWORD dwSize)
+	{
+		std::vector<std::pair<CString, CString>> vAttributes;
+		CString sTagName;
+		CString sGameName;
+
+		for (DWORD i = 0; i < dwSize; )
+		{
+			if (psData[i] != '<')
+			{
+				i++;
+				continue;
+			}
+
+			// Skip over comments, they can contain anything.
+			if (dwSize - i >= 4 && memcmp(&psData[i], "<!--", 4) == 0)
+			{
+				const CHAR *psEnd = nullptr;
+				for (DWORD x = i + 4; x + 3 <= dwSize && psEnd == nullptr; x++)
+				{
+					if (memcmp(&psData[x], "-->", 3) == 0)
+						psEnd = &psData[x];
+				}
+				i = (psEnd != nullptr ? (DWORD)(psEnd - psData) + 3 : dwSize);
+				continue;
+			}
+
+			ReadXmlTag(psData, dwSize, &i, &sTagName, &vAttributes);
+
+			// Keep track of the game we are in.
+			if (sTagName == "game" || sTagName == "machine")
+			{
+				sGameName = "";
+				for (size_t x = 0; x < vAttributes.size(); x++)
+				{
+					if (vAttributes[x].first == "name")
+						sGameName = vAttributes[x].second;
+				}
+			}
+			else if (sTagName == "/game" || sTagName == "/machine")
+				sGameName = "";
+
+			// Add each rom.
+			else if (sTagName == "rom")
+			{
+				CdiDatRom sRom;
+				sRom.sGameName = sGameName;
+				sRom.sDigests = { };
+				sRom.sDigests.qwSize = CDI_DAT_UNKNOWN_SIZE;
+				for (size_t x = 0; x < vAttributes.size(); x++)
+					SetRomField(&sRom, vAttributes[x].first, vAttributes[x].second);
+
+				AddRom(&sRom);
+			}
+		}
+	}
+
+	void CdiDatFile::ParseClrMamePro(const CHAR *psData, DWORD dwSize)
+	{
+		CString sToken, sValue;
+		CString sGameName;
+		bool bQuoted = false, bValueQuoted = false;
+		bool bGame = false;
+		DWORD dwPosition = 0;
+
+		while (ReadClrMameProToken(psData, dwSize, &dwPosition, &sToken, &bQuoted) == true)
+		{
+			// Top level blocks, only game blocks hold roms.
+			if (bGame == false)
+			{
+				if (bQuoted == false && (sToken == "game" || sToken == "machine" || sToken == "resource"))
+				{
+					DWORD dwNext = dwPosition;
+					if (ReadClrMameProToken(psData, dwSize, &dwNext, &sValue, &bValueQuoted) == true && bValueQuoted == false && sValue == "(")
+					{
+						dwPosition = dwNext;
+						bGame = true;
+						sGameName = "";
+					}
+				}
+				continue;
+			}
+
+			// End of the game block.
+			if (bQuoted == false && sToken == ")")
+			{
+				bGame = false;
+				continue;
+			}
+
+			// Everything inside of a game block is a key followed by a value or a block.
+			if (ReadClrMameProToken(psData, dwSize, &dwPosition, &sValue, &bValueQuoted) == false)
+				break;
+
+			if (bValueQuoted == true || sValue != "(")
+			{
+				if (sToken == "name")
+					sGameName = sValue;
+				continue;
+			}
+
+			// Read the key and value pairs of a rom, skip any other block.
+			CdiDatRom sRom;
+			sRom.sGameName = sGameName;
+			sRom.sDigests = { };
+			sRom.sDigests.qwSize = CDI_DAT_UNKNOWN_SIZE;
+			bool bRom = (sToken == "rom");
+			DWORD dwDepth = 1;
+			while (dwDepth > 0 && ReadClrMameProToken(psData, dwSize, &dwPosition, &sToken, &bQuoted) == true)
+			{
+				if (bQuoted == false && sToken == "(")
+					dwDepth++;
+				else if (bQuoted == false && sToken == ")")
+					dwDepth--;
+				else if (dwDepth == 1 && bRom == true && ReadClrMameProToken(psData, dwSize, &dwPosition, &sValue, &bValueQuoted) == true)
+				{
+					if (bValueQuoted == false && sValue == ")")
+						dwDepth--;
+					else
+						SetRomField(&sRom, sToken, sValue);
+				}
+			}
+
+			if (bRom == true)
+				AddRom(&sRom);
+		}
+	}
+
+	void CdiDatFile::SetRomField(CdiDatRom *pRom, const CString &sKey, const CString &sValue)
+	{
+		if (sKey == "name")
+			pRom->sName = sValue;
+		else if (sKey == "size")
+		{
+			// Sizes are decimal.
+			ULONGLONG qwSize = 0;
+			for (int i = 0; i < sValue.GetLength(); i++)
+			{
+				if (sValue[i] < '0' || sValue[i] > '9' || qwSize > (CDI_DAT_UNKNOWN_SIZE - 9) / 10)
+					return;
+				qwSize = (qwSize * 10) + (sValue[i] - '0');
+			}
+			if (sValue.GetLength() > 0)
+				pRom->sDigests.qwSize = qwSize;
+		}
+		else if (sKey.CompareNoCase("crc") == 0)
+		{
+			// The CRC32 is written as a big endian hex value.
+			BYTE bCrc[4];
+			if (IO::ParseDigest(sValue, sValue.GetLength(), bCrc, sizeof(bCrc)) == true)
+			{
+				pRom->sDigests.dwCrc32 = ((DWORD)bCrc[0] << 24) | ((DWORD)bCrc[1] << 16) | ((DWORD)bCrc[2] << 8) | bCrc[3];
+				pRom->sDigests.dwTypes |= IO::DigestType::DigestCrc32;
+			}
+		}
+		else if (sKey.CompareNoCase("md5") == 0)
+		{
+			if (IO::ParseDigest(sValue, sValue.GetLength(), pRom->sDigests.bMd5, MD5_DIGEST_SIZE) == true)
+				pRom->sDigests.dwTypes |= IO::DigestType::DigestMd5;
+		}
+		else if (sKey.CompareNoCase("sha1") == 0)
+		{
+			if (IO::ParseDigest(sValue, sValue.GetLength(), pRom->sDigests.bSha1, SHA1_DIGEST_SIZE) == true)
+				pRom->sDigests.dwTypes |= IO::DigestType::DigestSha1;
+		}
+	}
+
+	void CdiDatFile::AddRom(CdiDatRom *pRom)
+	{
+		// Roms without a size or any digest can't be matched.
+		if (pRom->sDigests.qwSize == CDI_DAT_UNKNOWN_SIZE || pRom->sDigests.dwTypes == IO::DigestType::DigestNone)
+		{
+			this->m_dwSkippedRoms++;
+			return;
+		}
+
+		// Index the rom by every digest it has.
+		DWORD dwIndex = (DWORD)this->m_vRoms.size();
+		if ((pRom->sDigests.dwTypes & IO::DigestType::DigestSha1) != 0)
+			this->m_mSha1Index.insert(std::make_pair(DigestKey(pRom->sDigests.bSha1), dwIndex));
+		if ((pRom->sDigests.dwTypes & IO::DigestType::DigestMd5) != 0)
+			this->m_mMd5Index.insert(std::make_pair(DigestKey(pRom->sDigests.bMd5), dwIndex));
+		if ((pRom->sDigests.dwTypes & IO::DigestType::DigestCrc32) != 0)
+			this->m_mCrcIndex.insert(std::make_pair(CrcKey(pRom->sDigests.dwCrc32, pRom->sDigests.qwSize), dwIndex));
+
+		this->m_vRoms.push_back(*pRom);
+	}
+
+	DWORD CdiDatFile::RomCount()
+	{
+		return (DWORD)this->m_vRoms.size();
+	}
+
+	DWORD CdiDatFile::SkippedRomCount()
+	{
+		return this->m_dwSkippedRoms;
+	}
+
+	bool CdiDatFile::MatchRom(const CdiDatRom *pRom, const IO::DigestSet *pDigests)
+	{
+		// The size and every digest the DAT has for the rom have to match.
+		const IO::DigestSet *pRomDigests = &pRom->sDigests;
+		if (pRomDigests->qwSize != pDigests->qwSize)
+			return false;
+		if ((pRomDigests->dwTypes & IO::DigestType::DigestCrc32) != 0 && pRomDigests->dwCrc32 != pDigests->dwCrc32)
+			return false;
+		if ((pRomDigests->dwTypes & IO::DigestType::DigestMd5) != 0 && memcmp(pRomDigests->bMd5, pDigests->bMd5, MD5_DIGEST_SIZE) != 0)
+			return false;
+		if ((pRomDigests->dwTypes & IO::DigestType::DigestSha1) != 0 && memcmp(pRomDigests->bSha1, pDigests->bSha1, SHA1_DIGEST_SIZE) != 0)
+			return false;
+
+		return true;
+	}
+
+	void CdiDatFile::FindInIndex(const std::unordered_multimap<ULONGLONG, DWORD> &mIndex, ULONGLONG qwKey, const IO::DigestSet *pDigests,
+		DWORD dwSkipTypes, std::vector<DWORD> *pvMatches)
+	{
+		// Check every rom with the key, the key is only part of the digest.
+		auto range = mIndex.equal_range(qwKey);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			const CdiDatRom *pRom = &this->m_vRoms[it->second];
+			if ((pRom->sDigests.dwTypes & dwSkipTypes) == 0 && MatchRom(pRom, pDigests) == true)
+				pvMatches->push_back(it->second);
+		}
+	}
+
+	void CdiDatFile::FindRoms(const IO::DigestSet *pDigests, std::vector<DWORD> *pvMatches)
+	{
+		// A rom that lists a SHA-1 is only matched through the SHA-1 index and one that lists an MD5 through the SHA-1
+		// or MD5 index, so the weaker indices only add roms that were not already checked.
+		FindInIndex(this->m_mSha1Index, DigestKey(pDigests->bSha1), pDigests, IO::DigestType::DigestNone, pvMatches);
+		FindInIndex(this->m_mMd5Index, DigestKey(pDigests->bMd5), pDigests, IO::DigestType::DigestSha1, pvMatches);
+		FindInIndex(this->m_mCrcIndex, CrcKey(pDigests->dwCrc32, pDigests->qwSize), pDigests,
+			IO::DigestType::DigestSha1 | IO::DigestType::DigestMd5, pvMatches);
+	}
+
+	const CdiDatRom *CdiDatFile::FindRom(const IO::DigestSet *pDigests)
+	{
+		// Try the strongest digest first, roms that only list weaker digests are found in the other indices.
+		std::vector<DWORD> vMatches;
+		FindRoms(pDigests, &vMatches);
+		return (vMatches.size() > 0 ? &this->m_vRoms[vMatches[0]] : nullptr);
+	}
+
+	bool CdiDatFile::CheckImage(const CdiHashReport *pReport)
+	{
+		// If the DAT lists the image itself we are done.
+		const CdiDatRom *pRom = FindRom(&pReport->sImage);
+		if (pRom != nullptr)
+		{
+			printf("image matches %s (%s)\n", pRom->sName, pRom->sGameName);
+			return true;
+		}
+
+		// Otherwise every track has to be in the DAT, under the same game. Collect every rom each track matches in
+		// either layout, raw matches first.
+		bool bAllMatched = (pReport->vTracks.size() > 0);
+		std::vector<std::vector<DWORD>> vTrackMatches(pReport->vTracks.size());
+		std::vector<DWORD> vRawMatchCounts(pReport->vTracks.size());
+		for (size_t i = 0; i < pReport->vTracks.size(); i++)
+		{
+			const CdiTrackHashReport *pTrack = &pReport->vTracks[i];
+			FindRoms(&pTrack->sRaw, &vTrackMatches[i]);
+			vRawMatchCounts[i] = (DWORD)vTrackMatches[i].size();
+			if (pTrack->bHasCooked == true)
+				FindRoms(&pTrack->sCooked, &vTrackMatches[i]);
+
+			if (vTrackMatches[i].size() == 0)
+				bAllMatched = false;
+		}
+
+		// The candidate games are the games of the first track's roms that every other track also has a rom in.
+		const CdiDatRom *pGameRom = nullptr;
+		for (size_t x = 0; bAllMatched == true && x < vTrackMatches[0].size() && pGameRom == nullptr; x++)
+		{
+			const CdiDatRom *pCandidate = &this->m_vRoms[vTrackMatches[0][x]];
+			bool bInEveryTrack = true;
+			for (size_t i = 1; i < vTrackMatches.size() && bInEveryTrack == true; i++)
+			{
+				bInEveryTrack = false;
+				for (size_t y = 0; y < vTrackMatches[i].size() && bInEveryTrack == false; y++)
+					bInEveryTrack = (this->m_vRoms[vTrackMatches[i][y]].sGameName == pCandidate->sGameName);
+			}
+
+			if (bInEveryTrack == true)
+				pGameRom = pCandidate;
+		}
+
+		// Print the rom each track matched, picking the one from the matched game if there is one.
+		for (size_t i = 0; i < pReport->vTracks.size(); i++)
+		{
+			const CdiTrackHashReport *pTrack = &pReport->vTracks[i];
+			if (vTrackMatches[i].size() == 0)
+			{
+				printf("session %d track %d \tnot found in DAT\n", pTrack->dwSessionNumber + 1, pTrack->dwTrackNumber + 1);
+				continue;
+			}
+
+			size_t dwMatch = 0;
+			for (size_t y = 0; pGameRom != nullptr && y < vTrackMatches[i].size(); y++)
+			{
+				if (this->m_vRoms[vTrackMatches[i][y]].sGameName == pGameRom->sGameName)
+				{
+					dwMatch = y;
+					break;
+				}
+			}
+
+			pRom = &this->m_vRoms[vTrackMatches[i][dwMatch]];
+			printf("session %d track %d \tmatches %s (%s, %s)\n", pTrack->dwSessionNumber + 1, pTrack->dwTrackNumber + 1,
+				pRom->sName, pRom->sGameName, (dwMatch < vRawMatchCounts[i] ? "raw" : "cooked"));
+		}
+
+		if (bAllMatched == true && pGameRom == nullptr)
+			printf("tracks match roms from different games!\n");
+		if (pGameRom != nullptr)
+		{
+			printf("image matches %s\n", pGameRom->sGameName);
+			return true;
+		}
+
+		printf("image does not match the DAT\n");
+		return false;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,140 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiDatFile.h - Reference DAT files images and tracks are checked against.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "../IO/Digest.h"
+#include "CdiHasher.h"
+#include <unordered_map>
+#include <vector>
+
+namespace DiskJuggler
+{
+	// Largest DAT file that will be loaded, anything larger is treated as corrupt.
+	#define CDI_DAT_MAX_FILE_SIZE			0x40000000
+
+	struct CdiDatRom
+	{
+		CString sGameName;				// Name of the game the rom belongs to
+		CString sName;					// Name of the rom
+		IO::DigestSet sDigests;			// Size of the rom and the digests the DAT lists for it
+	};
+
+	//-----------------------------------------------------
+	// CdiDatFile
+	//-----------------------------------------------------
+	/*
+		Loads the roms out of a Logiqx XML or clrmamepro DAT file and indexes them by SHA-1, MD5 and CRC32 plus size,
+		so a digest can be looked up without walking every rom in the DAT. A rom matches a digest set when the sizes
+		are the same and every digest the DAT lists for the rom is the same.
+	*/
+	class CdiDatFile
+	{
+	protected:
+		std::vector<CdiDatRom>	m_vRoms;			// Every rom in the DAT
+		DWORD			m_dwSkippedRoms;			// Number of roms without a size or any digest
+
+		// Hash indices, each maps a key built from a digest to the index of every rom with that key.
+		std::unordered_multimap<ULONGLONG, DWORD>	m_mSha1Index;
+		std::unordered_multimap<ULONGLONG, DWORD>	m_mMd5Index;
+		std::unordered_multimap<ULONGLONG, DWORD>	m_mCrcIndex;
+
+		/*
+			Description: Parses a Logiqx XML DAT, every <rom> element inside of a <game> or <machine> element.
+		*/
+		void ParseXml(const CHAR *psData, DWORD dwSize);
+
+		/*
+			Description: Parses a clrmamepro DAT, every rom ( ... ) block inside of a game ( ... ) block.
+		*/
+		void ParseClrMamePro(const CHAR *psData, DWORD dwSize);
+
+		/*
+			Description: Sets one of the fields of a rom from an attribute of the DAT.
+
+			Parameters:
+				pRom: Rom to set the field of.
+				sKey: Name of the attribute.
+				sValue: Value of the attribute.
+		*/
+		void SetRomField(CdiDatRom *pRom, const CString &sKey, const CString &sValue);
+
+		/*
+			Description: Adds a rom to the DAT and the hash indices, roms without a size or any digest are skipped.
+		*/
+		void AddRom(CdiDatRom *pRom);
+
+		/*
+			Description: Checks if a rom matches a digest set.
+		*/
+		bool MatchRom(const CdiDatRom *pRom, const IO::DigestSet *pDigests);
+
+		/*
+			Description: Looks up a digest set in one of the hash indices and adds every rom with the key that matches
+				the digest set to pvMatches.
+
+			Parameters:
+				mIndex: Hash index to look in.
+				qwKey: Key of the digest set in the index.
+				pDigests: Digests to look up.
+				dwSkipTypes: Roms that list any of these digest types are skipped, they are found in a stronger index.
+				pvMatches: Receives the index of every matching rom.
+		*/
+		void FindInIndex(const std::unordered_multimap<ULONGLONG, DWORD> &mIndex, ULONGLONG qwKey, const IO::DigestSet *pDigests,
+			DWORD dwSkipTypes, std::vector<DWORD> *pvMatches);
+
+		/*
+			Description: Adds the index of every rom that matches a digest set to pvMatches, each rom is added once.
+		*/
+		void FindRoms(const IO::DigestSet *pDigests, std::vector<DWORD> *pvMatches);
+
+	public:
+		CdiDatFile();
+
+		/*
+			Description: Loads a DAT file, the format is picked from the contents of the file.
+
+			Parameters:
+				sFileName: DAT file to load.
+
+			Returns: True if the file was read and has at least one rom, false otherwise.
+		*/
+		bool Load(CString sFileName);
+
+		/*
+			Description: Gets the number of roms loaded, and the number that were skipped because they had no size or
+				no digests.
+		*/
+		DWORD RomCount();
+		DWORD SkippedRomCount();
+
+		/*
+			Description: Looks up a rom by its digests, trying the SHA-1 index first, then MD5, then CRC32 and size.
+
+			Parameters:
+				pDigests: Digests to look up, every digest must be set.
+
+			Returns: The matching rom, or nullptr if no rom in the DAT matches.
+		*/
+		const CdiDatRom *FindRom(const IO::DigestSet *pDigests);
+
+		/*
+			Description: Checks the digests of an image against the DAT and prints the result for the image and each
+				track. Tracks are looked up by both their raw and cooked layout. Tracks that are the same on many discs
+				match roms of many games, so the image matches a game when every track matches one of that game's roms.
+
+			Parameters:
+				pReport: Digests of the image.
+
+			Returns: True if the image itself is in the DAT, or if every track is in the DAT under the same game,
+				false otherwise.
+		*/
+		bool CheckImage(const CdiHashReport *pReport);
+	};
+};
\ No newline at end of file
@@ -0,0 +1,350 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiEdcEcc.cpp - EDC and ECC routines for raw CD-ROM sectors.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiEdcEcc.h"
+
+namespace DiskJuggler
+{
+	// Reversed EDC polynomial, x^32 + x^31 + x^16 + x^15 + x^4 + x^3 + x + 1.
+	#define CD_EDC_POLYNOMIAL		0xD8018001
+
+	// Dimensions of the P and Q parity code words.
+	#define CD_ECC_ROW_SIZE			86		// Number of P code words, and the number of bytes in a row of sector data
+	#define CD_ECC_P_ROWS			24		// Number of rows covered by the P parity
+	#define CD_ECC_Q_WORDS			52		// Number of Q code words
+	#define CD_ECC_Q_STEPS			43		// Number of bytes in each Q code word
+
+	// Sync pattern found at the start of every mode 1 and mode 2 sector.
+	static const BYTE g_bSyncPattern[CD_SYNC_SIZE] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+
+	// Declared in CdiEdcEcc.h so the image writer and exporter share the one copy.
+	const BYTE g_bMode2Subheader[8] = { 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x08, 0x00 };
+
+	/*
+		Lookup tables for the EDC and ECC routines, built once when the program starts.
+	*/
+	static struct EdcEccTables
+	{
+		DWORD dwEdc[8][256];		// Slice-by-8 EDC tables, dwEdc[0] is the regular byte at a time table
+		BYTE bEccForward[256];		// Multiply by alpha in GF(2^8)
+		BYTE bEccBackward[256];		// Divide by (alpha + 1) in GF(2^8)
+		WORD wEccQIndex[CD_ECC_Q_STEPS][CD_ECC_Q_WORDS / 2];	// Offset of each pair of Q code word bytes at each step
+
+		EdcEccTables()
+		{
+			// Build the byte at a time EDC table and the GF(2^8) tables.
+			for (DWORD i = 0; i < 256; i++)
+			{
+				DWORD dwEdcValue = i;
+				for (int x = 0; x < 8; x++)
+					dwEdcValue = (dwEdcValue >> 1) ^ ((dwEdcValue & 1) != 0 ? CD_EDC_POLYNOMIAL : 0);
+				this->dwEdc[0][i] = dwEdcValue;
+
+				DWORD dwForward = (i << 1) ^ ((i & 0x80) != 0 ? 0x11D : 0);
+				this->bEccForward[i] = (BYTE)dwForward;
+				this->bEccBackward[i ^ dwForward] = (BYTE)i;
+			}
+
+			// Each slice table advances the EDC over one more zero byte.
+			for (int x = 1; x < 8; x++)
+			{
+				for (DWORD i = 0; i < 256; i++)
+					this->dwEdc[x][i] = (this->dwEdc[x - 1][i] >> 8) ^ this->dwEdc[0][this->dwEdc[x - 1][i] & 0xFF];
+			}
+
+			// Each pair of Q code words starts at the beginning of a row and moves down one row and across one
+			// word each step, wrapping around at the end of the P parity.
+			for (DWORD dwStep = 0; dwStep < CD_ECC_Q_STEPS; dwStep++)
+			{
+				for (DWORD i = 0; i < CD_ECC_Q_WORDS / 2; i++)
+					this->wEccQIndex[dwStep][i] = (WORD)((i * CD_ECC_ROW_SIZE + dwStep * (CD_ECC_ROW_SIZE + 2)) % (CD_ECC_Q_OFFSET - CD_HEADER_OFFSET));
+			}
+		}
+	} g_sTables;
+
+	DWORD ComputeEdc(DWORD dwEdc, const BYTE *pbData, DWORD dwSize)
+	{
+		// Process 8 bytes at a time using the slice tables.
+		while (dwSize >= 8)
+		{
+			DWORD dwLow, dwHigh;
+			memcpy(&dwLow, pbData, sizeof(DWORD));
+			memcpy(&dwHigh, pbData + 4, sizeof(DWORD));
+			dwLow ^= dwEdc;
+
+			dwEdc = g_sTables.dwEdc[7][dwLow & 0xFF] ^ g_sTables.dwEdc[6][(dwLow >> 8) & 0xFF] ^
+				g_sTables.dwEdc[5][(dwLow >> 16) & 0xFF] ^ g_sTables.dwEdc[4][dwLow >> 24] ^
+				g_sTables.dwEdc[3][dwHigh & 0xFF] ^ g_sTables.dwEdc[2][(dwHigh >> 8) & 0xFF] ^
+				g_sTables.dwEdc[1][(dwHigh >> 16) & 0xFF] ^ g_sTables.dwEdc[0][dwHigh >> 24];
+
+			pbData += 8;
+			dwSize -= 8;
+		}
+
+		// Process any remaining bytes one at a time.
+		while (dwSize-- > 0)
+			dwEdc = (dwEdc >> 8) ^ g_sTables.dwEdc[0][(dwEdc ^ *pbData++) & 0xFF];
+
+		return dwEdc;
+	}
+
+	/*
+		Description: Multiplies each of the 8 bytes in qwValue by alpha in GF(2^8).
+	*/
+	static inline ULONGLONG EccMultiplyAlpha(ULONGLONG qwValue)
+	{
+		return ((qwValue & 0x7F7F7F7F7F7F7F7FULL) << 1) ^ (((qwValue >> 7) & 0x0101010101010101ULL) * 0x1D);
+	}
+
+	/*
+		Description: Computes the parity bytes of dwCount code words that have been accumulated 8 at a time in
+			pqwEccA and pqwEccB.
+	*/
+	static void FinishEccBlock(const ULONGLONG *pqwEccA, const ULONGLONG *pqwEccB, DWORD dwCount, PBYTE pbParity)
+	{
+		const BYTE *pbEccA = (const BYTE*)pqwEccA;
+		const BYTE *pbEccB = (const BYTE*)pqwEccB;
+		for (DWORD i = 0; i < dwCount; i++)
+		{
+			BYTE bEccA = g_sTables.bEccBackward[g_sTables.bEccForward[pbEccA[i]] ^ pbEccB[i]];
+			pbParity[i] = bEccA;
+			pbParity[i + dwCount] = bEccA ^ pbEccB[i];
+		}
+	}
+
+	void ComputeEcc(const BYTE *pbSector, PBYTE pbEccP, PBYTE pbEccQ)
+	{
+		// Both parities are computed over the sector starting at the header. Each code word is accumulated in its own
+		// byte lane so 8 code words are processed at a time.
+		const BYTE *pbData = &pbSector[CD_HEADER_OFFSET];
+		ULONGLONG qwEccA[11], qwEccB[11], qwRow[11] = { 0 };
+
+		// The P parity has 86 code words made of the 24 rows of 86 bytes that hold the header, user data and EDC.
+		memset(qwEccA, 0, sizeof(qwEccA));
+		memset(qwEccB, 0, sizeof(qwEccB));
+		for (DWORD dwRow = 0; dwRow < CD_ECC_P_ROWS; dwRow++)
+		{
+			memcpy(qwRow, &pbData[dwRow * CD_ECC_ROW_SIZE], CD_ECC_ROW_SIZE);
+			for (int i = 0; i < 11; i++)
+			{
+				qwEccA[i] = EccMultiplyAlpha(qwEccA[i] ^ qwRow[i]);
+				qwEccB[i] ^= qwRow[i];
+			}
+		}
+		FinishEccBlock(qwEccA, qwEccB, CD_ECC_ROW_SIZE, pbEccP);
+
+		// The Q parity has 52 code words running diagonally through the same data followed by the P parity, which
+		// we take from pbEccP rather than the sector. Gather each diagonal step into a row using the index table.
+		BYTE bData[CD_ECC_Q_OFFSET - CD_HEADER_OFFSET];
+		memcpy(bData, pbData, CD_ECC_P_OFFSET - CD_HEADER_OFFSET);
+		memcpy(&bData[CD_ECC_P_OFFSET - CD_HEADER_OFFSET], pbEccP, CD_ECC_P_SIZE);
+
+		memset(qwEccA, 0, sizeof(qwEccA));
+		memset(qwEccB, 0, sizeof(qwEccB));
+		for (DWORD dwStep = 0; dwStep < CD_ECC_Q_STEPS; dwStep++)
+		{
+			PBYTE pbRow = (PBYTE)qwRow;
+			for (DWORD i = 0; i < CD_ECC_Q_WORDS / 2; i++)
+				memcpy(&pbRow[i * 2], &bData[g_sTables.wEccQIndex[dwStep][i]], 2);
+
+			for (int i = 0; i < 7; i++)
+			{
+				qwEccA[i] = EccMultiplyAlpha(qwEccA[i] ^ qwRow[i]);
+				qwEccB[i] ^= qwRow[i];
+			}
+		}
+		FinishEccBlock(qwEccA, qwEccB, CD_ECC_Q_WORDS, pbEccQ);
+	}
+
+	void LbaToMsf(DWORD dwLBA, PBYTE pbMsf)
+	{
+		// Convert the LBA to an absolute address and split it into minutes, seconds and frames.
+		DWORD dwAddress = dwLBA + CD_MSF_LBA_OFFSET;
+		DWORD dwMinute = dwAddress / (60 * 75);
+		DWORD dwSecond = (dwAddress / 75) % 60;
+		DWORD dwFrame = dwAddress % 75;
+
+		// Store each value as BCD.
+		pbMsf[0] = (BYTE)(((dwMinute / 10) << 4) | (dwMinute % 10));
+		pbMsf[1] = (BYTE)(((dwSecond / 10) << 4) | (dwSecond % 10));
+		pbMsf[2] = (BYTE)(((dwFrame / 10) << 4) | (dwFrame % 10));
+	}
+
+	bool CanVerifySectors(CdiSectorSize eSectorSize, CdiTrackMode eMode)
+	{
+		// Audio sectors have no error detection data and cooked 2048 byte sectors have had it stripped.
+		if (eMode == CdiTrackMode::Audio || eSectorSize == CdiSectorSize::Size_2048)
+			return false;
+
+		// 2336 byte sectors only exist for mode 2, everything else holds a full raw sector.
+		return eSectorSize != CdiSectorSize::Size_2336 || eMode == CdiTrackMode::Mode2;
+	}
+
+	DWORD VerifySector(const BYTE *pbSector, CdiSectorSize eSectorSize, CdiTrackMode eMode, DWORD dwLBA)
+	{
+		BYTE bSector[CD_RAW_SECTOR_SIZE];
+		BYTE bEccP[CD_ECC_P_SIZE];
+		BYTE bEccQ[CD_ECC_Q_SIZE];
+		DWORD dwErrors = SectorOk;
+
+		// 2336 byte sectors have no sync or header, rebuild the raw sector around them so the offsets line up.
+		const BYTE *pbRawSector = pbSector;
+		if (eSectorSize == CdiSectorSize::Size_2336)
+		{
+			memset(bSector, 0, CD_SUBHEADER_OFFSET);
+			memcpy(&bSector[CD_SUBHEADER_OFFSET], pbSector, CdiSectorSize::Size_2336);
+			pbRawSector = bSector;
+		}
+		else
+		{
+			// Check the sync pattern.
+			if (memcmp(pbRawSector, g_bSyncPattern, CD_SYNC_SIZE) != 0)
+				dwErrors |= SectorSyncError;
+
+			// Check the address in the header matches the LBA we read the sector from.
+			BYTE bMsf[3];
+			LbaToMsf(dwLBA, bMsf);
+			if (memcmp(&pbRawSector[CD_HEADER_OFFSET], bMsf, sizeof(bMsf)) != 0)
+				dwErrors |= SectorAddressError;
+
+			// Check the mode byte matches the track mode.
+			if (pbRawSector[CD_HEADER_OFFSET + 3] != (eMode == CdiTrackMode::Mode1 ? 1 : 2))
+				dwErrors |= SectorModeError;
+		}
+
+		// Mode 1 sectors have the EDC and ECC computed over the header and user data.
+		if (eMode == CdiTrackMode::Mode1)
+		{
+			// Check the EDC.
+			DWORD dwEdc;
+			memcpy(&dwEdc, &pbRawSector[CD_MODE1_EDC_OFFSET], sizeof(DWORD));
+			if (ComputeEdc(0, pbRawSector, CD_MODE1_EDC_OFFSET) != dwEdc)
+				dwErrors |= SectorEdcError;
+
+			// Check the ECC.
+			ComputeEcc(pbRawSector, bEccP, bEccQ);
+			if (memcmp(&pbRawSector[CD_ECC_P_OFFSET], bEccP, CD_ECC_P_SIZE) != 0)
+				dwErrors |= SectorEccPError;
+			if (memcmp(&pbRawSector[CD_ECC_Q_OFFSET], bEccQ, CD_ECC_Q_SIZE) != 0)
+				dwErrors |= SectorEccQError;
+
+			return dwErrors;
+		}
+
+		// Mode 2 sectors store the subheader twice, both copies must match.
+		if (memcmp(&pbRawSector[CD_SUBHEADER_OFFSET], &pbRawSector[CD_SUBHEADER_OFFSET + 4], 4) != 0)
+			dwErrors |= SectorSubheaderError;
+
+		// Form 2 sectors only have an EDC, and it is optional.
+		if ((pbRawSector[CD_SUBHEADER_OFFSET + 2] & CD_SUBMODE_FORM2) != 0)
+		{
+			DWORD dwEdc;
+			memcpy(&dwEdc, &pbRawSector[CD_MODE2_FORM2_EDC_OFFSET], sizeof(DWORD));
+			if (dwEdc != 0 && ComputeEdc(0, &pbRawSector[CD_SUBHEADER_OFFSET], CD_MODE2_FORM2_EDC_OFFSET - CD_SUBHEADER_OFFSET) != dwEdc)
+				dwErrors |= SectorEdcError;
+
+			return dwErrors;
+		}
+
+		// Form 1 sectors have the EDC computed over the subheader and user data.
+		DWORD dwEdc;
+		memcpy(&dwEdc, &pbRawSector[CD_MODE2_FORM1_EDC_OFFSET], sizeof(DWORD));
+		if (ComputeEdc(0, &pbRawSector[CD_SUBHEADER_OFFSET], CD_MODE2_FORM1_EDC_OFFSET - CD_SUBHEADER_OFFSET) != dwEdc)
+			dwErrors |= SectorEdcError;
+
+		// The ECC of form 1 sectors is computed with the header cleared so the sector can be relocated.
+		if (pbRawSector != bSector)
+		{
+			memcpy(bSector, pbRawSector, CD_ECC_Q_OFFSET);
+			memset(&bSector[CD_HEADER_OFFSET], 0, 4);
+		}
+		ComputeEcc(bSector, bEccP, bEccQ);
+		if (memcmp(&pbRawSector[CD_ECC_P_OFFSET], bEccP, CD_ECC_P_SIZE) != 0)
+			dwErrors |= SectorEccPError;
+		if (memcmp(&pbRawSector[CD_ECC_Q_OFFSET], bEccQ, CD_ECC_Q_SIZE) != 0)
+			dwErrors |= SectorEccQError;
+
+		return dwErrors;
+	}
+
+	/*
+		Description: Rebuilds the header, EDC and ECC of a single raw 2352 byte sector.
+	*/
+	static void RegenerateRawSector(PBYTE pbSector, CdiTrackMode eMode, DWORD dwLBA, DWORD dwFlags)
+	{
+		// Rewrite the sync pattern and header.
+		if ((dwFlags & RegenerateHeader) != 0)
+		{
+			memcpy(pbSector, g_bSyncPattern, CD_SYNC_SIZE);
+			LbaToMsf(dwLBA, &pbSector[CD_HEADER_OFFSET]);
+			pbSector[CD_HEADER_OFFSET + 3] = (eMode == CdiTrackMode::Mode1 ? 1 : 2);
+		}
+
+		if ((dwFlags & RegenerateEdcEcc) == 0)
+			return;
+
+		// Mode 1 sectors have the EDC and ECC computed over the header, and 8 reserved bytes after the EDC.
+		if (eMode == CdiTrackMode::Mode1)
+		{
+			DWORD dwEdc = ComputeEdc(0, pbSector, CD_MODE1_EDC_OFFSET);
+			memcpy(&pbSector[CD_MODE1_EDC_OFFSET], &dwEdc, sizeof(DWORD));
+			memset(&pbSector[CD_MODE1_EDC_OFFSET + 4], 0, 8);
+
+			ComputeEcc(pbSector, &pbSector[CD_ECC_P_OFFSET], &pbSector[CD_ECC_Q_OFFSET]);
+			return;
+		}
+
+		// Form 2 sectors only have an EDC.
+		if ((pbSector[CD_SUBHEADER_OFFSET + 2] & CD_SUBMODE_FORM2) != 0)
+		{
+			DWORD dwEdc = ComputeEdc(0, &pbSector[CD_SUBHEADER_OFFSET], CD_MODE2_FORM2_EDC_OFFSET - CD_SUBHEADER_OFFSET);
+			memcpy(&pbSector[CD_MODE2_FORM2_EDC_OFFSET], &dwEdc, sizeof(DWORD));
+			return;
+		}
+
+		// Form 1 sectors have the EDC computed over the subheader and the ECC computed with the header cleared.
+		DWORD dwEdc = ComputeEdc(0, &pbSector[CD_SUBHEADER_OFFSET], CD_MODE2_FORM1_EDC_OFFSET - CD_SUBHEADER_OFFSET);
+		memcpy(&pbSector[CD_MODE2_FORM1_EDC_OFFSET], &dwEdc, sizeof(DWORD));
+
+		BYTE bHeader[4];
+		memcpy(bHeader, &pbSector[CD_HEADER_OFFSET], sizeof(bHeader));
+		memset(&pbSector[CD_HEADER_OFFSET], 0, sizeof(bHeader));
+		ComputeEcc(pbSector, &pbSector[CD_ECC_P_OFFSET], &pbSector[CD_ECC_Q_OFFSET]);
+		memcpy(&pbSector[CD_HEADER_OFFSET], bHeader, sizeof(bHeader));
+	}
+
+	void RegenerateSectors(PBYTE pbSectors, CdiSectorSize eSectorSize, CdiTrackMode eMode, DWORD dwLBA, DWORD dwSectorCount, DWORD dwFlags)
+	{
+		BYTE bSector[CD_RAW_SECTOR_SIZE];
+
+		// Check there is anything to rebuild for this type of sector.
+		if (CanVerifySectors(eSectorSize, eMode) == false)
+			return;
+
+		// Loop through all of the sectors and rebuild each one.
+		for (DWORD i = 0; i < dwSectorCount; i++)
+		{
+			PBYTE pbSector = &pbSectors[(SIZE_T)i * eSectorSize];
+			if (eSectorSize != CdiSectorSize::Size_2336)
+			{
+				// Raw sectors can be rebuilt in place, any subchannel data following the sector is left alone.
+				RegenerateRawSector(pbSector, eMode, dwLBA + i, dwFlags);
+				continue;
+			}
+
+			// 2336 byte sectors have no header to rebuild, build a raw sector around them with the header cleared
+			// as that is how the ECC is computed, then copy the result back.
+			memset(bSector, 0, CD_SUBHEADER_OFFSET);
+			memcpy(&bSector[CD_SUBHEADER_OFFSET], pbSector, CdiSectorSize::Size_2336);
+			RegenerateRawSector(bSector, eMode, dwLBA + i, dwFlags & ~RegenerateHeader);
+			memcpy(pbSector, &bSector[CD_SUBHEADER_OFFSET], CdiSectorSize::Size_2336);
+		}
+	}
+};
\ No newline at end of file
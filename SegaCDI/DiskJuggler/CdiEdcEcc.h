@@ -0,0 +1,133 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiEdcEcc.h - EDC and ECC routines for raw CD-ROM sectors.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "CdiFileHandle.h"
+
+namespace DiskJuggler
+{
+	//-----------------------------------------------------
+	// Raw Sector Layout
+	//-----------------------------------------------------
+	#define CD_RAW_SECTOR_SIZE				2352
+	#define CD_SYNC_SIZE					12
+	#define CD_HEADER_OFFSET				0xC		// Minute, second, frame and mode bytes
+	#define CD_SUBHEADER_OFFSET				0x10	// Mode 2 subheader, stored twice
+	#define CD_MODE1_EDC_OFFSET				0x810
+	#define CD_MODE2_FORM1_EDC_OFFSET		0x818
+	#define CD_MODE2_FORM2_EDC_OFFSET		0x92C
+	#define CD_ECC_P_OFFSET					0x81C
+	#define CD_ECC_P_SIZE					172
+	#define CD_ECC_Q_OFFSET					0x8C8
+	#define CD_ECC_Q_SIZE					104
+
+	// Submode bit in the mode 2 subheader that selects form 2.
+	#define CD_SUBMODE_FORM2				0x20
+
+	// LBA 0 is located at MSF 00:02:00.
+	#define CD_MSF_LBA_OFFSET				150
+
+	// Mode 2 form 1 subheader for plain data sectors: file 0, channel 0, submode data, coding 0. Both copies of
+	// the subheader are included.
+	extern const BYTE g_bMode2Subheader[8];
+
+	/*
+		Bit flags describing what is wrong with a sector.
+	*/
+	enum CdiSectorError : DWORD
+	{
+		SectorOk			= 0,
+		SectorSyncError		= 0x01,		// Sync pattern is invalid
+		SectorAddressError	= 0x02,		// MSF address in the header does not match the LBA of the sector
+		SectorModeError		= 0x04,		// Mode byte does not match the mode of the track
+		SectorSubheaderError = 0x08,	// The two copies of the mode 2 subheader do not match
+		SectorEdcError		= 0x10,		// EDC does not match the sector data
+		SectorEccPError		= 0x20,		// P parity does not match the sector data
+		SectorEccQError		= 0x40,		// Q parity does not match the sector data
+		SectorReadError		= 0x80,		// Sector could not be read from the image
+		SectorSubchannelError = 0x100	// Q channel CRC is invalid or its address does not match the LBA of the sector
+	};
+
+	/*
+		Bit flags selecting which parts of a raw sector are rebuilt when sectors are written.
+	*/
+	enum CdiSectorRegeneration : DWORD
+	{
+		RegenerateNone		= 0,
+		RegenerateEdcEcc	= 0x01,		// Recompute the EDC and P/Q parity from the sector data
+		RegenerateHeader	= 0x02		// Rewrite the sync pattern, MSF address and mode byte from the LBA of the sector
+	};
+
+	/*
+		Description: Computes the EDC checksum of a block of sector data using slice-by-8 lookup tables.
+
+		Parameters:
+			dwEdc: EDC of the data preceding pbData, or 0 for the start of the block.
+			pbData: Data to checksum.
+			dwSize: Number of bytes in pbData.
+
+		Returns: The updated EDC value.
+	*/
+	DWORD ComputeEdc(DWORD dwEdc, const BYTE *pbData, DWORD dwSize);
+
+	/*
+		Description: Computes the P and Q parity of a raw sector. The parity is computed over the sector as it is,
+			mode 2 callers must clear the header bytes first.
+
+		Parameters:
+			pbSector: Raw 2352 byte sector.
+			pbEccP: Buffer that receives CD_ECC_P_SIZE bytes of P parity.
+			pbEccQ: Buffer that receives CD_ECC_Q_SIZE bytes of Q parity, computed using the P parity in pbEccP.
+	*/
+	void ComputeEcc(const BYTE *pbSector, PBYTE pbEccP, PBYTE pbEccQ);
+
+	/*
+		Description: Converts an LBA to the BCD encoded MSF address stored in a sector header.
+
+		Parameters:
+			dwLBA: LBA to convert.
+			pbMsf: Buffer that receives the minute, second and frame bytes.
+	*/
+	void LbaToMsf(DWORD dwLBA, PBYTE pbMsf);
+
+	/*
+		Description: Checks the sync pattern, header, subheader, EDC and ECC of a single sector.
+
+		Parameters:
+			pbSector: Sector to check, in the layout it is stored in the image. 2336 byte sectors start at the
+				subheader, 2352/2368/2448 byte sectors start at the sync pattern and any subchannel data is ignored.
+			eSectorSize: Size of the sector in the image.
+			eMode: Mode of the track the sector belongs to.
+			dwLBA: LBA of the sector, used to check the MSF address in the header.
+
+		Returns: A combination of CdiSectorError flags, SectorOk if the sector is valid.
+	*/
+	DWORD VerifySector(const BYTE *pbSector, CdiSectorSize eSectorSize, CdiTrackMode eMode, DWORD dwLBA);
+
+	/*
+		Description: Gets a boolean indicating if sectors of the given size and mode carry EDC/ECC data that can
+			be checked by VerifySector() or rebuilt by RegenerateSectors().
+	*/
+	bool CanVerifySectors(CdiSectorSize eSectorSize, CdiTrackMode eMode);
+
+	/*
+		Description: Rebuilds the header, EDC and ECC of a run of sectors in place after their user data has been
+			modified. Mode 2 sectors keep their subheader, which selects between form 1 and form 2.
+
+		Parameters:
+			pbSectors: Sectors to rebuild, in the layout they are stored in the image.
+			eSectorSize: Size of each sector in the image.
+			eMode: Mode of the track the sectors belong to.
+			dwLBA: LBA of the first sector.
+			dwSectorCount: Number of sectors in pbSectors.
+			dwFlags: Combination of CdiSectorRegeneration flags selecting what to rebuild.
+	*/
+	void RegenerateSectors(PBYTE pbSectors, CdiSectorSize eSectorSize, CdiTrackMode eMode, DWORD dwLBA, DWORD dwSectorCount, DWORD dwFlags);
+};
\ No newline at end of file
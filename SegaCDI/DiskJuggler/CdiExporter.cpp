@@ -0,0 +1,291 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiExporter.cpp - Exports the tracks of a Disk Juggler image to BIN/CUE and
+		GDI layouts.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiExporter.h"
+#include "CdiEdcEcc.h"
+#include "../IO/BlockDevice.h"
+
+namespace DiskJuggler
+{
+	CdiExporter::CdiExporter(CdiFileHandle *pCdiFile)
+	{
+		// Initialize fields.
+		this->m_pCdiFile = pCdiFile;
+		this->m_qwCopiedBytes = 0;
+		this->m_qwEncodedBytes = 0;
+	}
+
+	DWORD CdiExporter::GetCueSectorSize(const CdiTrack *pTrack, LPCSTR *ppsTrackType)
+	{
+		// Audio tracks are always written as plain 2352 byte sectors, the subchannel is dropped.
+		if (pTrack->eMode == CdiTrackMode::Audio)
+		{
+			*ppsTrackType = "AUDIO";
+			return CdiSectorSize::Size_2352;
+		}
+
+		if (pTrack->eMode == CdiTrackMode::Mode1)
+		{
+			// Mode 1 tracks keep their user data as is, anything larger becomes a raw sector.
+			if (pTrack->eSectorSize == CdiSectorSize::Size_2048)
+			{
+				*ppsTrackType = "MODE1/2048";
+				return CdiSectorSize::Size_2048;
+			}
+
+			*ppsTrackType = "MODE1/2352";
+			return CdiSectorSize::Size_2352;
+		}
+
+		// MODE2/2048 isn't understood by most tools, so mode 2 user data is rebuilt into raw sectors.
+		if (pTrack->eSectorSize == CdiSectorSize::Size_2336)
+		{
+			*ppsTrackType = "MODE2/2336";
+			return CdiSectorSize::Size_2336;
+		}
+
+		*ppsTrackType = "MODE2/2352";
+		return CdiSectorSize::Size_2352;
+	}
+
+	DWORD CdiExporter::GetGdiSectorSize(const CdiTrack *pTrack)
+	{
+		// GDI only knows 2048 byte data sectors and raw sectors.
+		if (pTrack->eMode != CdiTrackMode::Audio && pTrack->eSectorSize == CdiSectorSize::Size_2048)
+			return CdiSectorSize::Size_2048;
+
+		return CdiSectorSize::Size_2352;
+	}
+
+	void CdiExporter::EncodeSectors(const BYTE *pbSource, const CdiTrack *pTrack, DWORD dwLBA, DWORD dwSectorCount, PBYTE pbOutput, DWORD dwOutputSectorSize)
+	{
+		// Loop through all of the sectors and convert each one.
+		for (DWORD i = 0; i < dwSectorCount; i++)
+		{
+			const BYTE *pbSector = &pbSource[(SIZE_T)i * pTrack->eSectorSize];
+			PBYTE pbOutputSector = &pbOutput[(SIZE_T)i * dwOutputSectorSize];
+
+			switch (pTrack->eSectorSize)
+			{
+			case CdiSectorSize::Size_2048:
+				{
+					// Place the user data where it goes in a raw sector, mode 2 sectors get a form 1 subheader.
+					memset(pbOutputSector, 0, dwOutputSectorSize);
+					if (pTrack->eMode == CdiTrackMode::Mode2)
+					{
+						memcpy(&pbOutputSector[CD_SUBHEADER_OFFSET], g_bMode2Subheader, sizeof(g_bMode2Subheader));
+						memcpy(&pbOutputSector[CD_SUBHEADER_OFFSET + sizeof(g_bMode2Subheader)], pbSector, CdiSectorSize::Size_2048);
+					}
+					else
+						memcpy(&pbOutputSector[CD_SUBHEADER_OFFSET], pbSector, CdiSectorSize::Size_2048);
+					break;
+				}
+			case CdiSectorSize::Size_2336:
+				{
+					// The subheader, user data and EDC/ECC are all there, only the sync and header are missing.
+					memset(pbOutputSector, 0, CD_SUBHEADER_OFFSET);
+					memcpy(&pbOutputSector[CD_SUBHEADER_OFFSET], pbSector, CdiSectorSize::Size_2336);
+					break;
+				}
+			default:
+				{
+					// Raw sectors only need the subchannel dropped.
+					memcpy(pbOutputSector, pbSector, dwOutputSectorSize);
+					break;
+				}
+			}
+		}
+
+		// Build the parts of the sectors that weren't stored in the image.
+		if (pTrack->eSectorSize == CdiSectorSize::Size_2048)
+			RegenerateSectors(pbOutput, (CdiSectorSize)dwOutputSectorSize, pTrack->eMode, dwLBA, dwSectorCount, RegenerateHeader | RegenerateEdcEcc);
+		else if (pTrack->eSectorSize == CdiSectorSize::Size_2336)
+			RegenerateSectors(pbOutput, (CdiSectorSize)dwOutputSectorSize, pTrack->eMode, dwLBA, dwSectorCount, RegenerateHeader);
+	}
+
+	bool CdiExporter::ExportTrack(DWORD dwSessionNumber, DWORD dwTrackNumber, CString sFileName, DWORD dwOutputSectorSize, bool bIncludePregap)
+	{
+		ArrayView<CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+		const CdiTrack *pTrack = &sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber];
+
+		// Only raw sectors can be built from what is stored in the image.
+		if (dwOutputSectorSize != pTrack->eSectorSize && dwOutputSectorSize != CdiSectorSize::Size_2352)
+		{
+			printf("CdiExporter::ExportTrack(): can't convert %d byte sectors to %d byte sectors!\n", pTrack->eSectorSize, dwOutputSectorSize);
+			return false;
+		}
+
+		// Check which sectors to write.
+		DWORD dwFirstLBA = (bIncludePregap == true ? pTrack->dwLba - pTrack->dwPregapLength : pTrack->dwLba);
+		DWORD dwSectorCount = pTrack->dwLength + (bIncludePregap == true ? pTrack->dwPregapLength : 0);
+
+		// Create the track file.
+		IO::BlockDevice *pTrackFile = IO::OpenFileDevice(sFileName, IO::BlockDeviceAccess::CreateAlways);
+		if (pTrackFile == nullptr)
+		{
+			printf("CdiExporter::ExportTrack(): failed to create track file %s!\n", sFileName);
+			return false;
+		}
+
+		bool bResult = true;
+		if (dwOutputSectorSize == pTrack->eSectorSize)
+		{
+			// The sectors are stored the way they are exported, copy them straight from the image file to the track
+			// file so the data doesn't have to pass through our buffers.
+			bResult = this->m_pCdiFile->CopyRawSectors(dwSessionNumber, dwTrackNumber, dwFirstLBA, dwSectorCount, pTrackFile, 0);
+			if (bResult == true)
+				this->m_qwCopiedBytes += (ULONGLONG)dwSectorCount * dwOutputSectorSize;
+		}
+		else
+		{
+			// Read the sectors in batches and convert them to the new sector size.
+			PBYTE pbSource = new BYTE[CDI_EXPORT_BATCH_SECTORS * pTrack->eSectorSize];
+			PBYTE pbOutput = new BYTE[CDI_EXPORT_BATCH_SECTORS * dwOutputSectorSize];
+			for (DWORD i = 0; i < dwSectorCount && bResult == true; )
+			{
+				DWORD dwBatchCount = (dwSectorCount - i < CDI_EXPORT_BATCH_SECTORS ? dwSectorCount - i : CDI_EXPORT_BATCH_SECTORS);
+				if (this->m_pCdiFile->ReadRawSectors(dwSessionNumber, dwTrackNumber, dwFirstLBA + i, pbSource, dwBatchCount) == false)
+				{
+					bResult = false;
+					break;
+				}
+
+				EncodeSectors(pbSource, pTrack, dwFirstLBA + i, dwBatchCount, pbOutput, dwOutputSectorSize);
+				if (pTrackFile->WriteAt((ULONGLONG)i * dwOutputSectorSize, pbOutput, dwBatchCount * dwOutputSectorSize) == false)
+				{
+					printf("CdiExporter::ExportTrack(): failed to write to track file %s!\n", sFileName);
+					bResult = false;
+					break;
+				}
+
+				this->m_qwEncodedBytes += (ULONGLONG)dwBatchCount * dwOutputSectorSize;
+				i += dwBatchCount;
+			}
+
+			delete[] pbSource;
+			delete[] pbOutput;
+		}
+
+		// Close the track file.
+		delete pTrackFile;
+		return bResult;
+	}
+
+	bool CdiExporter::Export(CString sOutputFolder, CString sName, CdiExportFormat eFormat)
+	{
+		CString sSheet;
+		CString sFileName;
+
+		this->m_qwCopiedBytes = 0;
+		this->m_qwEncodedBytes = 0;
+
+		// Count the tracks on the disc, the GDI sheet starts with it.
+		ArrayView<CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+		DWORD dwDiscTrackCount = 0;
+		for (size_t i = 0; i < sessionCollection.size(); i++)
+			dwDiscTrackCount += sessionCollection[i]->wTrackCount;
+
+		if (eFormat == CdiExportFormat::ExportGdi)
+			sSheet.AppendFormat("%d\r\n", dwDiscTrackCount);
+
+		// Loop through all of the tracks on the disc and export each one.
+		DWORD dwDiscTrack = 1;
+		for (size_t i = 0; i < sessionCollection.size(); i++)
+		{
+			const CdiSession *pSession = sessionCollection[i];
+
+			// Mark where each session starts if there is more than one.
+			if (eFormat == CdiExportFormat::ExportBinCue && sessionCollection.size() > 1)
+				sSheet.AppendFormat("REM SESSION %02d\r\n", i + 1);
+
+			for (DWORD x = 0; x < pSession->wTrackCount; x++, dwDiscTrack++)
+			{
+				const CdiTrack *pTrack = &pSession->psTracks[x];
+
+				if (eFormat == CdiExportFormat::ExportBinCue)
+				{
+					// Get the sector size to export the track with.
+					LPCSTR psTrackType = nullptr;
+					DWORD dwSectorSize = GetCueSectorSize(pTrack, &psTrackType);
+
+					// The pregap of the first track on the disc is implied, every other pregap is kept in the track
+					// file and marked with INDEX 00.
+					bool bIncludePregap = (dwDiscTrack > 1 && pTrack->dwPregapLength > 0);
+
+					// Export the track.
+					CString sTrackName;
+					sTrackName.Format("%s (Track %02d).bin", sName, dwDiscTrack);
+					sFileName.Format("%s\\%s", sOutputFolder, sTrackName);
+					printf("exporting track %d to %s...\n", dwDiscTrack, sFileName);
+					if (ExportTrack((DWORD)i, x, sFileName, dwSectorSize, bIncludePregap) == false)
+						return false;
+
+					// Add it to the cue sheet.
+					sSheet.AppendFormat("FILE \"%s\" BINARY\r\n  TRACK %02d %s\r\n", sTrackName, dwDiscTrack, psTrackType);
+					if (bIncludePregap == true)
+					{
+						sSheet += "    INDEX 00 00:00:00\r\n";
+						sSheet.AppendFormat("    INDEX 01 %02d:%02d:%02d\r\n", pTrack->dwPregapLength / (75 * 60),
+							(pTrack->dwPregapLength / 75) % 60, pTrack->dwPregapLength % 75);
+					}
+					else
+						sSheet += "    INDEX 01 00:00:00\r\n";
+				}
+				else
+				{
+					// Get the sector size to export the track with, audio tracks are named .raw.
+					DWORD dwSectorSize = GetGdiSectorSize(pTrack);
+					bool bAudio = (pTrack->eMode == CdiTrackMode::Audio);
+
+					// Export the track, GDI track files start at the track LBA so pregaps are left out.
+					CString sTrackName;
+					sTrackName.Format("track%02d.%s", dwDiscTrack, (bAudio == true ? "raw" : "bin"));
+					sFileName.Format("%s\\%s", sOutputFolder, sTrackName);
+					printf("exporting track %d to %s...\n", dwDiscTrack, sFileName);
+					if (ExportTrack((DWORD)i, x, sFileName, dwSectorSize, false) == false)
+						return false;
+
+					// Add it to the GDI sheet.
+					sSheet.AppendFormat("%d %d %d %d %s 0\r\n", dwDiscTrack, pTrack->dwLba, (bAudio == true ? 0 : 4), dwSectorSize, sTrackName);
+				}
+			}
+		}
+
+		// Write the sheet out.
+		sFileName.Format("%s\\%s.%s", sOutputFolder, sName, (eFormat == CdiExportFormat::ExportBinCue ? "cue" : "gdi"));
+		IO::BlockDevice *pSheetFile = IO::OpenFileDevice(sFileName, IO::BlockDeviceAccess::CreateAlways);
+		if (pSheetFile == nullptr)
+		{
+			printf("CdiExporter::Export(): failed to create %s!\n", sFileName);
+			return false;
+		}
+
+		bool bResult = pSheetFile->WriteAt(0, sSheet.GetString(), sSheet.GetLength());
+		delete pSheetFile;
+		if (bResult == false)
+		{
+			printf("CdiExporter::Export(): failed to write %s!\n", sFileName);
+			return false;
+		}
+
+		return true;
+	}
+
+	ULONGLONG CdiExporter::BytesCopied()
+	{
+		return this->m_qwCopiedBytes;
+	}
+
+	ULONGLONG CdiExporter::BytesEncoded()
+	{
+		return this->m_qwEncodedBytes;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,109 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiExporter.h - Exports the tracks of a Disk Juggler image to BIN/CUE and
+		GDI layouts.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "CdiFileHandle.h"
+
+namespace DiskJuggler
+{
+	// Number of sectors re-encoded at a time when a track has to change sector size.
+	#define CDI_EXPORT_BATCH_SECTORS		256
+
+	/*
+		Layouts CdiExporter::Export() can write.
+	*/
+	enum CdiExportFormat : int
+	{
+		ExportBinCue,				// One .bin file per track and a .cue sheet, pregaps are kept as INDEX 00
+		ExportGdi					// One .bin/.raw file per track and a .gdi sheet
+	};
+
+	//-----------------------------------------------------
+	// CdiExporter
+	//-----------------------------------------------------
+	/*
+		Writes every track of an image to its own file in a sector size the target layout supports, along with the
+		sheet describing the disc. Tracks that keep the sector size they are stored with in the image are copied with
+		CdiFileHandle::CopyRawSectors() so the data doesn't pass through user space, only tracks that need a different
+		sector size are read and re-encoded.
+	*/
+	class CdiExporter
+	{
+	protected:
+		CdiFileHandle	*m_pCdiFile;		// Image to export
+		ULONGLONG		m_qwCopiedBytes;	// Number of bytes copied as they are stored in the image
+		ULONGLONG		m_qwEncodedBytes;	// Number of bytes written by re-encoding sectors
+
+		/*
+			Description: Gets the sector size a track is exported with and the track type to put in the cue sheet.
+
+			Returns: The sector size, or 0 if the track can't be exported.
+		*/
+		DWORD GetCueSectorSize(const CdiTrack *pTrack, LPCSTR *ppsTrackType);
+
+		/*
+			Description: Gets the sector size a track is exported with in the GDI layout.
+
+			Returns: The sector size, or 0 if the track can't be exported.
+		*/
+		DWORD GetGdiSectorSize(const CdiTrack *pTrack);
+
+		/*
+			Description: Converts sectors read with CdiFileHandle::ReadRawSectors() to a different sector size. The
+				subchannel is dropped from 2368/2448 byte sectors, the sync and header are generated for 2336 byte
+				sectors and 2048 byte sectors are rebuilt as raw sectors with their EDC/ECC.
+
+			Parameters:
+				pbSource: Sectors as they are stored in the image.
+				pTrack: Track the sectors belong to.
+				dwLBA: LBA of the first sector.
+				dwSectorCount: Number of sectors to convert.
+				pbOutput: Buffer that receives the converted sectors.
+				dwOutputSectorSize: Size of each converted sector.
+		*/
+		void EncodeSectors(const BYTE *pbSource, const CdiTrack *pTrack, DWORD dwLBA, DWORD dwSectorCount, PBYTE pbOutput, DWORD dwOutputSectorSize);
+
+		/*
+			Description: Writes a track to its own file.
+
+			Parameters:
+				dwSessionNumber, dwTrackNumber: Track to write, zero based.
+				sFileName: File to write the track to.
+				dwOutputSectorSize: Size of each sector in the file.
+				bIncludePregap: True if the pregap sectors should be written in front of the track.
+
+			Returns: True if the track was written, false otherwise.
+		*/
+		bool ExportTrack(DWORD dwSessionNumber, DWORD dwTrackNumber, CString sFileName, DWORD dwOutputSectorSize, bool bIncludePregap);
+
+	public:
+		CdiExporter(CdiFileHandle *pCdiFile);
+
+		/*
+			Description: Exports every track in the image and writes the sheet describing them.
+
+			Parameters:
+				sOutputFolder: Folder to write the files to, it must already exist.
+				sName: Base name of the sheet, and of the track files for BIN/CUE.
+				eFormat: Layout to write.
+
+			Returns: True if every track and the sheet were written, false otherwise.
+		*/
+		bool Export(CString sOutputFolder, CString sName, CdiExportFormat eFormat);
+
+		/*
+			Description: Gets the number of bytes copied as they are stored in the image and the number of bytes that
+				were re-encoded by the last call to Export().
+		*/
+		ULONGLONG BytesCopied();
+		ULONGLONG BytesEncoded();
+	};
+};
\ No newline at end of file
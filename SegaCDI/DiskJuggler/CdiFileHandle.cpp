@@ -1,599 +1,1988 @@
-/*
-	SegaCDI - Sega Dreamcast cdi image validator.
-
-	CdiFileHandle.cpp - File system reading and writing functions for
-	Disk Juggler images.
-
-	Dec 15th, 2015
-		- Initial creation.
-*/
-
-#include "../stdafx.h"
-#include "../Misc/Utilities.h"
-#include "CdiFileHandle.h"
-
-namespace DiskJuggler
-{
-	//-----------------------------------------------------
-	// CdiTrackHandle
-	//-----------------------------------------------------
-	DWORD CdiTrackHandle::LBA()
-	{
-		// Just return the lba from the track.
-		return this->pTrack->dwLba;
-	}
-
-	DWORD CdiTrackHandle::TrackSize()
-	{
-		// Compute the raw size of the track.
-		return this->pTrack->dwLength * RAW_SECTOR_SIZE;
-	}
-
-	bool CdiTrackHandle::ReadData(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSize)
-	{
-		// Check to see if the size is a multiple of RAW_SECTOR_SIZE.
-		if (dwSize % RAW_SECTOR_SIZE == 0)
-		{
-			// Delegate the functionality to the underlying CdiFileHandle.
-			return this->pFileHandle->ReadSectors(this->dwSessionNumber, this->dwTrackNumber, dwLBA + this->pTrack->dwLba, pbBuffer, dwSize / RAW_SECTOR_SIZE);
-		}
-		else
-		{
-			// Allocate a scratch buffer to store the data into.
-			DWORD dwReadSize = dwSize + (RAW_SECTOR_SIZE - (dwSize % RAW_SECTOR_SIZE));
-			BYTE *pbScratchBuffer = (PBYTE)VirtualAlloc(NULL, dwReadSize, MEM_COMMIT, PAGE_READWRITE);
-			if (pbScratchBuffer == NULL)
-			{
-				// Print an error and return false.
-				printf("CdiTrackHandle::ReadSectors(): failed to allocate scratch buffer!\n");
-				return false;
-			}
-
-			// Read the data from the track.
-			if (this->pFileHandle->ReadSectors(this->dwSessionNumber, this->dwTrackNumber, dwLBA + this->pTrack->dwLba,
-				pbScratchBuffer, dwReadSize / RAW_SECTOR_SIZE) == false)
-			{
-				// Failed to read the data, return false.
-				VirtualFree(pbScratchBuffer, dwReadSize, MEM_DECOMMIT);
-				return false;
-			}
-
-			// Copy the data to the output buffer.
-			memcpy(pbBuffer, pbScratchBuffer, dwSize);
-
-			// Free the scratch buffer and return true.
-			VirtualFree(pbScratchBuffer, dwReadSize, MEM_DECOMMIT);
-			return true;
-		}
-	}
-
-	bool CdiTrackHandle::WriteData(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSize)
-	{
-		// Delegate the functionality to the underlying CdiFileHandle.
-		return false;
-		//return this->pFileHandle->WriteSectors(this->dwSessionNumber, this->dwTrackNumber, dwLBA + this->pTrack->dwLba, pbBuffer, dwSectorCount);
-	}
-
-	//-----------------------------------------------------
-	// CdiFileHandle
-	//-----------------------------------------------------
-	CdiFileHandle::CdiFileHandle()
-	{
-		// Initialize fields.
-		this->m_hFile = INVALID_HANDLE_VALUE;
-		this->m_dwFileSize = 0;
-		this->m_dwCurrentLBA = -1;
-		this->m_wSessionCount = 0;
-		this->m_sSessions = nullptr;
-	}
-
-	CdiFileHandle::~CdiFileHandle()
-	{
-
-	}
-
-	bool CdiFileHandle::Open(CString sFileName, bool bWrite, bool bVerbose)
-	{
-		DWORD dwBytesRead = 0;
-
-		// Save the file name and open the cdi image file.
-		this->m_sFileName = sFileName;
-		this->m_hFile = CreateFile(this->m_sFileName, GENERIC_READ | (bWrite == true ? GENERIC_WRITE : 0), 0, 
-			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-		if (this->m_hFile == INVALID_HANDLE_VALUE)
-		{
-			// Print error and return.
-			printf("CdiFileHandle::Open: could not find file %s!\n", this->m_sFileName);
-			return false;
-		}
-
-		// Get the file size of the image and check it is valid.
-		this->m_dwFileSize = GetFileSize(this->m_hFile, NULL);
-		if (this->m_dwFileSize == 0)
-		{
-			// Print error, close the file, and return.
-			printf("CdiFileHandle::Open: image file %s has invalid size!", this->m_sFileName);
-			CloseHandle(this->m_hFile);
-			return false;
-		}
-
-		// Seek to the end of the file - 8 bytes to get the descriptor info block.
-		CdiSessionDescriptorInfo sDescriptorInfo;
-		SetFilePointer(this->m_hFile, -sizeof(CdiSessionDescriptorInfo), NULL, FILE_END);
-		if (ReadFile(this->m_hFile, &sDescriptorInfo, sizeof(CdiSessionDescriptorInfo), &dwBytesRead, NULL) == false ||
-			dwBytesRead != sizeof(CdiSessionDescriptorInfo))
-		{
-			// Failed to read the session descriptor.
-			printf("CdiFileHandle::Open(): failed to read session descriptor!\n");
-			CloseHandle(this->m_hFile);
-			return false;
-		}
-
-		// Verify the descriptor type.
-		if (sDescriptorInfo.eDescriptorType != CdiSessionDescriptorType::Type1 &&
-			sDescriptorInfo.eDescriptorType != CdiSessionDescriptorType::Type2 &&
-			sDescriptorInfo.eDescriptorType != CdiSessionDescriptorType::Type3)
-		{
-			// Print error, close the file, and return.
-			printf("CdiFileHandle::Open: invalid descriptor version %d!", sDescriptorInfo.eDescriptorType);
-			CloseHandle(this->m_hFile);
-			return false;
-		}
-
-		// Print the cdi version.
-		if (sDescriptorInfo.eDescriptorType == CdiSessionDescriptorType::Type1)
-			printf("found cdi version 2\n");
-		else if (sDescriptorInfo.eDescriptorType == CdiSessionDescriptorType::Type2)
-			printf("found cdi version 3\n");
-		else if (sDescriptorInfo.eDescriptorType == CdiSessionDescriptorType::Type3)
-			printf("found cdi version 3.5\n");
-
-		// Allocate a buffer for the session descriptor block.
-		DWORD dwSessionDescriptorSize = (sDescriptorInfo.eDescriptorType == CdiSessionDescriptorType::Type3 ?
-			sDescriptorInfo.dwDescriptorHelper : this->m_dwFileSize - sDescriptorInfo.dwDescriptorHelper);
-		BYTE *pbSessionDescriptor = new BYTE[dwSessionDescriptorSize];
-
-		// Read the session descriptor block from the image.
-		SetFilePointer(this->m_hFile, -(dwSessionDescriptorSize), NULL, FILE_END);
-		if (ReadFile(this->m_hFile, pbSessionDescriptor, dwSessionDescriptorSize, &dwBytesRead, NULL) == false ||
-			dwBytesRead != dwSessionDescriptorSize)
-		{
-			// Failed to read the session descriptor.
-			printf("CdiFileHandle::Open(): failed to read session descriptor data!\n");
-
-			// Clean up resources and return false.
-			CloseHandle(this->m_hFile);
-			delete[] pbSessionDescriptor;
-			return false;
-		}
-
-		// Parse the session descriptor block.
-		if (bVerbose == true) printf("found session descriptor of size %d\n", dwSessionDescriptorSize);
-		if (ParseSessionDescriptor(pbSessionDescriptor, dwSessionDescriptorSize, sDescriptorInfo.eDescriptorType, bVerbose) == false)
-		{
-			// There was an error reading the session descriptor, close the file and return.
-			CloseHandle(this->m_hFile);
-			delete[] pbSessionDescriptor;
-			return false;
-		}
-
-		// Delete temp buffer.
-		delete[] pbSessionDescriptor;
-
-		// Done, return true.
-		return true;
-	}
-
-	void CdiFileHandle::Close()
-	{
-
-	}
-
-	bool CdiFileHandle::ParseSessionDescriptor(PBYTE pbSessionDescriptor, DWORD dwDescriptorSize, CdiSessionDescriptorType eDescriptorType, bool bVerbose)
-	{
-		// Get the session count and create our session info array.
-		this->m_wSessionCount = CAST_TO_WORD(pbSessionDescriptor, 0);
-		this->m_sSessions = new CdiSession[this->m_wSessionCount];
-		printf("found %d sessions\n", this->m_wSessionCount);// + 1);
-		pbSessionDescriptor += 2;
-
-		// For now just loop through all of the sessions and parse each one.
-		for (int i = 0; i < this->m_wSessionCount; i++)
-		{
-			// Initialize the session structure.
-			this->m_sSessions[i] = CdiSession();
-
-			// Set the session number.
-			if (bVerbose == true) printf("\nsession %d:\n", i + 1);
-			this->m_sSessions[i].dwSessionNumber = i;
-
-			// The first word is the track count.
-			this->m_sSessions[i].wTrackCount = CAST_TO_WORD(pbSessionDescriptor, 0);
-			if (bVerbose == true) printf("\ttrack count: %d\n", this->m_sSessions[i].wTrackCount);
-			pbSessionDescriptor += 2;
-
-			// NOTE: 0 tracks means the session is open, we need to handle this.
-
-			// Create the track array.
-			this->m_sSessions[i].psTracks = new CdiTrack[this->m_sSessions[i].wTrackCount];
-
-			// Loop through all the tracks and read them from the descriptor.
-			for (int x = 0; x < this->m_sSessions[i].wTrackCount; x++)
-			{
-				// Initialize the track structure.
-				this->m_sSessions[i].psTracks[x] = CdiTrack();
-
-				// Set the track number.
-				if (bVerbose == true) printf("\n\ttrack %d\n", x + 1);
-				this->m_sSessions[i].psTracks[x].dwTrackNumber = x;
-
-				// Check for extra data we need to skip (DJ 3.00.780 and up).
-				if (CAST_TO_DWORD(pbSessionDescriptor, 0) != 0)
-					pbSessionDescriptor += 8;
-
-				// The next 20 bytes appear to be constant, I think they are some sort of track start marker (CDIRip src).
-				BYTE pbStatic1[20] = { 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xFF,
-					0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF };
-				if (memcmp(&pbSessionDescriptor[4], pbStatic1, 20) != 0)
-				{
-					// For now print a warning and break execution.
-					printf("CdiFileHandle::ParseSessionDescriptor(): session descriptor static field 1 (track start marker) mismatch!\n");
-					DebugBreak();
-				}
-
-				// I really have no idea what the next 4 bytes are, the information at hand is rudimentary at best.
-				BYTE pbUnknown1[4] = { pbSessionDescriptor[24], pbSessionDescriptor[25], pbSessionDescriptor[26], pbSessionDescriptor[27] };
-				if (bVerbose == true) printf("\t\tunknown bytes 1: %x %x %x %x\n", pbUnknown1[0], pbUnknown1[1], pbUnknown1[2], pbUnknown1[3]);
-
-				// Next we have the file name of this session.
-				this->m_sSessions[i].psTracks[x].bFileNameLength = CAST_TO_BYTE(pbSessionDescriptor, 28);
-				this->m_sSessions[i].psTracks[x].psFileName = new CHAR[this->m_sSessions[i].psTracks[x].bFileNameLength + 1];
-				memcpy(this->m_sSessions[i].psTracks[x].psFileName, &pbSessionDescriptor[29], this->m_sSessions[i].psTracks[x].bFileNameLength);
-
-				// Put a null terminating character at the end of the file name.
-				this->m_sSessions[i].psTracks[x].psFileName[this->m_sSessions[i].psTracks[x].bFileNameLength] = 0;
-				pbSessionDescriptor += 29 + this->m_sSessions[i].psTracks[x].bFileNameLength;
-				if (bVerbose == true) printf("\t\tfile name: %s\n", this->m_sSessions[i].psTracks[x].psFileName);
-
-				// Check some value that only appears in DiscJuggler 4, but changes the session descriptor structure.
-				pbSessionDescriptor += 19;
-				if (CAST_TO_DWORD(pbSessionDescriptor, 0) == 0x80000000)
-				{
-					// Skip the next 8 bytes.
-					pbSessionDescriptor += 8;
-				}
-
-				// Read the pregap length, and other length value.
-				this->m_sSessions[i].psTracks[x].dwPregapLength = CAST_TO_DWORD(pbSessionDescriptor, 6);
-				this->m_sSessions[i].psTracks[x].dwLength = CAST_TO_DWORD(pbSessionDescriptor, 10);
-				if (bVerbose == true)
-				{
-					printf("\t\tpregap length: %d\n", this->m_sSessions[i].psTracks[x].dwPregapLength);
-					printf("\t\tlength: %d\n", this->m_sSessions[i].psTracks[x].dwLength);
-				}
-
-				// Read the session mode.
-				this->m_sSessions[i].psTracks[x].eMode = (CdiTrackMode)CAST_TO_DWORD(pbSessionDescriptor, 20);
-				if (bVerbose == true)
-				{
-					printf("\t\tmode: ");
-					switch (this->m_sSessions[i].psTracks[x].eMode)
-					{
-					case CdiTrackMode::Audio:	printf("Audio\n");	break;
-					case CdiTrackMode::Mode1:	printf("Mode1\n");	break;
-					case CdiTrackMode::Mode2:	printf("Mode2\n");	break;
-					default:					printf("Unknown\n");	break;
-					}
-				}
-
-				// Check the track mode is valid.
-				if (this->m_sSessions[i].psTracks[x].eMode > CdiTrackMode::Mode2)
-				{
-					// Print error and return.
-					printf("CdiFileHandle::ParseSessionDescriptor(): invalid/unsupported track mode %d!\n", this->m_sSessions[i].psTracks[x].eMode);
-					return false;
-				}
-
-				// Read the lba and total length.
-				this->m_sSessions[i].psTracks[x].dwLba = CAST_TO_DWORD(pbSessionDescriptor, 36);
-				this->m_sSessions[i].psTracks[x].dwTotalLength = CAST_TO_DWORD(pbSessionDescriptor, 40);
-				if (bVerbose == true)
-				{
-					printf("\t\tlba: %d\n", this->m_sSessions[i].psTracks[x].dwLba);
-					printf("\t\ttotal length: %d\n", this->m_sSessions[i].psTracks[x].dwTotalLength);
-				}
-
-				// Read the sector size value.
-				this->m_sSessions[i].psTracks[x].eSectorType = (CdiSectorType)CAST_TO_DWORD(pbSessionDescriptor, 60);
-				switch (this->m_sSessions[i].psTracks[x].eSectorType)
-				{
-				case CdiSectorType::Type_2048:	this->m_sSessions[i].psTracks[x].eSectorSize = CdiSectorSize::Size_2048;	break;
-				case CdiSectorType::Type_2336:	this->m_sSessions[i].psTracks[x].eSectorSize = CdiSectorSize::Size_2336;	break;
-				case CdiSectorType::Type_2352:	this->m_sSessions[i].psTracks[x].eSectorSize = CdiSectorSize::Size_2352;	break;
-				case CdiSectorType::Type_2368:	this->m_sSessions[i].psTracks[x].eSectorSize = CdiSectorSize::Size_2368;	break;
-				case CdiSectorType::Type_2448:	this->m_sSessions[i].psTracks[x].eSectorSize = CdiSectorSize::Size_2448;	break;
-				default:						this->m_sSessions[i].psTracks[x].eSectorSize = (CdiSectorSize)0;			break;
-				}
-
-				// Check that the sector size is valid.
-				if (bVerbose == true) printf("\t\tsector size: %d\n", this->m_sSessions[i].psTracks[x].eSectorSize);
-				if (this->m_sSessions[i].psTracks[x].eSectorSize == 0)
-				{
-					// Print error and return.
-					printf("CdiFileHandle::ParseSessionDescriptor(): invalid/unsupported sector size %d!\n", this->m_sSessions[i].psTracks[x].eSectorSize);
-					return false;
-				}
-
-				// Next session.
-				pbSessionDescriptor += 93;
-
-				// If the image format isn't type 1 we need to check for extra data to skip over.
-				if (eDescriptorType != CdiSessionDescriptorType::Type1)
-				{
-					// Read some dword and see if there is extra data we need to skip.
-					if (CAST_TO_DWORD(pbSessionDescriptor, 5) == 0xFFFFFFFF)
-						pbSessionDescriptor += 78; // (DJ 3.00.780 and up)
-
-					// Skip the data we just read.
-					pbSessionDescriptor += 9;
-				}
-				else
-					DebugBreak();
-			}
-
-			// NOTE: There are 12 bytes unaccounted for.
-			pbSessionDescriptor += 12;
-
-			// Next session.
-			if (eDescriptorType != CdiSessionDescriptorType::Type1)
-				pbSessionDescriptor += 1;
-		}
-
-		// Create an initialize our shadow collection if the CdiSession objects.
-		this->m_pSessionCollection = new DisjointCollection<CdiSession>(this->m_sSessions, this->m_wSessionCount);
-
-		// Everything seems to check out.
-		printf("\n");
-		return true;
-	}
-
-	bool CdiFileHandle::ReadSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount)
-	{
-		DWORD dwBytesRead = 0;
-
-		// Check that the session number and track number are valid.
-		if (dwSessionNumber >= this->m_wSessionCount || dwTrackNumber >= this->m_sSessions[dwSessionNumber].wTrackCount)
-			return false;
-
-		// Check to make sure the data to be read wont go beyond the end of the track.
-		if (dwSectorCount > this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber].dwLength)
-		{
-			// Print an error and return.
-			printf("CdiFileHandle::ReadSectors(): read operation would go beyond the length of the track!\n");
-			return false;
-		}
-
-		// Pull out the track struct for easy access.
-		CdiTrack *pTargetTrack = &this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber];
-
-		// Check to see if we are already at the target LBA or if we need to seek.
-		if (dwLBA != this->m_dwCurrentLBA)
-		{
-			// Set the new current LBA.
-			this->m_dwCurrentLBA = dwLBA;
-
-			// Loop through all of the sessions until we get to the one we want.
-			DWORD dwTargetOffset = 0;
-			for (int i = 0; i <= dwSessionNumber; i++)
-			{
-				// Loop through all of the tracks until we get to the one we want.
-				WORD wTrackCount = (i == dwSessionNumber ? dwTrackNumber : this->m_sSessions[i].wTrackCount);
-				for (int x = 0; x < wTrackCount; x++)
-				{
-					// Skip over this track.
-					dwTargetOffset += this->m_sSessions[i].psTracks[x].dwTotalLength * this->m_sSessions[i].psTracks[x].eSectorSize;
-				}
-			}
-
-			// Skip the pregap section of the track.
-			dwTargetOffset += pTargetTrack->dwPregapLength * pTargetTrack->eSectorSize;
-
-			// Seek to the target LBA.
-			dwTargetOffset += pTargetTrack->eSectorSize * (dwLBA - pTargetTrack->dwLba);
-			SetFilePointer(this->m_hFile, dwTargetOffset, NULL, FILE_BEGIN);
-		}
-
-		// We need to know the header size of the track in order to read data from it.
-		DWORD dwHeaderSize = 0;
-		if (pTargetTrack->eMode == CdiTrackMode::Mode2)
-		{
-			// Check the sector size to determin the header size.
-			if (pTargetTrack->eSectorSize == CdiSectorSize::Size_2352)
-				dwHeaderSize = 24;
-			else if (pTargetTrack->eSectorSize == CdiSectorSize::Size_2336)
-				dwHeaderSize = 8;
-		}
-		else
-		{
-			// Check the sector size to determin the header size.
-			if (pTargetTrack->eSectorSize == CdiSectorSize::Size_2352)
-				dwHeaderSize = 16;
-		}
-
-		// Allocate a working buffer for the read operation.
-		BYTE *pbTempBuffer = new BYTE[pTargetTrack->eSectorSize];
-
-		// Loop through all of the requested sectors.
-		for (int i = 0; i < dwSectorCount; i++)
-		{
-			// Read a raw sector from the image file.
-			if (ReadFile(this->m_hFile, pbTempBuffer, pTargetTrack->eSectorSize, &dwBytesRead, NULL) == false ||
-				dwBytesRead != pTargetTrack->eSectorSize)
-			{
-				// Failed to read the sector from the image file.
-				printf("CdiFileHandle::ReadSectors(): failed to read sector! LBA=%d, Sector=%d, Size=%d!\n", 
-					dwLBA, i, pTargetTrack->eSectorSize);
-
-				// Free the temporary working buffer.
-				delete[] pbTempBuffer;
-				return false;
-			}
-
-			// Check if the track is an audio track or data track.
-			if (pTargetTrack->eMode == CdiTrackMode::Audio)
-			{
-				// Copy the whole raw sector to the output buffer.
-				memcpy(&pbBuffer[i * pTargetTrack->eSectorSize], pbTempBuffer, pTargetTrack->eSectorSize);
-			}
-			else
-			{
-				// Copy the real sector to the output buffer.
-				memcpy(&pbBuffer[i * RAW_SECTOR_SIZE], &pbTempBuffer[dwHeaderSize], RAW_SECTOR_SIZE);
-			}
-
-			// Increment the current LBA.
-			this->m_dwCurrentLBA++;
-		}
-
-		// Free the temporary working buffer.
-		delete[] pbTempBuffer;
-
-		// Done, successfully read the data.
-		return true;
-	}
-
-	bool CdiFileHandle::WriteSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount)
-	{
-		DWORD dwBytesWritten = 0;
-
-		// Check that the session number and track number are valid.
-		if (dwSessionNumber >= this->m_wSessionCount || dwTrackNumber >= this->m_sSessions[dwSessionNumber].wTrackCount)
-			return false;
-
-		// Check to make sure the data to be written wont go beyond the end of the track.
-		if (dwSectorCount > this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber].dwLength)
-		{
-			// Print an error and return.
-			printf("CdiFileHandle::WriteSectors(): write operation would go beyond the length of the track!\n");
-			return false;
-		}
-
-		// Pull out the track struct for easy access.
-		CdiTrack *pTargetTrack = &this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber];
-
-		// Check to see if we are already at the target LBA or if we need to seek.
-		if (dwLBA != this->m_dwCurrentLBA)
-		{
-			// Set the new current LBA.
-			this->m_dwCurrentLBA = dwLBA;
-
-			// Loop through all of the sessions until we get to the one we want.
-			DWORD dwTargetOffset = 0;
-			for (int i = 0; i <= dwSessionNumber; i++)
-			{
-				// Loop through all of the tracks until we get to the one we want.
-				WORD wTrackCount = (i == dwSessionNumber ? dwTrackNumber : this->m_sSessions[i].wTrackCount);
-				for (int x = 0; x < wTrackCount; x++)
-				{
-					// Skip over this track.
-					dwTargetOffset += this->m_sSessions[i].psTracks[x].dwTotalLength * this->m_sSessions[i].psTracks[x].eSectorSize;
-				}
-			}
-
-			// Skip the pregap section of the track.
-			dwTargetOffset += pTargetTrack->dwPregapLength * pTargetTrack->eSectorSize;
-
-			// Seek to the target LBA.
-			dwTargetOffset += pTargetTrack->eSectorSize * (dwLBA - pTargetTrack->dwLba);
-			SetFilePointer(this->m_hFile, dwTargetOffset, NULL, FILE_BEGIN);
-		}
-
-		// We need to know the header size of the track in order to write data to it.
-		DWORD dwHeaderSize = 0;
-		if (pTargetTrack->eMode == CdiTrackMode::Mode2)
-		{
-			// Check the sector size to determin the header size.
-			if (pTargetTrack->eSectorSize == CdiSectorSize::Size_2352)
-				dwHeaderSize = 24;
-			else if (pTargetTrack->eSectorSize == CdiSectorSize::Size_2336)
-				dwHeaderSize = 8;
-		}
-		else
-		{
-			// Check the sector size to determin the header size.
-			if (pTargetTrack->eSectorSize == CdiSectorSize::Size_2352)
-				dwHeaderSize = 16;
-		}
-
-		// Compute the sector size we will be writing in.
-		DWORD dwSectorSize = (pTargetTrack->eMode == CdiTrackMode::Audio ? pTargetTrack->eSectorSize : RAW_SECTOR_SIZE);
-
-		// Loop through all of the sectors and write each one.
-		for (int i = 0; i < dwSectorCount; i++)
-		{
-			// If the track is not an Audio track skip the header.
-			if (pTargetTrack->eMode != CdiTrackMode::Audio)
-			{
-				// Skip the sector header.
-				SetFilePointer(this->m_hFile, dwHeaderSize, NULL, FILE_CURRENT);
-			}
-
-			// Write the raw sector to the image.
-			if (WriteFile(this->m_hFile, &pbBuffer[i * dwSectorSize], dwSectorSize, &dwBytesWritten, NULL) == false ||
-				dwBytesWritten != dwSectorSize)
-			{
-				// Failed to write the sector to the file.
-				printf("CdiFileHandle::WriteSectors(): failed to write sector! LBA=%d, Sector=%d, Size=%d!\n",
-					dwLBA, i, pTargetTrack->eSectorSize);
-				return false;
-			}
-
-			// Increment the current LBA.
-			this->m_dwCurrentLBA++;
-		}
-
-		// Done, successfully wrote the sectors to file.
-		return true;
-	}
-
-	DisjointCollection<CdiSession>& CdiFileHandle::GetSessionsCollection()
-	{
-		// Return our shadow collection of CdiSession objects.
-		return *this->m_pSessionCollection;
-	}
-
-	CdiTrackHandle *CdiFileHandle::OpenTrackHandle(DWORD dwSessionNumber, DWORD dwTrackNumber)
-	{
-		// Check that the session number is valid.
-		if (dwSessionNumber < 0 || dwSessionNumber >= this->m_wSessionCount)
-		{
-			// The session number is invalid, print an error and return.
-			printf("CdiFileHandle::OpenTrackHandle(): session number specified is invalid!\n");
-			return nullptr;
-		}
-
-		// Check that the track number is valid.
-		if (dwTrackNumber < 0 || dwTrackNumber >= this->m_sSessions[dwSessionNumber].wTrackCount)
-		{
-			// The track number is invalid, print an error and return.
-			printf("CdiFileHandle::OpenTrackHandle(): track number specified is invalid!\n");
-			return nullptr;
-		}
-
-		// Create a new track handle and initialize it to the track specified.
-		CdiTrackHandle *pTrackHandle = new CdiTrackHandle();
-		pTrackHandle->dwSessionNumber = dwSessionNumber;
-		pTrackHandle->dwTrackNumber = dwTrackNumber;
-		pTrackHandle->pFileHandle = this;
-		pTrackHandle->pTrack = &this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber];
-
-		// Return the track handle.
-		return pTrackHandle;
-	}
-
-	void CdiFileHandle::CloseTrackHandle(CdiTrackHandle *pTrackHandle)
-	{
-		// Free the handle allocation.
-		delete pTrackHandle;
-	}
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiFileHandle.cpp - File system reading and writing functions for
+	Disk Juggler images.
+
+	Dec 15th, 2015
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "../Misc/Utilities.h"
+#include "CdiFileHandle.h"
+#include "CdiEdcEcc.h"
+#include "CdiSubchannel.h"
+#include "CdiSidecarIndex.h"
+#include "CdiCompressedImage.h"
+#include "CdiChunkStore.h"
+#include <algorithm>
+
+namespace DiskJuggler
+{
+	LPCSTR DescriptorErrorToString(CdiDescriptorError eError)
+	{
+		switch (eError)
+		{
+		case CdiDescriptorError::DescriptorOk:					return "ok";
+		case CdiDescriptorError::DescriptorReadFailed:			return "failed to read session descriptor";
+		case CdiDescriptorError::DescriptorInvalidVersion:		return "invalid descriptor version";
+		case CdiDescriptorError::DescriptorInvalidSize:			return "session descriptor has invalid size";
+		case CdiDescriptorError::DescriptorTruncated:			return "session descriptor is truncated";
+		case CdiDescriptorError::DescriptorMarkerMismatch:		return "track start marker mismatch";
+		case CdiDescriptorError::DescriptorInvalidTrackMode:	return "invalid/unsupported track mode";
+		case CdiDescriptorError::DescriptorInvalidSectorSize:	return "invalid/unsupported sector size";
+		case CdiDescriptorError::DescriptorTrackOutOfBounds:	return "track lies outside of the image file";
+		case CdiDescriptorError::DescriptorOutOfMemory:			return "out of memory";
+		default:												return "unknown error";
+		}
+	}
+
+	/*
+		Description: Checks that dwSize bytes starting at dwOffset are inside of a session descriptor of dwDescriptorSize
+			bytes, without overflowing.
+	*/
+	static inline bool DescriptorHasData(DWORD dwOffset, DWORD dwSize, DWORD dwDescriptorSize)
+	{
+		return dwOffset <= dwDescriptorSize && dwSize <= dwDescriptorSize - dwOffset;
+	}
+
+	//-----------------------------------------------------
+	// CdiTrackHandle
+	//-----------------------------------------------------
+	DWORD CdiTrackHandle::LBA()
+	{
+		// Just return the lba from the track.
+		return this->pTrack->dwLba;
+	}
+
+	ULONGLONG CdiTrackHandle::TrackSize()
+	{
+		// Compute the size of the track stream.
+		return (ULONGLONG)this->pTrack->dwLength * SectorDataSize();
+	}
+
+	const CdiTrackOffsetInfo *CdiTrackHandle::OffsetInfo()
+	{
+		// Return the offset table entry for the track.
+		return this->pOffsetInfo;
+	}
+
+	ULONGLONG CdiTrackHandle::SectorOffset(DWORD dwLBA)
+	{
+		// Compute the offset of the sector using the start of the track and the sector stride.
+		return this->pOffsetInfo->qwDataOffset + ((ULONGLONG)dwLBA * this->pOffsetInfo->dwSectorStride);
+	}
+
+	DWORD CdiTrackHandle::SectorDataSize()
+	{
+		// Audio sectors are returned whole, data sectors only hold their user data.
+		return (this->pTrack->eMode == CdiTrackMode::Audio ? this->pOffsetInfo->dwSectorStride : RAW_SECTOR_SIZE);
+	}
+
+	bool CdiTrackHandle::ReadBytes(ULONGLONG qwOffset, PBYTE pbBuffer, DWORD dwSize)
+	{
+		// Check to make sure the data to be read wont go beyond the end of the track.
+		DWORD dwSectorSize = SectorDataSize();
+		if (qwOffset + dwSize > (ULONGLONG)this->pTrack->dwLength * dwSectorSize)
+		{
+			// Print an error and return.
+			printf("CdiTrackHandle::ReadBytes(): read operation would go beyond the length of the track!\n");
+			return false;
+		}
+
+		// Split the offset into the sector it falls in and the offset inside of that sector.
+		DWORD dwLBA = (DWORD)(qwOffset / dwSectorSize);
+		DWORD dwSectorOffset = (DWORD)(qwOffset % dwSectorSize);
+
+		// If the data starts part way into a sector, or is smaller than a sector, read it into the scratch sector.
+		if (dwSize > 0 && (dwSectorOffset != 0 || dwSize < dwSectorSize))
+		{
+			if (ReadTrackSectors(dwLBA, this->bScratchSector, 1) == false)
+				return false;
+
+			// Copy out the part of the sector that was asked for.
+			DWORD dwCopySize = (dwSize < dwSectorSize - dwSectorOffset ? dwSize : dwSectorSize - dwSectorOffset);
+			memcpy(pbBuffer, &this->bScratchSector[dwSectorOffset], dwCopySize);
+			pbBuffer += dwCopySize;
+			dwSize -= dwCopySize;
+			dwLBA++;
+		}
+
+		// Read all of the whole sectors straight into the output buffer.
+		DWORD dwSectorCount = dwSize / dwSectorSize;
+		if (dwSectorCount > 0)
+		{
+			if (ReadTrackSectors(dwLBA, pbBuffer, dwSectorCount) == false)
+				return false;
+
+			pbBuffer += dwSectorCount * dwSectorSize;
+			dwSize -= dwSectorCount * dwSectorSize;
+			dwLBA += dwSectorCount;
+		}
+
+		// Read the partial sector at the end of the data into the scratch sector.
+		if (dwSize > 0)
+		{
+			if (ReadTrackSectors(dwLBA, this->bScratchSector, 1) == false)
+				return false;
+
+			memcpy(pbBuffer, this->bScratchSector, dwSize);
+		}
+
+		// Successfully read the data.
+		return true;
+	}
+
+	bool CdiTrackHandle::WriteBytes(ULONGLONG qwOffset, PBYTE pbBuffer, DWORD dwSize)
+	{
+		// Check to make sure the data to be written wont go beyond the end of the track.
+		DWORD dwSectorSize = SectorDataSize();
+		if (qwOffset + dwSize > (ULONGLONG)this->pTrack->dwLength * dwSectorSize)
+		{
+			// Print an error and return.
+			printf("CdiTrackHandle::WriteBytes(): write operation would go beyond the length of the track!\n");
+			return false;
+		}
+
+		// Split the offset into the sector it falls in and the offset inside of that sector.
+		DWORD dwLBA = (DWORD)(qwOffset / dwSectorSize);
+		DWORD dwSectorOffset = (DWORD)(qwOffset % dwSectorSize);
+		bool bResult = true;
+
+		// If the data starts part way into a sector, or is smaller than a sector, patch it into the existing sector.
+		// The sector is read from the file handle, the read ahead engine may be holding an older copy of it.
+		if (dwSize > 0 && (dwSectorOffset != 0 || dwSize < dwSectorSize))
+		{
+			DWORD dwCopySize = (dwSize < dwSectorSize - dwSectorOffset ? dwSize : dwSectorSize - dwSectorOffset);
+			if (this->pFileHandle->ReadSectors(this->dwSessionNumber, this->dwTrackNumber, dwLBA + this->pTrack->dwLba, this->bScratchSector, 1) == false)
+				return false;
+
+			memcpy(&this->bScratchSector[dwSectorOffset], pbBuffer, dwCopySize);
+			bResult = this->pFileHandle->WriteSectors(this->dwSessionNumber, this->dwTrackNumber, dwLBA + this->pTrack->dwLba, this->bScratchSector, 1);
+
+			pbBuffer += dwCopySize;
+			dwSize -= dwCopySize;
+			dwLBA++;
+		}
+
+		// Write all of the whole sectors straight from the input buffer.
+		DWORD dwSectorCount = dwSize / dwSectorSize;
+		if (bResult == true && dwSectorCount > 0)
+		{
+			bResult = this->pFileHandle->WriteSectors(this->dwSessionNumber, this->dwTrackNumber, dwLBA + this->pTrack->dwLba, pbBuffer, dwSectorCount);
+
+			pbBuffer += dwSectorCount * dwSectorSize;
+			dwSize -= dwSectorCount * dwSectorSize;
+			dwLBA += dwSectorCount;
+		}
+
+		// Patch the partial sector at the end of the data into the existing sector.
+		if (bResult == true && dwSize > 0)
+		{
+			bResult = this->pFileHandle->ReadSectors(this->dwSessionNumber, this->dwTrackNumber, dwLBA + this->pTrack->dwLba, this->bScratchSector, 1);
+			if (bResult == true)
+			{
+				memcpy(this->bScratchSector, pbBuffer, dwSize);
+				bResult = this->pFileHandle->WriteSectors(this->dwSessionNumber, this->dwTrackNumber, dwLBA + this->pTrack->dwLba, this->bScratchSector, 1);
+			}
+		}
+
+		// Anything the read ahead engine already read may be stale now, restart it.
+		if (this->pReadAhead != nullptr)
+			EnableReadAhead(this->dwReadAheadChunkSectors, this->dwReadAheadChunkCount);
+
+		return bResult;
+	}
+
+	bool CdiTrackHandle::ReadData(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSize)
+	{
+		// Read the data at the start of the sector.
+		return ReadBytes((ULONGLONG)dwLBA * SectorDataSize(), pbBuffer, dwSize);
+	}
+
+	bool CdiTrackHandle::ReadVector(CdiReadSegment *psSegments, DWORD dwSegmentCount)
+	{
+		DWORD dwSectorSize = SectorDataSize();
+		bool bResult = true;
+
+		// Fail any segment that goes beyond the end of the track up front, so it can't be merged into a run that
+		// reads into the next track. Sort the rest by LBA without moving them around in the caller's array.
+		std::vector<DWORD> vOrder;
+		vOrder.reserve(dwSegmentCount);
+		for (DWORD i = 0; i < dwSegmentCount; i++)
+		{
+			psSegments[i].bSuccess = false;
+			if ((ULONGLONG)psSegments[i].dwLBA * dwSectorSize + psSegments[i].dwSize > (ULONGLONG)this->pTrack->dwLength * dwSectorSize)
+			{
+				// Print an error and skip the segment.
+				printf("CdiTrackHandle::ReadVector(): segment at LBA %d would go beyond the length of the track!\n", psSegments[i].dwLBA);
+				bResult = false;
+				continue;
+			}
+
+			vOrder.push_back(i);
+		}
+		std::sort(vOrder.begin(), vOrder.end(), [psSegments](DWORD a, DWORD b) { return psSegments[a].dwLBA < psSegments[b].dwLBA; });
+
+		// Loop through the sorted segments and merge runs of them into single reads.
+		DWORD dwOrderCount = (DWORD)vOrder.size();
+		DWORD dwIndex = 0;
+		while (dwIndex < dwOrderCount)
+		{
+			// Start a run with the next segment and pull in every segment that starts within the gap limit of the end
+			// of the run, as long as the run still fits in the vector buffer.
+			CdiReadSegment *pFirst = &psSegments[vOrder[dwIndex]];
+			DWORD dwRunStart = pFirst->dwLBA;
+			ULONGLONG qwRunEnd = dwRunStart + ((ULONGLONG)pFirst->dwSize + dwSectorSize - 1) / dwSectorSize;
+			DWORD dwRunCount = 1;
+			while (dwIndex + dwRunCount < dwOrderCount && qwRunEnd - dwRunStart <= CDI_VECTOR_READ_MAX_SECTORS)
+			{
+				CdiReadSegment *pNext = &psSegments[vOrder[dwIndex + dwRunCount]];
+				ULONGLONG qwNextEnd = pNext->dwLBA + ((ULONGLONG)pNext->dwSize + dwSectorSize - 1) / dwSectorSize;
+				if (pNext->dwLBA > qwRunEnd + CDI_VECTOR_READ_MAX_GAP || (qwNextEnd > qwRunEnd ? qwNextEnd : qwRunEnd) - dwRunStart > CDI_VECTOR_READ_MAX_SECTORS)
+					break;
+
+				if (qwNextEnd > qwRunEnd)
+					qwRunEnd = qwNextEnd;
+				dwRunCount++;
+			}
+
+			// A segment on its own is read straight into its buffer.
+			if (dwRunCount == 1)
+			{
+				pFirst->bSuccess = ReadBytes((ULONGLONG)pFirst->dwLBA * dwSectorSize, pFirst->pbBuffer, pFirst->dwSize);
+				if (pFirst->bSuccess == false)
+					bResult = false;
+				dwIndex++;
+				continue;
+			}
+
+			// Allocate the vector buffer on first use.
+			if (this->pbVectorBuffer == nullptr)
+				this->pbVectorBuffer = (PBYTE)AlignedAlloc(CDI_VECTOR_READ_MAX_SECTORS * CdiSectorSize::Size_2448);
+
+			// Read the whole run in one go and copy each segment out of it.
+			DWORD dwRunSectors = (DWORD)(qwRunEnd - dwRunStart);
+			if (this->pbVectorBuffer != nullptr &&
+				this->pFileHandle->ReadSectors(this->dwSessionNumber, this->dwTrackNumber, dwRunStart + this->pTrack->dwLba, this->pbVectorBuffer, dwRunSectors) == true)
+			{
+				for (DWORD i = 0; i < dwRunCount; i++)
+				{
+					CdiReadSegment *pSegment = &psSegments[vOrder[dwIndex + i]];
+					memcpy(pSegment->pbBuffer, &this->pbVectorBuffer[(SIZE_T)(pSegment->dwLBA - dwRunStart) * dwSectorSize], pSegment->dwSize);
+					pSegment->bSuccess = true;
+				}
+			}
+			else
+			{
+				// The run could not be read, fall back to reading each segment on its own so only the segments that
+				// are actually bad fail.
+				for (DWORD i = 0; i < dwRunCount; i++)
+				{
+					CdiReadSegment *pSegment = &psSegments[vOrder[dwIndex + i]];
+					pSegment->bSuccess = ReadBytes((ULONGLONG)pSegment->dwLBA * dwSectorSize, pSegment->pbBuffer, pSegment->dwSize);
+					if (pSegment->bSuccess == false)
+						bResult = false;
+				}
+			}
+
+			// Next run.
+			dwIndex += dwRunCount;
+		}
+
+		return bResult;
+	}
+
+	void CdiTrackHandle::Seek(DWORD dwLBA)
+	{
+		// Move the read cursor.
+		this->dwCursorLBA = dwLBA;
+	}
+
+	DWORD CdiTrackHandle::Tell()
+	{
+		// Return the read cursor.
+		return this->dwCursorLBA;
+	}
+
+	bool CdiTrackHandle::ReadNext(PBYTE pbBuffer, DWORD dwSectorCount)
+	{
+		// Read the sectors at the cursor.
+		if (ReadTrackSectors(this->dwCursorLBA, pbBuffer, dwSectorCount) == false)
+			return false;
+
+		// Advance the cursor past the sectors we read.
+		this->dwCursorLBA += dwSectorCount;
+		return true;
+	}
+
+	bool CdiTrackHandle::ReadTrackSectors(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount)
+	{
+		// Check if read ahead is enabled.
+		if (this->pReadAhead != nullptr)
+		{
+			// Track how many reads in a row have picked up where the last one left off.
+			if (dwLBA == this->dwLastReadEndLBA)
+				this->dwSequentialReads++;
+			else
+				this->dwSequentialReads = 0;
+			this->dwLastReadEndLBA = dwLBA + dwSectorCount;
+
+			// If the engine is already reading ahead from here or the access pattern looks sequential read through the engine.
+			if (this->pReadAhead->IsActive(dwLBA) == true || this->dwSequentialReads >= CDI_READ_AHEAD_SEQUENTIAL_THRESHOLD)
+				return this->pReadAhead->Read(dwLBA, pbBuffer, dwSectorCount);
+		}
+
+		// Delegate the functionality to the underlying CdiFileHandle.
+		return this->pFileHandle->ReadSectors(this->dwSessionNumber, this->dwTrackNumber, dwLBA + this->pTrack->dwLba, pbBuffer, dwSectorCount);
+	}
+
+	void CdiTrackHandle::EnableReadAhead(DWORD dwChunkSectors, DWORD dwChunkCount)
+	{
+		// Replace any existing read ahead engine with one using the new settings.
+		DisableReadAhead();
+		this->pReadAhead = new CdiReadAhead(this->pFileHandle, this->dwSessionNumber, this->dwTrackNumber, dwChunkSectors, dwChunkCount);
+		this->dwReadAheadChunkSectors = dwChunkSectors;
+		this->dwReadAheadChunkCount = dwChunkCount;
+		this->dwLastReadEndLBA = 0xFFFFFFFF;
+		this->dwSequentialReads = 0;
+	}
+
+	void CdiTrackHandle::DisableReadAhead()
+	{
+		// Stop and free the read ahead engine.
+		if (this->pReadAhead != nullptr)
+		{
+			delete this->pReadAhead;
+			this->pReadAhead = nullptr;
+		}
+	}
+
+	bool CdiTrackHandle::ReadDataView(DWORD dwLBA, DWORD dwSectorCount, CdiSectorView *pView)
+	{
+		// Delegate the functionality to the underlying CdiFileHandle.
+		return this->pFileHandle->ReadSectorsView(this->dwSessionNumber, this->dwTrackNumber, dwLBA + this->pTrack->dwLba, dwSectorCount, pView);
+	}
+
+	bool CdiTrackHandle::WriteData(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSize)
+	{
+		// Write the data at the start of the sector.
+		return WriteBytes((ULONGLONG)dwLBA * SectorDataSize(), pbBuffer, dwSize);
+	}
+
+	//-----------------------------------------------------
+	// CdiFileHandle
+	//-----------------------------------------------------
+	CdiFileHandle::CdiFileHandle()
+	{
+		// Initialize fields.
+		this->m_pDevice = nullptr;
+		this->m_qwFileSize = 0;
+		this->m_pbMappedImage = nullptr;
+		this->m_wSessionCount = 0;
+		this->m_sSessions = nullptr;
+		this->m_pbMetadata = nullptr;
+		this->m_sDescriptorStatus = { CdiDescriptorError::DescriptorOk, 0, 0, 0 };
+		this->m_psTrackOffsets = nullptr;
+		this->m_pdwSessionTrackIndex = nullptr;
+		this->m_dwReadChunkSectors = CDI_DEFAULT_READ_CHUNK_SECTORS;
+		this->m_dwStagingBufferSize = this->m_dwReadChunkSectors * CdiSectorSize::Size_2448;
+		this->m_pReadQueue = nullptr;
+		this->m_dwReadQueueDepth = ASYNC_READ_QUEUE_DEFAULT_DEPTH;
+		this->m_bReapingReads = false;
+		this->m_dwRegenerationFlags = RegenerateEdcEcc;
+		this->m_bUseIndex = false;
+		this->m_pIndex = nullptr;
+	}
+
+	CdiFileHandle::~CdiFileHandle()
+	{
+		// Close the image file.
+		Close();
+
+		// Free the staging buffers.
+		FreeStagingBuffers();
+	}
+
+	bool CdiFileHandle::Open(CString sFileName, bool bWrite, bool bVerbose, bool bMemoryMap)
+	{
+		// Save the file name and open the cdi image file.
+		this->m_sFileName = sFileName;
+		this->m_sDescriptorStatus = { CdiDescriptorError::DescriptorOk, 0, 0, 0 };
+		IO::BlockDevice *pDevice = IO::OpenFileDevice(this->m_sFileName, (bWrite == true ? IO::BlockDeviceAccess::ReadWrite : IO::BlockDeviceAccess::ReadOnly));
+		if (pDevice == nullptr)
+		{
+			// Print error and return.
+			printf("CdiFileHandle::Open: could not find file %s!\n", this->m_sFileName);
+			this->m_sDescriptorStatus.eError = CdiDescriptorError::DescriptorReadFailed;
+			return false;
+		}
+
+		// Compressed images are read through a device that decompresses them on demand.
+		if (CdiCompressedDevice::IsCompressedImage(pDevice) == true)
+		{
+			CdiCompressedDevice *pCompressedDevice = new CdiCompressedDevice();
+			if (bWrite == true || pCompressedDevice->Open(pDevice) == false)
+			{
+				// Print error and return.
+				if (bWrite == true)
+					printf("CdiFileHandle::Open: compressed image %s can't be opened for writing!\n", this->m_sFileName);
+				this->m_sDescriptorStatus.eError = CdiDescriptorError::DescriptorReadFailed;
+				delete pCompressedDevice;
+				delete pDevice;
+				return false;
+			}
+
+			pDevice = pCompressedDevice;
+		}
+
+		// Images in a chunk store are read through a device that decodes their chunks on demand.
+		else if (CdiStoreDevice::IsManifest(pDevice) == true)
+		{
+			CdiStoreDevice *pStoreDevice = new CdiStoreDevice();
+			if (bWrite == true || pStoreDevice->Open(pDevice, this->m_sFileName) == false)
+			{
+				// Print error and return.
+				if (bWrite == true)
+					printf("CdiFileHandle::Open: image %s in a chunk store can't be opened for writing!\n", this->m_sFileName);
+				this->m_sDescriptorStatus.eError = CdiDescriptorError::DescriptorReadFailed;
+				delete pStoreDevice;
+				delete pDevice;
+				return false;
+			}
+
+			pDevice = pStoreDevice;
+		}
+
+		// Load the sidecar index for the image if it is enabled. Writing to the image makes the index stale, so it
+		// is only used when the image is opened for reading.
+		if (this->m_bUseIndex == true && bWrite == false)
+		{
+			CdiIndexKey sKey;
+			if (CdiSidecarIndex::ComputeKey(pDevice, &sKey) == true)
+			{
+				this->m_pIndex = new CdiSidecarIndex(this->m_sFileName);
+				this->m_pIndex->Load(sKey, bVerbose);
+			}
+		}
+
+		// Parse the image using the file device.
+		return Open(pDevice, bVerbose, bMemoryMap);
+	}
+
+	bool CdiFileHandle::Open(IO::BlockDevice *pDevice, bool bVerbose, bool bMemoryMap)
+	{
+		// Take ownership of the device.
+		this->m_pDevice = pDevice;
+		this->m_sDescriptorStatus = { CdiDescriptorError::DescriptorOk, 0, 0, 0 };
+		this->m_sWriteBuffer.Attach(this->m_pDevice);
+
+		// Get the file size of the image and check it is valid.
+		this->m_qwFileSize = this->m_pDevice->Size();
+		if (this->m_qwFileSize < sizeof(CdiSessionDescriptorInfo))
+		{
+			// Print error, close the file, and return.
+			printf("CdiFileHandle::Open: image file %s has invalid size!", this->m_sFileName);
+			this->m_sDescriptorStatus.eError = CdiDescriptorError::DescriptorTruncated;
+			Close();
+			return false;
+		}
+
+		// If we have a valid sidecar index restore the session layout from it, otherwise parse the session descriptor.
+		if (this->m_pIndex != nullptr && this->m_pIndex->IsLoaded() == true &&
+			this->m_pIndex->GetLayout(&this->m_sSessions, &this->m_wSessionCount, &this->m_psTrackOffsets, &this->m_pdwSessionTrackIndex) == true)
+		{
+			if (bVerbose == true)
+				printf("found %d sessions in index\n", this->m_wSessionCount);
+		}
+		else
+		{
+			// Read and parse the session descriptor from the image.
+			if (ReadSessionDescriptor(bVerbose) == false)
+			{
+				// There was an error reading the session descriptor, close the file and return.
+				Close();
+				return false;
+			}
+
+			// Save the layout in the index so the next open can skip the session descriptor.
+			if (this->m_pIndex != nullptr)
+				this->m_pIndex->SetLayout(this->m_sSessions, this->m_wSessionCount, this->m_psTrackOffsets);
+		}
+
+		// Pack the metadata into a single allocation.
+		if (CompactMetadata() == false)
+		{
+			// Failed to allocate the metadata arena, close the file and return.
+			printf("CdiFileHandle::Open(): failed to allocate memory for the image metadata!\n");
+			Close();
+			return false;
+		}
+
+		// Create the queue for asynchronous reads up front, so threads submitting reads never race to create it.
+		{
+			std::lock_guard<std::mutex> lock(this->m_ReadQueueLock);
+			this->m_pReadQueue = this->m_pDevice->CreateReadQueue(this->m_dwReadQueueDepth);
+			this->m_vReapedReads.resize(this->m_pReadQueue->Depth());
+		}
+
+		// Check if we should map the image into memory.
+		if (bMemoryMap == true)
+		{
+			// Map the whole image, if the mapping fails (ie: not enough address space for the image) fall back to reading from the device.
+			this->m_pbMappedImage = this->m_pDevice->Map();
+			if (this->m_pbMappedImage == nullptr)
+				printf("CdiFileHandle::Open(): failed to memory map image, falling back to file reads\n");
+			else if (bVerbose == true)
+				printf("memory mapped image at %p\n", this->m_pbMappedImage);
+		}
+
+		// Done, return true.
+		return true;
+	}
+
+	bool CdiFileHandle::Close()
+	{
+		// Write out any sectors still sitting in the write buffer.
+		bool bResult = this->m_sWriteBuffer.Flush();
+		if (bResult == false)
+			printf("CdiFileHandle::Close(): failed to write buffered sectors to the image!\n");
+		this->m_sWriteBuffer.Attach(nullptr);
+
+		// Write out the sidecar index if it was rebuilt.
+		if (this->m_pIndex != nullptr)
+		{
+			SaveSidecarIndex();
+			delete this->m_pIndex;
+			this->m_pIndex = nullptr;
+		}
+
+		// Destroy the read queue before the device it reads from.
+		{
+			std::lock_guard<std::mutex> lock(this->m_ReadQueueLock);
+			if (this->m_pReadQueue != nullptr)
+			{
+				delete this->m_pReadQueue;
+				this->m_pReadQueue = nullptr;
+			}
+			this->m_mReadCompletions.clear();
+		}
+
+		// Drop any cached sectors, if the handle is reopened on another image they would be served in place of its sectors.
+		this->m_sSectorCache.Clear();
+
+		// Release the mapping of the image.
+		if (this->m_pbMappedImage != nullptr)
+		{
+			this->m_pDevice->Unmap();
+			this->m_pbMappedImage = nullptr;
+		}
+
+		// Close the image device.
+		if (this->m_pDevice != nullptr)
+		{
+			delete this->m_pDevice;
+			this->m_pDevice = nullptr;
+		}
+
+		// Free the session and track info.
+		FreeMetadata();
+
+		return bResult;
+	}
+
+	bool CdiFileHandle::CompactMetadata()
+	{
+		// Nothing to do if the metadata is already in an arena.
+		if (this->m_pbMetadata != nullptr)
+			return true;
+
+		// Count the tracks and the space needed for their file names.
+		DWORD dwTotalTracks = 0;
+		DWORD dwNameSize = 0;
+		for (int i = 0; i < this->m_wSessionCount; i++)
+		{
+			dwTotalTracks += this->m_sSessions[i].wTrackCount;
+			for (int x = 0; x < this->m_sSessions[i].wTrackCount; x++)
+				dwNameSize += this->m_sSessions[i].psTracks[x].bFileNameLength + 1;
+		}
+
+		// Lay the tables out from largest alignment to smallest so each one is naturally aligned without padding:
+		// offset table, sessions, tracks, session track index and then the file names.
+		SIZE_T dwOffsetTableOffset = 0;
+		SIZE_T dwSessionsOffset = dwOffsetTableOffset + (SIZE_T)dwTotalTracks * sizeof(CdiTrackOffsetInfo);
+		SIZE_T dwTracksOffset = dwSessionsOffset + (SIZE_T)this->m_wSessionCount * sizeof(CdiSession);
+		SIZE_T dwIndexOffset = dwTracksOffset + (SIZE_T)dwTotalTracks * sizeof(CdiTrack);
+		SIZE_T dwNamesOffset = dwIndexOffset + (SIZE_T)this->m_wSessionCount * sizeof(DWORD);
+		PBYTE pbMetadata = new (std::nothrow) BYTE[dwNamesOffset + dwNameSize];
+		if (pbMetadata == nullptr)
+			return false;
+
+		// Copy the offset table and session index over.
+		CdiTrackOffsetInfo *psTrackOffsets = (CdiTrackOffsetInfo*)&pbMetadata[dwOffsetTableOffset];
+		CdiSession *psSessions = (CdiSession*)&pbMetadata[dwSessionsOffset];
+		CdiTrack *psTracks = (CdiTrack*)&pbMetadata[dwTracksOffset];
+		DWORD *pdwSessionTrackIndex = (DWORD*)&pbMetadata[dwIndexOffset];
+		CHAR *psNames = (CHAR*)&pbMetadata[dwNamesOffset];
+		memcpy(psTrackOffsets, this->m_psTrackOffsets, (SIZE_T)dwTotalTracks * sizeof(CdiTrackOffsetInfo));
+		memcpy(pdwSessionTrackIndex, this->m_pdwSessionTrackIndex, (SIZE_T)this->m_wSessionCount * sizeof(DWORD));
+
+		// Copy the sessions and tracks over, pointing each one at its new home in the arena.
+		for (int i = 0; i < this->m_wSessionCount; i++)
+		{
+			psSessions[i] = this->m_sSessions[i];
+			psSessions[i].psTracks = psTracks;
+			for (int x = 0; x < this->m_sSessions[i].wTrackCount; x++)
+			{
+				CdiTrack *pTrack = &this->m_sSessions[i].psTracks[x];
+				*psTracks = *pTrack;
+				psTracks->psFileName = psNames;
+				memcpy(psNames, pTrack->psFileName, pTrack->bFileNameLength);
+				psNames[pTrack->bFileNameLength] = 0;
+
+				psNames += pTrack->bFileNameLength + 1;
+				psTracks++;
+			}
+		}
+
+		// Free the old allocations and switch over to the arena.
+		WORD wSessionCount = this->m_wSessionCount;
+		FreeMetadata();
+		this->m_pbMetadata = pbMetadata;
+		this->m_wSessionCount = wSessionCount;
+		this->m_sSessions = psSessions;
+		this->m_psTrackOffsets = psTrackOffsets;
+		this->m_pdwSessionTrackIndex = pdwSessionTrackIndex;
+		return true;
+	}
+
+	void CdiFileHandle::FreeMetadata()
+	{
+		// Once compacted everything lives in the arena.
+		if (this->m_pbMetadata != nullptr)
+		{
+			delete[] this->m_pbMetadata;
+			this->m_pbMetadata = nullptr;
+		}
+		else
+		{
+			// Free each of the tables allocated while parsing the image, which may only be partially filled in.
+			for (int i = 0; i < this->m_wSessionCount && this->m_sSessions != nullptr; i++)
+			{
+				for (int x = 0; x < this->m_sSessions[i].wTrackCount && this->m_sSessions[i].psTracks != nullptr; x++)
+				{
+					if (this->m_sSessions[i].psTracks[x].psFileName != nullptr)
+						delete[] this->m_sSessions[i].psTracks[x].psFileName;
+				}
+
+				if (this->m_sSessions[i].psTracks != nullptr)
+					delete[] this->m_sSessions[i].psTracks;
+			}
+
+			if (this->m_sSessions != nullptr)
+				delete[] this->m_sSessions;
+			if (this->m_psTrackOffsets != nullptr)
+				delete[] this->m_psTrackOffsets;
+			if (this->m_pdwSessionTrackIndex != nullptr)
+				delete[] this->m_pdwSessionTrackIndex;
+		}
+
+		this->m_wSessionCount = 0;
+		this->m_sSessions = nullptr;
+		this->m_psTrackOffsets = nullptr;
+		this->m_pdwSessionTrackIndex = nullptr;
+	}
+
+	bool CdiFileHandle::ReadSessionDescriptor(bool bVerbose)
+	{
+		// Read the descriptor info block from the last 8 bytes of the file.
+		CdiSessionDescriptorInfo sDescriptorInfo;
+		if (this->m_pDevice->ReadAt(this->m_qwFileSize - sizeof(CdiSessionDescriptorInfo), &sDescriptorInfo, sizeof(CdiSessionDescriptorInfo)) == false)
+		{
+			// Failed to read the session descriptor.
+			return DescriptorError(CdiDescriptorError::DescriptorReadFailed, 0, 0, 0);
+		}
+
+		// Verify the descriptor type.
+		if (sDescriptorInfo.eDescriptorType != CdiSessionDescriptorType::Type1 &&
+			sDescriptorInfo.eDescriptorType != CdiSessionDescriptorType::Type2 &&
+			sDescriptorInfo.eDescriptorType != CdiSessionDescriptorType::Type3)
+		{
+			// Print error and return.
+			return DescriptorError(CdiDescriptorError::DescriptorInvalidVersion, 0, 0, 0);
+		}
+
+		// Print the cdi version.
+		if (sDescriptorInfo.eDescriptorType == CdiSessionDescriptorType::Type1)
+			printf("found cdi version 2\n");
+		else if (sDescriptorInfo.eDescriptorType == CdiSessionDescriptorType::Type2)
+			printf("found cdi version 3\n");
+		else if (sDescriptorInfo.eDescriptorType == CdiSessionDescriptorType::Type3)
+			printf("found cdi version 3.5\n");
+
+		// Compute the offset of the session descriptor block.
+		ULONGLONG qwSessionDescriptorOffset = 0;
+		if (sDescriptorInfo.eDescriptorType == CdiSessionDescriptorType::Type3)
+		{
+			// The helper value is the size of the descriptor.
+			if (sDescriptorInfo.dwDescriptorHelper <= this->m_qwFileSize)
+				qwSessionDescriptorOffset = this->m_qwFileSize - sDescriptorInfo.dwDescriptorHelper;
+			else
+				qwSessionDescriptorOffset = this->m_qwFileSize;
+		}
+		else
+		{
+			// The helper value is the offset of the descriptor, but it is only 32 bits wide. For images larger than 4GB
+			// use the high bits of the file size and step back 4GB if that would put the descriptor past the end of the file.
+			qwSessionDescriptorOffset = (this->m_qwFileSize & 0xFFFFFFFF00000000ULL) | sDescriptorInfo.dwDescriptorHelper;
+			if (qwSessionDescriptorOffset >= this->m_qwFileSize && qwSessionDescriptorOffset >= 0x100000000ULL)
+				qwSessionDescriptorOffset -= 0x100000000ULL;
+		}
+
+		// Make sure the descriptor size is sane before we allocate a buffer for it.
+		if (qwSessionDescriptorOffset >= this->m_qwFileSize ||
+			this->m_qwFileSize - qwSessionDescriptorOffset < sizeof(CdiSessionDescriptorInfo) + sizeof(WORD) ||
+			this->m_qwFileSize - qwSessionDescriptorOffset > CDI_MAX_SESSION_DESCRIPTOR_SIZE)
+		{
+			// Print error and return.
+			return DescriptorError(CdiDescriptorError::DescriptorInvalidSize, 0, 0, 0);
+		}
+
+		// Allocate a buffer for the session descriptor block.
+		DWORD dwSessionDescriptorSize = (DWORD)(this->m_qwFileSize - qwSessionDescriptorOffset);
+		BYTE *pbSessionDescriptor = new (std::nothrow) BYTE[dwSessionDescriptorSize];
+		if (pbSessionDescriptor == nullptr)
+			return DescriptorError(CdiDescriptorError::DescriptorOutOfMemory, 0, 0, 0);
+
+		// Read the session descriptor block from the image.
+		if (this->m_pDevice->ReadAt(qwSessionDescriptorOffset, pbSessionDescriptor, dwSessionDescriptorSize) == false)
+		{
+			// Failed to read the session descriptor, clean up resources and return false.
+			delete[] pbSessionDescriptor;
+			return DescriptorError(CdiDescriptorError::DescriptorReadFailed, 0, 0, 0);
+		}
+
+		// Parse the session descriptor block.
+		if (bVerbose == true) printf("found session descriptor of size %d\n", dwSessionDescriptorSize);
+		if (ParseSessionDescriptor(pbSessionDescriptor, dwSessionDescriptorSize, sDescriptorInfo.eDescriptorType, bVerbose) == false)
+		{
+			// There was an error parsing the session descriptor, clean up and return.
+			delete[] pbSessionDescriptor;
+			return false;
+		}
+
+		// Delete temp buffer.
+		delete[] pbSessionDescriptor;
+		return true;
+	}
+
+	bool CdiFileHandle::ParseSessionDescriptor(PBYTE pbSessionDescriptor, DWORD dwDescriptorSize, CdiSessionDescriptorType eDescriptorType, bool bVerbose)
+	{
+		// Get the session count and make sure the descriptor is large enough to hold that many sessions.
+		if (DescriptorHasData(0, sizeof(WORD), dwDescriptorSize) == false)
+			return DescriptorError(CdiDescriptorError::DescriptorTruncated, 0, 0, 0);
+		WORD wSessionCount = CAST_TO_WORD(pbSessionDescriptor, 0);
+		if (wSessionCount > (dwDescriptorSize - sizeof(WORD)) / CDI_SESSION_DESCRIPTOR_MIN_SIZE)
+			return DescriptorError(CdiDescriptorError::DescriptorTruncated, 0, 0, 0);
+		printf("found %d sessions\n", wSessionCount);// + 1);
+
+		// Every track takes up at least CDI_TRACK_DESCRIPTOR_MIN_SIZE bytes of the descriptor, and every file name is
+		// copied out of the descriptor, so the size of the descriptor bounds the size of all of the metadata. Allocate
+		// the arena up front with the same layout CompactMetadata() uses so nothing else needs to be allocated.
+		DWORD dwMaxTracks = (dwDescriptorSize - sizeof(WORD)) / CDI_TRACK_DESCRIPTOR_MIN_SIZE;
+		SIZE_T dwSessionsOffset = (SIZE_T)dwMaxTracks * sizeof(CdiTrackOffsetInfo);
+		SIZE_T dwTracksOffset = dwSessionsOffset + (SIZE_T)wSessionCount * sizeof(CdiSession);
+		SIZE_T dwIndexOffset = dwTracksOffset + (SIZE_T)dwMaxTracks * sizeof(CdiTrack);
+		SIZE_T dwNamesOffset = dwIndexOffset + (SIZE_T)wSessionCount * sizeof(DWORD);
+		this->m_pbMetadata = new (std::nothrow) BYTE[dwNamesOffset + dwDescriptorSize];
+		if (this->m_pbMetadata == nullptr)
+			return DescriptorError(CdiDescriptorError::DescriptorOutOfMemory, 0, 0, 0);
+
+		// Point the tables at the arena. The offset table and session index are filled in by BuildTrackOffsetTable().
+		this->m_wSessionCount = wSessionCount;
+		this->m_psTrackOffsets = (CdiTrackOffsetInfo*)&this->m_pbMetadata[0];
+		this->m_sSessions = (CdiSession*)&this->m_pbMetadata[dwSessionsOffset];
+		this->m_pdwSessionTrackIndex = (DWORD*)&this->m_pbMetadata[dwIndexOffset];
+		CdiTrack *psTracks = (CdiTrack*)&this->m_pbMetadata[dwTracksOffset];
+		CHAR *psNames = (CHAR*)&this->m_pbMetadata[dwNamesOffset];
+
+		// Loop through all of the sessions and parse each one.
+		DWORD dwOffset = sizeof(WORD);
+		DWORD dwTrackCount = 0;
+		for (int i = 0; i < wSessionCount; i++)
+		{
+			// Initialize the session structure.
+			CdiSession *pSession = &this->m_sSessions[i];
+			*pSession = CdiSession();
+
+			// Set the session number.
+			if (bVerbose == true) printf("\nsession %d:\n", i + 1);
+			pSession->dwSessionNumber = i;
+
+			// The first word is the track count.
+			if (DescriptorHasData(dwOffset, sizeof(WORD), dwDescriptorSize) == false)
+				return DescriptorError(CdiDescriptorError::DescriptorTruncated, dwOffset, i, 0);
+			pSession->wTrackCount = CAST_TO_WORD(pbSessionDescriptor, dwOffset);
+			if (bVerbose == true) printf("\ttrack count: %d\n", pSession->wTrackCount);
+			dwOffset += 2;
+
+			// NOTE: 0 tracks means the session is open, we need to handle this.
+
+			// Take the tracks for this session from the track array.
+			if (pSession->wTrackCount > dwMaxTracks - dwTrackCount)
+				return DescriptorError(CdiDescriptorError::DescriptorTruncated, dwOffset, i, 0);
+			pSession->psTracks = &psTracks[dwTrackCount];
+			dwTrackCount += pSession->wTrackCount;
+
+			// Loop through all the tracks and read them from the descriptor.
+			for (int x = 0; x < pSession->wTrackCount; x++)
+			{
+				// Initialize the track structure.
+				CdiTrack *pTrack = &pSession->psTracks[x];
+				*pTrack = CdiTrack();
+
+				// Set the track number.
+				if (bVerbose == true) printf("\n\ttrack %d\n", x + 1);
+				pTrack->dwTrackNumber = x;
+
+				// Check for extra data we need to skip (DJ 3.00.780 and up).
+				if (DescriptorHasData(dwOffset, sizeof(DWORD), dwDescriptorSize) == false)
+					return DescriptorError(CdiDescriptorError::DescriptorTruncated, dwOffset, i, x);
+				if (CAST_TO_DWORD(pbSessionDescriptor, dwOffset) != 0)
+					dwOffset += 8;
+
+				// The next 20 bytes appear to be constant, I think they are some sort of track start marker (CDIRip src).
+				BYTE pbStatic1[20] = { 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xFF,
+					0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF };
+				if (DescriptorHasData(dwOffset, 29, dwDescriptorSize) == false)
+					return DescriptorError(CdiDescriptorError::DescriptorTruncated, dwOffset, i, x);
+				if (memcmp(&pbSessionDescriptor[dwOffset + 4], pbStatic1, 20) != 0)
+					return DescriptorError(CdiDescriptorError::DescriptorMarkerMismatch, dwOffset + 4, i, x);
+
+				// I really have no idea what the next 4 bytes are, the information at hand is rudimentary at best.
+				PBYTE pbUnknown1 = &pbSessionDescriptor[dwOffset + 24];
+				if (bVerbose == true) printf("\t\tunknown bytes 1: %x %x %x %x\n", pbUnknown1[0], pbUnknown1[1], pbUnknown1[2], pbUnknown1[3]);
+
+				// Next we have the file name of this session, followed by 19 bytes and the DiscJuggler 4 marker.
+				pTrack->bFileNameLength = CAST_TO_BYTE(pbSessionDescriptor, dwOffset + 28);
+				dwOffset += 29;
+				if (DescriptorHasData(dwOffset, pTrack->bFileNameLength + 19 + sizeof(DWORD), dwDescriptorSize) == false)
+					return DescriptorError(CdiDescriptorError::DescriptorTruncated, dwOffset, i, x);
+
+				// Copy the file name into the arena and put a null terminating character at the end of it.
+				pTrack->psFileName = psNames;
+				memcpy(psNames, &pbSessionDescriptor[dwOffset], pTrack->bFileNameLength);
+				psNames[pTrack->bFileNameLength] = 0;
+				psNames += pTrack->bFileNameLength + 1;
+				dwOffset += pTrack->bFileNameLength;
+				if (bVerbose == true) printf("\t\tfile name: %s\n", pTrack->psFileName);
+
+				// Check some value that only appears in DiscJuggler 4, but changes the session descriptor structure.
+				dwOffset += 19;
+				if (CAST_TO_DWORD(pbSessionDescriptor, dwOffset) == 0x80000000)
+				{
+					// Skip the next 8 bytes.
+					dwOffset += 8;
+				}
+
+				// The rest of the fields are in the next 93 bytes.
+				if (DescriptorHasData(dwOffset, 93, dwDescriptorSize) == false)
+					return DescriptorError(CdiDescriptorError::DescriptorTruncated, dwOffset, i, x);
+
+				// Read the pregap length, and other length value.
+				pTrack->dwPregapLength = CAST_TO_DWORD(pbSessionDescriptor, dwOffset + 6);
+				pTrack->dwLength = CAST_TO_DWORD(pbSessionDescriptor, dwOffset + 10);
+				if (bVerbose == true)
+				{
+					printf("\t\tpregap length: %d\n", pTrack->dwPregapLength);
+					printf("\t\tlength: %d\n", pTrack->dwLength);
+				}
+
+				// Read the session mode.
+				pTrack->eMode = (CdiTrackMode)CAST_TO_DWORD(pbSessionDescriptor, dwOffset + 20);
+				if (bVerbose == true)
+				{
+					printf("\t\tmode: ");
+					switch (pTrack->eMode)
+					{
+					case CdiTrackMode::Audio:	printf("Audio\n");	break;
+					case CdiTrackMode::Mode1:	printf("Mode1\n");	break;
+					case CdiTrackMode::Mode2:	printf("Mode2\n");	break;
+					default:					printf("Unknown\n");	break;
+					}
+				}
+
+				// Check the track mode is valid.
+				if ((DWORD)pTrack->eMode > CdiTrackMode::Mode2)
+					return DescriptorError(CdiDescriptorError::DescriptorInvalidTrackMode, dwOffset + 20, i, x);
+
+				// Read the lba and total length.
+				pTrack->dwLba = CAST_TO_DWORD(pbSessionDescriptor, dwOffset + 36);
+				pTrack->dwTotalLength = CAST_TO_DWORD(pbSessionDescriptor, dwOffset + 40);
+				if (bVerbose == true)
+				{
+					printf("\t\tlba: %d\n", pTrack->dwLba);
+					printf("\t\ttotal length: %d\n", pTrack->dwTotalLength);
+				}
+
+				// Read the sector size value.
+				pTrack->eSectorType = (CdiSectorType)CAST_TO_DWORD(pbSessionDescriptor, dwOffset + 60);
+				switch (pTrack->eSectorType)
+				{
+				case CdiSectorType::Type_2048:	pTrack->eSectorSize = CdiSectorSize::Size_2048;	break;
+				case CdiSectorType::Type_2336:	pTrack->eSectorSize = CdiSectorSize::Size_2336;	break;
+				case CdiSectorType::Type_2352:	pTrack->eSectorSize = CdiSectorSize::Size_2352;	break;
+				case CdiSectorType::Type_2368:	pTrack->eSectorSize = CdiSectorSize::Size_2368;	break;
+				case CdiSectorType::Type_2448:	pTrack->eSectorSize = CdiSectorSize::Size_2448;	break;
+				default:						pTrack->eSectorSize = (CdiSectorSize)0;			break;
+				}
+
+				// Check that the sector size is valid.
+				if (bVerbose == true) printf("\t\tsector size: %d\n", pTrack->eSectorSize);
+				if (pTrack->eSectorSize == 0)
+					return DescriptorError(CdiDescriptorError::DescriptorInvalidSectorSize, dwOffset + 60, i, x);
+
+				// Next session.
+				dwOffset += 93;
+
+				// If the image format isn't type 1 we need to check for extra data to skip over. The layout of type 1
+				// descriptors is not known, so they are parsed the same way without the extra data.
+				if (eDescriptorType != CdiSessionDescriptorType::Type1)
+				{
+					// Read some dword and see if there is extra data we need to skip.
+					if (DescriptorHasData(dwOffset, 9, dwDescriptorSize) == false)
+						return DescriptorError(CdiDescriptorError::DescriptorTruncated, dwOffset, i, x);
+					if (CAST_TO_DWORD(pbSessionDescriptor, dwOffset + 5) == 0xFFFFFFFF)
+						dwOffset += 78; // (DJ 3.00.780 and up)
+
+					// Skip the data we just read.
+					dwOffset += 9;
+				}
+			}
+
+			// NOTE: There are 12 bytes unaccounted for.
+			dwOffset += 12;
+
+			// Next session.
+			if (eDescriptorType != CdiSessionDescriptorType::Type1)
+				dwOffset += 1;
+
+			// The skipped bytes have to be inside of the descriptor as well.
+			if (dwOffset > dwDescriptorSize)
+				return DescriptorError(CdiDescriptorError::DescriptorTruncated, dwDescriptorSize, i, pSession->wTrackCount);
+		}
+
+		// Build the offset table now that we know the layout of every track.
+		if (BuildTrackOffsetTable() == false)
+			return false;
+
+		// Everything seems to check out.
+		printf("\n");
+		return true;
+	}
+
+	bool CdiFileHandle::DescriptorError(CdiDescriptorError eError, DWORD dwOffset, DWORD dwSessionNumber, DWORD dwTrackNumber)
+	{
+		// Save the error so callers can tell why the image was rejected.
+		this->m_sDescriptorStatus.eError = eError;
+		this->m_sDescriptorStatus.dwOffset = dwOffset;
+		this->m_sDescriptorStatus.dwSessionNumber = dwSessionNumber;
+		this->m_sDescriptorStatus.dwTrackNumber = dwTrackNumber;
+
+		// Print the error and return.
+		printf("CdiFileHandle::ReadSessionDescriptor(): %s (session %d track %d, descriptor offset 0x%x)!\n",
+			DescriptorErrorToString(eError), dwSessionNumber + 1, dwTrackNumber + 1, dwOffset);
+		return false;
+	}
+
+	bool CdiFileHandle::BuildTrackOffsetTable()
+	{
+		// Count the total number of tracks in the image.
+		DWORD dwTotalTracks = 0;
+		for (int i = 0; i < this->m_wSessionCount; i++)
+			dwTotalTracks += this->m_sSessions[i].wTrackCount;
+
+		// Allocate the offset table and the session index table, unless they were already allocated in the arena.
+		if (this->m_psTrackOffsets == nullptr)
+		{
+			this->m_psTrackOffsets = new CdiTrackOffsetInfo[dwTotalTracks];
+			this->m_pdwSessionTrackIndex = new DWORD[this->m_wSessionCount];
+		}
+
+		// Loop through all of the sessions and tracks and compute the offsets of each one. The tracks are laid
+		// out back to back in the image file in session order, each one starting with its pregap.
+		DWORD dwTableIndex = 0;
+		ULONGLONG qwTrackOffset = 0;
+		for (int i = 0; i < this->m_wSessionCount; i++)
+		{
+			// Save the index of the first track in this session.
+			this->m_pdwSessionTrackIndex[i] = dwTableIndex;
+
+			for (int x = 0; x < this->m_sSessions[i].wTrackCount; x++)
+			{
+				CdiTrack *pTrack = &this->m_sSessions[i].psTracks[x];
+				CdiTrackOffsetInfo *pOffsetInfo = &this->m_psTrackOffsets[dwTableIndex++];
+
+				// The track data starts right after the pregap.
+				pOffsetInfo->qwPregapOffset = qwTrackOffset;
+				pOffsetInfo->qwDataOffset = qwTrackOffset + ((ULONGLONG)pTrack->dwPregapLength * pTrack->eSectorSize);
+				pOffsetInfo->dwSectorStride = pTrack->eSectorSize;
+
+				// Compute the offset of the end of the track and make sure it is inside of the image file. The pregap and
+				// data must also fit inside of the total length or the descriptor is corrupt.
+				ULONGLONG qwTrackSize = 0;
+				if (pTrack->dwPregapLength > pTrack->dwTotalLength || pTrack->dwLength > pTrack->dwTotalLength - pTrack->dwPregapLength ||
+					SafeMultiply64(pTrack->dwTotalLength, pTrack->eSectorSize, &qwTrackSize) == false ||
+					SafeAdd64(qwTrackOffset, qwTrackSize, &qwTrackSize) == false || qwTrackSize > this->m_qwFileSize)
+				{
+					// Print an error and return.
+					return DescriptorError(CdiDescriptorError::DescriptorTrackOutOfBounds, 0, i, x);
+				}
+
+				// We need to know the header size of the track in order to read data from it. 2368 and 2448 byte
+				// sectors are a raw 2352 byte sector followed by subchannel data so they have the same header.
+				pOffsetInfo->dwHeaderSize = 0;
+				if (pTrack->eMode == CdiTrackMode::Mode2)
+				{
+					// Check the sector size to determin the header size.
+					if (pTrack->eSectorSize >= CdiSectorSize::Size_2352)
+						pOffsetInfo->dwHeaderSize = 24;
+					else if (pTrack->eSectorSize == CdiSectorSize::Size_2336)
+						pOffsetInfo->dwHeaderSize = 8;
+				}
+				else if (pTrack->eMode == CdiTrackMode::Mode1)
+				{
+					// Check the sector size to determin the header size.
+					if (pTrack->eSectorSize >= CdiSectorSize::Size_2352)
+						pOffsetInfo->dwHeaderSize = 16;
+				}
+
+				// Skip over this track.
+				qwTrackOffset = qwTrackSize;
+			}
+		}
+
+		// Successfully built the offset table.
+		return true;
+	}
+
+	bool CdiFileHandle::ReadSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount)
+	{
+		// Check that the session number and track number are valid.
+		if (dwSessionNumber >= this->m_wSessionCount || dwTrackNumber >= this->m_sSessions[dwSessionNumber].wTrackCount)
+			return false;
+
+		// Check to make sure the data to be read is inside of the track. The offset math below assumes it is, and the
+		// sectors would be cached under this track even if they were read from the next one.
+		CdiTrack *pTargetTrack = &this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber];
+		if (dwLBA < pTargetTrack->dwLba || dwLBA - pTargetTrack->dwLba > pTargetTrack->dwLength ||
+			dwSectorCount > pTargetTrack->dwLength - (dwLBA - pTargetTrack->dwLba))
+		{
+			// Print an error and return.
+			printf("CdiFileHandle::ReadSectors(): read operation would go beyond the length of the track!\n");
+			return false;
+		}
+
+		// Pull out the offset info for easy access.
+		const CdiTrackOffsetInfo *pOffsetInfo = GetTrackOffsetInfo(dwSessionNumber, dwTrackNumber);
+
+		// If the image is memory mapped copy the sectors out of the mapping.
+		if (this->m_pbMappedImage != nullptr)
+		{
+			// Get a view of the sectors to copy.
+			CdiSectorView sView;
+			if (ReadSectorsView(dwSessionNumber, dwTrackNumber, dwLBA, dwSectorCount, &sView) == false)
+				return false;
+
+			// Check if the data can be copied in one go or if we have to skip the headers.
+			if (sView.IsContiguous() == true)
+				memcpy(pbBuffer, sView.pbData, sView.Size());
+			else
+			{
+				// Copy the user data of each sector to the output buffer.
+				for (DWORD i = 0; i < sView.dwSectorCount; i++)
+					memcpy(&pbBuffer[i * sView.dwSectorSize], sView.Sector(i), sView.dwSectorSize);
+			}
+
+			// Done, successfully read the data.
+			return true;
+		}
+
+		// Small reads go through the sector cache, large streaming reads bypass it.
+		DWORD dwSectorSize = (pTargetTrack->eMode == CdiTrackMode::Audio ? pOffsetInfo->dwSectorStride : RAW_SECTOR_SIZE);
+		bool bUseCache = (this->m_sSectorCache.Enabled() == true && dwSectorCount <= CDI_SECTOR_CACHE_MAX_READ_SECTORS);
+		ULONGLONG qwCacheGeneration = 0;
+		if (bUseCache == true)
+		{
+			// Check if all of the sectors are already cached.
+			if (this->m_sSectorCache.Lookup(dwSessionNumber, dwTrackNumber, dwLBA, dwSectorCount, dwSectorSize, pbBuffer) == true)
+				return true;
+
+			// Save the cache generation so we know if the sectors were written to while we read them.
+			qwCacheGeneration = this->m_sSectorCache.Generation();
+		}
+
+		// Read the sectors from the image.
+		if (ReadSectorsFromDevice(pTargetTrack, pOffsetInfo, dwLBA, pbBuffer, dwSectorCount) == false)
+			return false;
+
+		// Add the sectors to the cache.
+		if (bUseCache == true)
+			this->m_sSectorCache.Insert(dwSessionNumber, dwTrackNumber, dwLBA, dwSectorCount, dwSectorSize, pbBuffer, qwCacheGeneration);
+
+		// Done, successfully read the data.
+		return true;
+	}
+
+	bool CdiFileHandle::ReadSectorsFromDevice(const CdiTrack *pTargetTrack, const CdiTrackOffsetInfo *pOffsetInfo, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount)
+	{
+		// Compute the offset of the target LBA using the offset table.
+		ULONGLONG qwTargetOffset = pOffsetInfo->qwDataOffset + ((ULONGLONG)(dwLBA - pTargetTrack->dwLba) * pOffsetInfo->dwSectorStride);
+
+		// Check if the sectors can be read straight into the output buffer. Audio tracks are returned as whole raw
+		// sectors and cooked 2048 byte data tracks have no header to strip, so neither needs a staging buffer.
+		if (pTargetTrack->eMode == CdiTrackMode::Audio || pOffsetInfo->dwSectorStride == RAW_SECTOR_SIZE)
+		{
+			// Read all of the sectors in as few reads as possible.
+			if (ReadImageData(qwTargetOffset, pbBuffer, dwSectorCount, pOffsetInfo->dwSectorStride) == false)
+			{
+				// Failed to read the sectors from the image file.
+				printf("CdiFileHandle::ReadSectors(): failed to read sectors! LBA=%d, Count=%d, Size=%d!\n",
+					dwLBA, dwSectorCount, pTargetTrack->eSectorSize);
+				return false;
+			}
+
+			// Done, successfully read the data.
+			return true;
+		}
+
+		// Grab a staging buffer for this read, every thread reading from the image gets its own.
+		PBYTE pbStagingBuffer = AcquireStagingBuffer();
+		if (pbStagingBuffer == nullptr)
+		{
+			// Failed to allocate the staging buffer.
+			printf("CdiFileHandle::ReadSectors(): failed to allocate staging buffer!\n");
+			return false;
+		}
+
+		// Loop and read the sectors in chunks.
+		DWORD dwSectorsRemaining = dwSectorCount;
+		while (dwSectorsRemaining > 0)
+		{
+			// Read the next run of raw sectors into the staging buffer.
+			DWORD dwChunkSectors = (dwSectorsRemaining < this->m_dwReadChunkSectors ? dwSectorsRemaining : this->m_dwReadChunkSectors);
+			if (ReadImageData(qwTargetOffset, pbStagingBuffer, dwChunkSectors, pOffsetInfo->dwSectorStride) == false)
+			{
+				// Failed to read the sectors from the image file.
+				printf("CdiFileHandle::ReadSectors(): failed to read sectors! LBA=%d, Count=%d, Size=%d!\n",
+					dwLBA + (dwSectorCount - dwSectorsRemaining), dwChunkSectors, pTargetTrack->eSectorSize);
+				ReleaseStagingBuffer(pbStagingBuffer);
+				return false;
+			}
+
+			// Strip the sector headers and copy the user data to the output buffer.
+			PBYTE pbRawSector = &pbStagingBuffer[pOffsetInfo->dwHeaderSize];
+			for (DWORD i = 0; i < dwChunkSectors; i++)
+			{
+				memcpy(pbBuffer, pbRawSector, RAW_SECTOR_SIZE);
+				pbBuffer += RAW_SECTOR_SIZE;
+				pbRawSector += pOffsetInfo->dwSectorStride;
+			}
+
+			// Next chunk.
+			dwSectorsRemaining -= dwChunkSectors;
+			qwTargetOffset += (ULONGLONG)dwChunkSectors * pOffsetInfo->dwSectorStride;
+		}
+
+		// Return the staging buffer to the free list.
+		ReleaseStagingBuffer(pbStagingBuffer);
+
+		// Done, successfully read the data.
+		return true;
+	}
+
+	bool CdiFileHandle::ReadRawSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount)
+	{
+		// Check that the session number and track number are valid.
+		const CdiTrackOffsetInfo *pOffsetInfo = GetTrackOffsetInfo(dwSessionNumber, dwTrackNumber);
+		if (pOffsetInfo == nullptr)
+			return false;
+
+		// Check to make sure the data to be read wont go beyond the pregap or the end of the track.
+		CdiTrack *pTargetTrack = &this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber];
+		DWORD dwFirstLBA = pTargetTrack->dwLba - pTargetTrack->dwPregapLength;
+		DWORD dwSectorsInTrack = pTargetTrack->dwPregapLength + pTargetTrack->dwLength;
+		if (dwLBA - dwFirstLBA > dwSectorsInTrack || dwSectorCount > dwSectorsInTrack - (dwLBA - dwFirstLBA))
+		{
+			// Print an error and return.
+			printf("CdiFileHandle::ReadRawSectors(): read operation would go beyond the length of the track!\n");
+			return false;
+		}
+
+		// Compute the offset of the target LBA using the offset table.
+		ULONGLONG qwTargetOffset = pOffsetInfo->qwPregapOffset + ((ULONGLONG)(dwLBA - dwFirstLBA) * pOffsetInfo->dwSectorStride);
+
+		// If the image is memory mapped copy the sectors out of the mapping, after writing out any buffered writes to them.
+		if (this->m_pbMappedImage != nullptr)
+		{
+			if (this->m_sWriteBuffer.FlushRange(qwTargetOffset, (ULONGLONG)dwSectorCount * pOffsetInfo->dwSectorStride) == false)
+				return false;
+
+			memcpy(pbBuffer, this->m_pbMappedImage + (SIZE_T)qwTargetOffset, (SIZE_T)dwSectorCount * pOffsetInfo->dwSectorStride);
+			return true;
+		}
+
+		// Read all of the sectors in as few reads as possible.
+		if (ReadImageData(qwTargetOffset, pbBuffer, dwSectorCount, pOffsetInfo->dwSectorStride) == false)
+		{
+			// Failed to read the sectors from the image file.
+			printf("CdiFileHandle::ReadRawSectors(): failed to read sectors! LBA=%d, Count=%d, Size=%d!\n",
+				dwLBA, dwSectorCount, pTargetTrack->eSectorSize);
+			return false;
+		}
+
+		// Done, successfully read the data.
+		return true;
+	}
+
+	bool CdiFileHandle::CopyRawSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, IO::BlockDevice *pDestination, ULONGLONG qwDestinationOffset)
+	{
+		// Check that the session number and track number are valid.
+		const CdiTrackOffsetInfo *pOffsetInfo = GetTrackOffsetInfo(dwSessionNumber, dwTrackNumber);
+		if (pOffsetInfo == nullptr)
+			return false;
+
+		// Check to make sure the data to be copied wont go beyond the pregap or the end of the track.
+		CdiTrack *pTargetTrack = &this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber];
+		DWORD dwFirstLBA = pTargetTrack->dwLba - pTargetTrack->dwPregapLength;
+		DWORD dwSectorsInTrack = pTargetTrack->dwPregapLength + pTargetTrack->dwLength;
+		if (dwLBA - dwFirstLBA > dwSectorsInTrack || dwSectorCount > dwSectorsInTrack - (dwLBA - dwFirstLBA))
+		{
+			// Print an error and return.
+			printf("CdiFileHandle::CopyRawSectors(): copy operation would go beyond the length of the track!\n");
+			return false;
+		}
+
+		// Write out any buffered writes to the sectors so the copy sees them.
+		ULONGLONG qwSourceOffset = pOffsetInfo->qwPregapOffset + ((ULONGLONG)(dwLBA - dwFirstLBA) * pOffsetInfo->dwSectorStride);
+		ULONGLONG qwSize = (ULONGLONG)dwSectorCount * pOffsetInfo->dwSectorStride;
+		if (this->m_sWriteBuffer.FlushRange(qwSourceOffset, qwSize) == false)
+			return false;
+
+		// Copy the sectors.
+		if (this->m_pDevice->CopyTo(qwSourceOffset, pDestination, qwDestinationOffset, qwSize) == false)
+		{
+			printf("CdiFileHandle::CopyRawSectors(): failed to copy sectors! LBA=%d, Count=%d, Size=%d!\n",
+				dwLBA, dwSectorCount, pTargetTrack->eSectorSize);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool CdiFileHandle::ReadImageBytes(ULONGLONG qwOffset, PBYTE pbBuffer, DWORD dwSize)
+	{
+		// Check the range is inside of the image.
+		if (qwOffset > this->m_qwFileSize || dwSize > this->m_qwFileSize - qwOffset)
+		{
+			// Print an error and return.
+			printf("CdiFileHandle::ReadImageBytes(): read would go beyond the end of the image!\n");
+			return false;
+		}
+
+		// Write out any buffered writes to the range so the read sees them.
+		if (this->m_sWriteBuffer.FlushRange(qwOffset, dwSize) == false)
+			return false;
+
+		// Read the data.
+		if (this->m_pDevice->ReadAt(qwOffset, pbBuffer, dwSize) == false)
+		{
+			printf("CdiFileHandle::ReadImageBytes(): failed to read %d bytes at offset %lld!\n", dwSize, qwOffset);
+			return false;
+		}
+
+		return true;
+	}
+
+	ULONGLONG CdiFileHandle::ImageSize()
+	{
+		return this->m_qwFileSize;
+	}
+
+	bool CdiFileHandle::ReadSubchannelSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbMainChannel, PBYTE pbSubchannel, DWORD dwSectorCount)
+	{
+		// Check that the session number and track number are valid.
+		const CdiTrackOffsetInfo *pOffsetInfo = GetTrackOffsetInfo(dwSessionNumber, dwTrackNumber);
+		if (pOffsetInfo == nullptr)
+			return false;
+
+		// Check the track stores full sectors, and subchannel data if it was asked for.
+		CdiTrack *pTargetTrack = &this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber];
+		if (pTargetTrack->eSectorSize < CdiSectorSize::Size_2352 || (pbSubchannel != nullptr && HasSubchannel(pTargetTrack->eSectorSize) == false))
+		{
+			// Print an error and return.
+			printf("CdiFileHandle::ReadSubchannelSectors(): track does not store %s data!\n", (pbSubchannel != nullptr ? "subchannel" : "raw sector"));
+			return false;
+		}
+
+		// Sectors without subchannel data can be read straight into the output buffer.
+		if (pTargetTrack->eSectorSize == CdiSectorSize::Size_2352)
+			return pbMainChannel == nullptr || ReadRawSectors(dwSessionNumber, dwTrackNumber, dwLBA, pbMainChannel, dwSectorCount);
+
+		// Grab a staging buffer to read the sectors into, every thread reading from the image gets its own.
+		PBYTE pbStagingBuffer = AcquireStagingBuffer();
+		if (pbStagingBuffer == nullptr)
+		{
+			// Failed to allocate the staging buffer.
+			printf("CdiFileHandle::ReadSubchannelSectors(): failed to allocate staging buffer!\n");
+			return false;
+		}
+
+		// Loop and read the sectors in chunks.
+		DWORD dwSectorsRemaining = dwSectorCount;
+		while (dwSectorsRemaining > 0)
+		{
+			// Read the next run of sectors into the staging buffer.
+			DWORD dwChunkLBA = dwLBA + (dwSectorCount - dwSectorsRemaining);
+			DWORD dwChunkSectors = (dwSectorsRemaining < this->m_dwReadChunkSectors ? dwSectorsRemaining : this->m_dwReadChunkSectors);
+			if (ReadRawSectors(dwSessionNumber, dwTrackNumber, dwChunkLBA, pbStagingBuffer, dwChunkSectors) == false)
+			{
+				ReleaseStagingBuffer(pbStagingBuffer);
+				return false;
+			}
+
+			// Split off the main channel data.
+			for (DWORD i = 0; i < dwChunkSectors && pbMainChannel != nullptr; i++)
+			{
+				memcpy(pbMainChannel, &pbStagingBuffer[i * pOffsetInfo->dwSectorStride], CD_MAIN_CHANNEL_SIZE);
+				pbMainChannel += CD_MAIN_CHANNEL_SIZE;
+			}
+
+			// De-interleave the subchannel data of the whole chunk in one go.
+			if (pbSubchannel != nullptr)
+			{
+				DeinterleaveSubchannel(pbStagingBuffer, pTargetTrack->eSectorSize, dwChunkSectors, pbSubchannel);
+				pbSubchannel += dwChunkSectors * CD_SUBCHANNEL_SIZE;
+			}
+
+			// Next chunk.
+			dwSectorsRemaining -= dwChunkSectors;
+		}
+
+		// Return the staging buffer to the free list.
+		ReleaseStagingBuffer(pbStagingBuffer);
+		return true;
+	}
+
+	bool CdiFileHandle::ReadSectorsView(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, CdiSectorView *pView)
+	{
+		// Check that the image is memory mapped.
+		if (this->m_pbMappedImage == nullptr)
+			return false;
+
+		// Check that the session number and track number are valid.
+		const CdiTrackOffsetInfo *pOffsetInfo = GetTrackOffsetInfo(dwSessionNumber, dwTrackNumber);
+		if (pOffsetInfo == nullptr)
+			return false;
+
+		// Check to make sure the view wont go beyond the end of the track.
+		CdiTrack *pTargetTrack = &this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber];
+		if (dwLBA < pTargetTrack->dwLba || dwLBA - pTargetTrack->dwLba > pTargetTrack->dwLength ||
+			dwSectorCount > pTargetTrack->dwLength - (dwLBA - pTargetTrack->dwLba))
+		{
+			// Print an error and return.
+			printf("CdiFileHandle::ReadSectorsView(): view would go beyond the length of the track!\n");
+			return false;
+		}
+
+		// Make sure the view is inside of the mapped image.
+		ULONGLONG qwViewOffset = pOffsetInfo->qwDataOffset + ((ULONGLONG)(dwLBA - pTargetTrack->dwLba) * pOffsetInfo->dwSectorStride);
+		if (qwViewOffset + ((ULONGLONG)dwSectorCount * pOffsetInfo->dwSectorStride) > this->m_qwFileSize)
+		{
+			// Print an error and return.
+			printf("CdiFileHandle::ReadSectorsView(): view would go beyond the end of the image!\n");
+			return false;
+		}
+
+		// Write out any buffered writes to the sectors so the view is up to date.
+		if (this->m_sWriteBuffer.FlushRange(qwViewOffset, (ULONGLONG)dwSectorCount * pOffsetInfo->dwSectorStride) == false)
+			return false;
+
+		// Audio sectors are returned whole, data sectors only have their user data exposed.
+		pView->pbData = this->m_pbMappedImage + (SIZE_T)qwViewOffset;
+		pView->dwSectorStride = pOffsetInfo->dwSectorStride;
+		pView->dwSectorCount = dwSectorCount;
+		if (pTargetTrack->eMode == CdiTrackMode::Audio)
+			pView->dwSectorSize = pOffsetInfo->dwSectorStride;
+		else
+		{
+			pView->pbData += pOffsetInfo->dwHeaderSize;
+			pView->dwSectorSize = RAW_SECTOR_SIZE;
+		}
+
+		// Successfully created the view.
+		return true;
+	}
+
+	bool CdiFileHandle::IsMapped()
+	{
+		// Check if we have a mapped view of the image.
+		return this->m_pbMappedImage != nullptr;
+	}
+
+	bool CdiFileHandle::ReadImageData(ULONGLONG qwOffset, PBYTE pbBuffer, DWORD dwSectorCount, DWORD dwSectorSize)
+	{
+		// Make sure any buffered writes to the data are on the device first.
+		if (this->m_sWriteBuffer.FlushRange(qwOffset, (ULONGLONG)dwSectorCount * dwSectorSize) == false)
+			return false;
+
+		// Loop and read the data in the largest blocks that still fit in a single read call.
+		DWORD dwMaxSectorsPerRead = CDI_MAX_READ_SIZE / dwSectorSize;
+		while (dwSectorCount > 0)
+		{
+			// Read the next block of sectors from the image file.
+			DWORD dwReadSize = (dwSectorCount < dwMaxSectorsPerRead ? dwSectorCount : dwMaxSectorsPerRead) * dwSectorSize;
+			if (this->m_pDevice->ReadAt(qwOffset, pbBuffer, dwReadSize) == false)
+				return false;
+
+			// Next block.
+			qwOffset += dwReadSize;
+			pbBuffer += dwReadSize;
+			dwSectorCount -= dwReadSize / dwSectorSize;
+		}
+
+		// Successfully read all of the data.
+		return true;
+	}
+
+	bool CdiFileHandle::Flush()
+	{
+		// Write out everything staged in the write buffer.
+		return this->m_sWriteBuffer.Flush();
+	}
+
+	void CdiFileHandle::SetWriteBufferSize(DWORD dwSize)
+	{
+		// Resize the write buffer.
+		this->m_sWriteBuffer.SetSize(dwSize);
+	}
+
+	void CdiFileHandle::GetWriteBufferStats(CdiWriteBufferStats *pStats)
+	{
+		// Get the stats from the write buffer.
+		this->m_sWriteBuffer.GetStats(pStats);
+	}
+
+	void CdiFileHandle::SetSectorCacheSize(ULONGLONG qwBudget)
+	{
+		// Update the budget of the sector cache.
+		this->m_sSectorCache.SetBudget(qwBudget);
+	}
+
+	void CdiFileHandle::GetSectorCacheStats(CdiSectorCacheStats *pStats)
+	{
+		// Get the stats from the sector cache.
+		this->m_sSectorCache.GetStats(pStats);
+	}
+
+	bool CdiFileHandle::WriteRawDataSectors(const CdiTrack *pTargetTrack, const CdiTrackOffsetInfo *pOffsetInfo, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount)
+	{
+		// Compute the offset of the target LBA using the offset table.
+		ULONGLONG qwTargetOffset = pOffsetInfo->qwDataOffset + ((ULONGLONG)(dwLBA - pTargetTrack->dwLba) * pOffsetInfo->dwSectorStride);
+
+		// Grab a staging buffer to patch the raw sectors in.
+		PBYTE pbStagingBuffer = AcquireStagingBuffer();
+		if (pbStagingBuffer == nullptr)
+		{
+			// Failed to allocate the staging buffer.
+			printf("CdiFileHandle::WriteSectors(): failed to allocate staging buffer!\n");
+			return false;
+		}
+
+		// Loop and patch the sectors in chunks.
+		DWORD dwSectorsRemaining = dwSectorCount;
+		while (dwSectorsRemaining > 0)
+		{
+			// Read the raw sectors, the parts of the sector we don't rebuild have to be preserved.
+			DWORD dwChunkLBA = dwLBA + (dwSectorCount - dwSectorsRemaining);
+			DWORD dwChunkSectors = (dwSectorsRemaining < this->m_dwReadChunkSectors ? dwSectorsRemaining : this->m_dwReadChunkSectors);
+			if (ReadImageData(qwTargetOffset, pbStagingBuffer, dwChunkSectors, pOffsetInfo->dwSectorStride) == false)
+			{
+				// Failed to read the sectors from the image file.
+				printf("CdiFileHandle::WriteSectors(): failed to read sectors! LBA=%d, Count=%d, Size=%d!\n",
+					dwChunkLBA, dwChunkSectors, pTargetTrack->eSectorSize);
+				ReleaseStagingBuffer(pbStagingBuffer);
+				return false;
+			}
+
+			// Copy in the new user data and rebuild the rest of each sector if the track carries an EDC/ECC.
+			PBYTE pbRawSector = &pbStagingBuffer[pOffsetInfo->dwHeaderSize];
+			for (DWORD i = 0; i < dwChunkSectors; i++)
+			{
+				memcpy(pbRawSector, pbBuffer, RAW_SECTOR_SIZE);
+				pbBuffer += RAW_SECTOR_SIZE;
+				pbRawSector += pOffsetInfo->dwSectorStride;
+			}
+			if (this->m_dwRegenerationFlags != RegenerateNone && CanVerifySectors(pTargetTrack->eSectorSize, pTargetTrack->eMode) == true)
+				RegenerateSectors(pbStagingBuffer, pTargetTrack->eSectorSize, pTargetTrack->eMode, dwChunkLBA, dwChunkSectors, this->m_dwRegenerationFlags);
+
+			// Stage the whole chunk, headers included, so it goes out as part of one contiguous write.
+			if (this->m_sWriteBuffer.Write(qwTargetOffset, pbStagingBuffer, dwChunkSectors * pOffsetInfo->dwSectorStride) == false)
+			{
+				// Failed to write the sectors to the file.
+				printf("CdiFileHandle::WriteSectors(): failed to write sectors! LBA=%d, Count=%d, Size=%d!\n",
+					dwChunkLBA, dwChunkSectors, pTargetTrack->eSectorSize);
+				ReleaseStagingBuffer(pbStagingBuffer);
+				return false;
+			}
+
+			// Next chunk.
+			dwSectorsRemaining -= dwChunkSectors;
+			qwTargetOffset += (ULONGLONG)dwChunkSectors * pOffsetInfo->dwSectorStride;
+		}
+
+		// Return the staging buffer to the free list.
+		ReleaseStagingBuffer(pbStagingBuffer);
+		return true;
+	}
+
+	void CdiFileHandle::SetSectorRegeneration(DWORD dwFlags)
+	{
+		// Save the new flags.
+		this->m_dwRegenerationFlags = dwFlags;
+	}
+
+	DWORD CdiFileHandle::GetSectorRegeneration()
+	{
+		return this->m_dwRegenerationFlags;
+	}
+
+	void CdiFileHandle::EnableSidecarIndex(bool bEnable)
+	{
+		this->m_bUseIndex = bEnable;
+	}
+
+	CdiSidecarIndex *CdiFileHandle::GetSidecarIndex()
+	{
+		return this->m_pIndex;
+	}
+
+	bool CdiFileHandle::SaveSidecarIndex()
+	{
+		// Nothing to do if the index is disabled.
+		if (this->m_pIndex == nullptr)
+			return true;
+
+		return this->m_pIndex->Save();
+	}
+
+	void CdiFileHandle::SetReadQueueDepth(DWORD dwQueueDepth)
+	{
+		// Save the new depth, it is used when the queue is created the next time an image is opened.
+		this->m_dwReadQueueDepth = (dwQueueDepth == 0 ? 1 : dwQueueDepth);
+	}
+
+	DWORD CdiFileHandle::GetReadQueueDepth()
+	{
+		// If the queue has been created return its actual depth, otherwise the depth it will be created with.
+		std::lock_guard<std::mutex> lock(this->m_ReadQueueLock);
+		if (this->m_pReadQueue != nullptr)
+			return this->m_pReadQueue->Depth();
+
+		return this->m_dwReadQueueDepth;
+	}
+
+	bool CdiFileHandle::SubmitSectorReads(CdiSectorReadRequest **ppRequests, DWORD dwCount)
+	{
+		// Make sure the image is open and there is room in the queue for the requests. Other threads may fill the
+		// queue before we submit, in which case the submit below fails.
+		if (this->m_pReadQueue == nullptr || dwCount > this->m_pReadQueue->Depth() - this->m_pReadQueue->Outstanding())
+			return false;
+
+		// Validate each request and setup the raw read for it.
+		IO::AsyncReadRequest **ppIoRequests = new IO::AsyncReadRequest*[dwCount];
+		for (DWORD i = 0; i < dwCount; i++)
+		{
+			CdiSectorReadRequest *pRequest = ppRequests[i];
+			pRequest->pbStagingBuffer = nullptr;
+			pRequest->bSuccess = false;
+			pRequest->sOwner = std::this_thread::get_id();
+
+			// Check that the sectors are inside of the track and the read is not too large.
+			const CdiTrackOffsetInfo *pOffsetInfo = GetTrackOffsetInfo(pRequest->dwSessionNumber, pRequest->dwTrackNumber);
+			CdiTrack *pTrack = (pOffsetInfo != nullptr ? &this->m_sSessions[pRequest->dwSessionNumber].psTracks[pRequest->dwTrackNumber] : nullptr);
+			if (pTrack == nullptr || pRequest->dwLBA < pTrack->dwLba || pRequest->dwLBA - pTrack->dwLba > pTrack->dwLength ||
+				pRequest->dwSectorCount > pTrack->dwLength - (pRequest->dwLBA - pTrack->dwLba) ||
+				pRequest->dwSectorCount > CDI_MAX_READ_SIZE / pOffsetInfo->dwSectorStride)
+			{
+				// Print an error, undo the requests we already setup, and return.
+				printf("CdiFileHandle::SubmitSectorReads(): request %d is invalid!\n", i);
+				FreeRequestStagingBuffers(ppRequests, i);
+
+				delete[] ppIoRequests;
+				return false;
+			}
+
+			// Audio tracks and cooked data tracks can be read straight into the output buffer, everything else goes into
+			// a staging buffer so the headers can be stripped when the read completes.
+			pRequest->dwSectorStride = pOffsetInfo->dwSectorStride;
+			pRequest->dwHeaderSize = pOffsetInfo->dwHeaderSize;
+			pRequest->sIoRequest.qwOffset = pOffsetInfo->qwDataOffset + ((ULONGLONG)(pRequest->dwLBA - pTrack->dwLba) * pOffsetInfo->dwSectorStride);
+			pRequest->sIoRequest.dwSize = pRequest->dwSectorCount * pOffsetInfo->dwSectorStride;
+			pRequest->sIoRequest.pContext = pRequest;
+			pRequest->sIoRequest.pBuffer = pRequest->pbBuffer;
+
+			// Write out any buffered writes to the sectors before the device reads them.
+			if (this->m_sWriteBuffer.FlushRange(pRequest->sIoRequest.qwOffset, pRequest->sIoRequest.dwSize) == false)
+			{
+				// Print an error, undo the requests we already setup, and return.
+				printf("CdiFileHandle::SubmitSectorReads(): failed to write buffered sectors!\n");
+				FreeRequestStagingBuffers(ppRequests, i);
+
+				delete[] ppIoRequests;
+				return false;
+			}
+			if (pTrack->eMode != CdiTrackMode::Audio && pOffsetInfo->dwSectorStride != RAW_SECTOR_SIZE)
+			{
+				// Take a buffer from the staging buffer pool if the read fits in one, only oversized reads get a buffer of their own.
+				if (pRequest->sIoRequest.dwSize <= this->m_dwStagingBufferSize)
+					pRequest->pbStagingBuffer = AcquireStagingBuffer();
+				else
+					pRequest->pbStagingBuffer = (PBYTE)AlignedAlloc(pRequest->sIoRequest.dwSize);
+				if (pRequest->pbStagingBuffer == nullptr)
+				{
+					// Print an error, undo the requests we already setup, and return.
+					printf("CdiFileHandle::SubmitSectorReads(): failed to allocate staging buffer!\n");
+					FreeRequestStagingBuffers(ppRequests, i);
+
+					delete[] ppIoRequests;
+					return false;
+				}
+
+				pRequest->sIoRequest.pBuffer = pRequest->pbStagingBuffer;
+			}
+
+			ppIoRequests[i] = &pRequest->sIoRequest;
+		}
+
+		// Count the requests against the calling thread before they are submitted, another thread may pick up their
+		// completions before Submit() returns.
+		{
+			std::lock_guard<std::mutex> lock(this->m_ReadQueueLock);
+			this->m_mReadCompletions[std::this_thread::get_id()].dwOutstanding += dwCount;
+		}
+
+		// Submit the raw reads, if that fails release the staging buffers.
+		bool bResult = this->m_pReadQueue->Submit(ppIoRequests, dwCount);
+		if (bResult == false)
+		{
+			std::lock_guard<std::mutex> lock(this->m_ReadQueueLock);
+			this->m_mReadCompletions[std::this_thread::get_id()].dwOutstanding -= dwCount;
+			FreeRequestStagingBuffers(ppRequests, dwCount);
+		}
+
+		delete[] ppIoRequests;
+		return bResult;
+	}
+
+	void CdiFileHandle::FreeRequestStagingBuffers(CdiSectorReadRequest **ppRequests, DWORD dwCount)
+	{
+		// Release the staging buffer of each request.
+		for (DWORD i = 0; i < dwCount; i++)
+			ReleaseRequestStagingBuffer(ppRequests[i]);
+	}
+
+	void CdiFileHandle::ReleaseRequestStagingBuffer(CdiSectorReadRequest *pRequest)
+	{
+		// Check if the request has a staging buffer.
+		if (pRequest->pbStagingBuffer == nullptr)
+			return;
+
+		// Buffers that fit the pool came from it and go back to it, oversized buffers were allocated just for this request.
+		if (pRequest->sIoRequest.dwSize <= this->m_dwStagingBufferSize)
+			ReleaseStagingBuffer(pRequest->pbStagingBuffer);
+		else
+			AlignedFree(pRequest->pbStagingBuffer);
+		pRequest->pbStagingBuffer = nullptr;
+	}
+
+	DWORD CdiFileHandle::CompleteSectorReads(CdiSectorReadRequest **ppCompleted, DWORD dwMaxCount)
+	{
+		std::unique_lock<std::mutex> lock(this->m_ReadQueueLock);
+
+		// Check if there is anything in flight.
+		if (this->m_pReadQueue == nullptr || dwMaxCount == 0)
+			return 0;
+
+		// Loop until one of the requests submitted by this thread completes.
+		std::thread::id sThreadId = std::this_thread::get_id();
+		while (true)
+		{
+			// Check if any of our requests have been handed to us.
+			auto iter = this->m_mReadCompletions.find(sThreadId);
+			if (iter == this->m_mReadCompletions.end() || (iter->second.dwOutstanding == 0 && iter->second.dCompleted.size() == 0))
+				return 0;
+
+			ReadCompletionList *pList = &iter->second;
+			if (pList->dCompleted.size() > 0)
+			{
+				// Return as many completed requests as we can.
+				DWORD dwCount = 0;
+				while (dwCount < dwMaxCount && pList->dCompleted.size() > 0)
+				{
+					ppCompleted[dwCount++] = pList->dCompleted.front();
+					pList->dCompleted.pop_front();
+				}
+
+				pList->dwOutstanding -= dwCount;
+				if (pList->dwOutstanding == 0 && pList->dCompleted.size() == 0)
+					this->m_mReadCompletions.erase(iter);
+
+				return dwCount;
+			}
+
+			// If another thread is already waiting on the queue wait for it to hand out what completes.
+			if (this->m_bReapingReads == true)
+			{
+				this->m_ReadsCompleted.wait(lock);
+				continue;
+			}
+
+			// Wait on the queue ourselves, without holding the lock so other threads can keep submitting.
+			this->m_bReapingReads = true;
+			lock.unlock();
+			DWORD dwCount = this->m_pReadQueue->WaitForCompletions(this->m_vReapedReads.data(), (DWORD)this->m_vReapedReads.size());
+
+			// Finish each request that completed.
+			for (DWORD i = 0; i < dwCount; i++)
+			{
+				CdiSectorReadRequest *pRequest = (CdiSectorReadRequest*)this->m_vReapedReads[i]->pContext;
+				pRequest->bSuccess = this->m_vReapedReads[i]->bSuccess;
+
+				// If the sectors were read into a staging buffer strip the headers and copy the user data to the output buffer.
+				if (pRequest->pbStagingBuffer != nullptr)
+				{
+					if (pRequest->bSuccess == true)
+					{
+						PBYTE pbRawSector = &pRequest->pbStagingBuffer[pRequest->dwHeaderSize];
+						for (DWORD x = 0; x < pRequest->dwSectorCount; x++)
+						{
+							memcpy(&pRequest->pbBuffer[x * RAW_SECTOR_SIZE], pbRawSector, RAW_SECTOR_SIZE);
+							pbRawSector += pRequest->dwSectorStride;
+						}
+					}
+
+					ReleaseRequestStagingBuffer(pRequest);
+				}
+			}
+
+			// Hand the requests out to the threads that submitted them.
+			lock.lock();
+			for (DWORD i = 0; i < dwCount; i++)
+			{
+				CdiSectorReadRequest *pRequest = (CdiSectorReadRequest*)this->m_vReapedReads[i]->pContext;
+				this->m_mReadCompletions[pRequest->sOwner].dCompleted.push_back(pRequest);
+			}
+			this->m_bReapingReads = false;
+			this->m_ReadsCompleted.notify_all();
+
+			// The queue only comes back empty handed if it failed.
+			if (dwCount == 0)
+			{
+				printf("CdiFileHandle::CompleteSectorReads(): failed to wait for reads to complete!\n");
+				return 0;
+			}
+		}
+	}
+
+	PBYTE CdiFileHandle::AcquireStagingBuffer()
+	{
+		// Check if there is a free staging buffer we can reuse.
+		{
+			std::lock_guard<std::mutex> lock(this->m_StagingBufferLock);
+			if (this->m_vStagingBuffers.size() > 0)
+			{
+				PBYTE pbBuffer = this->m_vStagingBuffers.back();
+				this->m_vStagingBuffers.pop_back();
+				return pbBuffer;
+			}
+		}
+
+		// All of the staging buffers are in use, allocate a new one large enough to hold a full chunk of the largest sector size.
+		return (PBYTE)AlignedAlloc(this->m_dwStagingBufferSize);
+	}
+
+	void CdiFileHandle::ReleaseStagingBuffer(PBYTE pbBuffer)
+	{
+		// Put the buffer back on the free list.
+		std::lock_guard<std::mutex> lock(this->m_StagingBufferLock);
+		this->m_vStagingBuffers.push_back(pbBuffer);
+	}
+
+	void CdiFileHandle::FreeStagingBuffers()
+	{
+		// Free all of the buffers on the free list.
+		std::lock_guard<std::mutex> lock(this->m_StagingBufferLock);
+		for (size_t i = 0; i < this->m_vStagingBuffers.size(); i++)
+			AlignedFree(this->m_vStagingBuffers[i]);
+		this->m_vStagingBuffers.clear();
+	}
+
+	void CdiFileHandle::SetReadChunkSize(DWORD dwSectorCount)
+	{
+		// Make sure we always read at least one sector at a time.
+		if (dwSectorCount == 0)
+			dwSectorCount = 1;
+
+		// Free the staging buffers, they will be reallocated using the new chunk size on the next read.
+		FreeStagingBuffers();
+
+		// Save the new chunk size.
+		this->m_dwReadChunkSectors = dwSectorCount;
+		this->m_dwStagingBufferSize = dwSectorCount * CdiSectorSize::Size_2448;
+	}
+
+	bool CdiFileHandle::WriteSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount)
+	{
+		// Check that the session number and track number are valid.
+		const CdiTrackOffsetInfo *pOffsetInfo = GetTrackOffsetInfo(dwSessionNumber, dwTrackNumber);
+		if (pOffsetInfo == nullptr)
+			return false;
+
+		// Check to make sure the data to be written wont go before the start or beyond the end of the track. The
+		// write buffer defers the actual write, so a bad LBA has to be caught here or it would silently land in
+		// the next track when the buffer is flushed.
+		CdiTrack *pTargetTrack = &this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber];
+		if (dwLBA < pTargetTrack->dwLba || dwLBA - pTargetTrack->dwLba > pTargetTrack->dwLength ||
+			dwSectorCount > pTargetTrack->dwLength - (dwLBA - pTargetTrack->dwLba))
+		{
+			// Print an error and return.
+			printf("CdiFileHandle::WriteSectors(): write operation would go beyond the length of the track!\n");
+			return false;
+		}
+
+		// Compute the offset of the target LBA using the offset table.
+		ULONGLONG qwTargetOffset = pOffsetInfo->qwDataOffset + ((ULONGLONG)(dwLBA - pTargetTrack->dwLba) * pOffsetInfo->dwSectorStride);
+
+		// Audio sectors have no header to skip so they can be staged in one go.
+		if (pTargetTrack->eMode == CdiTrackMode::Audio)
+		{
+			// Stage the raw sectors in the write buffer.
+			if (this->m_sWriteBuffer.Write(qwTargetOffset, pbBuffer, dwSectorCount * pOffsetInfo->dwSectorStride) == false)
+			{
+				// Failed to write the sectors to the file.
+				printf("CdiFileHandle::WriteSectors(): failed to write sectors! LBA=%d, Count=%d, Size=%d!\n",
+					dwLBA, dwSectorCount, pTargetTrack->eSectorSize);
+				return false;
+			}
+
+			// Update any cached copies of the sectors and return.
+			this->m_sSectorCache.Update(dwSessionNumber, dwTrackNumber, dwLBA, dwSectorCount, pOffsetInfo->dwSectorStride, pbBuffer);
+			return true;
+		}
+
+		// Tracks that only store the user data can be staged as is. Everything else stores a header and EDC/ECC
+		// around the user data, stage the raw sectors so the write buffer sees one contiguous run instead of a
+		// short write per sector.
+		if (pOffsetInfo->dwHeaderSize == 0 && pOffsetInfo->dwSectorStride == RAW_SECTOR_SIZE)
+		{
+			// Stage the sectors in the write buffer.
+			if (this->m_sWriteBuffer.Write(qwTargetOffset, pbBuffer, dwSectorCount * RAW_SECTOR_SIZE) == false)
+			{
+				// Failed to write the sectors to the file.
+				printf("CdiFileHandle::WriteSectors(): failed to write sectors! LBA=%d, Count=%d, Size=%d!\n",
+					dwLBA, dwSectorCount, pTargetTrack->eSectorSize);
+				return false;
+			}
+		}
+		else if (WriteRawDataSectors(pTargetTrack, pOffsetInfo, dwLBA, pbBuffer, dwSectorCount) == false)
+			return false;
+
+		// Update any cached copies of the sectors.
+		this->m_sSectorCache.Update(dwSessionNumber, dwTrackNumber, dwLBA, dwSectorCount, RAW_SECTOR_SIZE, pbBuffer);
+
+		// Done, successfully wrote the sectors to file.
+		return true;
+	}
+
+	ArrayView<CdiSession> CdiFileHandle::GetSessions()
+	{
+		// Return a view over our session array.
+		return ArrayView<CdiSession>(this->m_sSessions, this->m_wSessionCount);
+	}
+
+	const CdiDescriptorStatus& CdiFileHandle::GetDescriptorStatus()
+	{
+		// Return the status of the last session descriptor we read.
+		return this->m_sDescriptorStatus;
+	}
+
+	void CdiFileHandle::AdviseSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, IO::BlockDeviceAccessHint eHint)
+	{
+		// Check that the session number and track number are valid.
+		const CdiTrackOffsetInfo *pOffsetInfo = GetTrackOffsetInfo(dwSessionNumber, dwTrackNumber);
+		if (pOffsetInfo == nullptr)
+			return;
+
+		// Compute the range of the image the sectors cover and pass the hint on to the device.
+		ULONGLONG qwOffset = pOffsetInfo->qwDataOffset + ((ULONGLONG)(dwLBA - this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber].dwLba) * pOffsetInfo->dwSectorStride);
+		this->m_pDevice->Advise(qwOffset, (ULONGLONG)dwSectorCount * pOffsetInfo->dwSectorStride, eHint);
+	}
+
+	const CdiTrackOffsetInfo *CdiFileHandle::GetTrackOffsetInfo(DWORD dwSessionNumber, DWORD dwTrackNumber)
+	{
+		// Check that the session number and track number are valid.
+		if (dwSessionNumber >= this->m_wSessionCount || dwTrackNumber >= this->m_sSessions[dwSessionNumber].wTrackCount)
+			return nullptr;
+
+		// Look up the track in the offset table.
+		return &this->m_psTrackOffsets[this->m_pdwSessionTrackIndex[dwSessionNumber] + dwTrackNumber];
+	}
+
+	CdiTrackHandle *CdiFileHandle::OpenTrackHandle(DWORD dwSessionNumber, DWORD dwTrackNumber)
+	{
+		// Check that the session number is valid.
+		if (dwSessionNumber < 0 || dwSessionNumber >= this->m_wSessionCount)
+		{
+			// The session number is invalid, print an error and return.
+			printf("CdiFileHandle::OpenTrackHandle(): session number specified is invalid!\n");
+			return nullptr;
+		}
+
+		// Check that the track number is valid.
+		if (dwTrackNumber < 0 || dwTrackNumber >= this->m_sSessions[dwSessionNumber].wTrackCount)
+		{
+			// The track number is invalid, print an error and return.
+			printf("CdiFileHandle::OpenTrackHandle(): track number specified is invalid!\n");
+			return nullptr;
+		}
+
+		// Create a new track handle and initialize it to the track specified.
+		CdiTrackHandle *pTrackHandle = new CdiTrackHandle();
+		pTrackHandle->dwSessionNumber = dwSessionNumber;
+		pTrackHandle->dwTrackNumber = dwTrackNumber;
+		pTrackHandle->pFileHandle = this;
+		pTrackHandle->pTrack = &this->m_sSessions[dwSessionNumber].psTracks[dwTrackNumber];
+		pTrackHandle->pOffsetInfo = GetTrackOffsetInfo(dwSessionNumber, dwTrackNumber);
+		pTrackHandle->dwCursorLBA = 0;
+		pTrackHandle->pReadAhead = nullptr;
+		pTrackHandle->dwLastReadEndLBA = 0xFFFFFFFF;
+		pTrackHandle->dwSequentialReads = 0;
+		pTrackHandle->dwReadAheadChunkSectors = 0;
+		pTrackHandle->dwReadAheadChunkCount = 0;
+		pTrackHandle->pbVectorBuffer = nullptr;
+
+		// Return the track handle.
+		return pTrackHandle;
+	}
+
+	void CdiFileHandle::CloseTrackHandle(CdiTrackHandle *pTrackHandle)
+	{
+		// Stop any read ahead and free the handle allocations.
+		pTrackHandle->DisableReadAhead();
+		if (pTrackHandle->pbVectorBuffer != nullptr)
+			AlignedFree(pTrackHandle->pbVectorBuffer);
+		delete pTrackHandle;
+	}
 };
\ No newline at end of file
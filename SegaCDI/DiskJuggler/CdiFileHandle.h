@@ -1,287 +1,966 @@
-/*
-	SegaCDI - Sega Dreamcast cdi image validator.
-
-	CdiFileHandle.h - File system reading and writing functions for
-		Disk Juggler images.
-
-	Dec 15th, 2015
-		- Initial creation.
-*/
-
-#pragma once
-#include "../stdafx.h"
-#include "../Misc/FlatMemoryIterator.h"
-#include "..\Misc\DisjointCollection.h"
-
-namespace DiskJuggler
-{
-	// Forward declarations.
-	class CdiFileHandle;
-
-	#define RAW_SECTOR_SIZE		2048
-
-	//-----------------------------------------------------
-	// CDI Track Definitions
-	//-----------------------------------------------------
-	enum CdiTrackMode : int
-	{
-		Audio,
-		Mode1,
-		Mode2
-	};
-
-	enum CdiSectorType : int
-	{
-		Type_2048 = 0,
-		Type_2336 = 1,
-		Type_2352 = 2,
-		Type_2368 = 3,
-		Type_2448 = 4
-	};
-
-	enum CdiSectorSize : int
-	{
-		Size_2048 = 2048,
-		Size_2336 = 2336,
-		Size_2352 = 2352,
-		Size_2368 = 2368,
-		Size_2448 = 2448
-	};
-
-	struct CdiTrack
-	{
-		DWORD dwTrackNumber;			// The track number for this track in the current session
-
-		BYTE bFileNameLength;			// Length of the file name
-		CHAR *psFileName;				// The file name of this track
-
-		DWORD dwPregapLength;			// Size of the track pregap in sectors
-		DWORD dwLength;					// Size of the track in sectors
-
-		CdiTrackMode eMode;				// Mode of the track
-
-		DWORD dwLba;					// Layer break address of the track
-		DWORD dwTotalLength;			// Size of the track including the pregap length in sectors
-
-		CdiSectorType eSectorType;		// Type of sector, used to determine the sector size
-		CdiSectorSize eSectorSize;		// Size of a single sector
-
-		CdiTrack() 
-		{
-			// Initialize fields.
-			this->dwTrackNumber = 0;
-			this->bFileNameLength = 0;
-			this->psFileName = nullptr;
-			this->dwPregapLength = 0;
-			this->dwLength = 0;
-			this->eMode = (CdiTrackMode)0;
-			this->dwLba = 0;
-			this->dwTotalLength = 0;
-			this->eSectorType = (CdiSectorType)0;
-			this->eSectorSize = (CdiSectorSize)0;
-		}
-
-		CdiTrack(const CdiTrack& other)
-		{
-			// Initialize fields.
-			this->dwTrackNumber = other.dwTrackNumber;
-			this->bFileNameLength = other.bFileNameLength;
-			this->psFileName = new CHAR[this->bFileNameLength + 1];
-			memcpy(this->psFileName, other.psFileName, this->bFileNameLength);
-			this->dwPregapLength = other.dwPregapLength;
-			this->dwLength = other.dwLength;
-			this->eMode = other.eMode;
-			this->dwLba = other.dwLba;
-			this->dwTotalLength = other.dwTotalLength;
-			this->eSectorType = other.eSectorType;
-			this->eSectorSize = other.eSectorSize;
-		}
-	};
-
-	//-----------------------------------------------------
-	// CdiTrackHandle
-	//-----------------------------------------------------
-	class CdiTrackHandle
-	{
-		friend class CdiFileHandle;
-	private:
-		CdiFileHandle *pFileHandle;		// CDI image file handle this handle is to be used with
-		DWORD dwSessionNumber;			// Session number this handle is located in
-		DWORD dwTrackNumber;			// Track number this handle is located in
-		CdiTrack *pTrack;				// CDI track structure this handle is for
-
-	public:
-		/*
-			Description: Gets the base LBA for this track.
-		*/
-		DWORD LBA();
-
-		DWORD TrackSize();
-
-		/*
-			Description: Reads dwSize number of bytes from the track stream at dwLBA.
-
-			Parameters:
-				dwLBA: LBA to begin reading at, relative to the start of the track.
-				pbBuffer: Buffer to read data into.
-				dwSize: Size of data to be read.
-
-			Returns: True if the data was successfully read from the track, false otherwise.
-		*/
-		bool ReadData(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSize);
-
-		/*
-			Description: Writes dwSize number of bytes to the track stream at dwLBA.
-
-			Parameters:
-				dwLBA: LBA to begin writing at, relative to the start of the track.
-				pbBuffer: Buffer containing the sector data to be written.
-				dwSize: Number of bytes to be written.
-
-			Returns: True if the data was successfully written to the track, false otherwise.
-		*/
-		bool WriteData(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSize);
-	};
-
-	//-----------------------------------------------------
-	// CDI Session Definitions
-	//-----------------------------------------------------
-	enum CdiSessionDescriptorType : unsigned int
-	{
-		Type1 = 0x80000004,		// Helper value is offset of session descriptor
-		Type2 = 0x80000005,		// Helper value is offset of session descriptor
-		Type3 = 0x80000006		// Helper value is size of session descriptor
-	};
-
-	struct CdiSessionDescriptorInfo
-	{
-		CdiSessionDescriptorType eDescriptorType;		// Type of this session descriptor block
-		DWORD dwDescriptorHelper;						// This is either the size of the descriptor or the offset of it
-	};
-
-	struct CdiSession
-	{
-		DWORD dwSessionNumber;			// The session number for this session
-
-		WORD wTrackCount;				// Number of tracks in this session
-		CdiTrack *psTracks;				// Array of tracks in this session
-
-		CdiSession() 
-		{ 
-			// Initialize fields.
-			this->dwSessionNumber = 0;
-			this->wTrackCount = 0;
-			this->psTracks = nullptr;
-		}
-
-		CdiSession(const CdiSession& other)
-		{
-			// Initialize fields.
-			this->dwSessionNumber = other.dwSessionNumber;
-			this->wTrackCount = other.wTrackCount;
-
-			this->psTracks = new CdiTrack[this->wTrackCount];
-			for (int i = 0; i < this->wTrackCount; i++)
-				this->psTracks[i] = CdiTrack(other.psTracks[i]);
-		}
-	};
-
-	//-----------------------------------------------------
-	// CdiFileHandle
-	//-----------------------------------------------------
-	class CdiFileHandle
-	{
-	protected:
-		CString		m_sFileName;					// Cdi image file path
-		HANDLE		m_hFile;						// Image handle
-		DWORD		m_dwFileSize;					// Size of the cdi image
-
-		DWORD		m_dwCurrentLBA;					// Current offset in the input file, used for sequential reads/writes
-
-		// Descriptor information.
-		WORD		m_wSessionCount;				// Number of sessions in the image
-		CdiSession	*m_sSessions;					// Session info array
-		DisjointCollection<CdiSession> *m_pSessionCollection;	// Publicly accessible collection of CdiSession objects
-
-		/*
-		*/
-		bool ParseSessionDescriptor(PBYTE pbSessionDescriptor, DWORD dwDescriptorSize, CdiSessionDescriptorType eDescriptorType, bool bVerbose);
-
-	public:
-		CdiFileHandle();
-		~CdiFileHandle();
-
-		/*
-			Description: Opens the CDI image file for processing and parses the session descriptor for the image.
-
-			Parameters:
-				sFileName: File name of the image file.
-				bWrite: Boolean indicating that the image file should be opened for writing.
-				bVerbose: Boolean indicating if verbose information should be printed to the console while reading.
-
-			Returns: True if the image was successfully opened and the session descriptor was parsed without errors, false otherwise.
-		*/
-		bool Open(CString sFileName, bool bWrite, bool bVerbose);
-
-		/*
-			Description: Closes the image file and flushes any buffers from memory.
-		*/
-		void Close();
-
-		/*
-			Description: Reads dwSectorCount number of sectors into buffer pbBuffer at LBA dwLBA in track dwTrackNumber of session dwSessionNumber.
-
-			Parameters:
-				dwSessionNumber: Session number that track dwTrackNumber is located in.
-				dwTrackNumber: Track number to read from.
-				dwLBA: LBA to start reading at relative to the beginning of the image file.
-				pbBuffer: Buffer to read the sectors into. Buffer should be a multiple of RAW_SECTOR_SIE if the track is a 
-					Mode1/Mode2 data track, or a multiple of the track's sector size if the track is an Audio track.
-				dwSectorCount: Number of sectors to read from the track.
-
-			Returns: True if the sectors are successfully read from the track, false otherwise.
-		*/
-		bool ReadSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount);
-
-		/*
-			Description: Writes dwSectorCount sectors from buffer pbBuffer at LBA dwLBA in track dwTrackNumber of session dwSessionNumber.
-
-			Parameters:
-				dwSessionNumber: Session number that track dwTrackNumber is located in.
-				dwTrackNumber: Track number to write to.
-				dwLBA: LBA to start writing at relative to the beginning of the image file.
-				pbBuffer: Buffer containing the sector data to be written. Buffer should be a multiple of RAW_SECTOR_SIE if the track is a 
-					Mode1/Mode2 data track, or a multiple of the track's sector size if the track is an Audio track.
-				dwSectorCount: Number of sectors to write to the track.
-
-			Returns: True if the sector data is successfully written to the track, false otherwise.
-		*/
-		bool WriteSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount);
-
-		/*
-			Description: Gets a collection of CdiSession's found in the cdi image file.
-
-			Returns: A DisjointCollection<CdiSession> instance.
-		*/
-		DisjointCollection<CdiSession>& GetSessionsCollection();
-
-		/*
-			Description: Opens a track handle on the specified track in the specified session.
-
-			Parameters:
-				dwSessionNumber: session number the track is located in.
-				dwTrackNumber: track number to open.
-
-			Returns: A CdiTrackHandle object is the track was successfully opened, nullptr otherwise.
-		*/
-		CdiTrackHandle *OpenTrackHandle(DWORD dwSessionNumber, DWORD dwTrackNumber);
-
-		/*
-			Description: Closes an opened track handle.
-
-			Parameters:
-				pTrackHandle: the track handle to close.
-		*/
-		void CloseTrackHandle(CdiTrackHandle *pTrackHandle);
-	};
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiFileHandle.h - File system reading and writing functions for
+		Disk Juggler images.
+
+	Dec 15th, 2015
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "../Misc/FlatMemoryIterator.h"
+#include "..\Misc\ArrayView.h"
+#include "..\IO\BlockDevice.h"
+#include "..\IO\AsyncReadQueue.h"
+#include "CdiSectorCache.h"
+#include "CdiReadAhead.h"
+#include "CdiWriteBuffer.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace DiskJuggler
+{
+	// Forward declarations.
+	class CdiFileHandle;
+	class CdiReadAhead;
+	class CdiSidecarIndex;
+
+	#define RAW_SECTOR_SIZE		2048
+
+	// Default number of sectors read from the image file in a single read call.
+	#define CDI_DEFAULT_READ_CHUNK_SECTORS		256
+
+	// Maximum number of bytes read from the image file in a single read call.
+	#define CDI_MAX_READ_SIZE					0x4000000
+
+	// Segments of a vectored read that are less than this many sectors apart are merged into one read, reading
+	// the gap is cheaper than issuing another read call.
+	#define CDI_VECTOR_READ_MAX_GAP				16
+
+	// Maximum number of sectors in a merged vectored read.
+	#define CDI_VECTOR_READ_MAX_SECTORS			512
+
+	// Upper limit for the size of the session descriptor, anything larger is treated as corrupt.
+	#define CDI_MAX_SESSION_DESCRIPTOR_SIZE		0x1000000
+
+	// Smallest number of bytes a session and a track take up in the session descriptor. Used to bound the number of
+	// sessions and tracks a descriptor of a given size can hold.
+	#define CDI_SESSION_DESCRIPTOR_MIN_SIZE		(2 + 12)
+	#define CDI_TRACK_DESCRIPTOR_MIN_SIZE		(29 + 19 + 93)
+
+	//-----------------------------------------------------
+	// CDI Track Definitions
+	//-----------------------------------------------------
+	enum CdiTrackMode : int
+	{
+		Audio,
+		Mode1,
+		Mode2
+	};
+
+	enum CdiSectorType : int
+	{
+		Type_2048 = 0,
+		Type_2336 = 1,
+		Type_2352 = 2,
+		Type_2368 = 3,
+		Type_2448 = 4
+	};
+
+	enum CdiSectorSize : int
+	{
+		Size_2048 = 2048,
+		Size_2336 = 2336,
+		Size_2352 = 2352,
+		Size_2368 = 2368,
+		Size_2448 = 2448
+	};
+
+	struct CdiTrack
+	{
+		DWORD dwTrackNumber;			// The track number for this track in the current session
+
+		BYTE bFileNameLength;			// Length of the file name
+		CHAR *psFileName;				// The file name of this track
+
+		DWORD dwPregapLength;			// Size of the track pregap in sectors
+		DWORD dwLength;					// Size of the track in sectors
+
+		CdiTrackMode eMode;				// Mode of the track
+
+		DWORD dwLba;					// Layer break address of the track
+		DWORD dwTotalLength;			// Size of the track including the pregap length in sectors
+
+		CdiSectorType eSectorType;		// Type of sector, used to determine the sector size
+		CdiSectorSize eSectorSize;		// Size of a single sector
+
+		CdiTrack() 
+		{
+			// Initialize fields.
+			this->dwTrackNumber = 0;
+			this->bFileNameLength = 0;
+			this->psFileName = nullptr;
+			this->dwPregapLength = 0;
+			this->dwLength = 0;
+			this->eMode = (CdiTrackMode)0;
+			this->dwLba = 0;
+			this->dwTotalLength = 0;
+			this->eSectorType = (CdiSectorType)0;
+			this->eSectorSize = (CdiSectorSize)0;
+		}
+	};
+
+	//-----------------------------------------------------
+	// CDI Track Offset Table
+	//-----------------------------------------------------
+	struct CdiTrackOffsetInfo
+	{
+		ULONGLONG qwPregapOffset;		// File offset of the start of the track pregap
+		ULONGLONG qwDataOffset;			// File offset of the first sector of the track (sector at dwLba)
+		DWORD dwSectorStride;			// Size of a single sector in the image file
+		DWORD dwHeaderSize;				// Number of header bytes preceding the user data in each sector
+	};
+
+	//-----------------------------------------------------
+	// CdiSectorView
+	//-----------------------------------------------------
+	struct CdiSectorView
+	{
+		PBYTE pbData;					// Pointer to the user data of the first sector in the view
+		DWORD dwSectorStride;			// Distance in bytes between the user data of two consecutive sectors
+		DWORD dwSectorSize;				// Size of the user data in each sector
+		DWORD dwSectorCount;			// Number of sectors in the view
+
+		CdiSectorView()
+		{
+			// Initialize fields.
+			this->pbData = nullptr;
+			this->dwSectorStride = 0;
+			this->dwSectorSize = 0;
+			this->dwSectorCount = 0;
+		}
+
+		/*
+			Description: Gets a pointer to the user data of sector dwIndex in the view.
+		*/
+		PBYTE Sector(DWORD dwIndex)
+		{
+			return this->pbData + ((SIZE_T)dwIndex * this->dwSectorStride);
+		}
+
+		/*
+			Description: Gets a boolean indicating if the user data of all the sectors in the view is laid out
+				back to back, in which case the view can be used as a single buffer of Size() bytes.
+		*/
+		bool IsContiguous()
+		{
+			return this->dwSectorStride == this->dwSectorSize;
+		}
+
+		/*
+			Description: Gets the total size of the user data in the view.
+		*/
+		SIZE_T Size()
+		{
+			return (SIZE_T)this->dwSectorCount * this->dwSectorSize;
+		}
+	};
+
+	//-----------------------------------------------------
+	// CdiReadSegment
+	//-----------------------------------------------------
+	/*
+		Segment of a vectored read, see CdiTrackHandle::ReadVector().
+	*/
+	struct CdiReadSegment
+	{
+		DWORD dwLBA;					// LBA to begin reading at, relative to the start of the track
+		DWORD dwSize;					// Number of bytes to read
+		PBYTE pbBuffer;					// Buffer to read the data into
+		bool bSuccess;					// Set when the read completes, true if the data was read
+	};
+
+	/*
+		Asynchronous sector read request, see CdiFileHandle::SubmitSectorReads().
+	*/
+	struct CdiSectorReadRequest
+	{
+		DWORD dwSessionNumber;			// Session number that track dwTrackNumber is located in
+		DWORD dwTrackNumber;			// Track number to read from
+		DWORD dwLBA;					// LBA to start reading at, same as CdiFileHandle::ReadSectors()
+		DWORD dwSectorCount;			// Number of sectors to read
+		PBYTE pbBuffer;					// Buffer to read the sectors into, same layout as CdiFileHandle::ReadSectors()
+		PVOID pContext;					// Caller defined value
+		bool bSuccess;					// Set when the request completes, true if all of the sectors were read
+
+		// Used internally while the request is in flight.
+		IO::AsyncReadRequest sIoRequest;	// Read request for the raw sectors
+		std::thread::id sOwner;			// Thread that submitted the request, only that thread gets its completion
+		PBYTE pbStagingBuffer;			// Buffer the raw sectors are read into when the headers need to be stripped
+		DWORD dwSectorStride;			// Size of each raw sector in the image
+		DWORD dwHeaderSize;				// Size of the header to strip from each raw sector
+	};
+
+	//-----------------------------------------------------
+	// CdiTrackHandle
+	//-----------------------------------------------------
+	class CdiTrackHandle
+	{
+		friend class CdiFileHandle;
+	private:
+		CdiFileHandle *pFileHandle;		// CDI image file handle this handle is to be used with
+		DWORD dwSessionNumber;			// Session number this handle is located in
+		DWORD dwTrackNumber;			// Track number this handle is located in
+		CdiTrack *pTrack;				// CDI track structure this handle is for
+		const CdiTrackOffsetInfo *pOffsetInfo;	// Offset table entry for this track
+		DWORD dwCursorLBA;				// Next LBA to be read by ReadNext(), relative to the start of the track
+
+		// Read ahead.
+		CdiReadAhead *pReadAhead;		// Read ahead engine for the track or nullptr if read ahead is disabled
+		DWORD dwLastReadEndLBA;			// LBA following the last sector read, used to detect sequential access
+		DWORD dwSequentialReads;		// Number of back to back sequential reads
+		DWORD dwReadAheadChunkSectors;	// Settings the read ahead engine was created with
+		DWORD dwReadAheadChunkCount;
+
+		// Byte granular reads and writes.
+		BYTE bScratchSector[CdiSectorSize::Size_2448];	// Partial head and tail sectors are staged here
+		PBYTE pbVectorBuffer;			// Merged vectored reads are staged here, allocated on first use
+
+		/*
+			Description: Reads whole sectors from the track, going through the read ahead engine when the reads
+				are sequential.
+		*/
+		bool ReadTrackSectors(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount);
+
+		/*
+			Description: Gets the number of bytes each sector of the track holds in the track stream, RAW_SECTOR_SIZE
+				for data tracks or the full sector size for audio tracks.
+		*/
+		DWORD SectorDataSize();
+
+	public:
+		/*
+			Description: Gets the base LBA for this track.
+		*/
+		DWORD LBA();
+
+		ULONGLONG TrackSize();
+
+		/*
+			Description: Gets the offset table entry for this track, which can be used to compute the file
+				offset of any sector in the track without going through the CdiFileHandle.
+		*/
+		const CdiTrackOffsetInfo *OffsetInfo();
+
+		/*
+			Description: Computes the file offset of the raw sector at dwLBA.
+
+			Parameters:
+				dwLBA: LBA of the sector, relative to the start of the track.
+
+			Returns: The offset of the raw sector in the image file, including the sector header.
+		*/
+		ULONGLONG SectorOffset(DWORD dwLBA);
+
+		/*
+			Description: Reads dwSize bytes from the track stream starting at byte offset qwOffset. Whole sectors are
+				read straight into pbBuffer, only a partial sector at the start or end of the range is staged in the
+				handle's scratch sector, so unaligned reads don't allocate.
+
+			Parameters:
+				qwOffset: Byte offset to begin reading at, relative to the start of the track stream.
+				pbBuffer: Buffer to read data into.
+				dwSize: Number of bytes to read.
+
+			Returns: True if the data was successfully read from the track, false if the read failed or would go
+				beyond the end of the track.
+		*/
+		bool ReadBytes(ULONGLONG qwOffset, PBYTE pbBuffer, DWORD dwSize);
+
+		/*
+			Description: Writes dwSize bytes to the track stream starting at byte offset qwOffset. Whole sectors are
+				written straight from pbBuffer, a partial sector at the start or end of the range is read, patched and
+				written back so the rest of its data is preserved.
+
+			Parameters:
+				qwOffset: Byte offset to begin writing at, relative to the start of the track stream.
+				pbBuffer: Buffer containing the data to write.
+				dwSize: Number of bytes to write.
+
+			Returns: True if the data was successfully written to the track, false otherwise.
+		*/
+		bool WriteBytes(ULONGLONG qwOffset, PBYTE pbBuffer, DWORD dwSize);
+
+		/*
+			Description: Reads dwSize number of bytes from the track stream at dwLBA.
+
+			Parameters:
+				dwLBA: LBA to begin reading at, relative to the start of the track.
+				pbBuffer: Buffer to read data into.
+				dwSize: Size of data to be read.
+
+			Returns: True if the data was successfully read from the track, false otherwise.
+		*/
+		bool ReadData(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSize);
+
+		/*
+			Description: Reads a batch of segments from the track. The segments are sorted by LBA and segments that
+				are close together are merged, so the batch is read with as few reads as possible. Segments that
+				are not merged with any other segment are read straight into their buffers. Segments that go beyond
+				the end of the track are failed without being read.
+
+			Parameters:
+				psSegments: Segments to read, bSuccess is set on each segment when the batch completes.
+				dwSegmentCount: Number of segments in psSegments.
+
+			Returns: True if every segment was read, false if any segment failed.
+		*/
+		bool ReadVector(CdiReadSegment *psSegments, DWORD dwSegmentCount);
+
+		/*
+			Description: Sets the read cursor used by ReadNext(). Each track handle has its own cursor, so handles on
+				the same image can be read sequentially from different threads.
+
+			Parameters:
+				dwLBA: LBA to move the cursor to, relative to the start of the track.
+		*/
+		void Seek(DWORD dwLBA);
+
+		/*
+			Description: Gets the current position of the read cursor, relative to the start of the track.
+		*/
+		DWORD Tell();
+
+		/*
+			Description: Reads dwSectorCount sectors at the read cursor and advances the cursor past them.
+
+			Parameters:
+				pbBuffer: Buffer to read the sectors into, see CdiFileHandle::ReadSectors() for the required size.
+				dwSectorCount: Number of sectors to read.
+
+			Returns: True if the sectors were read, false otherwise. The cursor is not moved if the read fails.
+		*/
+		bool ReadNext(PBYTE pbBuffer, DWORD dwSectorCount);
+
+		/*
+			Description: Enables read ahead for this track handle. Once the handle sees CDI_READ_AHEAD_SEQUENTIAL_THRESHOLD
+				back to back sequential reads a background thread starts reading chunks of the track ahead of the
+				reader, so reads from the image overlap with whatever the caller does with the data.
+
+			Parameters:
+				dwChunkSectors: Number of sectors to read ahead at a time.
+				dwChunkCount: Number of chunks to read ahead of the reader.
+		*/
+		void EnableReadAhead(DWORD dwChunkSectors = CDI_READ_AHEAD_CHUNK_SECTORS, DWORD dwChunkCount = CDI_READ_AHEAD_CHUNK_COUNT);
+
+		/*
+			Description: Disables read ahead for this track handle and stops the background thread.
+		*/
+		void DisableReadAhead();
+
+		/*
+			Description: Gets a view of dwSectorCount sectors starting at dwLBA directly from the memory mapped
+				image without copying any data. Only available when the image was opened with bMemoryMap set.
+
+			Parameters:
+				dwLBA: LBA to begin the view at, relative to the start of the track.
+				dwSectorCount: Number of sectors in the view.
+				pView: Out pointer for the sector view.
+
+			Returns: True if the view was created, false if the image is not mapped or the sectors are out of range.
+		*/
+		bool ReadDataView(DWORD dwLBA, DWORD dwSectorCount, CdiSectorView *pView);
+
+		/*
+			Description: Writes dwSize number of bytes to the track stream at dwLBA.
+
+			Parameters:
+				dwLBA: LBA to begin writing at, relative to the start of the track.
+				pbBuffer: Buffer containing the sector data to be written.
+				dwSize: Number of bytes to be written.
+
+			Returns: True if the data was successfully written to the track, false otherwise.
+		*/
+		bool WriteData(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSize);
+	};
+
+	//-----------------------------------------------------
+	// CDI Session Definitions
+	//-----------------------------------------------------
+	enum CdiSessionDescriptorType : unsigned int
+	{
+		Type1 = 0x80000004,		// Helper value is offset of session descriptor
+		Type2 = 0x80000005,		// Helper value is offset of session descriptor
+		Type3 = 0x80000006		// Helper value is size of session descriptor
+	};
+
+	struct CdiSessionDescriptorInfo
+	{
+		CdiSessionDescriptorType eDescriptorType;		// Type of this session descriptor block
+		DWORD dwDescriptorHelper;						// This is either the size of the descriptor or the offset of it
+	};
+
+	//-----------------------------------------------------
+	// Session descriptor errors
+	//-----------------------------------------------------
+	enum CdiDescriptorError : int
+	{
+		DescriptorOk,
+		DescriptorReadFailed,			// The descriptor could not be read from the image
+		DescriptorInvalidVersion,		// The descriptor info block has an unknown version
+		DescriptorInvalidSize,			// The descriptor size or offset points outside of the image
+		DescriptorTruncated,			// A session or track runs past the end of the descriptor
+		DescriptorMarkerMismatch,		// The track start marker is missing
+		DescriptorInvalidTrackMode,		// A track has an unknown track mode
+		DescriptorInvalidSectorSize,	// A track has an unknown sector type
+		DescriptorTrackOutOfBounds,		// A track lies outside of the image file
+		DescriptorOutOfMemory			// The metadata could not be allocated
+	};
+
+	/*
+		Describes why the session descriptor of an image was rejected.
+	*/
+	struct CdiDescriptorStatus
+	{
+		CdiDescriptorError eError;		// Error that was hit
+		DWORD dwOffset;					// Offset into the session descriptor the error was found at
+		DWORD dwSessionNumber;			// Session and track that were being parsed
+		DWORD dwTrackNumber;
+	};
+
+	/*
+		Description: Gets a short description of a session descriptor error.
+	*/
+	LPCSTR DescriptorErrorToString(CdiDescriptorError eError);
+
+	struct CdiSession
+	{
+		DWORD dwSessionNumber;			// The session number for this session
+
+		WORD wTrackCount;				// Number of tracks in this session
+		CdiTrack *psTracks;				// Array of tracks in this session
+
+		CdiSession() 
+		{ 
+			// Initialize fields.
+			this->dwSessionNumber = 0;
+			this->wTrackCount = 0;
+			this->psTracks = nullptr;
+		}
+	};
+
+	//-----------------------------------------------------
+	// CdiFileHandle
+	//-----------------------------------------------------
+	class CdiFileHandle
+	{
+	protected:
+		CString		m_sFileName;					// Cdi image file path
+		IO::BlockDevice	*m_pDevice;					// Block device the image is read from
+		ULONGLONG	m_qwFileSize;					// Size of the cdi image
+
+		// Memory mapping.
+		PBYTE		m_pbMappedImage;				// Base address of the mapped image or nullptr if the image is not mapped
+
+		// Descriptor information.
+		WORD		m_wSessionCount;				// Number of sessions in the image
+		CdiSession	*m_sSessions;					// Session info array
+
+		// Once the image is opened the sessions, tracks, track file names and offset table all live in this single
+		// allocation, see CompactMetadata().
+		PBYTE		m_pbMetadata;
+		CdiDescriptorStatus	m_sDescriptorStatus;	// Why the session descriptor was rejected, if it was
+
+		// Offset table.
+		CdiTrackOffsetInfo	*m_psTrackOffsets;		// Offset info for every track in the image, ordered by session then track
+		DWORD		*m_pdwSessionTrackIndex;		// Index into m_psTrackOffsets of the first track in each session
+
+		// Read staging buffers.
+		std::vector<PBYTE>	m_vStagingBuffers;		// Free page aligned buffers raw sectors are read into before the headers are stripped
+		std::mutex	m_StagingBufferLock;			// Protects m_vStagingBuffers so reads can be issued from multiple threads
+		DWORD		m_dwStagingBufferSize;			// Size of each staging buffer
+		DWORD		m_dwReadChunkSectors;			// Number of sectors read into a staging buffer at a time
+
+		// Sector cache shared by all track handles.
+		CdiSectorCache	m_sSectorCache;
+
+		// Asynchronous reads.
+		IO::AsyncReadQueue	*m_pReadQueue;			// Queue used for asynchronous sector reads, created when the image is opened
+		DWORD		m_dwReadQueueDepth;				// Depth to create the read queue with
+		std::mutex	m_ReadQueueLock;				// Protects the read queue and the completion lists below
+		std::condition_variable	m_ReadsCompleted;	// Signaled when completed reads are handed out to their threads
+		bool		m_bReapingReads;				// True while a thread is waiting on the read queue for completions
+		std::vector<IO::AsyncReadRequest*>	m_vReapedReads;	// Completions pulled off of the read queue, only used by the reaping thread
+
+		// Completed asynchronous reads waiting to be picked up by the thread that submitted them.
+		struct ReadCompletionList
+		{
+			DWORD dwOutstanding;						// Requests submitted by the thread that have not been returned yet
+			std::deque<CdiSectorReadRequest*> dCompleted;	// Requests that completed but have not been returned yet
+		};
+		std::unordered_map<std::thread::id, ReadCompletionList>	m_mReadCompletions;
+
+		// Writing.
+		DWORD		m_dwRegenerationFlags;			// CdiSectorRegeneration flags for sectors written to raw data tracks
+		CdiWriteBuffer	m_sWriteBuffer;				// Write behind buffer all sector writes are staged in
+
+		// Sidecar index.
+		bool		m_bUseIndex;					// True if the sidecar index should be used when the image is opened
+		CdiSidecarIndex	*m_pIndex;					// Sidecar index for the image or nullptr if it is not used
+
+		/*
+			Description: Reads the session descriptor from the end of the image and parses it.
+
+			Returns: True if the session descriptor was read and parsed without errors, false otherwise.
+		*/
+		bool ReadSessionDescriptor(bool bVerbose);
+
+		/*
+			Description: Parses the session descriptor in a single pass straight into the metadata arena. Every
+				read is checked against the size of the descriptor, so a corrupt or unknown descriptor is rejected
+				with an error in m_sDescriptorStatus instead of reading past the end of the buffer.
+
+			Returns: True if the session descriptor was parsed without errors, false otherwise.
+		*/
+		bool ParseSessionDescriptor(PBYTE pbSessionDescriptor, DWORD dwDescriptorSize, CdiSessionDescriptorType eDescriptorType, bool bVerbose);
+
+		/*
+			Description: Records and prints an error found while reading the session descriptor.
+
+			Returns: Always false so it can be returned straight from the caller.
+		*/
+		bool DescriptorError(CdiDescriptorError eError, DWORD dwOffset, DWORD dwSessionNumber, DWORD dwTrackNumber);
+
+		/*
+			Description: Builds the track offset table from the parsed session info so that seeking to a sector
+				does not require walking all of the preceding sessions and tracks.
+
+			Returns: True if the offset table was built, false if a track lies outside of the image file or its
+				offset cannot be represented.
+		*/
+		bool BuildTrackOffsetTable();
+
+		/*
+			Description: Moves the session array, track arrays, track file names and offset table into a single
+				allocation so the metadata is contiguous in memory and can be freed in one go. Does nothing if the
+				metadata was parsed straight into an arena.
+
+			Returns: True if the metadata was moved, false if the allocation failed.
+		*/
+		bool CompactMetadata();
+
+		/*
+			Description: Frees the session array, track arrays and offset table, whether they were compacted or not.
+		*/
+		void FreeMetadata();
+
+		/*
+			Description: Reads dwSectorCount raw sectors of size dwSectorSize starting at offset qwOffset in the image
+				using as few read calls as possible.
+
+			Returns: True if all of the data was read, false otherwise.
+		*/
+		bool ReadImageData(ULONGLONG qwOffset, PBYTE pbBuffer, DWORD dwSectorCount, DWORD dwSectorSize);
+
+		/*
+			Description: Reads sectors from the image device, bypassing the sector cache. The LBA and sector count
+				must already be validated against the track.
+
+			Returns: True if the sectors were read, false otherwise.
+		*/
+		bool ReadSectorsFromDevice(const CdiTrack *pTargetTrack, const CdiTrackOffsetInfo *pOffsetInfo, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount);
+
+		/*
+			Description: Writes the user data of sectors on a data track that stores more than the user data of each
+				sector. The raw sectors are read, patched, rebuilt using m_dwRegenerationFlags if the track carries an
+				EDC/ECC, and staged in the write buffer a chunk at a time so the headers go out with the user data in
+				one contiguous write. The LBA and sector count must already be validated against the track.
+
+			Returns: True if the sectors were written, false otherwise.
+		*/
+		bool WriteRawDataSectors(const CdiTrack *pTargetTrack, const CdiTrackOffsetInfo *pOffsetInfo, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount);
+
+		/*
+			Description: Frees the staging buffers of asynchronous read requests that could not be submitted.
+		*/
+		void FreeRequestStagingBuffers(CdiSectorReadRequest **ppRequests, DWORD dwCount);
+
+		/*
+			Description: Releases the staging buffer of an asynchronous read request. Buffers taken from the staging
+				buffer pool are returned to it, buffers allocated for reads too large for the pool are freed.
+		*/
+		void ReleaseRequestStagingBuffer(CdiSectorReadRequest *pRequest);
+
+		/*
+			Description: Takes a staging buffer from the free list, or allocates a new one if every buffer is in use
+				by another thread.
+
+			Returns: A staging buffer of m_dwStagingBufferSize bytes, or nullptr if a new buffer could not be allocated.
+		*/
+		PBYTE AcquireStagingBuffer();
+
+		/*
+			Description: Returns a staging buffer taken with AcquireStagingBuffer() to the free list.
+		*/
+		void ReleaseStagingBuffer(PBYTE pbBuffer);
+
+		/*
+			Description: Frees all of the staging buffers on the free list.
+		*/
+		void FreeStagingBuffers();
+
+	public:
+		CdiFileHandle();
+		~CdiFileHandle();
+
+		/*
+			Description: Opens the CDI image file for processing and parses the session descriptor for the image.
+				Compressed images are opened through a CdiCompressedDevice and image manifests in a chunk store through
+				a CdiStoreDevice, both can only be read.
+
+			Parameters:
+				sFileName: File name of the image file.
+				bWrite: Boolean indicating that the image file should be opened for writing.
+				bVerbose: Boolean indicating if verbose information should be printed to the console while reading.
+				bMemoryMap: Boolean indicating if the whole image should be mapped into memory. When mapped, sectors are
+					read out of the mapping and zero copy views can be taken with ReadSectorsView().
+
+			Returns: True if the image was successfully opened and the session descriptor was parsed without errors, false otherwise.
+		*/
+		bool Open(CString sFileName, bool bWrite, bool bVerbose, bool bMemoryMap = false);
+
+		/*
+			Description: Parses the session descriptor of a CDI image stored on the block device provided.
+
+			Parameters:
+				pDevice: Block device containing the image. The file handle takes ownership of the device and deletes
+					it when the handle is closed, even if the image fails to open.
+				bVerbose: Boolean indicating if verbose information should be printed to the console while reading.
+				bMemoryMap: Boolean indicating if the device should be mapped into memory, see Open() above.
+
+			Returns: True if the image was successfully opened and the session descriptor was parsed without errors, false otherwise.
+		*/
+		bool Open(IO::BlockDevice *pDevice, bool bVerbose, bool bMemoryMap = false);
+
+		/*
+			Description: Closes the image file and flushes any buffers from memory. Sector writes are buffered, so
+				callers that wrote to the image must check the return value (or call Flush() first) to know the
+				writes made it to the image.
+
+			Returns: True if all staged sectors were written to the image, false otherwise. The image is closed
+				either way.
+		*/
+		bool Close();
+
+		/*
+			Description: Writes any sectors staged in the write buffer out to the image. Sector writes are buffered
+				so errors writing to the image may only be reported here or when the image is closed.
+
+			Returns: True if all staged sectors were written, false otherwise.
+		*/
+		bool Flush();
+
+		/*
+			Description: Sets the size of the write buffer, flushing anything staged in it.
+
+			Parameters:
+				dwSize: Size of the buffer in bytes, 0 disables write buffering.
+		*/
+		void SetWriteBufferSize(DWORD dwSize);
+
+		/*
+			Description: Gets the staging and write counters of the write buffer.
+		*/
+		void GetWriteBufferStats(CdiWriteBufferStats *pStats);
+
+		/*
+			Description: Reads dwSectorCount number of sectors into buffer pbBuffer at LBA dwLBA in track dwTrackNumber of session dwSessionNumber.
+
+			Parameters:
+				dwSessionNumber: Session number that track dwTrackNumber is located in.
+				dwTrackNumber: Track number to read from.
+				dwLBA: LBA to start reading at relative to the beginning of the image file.
+				pbBuffer: Buffer to read the sectors into. Buffer should be a multiple of RAW_SECTOR_SIE if the track is a 
+					Mode1/Mode2 data track, or a multiple of the track's sector size if the track is an Audio track.
+				dwSectorCount: Number of sectors to read from the track.
+
+			Returns: True if the sectors are successfully read from the track, false otherwise or if any of the sectors
+				are outside of the track.
+		*/
+		bool ReadSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount);
+
+		/*
+			Description: Reads dwSectorCount sectors exactly as they are stored in the image, including the sync, header,
+				EDC and ECC bytes that ReadSectors() strips. Raw reads are not served from or added to the sector cache.
+
+			Parameters:
+				dwSessionNumber: Session number that track dwTrackNumber is located in.
+				dwTrackNumber: Track number to read from.
+				dwLBA: LBA to start reading at relative to the beginning of the image file, sectors in the pregap of the
+					track can be read too.
+				pbBuffer: Buffer to read the sectors into, must be dwSectorCount times the track's sector size.
+				dwSectorCount: Number of sectors to read from the track.
+
+			Returns: True if the sectors are successfully read from the track, false otherwise.
+		*/
+		bool ReadRawSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount);
+
+		/*
+			Description: Copies dwSectorCount sectors exactly as they are stored in the image to another block device.
+				See IO::BlockDevice::CopyTo(), when both ends are files the data doesn't pass through user space.
+
+			Parameters:
+				dwSessionNumber: Session number that track dwTrackNumber is located in.
+				dwTrackNumber: Track number to copy from.
+				dwLBA: LBA to start copying at, same as ReadRawSectors().
+				dwSectorCount: Number of sectors to copy.
+				pDestination: Device to copy the sectors to.
+				qwDestinationOffset: Offset to copy the sectors to in pDestination.
+
+			Returns: True if the sectors were copied, false otherwise.
+		*/
+		bool CopyRawSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, IO::BlockDevice *pDestination, ULONGLONG qwDestinationOffset);
+
+		/*
+			Description: Reads bytes straight from the image, including the data outside of any track such as the track
+				headers and the session descriptor. Compressed images and images in a chunk store are read decompressed.
+
+			Parameters:
+				qwOffset: Offset in the image to read from.
+				pbBuffer: Buffer to read the data into.
+				dwSize: Number of bytes to read.
+
+			Returns: True if the data was read, false otherwise.
+		*/
+		bool ReadImageBytes(ULONGLONG qwOffset, PBYTE pbBuffer, DWORD dwSize);
+
+		/*
+			Description: Gets the size of the image in bytes.
+		*/
+		ULONGLONG ImageSize();
+
+		/*
+			Description: Reads the full 2352 byte main channel data and the de-interleaved subchannel data of dwSectorCount
+				sectors. Only tracks stored with 2352 byte or larger sectors have main channel data, and only 2368/2448
+				byte tracks have subchannel data.
+
+			Parameters:
+				dwSessionNumber: Session number that track dwTrackNumber is located in.
+				dwTrackNumber: Track number to read from.
+				dwLBA: LBA to start reading at relative to the beginning of the image file.
+				pbMainChannel: Buffer that receives 2352 bytes per sector, or nullptr to skip the main channel.
+				pbSubchannel: Buffer that receives CD_SUBCHANNEL_SIZE bytes per sector, or nullptr to skip the subchannel.
+					See DeinterleaveSubchannel() for the layout.
+				dwSectorCount: Number of sectors to read from the track.
+
+			Returns: True if the sectors are successfully read from the track, false otherwise.
+		*/
+		bool ReadSubchannelSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbMainChannel, PBYTE pbSubchannel, DWORD dwSectorCount);
+
+		/*
+			Description: Sets the number of raw sectors that are read from the image file at a time when reading from
+				tracks that have sector headers that need to be stripped. Larger values mean fewer read calls at the
+				cost of larger staging buffers. Must not be called while other threads are reading from the image or
+				while asynchronous reads are in flight.
+
+			Parameters:
+				dwSectorCount: Number of sectors to read at a time.
+		*/
+		void SetReadChunkSize(DWORD dwSectorCount);
+
+		/*
+			Description: Sets the memory budget of the sector cache shared by all track handles on this image. Reads of up to
+				CDI_SECTOR_CACHE_MAX_READ_SECTORS sectors are served from the cache, writes update it.
+
+			Parameters:
+				qwBudget: Maximum number of bytes of sector data to cache, 0 disables the cache.
+		*/
+		void SetSectorCacheSize(ULONGLONG qwBudget);
+
+		/*
+			Description: Gets the hit, miss and eviction counters for the sector cache.
+		*/
+		void GetSectorCacheStats(CdiSectorCacheStats *pStats);
+
+		/*
+			Description: Sets the maximum number of asynchronous sector reads that can be in flight at once. The read
+				queue is created when the image is opened, so this must be called before Open().
+
+			Parameters:
+				dwQueueDepth: Maximum number of requests in flight.
+		*/
+		void SetReadQueueDepth(DWORD dwQueueDepth);
+
+		/*
+			Description: Gets the maximum number of asynchronous sector reads that can be in flight at once.
+		*/
+		DWORD GetReadQueueDepth();
+
+		/*
+			Description: Submits a batch of asynchronous sector reads. On Linux the reads are issued with io_uring
+				when it is available, everywhere else they are serviced by a pool of threads doing positional reads.
+				Asynchronous reads are not served from or added to the sector cache. Any number of threads can submit
+				reads at the same time, each request is only ever returned to the thread that submitted it. All of the
+				requests must be completed with CompleteSectorReads() before the image is closed.
+
+			Parameters:
+				ppRequests: Array of requests to submit, the requests must stay valid until they are completed.
+				dwCount: Number of requests in ppRequests.
+
+			Returns: True if all of the requests were submitted, false if a request is invalid or there is not enough
+				room in the queue. No requests are submitted on failure.
+		*/
+		bool SubmitSectorReads(CdiSectorReadRequest **ppRequests, DWORD dwCount);
+
+		/*
+			Description: Waits for sector reads submitted by the calling thread to complete.
+
+			Parameters:
+				ppCompleted: Array that receives the completed requests.
+				dwMaxCount: Maximum number of requests to return.
+
+			Returns: The number of completed requests written to ppCompleted. This blocks until at least one request
+				submitted by the calling thread completes and only returns 0 if the thread has no requests in flight.
+		*/
+		DWORD CompleteSectorReads(CdiSectorReadRequest **ppCompleted, DWORD dwMaxCount);
+
+		/*
+			Description: Gets a view of dwSectorCount sectors at LBA dwLBA in track dwTrackNumber of session dwSessionNumber
+				that points directly into the memory mapped image, with the sector header offsets already applied.
+
+			Parameters:
+				dwSessionNumber: Session number that track dwTrackNumber is located in.
+				dwTrackNumber: Track number to read from.
+				dwLBA: LBA to start the view at relative to the beginning of the image file.
+				dwSectorCount: Number of sectors in the view.
+				pView: Out pointer for the sector view.
+
+			Returns: True if the view was created, false if the image is not mapped or the sectors are out of range.
+		*/
+		bool ReadSectorsView(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, CdiSectorView *pView);
+
+		/*
+			Description: Gets a boolean indicating if the image is memory mapped.
+		*/
+		bool IsMapped();
+
+		/*
+			Description: Writes dwSectorCount sectors from buffer pbBuffer at LBA dwLBA in track dwTrackNumber of session dwSessionNumber.
+
+			Parameters:
+				dwSessionNumber: Session number that track dwTrackNumber is located in.
+				dwTrackNumber: Track number to write to.
+				dwLBA: LBA to start writing at relative to the beginning of the image file.
+				pbBuffer: Buffer containing the sector data to be written. Buffer should be a multiple of RAW_SECTOR_SIE if the track is a 
+					Mode1/Mode2 data track, or a multiple of the track's sector size if the track is an Audio track.
+				dwSectorCount: Number of sectors to write to the track.
+
+			Returns: True if the sector data is successfully written to the track, false otherwise.
+		*/
+		bool WriteSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount);
+
+		/*
+			Description: Selects what WriteSectors() rebuilds when writing to tracks that store raw sectors. By default
+				the EDC and ECC are recomputed so patched sectors stay readable, the header is only rewritten when
+				RegenerateHeader is set.
+
+			Parameters:
+				dwFlags: Combination of CdiSectorRegeneration flags, RegenerateNone only writes the user data.
+		*/
+		void SetSectorRegeneration(DWORD dwFlags);
+
+		/*
+			Description: Gets the CdiSectorRegeneration flags used by WriteSectors().
+		*/
+		DWORD GetSectorRegeneration();
+
+		/*
+			Description: Enables the sidecar index, must be called before Open(). When enabled, opening the image for
+				reading loads the session layout from the sidecar next to the image instead of parsing the session
+				descriptor. A missing or stale sidecar is rebuilt from the image and written out when the image is closed
+				or SaveSidecarIndex() is called.
+
+			Parameters:
+				bEnable: Boolean indicating if the sidecar index should be used.
+		*/
+		void EnableSidecarIndex(bool bEnable);
+
+		/*
+			Description: Gets the sidecar index for the image, which higher level code can use to store what it parsed
+				out of the image.
+
+			Returns: The sidecar index, or nullptr if the index is not used for this image.
+		*/
+		CdiSidecarIndex *GetSidecarIndex();
+
+		/*
+			Description: Writes the sidecar index out if it was rebuilt or changed since it was loaded.
+
+			Returns: True if the sidecar on disk is up to date or the index is not used, false if it could not be written.
+		*/
+		bool SaveSidecarIndex();
+
+		/*
+			Description: Gets a read only view of the CdiSession's found in the cdi image file. The view points
+				straight at the metadata of the file handle, so it is cheap to copy and is valid until the image is
+				closed.
+
+			Returns: An ArrayView<CdiSession> over the sessions of the image.
+		*/
+		ArrayView<CdiSession> GetSessions();
+
+		/*
+			Description: Gets the reason the session descriptor was rejected by the last call to Open(). The error is
+				DescriptorOk if the descriptor was valid or was not read.
+		*/
+		const CdiDescriptorStatus& GetDescriptorStatus();
+
+		/*
+			Description: Gets the offset table entry for track dwTrackNumber in session dwSessionNumber.
+
+			Parameters:
+				dwSessionNumber: session number the track is located in.
+				dwTrackNumber: track number to get the offset info for.
+
+			Returns: A pointer to the CdiTrackOffsetInfo for the track if the session and track numbers are valid, nullptr otherwise.
+		*/
+		const CdiTrackOffsetInfo *GetTrackOffsetInfo(DWORD dwSessionNumber, DWORD dwTrackNumber);
+
+		/*
+			Description: Passes an access hint for a range of sectors on to the image device.
+
+			Parameters:
+				dwSessionNumber: session number the track is located in.
+				dwTrackNumber: track number the sectors are located in.
+				dwLBA: LBA of the first sector.
+				dwSectorCount: number of sectors the hint applies to.
+				eHint: access hint for the sectors.
+		*/
+		void AdviseSectors(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, IO::BlockDeviceAccessHint eHint);
+
+		/*
+			Description: Opens a track handle on the specified track in the specified session.
+
+			Parameters:
+				dwSessionNumber: session number the track is located in.
+				dwTrackNumber: track number to open.
+
+			Returns: A CdiTrackHandle object is the track was successfully opened, nullptr otherwise.
+		*/
+		CdiTrackHandle *OpenTrackHandle(DWORD dwSessionNumber, DWORD dwTrackNumber);
+
+		/*
+			Description: Closes an opened track handle.
+
+			Parameters:
+				pTrackHandle: the track handle to close.
+		*/
+		void CloseTrackHandle(CdiTrackHandle *pTrackHandle);
+	};
 };
\ No newline at end of file
@@ -0,0 +1,355 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiHasher.cpp - Single pass CRC32/MD5/SHA-1 hashing of a cdi image and each
+		of its tracks.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiHasher.h"
+#include "CdiCompressedImage.h"
+#include <chrono>
+#include <thread>
+
+namespace DiskJuggler
+{
+	/*
+		Description: Prints the size and digests of a stream.
+	*/
+	static void PrintDigestSet(LPCSTR psName, const IO::DigestSet *pDigests)
+	{
+		CHAR sMd5[MD5_DIGEST_SIZE * 2 + 1];
+		CHAR sSha1[SHA1_DIGEST_SIZE * 2 + 1];
+		IO::FormatDigest(pDigests->bMd5, MD5_DIGEST_SIZE, sMd5);
+		IO::FormatDigest(pDigests->bSha1, SHA1_DIGEST_SIZE, sSha1);
+
+		printf("\t%-6s size %lld crc %08x md5 %s sha1 %s\n", psName, pDigests->qwSize, pDigests->dwCrc32, sMd5, sSha1);
+	}
+
+	void CdiHashReport::Print()
+	{
+		// Print the digests of each track.
+		for (size_t i = 0; i < this->vTracks.size(); i++)
+		{
+			CdiTrackHashReport *pTrack = &this->vTracks[i];
+			printf("session %d track %d \t%s/%d \t%d sectors\n", pTrack->dwSessionNumber + 1, pTrack->dwTrackNumber + 1,
+				(pTrack->eMode == CdiTrackMode::Audio ? "audio" : (pTrack->eMode == CdiTrackMode::Mode1 ? "mode1" : "mode2")),
+				pTrack->eSectorSize, pTrack->dwSectorCount);
+
+			PrintDigestSet("raw", &pTrack->sRaw);
+			if (pTrack->bHasCooked == true)
+				PrintDigestSet("cooked", &pTrack->sCooked);
+		}
+
+		// Print the digests of the image and the throughput.
+		printf("image\n");
+		PrintDigestSet("raw", &this->sImage);
+
+		double dMegabytes = (double)this->sImage.qwSize / (1024.0 * 1024.0);
+		printf("hashed %.2f MB in %.3f s on %d threads, %.2f MB/s%s\n", dMegabytes, this->dSeconds, this->dwThreadCount,
+			(this->dSeconds > 0.0 ? dMegabytes / this->dSeconds : 0.0), (IO::Crc32IsAccelerated() == true ? ", clmul crc32" : ""));
+	}
+
+	CdiHasher::CdiHasher(CdiFileHandle *pCdiFile, DWORD dwThreadCount)
+	{
+		// Initialize fields.
+		this->m_pCdiFile = pCdiFile;
+		this->m_dwTaskCount = 0;
+		this->m_dwNextTask = 0;
+		this->m_dwTasksDone = 0;
+		this->m_dwActiveWorkers = 0;
+		this->m_dwGeneration = 0;
+		this->m_bStop = false;
+		this->m_pbBlock = nullptr;
+		this->m_dwBlockSize = 0;
+
+		// Default to one thread per processor, a block never has more tasks than CDI_HASH_MAX_BLOCK_TASKS.
+		this->m_dwThreadCount = dwThreadCount;
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = std::thread::hardware_concurrency();
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = 1;
+		if (this->m_dwThreadCount > CDI_HASH_MAX_BLOCK_TASKS)
+			this->m_dwThreadCount = CDI_HASH_MAX_BLOCK_TASKS;
+	}
+
+	bool CdiHasher::PlanBlocks(CdiHashReport *pReport, std::vector<HashBlock> *pvBlocks)
+	{
+		// Split the image into extents, one for each track and one for each run of data between tracks.
+		std::vector<CdiCompressedExtent> vExtents;
+		if (BuildImageExtents(this->m_pCdiFile, this->m_pCdiFile->ImageSize(), &vExtents) == false)
+			return false;
+
+		pvBlocks->clear();
+		for (size_t i = 0; i < vExtents.size(); i++)
+		{
+			CdiCompressedExtent *pExtent = &vExtents[i];
+
+			// Find the track the extent belongs to, if any.
+			DWORD dwTrackIndex = CDI_HASH_NO_TRACK;
+			ULONGLONG qwDataOffset = pExtent->qwOffset + pExtent->qwSize;
+			for (DWORD x = 0; x < this->m_vTrackOffsets.size() && pExtent->bMode != CDI_COMPRESSED_NO_TRACK; x++)
+			{
+				if (this->m_vTrackOffsets[x]->qwPregapOffset == pExtent->qwOffset && pReport->vTracks[x].dwSectorCount > 0)
+				{
+					dwTrackIndex = x;
+					qwDataOffset = this->m_vTrackOffsets[x]->qwDataOffset;
+					break;
+				}
+			}
+
+			// Data outside of the track, and the pregap, only goes into the image digests.
+			for (ULONGLONG qwOffset = pExtent->qwOffset; qwOffset < qwDataOffset; qwOffset += CDI_HASH_BLOCK_SIZE)
+			{
+				HashBlock sBlock = { qwOffset, (DWORD)(qwDataOffset - qwOffset < CDI_HASH_BLOCK_SIZE ? qwDataOffset - qwOffset : CDI_HASH_BLOCK_SIZE), CDI_HASH_NO_TRACK };
+				pvBlocks->push_back(sBlock);
+			}
+
+			// Split the track data into blocks of whole sectors.
+			if (dwTrackIndex != CDI_HASH_NO_TRACK)
+			{
+				ULONGLONG qwEndOffset = pExtent->qwOffset + pExtent->qwSize;
+				DWORD dwBlockSize = (CDI_HASH_BLOCK_SIZE / pExtent->dwUnitSize) * pExtent->dwUnitSize;
+				for (ULONGLONG qwOffset = qwDataOffset; qwOffset < qwEndOffset; qwOffset += dwBlockSize)
+				{
+					HashBlock sBlock = { qwOffset, (DWORD)(qwEndOffset - qwOffset < dwBlockSize ? qwEndOffset - qwOffset : dwBlockSize), dwTrackIndex };
+					pvBlocks->push_back(sBlock);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void CdiHasher::PrepareTasks(const HashBlock *pBlock, CdiHashReport *pReport)
+	{
+		static const IO::DigestType eTypes[3] = { IO::DigestType::DigestCrc32, IO::DigestType::DigestMd5, IO::DigestType::DigestSha1 };
+
+		// Every block goes into the image digests.
+		this->m_dwTaskCount = 0;
+		for (int i = 0; i < 3; i++)
+			this->m_sTasks[this->m_dwTaskCount++] = { &this->m_vStreams[0], eTypes[i], 0, 0 };
+
+		if (pBlock->dwTrackIndex == CDI_HASH_NO_TRACK)
+			return;
+
+		// Track data goes into the raw digests of the track as is, and into the cooked digests a sector at a time.
+		const CdiTrackOffsetInfo *pOffsetInfo = this->m_vTrackOffsets[pBlock->dwTrackIndex];
+		for (int i = 0; i < 3; i++)
+			this->m_sTasks[this->m_dwTaskCount++] = { &this->m_vStreams[1 + pBlock->dwTrackIndex * 2], eTypes[i], 0, 0 };
+
+		// Tracks stored with 2048 byte sectors are already cooked, their cooked digests are copied when they are finished.
+		if (pReport->vTracks[pBlock->dwTrackIndex].bHasCooked == false || pOffsetInfo->dwSectorStride == RAW_SECTOR_SIZE)
+			return;
+
+		for (int i = 0; i < 3; i++)
+		{
+			this->m_sTasks[this->m_dwTaskCount++] = { &this->m_vStreams[2 + pBlock->dwTrackIndex * 2], eTypes[i],
+				pOffsetInfo->dwSectorStride, pOffsetInfo->dwHeaderSize };
+		}
+	}
+
+	void CdiHasher::RunTask(const HashTask *pTask)
+	{
+		HashStream *pStream = pTask->pStream;
+		DWORD dwSize = this->m_dwBlockSize;
+
+		// Raw streams take the whole block at once.
+		if (pTask->dwSectorStride == 0)
+		{
+			switch (pTask->eType)
+			{
+			case IO::DigestType::DigestCrc32: pStream->dwCrc32 = IO::Crc32Update(pStream->dwCrc32, this->m_pbBlock, dwSize); break;
+			case IO::DigestType::DigestMd5: pStream->sMd5.Update(this->m_pbBlock, dwSize); break;
+			case IO::DigestType::DigestSha1: pStream->sSha1.Update(this->m_pbBlock, dwSize); break;
+			}
+			return;
+		}
+
+		// Cooked streams take the user data of each sector.
+		for (DWORD dwOffset = 0; dwOffset + pTask->dwSectorStride <= dwSize; dwOffset += pTask->dwSectorStride)
+		{
+			const BYTE *pbUserData = &this->m_pbBlock[dwOffset + pTask->dwHeaderSize];
+			switch (pTask->eType)
+			{
+			case IO::DigestType::DigestCrc32: pStream->dwCrc32 = IO::Crc32Update(pStream->dwCrc32, pbUserData, RAW_SECTOR_SIZE); break;
+			case IO::DigestType::DigestMd5: pStream->sMd5.Update(pbUserData, RAW_SECTOR_SIZE); break;
+			case IO::DigestType::DigestSha1: pStream->sSha1.Update(pbUserData, RAW_SECTOR_SIZE); break;
+			}
+		}
+	}
+
+	void CdiHasher::WorkerThread()
+	{
+		DWORD dwGeneration = 0;
+		std::unique_lock<std::mutex> lock(this->m_Lock);
+		while (true)
+		{
+			// Wait for the next block.
+			this->m_WorkReady.wait(lock, [&]() { return this->m_bStop == true || this->m_dwGeneration != dwGeneration; });
+			if (this->m_bStop == true)
+				break;
+			dwGeneration = this->m_dwGeneration;
+			this->m_dwActiveWorkers++;
+			lock.unlock();
+
+			// Run tasks until there are none left.
+			DWORD dwTasksDone = 0;
+			while (true)
+			{
+				DWORD dwTaskIndex = this->m_dwNextTask++;
+				if (dwTaskIndex >= this->m_dwTaskCount)
+					break;
+
+				RunTask(&this->m_sTasks[dwTaskIndex]);
+				dwTasksDone++;
+			}
+
+			// Let the main thread know once no worker is touching the block anymore.
+			lock.lock();
+			this->m_dwTasksDone += dwTasksDone;
+			this->m_dwActiveWorkers--;
+			if (this->m_dwActiveWorkers == 0)
+				this->m_WorkDone.notify_one();
+		}
+	}
+
+	void CdiHasher::FinishStream(HashStream *pStream)
+	{
+		pStream->pResult->dwTypes = IO::DigestType::DigestAll;
+		pStream->pResult->dwCrc32 = pStream->dwCrc32;
+		pStream->sMd5.Final(pStream->pResult->bMd5);
+		pStream->sSha1.Final(pStream->pResult->bSha1);
+	}
+
+	bool CdiHasher::HashImage(CdiHashReport *pReport)
+	{
+		std::vector<HashBlock> vBlocks;
+		std::vector<std::thread> vWorkers;
+		PBYTE pbBuffers[2] = { nullptr, nullptr };
+		auto tStart = std::chrono::steady_clock::now();
+		bool bResult = false;
+
+		// Get a view of the sessions from the file handle.
+		ArrayView<CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+
+		// Setup the report.
+		pReport->sImage = { };
+		pReport->sImage.qwSize = this->m_pCdiFile->ImageSize();
+		pReport->vTracks.clear();
+		pReport->dSeconds = 0.0;
+		pReport->dwThreadCount = this->m_dwThreadCount;
+		this->m_vTrackOffsets.clear();
+		for (DWORD i = 0; i < sessionCollection.size(); i++)
+		{
+			for (DWORD x = 0; x < sessionCollection[i]->wTrackCount; x++)
+			{
+				CdiTrack *pTrack = &sessionCollection[i]->psTracks[x];
+				const CdiTrackOffsetInfo *pOffsetInfo = this->m_pCdiFile->GetTrackOffsetInfo(i, x);
+				if (pOffsetInfo == nullptr)
+					return false;
+
+				CdiTrackHashReport sTrackReport = { };
+				sTrackReport.dwSessionNumber = i;
+				sTrackReport.dwTrackNumber = x;
+				sTrackReport.eMode = pTrack->eMode;
+				sTrackReport.eSectorSize = pTrack->eSectorSize;
+				sTrackReport.dwSectorCount = pTrack->dwLength;
+				sTrackReport.sRaw.qwSize = (ULONGLONG)pTrack->dwLength * pOffsetInfo->dwSectorStride;
+				sTrackReport.bHasCooked = (pTrack->eMode != CdiTrackMode::Audio);
+				sTrackReport.sCooked.qwSize = (sTrackReport.bHasCooked == true ? (ULONGLONG)pTrack->dwLength * RAW_SECTOR_SIZE : 0);
+				pReport->vTracks.push_back(sTrackReport);
+				this->m_vTrackOffsets.push_back(pOffsetInfo);
+			}
+		}
+
+		// Setup a stream for the image and for both layouts of each track.
+		this->m_vStreams.clear();
+		this->m_vStreams.resize(1 + pReport->vTracks.size() * 2);
+		this->m_vStreams[0].pResult = &pReport->sImage;
+		for (size_t i = 0; i < pReport->vTracks.size(); i++)
+		{
+			this->m_vStreams[1 + i * 2].pResult = &pReport->vTracks[i].sRaw;
+			this->m_vStreams[2 + i * 2].pResult = &pReport->vTracks[i].sCooked;
+		}
+		for (size_t i = 0; i < this->m_vStreams.size(); i++)
+			this->m_vStreams[i].dwCrc32 = 0;
+
+		// Split the image into blocks.
+		if (PlanBlocks(pReport, &vBlocks) == false)
+			return false;
+
+		// Spin up the workers.
+		pbBuffers[0] = new BYTE[CDI_HASH_BLOCK_SIZE];
+		pbBuffers[1] = new BYTE[CDI_HASH_BLOCK_SIZE];
+		this->m_bStop = false;
+		this->m_dwGeneration = 0;
+		for (DWORD i = 0; i < this->m_dwThreadCount; i++)
+			vWorkers.push_back(std::thread(&CdiHasher::WorkerThread, this));
+
+		// Read the first block, then keep reading the next block while the workers hash the current one.
+		if (vBlocks.size() > 0 && this->m_pCdiFile->ReadImageBytes(vBlocks[0].qwOffset, pbBuffers[0], vBlocks[0].dwSize) == false)
+			goto Cleanup;
+
+		for (size_t i = 0; i < vBlocks.size(); i++)
+		{
+			// Hand the block to the workers once none of them is looking at the last one.
+			{
+				std::unique_lock<std::mutex> lock(this->m_Lock);
+				this->m_WorkDone.wait(lock, [&]() { return this->m_dwActiveWorkers == 0; });
+				PrepareTasks(&vBlocks[i], pReport);
+				this->m_pbBlock = pbBuffers[i % 2];
+				this->m_dwBlockSize = vBlocks[i].dwSize;
+				this->m_dwNextTask = 0;
+				this->m_dwTasksDone = 0;
+				this->m_dwGeneration++;
+			}
+			this->m_WorkReady.notify_all();
+
+			// Read the next block.
+			bool bReadFailed = (i + 1 < vBlocks.size() &&
+				this->m_pCdiFile->ReadImageBytes(vBlocks[i + 1].qwOffset, pbBuffers[(i + 1) % 2], vBlocks[i + 1].dwSize) == false);
+
+			// Wait for the workers to finish with the current block.
+			{
+				std::unique_lock<std::mutex> lock(this->m_Lock);
+				this->m_WorkDone.wait(lock, [&]() { return this->m_dwTasksDone == this->m_dwTaskCount && this->m_dwActiveWorkers == 0; });
+			}
+
+			if (bReadFailed == true)
+				goto Cleanup;
+		}
+
+		// Finish the digests, tracks stored with 2048 byte sectors have the same raw and cooked layout.
+		for (size_t i = 0; i < this->m_vStreams.size(); i++)
+			FinishStream(&this->m_vStreams[i]);
+		for (size_t i = 0; i < pReport->vTracks.size(); i++)
+		{
+			CdiTrackHashReport *pTrack = &pReport->vTracks[i];
+			if (pTrack->bHasCooked == true && this->m_vTrackOffsets[i]->dwSectorStride == RAW_SECTOR_SIZE)
+				pTrack->sCooked = pTrack->sRaw;
+			else if (pTrack->bHasCooked == false)
+				pTrack->sCooked = { };
+		}
+
+		pReport->dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+		bResult = true;
+
+	Cleanup:
+		// Shut down the workers.
+		{
+			std::lock_guard<std::mutex> lock(this->m_Lock);
+			this->m_bStop = true;
+		}
+		this->m_WorkReady.notify_all();
+		for (size_t i = 0; i < vWorkers.size(); i++)
+			vWorkers[i].join();
+
+		delete[] pbBuffers[0];
+		delete[] pbBuffers[1];
+		return bResult;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,162 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiHasher.h - Single pass CRC32/MD5/SHA-1 hashing of a cdi image and each
+		of its tracks.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "../IO/Digest.h"
+#include "CdiFileHandle.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace DiskJuggler
+{
+	// Number of bytes read from the image at a time. One block is hashed while the next one is read.
+	#define CDI_HASH_BLOCK_SIZE				0x400000
+
+	// Track index of blocks that don't belong to a track, ie: pregaps, track headers and the session descriptor.
+	#define CDI_HASH_NO_TRACK				0xFFFFFFFF
+
+	// Most digests a single block is added to: the image, and the raw and cooked layouts of a track.
+	#define CDI_HASH_MAX_BLOCK_TASKS		9
+
+	struct CdiTrackHashReport
+	{
+		DWORD dwSessionNumber;			// Session number the track is located in
+		DWORD dwTrackNumber;			// Track number in the session
+		CdiTrackMode eMode;				// Mode of the track
+		CdiSectorSize eSectorSize;		// Size of the sectors in the image
+		DWORD dwSectorCount;			// Number of sectors in the track, not counting the pregap
+		IO::DigestSet sRaw;				// Digests of the sectors as they are stored in the image
+		bool bHasCooked;				// False for audio tracks, they have no sector header to strip
+		IO::DigestSet sCooked;			// Digests of the 2048 byte user data of each sector
+	};
+
+	struct CdiHashReport
+	{
+		IO::DigestSet sImage;			// Digests of the whole image file
+		std::vector<CdiTrackHashReport> vTracks;	// Report for every track in the image
+		double dSeconds;				// Time taken to hash the image
+		DWORD dwThreadCount;			// Number of threads the digests were computed on
+
+		/*
+			Description: Prints the digests of each track and of the image.
+		*/
+		void Print();
+	};
+
+	//-----------------------------------------------------
+	// CdiHasher
+	//-----------------------------------------------------
+	/*
+		Reads an image once, front to back, and computes the CRC32, MD5 and SHA-1 of the whole image and of every
+		track in both its raw and cooked layouts. The main thread reads the next block while the worker threads hash
+		the current one, each digest of each stream is a separate task so they all run at the same time.
+	*/
+	class CdiHasher
+	{
+	protected:
+		struct HashStream
+		{
+			IO::DigestSet *pResult;		// Digests are written here when the stream is finished
+			DWORD dwCrc32;				// CRC32 so far
+			IO::Md5 sMd5;				// MD5 so far
+			IO::Sha1 sSha1;				// SHA-1 so far
+		};
+
+		struct HashBlock
+		{
+			ULONGLONG qwOffset;			// Offset of the block in the image
+			DWORD dwSize;				// Size of the block
+			DWORD dwTrackIndex;			// Index of the track in the report or CDI_HASH_NO_TRACK
+		};
+
+		struct HashTask
+		{
+			HashStream *pStream;		// Stream to add the block to
+			IO::DigestType eType;		// Digest of the stream to update
+			DWORD dwSectorStride;		// Size of each sector for cooked streams, 0 to add the block as is
+			DWORD dwHeaderSize;			// Offset of the user data in each sector for cooked streams
+		};
+
+		CdiFileHandle	*m_pCdiFile;				// Image to hash
+		DWORD			m_dwThreadCount;			// Number of worker threads to use
+
+		// Streams the image is split into, the image itself followed by the raw and cooked layout of each track.
+		std::vector<HashStream>	m_vStreams;
+		std::vector<const CdiTrackOffsetInfo*>	m_vTrackOffsets;	// Offset info for each track in the report
+
+		// Work shared with the worker threads, only changed while no worker is running a task.
+		std::mutex		m_Lock;						// Protects the fields below
+		std::condition_variable	m_WorkReady;		// Signalled when a new block is ready to be hashed
+		std::condition_variable	m_WorkDone;			// Signalled when the last busy worker is done with a block
+		HashTask		m_sTasks[CDI_HASH_MAX_BLOCK_TASKS];	// Tasks for the current block
+		DWORD			m_dwTaskCount;				// Number of tasks for the current block
+		std::atomic<DWORD>	m_dwNextTask;			// Index of the next task to be picked up by a worker
+		DWORD			m_dwTasksDone;				// Number of tasks of the current block that are done
+		DWORD			m_dwActiveWorkers;			// Number of workers picking up tasks
+		DWORD			m_dwGeneration;				// Incremented for every block handed to the workers
+		bool			m_bStop;					// Set to shut the workers down
+		const BYTE		*m_pbBlock;					// Data of the current block
+		DWORD			m_dwBlockSize;				// Size of the current block
+
+		/*
+			Description: Splits the image into blocks that never straddle a track boundary. Blocks of track data hold
+				whole sectors so the cooked layout can be pulled out of each block on its own.
+
+			Parameters:
+				pReport: Report the track indices of the blocks refer to.
+				pvBlocks: Receives the blocks, in image order.
+
+			Returns: True if the tracks could be laid out, false if they overlap or run past the end of the image.
+		*/
+		bool PlanBlocks(CdiHashReport *pReport, std::vector<HashBlock> *pvBlocks);
+
+		/*
+			Description: Fills in the tasks for a block.
+		*/
+		void PrepareTasks(const HashBlock *pBlock, CdiHashReport *pReport);
+
+		/*
+			Description: Adds the current block to a single digest of a single stream.
+		*/
+		void RunTask(const HashTask *pTask);
+
+		/*
+			Description: Worker thread routine, runs the tasks of each block until the workers are stopped.
+		*/
+		void WorkerThread();
+
+		/*
+			Description: Finishes the digests of a stream and writes them to its result.
+		*/
+		void FinishStream(HashStream *pStream);
+
+	public:
+		/*
+			Parameters:
+				pCdiFile: Image to hash.
+				dwThreadCount: Number of threads to hash with, 0 uses one per processor. No more than
+					CDI_HASH_MAX_BLOCK_TASKS threads are used.
+		*/
+		CdiHasher(CdiFileHandle *pCdiFile, DWORD dwThreadCount = 0);
+
+		/*
+			Description: Computes the digests of the image and every track in it.
+
+			Parameters:
+				pReport: Receives the digests.
+
+			Returns: True if the whole image was read and hashed, false otherwise.
+		*/
+		bool HashImage(CdiHashReport *pReport);
+	};
+};
\ No newline at end of file
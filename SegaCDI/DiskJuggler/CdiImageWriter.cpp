@@ -0,0 +1,595 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiImageWriter.cpp - Streams ISO and audio tracks into a new Disk Juggler
+		image in a single pass.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiImageWriter.h"
+#include "CdiEdcEcc.h"
+#include "CdiSubchannel.h"
+#include <thread>
+
+namespace DiskJuggler
+{
+	// Track start marker, see CdiFileHandle::ParseSessionDescriptor().
+	static const BYTE g_bTrackStartMarker[20] = { 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
+		0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF };
+
+	/*
+		Description: Appends a little endian dword to a descriptor.
+	*/
+	static void AppendDword(std::vector<BYTE> *pvDescriptor, DWORD dwValue)
+	{
+		for (int i = 0; i < 4; i++)
+			pvDescriptor->push_back((BYTE)(dwValue >> (i * 8)));
+	}
+
+	/*
+		Description: Stores a little endian dword in a descriptor.
+	*/
+	static void StoreDword(PBYTE pbData, DWORD dwValue)
+	{
+		for (int i = 0; i < 4; i++)
+			pbData[i] = (BYTE)(dwValue >> (i * 8));
+	}
+
+	CdiImageWriter::CdiImageWriter(DWORD dwThreadCount)
+	{
+		// Initialize fields.
+		this->m_pDevice = nullptr;
+		this->m_pbBuffer = nullptr;
+		this->m_bTrackOpen = false;
+		Cleanup();
+
+		// Default to one thread per processor.
+		this->m_dwThreadCount = dwThreadCount;
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = std::thread::hardware_concurrency();
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = 1;
+	}
+
+	CdiImageWriter::~CdiImageWriter()
+	{
+		// Close the image if it was never finished.
+		Cleanup();
+	}
+
+	void CdiImageWriter::Cleanup()
+	{
+		// Close the image file.
+		if (this->m_pDevice != nullptr)
+		{
+			delete this->m_pDevice;
+			this->m_pDevice = nullptr;
+		}
+
+		// Free the staging buffer.
+		if (this->m_pbBuffer != nullptr)
+		{
+			delete[] this->m_pbBuffer;
+			this->m_pbBuffer = nullptr;
+		}
+
+		// Reset the layout.
+		this->m_qwOffset = 0;
+		this->m_vTracks.clear();
+		this->m_vSessionTracks.clear();
+		this->m_dwNextLBA = (DWORD)-CD_MSF_LBA_OFFSET;
+		this->m_dwSessionLBA = CDI_WRITER_NEXT_LBA;
+		this->m_bTrackOpen = false;
+		this->m_dwSectorSize = 0;
+		this->m_dwBufferedSectors = 0;
+		this->m_dwBufferLBA = 0;
+		this->m_dwPartialSize = 0;
+	}
+
+	bool CdiImageWriter::Create(CString sFileName)
+	{
+		// Throw away anything left over from a previous image.
+		Cleanup();
+		this->m_sFileName = sFileName;
+
+		// Create the image file.
+		this->m_pDevice = IO::OpenFileDevice(sFileName, IO::BlockDeviceAccess::CreateAlways);
+		if (this->m_pDevice == nullptr)
+		{
+			printf("CdiImageWriter::Create(): failed to create image file %s!\n", sFileName);
+			return false;
+		}
+
+		// Allocate a staging buffer large enough for the largest sector size.
+		this->m_pbBuffer = new BYTE[CDI_WRITER_BUFFER_SECTORS * CdiSectorSize::Size_2448];
+		return true;
+	}
+
+	bool CdiImageWriter::BeginSession(DWORD dwLBA)
+	{
+		// Make sure there is an image to write to.
+		if (this->m_pDevice == nullptr)
+			return false;
+
+		// End the track of the previous session.
+		if (this->m_bTrackOpen == true && EndTrack() == false)
+			return false;
+
+		if (this->m_vSessionTracks.size() > 0)
+		{
+			// An empty session would be read back as an open session.
+			if (this->m_vSessionTracks.back() == 0)
+			{
+				printf("CdiImageWriter::BeginSession(): session %d has no tracks!\n", (DWORD)this->m_vSessionTracks.size());
+				return false;
+			}
+
+			// Leave room for the lead out of the previous session and the lead in of this one.
+			this->m_dwNextLBA += CDI_WRITER_SESSION_GAP;
+		}
+
+		// Start the new session.
+		this->m_vSessionTracks.push_back(0);
+		this->m_dwSessionLBA = dwLBA;
+		return true;
+	}
+
+	bool CdiImageWriter::BeginTrack(CdiTrackMode eMode, CdiSectorType eSectorType, DWORD dwPregapLength)
+	{
+		// Make sure there is an image to write to.
+		if (this->m_pDevice == nullptr)
+			return false;
+
+		// End the previous track, and start the first session if there isn't one yet.
+		if (this->m_bTrackOpen == true && EndTrack() == false)
+			return false;
+		if (this->m_vSessionTracks.size() == 0 && BeginSession() == false)
+			return false;
+
+		// Check the track fits on the disc.
+		if (this->m_vTracks.size() >= 99)
+		{
+			printf("CdiImageWriter::BeginTrack(): an image can only hold 99 tracks!\n");
+			return false;
+		}
+
+		// Check the sector type is valid for the mode of the track.
+		CdiSectorSize eSectorSize;
+		switch (eSectorType)
+		{
+		case CdiSectorType::Type_2048:	eSectorSize = CdiSectorSize::Size_2048;	break;
+		case CdiSectorType::Type_2336:	eSectorSize = CdiSectorSize::Size_2336;	break;
+		case CdiSectorType::Type_2352:	eSectorSize = CdiSectorSize::Size_2352;	break;
+		case CdiSectorType::Type_2368:	eSectorSize = CdiSectorSize::Size_2368;	break;
+		case CdiSectorType::Type_2448:	eSectorSize = CdiSectorSize::Size_2448;	break;
+		default:						eSectorSize = (CdiSectorSize)0;			break;
+		}
+		if (eSectorSize == 0 || (DWORD)eMode > CdiTrackMode::Mode2 ||
+			(eMode == CdiTrackMode::Audio && eSectorSize < CdiSectorSize::Size_2352) ||
+			(eMode == CdiTrackMode::Mode1 && eSectorSize == CdiSectorSize::Size_2336))
+		{
+			printf("CdiImageWriter::BeginTrack(): sector type %d can't be used for track mode %d!\n", eSectorType, eMode);
+			return false;
+		}
+
+		// The first track of a session can be placed at a fixed LBA, as long as it doesn't overlap the previous
+		// session.
+		if (this->m_vSessionTracks.back() == 0 && this->m_dwSessionLBA != CDI_WRITER_NEXT_LBA)
+		{
+			if ((LONG)(this->m_dwSessionLBA - dwPregapLength) < (LONG)this->m_dwNextLBA)
+			{
+				printf("CdiImageWriter::BeginTrack(): session LBA %d overlaps the previous session!\n", this->m_dwSessionLBA);
+				return false;
+			}
+			this->m_dwNextLBA = this->m_dwSessionLBA - dwPregapLength;
+		}
+
+		// Setup the track.
+		this->m_sTrack.eMode = eMode;
+		this->m_sTrack.eSectorType = eSectorType;
+		this->m_sTrack.dwPregapLength = dwPregapLength;
+		this->m_sTrack.dwLength = 0;
+		this->m_sTrack.dwLba = this->m_dwNextLBA + dwPregapLength;
+		this->m_dwSectorSize = eSectorSize;
+		this->m_dwUserSize = (eMode == CdiTrackMode::Audio ? CDI_WRITER_AUDIO_SECTOR_SIZE : CDI_WRITER_DATA_SECTOR_SIZE);
+		this->m_dwTrackNumber = (DWORD)this->m_vTracks.size() + 1;
+		this->m_dwPartialSize = 0;
+		this->m_bTrackOpen = true;
+
+		// Write the pregap.
+		for (DWORD i = 0; i < dwPregapLength; i++)
+		{
+			if (AddSector(nullptr, this->m_sTrack.dwLba - dwPregapLength + i, true) == false)
+				return false;
+		}
+
+		return true;
+	}
+
+	bool CdiImageWriter::WriteTrackData(const BYTE *pbData, DWORD dwSize)
+	{
+		// Make sure there is a track to write to.
+		if (this->m_bTrackOpen == false)
+			return false;
+
+		// Finish off any incomplete sector first.
+		if (this->m_dwPartialSize > 0)
+		{
+			DWORD dwCopySize = this->m_dwUserSize - this->m_dwPartialSize;
+			if (dwCopySize > dwSize)
+				dwCopySize = dwSize;
+
+			memcpy(&this->m_bPartial[this->m_dwPartialSize], pbData, dwCopySize);
+			this->m_dwPartialSize += dwCopySize;
+			pbData += dwCopySize;
+			dwSize -= dwCopySize;
+
+			if (this->m_dwPartialSize < this->m_dwUserSize)
+				return true;
+
+			this->m_dwPartialSize = 0;
+			if (AddSector(this->m_bPartial, this->m_sTrack.dwLba + this->m_sTrack.dwLength, false) == false)
+				return false;
+		}
+
+		// Add all of the whole sectors.
+		while (dwSize >= this->m_dwUserSize)
+		{
+			if (AddSector(pbData, this->m_sTrack.dwLba + this->m_sTrack.dwLength, false) == false)
+				return false;
+
+			pbData += this->m_dwUserSize;
+			dwSize -= this->m_dwUserSize;
+		}
+
+		// Hold on to what is left until the rest of the sector comes in.
+		memcpy(this->m_bPartial, pbData, dwSize);
+		this->m_dwPartialSize = dwSize;
+		return true;
+	}
+
+	bool CdiImageWriter::EndTrack()
+	{
+		// Make sure there is a track to end.
+		if (this->m_bTrackOpen == false)
+			return false;
+		this->m_bTrackOpen = false;
+
+		// Pad out the last sector.
+		if (this->m_dwPartialSize > 0)
+		{
+			memset(&this->m_bPartial[this->m_dwPartialSize], 0, this->m_dwUserSize - this->m_dwPartialSize);
+			this->m_dwPartialSize = 0;
+			if (AddSector(this->m_bPartial, this->m_sTrack.dwLba + this->m_sTrack.dwLength, false) == false)
+				return false;
+		}
+
+		// A track needs at least one sector of data.
+		if (this->m_sTrack.dwLength == 0)
+		{
+			printf("CdiImageWriter::EndTrack(): track %d has no data!\n", this->m_dwTrackNumber);
+			return false;
+		}
+
+		// Write out the rest of the track.
+		if (FlushSectors() == false)
+			return false;
+
+		// Add the track to the current session.
+		this->m_vTracks.push_back(this->m_sTrack);
+		this->m_vSessionTracks.back()++;
+		this->m_dwNextLBA = this->m_sTrack.dwLba + this->m_sTrack.dwLength;
+		return true;
+	}
+
+	bool CdiImageWriter::AddSector(const BYTE *pbUserData, DWORD dwLBA, bool bPregap)
+	{
+		PBYTE pbSector = &this->m_pbBuffer[this->m_dwBufferedSectors * this->m_dwSectorSize];
+		CdiTrackMode eMode = this->m_sTrack.eMode;
+
+		// Sectors in the buffer always have consecutive LBAs, remember where the run starts.
+		if (this->m_dwBufferedSectors == 0)
+			this->m_dwBufferLBA = dwLBA;
+
+		if (eMode == CdiTrackMode::Audio || this->m_dwSectorSize == CdiSectorSize::Size_2048)
+		{
+			// Audio samples and cooked sectors are stored as is.
+			if (pbUserData != nullptr)
+				memcpy(pbSector, pbUserData, this->m_dwUserSize);
+			else
+				memset(pbSector, 0, this->m_dwUserSize);
+		}
+		else
+		{
+			// Find where the user data goes, 2336 byte sectors start at the subheader.
+			DWORD dwSubheaderOffset = (this->m_dwSectorSize == CdiSectorSize::Size_2336 ? 0 : CD_SUBHEADER_OFFSET);
+			DWORD dwDataOffset = dwSubheaderOffset + (eMode == CdiTrackMode::Mode2 ? sizeof(g_bMode2Subheader) : 0);
+
+			// Place the user data in the sector, the header, EDC and ECC are generated when the buffer is flushed.
+			memset(pbSector, 0, (this->m_dwSectorSize == CdiSectorSize::Size_2336 ? CdiSectorSize::Size_2336 : CD_RAW_SECTOR_SIZE));
+			if (eMode == CdiTrackMode::Mode2)
+				memcpy(&pbSector[dwSubheaderOffset], g_bMode2Subheader, sizeof(g_bMode2Subheader));
+			if (pbUserData != nullptr)
+				memcpy(&pbSector[dwDataOffset], pbUserData, this->m_dwUserSize);
+		}
+
+		// Count the sector and write the buffer out once it is full.
+		if (bPregap == false)
+			this->m_sTrack.dwLength++;
+		if (++this->m_dwBufferedSectors == CDI_WRITER_BUFFER_SECTORS)
+			return FlushSectors();
+
+		return true;
+	}
+
+	void CdiImageWriter::EncodeSectors(DWORD dwFirstSector, DWORD dwSectorCount)
+	{
+		CdiTrackMode eMode = this->m_sTrack.eMode;
+		CdiSectorSize eSectorSize = (CdiSectorSize)this->m_dwSectorSize;
+
+		// Loop through all of the sectors and generate everything around the user data.
+		for (DWORD i = dwFirstSector; i < dwFirstSector + dwSectorCount; i++)
+		{
+			PBYTE pbSector = &this->m_pbBuffer[(SIZE_T)i * this->m_dwSectorSize];
+			DWORD dwLBA = this->m_dwBufferLBA + i;
+			bool bPregap = ((LONG)(dwLBA - this->m_sTrack.dwLba) < 0);
+
+			// Generate the header, EDC and ECC.
+			RegenerateSectors(pbSector, eSectorSize, eMode, dwLBA, 1, RegenerateHeader | RegenerateEdcEcc);
+
+			// Generate the subchannel, the P channel flags the pregap and the Q channel holds the position of the sector.
+			if (HasSubchannel(eSectorSize) == true)
+			{
+				BYTE bSubchannel[CD_SUBCHANNEL_SIZE] = { 0 };
+				if (bPregap == true)
+					memset(bSubchannel, 0xFF, CD_SUBCHANNEL_CHANNEL_SIZE);
+
+				CdiSubchannelQ sQ;
+				sQ.bControl = (eMode == CdiTrackMode::Audio ? 0x0 : 0x4);
+				sQ.bAdr = 1;
+				sQ.bTrackNumber = (BYTE)this->m_dwTrackNumber;
+				sQ.bIndex = (bPregap == true ? 0 : 1);
+				sQ.dwRelativeFrame = (bPregap == true ? this->m_sTrack.dwLba - dwLBA : dwLBA - this->m_sTrack.dwLba);
+				sQ.dwAbsoluteLBA = dwLBA;
+				EncodeSubchannelQ(&sQ, &bSubchannel[CD_SUBCHANNEL_Q_OFFSET]);
+
+				InterleaveSubchannel(bSubchannel, eSectorSize, 1, pbSector);
+			}
+		}
+	}
+
+	bool CdiImageWriter::FlushSectors()
+	{
+		// Check there is anything to write.
+		if (this->m_dwBufferedSectors == 0)
+			return true;
+
+		// Generating the EDC/ECC is the slow part of writing, so split the sectors across the threads. The calling
+		// thread takes the first part.
+		if (CanVerifySectors((CdiSectorSize)this->m_dwSectorSize, this->m_sTrack.eMode) == true || HasSubchannel((CdiSectorSize)this->m_dwSectorSize) == true)
+		{
+			DWORD dwThreadCount = this->m_dwThreadCount;
+			if (dwThreadCount > this->m_dwBufferedSectors / CDI_WRITER_MIN_THREAD_SECTORS)
+				dwThreadCount = (this->m_dwBufferedSectors / CDI_WRITER_MIN_THREAD_SECTORS > 0 ? this->m_dwBufferedSectors / CDI_WRITER_MIN_THREAD_SECTORS : 1);
+
+			DWORD dwSectorsPerThread = (this->m_dwBufferedSectors + dwThreadCount - 1) / dwThreadCount;
+			std::vector<std::thread> vWorkers;
+			for (DWORD dwFirst = dwSectorsPerThread; dwFirst < this->m_dwBufferedSectors; dwFirst += dwSectorsPerThread)
+			{
+				DWORD dwCount = (this->m_dwBufferedSectors - dwFirst < dwSectorsPerThread ? this->m_dwBufferedSectors - dwFirst : dwSectorsPerThread);
+				vWorkers.push_back(std::thread(&CdiImageWriter::EncodeSectors, this, dwFirst, dwCount));
+			}
+
+			EncodeSectors(0, (dwSectorsPerThread < this->m_dwBufferedSectors ? dwSectorsPerThread : this->m_dwBufferedSectors));
+			for (size_t i = 0; i < vWorkers.size(); i++)
+				vWorkers[i].join();
+		}
+
+		// Write the sectors to the end of the image.
+		DWORD dwSize = this->m_dwBufferedSectors * this->m_dwSectorSize;
+		this->m_dwBufferedSectors = 0;
+		if (this->m_pDevice->WriteAt(this->m_qwOffset, this->m_pbBuffer, dwSize) == false)
+		{
+			printf("CdiImageWriter::FlushSectors(): failed to write to image file %s!\n", this->m_sFileName);
+			return false;
+		}
+
+		this->m_qwOffset += dwSize;
+		return true;
+	}
+
+	bool CdiImageWriter::WriteTrackFromFile(CString sFileName, CdiTrackMode eMode, CdiSectorType eSectorType, DWORD dwPregapLength)
+	{
+		// Open the track file.
+		IO::BlockDevice *pTrackFile = IO::OpenFileDevice(sFileName, IO::BlockDeviceAccess::ReadOnly);
+		if (pTrackFile == nullptr)
+		{
+			printf("CdiImageWriter::WriteTrackFromFile(): failed to open %s!\n", sFileName);
+			return false;
+		}
+
+		// By default the whole file is track data.
+		ULONGLONG qwDataOffset = 0;
+		ULONGLONG qwDataSize = pTrackFile->Size();
+
+		// Check if the audio is in a WAV file.
+		BYTE bRiffHeader[12];
+		if (eMode == CdiTrackMode::Audio && qwDataSize >= sizeof(bRiffHeader) && pTrackFile->ReadAt(0, bRiffHeader, sizeof(bRiffHeader)) == true &&
+			memcmp(bRiffHeader, "RIFF", 4) == 0 && memcmp(&bRiffHeader[8], "WAVE", 4) == 0)
+		{
+			// Loop through the chunks until we find the sample data.
+			bool bFoundData = false;
+			ULONGLONG qwChunkOffset = sizeof(bRiffHeader);
+			BYTE bChunkHeader[8];
+			while (qwChunkOffset + sizeof(bChunkHeader) <= qwDataSize && pTrackFile->ReadAt(qwChunkOffset, bChunkHeader, sizeof(bChunkHeader)) == true)
+			{
+				DWORD dwChunkSize = CAST_TO_DWORD(bChunkHeader, 4);
+				if (memcmp(bChunkHeader, "fmt ", 4) == 0)
+				{
+					// Only CD audio can be stored as is: PCM, 2 channels, 44.1kHz, 16 bits.
+					BYTE bFormat[16];
+					if (dwChunkSize < sizeof(bFormat) || pTrackFile->ReadAt(qwChunkOffset + sizeof(bChunkHeader), bFormat, sizeof(bFormat)) == false ||
+						CAST_TO_WORD(bFormat, 0) != 1 || CAST_TO_WORD(bFormat, 2) != 2 || CAST_TO_DWORD(bFormat, 4) != 44100 || CAST_TO_WORD(bFormat, 14) != 16)
+					{
+						printf("CdiImageWriter::WriteTrackFromFile(): %s is not 44.1kHz 16 bit stereo PCM!\n", sFileName);
+						delete pTrackFile;
+						return false;
+					}
+				}
+				else if (memcmp(bChunkHeader, "data", 4) == 0)
+				{
+					// Found the samples.
+					qwDataOffset = qwChunkOffset + sizeof(bChunkHeader);
+					qwDataSize = (dwChunkSize < qwDataSize - qwDataOffset ? dwChunkSize : qwDataSize - qwDataOffset);
+					bFoundData = true;
+					break;
+				}
+
+				// Next chunk, chunks are padded to an even size.
+				qwChunkOffset += sizeof(bChunkHeader) + dwChunkSize + (dwChunkSize & 1);
+			}
+
+			if (bFoundData == false)
+			{
+				printf("CdiImageWriter::WriteTrackFromFile(): %s has no sample data!\n", sFileName);
+				delete pTrackFile;
+				return false;
+			}
+		}
+
+		// Start the track.
+		if (BeginTrack(eMode, eSectorType, dwPregapLength) == false)
+		{
+			delete pTrackFile;
+			return false;
+		}
+
+		// Stream the file into the track a buffer at a time.
+		DWORD dwBufferSize = CDI_WRITER_BUFFER_SECTORS * this->m_dwUserSize;
+		PBYTE pbBuffer = new BYTE[dwBufferSize];
+		bool bResult = true;
+		pTrackFile->Advise(qwDataOffset, qwDataSize, IO::BlockDeviceAccessHint::Sequential);
+		for (ULONGLONG qwOffset = 0; qwOffset < qwDataSize && bResult == true; qwOffset += dwBufferSize)
+		{
+			DWORD dwReadSize = (qwDataSize - qwOffset < dwBufferSize ? (DWORD)(qwDataSize - qwOffset) : dwBufferSize);
+			if (pTrackFile->ReadAt(qwDataOffset + qwOffset, pbBuffer, dwReadSize) == false)
+			{
+				printf("CdiImageWriter::WriteTrackFromFile(): failed to read %s!\n", sFileName);
+				bResult = false;
+			}
+			else
+				bResult = WriteTrackData(pbBuffer, dwReadSize);
+		}
+
+		// Cleanup and end the track.
+		delete[] pbBuffer;
+		delete pTrackFile;
+		if (bResult == true)
+			bResult = EndTrack();
+
+		return bResult;
+	}
+
+	void CdiImageWriter::BuildSessionDescriptor(std::vector<BYTE> *pvDescriptor)
+	{
+		// Each track stores the name of the image it was written to, without the folder.
+		CString sName = this->m_sFileName;
+		int dwSeparator = sName.ReverseFind('\\');
+		if (sName.ReverseFind('/') > dwSeparator)
+			dwSeparator = sName.ReverseFind('/');
+		if (dwSeparator != -1)
+			sName = sName.Mid(dwSeparator + 1);
+		BYTE bNameLength = (BYTE)(sName.GetLength() > 255 ? 255 : sName.GetLength());
+
+		// The session count comes first.
+		pvDescriptor->clear();
+		pvDescriptor->push_back((BYTE)this->m_vSessionTracks.size());
+		pvDescriptor->push_back((BYTE)(this->m_vSessionTracks.size() >> 8));
+
+		// Write each session in the layout CdiFileHandle::ParseSessionDescriptor() reads, fields we don't know
+		// the meaning of are left zero.
+		DWORD dwTrackIndex = 0;
+		for (size_t i = 0; i < this->m_vSessionTracks.size(); i++)
+		{
+			// Track count.
+			pvDescriptor->push_back((BYTE)this->m_vSessionTracks[i]);
+			pvDescriptor->push_back((BYTE)(this->m_vSessionTracks[i] >> 8));
+
+			for (DWORD x = 0; x < this->m_vSessionTracks[i]; x++)
+			{
+				WrittenTrack *pTrack = &this->m_vTracks[dwTrackIndex++];
+
+				// No extra data, then the track start marker and 4 unknown bytes.
+				AppendDword(pvDescriptor, 0);
+				pvDescriptor->insert(pvDescriptor->end(), g_bTrackStartMarker, g_bTrackStartMarker + sizeof(g_bTrackStartMarker));
+				AppendDword(pvDescriptor, 0);
+
+				// File name followed by 19 unknown bytes.
+				pvDescriptor->push_back(bNameLength);
+				pvDescriptor->insert(pvDescriptor->end(), sName.GetString(), sName.GetString() + bNameLength);
+				pvDescriptor->insert(pvDescriptor->end(), 19, 0);
+
+				// Track layout.
+				BYTE bTrackInfo[93] = { 0 };
+				StoreDword(&bTrackInfo[6], pTrack->dwPregapLength);
+				StoreDword(&bTrackInfo[10], pTrack->dwLength);
+				StoreDword(&bTrackInfo[20], pTrack->eMode);
+				StoreDword(&bTrackInfo[36], pTrack->dwLba);
+				StoreDword(&bTrackInfo[40], pTrack->dwPregapLength + pTrack->dwLength);
+				StoreDword(&bTrackInfo[60], pTrack->eSectorType);
+				pvDescriptor->insert(pvDescriptor->end(), bTrackInfo, bTrackInfo + sizeof(bTrackInfo));
+
+				// Version 3 and later have 9 more bytes per track.
+				pvDescriptor->insert(pvDescriptor->end(), 9, 0);
+			}
+
+			// 12 unknown bytes plus one more for version 3 and later.
+			pvDescriptor->insert(pvDescriptor->end(), 12 + 1, 0);
+		}
+
+		// The descriptor info block goes at the very end, for version 3.5 it holds the size of the descriptor.
+		DWORD dwDescriptorSize = (DWORD)pvDescriptor->size() + sizeof(CdiSessionDescriptorInfo);
+		AppendDword(pvDescriptor, CdiSessionDescriptorType::Type3);
+		AppendDword(pvDescriptor, dwDescriptorSize);
+	}
+
+	bool CdiImageWriter::Close()
+	{
+		// Make sure there is an image to close.
+		if (this->m_pDevice == nullptr)
+			return false;
+
+		// End the last track and make sure every session has a track in it.
+		if ((this->m_bTrackOpen == true && EndTrack() == false) || this->m_vSessionTracks.size() == 0 || this->m_vSessionTracks.back() == 0)
+		{
+			if (this->m_vSessionTracks.size() == 0 || this->m_vSessionTracks.back() == 0)
+				printf("CdiImageWriter::Close(): the last session has no tracks!\n");
+			Cleanup();
+			return false;
+		}
+
+		// Write the session descriptor after the last track.
+		std::vector<BYTE> vDescriptor;
+		BuildSessionDescriptor(&vDescriptor);
+		bool bResult = this->m_pDevice->WriteAt(this->m_qwOffset, vDescriptor.data(), (DWORD)vDescriptor.size()) && this->m_pDevice->Flush();
+		if (bResult == false)
+			printf("CdiImageWriter::Close(): failed to write the session descriptor to %s!\n", this->m_sFileName);
+		else
+			this->m_qwOffset += vDescriptor.size();
+
+		// Close the image.
+		delete this->m_pDevice;
+		this->m_pDevice = nullptr;
+		delete[] this->m_pbBuffer;
+		this->m_pbBuffer = nullptr;
+		return bResult;
+	}
+
+	ULONGLONG CdiImageWriter::BytesWritten()
+	{
+		return this->m_qwOffset + (ULONGLONG)this->m_dwBufferedSectors * this->m_dwSectorSize;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,197 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiImageWriter.h - Streams ISO and audio tracks into a new Disk Juggler
+		image in a single pass.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "../IO/BlockDevice.h"
+#include "CdiFileHandle.h"
+#include <vector>
+
+namespace DiskJuggler
+{
+	// Number of sectors built in memory before they are written to the image.
+	#define CDI_WRITER_BUFFER_SECTORS		1024
+
+	// Smallest number of sectors worth handing to another thread for EDC/ECC generation.
+	#define CDI_WRITER_MIN_THREAD_SECTORS	64
+
+	// Default pregap length of a track, 2 seconds.
+	#define CDI_WRITER_DEFAULT_PREGAP		150
+
+	// Number of sectors between the end of one session and the start of the next: a 1:30 lead out followed by a
+	// 1:00 lead in.
+	#define CDI_WRITER_SESSION_GAP			(6750 + 4500)
+
+	// Pass to CdiImageWriter::BeginSession() to start the session right after the previous one.
+	#define CDI_WRITER_NEXT_LBA				0xFFFFFFFF
+
+	// Size of the user data of each sector passed to CdiImageWriter::WriteTrackData().
+	#define CDI_WRITER_DATA_SECTOR_SIZE		2048
+	#define CDI_WRITER_AUDIO_SECTOR_SIZE	2352
+
+	//-----------------------------------------------------
+	// CdiImageWriter
+	//-----------------------------------------------------
+	class CdiImageWriter
+	{
+	protected:
+		/*
+			Layout of a track that has been written, used to build the session descriptor.
+		*/
+		struct WrittenTrack
+		{
+			CdiTrackMode eMode;				// Mode of the track
+			CdiSectorType eSectorType;		// Type of sector stored in the image
+			DWORD dwPregapLength;			// Size of the pregap in sectors
+			DWORD dwLength;					// Size of the track in sectors
+			DWORD dwLba;					// LBA of the first sector after the pregap
+		};
+
+		IO::BlockDevice	*m_pDevice;			// Image file being written
+		CString		m_sFileName;			// File path of the image
+		DWORD		m_dwThreadCount;		// Number of threads used to generate the EDC/ECC
+		ULONGLONG	m_qwOffset;				// File offset the next sector is written to
+
+		// Sessions and tracks written so far.
+		std::vector<WrittenTrack>	m_vTracks;			// Every track in the image, in order
+		std::vector<WORD>			m_vSessionTracks;	// Number of tracks in each session
+		DWORD		m_dwNextLBA;			// LBA right after the last sector written
+		DWORD		m_dwSessionLBA;			// Requested LBA of the first track of the current session
+
+		// State of the open track.
+		bool		m_bTrackOpen;			// True while a track is being written
+		WrittenTrack m_sTrack;				// Layout of the open track
+		DWORD		m_dwSectorSize;			// Size of a sector of the open track in the image
+		DWORD		m_dwUserSize;			// Size of the user data of each sector passed to WriteTrackData()
+		DWORD		m_dwTrackNumber;		// Track number of the open track on the disc, starting at 1
+
+		// Staging buffers.
+		PBYTE		m_pbBuffer;				// Sectors built but not yet written
+		DWORD		m_dwBufferedSectors;	// Number of sectors in m_pbBuffer
+		DWORD		m_dwBufferLBA;			// LBA of the first sector in m_pbBuffer
+		BYTE		m_bPartial[CDI_WRITER_AUDIO_SECTOR_SIZE];	// User data of an incomplete sector
+		DWORD		m_dwPartialSize;		// Number of bytes in m_bPartial
+
+		/*
+			Description: Places the user data of a sector of the open track in the staging buffer and writes the
+				buffer out when it is full.
+
+			Parameters:
+				pbUserData: User data of the sector, m_dwUserSize bytes, or nullptr for an empty sector.
+				dwLBA: LBA of the sector.
+				bPregap: True if the sector is part of the pregap.
+
+			Returns: True if the sector was added, false if writing the staging buffer failed.
+		*/
+		bool AddSector(const BYTE *pbUserData, DWORD dwLBA, bool bPregap);
+
+		/*
+			Description: Generates the header, EDC/ECC and subchannel of a range of sectors in the staging buffer.
+				Called from multiple threads at once, each with its own range.
+		*/
+		void EncodeSectors(DWORD dwFirstSector, DWORD dwSectorCount);
+
+		/*
+			Description: Encodes the sectors in the staging buffer, writes them to the image and empties the buffer.
+		*/
+		bool FlushSectors();
+
+		/*
+			Description: Builds the session descriptor for all of the tracks written.
+		*/
+		void BuildSessionDescriptor(std::vector<BYTE> *pvDescriptor);
+
+		/*
+			Description: Closes the image file and frees all buffers.
+		*/
+		void Cleanup();
+
+	public:
+		/*
+			Parameters:
+				dwThreadCount: Number of threads used to generate the EDC/ECC, 0 uses one per processor.
+		*/
+		CdiImageWriter(DWORD dwThreadCount = 0);
+		~CdiImageWriter();
+
+		/*
+			Description: Creates a new image file, replacing any existing file.
+
+			Returns: True if the file was created, false otherwise.
+		*/
+		bool Create(CString sFileName);
+
+		/*
+			Description: Starts a new session, ending the previous one. Sessions must contain at least one track.
+
+			Parameters:
+				dwLBA: LBA the data of the first track in the session starts at, or CDI_WRITER_NEXT_LBA to place the
+					session right after the previous one. ISO file systems are mastered for a fixed LBA, so data
+					sessions usually need this set.
+
+			Returns: True if the session was started, false otherwise.
+		*/
+		bool BeginSession(DWORD dwLBA = CDI_WRITER_NEXT_LBA);
+
+		/*
+			Description: Starts a new track in the current session and writes its pregap.
+
+			Parameters:
+				eMode: Mode of the track.
+				eSectorType: Type of sector to store in the image. Audio tracks need a raw sector type, mode 1
+					tracks can't use Type_2336.
+				dwPregapLength: Length of the pregap in sectors.
+
+			Returns: True if the track was started, false otherwise.
+		*/
+		bool BeginTrack(CdiTrackMode eMode, CdiSectorType eSectorType, DWORD dwPregapLength = CDI_WRITER_DEFAULT_PREGAP);
+
+		/*
+			Description: Appends data to the open track. Data tracks take CDI_WRITER_DATA_SECTOR_SIZE bytes of user
+				data per sector (mode 2 tracks are written as form 1), audio tracks take CDI_WRITER_AUDIO_SECTOR_SIZE
+				bytes of 16 bit stereo samples per sector. The sync pattern, headers, EDC/ECC and subchannel are
+				generated. The data does not need to be sector aligned.
+
+			Returns: True if the data was written, false otherwise.
+		*/
+		bool WriteTrackData(const BYTE *pbData, DWORD dwSize);
+
+		/*
+			Description: Ends the open track, padding the last sector with zeros.
+
+			Returns: True if the track was written, false otherwise.
+		*/
+		bool EndTrack();
+
+		/*
+			Description: Writes a whole track from a file. Audio tracks can be read from a 44.1kHz 16 bit stereo
+				WAV file or raw samples, data tracks from an ISO file with 2048 byte sectors.
+
+			Parameters:
+				sFileName: File to read the track from.
+				eMode, eSectorType, dwPregapLength: Same as BeginTrack().
+
+			Returns: True if the track was written, false otherwise.
+		*/
+		bool WriteTrackFromFile(CString sFileName, CdiTrackMode eMode, CdiSectorType eSectorType, DWORD dwPregapLength = CDI_WRITER_DEFAULT_PREGAP);
+
+		/*
+			Description: Ends the open track and session, writes the session descriptor and closes the image.
+
+			Returns: True if the image was completed, false otherwise.
+		*/
+		bool Close();
+
+		/*
+			Description: Gets the number of bytes written to the image so far.
+		*/
+		ULONGLONG BytesWritten();
+	};
+};
\ No newline at end of file
@@ -0,0 +1,224 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiReadAhead.cpp - Background read ahead for sequential track reads.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiReadAhead.h"
+#include "CdiFileHandle.h"
+
+namespace DiskJuggler
+{
+	CdiReadAhead::CdiReadAhead(CdiFileHandle *pFileHandle, DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwChunkSectors, DWORD dwChunkCount)
+	{
+		// Make sure we have at least two chunks so the worker can fill one while the other is being read.
+		if (dwChunkSectors == 0)
+			dwChunkSectors = 1;
+		if (dwChunkCount < 2)
+			dwChunkCount = 2;
+
+		// Initialize fields.
+		this->m_pFileHandle = pFileHandle;
+		this->m_dwSessionNumber = dwSessionNumber;
+		this->m_dwTrackNumber = dwTrackNumber;
+		this->m_dwChunkSectors = dwChunkSectors;
+		this->m_qwProduceIndex = 0;
+		this->m_qwConsumeIndex = 0;
+		this->m_dwProduceLBA = 0;
+		this->m_dwNextLBA = 0;
+		this->m_bRunning = false;
+		this->m_bStop = false;
+		this->m_bWorkerDone = false;
+
+		// Get the track info.
+		CdiTrack *pTrack = &pFileHandle->GetSessions()[dwSessionNumber]->psTracks[dwTrackNumber];
+		const CdiTrackOffsetInfo *pOffsetInfo = pFileHandle->GetTrackOffsetInfo(dwSessionNumber, dwTrackNumber);
+		this->m_dwTrackLBA = pTrack->dwLba;
+		this->m_dwTrackLength = pTrack->dwLength;
+		this->m_dwSectorSize = (pTrack->eMode == CdiTrackMode::Audio ? pOffsetInfo->dwSectorStride : RAW_SECTOR_SIZE);
+
+		// Allocate the chunk buffers.
+		this->m_vChunks.resize(dwChunkCount);
+		for (DWORD i = 0; i < dwChunkCount; i++)
+		{
+			this->m_vChunks[i].dwLBA = 0;
+			this->m_vChunks[i].dwSectorCount = 0;
+			this->m_vChunks[i].pbData = new BYTE[dwChunkSectors * this->m_dwSectorSize];
+			this->m_vChunks[i].bFailed = false;
+		}
+
+		// Let the device know the track is going to be read sequentially.
+		pFileHandle->AdviseSectors(dwSessionNumber, dwTrackNumber, pTrack->dwLba, pTrack->dwLength, IO::BlockDeviceAccessHint::Sequential);
+	}
+
+	CdiReadAhead::~CdiReadAhead()
+	{
+		// Stop the worker thread.
+		Stop();
+
+		// Free the chunk buffers.
+		for (size_t i = 0; i < this->m_vChunks.size(); i++)
+			delete[] this->m_vChunks[i].pbData;
+	}
+
+	void CdiReadAhead::WorkerThread()
+	{
+		std::unique_lock<std::mutex> lock(this->m_Lock);
+
+		// Loop until we are told to stop or we reach the end of the track.
+		while (this->m_bStop == false && this->m_dwProduceLBA < this->m_dwTrackLength)
+		{
+			// Wait for a free chunk in the ring.
+			if (this->m_qwProduceIndex - this->m_qwConsumeIndex >= this->m_vChunks.size())
+			{
+				this->m_cvChunkFree.wait(lock);
+				continue;
+			}
+
+			// Setup the next chunk to be read.
+			Chunk *pChunk = &this->m_vChunks[this->m_qwProduceIndex % this->m_vChunks.size()];
+			DWORD dwSectorsRemaining = this->m_dwTrackLength - this->m_dwProduceLBA;
+			pChunk->dwLBA = this->m_dwProduceLBA;
+			pChunk->dwSectorCount = (dwSectorsRemaining < this->m_dwChunkSectors ? dwSectorsRemaining : this->m_dwChunkSectors);
+
+			// Read the chunk without holding the lock so the reader can keep copying out of the chunks already filled.
+			lock.unlock();
+			{
+				// Hint that the chunk after this one will be needed soon so the device can start on it while we copy this one.
+				DWORD dwNextLBA = pChunk->dwLBA + pChunk->dwSectorCount;
+				if (dwNextLBA < this->m_dwTrackLength)
+				{
+					DWORD dwNextCount = this->m_dwTrackLength - dwNextLBA;
+					this->m_pFileHandle->AdviseSectors(this->m_dwSessionNumber, this->m_dwTrackNumber, this->m_dwTrackLBA + dwNextLBA,
+						(dwNextCount < this->m_dwChunkSectors ? dwNextCount : this->m_dwChunkSectors), IO::BlockDeviceAccessHint::WillNeed);
+				}
+
+				// Read the sectors for the chunk.
+				pChunk->bFailed = !this->m_pFileHandle->ReadSectors(this->m_dwSessionNumber, this->m_dwTrackNumber,
+					this->m_dwTrackLBA + pChunk->dwLBA, pChunk->pbData, pChunk->dwSectorCount);
+			}
+			lock.lock();
+
+			// Publish the chunk to the reader.
+			this->m_qwProduceIndex++;
+			this->m_dwProduceLBA += pChunk->dwSectorCount;
+			this->m_cvChunkReady.notify_all();
+
+			// If the read failed there is no point in continuing.
+			if (pChunk->bFailed == true)
+				break;
+		}
+
+		// Let the reader know there will be no more chunks.
+		this->m_bWorkerDone = true;
+		this->m_cvChunkReady.notify_all();
+	}
+
+	void CdiReadAhead::Stop()
+	{
+		// Check if the worker thread is running.
+		if (this->m_bRunning == false)
+			return;
+
+		// Signal the worker to stop and wait for it to exit.
+		{
+			std::lock_guard<std::mutex> lock(this->m_Lock);
+			this->m_bStop = true;
+			this->m_cvChunkFree.notify_all();
+		}
+		this->m_Thread.join();
+		this->m_bRunning = false;
+	}
+
+	void CdiReadAhead::Restart(DWORD dwLBA)
+	{
+		// Stop the worker if it is running.
+		Stop();
+
+		// Reset the ring to start at the new LBA.
+		this->m_qwProduceIndex = 0;
+		this->m_qwConsumeIndex = 0;
+		this->m_dwProduceLBA = dwLBA;
+		this->m_dwNextLBA = dwLBA;
+		this->m_bStop = false;
+		this->m_bWorkerDone = false;
+
+		// Start the worker thread.
+		this->m_Thread = std::thread(&CdiReadAhead::WorkerThread, this);
+		this->m_bRunning = true;
+	}
+
+	bool CdiReadAhead::IsActive(DWORD dwLBA)
+	{
+		// Check if the worker is running and reading ahead from this LBA.
+		return this->m_bRunning == true && dwLBA == this->m_dwNextLBA;
+	}
+
+	bool CdiReadAhead::Read(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount)
+	{
+		// Check to make sure the data to be read wont go beyond the end of the track.
+		if (dwLBA > this->m_dwTrackLength || dwSectorCount > this->m_dwTrackLength - dwLBA)
+		{
+			// Print an error and return.
+			printf("CdiReadAhead::Read(): read operation would go beyond the length of the track!\n");
+			return false;
+		}
+
+		// If this read doesn't continue where the last one left off restart the read ahead at the new position.
+		if (IsActive(dwLBA) == false)
+			Restart(dwLBA);
+
+		// Loop and copy the sectors out of the ring.
+		std::unique_lock<std::mutex> lock(this->m_Lock);
+		while (dwSectorCount > 0)
+		{
+			// Wait for the worker to fill the next chunk.
+			if (this->m_qwConsumeIndex == this->m_qwProduceIndex)
+			{
+				// If the worker has stopped the chunk will never be filled, force the next read to restart the worker.
+				if (this->m_bWorkerDone == true)
+				{
+					this->m_dwNextLBA = 0xFFFFFFFF;
+					return false;
+				}
+
+				this->m_cvChunkReady.wait(lock);
+				continue;
+			}
+
+			// Check if the chunk was read successfully.
+			Chunk *pChunk = &this->m_vChunks[this->m_qwConsumeIndex % this->m_vChunks.size()];
+			if (pChunk->bFailed == true)
+			{
+				this->m_dwNextLBA = 0xFFFFFFFF;
+				return false;
+			}
+
+			// Copy as much of the chunk as we need.
+			DWORD dwChunkOffset = this->m_dwNextLBA - pChunk->dwLBA;
+			DWORD dwCopyCount = pChunk->dwSectorCount - dwChunkOffset;
+			if (dwCopyCount > dwSectorCount)
+				dwCopyCount = dwSectorCount;
+			memcpy(pbBuffer, &pChunk->pbData[dwChunkOffset * this->m_dwSectorSize], dwCopyCount * this->m_dwSectorSize);
+
+			// Advance past the sectors we copied.
+			pbBuffer += dwCopyCount * this->m_dwSectorSize;
+			dwSectorCount -= dwCopyCount;
+			this->m_dwNextLBA += dwCopyCount;
+
+			// If we finished with the chunk hand it back to the worker.
+			if (dwChunkOffset + dwCopyCount == pChunk->dwSectorCount)
+			{
+				this->m_qwConsumeIndex++;
+				this->m_cvChunkFree.notify_all();
+			}
+		}
+
+		// Successfully read the sectors.
+		return true;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,117 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiReadAhead.h - Background read ahead for sequential track reads.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DiskJuggler
+{
+	// Forward declarations.
+	class CdiFileHandle;
+
+	// Default number of sectors in each read ahead chunk.
+	#define CDI_READ_AHEAD_CHUNK_SECTORS		256
+
+	// Default number of chunks in the read ahead ring, the engine reads up to this many chunks ahead of the reader.
+	#define CDI_READ_AHEAD_CHUNK_COUNT			4
+
+	// Number of back to back sequential reads a track handle must see before it starts reading ahead.
+	#define CDI_READ_AHEAD_SEQUENTIAL_THRESHOLD	2
+
+	//-----------------------------------------------------
+	// CdiReadAhead
+	//-----------------------------------------------------
+	class CdiReadAhead
+	{
+	protected:
+		struct Chunk
+		{
+			DWORD dwLBA;				// First LBA in the chunk, relative to the start of the track
+			DWORD dwSectorCount;		// Number of sectors in the chunk
+			PBYTE pbData;				// Sector data
+			bool bFailed;				// True if the chunk could not be read from the image
+		};
+
+		// Track info.
+		CdiFileHandle	*m_pFileHandle;		// CDI image file handle to read from
+		DWORD		m_dwSessionNumber;		// Session number of the track
+		DWORD		m_dwTrackNumber;		// Track number of the track
+		DWORD		m_dwTrackLBA;			// Base LBA of the track
+		DWORD		m_dwTrackLength;		// Number of sectors in the track
+		DWORD		m_dwSectorSize;			// Size of each sector returned by CdiFileHandle::ReadSectors()
+
+		// Ring buffer.
+		std::vector<Chunk>	m_vChunks;		// Ring of chunk buffers
+		DWORD		m_dwChunkSectors;		// Number of sectors per chunk
+		ULONGLONG	m_qwProduceIndex;		// Number of chunks the worker has filled
+		ULONGLONG	m_qwConsumeIndex;		// Number of chunks the reader has finished with
+		DWORD		m_dwProduceLBA;			// Next LBA the worker will read
+		DWORD		m_dwNextLBA;			// Next LBA the reader is expected to read
+
+		// Worker thread.
+		std::thread	m_Thread;				// Background thread filling the ring
+		std::mutex	m_Lock;					// Protects the ring state
+		std::condition_variable	m_cvChunkReady;		// Signaled when the worker fills a chunk
+		std::condition_variable	m_cvChunkFree;		// Signaled when the reader frees a chunk or the worker should stop
+		bool		m_bRunning;				// True if the worker thread has been started
+		bool		m_bStop;				// Set to tell the worker thread to exit
+		bool		m_bWorkerDone;			// Set by the worker when it reaches the end of the track or fails
+
+		/*
+			Description: Worker thread routine, reads chunks ahead of the reader until the ring is full.
+		*/
+		void WorkerThread();
+
+		/*
+			Description: Stops the worker thread and resets the ring to start reading at dwLBA.
+		*/
+		void Restart(DWORD dwLBA);
+
+		/*
+			Description: Stops the worker thread if it is running.
+		*/
+		void Stop();
+
+	public:
+		/*
+			Description: Creates a read ahead engine for a track.
+
+			Parameters:
+				pFileHandle: CDI image file handle to read from.
+				dwSessionNumber: Session number of the track.
+				dwTrackNumber: Track number of the track.
+				dwChunkSectors: Number of sectors to read at a time.
+				dwChunkCount: Number of chunks to read ahead of the reader.
+		*/
+		CdiReadAhead(CdiFileHandle *pFileHandle, DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwChunkSectors, DWORD dwChunkCount);
+		~CdiReadAhead();
+
+		/*
+			Description: Checks if the engine is already reading ahead from dwLBA.
+		*/
+		bool IsActive(DWORD dwLBA);
+
+		/*
+			Description: Reads sectors from the track through the read ahead ring. If dwLBA is not where the last read
+				left off the ring is discarded and read ahead restarts at dwLBA.
+
+			Parameters:
+				dwLBA: LBA to begin reading at, relative to the start of the track.
+				pbBuffer: Buffer to read the sectors into.
+				dwSectorCount: Number of sectors to read.
+
+			Returns: True if the sectors were read, false otherwise.
+		*/
+		bool Read(DWORD dwLBA, PBYTE pbBuffer, DWORD dwSectorCount);
+	};
+};
\ No newline at end of file
@@ -0,0 +1,193 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiSectorCache.cpp - LRU cache of sectors read from a cdi image.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiSectorCache.h"
+
+namespace DiskJuggler
+{
+	CdiSectorCache::CdiSectorCache()
+	{
+		// Initialize fields.
+		this->m_qwBudget = CDI_DEFAULT_SECTOR_CACHE_SIZE;
+		this->m_qwBytesUsed = 0;
+		this->m_qwGeneration = 0;
+		this->m_qwHits = 0;
+		this->m_qwMisses = 0;
+		this->m_qwEvictions = 0;
+	}
+
+	CdiSectorCache::~CdiSectorCache()
+	{
+		// Free all of the cached sectors.
+		Clear();
+	}
+
+	void CdiSectorCache::SetBudget(ULONGLONG qwBudget)
+	{
+		// Set the new budget and evict anything that no longer fits.
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+		this->m_qwBudget = qwBudget;
+		Trim();
+	}
+
+	void CdiSectorCache::Trim()
+	{
+		// Evict sectors from the back of the list until we are within the budget.
+		while (this->m_qwBytesUsed > this->m_qwBudget && this->m_lEntries.size() > 0)
+		{
+			CacheEntry &sEntry = this->m_lEntries.back();
+			this->m_qwBytesUsed -= sEntry.dwSize;
+			this->m_mEntryMap.erase(sEntry.qwKey);
+			delete[] sEntry.pbData;
+			this->m_lEntries.pop_back();
+
+			this->m_qwEvictions++;
+		}
+	}
+
+	bool CdiSectorCache::Lookup(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, DWORD dwSectorSize, PBYTE pbBuffer)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// Loop and copy out each sector.
+		for (DWORD i = 0; i < dwSectorCount; i++)
+		{
+			// Check if the sector is cached.
+			auto it = this->m_mEntryMap.find(MakeKey(dwSessionNumber, dwTrackNumber, dwLBA + i));
+			if (it == this->m_mEntryMap.end() || it->second->dwSize != dwSectorSize)
+			{
+				// The rest of the sectors will be read from the image.
+				this->m_qwMisses += dwSectorCount - i;
+				return false;
+			}
+
+			// Copy the sector data and move the entry to the front of the list.
+			memcpy(&pbBuffer[i * dwSectorSize], it->second->pbData, dwSectorSize);
+			this->m_lEntries.splice(this->m_lEntries.begin(), this->m_lEntries, it->second);
+			this->m_qwHits++;
+		}
+
+		// All of the sectors were found in the cache.
+		return true;
+	}
+
+	ULONGLONG CdiSectorCache::Generation()
+	{
+		// Return the write generation.
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+		return this->m_qwGeneration;
+	}
+
+	void CdiSectorCache::Insert(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, DWORD dwSectorSize,
+		const BYTE *pbBuffer, ULONGLONG qwGeneration)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// If sectors were written while the data was being read it may be stale, so don't cache it.
+		if (qwGeneration != this->m_qwGeneration || this->m_qwBudget == 0)
+			return;
+
+		// Loop and add each sector.
+		for (DWORD i = 0; i < dwSectorCount; i++)
+		{
+			// Check if the sector is already cached.
+			ULONGLONG qwKey = MakeKey(dwSessionNumber, dwTrackNumber, dwLBA + i);
+			auto it = this->m_mEntryMap.find(qwKey);
+			if (it != this->m_mEntryMap.end())
+			{
+				// Another thread beat us to it, just move the entry to the front of the list.
+				this->m_lEntries.splice(this->m_lEntries.begin(), this->m_lEntries, it->second);
+				continue;
+			}
+
+			// Create a new entry for the sector.
+			CacheEntry sEntry;
+			sEntry.qwKey = qwKey;
+			sEntry.dwSize = dwSectorSize;
+			sEntry.pbData = new BYTE[dwSectorSize];
+			memcpy(sEntry.pbData, &pbBuffer[i * dwSectorSize], dwSectorSize);
+
+			// Add it to the front of the list.
+			this->m_lEntries.push_front(sEntry);
+			this->m_mEntryMap[qwKey] = this->m_lEntries.begin();
+			this->m_qwBytesUsed += dwSectorSize;
+		}
+
+		// Evict old sectors to stay within the budget.
+		Trim();
+	}
+
+	void CdiSectorCache::Update(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, DWORD dwSectorSize,
+		const BYTE *pbBuffer)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// Invalidate any reads that are currently in flight.
+		this->m_qwGeneration++;
+
+		// Loop and update each sector that is cached.
+		for (DWORD i = 0; i < dwSectorCount; i++)
+		{
+			auto it = this->m_mEntryMap.find(MakeKey(dwSessionNumber, dwTrackNumber, dwLBA + i));
+			if (it == this->m_mEntryMap.end())
+				continue;
+
+			// Check the size matches, if not drop the entry.
+			if (it->second->dwSize != dwSectorSize)
+			{
+				this->m_qwBytesUsed -= it->second->dwSize;
+				delete[] it->second->pbData;
+				this->m_lEntries.erase(it->second);
+				this->m_mEntryMap.erase(it);
+				continue;
+			}
+
+			// Copy in the new sector data.
+			memcpy(it->second->pbData, &pbBuffer[i * dwSectorSize], dwSectorSize);
+		}
+	}
+
+	void CdiSectorCache::Clear()
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// Free all of the sector data.
+		for (auto it = this->m_lEntries.begin(); it != this->m_lEntries.end(); it++)
+			delete[] it->pbData;
+
+		// Empty the lists.
+		this->m_lEntries.clear();
+		this->m_mEntryMap.clear();
+		this->m_qwBytesUsed = 0;
+	}
+
+	void CdiSectorCache::GetStats(CdiSectorCacheStats *pStats)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// Fill out the stats structure.
+		pStats->qwHits = this->m_qwHits;
+		pStats->qwMisses = this->m_qwMisses;
+		pStats->qwEvictions = this->m_qwEvictions;
+		pStats->qwBytesUsed = this->m_qwBytesUsed;
+		pStats->qwBudget = this->m_qwBudget;
+		pStats->dwEntryCount = (DWORD)this->m_lEntries.size();
+	}
+
+	void CdiSectorCache::ResetStats()
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// Reset the counters.
+		this->m_qwHits = 0;
+		this->m_qwMisses = 0;
+		this->m_qwEvictions = 0;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,152 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiSectorCache.h - LRU cache of sectors read from a cdi image.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace DiskJuggler
+{
+	// Default memory budget for the sector cache.
+	#define CDI_DEFAULT_SECTOR_CACHE_SIZE		0x800000
+
+	// Reads larger than this are streamed straight from the image without going through the sector cache
+	// so that dumping a whole track does not flush the sectors we actually want to keep around.
+	#define CDI_SECTOR_CACHE_MAX_READ_SECTORS	64
+
+	struct CdiSectorCacheStats
+	{
+		ULONGLONG qwHits;				// Number of sector lookups that were found in the cache
+		ULONGLONG qwMisses;				// Number of sector lookups that had to go to the image
+		ULONGLONG qwEvictions;			// Number of sectors evicted to stay within the memory budget
+		ULONGLONG qwBytesUsed;			// Number of bytes of sector data currently cached
+		ULONGLONG qwBudget;				// Maximum number of bytes of sector data that will be cached
+		DWORD dwEntryCount;				// Number of sectors currently cached
+	};
+
+	//-----------------------------------------------------
+	// CdiSectorCache
+	//-----------------------------------------------------
+	class CdiSectorCache
+	{
+	protected:
+		struct CacheEntry
+		{
+			ULONGLONG qwKey;			// Session, track and LBA of the sector
+			DWORD dwSize;				// Size of the sector data
+			PBYTE pbData;				// Sector data
+		};
+
+		std::list<CacheEntry>		m_lEntries;		// Cached sectors, most recently used first
+		std::unordered_map<ULONGLONG, std::list<CacheEntry>::iterator>	m_mEntryMap;	// Lookup from key to entry
+
+		std::mutex	m_Lock;						// Protects the cache so it can be shared by multiple threads
+		ULONGLONG	m_qwBudget;					// Maximum number of bytes of sector data to cache
+		ULONGLONG	m_qwBytesUsed;				// Number of bytes of sector data cached
+		ULONGLONG	m_qwGeneration;				// Incremented every time cached sectors are written to
+
+		// Statistics.
+		ULONGLONG	m_qwHits;
+		ULONGLONG	m_qwMisses;
+		ULONGLONG	m_qwEvictions;
+
+		/*
+			Description: Builds the cache key for a sector.
+		*/
+		static ULONGLONG MakeKey(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA)
+		{
+			return ((ULONGLONG)(dwSessionNumber & 0xFFFF) << 48) | ((ULONGLONG)(dwTrackNumber & 0xFFFF) << 32) | dwLBA;
+		}
+
+		/*
+			Description: Evicts the least recently used sectors until the cache is within its memory budget. The
+				cache lock must be held by the caller.
+		*/
+		void Trim();
+
+	public:
+		CdiSectorCache();
+		~CdiSectorCache();
+
+		/*
+			Description: Sets the memory budget for the cache, evicting sectors if the cache is over the new budget.
+
+			Parameters:
+				qwBudget: Maximum number of bytes of sector data to cache, 0 disables the cache.
+		*/
+		void SetBudget(ULONGLONG qwBudget);
+
+		/*
+			Description: Checks if the cache is enabled.
+		*/
+		bool Enabled() { return this->m_qwBudget != 0; }
+
+		/*
+			Description: Copies dwSectorCount sectors starting at dwLBA out of the cache.
+
+			Parameters:
+				dwSessionNumber: Session number of the sectors.
+				dwTrackNumber: Track number of the sectors.
+				dwLBA: LBA of the first sector.
+				dwSectorCount: Number of sectors to look up.
+				dwSectorSize: Size of each sector in pbBuffer.
+				pbBuffer: Buffer to copy the sectors into.
+
+			Returns: True if every sector was found in the cache, false otherwise. The contents of pbBuffer are
+				undefined if false is returned.
+		*/
+		bool Lookup(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, DWORD dwSectorSize, PBYTE pbBuffer);
+
+		/*
+			Description: Gets the current write generation of the cache. This should be read before the image is read
+				and passed to Insert() so sectors that were written while the read was in flight are not cached.
+		*/
+		ULONGLONG Generation();
+
+		/*
+			Description: Adds sectors read from the image to the cache.
+
+			Parameters:
+				dwSessionNumber: Session number of the sectors.
+				dwTrackNumber: Track number of the sectors.
+				dwLBA: LBA of the first sector.
+				dwSectorCount: Number of sectors to add.
+				dwSectorSize: Size of each sector in pbBuffer.
+				pbBuffer: Sector data to add.
+				qwGeneration: Value returned by Generation() before the sectors were read.
+		*/
+		void Insert(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, DWORD dwSectorSize,
+			const BYTE *pbBuffer, ULONGLONG qwGeneration);
+
+		/*
+			Description: Updates any cached copies of sectors that were written to the image so the cache stays coherent.
+
+			Parameters: See Insert().
+		*/
+		void Update(DWORD dwSessionNumber, DWORD dwTrackNumber, DWORD dwLBA, DWORD dwSectorCount, DWORD dwSectorSize,
+			const BYTE *pbBuffer);
+
+		/*
+			Description: Removes every sector from the cache.
+		*/
+		void Clear();
+
+		/*
+			Description: Gets the hit, miss and eviction counters of the cache.
+		*/
+		void GetStats(CdiSectorCacheStats *pStats);
+
+		/*
+			Description: Resets the hit, miss and eviction counters of the cache.
+		*/
+		void ResetStats();
+	};
+};
\ No newline at end of file
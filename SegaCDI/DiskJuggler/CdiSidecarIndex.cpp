@@ -0,0 +1,410 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiSidecarIndex.cpp - Sidecar file caching the parsed layout and file system
+		of a cdi image so it can be re-opened without parsing it again.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiSidecarIndex.h"
+#include "CdiEdcEcc.h"
+
+namespace DiskJuggler
+{
+	/*
+		Description: Appends a value to a byte buffer.
+	*/
+	static void AppendIndexData(std::vector<BYTE> &vBuffer, const void *pData, SIZE_T dwSize)
+	{
+		const BYTE *pbData = (const BYTE*)pData;
+		vBuffer.insert(vBuffer.end(), pbData, pbData + dwSize);
+	}
+
+	/*
+		Description: Reads a value from a byte buffer, checking it does not run past the end of the buffer.
+	*/
+	static bool ReadIndexData(const BYTE *pbBuffer, DWORD dwBufferSize, DWORD *pdwOffset, void *pData, DWORD dwSize)
+	{
+		if (dwSize > dwBufferSize - *pdwOffset)
+			return false;
+
+		memcpy(pData, &pbBuffer[*pdwOffset], dwSize);
+		*pdwOffset += dwSize;
+		return true;
+	}
+
+	CdiSidecarIndex::CdiSidecarIndex(CString sImageFileName)
+	{
+		// Initialize fields.
+		this->m_sFileName = sImageFileName + CDI_INDEX_EXTENSION;
+		memset(&this->m_sKey, 0, sizeof(this->m_sKey));
+		Reset();
+	}
+
+	void CdiSidecarIndex::Reset()
+	{
+		// Clear the contents, an empty index always needs to be written out.
+		this->m_bLoaded = false;
+		this->m_bDirty = true;
+		this->m_vLayout.clear();
+		this->m_dwBootstrapSession = CDI_INDEX_NO_BOOTSTRAP;
+		this->m_dwBootstrapTrack = CDI_INDEX_NO_BOOTSTRAP;
+		this->m_dwDirectoryEntryCount = 0;
+		this->m_vDirectoryRecords.clear();
+	}
+
+	bool CdiSidecarIndex::ComputeKey(IO::BlockDevice *pImage, CdiIndexKey *pKey)
+	{
+		// Get the size and modification time of the image.
+		pKey->qwImageSize = pImage->Size();
+		pKey->qwModifiedTime = pImage->ModifiedTime();
+
+		// Hash the tail of the image.
+		DWORD dwTailSize = (pKey->qwImageSize < CDI_INDEX_TAIL_HASH_SIZE ? (DWORD)pKey->qwImageSize : CDI_INDEX_TAIL_HASH_SIZE);
+		PBYTE pbTail = new BYTE[dwTailSize];
+		if (pImage->ReadAt(pKey->qwImageSize - dwTailSize, pbTail, dwTailSize) == false)
+		{
+			// Failed to read the tail of the image.
+			delete[] pbTail;
+			return false;
+		}
+
+		pKey->dwTailHash = ComputeEdc(0, pbTail, dwTailSize);
+		delete[] pbTail;
+		return true;
+	}
+
+	bool CdiSidecarIndex::Load(const CdiIndexKey &sKey, bool bVerbose)
+	{
+		CdiIndexHeader sHeader;
+		PBYTE pbBody = nullptr;
+		DWORD dwOffset = 0, dwSectionSize = 0, dwTrackCount = 0;
+		ULONGLONG qwSize = 0;
+
+		// Start from an empty index for this image, anything we bail out on below gets rebuilt.
+		this->m_sKey = sKey;
+		Reset();
+
+		// Open the sidecar, if it doesn't exist yet there is nothing to load.
+		IO::BlockDevice *pDevice = IO::OpenFileDevice(this->m_sFileName, IO::BlockDeviceAccess::ReadOnly);
+		if (pDevice == nullptr)
+		{
+			if (bVerbose == true) printf("no index found for image, building %s\n", this->m_sFileName);
+			return false;
+		}
+
+		// Read the whole sidecar in one go.
+		qwSize = pDevice->Size();
+		if (qwSize < sizeof(CdiIndexHeader) || qwSize > CDI_INDEX_MAX_SIZE)
+		{
+			if (bVerbose == true) printf("index %s has invalid size, rebuilding\n", this->m_sFileName);
+			goto Cleanup;
+		}
+
+		pbBody = new BYTE[(DWORD)qwSize];
+		if (pDevice->ReadAt(0, pbBody, (DWORD)qwSize) == false)
+		{
+			if (bVerbose == true) printf("failed to read index %s, rebuilding\n", this->m_sFileName);
+			goto Cleanup;
+		}
+		memcpy(&sHeader, pbBody, sizeof(CdiIndexHeader));
+
+		// Check the sidecar was built from this exact image.
+		if (sHeader.dwMagic != CDI_INDEX_MAGIC || sHeader.dwVersion != CDI_INDEX_VERSION)
+		{
+			if (bVerbose == true) printf("index %s has unsupported version, rebuilding\n", this->m_sFileName);
+			goto Cleanup;
+		}
+		if (sHeader.qwImageSize != sKey.qwImageSize || sHeader.qwModifiedTime != sKey.qwModifiedTime || sHeader.dwTailHash != sKey.dwTailHash)
+		{
+			if (bVerbose == true) printf("index %s is stale, rebuilding\n", this->m_sFileName);
+			goto Cleanup;
+		}
+
+		// Check the body is intact, a sidecar that was only partially written fails here.
+		if (sHeader.dwBodySize != qwSize - sizeof(CdiIndexHeader) ||
+			ComputeEdc(0, &pbBody[sizeof(CdiIndexHeader)], sHeader.dwBodySize) != sHeader.dwBodyHash)
+		{
+			if (bVerbose == true) printf("index %s is corrupt, rebuilding\n", this->m_sFileName);
+			goto Cleanup;
+		}
+
+		// Read out each of the sections.
+		dwOffset = sizeof(CdiIndexHeader);
+		if (ReadIndexData(pbBody, (DWORD)qwSize, &dwOffset, &dwSectionSize, sizeof(DWORD)) == false || dwSectionSize > qwSize - dwOffset)
+			goto Corrupt;
+		this->m_vLayout.assign(&pbBody[dwOffset], &pbBody[dwOffset] + dwSectionSize);
+		dwOffset += dwSectionSize;
+
+		if (ReadIndexData(pbBody, (DWORD)qwSize, &dwOffset, &this->m_dwBootstrapSession, sizeof(DWORD)) == false ||
+			ReadIndexData(pbBody, (DWORD)qwSize, &dwOffset, &this->m_dwBootstrapTrack, sizeof(DWORD)) == false ||
+			ReadIndexData(pbBody, (DWORD)qwSize, &dwOffset, &this->m_dwDirectoryEntryCount, sizeof(DWORD)) == false ||
+			ReadIndexData(pbBody, (DWORD)qwSize, &dwOffset, &dwSectionSize, sizeof(DWORD)) == false || dwSectionSize != qwSize - dwOffset)
+			goto Corrupt;
+		this->m_vDirectoryRecords.assign(&pbBody[dwOffset], &pbBody[dwOffset] + dwSectionSize);
+
+		// Make sure the layout can be used before we hand it out.
+		if (ValidateLayout(&dwTrackCount) == false)
+			goto Corrupt;
+
+		// The sidecar is valid.
+		this->m_bLoaded = true;
+		this->m_bDirty = false;
+		if (bVerbose == true) printf("loaded index %s\n", this->m_sFileName);
+
+		delete[] pbBody;
+		delete pDevice;
+		return true;
+
+	Corrupt:
+		if (bVerbose == true) printf("index %s is corrupt, rebuilding\n", this->m_sFileName);
+
+	Cleanup:
+		// Throw away anything we read and rebuild the sidecar.
+		Reset();
+		if (pbBody != nullptr)
+			delete[] pbBody;
+		delete pDevice;
+		return false;
+	}
+
+	bool CdiSidecarIndex::Save()
+	{
+		// Nothing to do if the sidecar on disk is up to date.
+		if (this->m_bDirty == false)
+			return true;
+
+		// Serialize the contents.
+		std::vector<BYTE> vSidecar(sizeof(CdiIndexHeader));
+		DWORD dwSectionSize = (DWORD)this->m_vLayout.size();
+		AppendIndexData(vSidecar, &dwSectionSize, sizeof(DWORD));
+		AppendIndexData(vSidecar, this->m_vLayout.data(), this->m_vLayout.size());
+		AppendIndexData(vSidecar, &this->m_dwBootstrapSession, sizeof(DWORD));
+		AppendIndexData(vSidecar, &this->m_dwBootstrapTrack, sizeof(DWORD));
+		AppendIndexData(vSidecar, &this->m_dwDirectoryEntryCount, sizeof(DWORD));
+		dwSectionSize = (DWORD)this->m_vDirectoryRecords.size();
+		AppendIndexData(vSidecar, &dwSectionSize, sizeof(DWORD));
+		AppendIndexData(vSidecar, this->m_vDirectoryRecords.data(), this->m_vDirectoryRecords.size());
+
+		// Fill in the header now that we know the size of the body.
+		CdiIndexHeader sHeader;
+		sHeader.dwMagic = CDI_INDEX_MAGIC;
+		sHeader.dwVersion = CDI_INDEX_VERSION;
+		sHeader.qwImageSize = this->m_sKey.qwImageSize;
+		sHeader.qwModifiedTime = this->m_sKey.qwModifiedTime;
+		sHeader.dwTailHash = this->m_sKey.dwTailHash;
+		sHeader.dwBodySize = (DWORD)(vSidecar.size() - sizeof(CdiIndexHeader));
+		sHeader.dwBodyHash = ComputeEdc(0, &vSidecar[sizeof(CdiIndexHeader)], sHeader.dwBodySize);
+		memcpy(vSidecar.data(), &sHeader, sizeof(CdiIndexHeader));
+
+		// Write the sidecar out in one go.
+		IO::BlockDevice *pDevice = IO::OpenFileDevice(this->m_sFileName, IO::BlockDeviceAccess::CreateAlways);
+		if (pDevice == nullptr)
+		{
+			// The image may be on read only media, the index is optional so just warn about it.
+			printf("CdiSidecarIndex::Save(): failed to create index file %s!\n", this->m_sFileName);
+			return false;
+		}
+
+		bool bResult = pDevice->WriteAt(0, vSidecar.data(), (DWORD)vSidecar.size());
+		delete pDevice;
+		if (bResult == false)
+		{
+			printf("CdiSidecarIndex::Save(): failed to write index file %s!\n", this->m_sFileName);
+			return false;
+		}
+
+		this->m_bDirty = false;
+		return true;
+	}
+
+	bool CdiSidecarIndex::IsLoaded()
+	{
+		return this->m_bLoaded;
+	}
+
+	bool CdiSidecarIndex::ValidateLayout(DWORD *pdwTrackCount)
+	{
+		const BYTE *pbLayout = this->m_vLayout.data();
+		DWORD dwLayoutSize = (DWORD)this->m_vLayout.size();
+		DWORD dwOffset = 0;
+		*pdwTrackCount = 0;
+
+		// Read the session count.
+		WORD wSessionCount;
+		if (ReadIndexData(pbLayout, dwLayoutSize, &dwOffset, &wSessionCount, sizeof(WORD)) == false)
+			return false;
+
+		// Loop through all the sessions and tracks.
+		for (WORD i = 0; i < wSessionCount; i++)
+		{
+			WORD wTrackCount;
+			if (ReadIndexData(pbLayout, dwLayoutSize, &dwOffset, &wTrackCount, sizeof(WORD)) == false)
+				return false;
+
+			for (WORD x = 0; x < wTrackCount; x++)
+			{
+				CdiIndexTrack sTrack;
+				if (ReadIndexData(pbLayout, dwLayoutSize, &dwOffset, &sTrack, sizeof(CdiIndexTrack)) == false ||
+					sTrack.bFileNameLength > dwLayoutSize - dwOffset)
+					return false;
+				dwOffset += sTrack.bFileNameLength;
+
+				// Check the track fits inside of the image it was built from.
+				ULONGLONG qwTrackEnd = 0;
+				if (sTrack.dwMode > CdiTrackMode::Mode2 || sTrack.dwSectorStride != sTrack.dwSectorSize ||
+					sTrack.dwSectorSize < CdiSectorSize::Size_2048 || sTrack.dwSectorSize > CdiSectorSize::Size_2448 ||
+					sTrack.dwLength > sTrack.dwTotalLength ||
+					SafeMultiply64(sTrack.dwLength, sTrack.dwSectorStride, &qwTrackEnd) == false ||
+					SafeAdd64(qwTrackEnd, sTrack.qwDataOffset, &qwTrackEnd) == false || qwTrackEnd > this->m_sKey.qwImageSize)
+					return false;
+
+				(*pdwTrackCount)++;
+			}
+		}
+
+		// There should be nothing left over.
+		return dwOffset == dwLayoutSize;
+	}
+
+	void CdiSidecarIndex::SetLayout(const CdiSession *psSessions, WORD wSessionCount, const CdiTrackOffsetInfo *psTrackOffsets)
+	{
+		// Serialize each session and track along with its offset table entry.
+		this->m_vLayout.clear();
+		AppendIndexData(this->m_vLayout, &wSessionCount, sizeof(WORD));
+
+		DWORD dwTableIndex = 0;
+		for (WORD i = 0; i < wSessionCount; i++)
+		{
+			AppendIndexData(this->m_vLayout, &psSessions[i].wTrackCount, sizeof(WORD));
+			for (WORD x = 0; x < psSessions[i].wTrackCount; x++)
+			{
+				const CdiTrack *pTrack = &psSessions[i].psTracks[x];
+				const CdiTrackOffsetInfo *pOffsetInfo = &psTrackOffsets[dwTableIndex++];
+
+				CdiIndexTrack sTrack;
+				sTrack.dwPregapLength = pTrack->dwPregapLength;
+				sTrack.dwLength = pTrack->dwLength;
+				sTrack.dwMode = pTrack->eMode;
+				sTrack.dwLba = pTrack->dwLba;
+				sTrack.dwTotalLength = pTrack->dwTotalLength;
+				sTrack.dwSectorType = pTrack->eSectorType;
+				sTrack.dwSectorSize = pTrack->eSectorSize;
+				sTrack.qwPregapOffset = pOffsetInfo->qwPregapOffset;
+				sTrack.qwDataOffset = pOffsetInfo->qwDataOffset;
+				sTrack.dwSectorStride = pOffsetInfo->dwSectorStride;
+				sTrack.dwHeaderSize = pOffsetInfo->dwHeaderSize;
+				sTrack.bFileNameLength = pTrack->bFileNameLength;
+				AppendIndexData(this->m_vLayout, &sTrack, sizeof(CdiIndexTrack));
+				AppendIndexData(this->m_vLayout, pTrack->psFileName, pTrack->bFileNameLength);
+			}
+		}
+
+		this->m_bDirty = true;
+	}
+
+	bool CdiSidecarIndex::GetLayout(CdiSession **ppsSessions, WORD *pwSessionCount, CdiTrackOffsetInfo **ppsTrackOffsets, DWORD **ppdwSessionTrackIndex)
+	{
+		// Check there is a layout and count the tracks in it.
+		DWORD dwTotalTracks = 0;
+		if (this->m_vLayout.size() == 0 || ValidateLayout(&dwTotalTracks) == false)
+			return false;
+
+		// Allocate the session array and offset tables, the layout has already been validated so the reads
+		// below can't fail.
+		const BYTE *pbLayout = this->m_vLayout.data();
+		DWORD dwLayoutSize = (DWORD)this->m_vLayout.size();
+		DWORD dwOffset = 0;
+
+		ReadIndexData(pbLayout, dwLayoutSize, &dwOffset, pwSessionCount, sizeof(WORD));
+		*ppsSessions = new CdiSession[*pwSessionCount];
+		*ppsTrackOffsets = new CdiTrackOffsetInfo[dwTotalTracks];
+		*ppdwSessionTrackIndex = new DWORD[*pwSessionCount];
+
+		DWORD dwTableIndex = 0;
+		for (WORD i = 0; i < *pwSessionCount; i++)
+		{
+			CdiSession *pSession = &(*ppsSessions)[i];
+			pSession->dwSessionNumber = i;
+			ReadIndexData(pbLayout, dwLayoutSize, &dwOffset, &pSession->wTrackCount, sizeof(WORD));
+			pSession->psTracks = new CdiTrack[pSession->wTrackCount];
+			(*ppdwSessionTrackIndex)[i] = dwTableIndex;
+
+			for (WORD x = 0; x < pSession->wTrackCount; x++)
+			{
+				CdiTrack *pTrack = &pSession->psTracks[x];
+				CdiTrackOffsetInfo *pOffsetInfo = &(*ppsTrackOffsets)[dwTableIndex++];
+
+				CdiIndexTrack sTrack;
+				ReadIndexData(pbLayout, dwLayoutSize, &dwOffset, &sTrack, sizeof(CdiIndexTrack));
+				pTrack->dwTrackNumber = x;
+				pTrack->dwPregapLength = sTrack.dwPregapLength;
+				pTrack->dwLength = sTrack.dwLength;
+				pTrack->eMode = (CdiTrackMode)sTrack.dwMode;
+				pTrack->dwLba = sTrack.dwLba;
+				pTrack->dwTotalLength = sTrack.dwTotalLength;
+				pTrack->eSectorType = (CdiSectorType)sTrack.dwSectorType;
+				pTrack->eSectorSize = (CdiSectorSize)sTrack.dwSectorSize;
+
+				// Copy the file name and null terminate it.
+				pTrack->bFileNameLength = sTrack.bFileNameLength;
+				pTrack->psFileName = new CHAR[pTrack->bFileNameLength + 1];
+				ReadIndexData(pbLayout, dwLayoutSize, &dwOffset, pTrack->psFileName, pTrack->bFileNameLength);
+				pTrack->psFileName[pTrack->bFileNameLength] = 0;
+
+				pOffsetInfo->qwPregapOffset = sTrack.qwPregapOffset;
+				pOffsetInfo->qwDataOffset = sTrack.qwDataOffset;
+				pOffsetInfo->dwSectorStride = sTrack.dwSectorStride;
+				pOffsetInfo->dwHeaderSize = sTrack.dwHeaderSize;
+			}
+		}
+
+		return true;
+	}
+
+	void CdiSidecarIndex::SetBootstrapLocation(DWORD dwSessionNumber, DWORD dwTrackNumber)
+	{
+		// Only mark the index dirty if the location actually changed.
+		if (this->m_dwBootstrapSession == dwSessionNumber && this->m_dwBootstrapTrack == dwTrackNumber)
+			return;
+
+		this->m_dwBootstrapSession = dwSessionNumber;
+		this->m_dwBootstrapTrack = dwTrackNumber;
+		this->m_bDirty = true;
+
+		// The directory tree belongs to the file system in the bootstrap track, so it has to be rebuilt as well.
+		this->m_dwDirectoryEntryCount = 0;
+		this->m_vDirectoryRecords.clear();
+	}
+
+	bool CdiSidecarIndex::GetBootstrapLocation(DWORD *pdwSessionNumber, DWORD *pdwTrackNumber)
+	{
+		if (this->m_dwBootstrapSession == CDI_INDEX_NO_BOOTSTRAP)
+			return false;
+
+		*pdwSessionNumber = this->m_dwBootstrapSession;
+		*pdwTrackNumber = this->m_dwBootstrapTrack;
+		return true;
+	}
+
+	void CdiSidecarIndex::SetDirectoryRecords(const BYTE *pbRecords, DWORD dwSize, DWORD dwEntryCount)
+	{
+		this->m_vDirectoryRecords.assign(pbRecords, pbRecords + dwSize);
+		this->m_dwDirectoryEntryCount = dwEntryCount;
+		this->m_bDirty = true;
+	}
+
+	bool CdiSidecarIndex::GetDirectoryRecords(const BYTE **ppbRecords, DWORD *pdwSize, DWORD *pdwEntryCount)
+	{
+		if (this->m_dwDirectoryEntryCount == 0)
+			return false;
+
+		*ppbRecords = this->m_vDirectoryRecords.data();
+		*pdwSize = (DWORD)this->m_vDirectoryRecords.size();
+		*pdwEntryCount = this->m_dwDirectoryEntryCount;
+		return true;
+	}
+};
\ No newline at end of file
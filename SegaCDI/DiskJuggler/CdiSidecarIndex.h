@@ -0,0 +1,193 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiSidecarIndex.h - Sidecar file caching the parsed layout and file system
+		of a cdi image so it can be re-opened without parsing it again.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "CdiFileHandle.h"
+#include <vector>
+
+namespace DiskJuggler
+{
+	// Extension appended to the image file name to get the file name of its sidecar.
+	#define CDI_INDEX_EXTENSION				".idx"
+
+	// 'CIDX', and the version of the sidecar layout. Bump the version whenever the layout changes so old sidecars
+	// are rebuilt instead of misread.
+	#define CDI_INDEX_MAGIC					0x58444943
+	#define CDI_INDEX_VERSION				1
+
+	// Number of bytes at the end of the image covered by the tail hash. The session descriptor lives at the end
+	// of the image so any change to the layout of the image changes the hash.
+	#define CDI_INDEX_TAIL_HASH_SIZE		0x10000
+
+	// Upper limit for the size of a sidecar, anything larger is treated as corrupt.
+	#define CDI_INDEX_MAX_SIZE				0x4000000
+
+	// Session and track number stored when the location of the bootstrap is not known.
+	#define CDI_INDEX_NO_BOOTSTRAP			0xFFFFFFFF
+
+	/*
+		Identifies the exact image a sidecar was built from, a sidecar with a different key is stale.
+	*/
+	struct CdiIndexKey
+	{
+		ULONGLONG qwImageSize;			// Size of the image file
+		ULONGLONG qwModifiedTime;		// Modification time of the image file
+		DWORD dwTailHash;				// EDC of the last CDI_INDEX_TAIL_HASH_SIZE bytes of the image
+	};
+
+#pragma pack(push, 1)
+	struct CdiIndexHeader
+	{
+		/* 0x00 */ DWORD dwMagic;				// CDI_INDEX_MAGIC
+		/* 0x04 */ DWORD dwVersion;				// CDI_INDEX_VERSION
+		/* 0x08 */ ULONGLONG qwImageSize;		// Key of the image the sidecar was built from
+		/* 0x10 */ ULONGLONG qwModifiedTime;
+		/* 0x18 */ DWORD dwTailHash;
+		/* 0x1C */ DWORD dwBodySize;			// Size of the data following the header
+		/* 0x20 */ DWORD dwBodyHash;			// EDC of the data following the header
+	};
+
+	/*
+		Track entry in the layout section, followed by the file name of the track.
+	*/
+	struct CdiIndexTrack
+	{
+		/* 0x00 */ DWORD dwPregapLength;
+		/* 0x04 */ DWORD dwLength;
+		/* 0x08 */ DWORD dwMode;
+		/* 0x0C */ DWORD dwLba;
+		/* 0x10 */ DWORD dwTotalLength;
+		/* 0x14 */ DWORD dwSectorType;
+		/* 0x18 */ DWORD dwSectorSize;
+		/* 0x1C */ ULONGLONG qwPregapOffset;	// Offset table entry for the track
+		/* 0x24 */ ULONGLONG qwDataOffset;
+		/* 0x2C */ DWORD dwSectorStride;
+		/* 0x30 */ DWORD dwHeaderSize;
+		/* 0x34 */ BYTE bFileNameLength;
+	};
+#pragma pack(pop)
+
+	//-----------------------------------------------------
+	// CdiSidecarIndex
+	//-----------------------------------------------------
+	class CdiSidecarIndex
+	{
+	protected:
+		CString		m_sFileName;				// File path of the sidecar
+		CdiIndexKey	m_sKey;						// Key of the image the contents belong to
+		bool		m_bLoaded;					// True if the contents were read from a valid sidecar
+		bool		m_bDirty;					// True if the contents changed since the sidecar was read or written
+
+		// Contents, after the header the sidecar holds each of these in order with a DWORD size or count before each
+		// variable length section.
+		std::vector<BYTE>	m_vLayout;			// Sessions, tracks and offset table
+		DWORD		m_dwBootstrapSession;		// Session number the bootstrap was found in
+		DWORD		m_dwBootstrapTrack;			// Track number the bootstrap was found in
+		DWORD		m_dwDirectoryEntryCount;	// Number of entries in the flattened directory tree
+		std::vector<BYTE>	m_vDirectoryRecords;	// Flattened directory tree, see ISO9660::ExportDirectoryRecords()
+
+		/*
+			Description: Clears the contents of the index.
+		*/
+		void Reset();
+
+		/*
+			Description: Walks the serialized layout and checks every session and track in it is sane.
+
+			Parameters:
+				pdwTrackCount: Receives the total number of tracks in the layout.
+
+			Returns: True if the layout is valid, false otherwise.
+		*/
+		bool ValidateLayout(DWORD *pdwTrackCount);
+
+	public:
+		/*
+			Parameters:
+				sImageFileName: File path of the image, the sidecar is stored next to it.
+		*/
+		CdiSidecarIndex(CString sImageFileName);
+
+		/*
+			Description: Computes the key identifying the current contents of an image. This reads the tail of the
+				image, everything else comes from the file system.
+
+			Parameters:
+				pImage: Device the image is stored on.
+				pKey: Receives the key.
+
+			Returns: True if the key was computed, false if the image could not be read.
+		*/
+		static bool ComputeKey(IO::BlockDevice *pImage, CdiIndexKey *pKey);
+
+		/*
+			Description: Reads the sidecar in a single read and checks it was built from the image with key sKey.
+				If the sidecar is missing, stale or corrupt the index is left empty and marked for rebuilding.
+
+			Parameters:
+				sKey: Key of the image being opened.
+				bVerbose: Boolean indicating if the reason a sidecar was rejected should be printed.
+
+			Returns: True if the sidecar was loaded, false if it has to be rebuilt.
+		*/
+		bool Load(const CdiIndexKey &sKey, bool bVerbose);
+
+		/*
+			Description: Writes the sidecar if its contents changed since it was loaded or last saved.
+
+			Returns: True if the sidecar is up to date on disk, false if it could not be written.
+		*/
+		bool Save();
+
+		/*
+			Description: Gets a boolean indicating if the contents were read from a valid sidecar.
+		*/
+		bool IsLoaded();
+
+		/*
+			Description: Stores the session layout and offset table of the image.
+		*/
+		void SetLayout(const CdiSession *psSessions, WORD wSessionCount, const CdiTrackOffsetInfo *psTrackOffsets);
+
+		/*
+			Description: Rebuilds the session array and offset tables of the image from the stored layout. The arrays
+				are allocated with new[] and owned by the caller.
+
+			Returns: True if a layout was stored, false otherwise.
+		*/
+		bool GetLayout(CdiSession **ppsSessions, WORD *pwSessionCount, CdiTrackOffsetInfo **ppsTrackOffsets, DWORD **ppdwSessionTrackIndex);
+
+		/*
+			Description: Stores the session and track number the bootstrap was found in. If the location changed the
+				directory tree is cleared, since it belongs to the file system in the bootstrap track.
+		*/
+		void SetBootstrapLocation(DWORD dwSessionNumber, DWORD dwTrackNumber);
+
+		/*
+			Description: Gets the session and track number the bootstrap was found in.
+
+			Returns: True if the location was stored, false otherwise.
+		*/
+		bool GetBootstrapLocation(DWORD *pdwSessionNumber, DWORD *pdwTrackNumber);
+
+		/*
+			Description: Stores the flattened directory tree of the file system.
+		*/
+		void SetDirectoryRecords(const BYTE *pbRecords, DWORD dwSize, DWORD dwEntryCount);
+
+		/*
+			Description: Gets the flattened directory tree of the file system. The records stay owned by the index.
+
+			Returns: True if a directory tree was stored, false otherwise.
+		*/
+		bool GetDirectoryRecords(const BYTE **ppbRecords, DWORD *pdwSize, DWORD *pdwEntryCount);
+	};
+};
\ No newline at end of file
@@ -0,0 +1,197 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiSubchannel.cpp - Subchannel de-interleaving and Q channel decoding for
+		2368/2448 byte sectors.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiSubchannel.h"
+#include "CdiEdcEcc.h"
+
+namespace DiskJuggler
+{
+	// CRC-16 CCITT polynomial, x^16 + x^12 + x^5 + 1.
+	#define CD_SUBCHANNEL_CRC_POLYNOMIAL	0x1021
+
+	/*
+		Lookup table for the Q channel CRC, built once when the program starts.
+	*/
+	static struct SubchannelCrcTable
+	{
+		WORD wCrc[256];
+
+		SubchannelCrcTable()
+		{
+			for (DWORD i = 0; i < 256; i++)
+			{
+				WORD wValue = (WORD)(i << 8);
+				for (int x = 0; x < 8; x++)
+					wValue = (WORD)((wValue << 1) ^ ((wValue & 0x8000) != 0 ? CD_SUBCHANNEL_CRC_POLYNOMIAL : 0));
+				this->wCrc[i] = wValue;
+			}
+		}
+	} g_sCrcTable;
+
+	/*
+		Description: Transposes an 8x8 bit matrix stored one row per byte, with row 0 in the most significant byte
+			and column 0 in the most significant bit of each row.
+	*/
+	static inline ULONGLONG TransposeBits8x8(ULONGLONG qwValue)
+	{
+		ULONGLONG qwTemp;
+		qwTemp = (qwValue ^ (qwValue >> 7)) & 0x00AA00AA00AA00AAULL;
+		qwValue ^= qwTemp ^ (qwTemp << 7);
+		qwTemp = (qwValue ^ (qwValue >> 14)) & 0x0000CCCC0000CCCCULL;
+		qwValue ^= qwTemp ^ (qwTemp << 14);
+		qwTemp = (qwValue ^ (qwValue >> 28)) & 0x00000000F0F0F0F0ULL;
+		qwValue ^= qwTemp ^ (qwTemp << 28);
+		return qwValue;
+	}
+
+	bool HasSubchannel(CdiSectorSize eSectorSize)
+	{
+		return eSectorSize == CdiSectorSize::Size_2368 || eSectorSize == CdiSectorSize::Size_2448;
+	}
+
+	void DeinterleaveSubchannel(const BYTE *pbSectors, CdiSectorSize eSectorSize, DWORD dwSectorCount, PBYTE pbSubchannel)
+	{
+		// Loop through all of the sectors.
+		for (DWORD i = 0; i < dwSectorCount; i++)
+		{
+			const BYTE *pbRaw = &pbSectors[(SIZE_T)i * eSectorSize + CD_MAIN_CHANNEL_SIZE];
+			PBYTE pbOutput = &pbSubchannel[(SIZE_T)i * CD_SUBCHANNEL_SIZE];
+
+			// 2368 byte sectors only carry the Q channel, which is already de-interleaved.
+			if (eSectorSize == CdiSectorSize::Size_2368)
+			{
+				memset(pbOutput, 0, CD_SUBCHANNEL_SIZE);
+				memcpy(&pbOutput[CD_SUBCHANNEL_Q_OFFSET], pbRaw, CD_SUBCHANNEL_CHANNEL_SIZE);
+				continue;
+			}
+
+			// Each group of 8 raw bytes holds one byte of every channel, with channel P in the top bit of each raw
+			// byte. Load the group as a big endian value and transpose it to get one channel per byte.
+			for (DWORD dwGroup = 0; dwGroup < CD_SUBCHANNEL_CHANNEL_SIZE; dwGroup++)
+			{
+				const BYTE *pbGroup = &pbRaw[dwGroup * 8];
+				ULONGLONG qwGroup = ((ULONGLONG)pbGroup[0] << 56) | ((ULONGLONG)pbGroup[1] << 48) | ((ULONGLONG)pbGroup[2] << 40) |
+					((ULONGLONG)pbGroup[3] << 32) | ((ULONGLONG)pbGroup[4] << 24) | ((ULONGLONG)pbGroup[5] << 16) |
+					((ULONGLONG)pbGroup[6] << 8) | (ULONGLONG)pbGroup[7];
+				qwGroup = TransposeBits8x8(qwGroup);
+
+				for (DWORD dwChannel = 0; dwChannel < 8; dwChannel++)
+					pbOutput[dwChannel * CD_SUBCHANNEL_CHANNEL_SIZE + dwGroup] = (BYTE)(qwGroup >> (56 - dwChannel * 8));
+			}
+		}
+	}
+
+	void InterleaveSubchannel(const BYTE *pbSubchannel, CdiSectorSize eSectorSize, DWORD dwSectorCount, PBYTE pbSectors)
+	{
+		// Loop through all of the sectors.
+		for (DWORD i = 0; i < dwSectorCount; i++)
+		{
+			const BYTE *pbInput = &pbSubchannel[(SIZE_T)i * CD_SUBCHANNEL_SIZE];
+			PBYTE pbRaw = &pbSectors[(SIZE_T)i * eSectorSize + CD_MAIN_CHANNEL_SIZE];
+
+			// 2368 byte sectors only carry the Q channel.
+			if (eSectorSize == CdiSectorSize::Size_2368)
+			{
+				memcpy(pbRaw, &pbInput[CD_SUBCHANNEL_Q_OFFSET], CD_SUBCHANNEL_CHANNEL_SIZE);
+				memset(&pbRaw[CD_SUBCHANNEL_CHANNEL_SIZE], 0, CdiSectorSize::Size_2368 - CD_MAIN_CHANNEL_SIZE - CD_SUBCHANNEL_CHANNEL_SIZE);
+				continue;
+			}
+
+			// Gather one byte of every channel into a group and transpose it back, the transpose is its own inverse.
+			for (DWORD dwGroup = 0; dwGroup < CD_SUBCHANNEL_CHANNEL_SIZE; dwGroup++)
+			{
+				ULONGLONG qwGroup = 0;
+				for (DWORD dwChannel = 0; dwChannel < 8; dwChannel++)
+					qwGroup |= (ULONGLONG)pbInput[dwChannel * CD_SUBCHANNEL_CHANNEL_SIZE + dwGroup] << (56 - dwChannel * 8);
+				qwGroup = TransposeBits8x8(qwGroup);
+
+				PBYTE pbGroup = &pbRaw[dwGroup * 8];
+				for (DWORD x = 0; x < 8; x++)
+					pbGroup[x] = (BYTE)(qwGroup >> (56 - x * 8));
+			}
+		}
+	}
+
+	WORD ComputeSubchannelCrc(const BYTE *pbData, DWORD dwSize)
+	{
+		// Run the data through the table.
+		WORD wCrc = 0;
+		for (DWORD i = 0; i < dwSize; i++)
+			wCrc = (WORD)((wCrc << 8) ^ g_sCrcTable.wCrc[(wCrc >> 8) ^ pbData[i]]);
+
+		return wCrc;
+	}
+
+	/*
+		Description: Converts a BCD encoded byte to binary.
+	*/
+	static inline DWORD BcdToBinary(BYTE bValue)
+	{
+		return (bValue >> 4) * 10 + (bValue & 0xF);
+	}
+
+	/*
+		Description: Converts a binary value below 100 to BCD.
+	*/
+	static inline BYTE BinaryToBcd(DWORD dwValue)
+	{
+		return (BYTE)(((dwValue / 10) << 4) | (dwValue % 10));
+	}
+
+	bool DecodeSubchannelQ(const BYTE *pbQ, CdiSubchannelQ *pQ)
+	{
+		// Check the CRC, it is stored inverted and big endian.
+		WORD wCrc = (WORD)((pbQ[CD_SUBCHANNEL_Q_CRC_OFFSET] << 8) | pbQ[CD_SUBCHANNEL_Q_CRC_OFFSET + 1]);
+		pQ->bCrcValid = (ComputeSubchannelCrc(pbQ, CD_SUBCHANNEL_Q_CRC_OFFSET) == (WORD)~wCrc);
+
+		// Decode the control and mode.
+		pQ->bControl = pbQ[0] >> 4;
+		pQ->bAdr = pbQ[0] & 0xF;
+
+		// Only mode 1 carries the position of the sector.
+		if (pQ->bAdr != 1)
+		{
+			pQ->bTrackNumber = 0;
+			pQ->bIndex = 0;
+			pQ->dwRelativeFrame = 0;
+			pQ->dwAbsoluteLBA = 0;
+			return pQ->bCrcValid;
+		}
+
+		// Decode the track, index and addresses. The lead out track number is not BCD.
+		pQ->bTrackNumber = (pbQ[1] == 0xAA ? 0xAA : (BYTE)BcdToBinary(pbQ[1]));
+		pQ->bIndex = (BYTE)BcdToBinary(pbQ[2]);
+		pQ->dwRelativeFrame = (BcdToBinary(pbQ[3]) * 60 + BcdToBinary(pbQ[4])) * 75 + BcdToBinary(pbQ[5]);
+		pQ->dwAbsoluteLBA = (BcdToBinary(pbQ[7]) * 60 + BcdToBinary(pbQ[8])) * 75 + BcdToBinary(pbQ[9]) - CD_MSF_LBA_OFFSET;
+
+		return pQ->bCrcValid;
+	}
+
+	void EncodeSubchannelQ(const CdiSubchannelQ *pQ, PBYTE pbQ)
+	{
+		// Encode the control, mode and track number. The lead out track number is not BCD.
+		pbQ[0] = (BYTE)((pQ->bControl << 4) | (pQ->bAdr & 0xF));
+		pbQ[1] = (pQ->bTrackNumber == 0xAA ? 0xAA : BinaryToBcd(pQ->bTrackNumber));
+		pbQ[2] = BinaryToBcd(pQ->bIndex);
+
+		// Encode the relative and absolute addresses as MSF.
+		pbQ[3] = BinaryToBcd(pQ->dwRelativeFrame / (60 * 75));
+		pbQ[4] = BinaryToBcd((pQ->dwRelativeFrame / 75) % 60);
+		pbQ[5] = BinaryToBcd(pQ->dwRelativeFrame % 75);
+		pbQ[6] = 0;
+		LbaToMsf(pQ->dwAbsoluteLBA, &pbQ[7]);
+
+		// Store the CRC inverted and big endian.
+		WORD wCrc = (WORD)~ComputeSubchannelCrc(pbQ, CD_SUBCHANNEL_Q_CRC_OFFSET);
+		pbQ[CD_SUBCHANNEL_Q_CRC_OFFSET] = (BYTE)(wCrc >> 8);
+		pbQ[CD_SUBCHANNEL_Q_CRC_OFFSET + 1] = (BYTE)wCrc;
+	}
+};
\ No newline at end of file
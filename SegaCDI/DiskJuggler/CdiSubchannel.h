@@ -0,0 +1,101 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiSubchannel.h - Subchannel de-interleaving and Q channel decoding for
+		2368/2448 byte sectors.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "CdiFileHandle.h"
+
+namespace DiskJuggler
+{
+	// Size of the main channel data at the start of every sector that carries subchannel data.
+	#define CD_MAIN_CHANNEL_SIZE			2352
+
+	// Size of the de-interleaved subchannel data for one sector: 8 channels (P to W) of 12 bytes each.
+	#define CD_SUBCHANNEL_SIZE				96
+	#define CD_SUBCHANNEL_CHANNEL_SIZE		12
+
+	// Offset of the Q channel in the de-interleaved subchannel data.
+	#define CD_SUBCHANNEL_Q_OFFSET			12
+
+	// Size of the Q channel data covered by the CRC.
+	#define CD_SUBCHANNEL_Q_CRC_OFFSET		10
+
+	/*
+		Decoded Q channel of a single sector.
+	*/
+	struct CdiSubchannelQ
+	{
+		BYTE bControl;					// Control bits, 0x4 is set for data tracks
+		BYTE bAdr;						// Mode of the Q channel, only mode 1 (position) carries the fields below
+		BYTE bTrackNumber;				// Track number, 0xAA is the lead out
+		BYTE bIndex;					// Index within the track, 0 is the pregap
+		DWORD dwRelativeFrame;			// Frame number relative to the start of the index
+		DWORD dwAbsoluteLBA;			// LBA of the sector
+		bool bCrcValid;					// True if the CRC of the Q channel is valid
+	};
+
+	/*
+		Description: Gets a boolean indicating if sectors of the given size carry subchannel data after the main channel.
+	*/
+	bool HasSubchannel(CdiSectorSize eSectorSize);
+
+	/*
+		Description: Extracts and de-interleaves the subchannel data of a run of sectors. 2448 byte sectors store the
+			96 bytes of raw P-W subchannel with one bit from each channel per byte, which is transposed 8 bytes at a
+			time. 2368 byte sectors only store the 12 bytes of the Q channel (followed by 4 bytes of padding), the
+			other channels are returned as zeros.
+
+		Parameters:
+			pbSectors: Sectors in the layout they are stored in the image.
+			eSectorSize: Size of each sector in the image, must be Size_2368 or Size_2448.
+			dwSectorCount: Number of sectors in pbSectors.
+			pbSubchannel: Buffer that receives CD_SUBCHANNEL_SIZE bytes per sector, each channel in order from P to W.
+	*/
+	void DeinterleaveSubchannel(const BYTE *pbSectors, CdiSectorSize eSectorSize, DWORD dwSectorCount, PBYTE pbSubchannel);
+
+	/*
+		Description: Interleaves de-interleaved subchannel data back into a run of sectors, the reverse of
+			DeinterleaveSubchannel(). 2368 byte sectors only receive the Q channel followed by 4 bytes of padding.
+
+		Parameters:
+			pbSubchannel: CD_SUBCHANNEL_SIZE bytes per sector, each channel in order from P to W.
+			eSectorSize: Size of each sector in the image, must be Size_2368 or Size_2448.
+			dwSectorCount: Number of sectors in pbSectors.
+			pbSectors: Sectors in the layout they are stored in the image, the subchannel data after the main channel
+				of each sector is overwritten.
+	*/
+	void InterleaveSubchannel(const BYTE *pbSubchannel, CdiSectorSize eSectorSize, DWORD dwSectorCount, PBYTE pbSectors);
+
+	/*
+		Description: Computes the CRC-16 (CCITT) used by the Q channel. The CRC is stored inverted after the data.
+	*/
+	WORD ComputeSubchannelCrc(const BYTE *pbData, DWORD dwSize);
+
+	/*
+		Description: Decodes the Q channel of a sector.
+
+		Parameters:
+			pbQ: CD_SUBCHANNEL_CHANNEL_SIZE bytes of Q channel data.
+			pQ: Receives the decoded fields.
+
+		Returns: True if the CRC of the Q channel is valid, false otherwise.
+	*/
+	bool DecodeSubchannelQ(const BYTE *pbQ, CdiSubchannelQ *pQ);
+
+	/*
+		Description: Encodes the Q channel of a sector, the reverse of DecodeSubchannelQ(). bCrcValid is ignored and
+			a valid CRC is always written.
+
+		Parameters:
+			pQ: Fields to encode, bAdr must be 1.
+			pbQ: Buffer that receives CD_SUBCHANNEL_CHANNEL_SIZE bytes of Q channel data.
+	*/
+	void EncodeSubchannelQ(const CdiSubchannelQ *pQ, PBYTE pbQ);
+};
\ No newline at end of file
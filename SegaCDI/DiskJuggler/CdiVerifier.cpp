@@ -0,0 +1,240 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiVerifier.cpp - Parallel EDC/ECC verification of every sector in a cdi image.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiVerifier.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace DiskJuggler
+{
+	DWORD CdiVerifyReport::BadSectorCount()
+	{
+		// Add up the bad sectors of each track.
+		DWORD dwCount = 0;
+		for (size_t i = 0; i < this->vTracks.size(); i++)
+			dwCount += (DWORD)this->vTracks[i].vBadSectors.size();
+
+		return dwCount;
+	}
+
+	void CdiVerifyReport::Print(bool bVerbose)
+	{
+		// Print the result for each track.
+		for (size_t i = 0; i < this->vTracks.size(); i++)
+		{
+			CdiTrackVerifyReport *pTrack = &this->vTracks[i];
+			printf("session %d track %d \t%s/%d \t", pTrack->dwSessionNumber + 1, pTrack->dwTrackNumber + 1,
+				(pTrack->eMode == CdiTrackMode::Audio ? "audio" : (pTrack->eMode == CdiTrackMode::Mode1 ? "mode1" : "mode2")), pTrack->eSectorSize);
+
+			if (pTrack->bVerified == false)
+			{
+				printf("skipped, no EDC/ECC or subchannel data\n");
+				continue;
+			}
+			printf("%d sectors \t%d bad\n", pTrack->dwSectorsVerified, (DWORD)pTrack->vBadSectors.size());
+
+			// Print each bad sector and what is wrong with it.
+			for (size_t x = 0; x < pTrack->vBadSectors.size() && bVerbose == true; x++)
+			{
+				DWORD dwErrors = pTrack->vBadSectors[x].dwErrors;
+				printf("\tLBA %d:%s%s%s%s%s%s%s%s%s\n", pTrack->vBadSectors[x].dwLBA,
+					(dwErrors & SectorReadError) != 0 ? " read" : "",
+					(dwErrors & SectorSyncError) != 0 ? " sync" : "",
+					(dwErrors & SectorAddressError) != 0 ? " address" : "",
+					(dwErrors & SectorModeError) != 0 ? " mode" : "",
+					(dwErrors & SectorSubheaderError) != 0 ? " subheader" : "",
+					(dwErrors & SectorEdcError) != 0 ? " edc" : "",
+					(dwErrors & SectorEccPError) != 0 ? " ecc-p" : "",
+					(dwErrors & SectorEccQError) != 0 ? " ecc-q" : "",
+					(dwErrors & SectorSubchannelError) != 0 ? " subchannel" : "");
+			}
+		}
+
+		// Print the totals and throughput.
+		double dGigabytes = (double)this->qwBytesVerified / (1024.0 * 1024.0 * 1024.0);
+		printf("verified %.2f MB in %.3f s on %d threads, %.2f GB/s, %d bad sectors\n", dGigabytes * 1024.0, this->dSeconds,
+			this->dwThreadCount, (this->dSeconds > 0.0 ? dGigabytes / this->dSeconds : 0.0), BadSectorCount());
+	}
+
+	CdiVerifier::CdiVerifier(CdiFileHandle *pCdiFile, DWORD dwThreadCount)
+	{
+		// Initialize fields.
+		this->m_pCdiFile = pCdiFile;
+		this->m_pReport = nullptr;
+		this->m_dwNextJob = 0;
+
+		// Default to one thread per processor.
+		this->m_dwThreadCount = dwThreadCount;
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = std::thread::hardware_concurrency();
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = 1;
+	}
+
+	bool CdiVerifier::VerifyImage(CdiVerifyReport *pReport)
+	{
+		// Split the image into jobs.
+		PrepareJobs(pReport);
+
+		// Spin up the workers and wait for them to chew through all of the jobs.
+		auto tStart = std::chrono::steady_clock::now();
+		this->m_dwNextJob = 0;
+		std::vector<std::thread> vWorkers;
+		for (DWORD i = 0; i < this->m_dwThreadCount; i++)
+			vWorkers.push_back(std::thread(&CdiVerifier::WorkerThread, this));
+		for (size_t i = 0; i < vWorkers.size(); i++)
+			vWorkers[i].join();
+		pReport->dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+		// Sort the results.
+		return FinishReport();
+	}
+
+	DWORD CdiVerifier::PrepareJobs(CdiVerifyReport *pReport)
+	{
+		// Get a view of the sessions from the file handle.
+		ArrayView<CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+
+		// Setup the report.
+		pReport->vTracks.clear();
+		pReport->qwBytesVerified = 0;
+		pReport->dSeconds = 0.0;
+		pReport->dwThreadCount = this->m_dwThreadCount;
+		this->m_pReport = pReport;
+
+		// Loop through all the tracks and split the ones we can verify into jobs.
+		this->m_vJobs.clear();
+		for (DWORD i = 0; i < sessionCollection.size(); i++)
+		{
+			for (DWORD x = 0; x < sessionCollection[i]->wTrackCount; x++)
+			{
+				CdiTrack *pTrack = &sessionCollection[i]->psTracks[x];
+
+				// Add the track to the report.
+				CdiTrackVerifyReport sTrackReport;
+				sTrackReport.dwSessionNumber = i;
+				sTrackReport.dwTrackNumber = x;
+				sTrackReport.eMode = pTrack->eMode;
+				sTrackReport.eSectorSize = pTrack->eSectorSize;
+				sTrackReport.bVerified = (CanVerifySectors(pTrack->eSectorSize, pTrack->eMode) == true || HasSubchannel(pTrack->eSectorSize) == true);
+				sTrackReport.dwSectorsVerified = 0;
+				pReport->vTracks.push_back(sTrackReport);
+
+				if (sTrackReport.bVerified == false)
+					continue;
+
+				// Split the track into jobs so large tracks are spread across all of the threads.
+				for (DWORD dwOffset = 0; dwOffset < pTrack->dwLength; dwOffset += CDI_VERIFY_JOB_SECTORS)
+				{
+					VerifyJob sJob;
+					sJob.dwReportIndex = (DWORD)pReport->vTracks.size() - 1;
+					sJob.dwLBA = pTrack->dwLba + dwOffset;
+					sJob.dwSectorCount = (pTrack->dwLength - dwOffset < CDI_VERIFY_JOB_SECTORS ? pTrack->dwLength - dwOffset : CDI_VERIFY_JOB_SECTORS);
+					this->m_vJobs.push_back(sJob);
+				}
+			}
+		}
+
+		return (DWORD)this->m_vJobs.size();
+	}
+
+	bool CdiVerifier::FinishReport()
+	{
+		// Jobs finish in any order, sort the bad sectors of each track by LBA.
+		bool bResult = true;
+		for (size_t i = 0; i < this->m_pReport->vTracks.size(); i++)
+		{
+			std::vector<CdiBadSector> &vBadSectors = this->m_pReport->vTracks[i].vBadSectors;
+			std::sort(vBadSectors.begin(), vBadSectors.end(), [](const CdiBadSector &a, const CdiBadSector &b) { return a.dwLBA < b.dwLBA; });
+
+			for (size_t x = 0; x < vBadSectors.size() && bResult == true; x++)
+			{
+				if ((vBadSectors[x].dwErrors & SectorReadError) != 0)
+					bResult = false;
+			}
+		}
+
+		this->m_pReport = nullptr;
+		return bResult;
+	}
+
+	void CdiVerifier::WorkerThread()
+	{
+		// Allocate a buffer large enough for a read of the largest sector size.
+		PBYTE pbBuffer = new BYTE[CDI_VERIFY_SECTOR_BUFFER_SIZE];
+		PBYTE pbSubchannel = new BYTE[CDI_VERIFY_SUBCHANNEL_BUFFER_SIZE];
+
+		// Loop until there are no jobs left.
+		while (true)
+		{
+			DWORD dwJobIndex = this->m_dwNextJob++;
+			if (dwJobIndex >= this->m_vJobs.size())
+				break;
+
+			RunJob(dwJobIndex, pbBuffer, pbSubchannel);
+		}
+
+		// Free the read buffers.
+		delete[] pbSubchannel;
+		delete[] pbBuffer;
+	}
+
+	void CdiVerifier::RunJob(DWORD dwJobIndex, PBYTE pbBuffer, PBYTE pbSubchannel)
+	{
+		VerifyJob *pJob = &this->m_vJobs[dwJobIndex];
+		CdiTrackVerifyReport *pTrackReport = &this->m_pReport->vTracks[pJob->dwReportIndex];
+		bool bCheckSectors = CanVerifySectors(pTrackReport->eSectorSize, pTrackReport->eMode);
+		bool bCheckSubchannel = HasSubchannel(pTrackReport->eSectorSize);
+		std::vector<CdiBadSector> vBadSectors;
+
+		// Loop and read the sectors of the job.
+		for (DWORD dwOffset = 0; dwOffset < pJob->dwSectorCount; dwOffset += CDI_VERIFY_READ_SECTORS)
+		{
+			DWORD dwLBA = pJob->dwLBA + dwOffset;
+			DWORD dwCount = (pJob->dwSectorCount - dwOffset < CDI_VERIFY_READ_SECTORS ? pJob->dwSectorCount - dwOffset : CDI_VERIFY_READ_SECTORS);
+
+			// Read the raw sectors, if this fails flag all of them as bad.
+			if (this->m_pCdiFile->ReadRawSectors(pTrackReport->dwSessionNumber, pTrackReport->dwTrackNumber, dwLBA, pbBuffer, dwCount) == false)
+			{
+				for (DWORD i = 0; i < dwCount; i++)
+					vBadSectors.push_back({ dwLBA + i, SectorReadError });
+				continue;
+			}
+
+			// De-interleave the subchannel data of all the sectors we just read.
+			if (bCheckSubchannel == true)
+				DeinterleaveSubchannel(pbBuffer, pTrackReport->eSectorSize, dwCount, pbSubchannel);
+
+			// Check each sector.
+			for (DWORD i = 0; i < dwCount; i++)
+			{
+				DWORD dwErrors = SectorOk;
+				if (bCheckSectors == true)
+					dwErrors = VerifySector(&pbBuffer[i * pTrackReport->eSectorSize], pTrackReport->eSectorSize, pTrackReport->eMode, dwLBA + i);
+
+				// Check the Q channel is intact and, if it holds a position, that it points at this sector.
+				CdiSubchannelQ sQ;
+				if (bCheckSubchannel == true && (DecodeSubchannelQ(&pbSubchannel[i * CD_SUBCHANNEL_SIZE + CD_SUBCHANNEL_Q_OFFSET], &sQ) == false ||
+					(sQ.bAdr == 1 && sQ.dwAbsoluteLBA != dwLBA + i)))
+					dwErrors |= SectorSubchannelError;
+
+				if (dwErrors != SectorOk)
+					vBadSectors.push_back({ dwLBA + i, dwErrors });
+			}
+		}
+
+		// Add the results of the job to the report.
+		std::lock_guard<std::mutex> lock(this->m_ReportLock);
+		pTrackReport->dwSectorsVerified += pJob->dwSectorCount;
+		pTrackReport->vBadSectors.insert(pTrackReport->vBadSectors.end(), vBadSectors.begin(), vBadSectors.end());
+		this->m_pReport->qwBytesVerified += (ULONGLONG)pJob->dwSectorCount * pTrackReport->eSectorSize;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,142 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiVerifier.h - Parallel EDC/ECC verification of every sector in a cdi image.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "CdiFileHandle.h"
+#include "CdiEdcEcc.h"
+#include "CdiSubchannel.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace DiskJuggler
+{
+	// Number of sectors in a single unit of work handed to a verification thread.
+	#define CDI_VERIFY_JOB_SECTORS			4096
+
+	// Number of sectors read from the image at a time while verifying.
+	#define CDI_VERIFY_READ_SECTORS			256
+
+	// Size of the sector and subchannel buffers passed to CdiVerifier::RunJob().
+	#define CDI_VERIFY_SECTOR_BUFFER_SIZE		(CDI_VERIFY_READ_SECTORS * DiskJuggler::CdiSectorSize::Size_2448)
+	#define CDI_VERIFY_SUBCHANNEL_BUFFER_SIZE	(CDI_VERIFY_READ_SECTORS * CD_SUBCHANNEL_SIZE)
+
+	struct CdiBadSector
+	{
+		DWORD dwLBA;					// LBA of the sector
+		DWORD dwErrors;					// Combination of CdiSectorError flags
+	};
+
+	struct CdiTrackVerifyReport
+	{
+		DWORD dwSessionNumber;			// Session number the track is located in
+		DWORD dwTrackNumber;			// Track number in the session
+		CdiTrackMode eMode;				// Mode of the track
+		CdiSectorSize eSectorSize;		// Size of the sectors in the image
+		bool bVerified;					// False if the track has no EDC/ECC or subchannel data to check
+		DWORD dwSectorsVerified;		// Number of sectors checked
+		std::vector<CdiBadSector> vBadSectors;	// Sectors that failed verification, ordered by LBA
+	};
+
+	struct CdiVerifyReport
+	{
+		std::vector<CdiTrackVerifyReport> vTracks;	// Report for every track in the image
+		ULONGLONG qwBytesVerified;		// Number of bytes of sector data checked
+		double dSeconds;				// Time taken to verify the image
+		DWORD dwThreadCount;			// Number of threads used
+
+		/*
+			Description: Gets the total number of bad sectors across all tracks.
+		*/
+		DWORD BadSectorCount();
+
+		/*
+			Description: Prints the per track summary, and every bad sector if bVerbose is set.
+		*/
+		void Print(bool bVerbose);
+	};
+
+	//-----------------------------------------------------
+	// CdiVerifier
+	//-----------------------------------------------------
+	class CdiVerifier
+	{
+	protected:
+		struct VerifyJob
+		{
+			DWORD dwReportIndex;		// Index of the track in the report
+			DWORD dwLBA;				// First LBA to check
+			DWORD dwSectorCount;		// Number of sectors to check
+		};
+
+		CdiFileHandle	*m_pCdiFile;				// Image to verify
+		DWORD			m_dwThreadCount;			// Number of worker threads to use
+
+		std::vector<VerifyJob>	m_vJobs;			// Work to be done
+		std::atomic<DWORD>	m_dwNextJob;			// Index of the next job to be picked up by a worker
+		std::mutex		m_ReportLock;				// Protects the report while workers add bad sectors to it
+		CdiVerifyReport	*m_pReport;					// Report being filled in
+
+		/*
+			Description: Worker thread routine, verifies jobs until there are none left.
+		*/
+		void WorkerThread();
+
+	public:
+		/*
+			Parameters:
+				pCdiFile: Image to verify.
+				dwThreadCount: Number of threads to verify with, 0 uses one per processor.
+		*/
+		CdiVerifier(CdiFileHandle *pCdiFile, DWORD dwThreadCount = 0);
+
+		/*
+			Description: Checks the sync, header, subheader, EDC and ECC of every sector in every data track
+				that stores raw sectors, and the Q channel of every sector in tracks that store subchannel data.
+				Tracks are split into jobs and spread across all worker threads.
+
+			Parameters:
+				pReport: Receives the per track results.
+
+			Returns: True if every sector was checked, false if the image could not be read. Bad sectors do not
+				cause this to fail, check the report.
+		*/
+		bool VerifyImage(CdiVerifyReport *pReport);
+
+		/*
+			Description: Splits the image into jobs without verifying anything, so the caller can run the jobs on its
+				own threads with RunJob() and then call FinishReport(). VerifyImage() does all three.
+
+			Parameters:
+				pReport: Receives the per track results, must stay valid until FinishReport() is called.
+
+			Returns: The number of jobs to run.
+		*/
+		DWORD PrepareJobs(CdiVerifyReport *pReport);
+
+		/*
+			Description: Verifies the sectors of a single job and adds the bad sectors to the report. Jobs can be
+				run from any number of threads at once.
+
+			Parameters:
+				dwJobIndex: Index of the job, less than the count returned by PrepareJobs().
+				pbBuffer: Scratch buffer of CDI_VERIFY_SECTOR_BUFFER_SIZE bytes.
+				pbSubchannel: Scratch buffer of CDI_VERIFY_SUBCHANNEL_BUFFER_SIZE bytes.
+		*/
+		void RunJob(DWORD dwJobIndex, PBYTE pbBuffer, PBYTE pbSubchannel);
+
+		/*
+			Description: Sorts the bad sectors of each track once every job has been run.
+
+			Returns: True if every sector was read, false if any of them could not be read from the image.
+		*/
+		bool FinishReport();
+	};
+};
\ No newline at end of file
@@ -0,0 +1,157 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiWriteBuffer.cpp - Write behind buffer that coalesces sector writes to a
+		cdi image into large contiguous writes.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiWriteBuffer.h"
+
+namespace DiskJuggler
+{
+	CdiWriteBuffer::CdiWriteBuffer()
+	{
+		// Initialize fields.
+		this->m_pDevice = nullptr;
+		this->m_pbBuffer = nullptr;
+		this->m_dwBufferSize = CDI_DEFAULT_WRITE_BUFFER_SIZE;
+		this->m_qwRunOffset = 0;
+		this->m_dwRunSize = 0;
+		this->m_qwBytesStaged = 0;
+		this->m_qwBytesWritten = 0;
+		this->m_qwWriteCount = 0;
+	}
+
+	CdiWriteBuffer::~CdiWriteBuffer()
+	{
+		// Write out anything that is still staged and free the buffer.
+		Flush();
+		if (this->m_pbBuffer != nullptr)
+			AlignedFree(this->m_pbBuffer);
+	}
+
+	void CdiWriteBuffer::Attach(IO::BlockDevice *pDevice)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+		this->m_pDevice = pDevice;
+		this->m_dwRunSize = 0;
+	}
+
+	void CdiWriteBuffer::SetSize(DWORD dwSize)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// Flush and free the old buffer, the new one is allocated on the next write.
+		FlushRun();
+		if (this->m_pbBuffer != nullptr)
+		{
+			AlignedFree(this->m_pbBuffer);
+			this->m_pbBuffer = nullptr;
+		}
+
+		this->m_dwBufferSize = dwSize;
+	}
+
+	bool CdiWriteBuffer::Write(ULONGLONG qwOffset, const void *pData, DWORD dwSize)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// If buffering is disabled or the write would not fit in the buffer anyway write it straight to the device,
+		// flushing the staged run first so the writes land in order.
+		if (dwSize >= this->m_dwBufferSize)
+		{
+			bool bResult = FlushRun();
+			return WriteThrough(qwOffset, pData, dwSize) == true && bResult == true;
+		}
+
+		// Allocate the buffer on first use.
+		if (this->m_pbBuffer == nullptr)
+		{
+			this->m_pbBuffer = (PBYTE)AlignedAlloc(this->m_dwBufferSize);
+			if (this->m_pbBuffer == nullptr)
+				return WriteThrough(qwOffset, pData, dwSize);
+		}
+
+		// Check if the write lands inside of the staged run, or continues it and still fits in the buffer.
+		bool bResult = true;
+		if (this->m_dwRunSize != 0 && qwOffset >= this->m_qwRunOffset && qwOffset - this->m_qwRunOffset <= this->m_dwRunSize &&
+			qwOffset - this->m_qwRunOffset + dwSize <= this->m_dwBufferSize)
+		{
+			// Copy the data into the run, growing it if the write goes past the end.
+			DWORD dwRunOffset = (DWORD)(qwOffset - this->m_qwRunOffset);
+			memcpy(&this->m_pbBuffer[dwRunOffset], pData, dwSize);
+			if (dwRunOffset + dwSize > this->m_dwRunSize)
+				this->m_dwRunSize = dwRunOffset + dwSize;
+		}
+		else
+		{
+			// Write out the staged run and start a new one with this write.
+			bResult = FlushRun();
+			memcpy(this->m_pbBuffer, pData, dwSize);
+			this->m_qwRunOffset = qwOffset;
+			this->m_dwRunSize = dwSize;
+		}
+
+		this->m_qwBytesStaged += dwSize;
+		return bResult;
+	}
+
+	bool CdiWriteBuffer::FlushRange(ULONGLONG qwOffset, ULONGLONG qwSize)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// Only flush if the range overlaps the staged run.
+		if (this->m_dwRunSize == 0 || qwOffset >= this->m_qwRunOffset + this->m_dwRunSize || qwOffset + qwSize <= this->m_qwRunOffset)
+			return true;
+
+		return FlushRun();
+	}
+
+	bool CdiWriteBuffer::Flush()
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+		return FlushRun();
+	}
+
+	bool CdiWriteBuffer::FlushRun()
+	{
+		// Check if there is anything to write.
+		if (this->m_dwRunSize == 0)
+			return true;
+
+		// Write the run and empty the buffer.
+		DWORD dwRunSize = this->m_dwRunSize;
+		this->m_dwRunSize = 0;
+		if (WriteThrough(this->m_qwRunOffset, this->m_pbBuffer, dwRunSize) == false)
+		{
+			// Failed to write the staged data to the device.
+			printf("CdiWriteBuffer::Flush(): failed to write %d bytes at offset 0x%llx!\n", dwRunSize, this->m_qwRunOffset);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool CdiWriteBuffer::WriteThrough(ULONGLONG qwOffset, const void *pData, DWORD dwSize)
+	{
+		// Make sure we have a device to write to.
+		if (this->m_pDevice == nullptr)
+			return false;
+
+		this->m_qwWriteCount++;
+		this->m_qwBytesWritten += dwSize;
+		return this->m_pDevice->WriteAt(qwOffset, pData, dwSize);
+	}
+
+	void CdiWriteBuffer::GetStats(CdiWriteBufferStats *pStats)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+		pStats->qwBytesStaged = this->m_qwBytesStaged;
+		pStats->qwBytesWritten = this->m_qwBytesWritten;
+		pStats->qwWriteCount = this->m_qwWriteCount;
+	}
+};
\ No newline at end of file
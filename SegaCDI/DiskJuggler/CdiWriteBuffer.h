@@ -0,0 +1,114 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiWriteBuffer.h - Write behind buffer that coalesces sector writes to a
+		cdi image into large contiguous writes.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "../IO/BlockDevice.h"
+#include <mutex>
+
+namespace DiskJuggler
+{
+	// Default size of the write behind buffer.
+	#define CDI_DEFAULT_WRITE_BUFFER_SIZE		0x800000
+
+	struct CdiWriteBufferStats
+	{
+		ULONGLONG qwBytesStaged;		// Number of bytes written into the buffer
+		ULONGLONG qwBytesWritten;		// Number of bytes written to the device
+		ULONGLONG qwWriteCount;			// Number of write calls made to the device
+	};
+
+	//-----------------------------------------------------
+	// CdiWriteBuffer
+	//-----------------------------------------------------
+	class CdiWriteBuffer
+	{
+	protected:
+		IO::BlockDevice	*m_pDevice;				// Device the buffered data is written to
+		PBYTE		m_pbBuffer;					// Staged data, allocated on first use
+		DWORD		m_dwBufferSize;				// Size of m_pbBuffer, 0 disables buffering
+
+		ULONGLONG	m_qwRunOffset;				// Device offset of the first byte in the buffer
+		DWORD		m_dwRunSize;				// Number of bytes staged in the buffer
+
+		std::mutex	m_Lock;						// Protects the buffer so writes and reads can come from multiple threads
+
+		// Statistics.
+		ULONGLONG	m_qwBytesStaged;
+		ULONGLONG	m_qwBytesWritten;
+		ULONGLONG	m_qwWriteCount;
+
+		/*
+			Description: Writes the staged run to the device and empties the buffer. The buffer lock must be held by
+				the caller.
+
+			Returns: True if the run was written, false otherwise. The run is discarded either way.
+		*/
+		bool FlushRun();
+
+		/*
+			Description: Writes data straight to the device, bypassing the buffer.
+		*/
+		bool WriteThrough(ULONGLONG qwOffset, const void *pData, DWORD dwSize);
+
+	public:
+		CdiWriteBuffer();
+		~CdiWriteBuffer();
+
+		/*
+			Description: Sets the device staged data is written to. Any data staged for the previous device must be
+				flushed first.
+		*/
+		void Attach(IO::BlockDevice *pDevice);
+
+		/*
+			Description: Sets the size of the buffer, flushing anything that is staged.
+
+			Parameters:
+				dwSize: Size of the buffer in bytes, 0 disables buffering and writes go straight to the device.
+		*/
+		void SetSize(DWORD dwSize);
+
+		/*
+			Description: Stages data to be written to the device. Writes that continue the staged run, or land
+				entirely inside of it, are copied into the buffer. Anything else flushes the staged run first. Writes
+				larger than the buffer go straight to the device.
+
+			Parameters:
+				qwOffset: Device offset to write the data at.
+				pData: Data to write.
+				dwSize: Number of bytes to write.
+
+			Returns: True if the data was staged or written. A failure to write data that was staged by an earlier
+				call is also reported here, since it is flushed to make room.
+		*/
+		bool Write(ULONGLONG qwOffset, const void *pData, DWORD dwSize);
+
+		/*
+			Description: Flushes the staged run if it overlaps a range of the device that is about to be read from,
+				so reads never see stale data.
+
+			Returns: True if nothing had to be flushed or the flush succeeded, false otherwise.
+		*/
+		bool FlushRange(ULONGLONG qwOffset, ULONGLONG qwSize);
+
+		/*
+			Description: Writes the staged run to the device. This does not flush the device itself to disk.
+
+			Returns: True if the staged run was written, false otherwise.
+		*/
+		bool Flush();
+
+		/*
+			Description: Gets the staging and write counters of the buffer.
+		*/
+		void GetStats(CdiWriteBufferStats *pStats);
+	};
+};
\ No newline at end of file
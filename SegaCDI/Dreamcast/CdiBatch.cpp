@@ -0,0 +1,501 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiBatch.cpp - Validates many cdi images at once on a pool of worker threads
+		and writes a single report for all of them.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "CdiBatch.h"
+#include <chrono>
+#include <thread>
+
+namespace Dreamcast
+{
+	/*
+		Description: Checks if a file name ends with one of the image extensions, ignoring case.
+	*/
+	static bool IsImageFile(CString sFileName)
+	{
+		int dwLength = (int)strlen(CDI_BATCH_IMAGE_EXTENSION);
+		int dwCompressedLength = (int)strlen(CDI_BATCH_COMPRESSED_EXTENSION);
+		int dwManifestLength = (int)strlen(CDI_BATCH_MANIFEST_EXTENSION);
+		return (sFileName.GetLength() >= dwLength && sFileName.Right(dwLength).CompareNoCase(CDI_BATCH_IMAGE_EXTENSION) == 0) ||
+			(sFileName.GetLength() >= dwCompressedLength && sFileName.Right(dwCompressedLength).CompareNoCase(CDI_BATCH_COMPRESSED_EXTENSION) == 0) ||
+			(sFileName.GetLength() >= dwManifestLength && sFileName.Right(dwManifestLength).CompareNoCase(CDI_BATCH_MANIFEST_EXTENSION) == 0);
+	}
+
+	/*
+		Description: Recursively searches sFolder for image files and adds them to pvFiles.
+	*/
+	static void FindImageFiles(CString sFolder, std::vector<CString> *pvFiles)
+	{
+		// Loop through everything in the folder.
+		WIN32_FIND_DATA sFindData;
+		HANDLE hFind = FindFirstFile(sFolder + "\\*", &sFindData);
+		if (hFind == INVALID_HANDLE_VALUE)
+			return;
+
+		do
+		{
+			// Skip the current and parent folder entries.
+			CString sName = sFindData.cFileName;
+			if (sName == "." || sName == "..")
+				continue;
+
+			// Search sub folders, and add any images we find.
+			if ((sFindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+				FindImageFiles(sFolder + "\\" + sName, pvFiles);
+			else if (IsImageFile(sName) == true)
+				pvFiles->push_back(sFolder + "\\" + sName);
+		} while (FindNextFile(hFind, &sFindData) != 0);
+
+		FindClose(hFind);
+	}
+
+	/*
+		Description: Appends psString to psOutput as a quoted JSON string.
+	*/
+	static void AppendJsonString(CString *psOutput, LPCSTR psString)
+	{
+		*psOutput += "\"";
+		for (const CHAR *pc = psString; *pc != 0; pc++)
+		{
+			// Escape quotes, back slashes and control characters.
+			if (*pc == '"' || *pc == '\\')
+			{
+				CHAR sEscape[3] = { '\\', *pc, 0 };
+				*psOutput += sEscape;
+			}
+			else if ((BYTE)*pc < 0x20)
+				psOutput->AppendFormat("\\u%04x", (BYTE)*pc);
+			else
+			{
+				CHAR sChar[2] = { *pc, 0 };
+				*psOutput += sChar;
+			}
+		}
+		*psOutput += "\"";
+	}
+
+	/*
+		Description: Gets the name of a load stage for the report.
+	*/
+	static LPCSTR LoadStageToString(CdiLoadStage eStage)
+	{
+		switch (eStage)
+		{
+		case LoadStageDescriptor:	return "descriptor";
+		case LoadStageBootstrap:	return "bootstrap";
+		case LoadStageFileSystem:	return "filesystem";
+		case LoadStageDone:			return "done";
+		default:					return "unknown";
+		}
+	}
+
+	CdiBatchValidator::CdiBatchValidator(DWORD dwChecks, DWORD dwThreadCount)
+	{
+		// Initialize fields, the file system can only be found through the bootstrap.
+		this->m_dwChecks = dwChecks;
+		if ((this->m_dwChecks & BatchCheckFileSystem) != 0)
+			this->m_dwChecks |= BatchCheckBootstrap;
+		this->m_bUseIndex = false;
+		this->m_dSeconds = 0.0;
+		this->m_dwNextImage = 0;
+		this->m_dwOpenImages = 0;
+		this->m_dwLoadingImages = 0;
+
+		// Default to one thread per processor.
+		this->m_dwThreadCount = dwThreadCount;
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = std::thread::hardware_concurrency();
+		if (this->m_dwThreadCount == 0)
+			this->m_dwThreadCount = 1;
+
+		// Set the default memory limits.
+		SetMemoryLimits(CDI_BATCH_DEFAULT_IMAGE_BUDGET, 0);
+	}
+
+	void CdiBatchValidator::SetMemoryLimits(ULONGLONG qwImageBudget, DWORD dwMaxOpenImages)
+	{
+		// Save the limits, there needs to be at least one image open per worker to keep them all busy.
+		this->m_qwImageBudget = qwImageBudget;
+		this->m_dwMaxOpenImages = dwMaxOpenImages;
+		if (this->m_dwMaxOpenImages == 0)
+			this->m_dwMaxOpenImages = this->m_dwThreadCount * CDI_BATCH_OPEN_IMAGES_PER_WORKER;
+	}
+
+	void CdiBatchValidator::EnableSidecarIndex(bool bEnable)
+	{
+		this->m_bUseIndex = bEnable;
+	}
+
+	bool CdiBatchValidator::AddImages(CString sSource)
+	{
+		std::vector<CString> vFiles;
+
+		// Check if the source is a wildcard pattern.
+		if (sSource.FindOneOf("*?") != -1)
+		{
+			// Get the folder the pattern is in so we can build the full path of each file.
+			int dwSeparator = sSource.ReverseFind('\\');
+			if (sSource.ReverseFind('/') > dwSeparator)
+				dwSeparator = sSource.ReverseFind('/');
+			CString sFolder = (dwSeparator != -1 ? sSource.Left(dwSeparator + 1) : CString(""));
+
+			// Loop through all of the files that match the pattern.
+			WIN32_FIND_DATA sFindData;
+			HANDLE hFind = FindFirstFile(sSource, &sFindData);
+			if (hFind == INVALID_HANDLE_VALUE)
+			{
+				printf("CdiBatchValidator::AddImages(): no files match %s!\n", sSource);
+				return false;
+			}
+
+			do
+			{
+				if ((sFindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+					vFiles.push_back(sFolder + sFindData.cFileName);
+			} while (FindNextFile(hFind, &sFindData) != 0);
+
+			FindClose(hFind);
+		}
+		else
+		{
+			// Check the source exists.
+			DWORD dwAttributes = GetFileAttributes(sSource);
+			if (dwAttributes == INVALID_FILE_ATTRIBUTES)
+			{
+				printf("CdiBatchValidator::AddImages(): could not find %s!\n", sSource);
+				return false;
+			}
+
+			if ((dwAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+			{
+				// Search the folder for images.
+				FindImageFiles(sSource, &vFiles);
+			}
+			else if (IsImageFile(sSource) == true)
+			{
+				// Single image.
+				vFiles.push_back(sSource);
+			}
+			else
+			{
+				// Anything else is a list file, read the whole thing.
+				IO::BlockDevice *pListFile = IO::OpenFileDevice(sSource, IO::BlockDeviceAccess::ReadOnly);
+				if (pListFile == nullptr || pListFile->Size() > 0x10000000)
+				{
+					printf("CdiBatchValidator::AddImages(): failed to open list file %s!\n", sSource);
+					delete pListFile;
+					return false;
+				}
+
+				DWORD dwListSize = (DWORD)pListFile->Size();
+				CHAR *psList = new CHAR[dwListSize + 1];
+				bool bResult = pListFile->ReadAt(0, psList, dwListSize);
+				delete pListFile;
+				if (bResult == false)
+				{
+					printf("CdiBatchValidator::AddImages(): failed to read list file %s!\n", sSource);
+					delete[] psList;
+					return false;
+				}
+
+				// Split the list into lines, skipping blank lines and comments.
+				psList[dwListSize] = 0;
+				for (CHAR *psLine = psList; psLine < psList + dwListSize; )
+				{
+					// Find the end of the line and terminate it.
+					CHAR *psEnd = psLine;
+					while (*psEnd != 0 && *psEnd != '\n' && *psEnd != '\r')
+						psEnd++;
+					CHAR *psNext = psEnd + 1;
+					*psEnd = 0;
+
+					// Trim white space off of the end.
+					while (psEnd > psLine && (psEnd[-1] == ' ' || psEnd[-1] == '\t'))
+						*--psEnd = 0;
+
+					if (psLine[0] != 0 && psLine[0] != '#')
+						vFiles.push_back(CString(psLine));
+					psLine = psNext;
+				}
+
+				delete[] psList;
+			}
+		}
+
+		// Add a result entry for each image.
+		for (size_t i = 0; i < vFiles.size(); i++)
+		{
+			CdiBatchResult sResult;
+			sResult.sFileName = vFiles[i];
+			sResult.qwFileSize = 0;
+			sResult.bPassed = false;
+			sResult.eLoadStage = LoadStageDescriptor;
+			sResult.sDescriptorStatus = { DiskJuggler::CdiDescriptorError::DescriptorOk, 0, 0, 0 };
+			sResult.dwSessionCount = 0;
+			sResult.dwTrackCount = 0;
+			sResult.bSectorsChecked = false;
+			sResult.bReadErrors = false;
+			sResult.qwSectorsVerified = 0;
+			sResult.dwBadSectors = 0;
+			sResult.dSeconds = 0.0;
+			this->m_vResults.push_back(sResult);
+		}
+
+		return true;
+	}
+
+	DWORD CdiBatchValidator::ImageCount()
+	{
+		return (DWORD)this->m_vResults.size();
+	}
+
+	bool CdiBatchValidator::Run()
+	{
+		// Reset the scheduler.
+		this->m_dwNextImage = 0;
+		this->m_dwOpenImages = 0;
+		this->m_dwLoadingImages = 0;
+		this->m_dActiveImages.clear();
+
+		// Spin up the workers and wait for them to get through all of the images.
+		auto tStart = std::chrono::steady_clock::now();
+		std::vector<std::thread> vWorkers;
+		for (DWORD i = 0; i < this->m_dwThreadCount; i++)
+			vWorkers.push_back(std::thread(&CdiBatchValidator::WorkerThread, this));
+		for (size_t i = 0; i < vWorkers.size(); i++)
+			vWorkers[i].join();
+		this->m_dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+		// Check if all of the images passed.
+		for (size_t i = 0; i < this->m_vResults.size(); i++)
+		{
+			if (this->m_vResults[i].bPassed == false)
+				return false;
+		}
+
+		return true;
+	}
+
+	bool CdiBatchValidator::GetTask(Task *pTask)
+	{
+		std::unique_lock<std::mutex> lock(this->m_Lock);
+		while (true)
+		{
+			// Open another image if we are below the limit.
+			if (this->m_dwOpenImages < this->m_dwMaxOpenImages && this->m_dwNextImage < this->m_vResults.size())
+			{
+				pTask->pImage = nullptr;
+				pTask->dwIndex = this->m_dwNextImage++;
+				this->m_dwOpenImages++;
+				this->m_dwLoadingImages++;
+				return true;
+			}
+
+			// Take the next job from the image at the front of the queue, and move the image to the back so
+			// every open image gets the same share of the workers.
+			if (this->m_dActiveImages.size() > 0)
+			{
+				OpenImage *pOpenImage = this->m_dActiveImages.front();
+				this->m_dActiveImages.pop_front();
+
+				pTask->pImage = pOpenImage;
+				pTask->dwIndex = pOpenImage->dwNextJob++;
+				if (pOpenImage->dwNextJob < pOpenImage->dwJobCount)
+					this->m_dActiveImages.push_back(pOpenImage);
+				return true;
+			}
+
+			// If there are no images left to open and none being loaded there is nothing left to hand out.
+			if (this->m_dwNextImage >= this->m_vResults.size() && this->m_dwLoadingImages == 0)
+				return false;
+
+			// Wait for an image to finish loading or closing.
+			this->m_WorkReady.wait(lock);
+		}
+	}
+
+	void CdiBatchValidator::LoadImage(DWORD dwResultIndex)
+	{
+		CdiBatchResult *pResult = &this->m_vResults[dwResultIndex];
+
+		// Setup the open image.
+		OpenImage *pOpenImage = new OpenImage();
+		pOpenImage->dwResultIndex = dwResultIndex;
+		pOpenImage->pImage = new CdiImage();
+		pOpenImage->pVerifier = nullptr;
+		pOpenImage->dwJobCount = 0;
+		pOpenImage->dwNextJob = 0;
+		pOpenImage->dwJobsDone = 0;
+		pOpenImage->tStart = std::chrono::steady_clock::now();
+
+		// Get the size of the image file.
+		IO::BlockDevice *pDevice = IO::OpenFileDevice(pResult->sFileName, IO::BlockDeviceAccess::ReadOnly);
+		if (pDevice != nullptr)
+		{
+			pResult->qwFileSize = pDevice->Size();
+			delete pDevice;
+		}
+
+		// Load the image up to the last stage we need to check.
+		CdiLoadStage eLastStage = LoadStageDescriptor;
+		if ((this->m_dwChecks & BatchCheckFileSystem) != 0)
+			eLastStage = LoadStageFileSystem;
+		else if ((this->m_dwChecks & BatchCheckBootstrap) != 0)
+			eLastStage = LoadStageBootstrap;
+
+		pOpenImage->pImage->SetMemoryBudget(this->m_qwImageBudget);
+		if (pOpenImage->pImage->LoadImage(pResult->sFileName, false, false, this->m_bUseIndex, eLastStage) == true &&
+			(this->m_dwChecks & BatchCheckSectors) != 0)
+		{
+			// Split the sectors into jobs, these are run by the workers one at a time alongside the jobs of the
+			// other open images.
+			pOpenImage->pVerifier = new DiskJuggler::CdiVerifier(pOpenImage->pImage->GetFileHandle(), 1);
+			pOpenImage->dwJobCount = pOpenImage->pVerifier->PrepareJobs(&pOpenImage->sReport);
+		}
+
+		// Queue the jobs for the image, or close it right away if there is nothing else to check.
+		{
+			std::lock_guard<std::mutex> lock(this->m_Lock);
+			this->m_dwLoadingImages--;
+			if (pOpenImage->dwJobCount > 0)
+				this->m_dActiveImages.push_back(pOpenImage);
+		}
+
+		if (pOpenImage->dwJobCount == 0)
+			CloseImage(pOpenImage);
+		else
+			this->m_WorkReady.notify_all();
+	}
+
+	void CdiBatchValidator::CloseImage(OpenImage *pOpenImage)
+	{
+		CdiBatchResult *pResult = &this->m_vResults[pOpenImage->dwResultIndex];
+		CdiImage *pImage = pOpenImage->pImage;
+
+		// Fill in the load results.
+		pResult->eLoadStage = pImage->GetLoadStage();
+		pResult->sDescriptorStatus = pImage->GetDescriptorStatus();
+		pResult->dwSessionCount = pImage->GetSessionCount();
+		pResult->dwTrackCount = pImage->GetTrackCount();
+
+		// Fill in the sector results.
+		if (pOpenImage->pVerifier != nullptr)
+		{
+			pResult->bSectorsChecked = true;
+			pResult->bReadErrors = (pOpenImage->pVerifier->FinishReport() == false);
+			pResult->dwBadSectors = pOpenImage->sReport.BadSectorCount();
+			for (size_t i = 0; i < pOpenImage->sReport.vTracks.size(); i++)
+				pResult->qwSectorsVerified += pOpenImage->sReport.vTracks[i].dwSectorsVerified;
+		}
+
+		pResult->bPassed = (pResult->eLoadStage == LoadStageDone && pResult->bReadErrors == false && pResult->dwBadSectors == 0);
+		pResult->dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pOpenImage->tStart).count();
+		printf("%s: %s\n", pResult->sFileName, (pResult->bPassed == true ? "passed" : "FAILED"));
+
+		// Close the image and free its memory.
+		if (pOpenImage->pVerifier != nullptr)
+			delete pOpenImage->pVerifier;
+		delete pImage;
+		delete pOpenImage;
+
+		// Let the workers open another image.
+		{
+			std::lock_guard<std::mutex> lock(this->m_Lock);
+			this->m_dwOpenImages--;
+		}
+		this->m_WorkReady.notify_all();
+	}
+
+	void CdiBatchValidator::WorkerThread()
+	{
+		// Allocate the verification buffers, these are shared by every image this worker runs jobs for.
+		PBYTE pbBuffer = new BYTE[CDI_VERIFY_SECTOR_BUFFER_SIZE];
+		PBYTE pbSubchannel = new BYTE[CDI_VERIFY_SUBCHANNEL_BUFFER_SIZE];
+
+		// Loop until there is no work left.
+		Task sTask;
+		while (GetTask(&sTask) == true)
+		{
+			// Load the next image.
+			if (sTask.pImage == nullptr)
+			{
+				LoadImage(sTask.dwIndex);
+				continue;
+			}
+
+			// Run the verification job, whoever finishes the last job of an image closes it.
+			sTask.pImage->pVerifier->RunJob(sTask.dwIndex, pbBuffer, pbSubchannel);
+
+			bool bLastJob = false;
+			{
+				std::lock_guard<std::mutex> lock(this->m_Lock);
+				bLastJob = (++sTask.pImage->dwJobsDone == sTask.pImage->dwJobCount);
+			}
+
+			if (bLastJob == true)
+				CloseImage(sTask.pImage);
+		}
+
+		// Free the verification buffers.
+		delete[] pbSubchannel;
+		delete[] pbBuffer;
+	}
+
+	bool CdiBatchValidator::WriteReport(CString sReportFile)
+	{
+		// Count the images that passed.
+		DWORD dwPassed = 0;
+		for (size_t i = 0; i < this->m_vResults.size(); i++)
+		{
+			if (this->m_vResults[i].bPassed == true)
+				dwPassed++;
+		}
+
+		// Write the summary.
+		CString sReport;
+		sReport.AppendFormat("{\n\t\"images\": %d,\n\t\"passed\": %d,\n\t\"failed\": %d,\n\t\"seconds\": %.3f,\n\t\"threads\": %d,\n",
+			(DWORD)this->m_vResults.size(), dwPassed, (DWORD)this->m_vResults.size() - dwPassed, this->m_dSeconds, this->m_dwThreadCount);
+		sReport.AppendFormat("\t\"checks\": { \"bootstrap\": %s, \"filesystem\": %s, \"sectors\": %s },\n\t\"results\": [",
+			((this->m_dwChecks & BatchCheckBootstrap) != 0 ? "true" : "false"), ((this->m_dwChecks & BatchCheckFileSystem) != 0 ? "true" : "false"),
+			((this->m_dwChecks & BatchCheckSectors) != 0 ? "true" : "false"));
+
+		// Write the result of each image.
+		for (size_t i = 0; i < this->m_vResults.size(); i++)
+		{
+			CdiBatchResult *pResult = &this->m_vResults[i];
+
+			sReport += (i == 0 ? "\n\t\t{ \"file\": " : ",\n\t\t{ \"file\": ");
+			AppendJsonString(&sReport, pResult->sFileName);
+			sReport.AppendFormat(", \"size\": %llu, \"passed\": %s, \"stage\": \"%s\", ", pResult->qwFileSize,
+				(pResult->bPassed == true ? "true" : "false"), LoadStageToString(pResult->eLoadStage));
+			sReport.AppendFormat("\"descriptor\": { \"error\": \"%s\", \"offset\": %d, \"session\": %d, \"track\": %d }, ",
+				DiskJuggler::DescriptorErrorToString(pResult->sDescriptorStatus.eError), pResult->sDescriptorStatus.dwOffset,
+				pResult->sDescriptorStatus.dwSessionNumber + 1, pResult->sDescriptorStatus.dwTrackNumber + 1);
+			sReport.AppendFormat("\"sessions\": %d, \"tracks\": %d, \"sectors_checked\": %s, \"sectors_verified\": %llu, \"bad_sectors\": %d, \"read_errors\": %s, \"seconds\": %.3f }",
+				pResult->dwSessionCount, pResult->dwTrackCount, (pResult->bSectorsChecked == true ? "true" : "false"), pResult->qwSectorsVerified,
+				pResult->dwBadSectors, (pResult->bReadErrors == true ? "true" : "false"), pResult->dSeconds);
+		}
+		sReport += "\n\t]\n}\n";
+
+		// Write the report out.
+		IO::BlockDevice *pReportFile = IO::OpenFileDevice(sReportFile, IO::BlockDeviceAccess::CreateAlways);
+		if (pReportFile == nullptr)
+		{
+			printf("CdiBatchValidator::WriteReport(): failed to create report file %s!\n", sReportFile);
+			return false;
+		}
+
+		bool bResult = pReportFile->WriteAt(0, sReport.GetString(), sReport.GetLength());
+		delete pReportFile;
+		if (bResult == false)
+			printf("CdiBatchValidator::WriteReport(): failed to write report file %s!\n", sReportFile);
+		return bResult;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,198 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiBatch.h - Validates many cdi images at once on a pool of worker threads
+		and writes a single report for all of them.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "CdiImage.h"
+#include "../DiskJuggler/CdiVerifier.h"
+#include "../DiskJuggler/CdiCompressedImage.h"
+#include "../DiskJuggler/CdiChunkStore.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace Dreamcast
+{
+	// Default memory budget of a single open image, see CdiImage::SetMemoryBudget().
+	#define CDI_BATCH_DEFAULT_IMAGE_BUDGET		0x400000
+
+	// Default number of images open at once for every worker thread.
+	#define CDI_BATCH_OPEN_IMAGES_PER_WORKER	2
+
+	// File extensions of the images picked up when a folder is validated.
+	#define CDI_BATCH_IMAGE_EXTENSION			".cdi"
+	#define CDI_BATCH_COMPRESSED_EXTENSION		CDI_COMPRESSED_EXTENSION
+	#define CDI_BATCH_MANIFEST_EXTENSION		CDI_STORE_MANIFEST_EXTENSION
+
+	// Report file written when no other file is given.
+	#define CDI_BATCH_DEFAULT_REPORT_FILE		"segacdi_report.json"
+
+	/*
+		Checks that can be run on each image, the session descriptor is always checked.
+	*/
+	enum CdiBatchChecks : DWORD
+	{
+		BatchCheckDescriptor	= 0,
+		BatchCheckBootstrap		= 1,		// Find and parse IP.BIN
+		BatchCheckFileSystem	= 2,		// Parse the ISO9660 directory tree, implies BatchCheckBootstrap
+		BatchCheckSectors		= 4,		// Check the EDC/ECC and subchannel of every sector
+		BatchCheckAll			= BatchCheckBootstrap | BatchCheckFileSystem | BatchCheckSectors
+	};
+
+	/*
+		Result of validating a single image.
+	*/
+	struct CdiBatchResult
+	{
+		CString sFileName;				// File path of the image
+		ULONGLONG qwFileSize;			// Size of the image file
+		bool bPassed;					// True if every check passed
+		CdiLoadStage eLoadStage;		// Stage loading failed at, or LoadStageDone
+		DiskJuggler::CdiDescriptorStatus sDescriptorStatus;	// Why the session descriptor was rejected, if it was
+		DWORD dwSessionCount;			// Number of sessions in the image
+		DWORD dwTrackCount;				// Number of tracks in the image
+		bool bSectorsChecked;			// True if the sectors were verified
+		bool bReadErrors;				// True if any sector could not be read
+		ULONGLONG qwSectorsVerified;	// Number of sectors verified
+		DWORD dwBadSectors;				// Number of sectors that failed verification
+		double dSeconds;				// Time from opening the image until all of its checks finished
+	};
+
+	//-----------------------------------------------------
+	// CdiBatchValidator
+	//-----------------------------------------------------
+	class CdiBatchValidator
+	{
+	protected:
+		/*
+			An image that is open and has sector verification jobs left to run.
+		*/
+		struct OpenImage
+		{
+			DWORD dwResultIndex;					// Index of the image in m_vResults
+			CdiImage *pImage;						// Loaded image
+			DiskJuggler::CdiVerifier *pVerifier;	// Verifier the jobs belong to
+			DiskJuggler::CdiVerifyReport sReport;	// Sector verification results
+			DWORD dwJobCount;						// Number of verification jobs
+			DWORD dwNextJob;						// Index of the next job to hand out
+			DWORD dwJobsDone;						// Number of jobs that have finished
+			std::chrono::steady_clock::time_point tStart;	// Time the image was opened
+		};
+
+		/*
+			Unit of work handed to a worker, either loading the next image or one verification job of an open image.
+		*/
+		struct Task
+		{
+			OpenImage *pImage;						// Image to run a job for, nullptr to load the next image
+			DWORD dwIndex;							// Job index, or index of the image to load
+		};
+
+		// Settings.
+		DWORD		m_dwChecks;						// CdiBatchChecks flags
+		DWORD		m_dwThreadCount;				// Number of worker threads
+		DWORD		m_dwMaxOpenImages;				// Maximum number of images open at once
+		ULONGLONG	m_qwImageBudget;				// Memory budget of each open image
+		bool		m_bUseIndex;					// True if the sidecar index should be used
+
+		// Images and their results.
+		std::vector<CdiBatchResult>	m_vResults;		// Result for every image, in the order they were added
+		double		m_dSeconds;						// Time taken to validate all images
+
+		// Scheduling state, protected by m_Lock.
+		std::mutex	m_Lock;
+		std::condition_variable	m_WorkReady;		// Signaled when an image is loaded or closed
+		DWORD		m_dwNextImage;					// Index of the next image to load
+		DWORD		m_dwOpenImages;					// Number of images loading or open
+		DWORD		m_dwLoadingImages;				// Number of images being loaded
+		std::deque<OpenImage*>	m_dActiveImages;	// Open images with jobs left to hand out, in round robin order
+
+		/*
+			Description: Waits for the next unit of work. Loading a new image takes priority while fewer than
+				m_dwMaxOpenImages are open, otherwise jobs are handed out one at a time from each open image in
+				turn so a large image cannot hold up the smaller ones.
+
+			Returns: True if pTask was filled in, false if there is no work left.
+		*/
+		bool GetTask(Task *pTask);
+
+		/*
+			Description: Loads an image, runs the cheap checks on it and queues its verification jobs.
+		*/
+		void LoadImage(DWORD dwResultIndex);
+
+		/*
+			Description: Fills in the result for an image and closes it.
+		*/
+		void CloseImage(OpenImage *pOpenImage);
+
+		/*
+			Description: Worker thread routine, runs tasks until there are none left.
+		*/
+		void WorkerThread();
+
+	public:
+		/*
+			Parameters:
+				dwChecks: CdiBatchChecks flags for the checks to run.
+				dwThreadCount: Number of worker threads, 0 uses one per processor.
+		*/
+		CdiBatchValidator(DWORD dwChecks, DWORD dwThreadCount = 0);
+
+		/*
+			Description: Sets the memory budget of each open image and the number of images that can be open at
+				once, which together bound the memory used by the batch.
+
+			Parameters:
+				qwImageBudget: Budget in bytes for each image, see CdiImage::SetMemoryBudget().
+				dwMaxOpenImages: Maximum number of images open at once, 0 uses CDI_BATCH_OPEN_IMAGES_PER_WORKER
+					per worker thread.
+		*/
+		void SetMemoryLimits(ULONGLONG qwImageBudget, DWORD dwMaxOpenImages = 0);
+
+		/*
+			Description: Sets if the sidecar index should be used for each image.
+		*/
+		void EnableSidecarIndex(bool bEnable);
+
+		/*
+			Description: Adds images to the batch. sSource can be a single image, a folder which is searched for
+				images recursively, a wildcard pattern such as "D:\\Games\\*.cdi", or a list file with one image
+				path on each line.
+
+			Returns: True if sSource was found, false otherwise.
+		*/
+		bool AddImages(CString sSource);
+
+		/*
+			Description: Gets the number of images in the batch.
+		*/
+		DWORD ImageCount();
+
+		/*
+			Description: Validates every image in the batch.
+
+			Returns: True if every image passed, false otherwise.
+		*/
+		bool Run();
+
+		/*
+			Description: Writes the results as a JSON document.
+
+			Parameters:
+				sReportFile: File path to write the report to.
+
+			Returns: True if the report was written, false otherwise.
+		*/
+		bool WriteReport(CString sReportFile);
+	};
+};
\ No newline at end of file
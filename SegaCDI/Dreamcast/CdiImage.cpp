@@ -1,357 +1,776 @@
-/*
-	SegaCDI - Sega Dreamcast cdi image validator.
-
-	CdiImage.cpp - Support for DiscJuggler cdi images.
-
-	Mar 6th, 2013
-		- Initial creation.
-
-	Dec 1st, 2015
-		- Added ReadSectors() function to reduce code bloat on repetitive operations.
-*/
-
-#include "../stdafx.h"
-#include "CdiImage.h"
-#include "MRImage.h"
-
-namespace Dreamcast
-{
-	CdiImage::CdiImage()
-	{
-		// Initialize fields.
-		this->m_pCdiFile = nullptr;
-		this->m_dwFsSessionNumber = -1;
-		this->m_dwFsTrackNumber = -1;
-		this->m_phFsTrackHandle = nullptr;
-		this->m_pFsIsoHandle = nullptr;
-	}
-
-	CdiImage::~CdiImage()
-	{
-	}
-
-	bool CdiImage::LoadImage(CString sFileName, bool bVerbos)
-	{
-		// Initialize the file handle which will take care of parsing the disk juggler
-		// format and giving us an easy to use api to read and write data with.
-		this->m_pCdiFile = new DiskJuggler::CdiFileHandle();
-		if (this->m_pCdiFile->Open(sFileName, false, bVerbos) == false)
-		{
-			// Failed to initialize the cdi file handle, close any file handles and return.
-			goto Cleanup;
-		}
-
-		// Load and parse the bootstrap (ip.bin).
-		if (this->LoadBootstrap(bVerbos) == false)
-		{
-			// Failed to read the bootstrap sector.
-			printf("CdiImage::LoadImage(): failed to load bootstrap sector!\n");
-			goto Cleanup;
-		}
-
-		// Initialize the file system track handle using the session and track numbers we found the bootstrap in.
-		this->m_phFsTrackHandle = this->m_pCdiFile->OpenTrackHandle(this->m_dwFsSessionNumber, this->m_dwFsTrackNumber);
-		if (this->m_phFsTrackHandle == nullptr)
-		{
-			// Failed to get a handle on the file system track.
-			printf("CdiImage::LoadImage(): failed to open file system track!\n");
-			goto Cleanup;
-		}
-
-		// Parse the ISO9660 structure and read out the file system.
-		this->m_pFsIsoHandle = new ISO::ISO9660();
-		if (this->m_pFsIsoHandle->LoadISOFromCDI(this->m_phFsTrackHandle, bVerbos) == false)
-		{
-			// Failed to load the ISO file system.
-			goto Cleanup;
-		}
-
-		// Everything loaded okay, return true.
-		return true;
-
-	Cleanup:
-		// Check if we created the ISO fs subsystem.
-		if (this->m_pFsIsoHandle)
-			delete this->m_pFsIsoHandle;
-
-		// Cleanup the CDI image subsystem resources.
-		if (this->m_phFsTrackHandle)
-			this->m_pCdiFile->CloseTrackHandle(this->m_phFsTrackHandle);
-		if (this->m_pCdiFile)
-			delete this->m_pCdiFile;
-
-		// Return false.
-		return false;
-	}
-
-	bool CdiImage::LoadBootstrap(bool bVerbos)
-	{
-		// Allocate a scratch buffer for the bootstrap data.
-		PBYTE pbBootstrapBuffer = (PBYTE)VirtualAlloc(NULL, BOOTSTRAP_SIZE, MEM_COMMIT, PAGE_READWRITE);
-		if (pbBootstrapBuffer == NULL)
-		{
-			// Failed to allocate scratch memory.
-			printf("CdiImage::LoadBootstrap(): failed to allocate memory for bootstrap data!\n");
-			return false;
-		}
-
-		// Loop through all the sessions and search for one with a DATA track.
-		printf("searching for IP.BIN...\n");
-		DisjointCollection<DiskJuggler::CdiSession> sessionCollection = this->m_pCdiFile->GetSessionsCollection();
-		for (int i = 0; i < sessionCollection.size(); i++)
-		{
-			// Search for a track that is DATA.
-			for (int x = 0; x < sessionCollection[i]->wTrackCount; x++)
-			{
-				// Check if this track is a DATA track, if it's not skip it.
-				if (sessionCollection[i]->psTracks[x].eMode == DiskJuggler::CdiTrackMode::Audio)
-					continue;
-
-				// Print status.
-				printf("\rsearching session %d track %d...", i + 1, x + 1);
-				fflush(stdout);
-
-				// Read the first sector of the track so we can check for the bootstrap markings.
-				if (this->m_pCdiFile->ReadSectors(i, x, sessionCollection[i]->psTracks[x].dwLba, pbBootstrapBuffer, 1) == false)
-				{
-					// Failed to read the first sector of the track.
-					printf("\nCdiImage::LoadBootstrap(): failed to read first sector of session %d track %d!\n", i, x);
-					continue;
-				}
-
-				// Check the firt 4 bytes for 'SEGA'.
-				if (memcmp(pbBootstrapBuffer, HARDWARE_ID, 16) != 0)
-					continue;
-
-				// We found the correct track, save the session and track numbers for later.
-				printf("\nfound IP.BIN\n");
-				this->m_dwFsSessionNumber = i;
-				this->m_dwFsTrackNumber = x;
-
-				// Read the remaining sectors from the track.
-				if (this->m_pCdiFile->ReadSectors(i, x, sessionCollection[i]->psTracks[x].dwLba + 1, &pbBootstrapBuffer[2048], BOOTSTRAP_SECTOR_COUNT - 1) == false)
-				{
-					// Failed to read the remaining bootstrap sectors.
-					printf("\nCdiImage::LoadBootstrap(): failed to read bootstrap data in session %d track %d!\n", i, x);
-					continue;
-				}
-
-				// Try to parse the bootstrap data.
-				if (this->m_sBootstrap.LoadBootstrap((char*)pbBootstrapBuffer, BOOTSTRAP_SIZE) == false)
-				{
-					// Print error and return false.
-					printf("ERROR: IP.BIN is invalid!\n");
-
-					// Deallocate temp buffers.
-					VirtualFree(pbBootstrapBuffer, BOOTSTRAP_SIZE, MEM_DECOMMIT);
-
-					// Return false.
-					return false;
-				}
-
-				// Bootstrap appears to be valid.
-				printf("bootstrap appears to be valid\n");
-
-				// Deallocate the sector buffer.
-				VirtualFree(pbBootstrapBuffer, BOOTSTRAP_SIZE, MEM_DECOMMIT);
-
-				// Done, return true.
-				return true;
-			}
-		}
-
-		// If the scratch buffer is still valid, free it.
-		if (pbBootstrapBuffer)
-			VirtualFree(pbBootstrapBuffer, BOOTSTRAP_SIZE, MEM_DECOMMIT);
-
-		// Bootstrap was not found.
-		printf("ERROR: could not find bootstrap!n");
-		return false;
-	}
-
-	bool CdiImage::WriteTrackToFile(CString sOutputFolder, DWORD dwSessionNumber, DWORD dwTrackNumber)
-	{
-		// Correct the session and track numbers.
-		dwSessionNumber--;
-		dwTrackNumber--;
-
-		// Get the collection of session objects from the file handle.
-		DisjointCollection<DiskJuggler::CdiSession> sessionCollection = this->m_pCdiFile->GetSessionsCollection();
-
-		// Check the session number is valid.
-		if (dwSessionNumber < 0 || dwSessionNumber >= sessionCollection.size())
-		{
-			// Print error and return.
-			printf("ERROR: requested session %d is invalid!\n", dwSessionNumber + 1);
-			return false;
-		}
-
-		// Check there is at least 1 closed track for this session.
-		if (sessionCollection[dwSessionNumber]->wTrackCount == 0)
-		{
-			// Print error and return.
-			printf("ERROR: no tracks found or track is open for session %d!\n", dwSessionNumber + 1);
-			return false;
-		}
-
-		// Check if the track number is valid.
-		if (dwTrackNumber < 0 || dwTrackNumber >= sessionCollection[dwSessionNumber]->wTrackCount)
-		{
-			// Print error and return.
-			printf("ERROR: requested track %d is invalid!\n", dwTrackNumber + 1);
-			return false;
-		}
-
-		// Format the output file name.
-		CHAR sFileName[MAX_PATH] = { 0 };
-		LPCSTR sTrackName = (sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eMode == DiskJuggler::CdiTrackMode::Audio ? "Audio" : "Data");
-		LPCSTR sTrackExt = (sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eMode == DiskJuggler::CdiTrackMode::Audio ? "wav" : "iso");
-		sprintf(sFileName, "%s\\T%s%d-%d.%s", sOutputFolder, sTrackName, dwSessionNumber + 1, dwTrackNumber + 1, sTrackExt);
-
-		// Create the iso file.
-		HANDLE hTrackFile = CreateFile(sFileName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-		if (hTrackFile == INVALID_HANDLE_VALUE)
-		{
-			// Print error and return.
-			printf("ERROR: could not create output file %s!\n", sFileName);
-			return false;
-		}
-
-		// Check if the track is of Audio type.
-		if (sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eMode == DiskJuggler::CdiTrackMode::Audio)
-		{
-			// Write a wav header for it.
-			if (WriteWavHeader(hTrackFile, sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].dwLength) == false)
-			{
-				// Print error, close file and return false.
-				printf("ERROR: could not write wav header for file %s!\n", sFileName);
-				CloseHandle(hTrackFile);
-				return false;
-			}
-		}
-
-		// Allocate a working buffer.
-		DWORD Count = 0;
-		BYTE *pbBuffer = new BYTE[sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eSectorSize];
-
-		// Loop through all the sectors for this track.
-		for (int i = 0; i < sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].dwLength; i++)
-		{
-			// Print progress.
-			printf("\rsaving track \t%d \t%s/%d \t%.2f%%", dwTrackNumber, sTrackName, sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eSectorSize,
-				(float)((float)(i + 1) / (float)sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].dwLength) * 100.0f);
-			fflush(stdout);
-
-			// Read sector from the track.
-			this->m_pCdiFile->ReadSectors(dwSessionNumber, dwTrackNumber, sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].dwLba + i, pbBuffer, 1);
-
-			// Check if we are writing an audio track or data track.
-			if (sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eMode == DiskJuggler::CdiTrackMode::Audio)
-			{
-				// Write the full sector.
-				WriteFile(hTrackFile, pbBuffer, sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eSectorSize, &Count, NULL);
-			}
-			else
-			{
-				// Write the sector minus the header size and extra bytes.
-				WriteFile(hTrackFile, pbBuffer, RAW_SECTOR_SIZE, &Count, NULL);
-			}
-		}
-
-		// Delete temp buffer.
-		delete[] pbBuffer;
-
-		// Close the output iso file and return.
-		printf("\n");
-		CloseHandle(hTrackFile);
-		return true;
-	}
-
-	bool CdiImage::WriteAllTracks(CString sOutputFolder)
-	{
-		// Get the collection of session objects from the file handle.
-		DisjointCollection<DiskJuggler::CdiSession> sessionCollection = this->m_pCdiFile->GetSessionsCollection();
-
-		// Loop through all the sessions and dump every track.
-		for (int i = 0; i < sessionCollection.size(); i++)
-		{
-			// Loop through all the tracks and dump each one.
-			for (int x = 0; x < sessionCollection[i]->wTrackCount; x++)
-			{
-				// Dump the track and check the result.
-				if (this->WriteTrackToFile(sOutputFolder, i + 1, x + 1) == false)
-				{
-					// Print error and return.
-					printf("ERROR: failed to dump track %d from session %d!\n", i + 1, x + 1);
-					return false;
-				}
-			}
-		}
-
-		// Done.
-		return true;
-	}
-
-	bool CdiImage::ExtractIPBin(CString sOutputFolder)
-	{
-		// Format the output file name.
-		CHAR sFileName[MAX_PATH] = { 0 };
-		sprintf(sFileName, "%s\\IP.BIN", sOutputFolder);
-
-		// Create the output file.
-		HANDLE hOutputFile = CreateFile(sFileName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-		if (hOutputFile == INVALID_HANDLE_VALUE)
-		{
-			// Print error and return.
-			printf("ERROR: failed to create output file %s!", sFileName);
-			return false;
-		}
-
-		// Allocate a temp buffer for the bootstrap data.
-		char *pbBootstrapBuffer = new char[BOOTSTRAP_SIZE];
-
-		// Copy the bootstrap data.
-		if (this->m_sBootstrap.CopyBootstrapBuffer(pbBootstrapBuffer, BOOTSTRAP_SIZE) == false)
-		{
-			// Print error and return false.
-			printf("ERROR: what the actual fuck...\n");
-			delete[] pbBootstrapBuffer;
-			return false;
-		}
-
-		// Write the bootstrap data to file.
-		DWORD count = 0;
-		WriteFile(hOutputFile, pbBootstrapBuffer, BOOTSTRAP_SIZE, &count, NULL);
-
-		// Close the output IP.BIN file.
-		printf("successfully extracted IP.BIN\n");
-		CloseHandle(hOutputFile);
-
-		// Deallocate the bootstrap buffer.
-		delete[] pbBootstrapBuffer;
-
-		// Done, return true.
-		return true;
-	}
-
-	bool CdiImage::ExtractMRImage(CString sOutputFolder)
-	{
-		// Try to dump the boot logo.
-		if (this->m_sBootstrap.Extract3rdPartyBootLogo(sOutputFolder) == true)
-			printf("successfully extracted boot logo\n");
-		else
-			return false;
-
-		// Done, return.
-		return true;
-	}
-
-	bool CdiImage::ExtractISOFileSystem(CString sOutputFolder)
-	{
-		// Check that we have a valid fs iso handle.
-		if (this->m_pFsIsoHandle == nullptr)
-			return false;
-
-		// 
-	}
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiImage.cpp - Support for DiscJuggler cdi images.
+
+	Mar 6th, 2013
+		- Initial creation.
+
+	Dec 1st, 2015
+		- Added ReadSectors() function to reduce code bloat on repetitive operations.
+*/
+
+#include "../stdafx.h"
+#include "CdiImage.h"
+#include "MRImage.h"
+#include "../DiskJuggler/CdiVerifier.h"
+#include "../DiskJuggler/CdiSidecarIndex.h"
+#include "../DiskJuggler/CdiImageWriter.h"
+#include "../ISO/Iso9660Relocator.h"
+#include <vector>
+
+namespace Dreamcast
+{
+	CdiImage::CdiImage()
+	{
+		// Initialize fields.
+		this->m_pCdiFile = nullptr;
+		this->m_dwFsSessionNumber = -1;
+		this->m_dwFsTrackNumber = -1;
+		this->m_phFsTrackHandle = nullptr;
+		this->m_pFsIsoHandle = nullptr;
+		this->m_qwMemoryBudget = 0;
+		this->m_eLoadStage = LoadStageDescriptor;
+		this->m_sDescriptorStatus = { DiskJuggler::CdiDescriptorError::DescriptorOk, 0, 0, 0 };
+		this->m_dwSessionCount = 0;
+		this->m_dwTrackCount = 0;
+	}
+
+	CdiImage::~CdiImage()
+	{
+		// Close the image if it is still open.
+		Close();
+	}
+
+	void CdiImage::Close()
+	{
+		// Check if we created the ISO fs subsystem.
+		if (this->m_pFsIsoHandle != nullptr)
+		{
+			delete this->m_pFsIsoHandle;
+			this->m_pFsIsoHandle = nullptr;
+		}
+
+		// Cleanup the CDI image subsystem resources.
+		if (this->m_phFsTrackHandle != nullptr)
+		{
+			this->m_pCdiFile->CloseTrackHandle(this->m_phFsTrackHandle);
+			this->m_phFsTrackHandle = nullptr;
+		}
+		if (this->m_pCdiFile != nullptr)
+		{
+			delete this->m_pCdiFile;
+			this->m_pCdiFile = nullptr;
+		}
+	}
+
+	bool CdiImage::LoadImage(CString sFileName, bool bVerbos, bool bMemoryMap, bool bUseIndex, CdiLoadStage eLastStage)
+	{
+		DiskJuggler::CdiSidecarIndex *pIndex = nullptr;
+		DWORD dwSessionNumber = 0, dwTrackNumber = 0;
+
+		// Initialize the file handle which will take care of parsing the disk juggler
+		// format and giving us an easy to use api to read and write data with.
+		this->m_eLoadStage = LoadStageDescriptor;
+		this->m_dwSessionCount = 0;
+		this->m_dwTrackCount = 0;
+		this->m_pCdiFile = new DiskJuggler::CdiFileHandle();
+		this->m_pCdiFile->EnableSidecarIndex(bUseIndex);
+		if (this->m_qwMemoryBudget != 0)
+		{
+			// Split the budget between the sector cache and the staging buffers used for reads that strip sector headers.
+			DWORD dwChunkSectors = (DWORD)((this->m_qwMemoryBudget / 4) / DiskJuggler::CdiSectorSize::Size_2448);
+			this->m_pCdiFile->SetSectorCacheSize(this->m_qwMemoryBudget / 2);
+			this->m_pCdiFile->SetReadChunkSize(dwChunkSectors < 16 ? 16 : (dwChunkSectors > CDI_DEFAULT_READ_CHUNK_SECTORS ? CDI_DEFAULT_READ_CHUNK_SECTORS : dwChunkSectors));
+		}
+		bool bOpened = this->m_pCdiFile->Open(sFileName, false, bVerbos, bMemoryMap);
+		this->m_sDescriptorStatus = this->m_pCdiFile->GetDescriptorStatus();
+		if (bOpened == false)
+		{
+			// Failed to initialize the cdi file handle, close any file handles and return.
+			goto Cleanup;
+		}
+
+		// Count the sessions and tracks for anyone checking the image after a later stage fails.
+		{
+			ArrayView<DiskJuggler::CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+			this->m_dwSessionCount = (DWORD)sessionCollection.size();
+			this->m_dwTrackCount = 0;
+			for (DWORD i = 0; i < sessionCollection.size(); i++)
+				this->m_dwTrackCount += sessionCollection[i]->wTrackCount;
+		}
+		if (eLastStage < LoadStageBootstrap)
+		{
+			this->m_eLoadStage = LoadStageDone;
+			return true;
+		}
+
+		// If the index knows where the bootstrap is go straight to it, otherwise search the image for it.
+		this->m_eLoadStage = LoadStageBootstrap;
+		pIndex = this->m_pCdiFile->GetSidecarIndex();
+		if (pIndex != nullptr && pIndex->GetBootstrapLocation(&dwSessionNumber, &dwTrackNumber) == true &&
+			this->LoadBootstrapFromTrack(dwSessionNumber, dwTrackNumber) == true)
+		{
+			// Save the session and track numbers for later.
+			if (bVerbos == true)
+				printf("found IP.BIN in session %d track %d from index\n", dwSessionNumber + 1, dwTrackNumber + 1);
+			this->m_dwFsSessionNumber = dwSessionNumber;
+			this->m_dwFsTrackNumber = dwTrackNumber;
+		}
+		else if (this->LoadBootstrap(bVerbos) == false)
+		{
+			// Failed to read the bootstrap sector.
+			printf("CdiImage::LoadImage(): failed to load bootstrap sector!\n");
+			goto Cleanup;
+		}
+
+		// Save the bootstrap location in the index.
+		if (pIndex != nullptr)
+			pIndex->SetBootstrapLocation(this->m_dwFsSessionNumber, this->m_dwFsTrackNumber);
+		if (eLastStage < LoadStageFileSystem)
+		{
+			this->m_pCdiFile->SaveSidecarIndex();
+			this->m_eLoadStage = LoadStageDone;
+			return true;
+		}
+
+		// Initialize the file system track handle using the session and track numbers we found the bootstrap in.
+		this->m_eLoadStage = LoadStageFileSystem;
+		this->m_phFsTrackHandle = this->m_pCdiFile->OpenTrackHandle(this->m_dwFsSessionNumber, this->m_dwFsTrackNumber);
+		if (this->m_phFsTrackHandle == nullptr)
+		{
+			// Failed to get a handle on the file system track.
+			printf("CdiImage::LoadImage(): failed to open file system track!\n");
+			goto Cleanup;
+		}
+
+		// Load the ISO9660 file system.
+		if (this->LoadFileSystem(bVerbos) == false)
+		{
+			// Failed to load the ISO file system.
+			goto Cleanup;
+		}
+
+		// Write out the sidecar index if anything in it was rebuilt.
+		this->m_pCdiFile->SaveSidecarIndex();
+
+		// Everything loaded okay, return true.
+		this->m_eLoadStage = LoadStageDone;
+		return true;
+
+	Cleanup:
+		// Close anything we opened and return false.
+		Close();
+		return false;
+	}
+
+	void CdiImage::SetMemoryBudget(ULONGLONG qwBudget)
+	{
+		// Save the budget for when the image is loaded.
+		this->m_qwMemoryBudget = qwBudget;
+	}
+
+	CdiLoadStage CdiImage::GetLoadStage()
+	{
+		return this->m_eLoadStage;
+	}
+
+	const DiskJuggler::CdiDescriptorStatus& CdiImage::GetDescriptorStatus()
+	{
+		return this->m_sDescriptorStatus;
+	}
+
+	DWORD CdiImage::GetSessionCount()
+	{
+		return this->m_dwSessionCount;
+	}
+
+	DWORD CdiImage::GetTrackCount()
+	{
+		return this->m_dwTrackCount;
+	}
+
+	DiskJuggler::CdiFileHandle *CdiImage::GetFileHandle()
+	{
+		return this->m_pCdiFile;
+	}
+
+	bool CdiImage::LoadBootstrap(bool bVerbos)
+	{
+		// Allocate a scratch buffer for the bootstrap data.
+		PBYTE pbBootstrapBuffer = (PBYTE)AlignedAlloc(BOOTSTRAP_SIZE);
+		if (pbBootstrapBuffer == NULL)
+		{
+			// Failed to allocate scratch memory.
+			printf("CdiImage::LoadBootstrap(): failed to allocate memory for bootstrap data!\n");
+			return false;
+		}
+
+		// Loop through all the sessions and search for one with a DATA track.
+		printf("searching for IP.BIN...\n");
+		ArrayView<DiskJuggler::CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+		for (int i = 0; i < sessionCollection.size(); i++)
+		{
+			// Search for a track that is DATA.
+			for (int x = 0; x < sessionCollection[i]->wTrackCount; x++)
+			{
+				// Check if this track is a DATA track, if it's not skip it.
+				if (sessionCollection[i]->psTracks[x].eMode == DiskJuggler::CdiTrackMode::Audio)
+					continue;
+
+				// Print status.
+				printf("\rsearching session %d track %d...", i + 1, x + 1);
+				fflush(stdout);
+
+				// Read the first sector of the track so we can check for the bootstrap markings.
+				if (this->m_pCdiFile->ReadSectors(i, x, sessionCollection[i]->psTracks[x].dwLba, pbBootstrapBuffer, 1) == false)
+				{
+					// Failed to read the first sector of the track.
+					printf("\nCdiImage::LoadBootstrap(): failed to read first sector of session %d track %d!\n", i, x);
+					continue;
+				}
+
+				// Check the firt 4 bytes for 'SEGA'.
+				if (memcmp(pbBootstrapBuffer, HARDWARE_ID, 16) != 0)
+					continue;
+
+				// We found the correct track, save the session and track numbers for later.
+				printf("\nfound IP.BIN\n");
+				this->m_dwFsSessionNumber = i;
+				this->m_dwFsTrackNumber = x;
+
+				// Read the remaining sectors from the track.
+				if (this->m_pCdiFile->ReadSectors(i, x, sessionCollection[i]->psTracks[x].dwLba + 1, &pbBootstrapBuffer[2048], BOOTSTRAP_SECTOR_COUNT - 1) == false)
+				{
+					// Failed to read the remaining bootstrap sectors.
+					printf("\nCdiImage::LoadBootstrap(): failed to read bootstrap data in session %d track %d!\n", i, x);
+					continue;
+				}
+
+				// Try to parse the bootstrap data.
+				if (this->m_sBootstrap.LoadBootstrap((char*)pbBootstrapBuffer, BOOTSTRAP_SIZE) == false)
+				{
+					// Print error and return false.
+					printf("ERROR: IP.BIN is invalid!\n");
+
+					// Deallocate temp buffers.
+					AlignedFree(pbBootstrapBuffer);
+
+					// Return false.
+					return false;
+				}
+
+				// Bootstrap appears to be valid.
+				printf("bootstrap appears to be valid\n");
+
+				// Deallocate the sector buffer.
+				AlignedFree(pbBootstrapBuffer);
+
+				// Done, return true.
+				return true;
+			}
+		}
+
+		// If the scratch buffer is still valid, free it.
+		if (pbBootstrapBuffer)
+			AlignedFree(pbBootstrapBuffer);
+
+		// Bootstrap was not found.
+		printf("ERROR: could not find bootstrap!n");
+		return false;
+	}
+
+	bool CdiImage::LoadBootstrapFromTrack(DWORD dwSessionNumber, DWORD dwTrackNumber)
+	{
+		// Get the collection of session objects from the file handle and check the track is a DATA track.
+		ArrayView<DiskJuggler::CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+		if (dwSessionNumber >= sessionCollection.size() || dwTrackNumber >= sessionCollection[dwSessionNumber]->wTrackCount ||
+			sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eMode == DiskJuggler::CdiTrackMode::Audio)
+			return false;
+
+		// Allocate a scratch buffer for the bootstrap data.
+		PBYTE pbBootstrapBuffer = (PBYTE)AlignedAlloc(BOOTSTRAP_SIZE);
+		if (pbBootstrapBuffer == NULL)
+		{
+			// Failed to allocate scratch memory.
+			printf("CdiImage::LoadBootstrapFromTrack(): failed to allocate memory for bootstrap data!\n");
+			return false;
+		}
+
+		// Read all of the bootstrap sectors in one go, check the hardware id and parse them.
+		bool bResult = this->m_pCdiFile->ReadSectors(dwSessionNumber, dwTrackNumber, sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].dwLba,
+			pbBootstrapBuffer, BOOTSTRAP_SECTOR_COUNT) == true &&
+			memcmp(pbBootstrapBuffer, HARDWARE_ID, 16) == 0 &&
+			this->m_sBootstrap.LoadBootstrap((char*)pbBootstrapBuffer, BOOTSTRAP_SIZE) == true;
+
+		// Deallocate the sector buffer.
+		AlignedFree(pbBootstrapBuffer);
+		return bResult;
+	}
+
+	bool CdiImage::LoadFileSystem(bool bVerbos)
+	{
+		DiskJuggler::CdiSidecarIndex *pIndex = this->m_pCdiFile->GetSidecarIndex();
+
+		// If the index has the directory tree restore it from there instead of walking the file system.
+		const BYTE *pbRecords = nullptr;
+		DWORD dwSize = 0, dwEntryCount = 0;
+		if (pIndex != nullptr && pIndex->GetDirectoryRecords(&pbRecords, &dwSize, &dwEntryCount) == true)
+		{
+			this->m_pFsIsoHandle = new ISO::ISO9660();
+			if (this->m_pFsIsoHandle->LoadISOFromIndex(this->m_phFsTrackHandle, pbRecords, dwSize, dwEntryCount, bVerbos) == true)
+				return true;
+
+			// The directory records are bad, fall back to parsing the file system.
+			delete this->m_pFsIsoHandle;
+			this->m_pFsIsoHandle = nullptr;
+		}
+
+		// Parse the ISO9660 structure and read out the file system.
+		this->m_pFsIsoHandle = new ISO::ISO9660();
+		if (this->m_pFsIsoHandle->LoadISOFromCDI(this->m_phFsTrackHandle, bVerbos) == false)
+			return false;
+
+		// Save the directory tree in the index.
+		if (pIndex != nullptr)
+		{
+			std::vector<BYTE> vRecords;
+			this->m_pFsIsoHandle->ExportDirectoryRecords(&vRecords, &dwEntryCount);
+			pIndex->SetDirectoryRecords(vRecords.data(), (DWORD)vRecords.size(), dwEntryCount);
+		}
+
+		return true;
+	}
+
+	bool CdiImage::WriteTrackToFile(CString sOutputFolder, DWORD dwSessionNumber, DWORD dwTrackNumber)
+	{
+		// Correct the session and track numbers.
+		dwSessionNumber--;
+		dwTrackNumber--;
+
+		// Get the collection of session objects from the file handle.
+		ArrayView<DiskJuggler::CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+
+		// Check the session number is valid.
+		if (dwSessionNumber < 0 || dwSessionNumber >= sessionCollection.size())
+		{
+			// Print error and return.
+			printf("ERROR: requested session %d is invalid!\n", dwSessionNumber + 1);
+			return false;
+		}
+
+		// Check there is at least 1 closed track for this session.
+		if (sessionCollection[dwSessionNumber]->wTrackCount == 0)
+		{
+			// Print error and return.
+			printf("ERROR: no tracks found or track is open for session %d!\n", dwSessionNumber + 1);
+			return false;
+		}
+
+		// Check if the track number is valid.
+		if (dwTrackNumber < 0 || dwTrackNumber >= sessionCollection[dwSessionNumber]->wTrackCount)
+		{
+			// Print error and return.
+			printf("ERROR: requested track %d is invalid!\n", dwTrackNumber + 1);
+			return false;
+		}
+
+		// Format the output file name.
+		CHAR sFileName[MAX_PATH] = { 0 };
+		LPCSTR sTrackName = (sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eMode == DiskJuggler::CdiTrackMode::Audio ? "Audio" : "Data");
+		LPCSTR sTrackExt = (sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eMode == DiskJuggler::CdiTrackMode::Audio ? "wav" : "iso");
+		sprintf(sFileName, "%s\\T%s%d-%d.%s", sOutputFolder, sTrackName, dwSessionNumber + 1, dwTrackNumber + 1, sTrackExt);
+
+		// Create the iso file.
+		IO::BlockDevice *pTrackFile = IO::OpenFileDevice(sFileName, IO::BlockDeviceAccess::CreateAlways);
+		if (pTrackFile == nullptr)
+		{
+			// Print error and return.
+			printf("ERROR: could not create output file %s!\n", sFileName);
+			return false;
+		}
+
+		// Check if the track is of Audio type.
+		ULONGLONG qwOutputOffset = 0;
+		if (sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eMode == DiskJuggler::CdiTrackMode::Audio)
+		{
+			// Write a wav header for it.
+			if (WriteWavHeader(pTrackFile, sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].dwLength) == false)
+			{
+				// Print error, close file and return false.
+				printf("ERROR: could not write wav header for file %s!\n", sFileName);
+				delete pTrackFile;
+				return false;
+			}
+
+			// The track data starts after the 44 byte wav header.
+			qwOutputOffset = 44;
+		}
+
+		// Stream the track to the output file, the next batches of sectors are read while the current one is written.
+		DWORD dwTrackLength = sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].dwLength;
+		bool bResult = StreamTrack(dwSessionNumber, dwTrackNumber, [&](DWORD dwLBA, PBYTE pbData, DWORD dwSectorCount, DWORD dwSectorSize) -> bool
+		{
+			// Write the sectors to the output file.
+			if (pTrackFile->WriteAt(qwOutputOffset, pbData, dwSectorCount * dwSectorSize) == false)
+			{
+				// Print error and bail out.
+				printf("\nERROR: failed to write to output file %s!\n", sFileName);
+				return false;
+			}
+			qwOutputOffset += (ULONGLONG)dwSectorCount * dwSectorSize;
+
+			// Print progress.
+			printf("\rsaving track \t%d \t%s/%d \t%.2f%%", dwTrackNumber, sTrackName, sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber].eSectorSize,
+				(float)((float)(dwLBA + dwSectorCount) / (float)dwTrackLength) * 100.0f);
+			fflush(stdout);
+			return true;
+		});
+
+		// Close the output iso file and return.
+		printf("\n");
+		delete pTrackFile;
+		return bResult;
+	}
+
+	bool CdiImage::StreamTrack(DWORD dwSessionNumber, DWORD dwTrackNumber, TrackStreamCallback fnCallback)
+	{
+		// Get the collection of session objects from the file handle.
+		ArrayView<DiskJuggler::CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+
+		// Check the session and track numbers are valid.
+		if (dwSessionNumber >= sessionCollection.size() || dwTrackNumber >= sessionCollection[dwSessionNumber]->wTrackCount)
+		{
+			// Print error and return.
+			printf("CdiImage::StreamTrack(): invalid session %d track %d!\n", dwSessionNumber + 1, dwTrackNumber + 1);
+			return false;
+		}
+
+		// Audio tracks are returned as full sectors, data tracks as user data only.
+		DiskJuggler::CdiTrack *pTrack = &sessionCollection[dwSessionNumber]->psTracks[dwTrackNumber];
+		DWORD dwSectorSize = (pTrack->eMode == DiskJuggler::CdiTrackMode::Audio ? pTrack->eSectorSize : RAW_SECTOR_SIZE);
+
+		// Setup the batches we will keep in flight.
+		DWORD dwBatchCount = this->m_pCdiFile->GetReadQueueDepth();
+		if (dwBatchCount > CDI_STREAM_BATCH_COUNT)
+			dwBatchCount = CDI_STREAM_BATCH_COUNT;
+		DiskJuggler::CdiSectorReadRequest *psBatches = new DiskJuggler::CdiSectorReadRequest[dwBatchCount];
+		DiskJuggler::CdiSectorReadRequest **ppBatchList = new DiskJuggler::CdiSectorReadRequest*[dwBatchCount];
+		bool *pbBatchDone = new bool[dwBatchCount];
+		PBYTE pbBuffer = new BYTE[dwBatchCount * CDI_STREAM_BATCH_SECTORS * dwSectorSize];
+		for (DWORD i = 0; i < dwBatchCount; i++)
+		{
+			psBatches[i].dwSessionNumber = dwSessionNumber;
+			psBatches[i].dwTrackNumber = dwTrackNumber;
+			psBatches[i].pbBuffer = &pbBuffer[i * CDI_STREAM_BATCH_SECTORS * dwSectorSize];
+			psBatches[i].pContext = (PVOID)(uintptr_t)i;
+			pbBatchDone[i] = false;
+		}
+
+		// Loop until every batch has been handed to the callback. Batches are submitted in order and handed to the
+		// callback in order, but they may complete in any order.
+		bool bResult = true;
+		DWORD dwSubmitIndex = 0, dwDeliverIndex = 0, dwNextLBA = 0;
+		while (true)
+		{
+			// Fill any free batches with the next sectors of the track and submit them.
+			DWORD dwSubmitCount = 0;
+			while (dwSubmitIndex - dwDeliverIndex < dwBatchCount && dwNextLBA < pTrack->dwLength)
+			{
+				DiskJuggler::CdiSectorReadRequest *pBatch = &psBatches[dwSubmitIndex % dwBatchCount];
+				DWORD dwSectorsRemaining = pTrack->dwLength - dwNextLBA;
+				pBatch->dwLBA = pTrack->dwLba + dwNextLBA;
+				pBatch->dwSectorCount = (dwSectorsRemaining < CDI_STREAM_BATCH_SECTORS ? dwSectorsRemaining : CDI_STREAM_BATCH_SECTORS);
+
+				ppBatchList[dwSubmitCount++] = pBatch;
+				dwNextLBA += pBatch->dwSectorCount;
+				dwSubmitIndex++;
+			}
+			if (dwSubmitCount > 0 && this->m_pCdiFile->SubmitSectorReads(ppBatchList, dwSubmitCount) == false)
+			{
+				// Failed to submit the reads, forget about them so we don't wait for them below.
+				printf("CdiImage::StreamTrack(): failed to submit reads!\n");
+				bResult = false;
+				break;
+			}
+
+			// Check if we are done.
+			if (dwDeliverIndex == dwSubmitIndex)
+				break;
+
+			// If the next batch in order hasn't completed yet wait for some completions.
+			DWORD dwSlot = dwDeliverIndex % dwBatchCount;
+			if (pbBatchDone[dwSlot] == false)
+			{
+				DWORD dwCount = this->m_pCdiFile->CompleteSectorReads(ppBatchList, dwBatchCount);
+				if (dwCount == 0)
+				{
+					bResult = false;
+					break;
+				}
+
+				for (DWORD i = 0; i < dwCount; i++)
+					pbBatchDone[(uintptr_t)ppBatchList[i]->pContext] = true;
+				continue;
+			}
+
+			// Check the batch was read successfully and hand it to the callback.
+			DiskJuggler::CdiSectorReadRequest *pBatch = &psBatches[dwSlot];
+			if (pBatch->bSuccess == false)
+			{
+				printf("CdiImage::StreamTrack(): failed to read sectors! LBA=%d, Count=%d\n", pBatch->dwLBA, pBatch->dwSectorCount);
+				bResult = false;
+				break;
+			}
+			if (fnCallback(pBatch->dwLBA - pTrack->dwLba, pBatch->pbBuffer, pBatch->dwSectorCount, dwSectorSize) == false)
+			{
+				bResult = false;
+				break;
+			}
+
+			// Next batch.
+			pbBatchDone[dwSlot] = false;
+			dwDeliverIndex++;
+		}
+
+		// Wait for anything still in flight before we free the buffers.
+		while (this->m_pCdiFile->CompleteSectorReads(ppBatchList, dwBatchCount) > 0);
+
+		// Free the batches.
+		delete[] pbBuffer;
+		delete[] pbBatchDone;
+		delete[] ppBatchList;
+		delete[] psBatches;
+		return bResult;
+	}
+
+	bool CdiImage::WriteAllTracks(CString sOutputFolder)
+	{
+		// Get the collection of session objects from the file handle.
+		ArrayView<DiskJuggler::CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+
+		// Loop through all the sessions and dump every track.
+		for (int i = 0; i < sessionCollection.size(); i++)
+		{
+			// Loop through all the tracks and dump each one.
+			for (int x = 0; x < sessionCollection[i]->wTrackCount; x++)
+			{
+				// Dump the track and check the result.
+				if (this->WriteTrackToFile(sOutputFolder, i + 1, x + 1) == false)
+				{
+					// Print error and return.
+					printf("ERROR: failed to dump track %d from session %d!\n", i + 1, x + 1);
+					return false;
+				}
+			}
+		}
+
+		// Done.
+		return true;
+	}
+
+	bool CdiImage::ValidateImage(bool bVerbose, DWORD dwThreadCount)
+	{
+		// Check every sector in the image.
+		DiskJuggler::CdiVerifier sVerifier(this->m_pCdiFile, dwThreadCount);
+		DiskJuggler::CdiVerifyReport sReport;
+		bool bResult = sVerifier.VerifyImage(&sReport);
+
+		// Print the report.
+		sReport.Print(bVerbose);
+		return bResult == true && sReport.BadSectorCount() == 0;
+	}
+
+	bool CdiImage::ExtractIPBin(CString sOutputFolder)
+	{
+		// Format the output file name.
+		CHAR sFileName[MAX_PATH] = { 0 };
+		sprintf(sFileName, "%s\\IP.BIN", sOutputFolder);
+
+		// Create the output file.
+		IO::BlockDevice *pOutputFile = IO::OpenFileDevice(sFileName, IO::BlockDeviceAccess::CreateAlways);
+		if (pOutputFile == nullptr)
+		{
+			// Print error and return.
+			printf("ERROR: failed to create output file %s!", sFileName);
+			return false;
+		}
+
+		// Allocate a temp buffer for the bootstrap data.
+		char *pbBootstrapBuffer = new char[BOOTSTRAP_SIZE];
+
+		// Copy the bootstrap data.
+		if (this->m_sBootstrap.CopyBootstrapBuffer(pbBootstrapBuffer, BOOTSTRAP_SIZE) == false)
+		{
+			// Print error and return false.
+			printf("ERROR: what the actual fuck...\n");
+			delete[] pbBootstrapBuffer;
+			delete pOutputFile;
+			return false;
+		}
+
+		// Write the bootstrap data to file.
+		pOutputFile->WriteAt(0, pbBootstrapBuffer, BOOTSTRAP_SIZE);
+
+		// Close the output IP.BIN file.
+		printf("successfully extracted IP.BIN\n");
+		delete pOutputFile;
+
+		// Deallocate the bootstrap buffer.
+		delete[] pbBootstrapBuffer;
+
+		// Done, return true.
+		return true;
+	}
+
+	bool CdiImage::ExtractMRImage(CString sOutputFolder)
+	{
+		// Try to dump the boot logo.
+		if (this->m_sBootstrap.Extract3rdPartyBootLogo(sOutputFolder) == true)
+			printf("successfully extracted boot logo\n");
+		else
+			return false;
+
+		// Done, return.
+		return true;
+	}
+
+	bool CdiImage::ExtractISOFileSystem(CString sOutputFolder)
+	{
+		// Check that we have a valid fs iso handle.
+		if (this->m_pFsIsoHandle == nullptr)
+			return false;
+
+		// Extract all of the files and folders in the file system.
+		return this->m_pFsIsoHandle->ExtractFileSystem(sOutputFolder, false);
+	}
+
+	bool CdiImage::ConvertImage(CString sOutputFile, CdiConvertFormat eFormat)
+	{
+		// The bootstrap and the file system are on the same track, make sure we found it.
+		if (this->m_phFsTrackHandle == nullptr)
+		{
+			printf("CdiImage::ConvertImage(): image has no file system track!\n");
+			return false;
+		}
+		ArrayView<DiskJuggler::CdiSession> sessionCollection = this->m_pCdiFile->GetSessions();
+		DiskJuggler::CdiTrack *pTrack = &sessionCollection[this->m_dwFsSessionNumber]->psTracks[this->m_dwFsTrackNumber];
+
+		// Open a track handle of our own to stream the track through so the reads run ahead of the writes.
+		DiskJuggler::CdiTrackHandle *phTrack = this->m_pCdiFile->OpenTrackHandle(this->m_dwFsSessionNumber, this->m_dwFsTrackNumber);
+		if (phTrack == nullptr)
+			return false;
+		phTrack->EnableReadAhead();
+
+		IO::BlockDevice *pIsoFile = nullptr;
+		DiskJuggler::CdiImageWriter *pWriter = nullptr;
+		PBYTE pbBuffer = nullptr;
+		std::vector<BYTE> vHeader;
+		ULONGLONG qwOutputOffset = 0;
+		bool bResult = false;
+
+		// Read the volume descriptors and path tables and relocate them. Both the ISO image and the first session of
+		// a data/data image start at LBA 0.
+		ISO::ISO9660Relocator sRelocator;
+		if (sRelocator.Prepare(phTrack, 0) == false)
+			goto Cleanup;
+
+		// Create the output image.
+		if (eFormat == CdiConvertFormat::ConvertIso)
+		{
+			pIsoFile = IO::OpenFileDevice(sOutputFile, IO::BlockDeviceAccess::CreateAlways);
+			if (pIsoFile == nullptr)
+			{
+				printf("ERROR: could not create output file %s!\n", sOutputFile);
+				goto Cleanup;
+			}
+		}
+		else
+		{
+			pWriter = new DiskJuggler::CdiImageWriter();
+			if (pWriter->Create(sOutputFile) == false || pWriter->BeginTrack(pTrack->eMode, pTrack->eSectorType) == false)
+				goto Cleanup;
+		}
+
+		// Stream the track through the relocator and into the output image.
+		pbBuffer = new BYTE[CDI_STREAM_BATCH_SECTORS * ISO9660_SECTOR_SIZE];
+		vHeader.resize(sRelocator.GetHeaderSectorCount() * ISO9660_SECTOR_SIZE);
+		for (DWORD dwLBA = 0; dwLBA < pTrack->dwLength; )
+		{
+			// Read the next batch of sectors and relocate them.
+			DWORD dwSectorCount = (pTrack->dwLength - dwLBA < CDI_STREAM_BATCH_SECTORS ? pTrack->dwLength - dwLBA : CDI_STREAM_BATCH_SECTORS);
+			if (phTrack->ReadNext(pbBuffer, dwSectorCount) == false)
+			{
+				printf("\nCdiImage::ConvertImage(): failed to read sectors! LBA=%d, Count=%d\n", pTrack->dwLba + dwLBA, dwSectorCount);
+				goto Cleanup;
+			}
+			if (sRelocator.RelocateSectors(dwLBA, pbBuffer, dwSectorCount) == false)
+				goto Cleanup;
+
+			// Keep a copy of the relocated bootstrap and volume descriptors for the second session.
+			if (dwLBA * ISO9660_SECTOR_SIZE < vHeader.size())
+			{
+				DWORD dwHeaderSize = (DWORD)vHeader.size() - dwLBA * ISO9660_SECTOR_SIZE;
+				memcpy(&vHeader[dwLBA * ISO9660_SECTOR_SIZE], pbBuffer, (dwHeaderSize < dwSectorCount * ISO9660_SECTOR_SIZE ? dwHeaderSize : dwSectorCount * ISO9660_SECTOR_SIZE));
+			}
+
+			// Write the sectors to the output image.
+			bool bWritten = (pIsoFile != nullptr ? pIsoFile->WriteAt(qwOutputOffset, pbBuffer, dwSectorCount * ISO9660_SECTOR_SIZE) :
+				pWriter->WriteTrackData(pbBuffer, dwSectorCount * ISO9660_SECTOR_SIZE));
+			if (bWritten == false)
+			{
+				printf("\nERROR: failed to write to output file %s!\n", sOutputFile);
+				goto Cleanup;
+			}
+			qwOutputOffset += (ULONGLONG)dwSectorCount * ISO9660_SECTOR_SIZE;
+			dwLBA += dwSectorCount;
+
+			// Print progress.
+			printf("\rconverting image \t%.2f%%", (float)((float)dwLBA / (float)pTrack->dwLength) * 100.0f);
+			fflush(stdout);
+		}
+		printf("\n");
+
+		// Make sure every directory got relocated.
+		if (sRelocator.Finish() == false)
+			goto Cleanup;
+
+		if (pWriter != nullptr)
+		{
+			// The console boots from the last session, give it the bootstrap and the volume descriptors pointing back
+			// at the file system in the first session. Pad the track out to the shortest track allowed.
+			if (pWriter->BeginSession() == false || pWriter->BeginTrack(pTrack->eMode, pTrack->eSectorType) == false ||
+				pWriter->WriteTrackData(vHeader.data(), (DWORD)vHeader.size()) == false)
+				goto Cleanup;
+
+			memset(pbBuffer, 0, ISO9660_SECTOR_SIZE);
+			for (DWORD i = sRelocator.GetHeaderSectorCount(); i < CDI_MIN_TRACK_SECTORS; i++)
+			{
+				if (pWriter->WriteTrackData(pbBuffer, ISO9660_SECTOR_SIZE) == false)
+					goto Cleanup;
+			}
+
+			if (pWriter->Close() == false)
+				goto Cleanup;
+		}
+		else if (pIsoFile->Flush() == false)
+		{
+			printf("ERROR: failed to write to output file %s!\n", sOutputFile);
+			goto Cleanup;
+		}
+
+		printf("relocated %d LBAs, saved image to %s\n", sRelocator.GetRelocatedCount(), sOutputFile);
+		bResult = true;
+
+	Cleanup:
+		// Close the output image, an image that failed to convert is left incomplete.
+		if (pIsoFile != nullptr)
+			delete pIsoFile;
+		if (pWriter != nullptr)
+			delete pWriter;
+		if (pbBuffer != nullptr)
+			delete[] pbBuffer;
+		this->m_pCdiFile->CloseTrackHandle(phTrack);
+		return bResult;
+	}
 };
\ No newline at end of file
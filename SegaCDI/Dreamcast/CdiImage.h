@@ -1,73 +1,213 @@
-/*
-	SegaCDI - Sega Dreamcast cdi image validator.
-
-	CdiImage.h - Support for DiscJuggler cdi images.
-
-	Mar 6th, 2013
-		- Initial creation.
-
-	Dec 15th, 2015
-		- Added overload for LoadImage() to read the ISO9660 data session
-			when reading the CDI image file.
-*/
-
-#pragma once
-#include "../stdafx.h"
-#include "../DiskJuggler/CdiFileHandle.h"
-#include "Bootstrap.h"
-#include "..\ISO\Iso9660.h"
-
-namespace Dreamcast
-{
-	#define IP_BIN_SECTOR_COUNT			16
-	#define IP_BIN_SIZE					0x8000
-
-	class CdiImage
-	{
-	protected:
-		DiskJuggler::CdiFileHandle *m_pCdiFile;		// CDI image file handle
-
-		// Bootstrap and file system data.
-		DWORD			m_dwFsSessionNumber;			// Session number the file system data is located in
-		DWORD			m_dwFsTrackNumber;				// Track number the file system data is located in
-
-		DiskJuggler::CdiTrackHandle *m_phFsTrackHandle;	// Track handle for the file system track
-		Bootstrap		m_sBootstrap;					// IP.BIN bootstrap data handler
-
-		ISO::ISO9660	*m_pFsIsoHandle;				// ISO handle for the file system
-
-		/*
-			Description: Searches each session in the CDI file for the IP.BIN bootstrap.
-
-			Parameters:
-				bVerbose: boolean indicating if extra information should be printed to the console.
-
-			Returns: True if the bootstrap was found and successfully parsed, false otherwise.
-		*/
-		bool LoadBootstrap(bool bVerbos);
-
-	public:
-		CdiImage();
-		~CdiImage();
-
-		/*
-			Description: Loads the CDI image specified, finding the bootstrap sector and reading
-				any file system sessions within the image.
-
-			Parameters:
-				sFileName: file path of the CDI image to load.
-				bVerbose: boolean indicating if extra information should be printed to the console.
-
-			Returns: True if the CDI image and file sub systems were successfully read and initialize, false otherwise.
-		*/
-		bool LoadImage(CString sFileName, bool bVerbos);
-
-		bool WriteTrackToFile(CString sOutputFolder, DWORD dwSessionNumber, DWORD dwTrackNumber);
-		bool WriteAllTracks(CString sOutputFolder);
-
-		bool ExtractIPBin(CString sOutputFolder);
-		bool ExtractMRImage(CString sOutputFolder);
-
-		bool ExtractISOFileSystem(CString sOutputFolder);
-	};
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	CdiImage.h - Support for DiscJuggler cdi images.
+
+	Mar 6th, 2013
+		- Initial creation.
+
+	Dec 15th, 2015
+		- Added overload for LoadImage() to read the ISO9660 data session
+			when reading the CDI image file.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "../DiskJuggler/CdiFileHandle.h"
+#include "Bootstrap.h"
+#include "..\ISO\Iso9660.h"
+#include <functional>
+
+namespace Dreamcast
+{
+	#define IP_BIN_SECTOR_COUNT			16
+	#define IP_BIN_SIZE					0x8000
+
+	// Number of sectors per read and number of reads kept in flight when streaming a track.
+	#define CDI_STREAM_BATCH_SECTORS	256
+	#define CDI_STREAM_BATCH_COUNT		8
+
+	// Shortest track allowed on a disc, 4 seconds.
+	#define CDI_MIN_TRACK_SECTORS		300
+
+	/*
+		Callback for CdiImage::StreamTrack(), receives the sectors of the track in order. dwLBA is relative to the start
+		of the track and dwSectorSize is the size of each sector in pbData. Return false to stop streaming.
+	*/
+	typedef std::function<bool(DWORD dwLBA, PBYTE pbData, DWORD dwSectorCount, DWORD dwSectorSize)> TrackStreamCallback;
+
+	/*
+		Stages CdiImage::LoadImage() goes through, in order.
+	*/
+	enum CdiLoadStage : int
+	{
+		LoadStageDescriptor,		// Opening the image and parsing the session descriptor
+		LoadStageBootstrap,			// Finding and parsing the IP.BIN bootstrap
+		LoadStageFileSystem,		// Parsing the ISO9660 file system
+		LoadStageDone				// Every requested stage was loaded
+	};
+
+	/*
+		Output formats for CdiImage::ConvertImage().
+	*/
+	enum CdiConvertFormat : int
+	{
+		ConvertDataData,			// CDI image with the file system in the first session and the bootstrap in the second
+		ConvertIso					// Plain ISO image starting at LBA 0
+	};
+
+	class CdiImage
+	{
+	protected:
+		DiskJuggler::CdiFileHandle *m_pCdiFile;		// CDI image file handle
+
+		// Bootstrap and file system data.
+		DWORD			m_dwFsSessionNumber;			// Session number the file system data is located in
+		DWORD			m_dwFsTrackNumber;				// Track number the file system data is located in
+
+		DiskJuggler::CdiTrackHandle *m_phFsTrackHandle;	// Track handle for the file system track
+		Bootstrap		m_sBootstrap;					// IP.BIN bootstrap data handler
+
+		ISO::ISO9660	*m_pFsIsoHandle;				// ISO handle for the file system
+
+		// Loading.
+		ULONGLONG		m_qwMemoryBudget;				// Memory budget for the file handle, 0 uses the file handle defaults
+		CdiLoadStage	m_eLoadStage;					// Stage LoadImage() failed at, or LoadStageDone
+		DiskJuggler::CdiDescriptorStatus	m_sDescriptorStatus;	// Session descriptor status from the last LoadImage()
+		DWORD			m_dwSessionCount;				// Number of sessions found by the last LoadImage()
+		DWORD			m_dwTrackCount;					// Number of tracks found by the last LoadImage()
+
+		/*
+			Description: Searches each session in the CDI file for the IP.BIN bootstrap.
+
+			Parameters:
+				bVerbose: boolean indicating if extra information should be printed to the console.
+
+			Returns: True if the bootstrap was found and successfully parsed, false otherwise.
+		*/
+		bool LoadBootstrap(bool bVerbos);
+
+		/*
+			Description: Reads and parses the IP.BIN bootstrap from the track it was previously found in.
+
+			Returns: True if the bootstrap was read and successfully parsed, false otherwise.
+		*/
+		bool LoadBootstrapFromTrack(DWORD dwSessionNumber, DWORD dwTrackNumber);
+
+		/*
+			Description: Parses the ISO9660 file system on the file system track, restoring the directory tree from
+				the sidecar index when there is a valid one.
+
+			Returns: True if the file system was loaded, false otherwise.
+		*/
+		bool LoadFileSystem(bool bVerbos);
+
+		/*
+			Description: Closes the file system, the file system track handle and the image file.
+		*/
+		void Close();
+
+	public:
+		CdiImage();
+		~CdiImage();
+
+		/*
+			Description: Loads the CDI image specified, finding the bootstrap sector and reading
+				any file system sessions within the image.
+
+			Parameters:
+				sFileName: file path of the CDI image to load.
+				bVerbose: boolean indicating if extra information should be printed to the console.
+				bMemoryMap: boolean indicating if the image file should be memory mapped.
+				bUseIndex: boolean indicating if the sidecar index should be used. The session layout, bootstrap
+					location and file system directory tree are loaded from the sidecar next to the image instead of
+					being parsed, and a missing or stale sidecar is rebuilt.
+				eLastStage: last stage to load, LoadStageDescriptor only opens the image and LoadStageBootstrap stops
+					after IP.BIN. The extract functions need the file system.
+
+			Returns: True if the CDI image and file sub systems were successfully read and initialize, false otherwise.
+				GetLoadStage() tells which stage failed.
+		*/
+		bool LoadImage(CString sFileName, bool bVerbos, bool bMemoryMap = false, bool bUseIndex = false, CdiLoadStage eLastStage = LoadStageFileSystem);
+
+		/*
+			Description: Caps the memory the image file handle uses for its sector cache and staging buffers. Must be
+				called before LoadImage().
+
+			Parameters:
+				qwBudget: Budget in bytes, 0 uses the file handle defaults.
+		*/
+		void SetMemoryBudget(ULONGLONG qwBudget);
+
+		/*
+			Description: Gets the stage the last call to LoadImage() failed at, or LoadStageDone if it succeeded.
+		*/
+		CdiLoadStage GetLoadStage();
+
+		/*
+			Description: Gets the session descriptor status from the last call to LoadImage(), which says why the
+				image was rejected when it failed at LoadStageDescriptor.
+		*/
+		const DiskJuggler::CdiDescriptorStatus& GetDescriptorStatus();
+
+		/*
+			Description: Gets the number of sessions and tracks found by the last call to LoadImage(), these are kept
+				when a later stage fails and the image is closed.
+		*/
+		DWORD GetSessionCount();
+		DWORD GetTrackCount();
+
+		/*
+			Description: Gets the file handle of the loaded image, or nullptr if no image is loaded.
+		*/
+		DiskJuggler::CdiFileHandle *GetFileHandle();
+
+		/*
+			Description: Reads a whole track using asynchronous reads, keeping several batches of sectors in flight
+				while the previous ones are processed by the callback.
+
+			Parameters:
+				dwSessionNumber: session number the track is located in, zero based.
+				dwTrackNumber: track number to stream, zero based.
+				fnCallback: callback that receives the sectors of the track in order.
+
+			Returns: True if the whole track was read and the callback accepted every batch, false otherwise.
+		*/
+		bool StreamTrack(DWORD dwSessionNumber, DWORD dwTrackNumber, TrackStreamCallback fnCallback);
+
+		bool WriteTrackToFile(CString sOutputFolder, DWORD dwSessionNumber, DWORD dwTrackNumber);
+		bool WriteAllTracks(CString sOutputFolder);
+
+		/*
+			Description: Checks the sync, header, EDC and ECC of every raw sector in the image and prints a report
+				of the bad sectors in each track.
+
+			Parameters:
+				bVerbose: boolean indicating if every bad sector should be listed.
+				dwThreadCount: number of threads to verify with, 0 uses one per processor.
+
+			Returns: True if every sector was read and is valid, false otherwise.
+		*/
+		bool ValidateImage(bool bVerbose, DWORD dwThreadCount = 0);
+
+		bool ExtractIPBin(CString sOutputFolder);
+		bool ExtractMRImage(CString sOutputFolder);
+
+		bool ExtractISOFileSystem(CString sOutputFolder);
+
+		/*
+			Description: Converts the file system track to a data/data image or a plain ISO image in one sequential
+				pass. The ISO image is moved to LBA 0, the volume descriptors and path tables are relocated up front
+				and directory sectors are relocated as they are streamed, every other sector is copied as is. A
+				data/data image gets the relocated bootstrap and volume descriptors again in a second session so
+				the console can boot it.
+
+			Parameters:
+				sOutputFile: File path of the image to create.
+				eFormat: Format of the image to create.
+
+			Returns: True if the image was converted, false otherwise.
+		*/
+		bool ConvertImage(CString sOutputFile, CdiConvertFormat eFormat);
+	};
 };
\ No newline at end of file
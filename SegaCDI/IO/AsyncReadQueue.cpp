@@ -0,0 +1,131 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	AsyncReadQueue.cpp - Asynchronous batched reads from a block device.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "AsyncReadQueue.h"
+
+namespace IO
+{
+	//-----------------------------------------------------
+	// ThreadPoolReadQueue
+	//-----------------------------------------------------
+	ThreadPoolReadQueue::ThreadPoolReadQueue(BlockDevice *pDevice, DWORD dwQueueDepth)
+	{
+		// Initialize fields.
+		this->m_pDevice = pDevice;
+		this->m_dwQueueDepth = (dwQueueDepth == 0 ? 1 : dwQueueDepth);
+		this->m_dwOutstanding = 0;
+		this->m_bStop = false;
+
+		// The worker threads are started on the first submit, so a queue that is never used costs nothing.
+		this->m_dwThreadCount = (this->m_dwQueueDepth < ASYNC_READ_QUEUE_MAX_THREADS ? this->m_dwQueueDepth : ASYNC_READ_QUEUE_MAX_THREADS);
+	}
+
+	ThreadPoolReadQueue::~ThreadPoolReadQueue()
+	{
+		// Signal the workers to exit.
+		{
+			std::lock_guard<std::mutex> lock(this->m_Lock);
+			this->m_bStop = true;
+			this->m_cvPending.notify_all();
+		}
+
+		// Wait for the workers to exit.
+		for (size_t i = 0; i < this->m_vThreads.size(); i++)
+			this->m_vThreads[i].join();
+	}
+
+	void ThreadPoolReadQueue::WorkerThread()
+	{
+		std::unique_lock<std::mutex> lock(this->m_Lock);
+
+		// Loop until we are told to stop.
+		while (this->m_bStop == false)
+		{
+			// Wait for a request to service.
+			if (this->m_dPending.size() == 0)
+			{
+				this->m_cvPending.wait(lock);
+				continue;
+			}
+
+			// Take the next request off of the queue.
+			AsyncReadRequest *pRequest = this->m_dPending.front();
+			this->m_dPending.pop_front();
+
+			// Read the data without holding the lock.
+			lock.unlock();
+			pRequest->bSuccess = this->m_pDevice->ReadAt(pRequest->qwOffset, pRequest->pBuffer, pRequest->dwSize);
+			lock.lock();
+
+			// Hand the request back to the caller.
+			this->m_dCompleted.push_back(pRequest);
+			this->m_cvCompleted.notify_all();
+		}
+	}
+
+	bool ThreadPoolReadQueue::Submit(AsyncReadRequest **ppRequests, DWORD dwCount)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// Make sure there is room for all of the requests.
+		if (dwCount > this->m_dwQueueDepth - this->m_dwOutstanding)
+			return false;
+
+		// Start the worker threads if this is the first submit.
+		if (this->m_vThreads.size() == 0)
+		{
+			for (DWORD i = 0; i < this->m_dwThreadCount; i++)
+				this->m_vThreads.push_back(std::thread(&ThreadPoolReadQueue::WorkerThread, this));
+		}
+
+		// Queue the requests for the workers.
+		for (DWORD i = 0; i < dwCount; i++)
+		{
+			ppRequests[i]->bSuccess = false;
+			this->m_dPending.push_back(ppRequests[i]);
+		}
+		this->m_dwOutstanding += dwCount;
+
+		// Wake up the workers.
+		this->m_cvPending.notify_all();
+		return true;
+	}
+
+	DWORD ThreadPoolReadQueue::WaitForCompletions(AsyncReadRequest **ppCompleted, DWORD dwMaxCount)
+	{
+		std::unique_lock<std::mutex> lock(this->m_Lock);
+
+		// Check if there is anything to wait for.
+		if (this->m_dwOutstanding == 0 || dwMaxCount == 0)
+			return 0;
+
+		// Wait for at least one request to complete.
+		while (this->m_dCompleted.size() == 0)
+			this->m_cvCompleted.wait(lock);
+
+		// Return as many completed requests as we can.
+		DWORD dwCount = 0;
+		while (dwCount < dwMaxCount && this->m_dCompleted.size() > 0)
+		{
+			ppCompleted[dwCount++] = this->m_dCompleted.front();
+			this->m_dCompleted.pop_front();
+		}
+
+		this->m_dwOutstanding -= dwCount;
+		return dwCount;
+	}
+
+	DWORD ThreadPoolReadQueue::Outstanding()
+	{
+		// Return the number of requests in flight.
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+		return this->m_dwOutstanding;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,201 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	AsyncReadQueue.h - Asynchronous batched reads from a block device.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "BlockDevice.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+// Kernel io_uring structures, defined in <linux/io_uring.h>.
+struct io_uring_sqe;
+struct io_uring_cqe;
+#endif
+
+namespace IO
+{
+	// Default number of reads that can be in flight at once on a read queue.
+	#define ASYNC_READ_QUEUE_DEFAULT_DEPTH		32
+
+	// Upper limit for the number of worker threads used by the thread pool read queue.
+	#define ASYNC_READ_QUEUE_MAX_THREADS		8
+
+	struct AsyncReadRequest
+	{
+		ULONGLONG qwOffset;		// Offset to read from
+		PVOID pBuffer;			// Buffer to read the data into
+		DWORD dwSize;			// Number of bytes to read
+		PVOID pContext;			// Caller defined value, not touched by the queue
+		bool bSuccess;			// Set when the request completes, true if all of the data was read
+	};
+
+	//-----------------------------------------------------
+	// AsyncReadQueue
+	//-----------------------------------------------------
+	class AsyncReadQueue
+	{
+	public:
+		virtual ~AsyncReadQueue() { }
+
+		/*
+			Description: Submits a batch of read requests. The requests must stay valid until they are returned
+				by WaitForCompletions().
+
+			Parameters:
+				ppRequests: Array of requests to submit.
+				dwCount: Number of requests in ppRequests.
+
+			Returns: True if all of the requests were queued, false if there is not enough room left in the queue
+				for all of them. No requests are queued on failure.
+		*/
+		virtual bool Submit(AsyncReadRequest **ppRequests, DWORD dwCount) = 0;
+
+		/*
+			Description: Waits for submitted requests to complete.
+
+			Parameters:
+				ppCompleted: Array that receives the completed requests.
+				dwMaxCount: Maximum number of requests to return.
+
+			Returns: The number of completed requests written to ppCompleted. This blocks until at least one request
+				completes and only returns 0 if there are no requests in flight.
+		*/
+		virtual DWORD WaitForCompletions(AsyncReadRequest **ppCompleted, DWORD dwMaxCount) = 0;
+
+		/*
+			Description: Gets the number of requests that have been submitted but not yet returned by WaitForCompletions().
+		*/
+		virtual DWORD Outstanding() = 0;
+
+		/*
+			Description: Gets the maximum number of requests that can be in flight at once.
+		*/
+		virtual DWORD Depth() = 0;
+
+		/*
+			Description: Gets the name of the read queue implementation, for diagnostics.
+		*/
+		virtual LPCSTR Name() = 0;
+	};
+
+	//-----------------------------------------------------
+	// ThreadPoolReadQueue
+	//-----------------------------------------------------
+	class ThreadPoolReadQueue : public AsyncReadQueue
+	{
+	protected:
+		BlockDevice	*m_pDevice;				// Device to read from
+
+		std::vector<std::thread>		m_vThreads;		// Worker threads
+		std::deque<AsyncReadRequest*>	m_dPending;		// Requests waiting for a worker
+		std::deque<AsyncReadRequest*>	m_dCompleted;	// Requests waiting to be returned to the caller
+		std::mutex	m_Lock;					// Protects the request queues
+		std::condition_variable	m_cvPending;		// Signaled when requests are submitted or the workers should exit
+		std::condition_variable	m_cvCompleted;		// Signaled when a request completes
+		DWORD		m_dwQueueDepth;			// Maximum number of requests in flight
+		DWORD		m_dwOutstanding;		// Number of requests submitted but not returned
+		bool		m_bStop;				// Set to tell the workers to exit
+		DWORD		m_dwThreadCount;		// Number of worker threads to start on the first submit
+
+		/*
+			Description: Worker thread routine, reads pending requests until told to stop.
+		*/
+		void WorkerThread();
+
+	public:
+		/*
+			Description: Creates a read queue that services requests with positional reads on a pool of threads.
+
+			Parameters:
+				pDevice: Device to read from, must support concurrent ReadAt() calls.
+				dwQueueDepth: Maximum number of requests in flight, the number of worker threads is capped at
+					ASYNC_READ_QUEUE_MAX_THREADS. The threads are only started once the first request is submitted.
+		*/
+		ThreadPoolReadQueue(BlockDevice *pDevice, DWORD dwQueueDepth);
+		~ThreadPoolReadQueue();
+
+		bool Submit(AsyncReadRequest **ppRequests, DWORD dwCount);
+		DWORD WaitForCompletions(AsyncReadRequest **ppCompleted, DWORD dwMaxCount);
+		DWORD Outstanding();
+		DWORD Depth() { return this->m_dwQueueDepth; }
+		LPCSTR Name() { return "thread pool"; }
+	};
+
+#ifdef __linux__
+	//-----------------------------------------------------
+	// IoUringReadQueue
+	//-----------------------------------------------------
+	class IoUringReadQueue : public AsyncReadQueue
+	{
+	protected:
+		BlockDevice	*m_pDevice;				// Device the file descriptor belongs to, used to finish short reads
+		int			m_iFile;				// File descriptor to read from
+		int			m_iRing;				// io_uring file descriptor
+		DWORD		m_dwQueueDepth;			// Number of entries in the submission queue
+
+		// Submission queue ring.
+		PBYTE		m_pbSqRing;				// Mapped submission queue ring
+		SIZE_T		m_dwSqRingSize;			// Size of the submission queue ring mapping
+		DWORD		*m_pdwSqHead;			// Submission queue head, advanced by the kernel
+		DWORD		*m_pdwSqTail;			// Submission queue tail, advanced by us
+		DWORD		m_dwSqMask;				// Submission queue index mask
+		DWORD		*m_pdwSqArray;			// Submission queue index array
+		::io_uring_sqe	*m_psSqes;		// Submission queue entries
+		SIZE_T		m_dwSqesSize;			// Size of the submission queue entries mapping
+
+		// Completion queue ring.
+		PBYTE		m_pbCqRing;				// Mapped completion queue ring, may be the same mapping as the submission queue
+		SIZE_T		m_dwCqRingSize;			// Size of the completion queue ring mapping
+		DWORD		*m_pdwCqHead;			// Completion queue head, advanced by us
+		DWORD		*m_pdwCqTail;			// Completion queue tail, advanced by the kernel
+		DWORD		m_dwCqMask;				// Completion queue index mask
+		::io_uring_cqe	*m_psCqes;		// Completion queue entries
+
+		DWORD		m_dwOutstanding;		// Number of requests submitted but not returned
+		DWORD		m_dwUnsubmitted;		// Number of entries in the submission queue the kernel has not consumed yet
+
+		std::mutex	m_Lock;					// Protects the submission queue, the completion queue head and the counters
+		std::mutex	m_WaitLock;				// Held while waiting for completions, only one thread waits on the ring at a time
+
+		IoUringReadQueue();
+
+		/*
+			Description: Creates the io_uring instance and maps its rings.
+
+			Returns: True if io_uring is available and the rings were mapped, false otherwise.
+		*/
+		bool Initialize(BlockDevice *pDevice, int iFile, DWORD dwQueueDepth);
+
+	public:
+		~IoUringReadQueue();
+
+		/*
+			Description: Creates an io_uring read queue for the file descriptor of a device.
+
+			Parameters:
+				pDevice: Device the file descriptor belongs to.
+				iFile: File descriptor to read from.
+				dwQueueDepth: Maximum number of requests in flight.
+
+			Returns: A new read queue, or nullptr if io_uring is not available on this system.
+		*/
+		static IoUringReadQueue *Create(BlockDevice *pDevice, int iFile, DWORD dwQueueDepth);
+
+		bool Submit(AsyncReadRequest **ppRequests, DWORD dwCount);
+		DWORD WaitForCompletions(AsyncReadRequest **ppCompleted, DWORD dwMaxCount);
+		DWORD Outstanding();
+		DWORD Depth() { return this->m_dwQueueDepth; }
+		LPCSTR Name() { return "io_uring"; }
+	};
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,124 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	BlockDevice.cpp - Positional block device interface used for all image
+		and output file I/O.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "BlockDevice.h"
+#include "AsyncReadQueue.h"
+
+namespace IO
+{
+	//-----------------------------------------------------
+	// BlockDevice
+	//-----------------------------------------------------
+	bool BlockDevice::ReadAtVectored(ULONGLONG qwOffset, const BlockDeviceBuffer *psBuffers, DWORD dwBufferCount)
+	{
+		// Read each buffer from the device in order.
+		for (DWORD i = 0; i < dwBufferCount; i++)
+		{
+			// Read the data for this buffer.
+			if (ReadAt(qwOffset, psBuffers[i].pBuffer, psBuffers[i].dwSize) == false)
+				return false;
+
+			// Next buffer.
+			qwOffset += psBuffers[i].dwSize;
+		}
+
+		// Successfully read all of the buffers.
+		return true;
+	}
+
+	bool BlockDevice::CopyTo(ULONGLONG qwOffset, BlockDevice *pDestination, ULONGLONG qwDestinationOffset, ULONGLONG qwSize)
+	{
+		// Copy the data through a buffer one block at a time.
+		std::vector<BYTE> vBuffer((SIZE_T)(qwSize < BLOCK_DEVICE_COPY_BUFFER_SIZE ? qwSize : BLOCK_DEVICE_COPY_BUFFER_SIZE));
+		while (qwSize > 0)
+		{
+			// Read the next block and write it to the destination.
+			DWORD dwBlockSize = (DWORD)(qwSize < vBuffer.size() ? qwSize : vBuffer.size());
+			if (ReadAt(qwOffset, vBuffer.data(), dwBlockSize) == false || pDestination->WriteAt(qwDestinationOffset, vBuffer.data(), dwBlockSize) == false)
+				return false;
+
+			// Next block.
+			qwOffset += dwBlockSize;
+			qwDestinationOffset += dwBlockSize;
+			qwSize -= dwBlockSize;
+		}
+
+		// Successfully copied all of the data.
+		return true;
+	}
+
+	AsyncReadQueue *BlockDevice::CreateReadQueue(DWORD dwQueueDepth)
+	{
+		// Service the reads on a pool of threads.
+		return new ThreadPoolReadQueue(this, dwQueueDepth);
+	}
+
+	BlockDevice *OpenFileDevice(LPCSTR psFileName, BlockDeviceAccess eAccess)
+	{
+		// Create a new file device and open the file.
+		FileBlockDevice *pDevice = new FileBlockDevice();
+		if (pDevice->Open(psFileName, eAccess) == false)
+		{
+			// Failed to open the file.
+			delete pDevice;
+			return nullptr;
+		}
+
+		// Return the new device.
+		return pDevice;
+	}
+
+	//-----------------------------------------------------
+	// MemoryBlockDevice
+	//-----------------------------------------------------
+	MemoryBlockDevice::MemoryBlockDevice()
+	{
+	}
+
+	MemoryBlockDevice::MemoryBlockDevice(const BYTE *pbData, SIZE_T dwSize)
+		: m_vData(pbData, pbData + dwSize)
+	{
+	}
+
+	bool MemoryBlockDevice::ReadAt(ULONGLONG qwOffset, PVOID pBuffer, DWORD dwSize)
+	{
+		// Check the read is inside of the device.
+		if (qwOffset > this->m_vData.size() || dwSize > this->m_vData.size() - qwOffset)
+			return false;
+
+		// Copy the data out.
+		memcpy(pBuffer, &this->m_vData[(SIZE_T)qwOffset], dwSize);
+		return true;
+	}
+
+	bool MemoryBlockDevice::WriteAt(ULONGLONG qwOffset, const void *pBuffer, DWORD dwSize)
+	{
+		// Grow the device if the write goes past the end of it.
+		if (qwOffset + dwSize > this->m_vData.size())
+			this->m_vData.resize((SIZE_T)(qwOffset + dwSize), 0);
+
+		// Copy the data in.
+		memcpy(&this->m_vData[(SIZE_T)qwOffset], pBuffer, dwSize);
+		return true;
+	}
+
+	ULONGLONG MemoryBlockDevice::Size()
+	{
+		// Return the size of the data buffer.
+		return this->m_vData.size();
+	}
+
+	PBYTE MemoryBlockDevice::Map()
+	{
+		// The device is already in memory.
+		return this->m_vData.data();
+	}
+};
\ No newline at end of file
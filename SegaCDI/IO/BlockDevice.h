@@ -0,0 +1,249 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	BlockDevice.h - Positional block device interface used for all image
+		and output file I/O.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include <vector>
+
+namespace IO
+{
+	// Forward declarations.
+	class AsyncReadQueue;
+
+	// Size of the buffer BlockDevice::CopyTo() copies through when the data can't be copied directly.
+	#define BLOCK_DEVICE_COPY_BUFFER_SIZE	0x100000
+
+	//-----------------------------------------------------
+	// Block Device Definitions
+	//-----------------------------------------------------
+	enum BlockDeviceAccess : int
+	{
+		ReadOnly,			// Open an existing file for reading
+		ReadWrite,			// Open an existing file for reading and writing
+		CreateAlways		// Create a new file or truncate an existing one, for reading and writing
+	};
+
+	enum BlockDeviceAccessHint : int
+	{
+		Normal,				// No particular access pattern
+		Sequential,			// Data will be read sequentially
+		Random,				// Data will be read in a random order
+		WillNeed			// Data will be needed soon and should be read ahead
+	};
+
+	struct BlockDeviceBuffer
+	{
+		PVOID pBuffer;		// Buffer to read data into
+		DWORD dwSize;		// Size of the buffer
+	};
+
+	//-----------------------------------------------------
+	// BlockDevice
+	//-----------------------------------------------------
+	class BlockDevice
+	{
+	public:
+		virtual ~BlockDevice() { }
+
+		/*
+			Description: Reads dwSize bytes from the device at offset qwOffset. This does not use or change any shared
+				file position so it is safe to call from multiple threads at once.
+
+			Parameters:
+				qwOffset: Offset to read from.
+				pBuffer: Buffer to read the data into.
+				dwSize: Number of bytes to read.
+
+			Returns: True if all of the data was read, false otherwise.
+		*/
+		virtual bool ReadAt(ULONGLONG qwOffset, PVOID pBuffer, DWORD dwSize) = 0;
+
+		/*
+			Description: Writes dwSize bytes to the device at offset qwOffset.
+
+			Parameters:
+				qwOffset: Offset to write to.
+				pBuffer: Buffer containing the data to write.
+				dwSize: Number of bytes to write.
+
+			Returns: True if all of the data was written, false otherwise.
+		*/
+		virtual bool WriteAt(ULONGLONG qwOffset, const void *pBuffer, DWORD dwSize) = 0;
+
+		/*
+			Description: Reads a contiguous range of the device starting at qwOffset into a list of buffers, filling
+				each buffer in order before moving on to the next one.
+
+			Parameters:
+				qwOffset: Offset to read from.
+				psBuffers: Array of buffers to read the data into.
+				dwBufferCount: Number of buffers in psBuffers.
+
+			Returns: True if all of the buffers were filled, false otherwise.
+		*/
+		virtual bool ReadAtVectored(ULONGLONG qwOffset, const BlockDeviceBuffer *psBuffers, DWORD dwBufferCount);
+
+		/*
+			Description: Copies a range of the device to another device. The default copy goes through a buffer using
+				ReadAt() and WriteAt(), devices that can have the data copied without it passing through user space
+				do that instead.
+
+			Parameters:
+				qwOffset: Offset to copy from.
+				pDestination: Device to copy the data to.
+				qwDestinationOffset: Offset to copy the data to in pDestination.
+				qwSize: Number of bytes to copy.
+
+			Returns: True if all of the data was copied, false otherwise.
+		*/
+		virtual bool CopyTo(ULONGLONG qwOffset, BlockDevice *pDestination, ULONGLONG qwDestinationOffset, ULONGLONG qwSize);
+
+		/*
+			Description: Gets the size of the device in bytes.
+		*/
+		virtual ULONGLONG Size() = 0;
+
+		/*
+			Description: Gets the last modification time of the device, in device specific units. Only useful for
+				checking if the contents of the device changed, devices that don't track it return 0.
+		*/
+		virtual ULONGLONG ModifiedTime() { return 0; }
+
+		/*
+			Description: Flushes any buffered writes to the underlying storage.
+		*/
+		virtual bool Flush() { return true; }
+
+		/*
+			Description: Gives the device a hint about how a range of data will be accessed. Devices that can't
+				make use of the hint ignore it.
+		*/
+		virtual void Advise(ULONGLONG /*qwOffset*/, ULONGLONG /*qwLength*/, BlockDeviceAccessHint /*eHint*/) { }
+
+		/*
+			Description: Maps the whole device into memory for reading.
+
+			Returns: The base address of the mapping, or nullptr if the device can't be mapped.
+		*/
+		virtual PBYTE Map() { return nullptr; }
+
+		/*
+			Description: Releases a mapping created by Map().
+		*/
+		virtual void Unmap() { }
+
+		/*
+			Description: Creates a queue for issuing asynchronous reads against the device. The default queue
+				services the reads with ReadAt() on a pool of threads.
+
+			Parameters:
+				dwQueueDepth: Maximum number of reads in flight at once.
+
+			Returns: A new read queue, which must be deleted before the device is.
+		*/
+		virtual AsyncReadQueue *CreateReadQueue(DWORD dwQueueDepth);
+	};
+
+	//-----------------------------------------------------
+	// FileBlockDevice
+	//-----------------------------------------------------
+	class FileBlockDevice : public BlockDevice
+	{
+	protected:
+#ifdef _WIN32
+		HANDLE		m_hFile;				// File handle
+		HANDLE		m_hFileMapping;			// File mapping object, when mapped
+#else
+		int			m_iFile;				// File descriptor
+#endif
+		PBYTE		m_pbMappedView;			// Base address of the mapped file or nullptr if not mapped
+		ULONGLONG	m_qwMappedSize;			// Size of the mapped view
+
+	public:
+		FileBlockDevice();
+		~FileBlockDevice();
+
+		/*
+			Description: Opens the file for block access.
+
+			Parameters:
+				psFileName: Path of the file to open.
+				eAccess: Access mode to open the file with.
+
+			Returns: True if the file was opened, false otherwise.
+		*/
+		bool Open(LPCSTR psFileName, BlockDeviceAccess eAccess);
+
+		/*
+			Description: Closes the file, releasing any mapping of it.
+		*/
+		void Close();
+
+		bool ReadAt(ULONGLONG qwOffset, PVOID pBuffer, DWORD dwSize);
+		bool WriteAt(ULONGLONG qwOffset, const void *pBuffer, DWORD dwSize);
+		bool ReadAtVectored(ULONGLONG qwOffset, const BlockDeviceBuffer *psBuffers, DWORD dwBufferCount);
+		ULONGLONG Size();
+		ULONGLONG ModifiedTime();
+		bool Flush();
+		void Advise(ULONGLONG qwOffset, ULONGLONG qwLength, BlockDeviceAccessHint eHint);
+		PBYTE Map();
+		void Unmap();
+#ifndef _WIN32
+		AsyncReadQueue *CreateReadQueue(DWORD dwQueueDepth);
+		bool CopyTo(ULONGLONG qwOffset, BlockDevice *pDestination, ULONGLONG qwDestinationOffset, ULONGLONG qwSize);
+
+		/*
+			Description: Gets the file descriptor for the file.
+		*/
+		int Descriptor() { return this->m_iFile; }
+#endif
+	};
+
+	//-----------------------------------------------------
+	// MemoryBlockDevice
+	//-----------------------------------------------------
+	class MemoryBlockDevice : public BlockDevice
+	{
+	protected:
+		std::vector<BYTE>	m_vData;		// Contents of the device
+
+	public:
+		/*
+			Description: Creates an empty memory device, writes past the end of the device grow it.
+		*/
+		MemoryBlockDevice();
+
+		/*
+			Description: Creates a memory device initialized with a copy of pbData.
+		*/
+		MemoryBlockDevice(const BYTE *pbData, SIZE_T dwSize);
+
+		bool ReadAt(ULONGLONG qwOffset, PVOID pBuffer, DWORD dwSize);
+		bool WriteAt(ULONGLONG qwOffset, const void *pBuffer, DWORD dwSize);
+		ULONGLONG Size();
+		PBYTE Map();
+
+		/*
+			Description: Gets a pointer to the contents of the device.
+		*/
+		PBYTE Data() { return this->m_vData.data(); }
+	};
+
+	/*
+		Description: Opens a file as a block device.
+
+		Parameters:
+			psFileName: Path of the file to open.
+			eAccess: Access mode to open the file with.
+
+		Returns: A new FileBlockDevice for the file, or nullptr if the file could not be opened.
+	*/
+	BlockDevice *OpenFileDevice(LPCSTR psFileName, BlockDeviceAccess eAccess);
+};
\ No newline at end of file
@@ -0,0 +1,586 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	Digest.cpp - CRC32, MD5 and SHA-1 digests used to check images against
+		reference DAT files.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "Digest.h"
+
+// The carry-less multiplication CRC32 is only built for x86 and x64, everything else uses the slice-by-8 tables.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DIGEST_CRC32_CLMUL
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define DIGEST_TARGET_CLMUL
+#else
+#include <cpuid.h>
+#define DIGEST_TARGET_CLMUL		__attribute__((target("pclmul,sse4.1")))
+#endif
+#endif
+
+namespace IO
+{
+	// Reversed CRC32 polynomial, x^32 + x^26 + x^23 + x^22 + x^16 + x^12 + x^11 + x^10 + x^8 + x^7 + x^5 + x^4 + x^2 + x + 1.
+	#define CRC32_POLYNOMIAL		0xEDB88320
+
+	// Smallest run of data handed to the carry-less multiplication CRC32, it folds 64 bytes at a time.
+	#define CRC32_CLMUL_MIN_SIZE	64
+
+	/*
+		Lookup tables for the CRC32 routine and the processor features it can use, set up once when the program starts.
+	*/
+	static struct Crc32Tables
+	{
+		DWORD dwCrc[8][256];		// Slice-by-8 CRC32 tables, dwCrc[0] is the regular byte at a time table
+		bool bClmul;				// True if the processor supports PCLMULQDQ and SSE4.1
+
+		Crc32Tables()
+		{
+			// Build the byte at a time table.
+			for (DWORD i = 0; i < 256; i++)
+			{
+				DWORD dwCrcValue = i;
+				for (int x = 0; x < 8; x++)
+					dwCrcValue = (dwCrcValue >> 1) ^ ((dwCrcValue & 1) != 0 ? CRC32_POLYNOMIAL : 0);
+				this->dwCrc[0][i] = dwCrcValue;
+			}
+
+			// Each slice table advances the CRC over one more zero byte.
+			for (int x = 1; x < 8; x++)
+			{
+				for (DWORD i = 0; i < 256; i++)
+					this->dwCrc[x][i] = (this->dwCrc[x - 1][i] >> 8) ^ this->dwCrc[0][this->dwCrc[x - 1][i] & 0xFF];
+			}
+
+			// Check for PCLMULQDQ (ecx bit 1) and SSE4.1 (ecx bit 19).
+			this->bClmul = false;
+#if defined(DIGEST_CRC32_CLMUL) && defined(_MSC_VER)
+			int iCpuInfo[4];
+			__cpuid(iCpuInfo, 1);
+			this->bClmul = ((iCpuInfo[2] & (1 << 1)) != 0 && (iCpuInfo[2] & (1 << 19)) != 0);
+#elif defined(DIGEST_CRC32_CLMUL)
+			unsigned int uEax, uEbx, uEcx, uEdx;
+			if (__get_cpuid(1, &uEax, &uEbx, &uEcx, &uEdx) != 0)
+				this->bClmul = ((uEcx & (1 << 1)) != 0 && (uEcx & (1 << 19)) != 0);
+#endif
+		}
+	} g_sCrc32Tables;
+
+	/*
+		Description: Updates an inverted CRC32 with the slice-by-8 tables.
+	*/
+	static DWORD Crc32UpdateTables(DWORD dwCrc, const BYTE *pbData, DWORD dwSize)
+	{
+		// Process 8 bytes at a time using the slice tables.
+		while (dwSize >= 8)
+		{
+			DWORD dwLow, dwHigh;
+			memcpy(&dwLow, pbData, sizeof(DWORD));
+			memcpy(&dwHigh, pbData + 4, sizeof(DWORD));
+			dwLow ^= dwCrc;
+
+			dwCrc = g_sCrc32Tables.dwCrc[7][dwLow & 0xFF] ^ g_sCrc32Tables.dwCrc[6][(dwLow >> 8) & 0xFF] ^
+				g_sCrc32Tables.dwCrc[5][(dwLow >> 16) & 0xFF] ^ g_sCrc32Tables.dwCrc[4][dwLow >> 24] ^
+				g_sCrc32Tables.dwCrc[3][dwHigh & 0xFF] ^ g_sCrc32Tables.dwCrc[2][(dwHigh >> 8) & 0xFF] ^
+				g_sCrc32Tables.dwCrc[1][(dwHigh >> 16) & 0xFF] ^ g_sCrc32Tables.dwCrc[0][dwHigh >> 24];
+
+			pbData += 8;
+			dwSize -= 8;
+		}
+
+		// Process any remaining bytes one at a time.
+		while (dwSize-- > 0)
+			dwCrc = (dwCrc >> 8) ^ g_sCrc32Tables.dwCrc[0][(dwCrc ^ *pbData++) & 0xFF];
+
+		return dwCrc;
+	}
+
+#ifdef DIGEST_CRC32_CLMUL
+	/*
+		Description: Updates an inverted CRC32 by folding the data with carry-less multiplication, see "Fast CRC
+			Computation for Generic Polynomials Using PCLMULQDQ Instruction" (Gopal et al, Intel 2009). The folding
+			constants are x^n mod P in the bit reflected domain, followed by the Barrett reduction constants.
+
+		Parameters:
+			dwSize: Size of the data, at least CRC32_CLMUL_MIN_SIZE bytes and a multiple of 16.
+	*/
+	DIGEST_TARGET_CLMUL static DWORD Crc32UpdateClmul(DWORD dwCrc, const BYTE *pbData, DWORD dwSize)
+	{
+		static const ULONGLONG qwK1K2[2] = { 0x0154442bd4, 0x01c6e41596 };		// x^(4*128+32) and x^(4*128-32) mod P
+		static const ULONGLONG qwK3K4[2] = { 0x01751997d0, 0x00ccaa009e };		// x^(128+32) and x^(128-32) mod P
+		static const ULONGLONG qwK5K0[2] = { 0x0163cd6124, 0x0000000000 };		// x^64 mod P
+		static const ULONGLONG qwPoly[2] = { 0x01db710641, 0x01f7011641 };		// P and floor(x^64 / P)
+
+		__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+		// Load the first 64 bytes and mix in the CRC so far.
+		x1 = _mm_loadu_si128((const __m128i*)(pbData + 0x00));
+		x2 = _mm_loadu_si128((const __m128i*)(pbData + 0x10));
+		x3 = _mm_loadu_si128((const __m128i*)(pbData + 0x20));
+		x4 = _mm_loadu_si128((const __m128i*)(pbData + 0x30));
+		x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)dwCrc));
+		pbData += 64;
+		dwSize -= 64;
+
+		// Fold the 4 lanes forward over the next 64 bytes until there are less than 64 left.
+		x0 = _mm_loadu_si128((const __m128i*)qwK1K2);
+		while (dwSize >= 64)
+		{
+			x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+			x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+			x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+			x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+			x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+			x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+			x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+			x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(pbData + 0x00)));
+			x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(pbData + 0x10)));
+			x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(pbData + 0x20)));
+			x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(pbData + 0x30)));
+
+			pbData += 64;
+			dwSize -= 64;
+		}
+
+		// Fold the 4 lanes into one.
+		x0 = _mm_loadu_si128((const __m128i*)qwK3K4);
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+		// Fold the remaining 16 byte blocks in one at a time.
+		while (dwSize >= 16)
+		{
+			x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+			x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)pbData)), x5);
+
+			pbData += 16;
+			dwSize -= 16;
+		}
+
+		// Fold 128 bits down to 64.
+		x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+		x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+		x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+		x0 = _mm_loadl_epi64((const __m128i*)qwK5K0);
+		x2 = _mm_srli_si128(x1, 4);
+		x1 = _mm_and_si128(x1, x3);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+
+		// Barrett reduce to 32 bits.
+		x0 = _mm_loadu_si128((const __m128i*)qwPoly);
+		x2 = _mm_and_si128(x1, x3);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+		x2 = _mm_and_si128(x2, x3);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+
+		return (DWORD)_mm_extract_epi32(x1, 1);
+	}
+#endif
+
+	DWORD Crc32Update(DWORD dwCrc, const BYTE *pbData, DWORD dwSize)
+	{
+		dwCrc = ~dwCrc;
+
+#ifdef DIGEST_CRC32_CLMUL
+		// Fold as many 16 byte blocks as we can, the tables pick up the rest.
+		if (g_sCrc32Tables.bClmul == true && dwSize >= CRC32_CLMUL_MIN_SIZE)
+		{
+			DWORD dwFoldSize = dwSize & ~15;
+			dwCrc = Crc32UpdateClmul(dwCrc, pbData, dwFoldSize);
+			pbData += dwFoldSize;
+			dwSize -= dwFoldSize;
+		}
+#endif
+
+		return ~Crc32UpdateTables(dwCrc, pbData, dwSize);
+	}
+
+	bool Crc32IsAccelerated()
+	{
+		return g_sCrc32Tables.bClmul;
+	}
+
+	void FormatDigest(const BYTE *pbDigest, DWORD dwSize, CHAR *psOutput)
+	{
+		static const CHAR sHexDigits[] = "0123456789abcdef";
+
+		for (DWORD i = 0; i < dwSize; i++)
+		{
+			psOutput[i * 2] = sHexDigits[pbDigest[i] >> 4];
+			psOutput[i * 2 + 1] = sHexDigits[pbDigest[i] & 15];
+		}
+		psOutput[dwSize * 2] = 0;
+	}
+
+	bool ParseDigest(LPCSTR psInput, DWORD dwLength, PBYTE pbDigest, DWORD dwSize)
+	{
+		if (dwLength != dwSize * 2)
+			return false;
+
+		for (DWORD i = 0; i < dwLength; i++)
+		{
+			CHAR c = psInput[i];
+			BYTE bNibble;
+			if (c >= '0' && c <= '9')
+				bNibble = (BYTE)(c - '0');
+			else if (c >= 'a' && c <= 'f')
+				bNibble = (BYTE)(c - 'a' + 10);
+			else if (c >= 'A' && c <= 'F')
+				bNibble = (BYTE)(c - 'A' + 10);
+			else
+				return false;
+
+			if ((i & 1) == 0)
+				pbDigest[i / 2] = (BYTE)(bNibble << 4);
+			else
+				pbDigest[i / 2] |= bNibble;
+		}
+
+		return true;
+	}
+
+	/*
+		Description: Rotates a 32 bit value left.
+	*/
+	static inline DWORD RotateLeft(DWORD dwValue, int iCount)
+	{
+		return (dwValue << iCount) | (dwValue >> (32 - iCount));
+	}
+
+	/*
+		Description: Reads a 32 bit big endian value that may not be aligned.
+	*/
+	static inline DWORD ReadBigEndian32(const BYTE *pbData)
+	{
+		return ((DWORD)pbData[0] << 24) | ((DWORD)pbData[1] << 16) | ((DWORD)pbData[2] << 8) | (DWORD)pbData[3];
+	}
+
+	/*
+		Compression function of a digest, runs over dwBlockCount whole blocks.
+	*/
+	typedef void (*DigestTransform)(DWORD *pdwState, const BYTE *pbData, DWORD dwBlockCount);
+
+	/*
+		Description: Adds data to a digest that processes DIGEST_BLOCK_SIZE byte blocks, buffering partial blocks.
+
+		Parameters:
+			pfnTransform: Compression function of the digest.
+			pdwState: Chaining values of the digest.
+			pbBuffer: Partial block of the digest.
+			pqwLength: Number of bytes added to the digest so far.
+	*/
+	static void UpdateBlocks(DigestTransform pfnTransform, DWORD *pdwState, PBYTE pbBuffer, ULONGLONG *pqwLength, const BYTE *pbData, DWORD dwSize)
+	{
+		DWORD dwBuffered = (DWORD)(*pqwLength % DIGEST_BLOCK_SIZE);
+		*pqwLength += dwSize;
+
+		// Top up the partial block first.
+		if (dwBuffered != 0)
+		{
+			DWORD dwFill = DIGEST_BLOCK_SIZE - dwBuffered;
+			if (dwSize < dwFill)
+			{
+				memcpy(&pbBuffer[dwBuffered], pbData, dwSize);
+				return;
+			}
+
+			memcpy(&pbBuffer[dwBuffered], pbData, dwFill);
+			pfnTransform(pdwState, pbBuffer, 1);
+			pbData += dwFill;
+			dwSize -= dwFill;
+		}
+
+		// Process whole blocks straight from the data and buffer what is left.
+		if (dwSize >= DIGEST_BLOCK_SIZE)
+		{
+			pfnTransform(pdwState, pbData, dwSize / DIGEST_BLOCK_SIZE);
+			pbData += dwSize - (dwSize % DIGEST_BLOCK_SIZE);
+			dwSize %= DIGEST_BLOCK_SIZE;
+		}
+		if (dwSize != 0)
+			memcpy(pbBuffer, pbData, dwSize);
+	}
+
+	/*
+		Description: Gets the number of padding bytes to add so the data ends 8 bytes short of a block boundary,
+			leaving room for the length. There is always at least one byte of padding.
+	*/
+	static DWORD PaddingSize(ULONGLONG qwLength)
+	{
+		DWORD dwBuffered = (DWORD)(qwLength % DIGEST_BLOCK_SIZE);
+		return (dwBuffered < DIGEST_BLOCK_SIZE - 8 ? DIGEST_BLOCK_SIZE - 8 - dwBuffered : (DIGEST_BLOCK_SIZE * 2) - 8 - dwBuffered);
+	}
+
+	// Padding added to the end of the data, a single 1 bit followed by zeros.
+	static const BYTE g_bPadding[DIGEST_BLOCK_SIZE] = { 0x80 };
+
+	//-----------------------------------------------------
+	// Md5
+	//-----------------------------------------------------
+
+	// Round functions and a single step of the MD5 compression function.
+	#define MD5_F(x, y, z)		((z) ^ ((x) & ((y) ^ (z))))
+	#define MD5_G(x, y, z)		((y) ^ ((z) & ((x) ^ (y))))
+	#define MD5_H(x, y, z)		((x) ^ (y) ^ (z))
+	#define MD5_I(x, y, z)		((y) ^ ((x) | ~(z)))
+	#define MD5_STEP(f, a, b, c, d, x, t, s)	(a) += f((b), (c), (d)) + (x) + (t); (a) = RotateLeft((a), (s)) + (b);
+
+	Md5::Md5()
+	{
+		Reset();
+	}
+
+	void Md5::Reset()
+	{
+		this->m_dwState[0] = 0x67452301;
+		this->m_dwState[1] = 0xefcdab89;
+		this->m_dwState[2] = 0x98badcfe;
+		this->m_dwState[3] = 0x10325476;
+		this->m_qwLength = 0;
+	}
+
+	/*
+		Description: MD5 compression function.
+	*/
+	static void Md5Transform(DWORD *pdwState, const BYTE *pbData, DWORD dwBlockCount)
+	{
+		DWORD a = pdwState[0];
+		DWORD b = pdwState[1];
+		DWORD c = pdwState[2];
+		DWORD d = pdwState[3];
+
+		for (; dwBlockCount > 0; dwBlockCount--, pbData += DIGEST_BLOCK_SIZE)
+		{
+			// MD5 reads the block as little endian words.
+			DWORD x[16];
+			memcpy(x, pbData, sizeof(x));
+
+			DWORD aa = a, bb = b, cc = c, dd = d;
+
+			MD5_STEP(MD5_F, a, b, c, d, x[0], 0xd76aa478, 7);
+			MD5_STEP(MD5_F, d, a, b, c, x[1], 0xe8c7b756, 12);
+			MD5_STEP(MD5_F, c, d, a, b, x[2], 0x242070db, 17);
+			MD5_STEP(MD5_F, b, c, d, a, x[3], 0xc1bdceee, 22);
+			MD5_STEP(MD5_F, a, b, c, d, x[4], 0xf57c0faf, 7);
+			MD5_STEP(MD5_F, d, a, b, c, x[5], 0x4787c62a, 12);
+			MD5_STEP(MD5_F, c, d, a, b, x[6], 0xa8304613, 17);
+			MD5_STEP(MD5_F, b, c, d, a, x[7], 0xfd469501, 22);
+			MD5_STEP(MD5_F, a, b, c, d, x[8], 0x698098d8, 7);
+			MD5_STEP(MD5_F, d, a, b, c, x[9], 0x8b44f7af, 12);
+			MD5_STEP(MD5_F, c, d, a, b, x[10], 0xffff5bb1, 17);
+			MD5_STEP(MD5_F, b, c, d, a, x[11], 0x895cd7be, 22);
+			MD5_STEP(MD5_F, a, b, c, d, x[12], 0x6b901122, 7);
+			MD5_STEP(MD5_F, d, a, b, c, x[13], 0xfd987193, 12);
+			MD5_STEP(MD5_F, c, d, a, b, x[14], 0xa679438e, 17);
+			MD5_STEP(MD5_F, b, c, d, a, x[15], 0x49b40821, 22);
+
+			MD5_STEP(MD5_G, a, b, c, d, x[1], 0xf61e2562, 5);
+			MD5_STEP(MD5_G, d, a, b, c, x[6], 0xc040b340, 9);
+			MD5_STEP(MD5_G, c, d, a, b, x[11], 0x265e5a51, 14);
+			MD5_STEP(MD5_G, b, c, d, a, x[0], 0xe9b6c7aa, 20);
+			MD5_STEP(MD5_G, a, b, c, d, x[5], 0xd62f105d, 5);
+			MD5_STEP(MD5_G, d, a, b, c, x[10], 0x02441453, 9);
+			MD5_STEP(MD5_G, c, d, a, b, x[15], 0xd8a1e681, 14);
+			MD5_STEP(MD5_G, b, c, d, a, x[4], 0xe7d3fbc8, 20);
+			MD5_STEP(MD5_G, a, b, c, d, x[9], 0x21e1cde6, 5);
+			MD5_STEP(MD5_G, d, a, b, c, x[14], 0xc33707d6, 9);
+			MD5_STEP(MD5_G, c, d, a, b, x[3], 0xf4d50d87, 14);
+			MD5_STEP(MD5_G, b, c, d, a, x[8], 0x455a14ed, 20);
+			MD5_STEP(MD5_G, a, b, c, d, x[13], 0xa9e3e905, 5);
+			MD5_STEP(MD5_G, d, a, b, c, x[2], 0xfcefa3f8, 9);
+			MD5_STEP(MD5_G, c, d, a, b, x[7], 0x676f02d9, 14);
+			MD5_STEP(MD5_G, b, c, d, a, x[12], 0x8d2a4c8a, 20);
+
+			MD5_STEP(MD5_H, a, b, c, d, x[5], 0xfffa3942, 4);
+			MD5_STEP(MD5_H, d, a, b, c, x[8], 0x8771f681, 11);
+			MD5_STEP(MD5_H, c, d, a, b, x[11], 0x6d9d6122, 16);
+			MD5_STEP(MD5_H, b, c, d, a, x[14], 0xfde5380c, 23);
+			MD5_STEP(MD5_H, a, b, c, d, x[1], 0xa4beea44, 4);
+			MD5_STEP(MD5_H, d, a, b, c, x[4], 0x4bdecfa9, 11);
+			MD5_STEP(MD5_H, c, d, a, b, x[7], 0xf6bb4b60, 16);
+			MD5_STEP(MD5_H, b, c, d, a, x[10], 0xbebfbc70, 23);
+			MD5_STEP(MD5_H, a, b, c, d, x[13], 0x289b7ec6, 4);
+			MD5_STEP(MD5_H, d, a, b, c, x[0], 0xeaa127fa, 11);
+			MD5_STEP(MD5_H, c, d, a, b, x[3], 0xd4ef3085, 16);
+			MD5_STEP(MD5_H, b, c, d, a, x[6], 0x04881d05, 23);
+			MD5_STEP(MD5_H, a, b, c, d, x[9], 0xd9d4d039, 4);
+			MD5_STEP(MD5_H, d, a, b, c, x[12], 0xe6db99e5, 11);
+			MD5_STEP(MD5_H, c, d, a, b, x[15], 0x1fa27cf8, 16);
+			MD5_STEP(MD5_H, b, c, d, a, x[2], 0xc4ac5665, 23);
+
+			MD5_STEP(MD5_I, a, b, c, d, x[0], 0xf4292244, 6);
+			MD5_STEP(MD5_I, d, a, b, c, x[7], 0x432aff97, 10);
+			MD5_STEP(MD5_I, c, d, a, b, x[14], 0xab9423a7, 15);
+			MD5_STEP(MD5_I, b, c, d, a, x[5], 0xfc93a039, 21);
+			MD5_STEP(MD5_I, a, b, c, d, x[12], 0x655b59c3, 6);
+			MD5_STEP(MD5_I, d, a, b, c, x[3], 0x8f0ccc92, 10);
+			MD5_STEP(MD5_I, c, d, a, b, x[10], 0xffeff47d, 15);
+			MD5_STEP(MD5_I, b, c, d, a, x[1], 0x85845dd1, 21);
+			MD5_STEP(MD5_I, a, b, c, d, x[8], 0x6fa87e4f, 6);
+			MD5_STEP(MD5_I, d, a, b, c, x[15], 0xfe2ce6e0, 10);
+			MD5_STEP(MD5_I, c, d, a, b, x[6], 0xa3014314, 15);
+			MD5_STEP(MD5_I, b, c, d, a, x[13], 0x4e0811a1, 21);
+			MD5_STEP(MD5_I, a, b, c, d, x[4], 0xf7537e82, 6);
+			MD5_STEP(MD5_I, d, a, b, c, x[11], 0xbd3af235, 10);
+			MD5_STEP(MD5_I, c, d, a, b, x[2], 0x2ad7d2bb, 15);
+			MD5_STEP(MD5_I, b, c, d, a, x[9], 0xeb86d391, 21);
+
+			a += aa;
+			b += bb;
+			c += cc;
+			d += dd;
+		}
+
+		pdwState[0] = a;
+		pdwState[1] = b;
+		pdwState[2] = c;
+		pdwState[3] = d;
+	}
+
+	void Md5::Update(const BYTE *pbData, DWORD dwSize)
+	{
+		UpdateBlocks(Md5Transform, this->m_dwState, this->m_bBuffer, &this->m_qwLength, pbData, dwSize);
+	}
+
+	void Md5::Final(PBYTE pbDigest)
+	{
+		// Pad the data and append the length in bits as a little endian value.
+		ULONGLONG qwBitLength = this->m_qwLength * 8;
+		BYTE bLength[8];
+		for (int i = 0; i < 8; i++)
+			bLength[i] = (BYTE)(qwBitLength >> (i * 8));
+
+		Update(g_bPadding, PaddingSize(this->m_qwLength));
+		Update(bLength, sizeof(bLength));
+
+		memcpy(pbDigest, this->m_dwState, MD5_DIGEST_SIZE);
+	}
+
+	//-----------------------------------------------------
+	// Sha1
+	//-----------------------------------------------------
+
+	// Round functions of the SHA-1 compression function.
+	#define SHA1_CH(x, y, z)		((z) ^ ((x) & ((y) ^ (z))))
+	#define SHA1_PARITY(x, y, z)	((x) ^ (y) ^ (z))
+	#define SHA1_MAJ(x, y, z)		(((x) & (y)) | ((z) & ((x) | (y))))
+
+	Sha1::Sha1()
+	{
+		Reset();
+	}
+
+	void Sha1::Reset()
+	{
+		this->m_dwState[0] = 0x67452301;
+		this->m_dwState[1] = 0xefcdab89;
+		this->m_dwState[2] = 0x98badcfe;
+		this->m_dwState[3] = 0x10325476;
+		this->m_dwState[4] = 0xc3d2e1f0;
+		this->m_qwLength = 0;
+	}
+
+	/*
+		Description: SHA-1 compression function.
+	*/
+	static void Sha1Transform(DWORD *pdwState, const BYTE *pbData, DWORD dwBlockCount)
+	{
+		DWORD a = pdwState[0];
+		DWORD b = pdwState[1];
+		DWORD c = pdwState[2];
+		DWORD d = pdwState[3];
+		DWORD e = pdwState[4];
+
+		for (; dwBlockCount > 0; dwBlockCount--, pbData += DIGEST_BLOCK_SIZE)
+		{
+			// The message schedule is kept as a rolling window of the last 16 words.
+			DWORD w[16];
+			for (int i = 0; i < 16; i++)
+				w[i] = ReadBigEndian32(&pbData[i * 4]);
+
+			DWORD aa = a, bb = b, cc = c, dd = d, ee = e;
+			for (int i = 0; i < 80; i++)
+			{
+				if (i >= 16)
+					w[i & 15] = RotateLeft(w[(i - 3) & 15] ^ w[(i - 8) & 15] ^ w[(i - 14) & 15] ^ w[i & 15], 1);
+
+				DWORD dwF;
+				if (i < 20)
+					dwF = SHA1_CH(b, c, d) + 0x5a827999;
+				else if (i < 40)
+					dwF = SHA1_PARITY(b, c, d) + 0x6ed9eba1;
+				else if (i < 60)
+					dwF = SHA1_MAJ(b, c, d) + 0x8f1bbcdc;
+				else
+					dwF = SHA1_PARITY(b, c, d) + 0xca62c1d6;
+
+				DWORD dwTemp = RotateLeft(a, 5) + dwF + e + w[i & 15];
+				e = d;
+				d = c;
+				c = RotateLeft(b, 30);
+				b = a;
+				a = dwTemp;
+			}
+
+			a += aa;
+			b += bb;
+			c += cc;
+			d += dd;
+			e += ee;
+		}
+
+		pdwState[0] = a;
+		pdwState[1] = b;
+		pdwState[2] = c;
+		pdwState[3] = d;
+		pdwState[4] = e;
+	}
+
+	void Sha1::Update(const BYTE *pbData, DWORD dwSize)
+	{
+		UpdateBlocks(Sha1Transform, this->m_dwState, this->m_bBuffer, &this->m_qwLength, pbData, dwSize);
+	}
+
+	void Sha1::Final(PBYTE pbDigest)
+	{
+		// Pad the data and append the length in bits as a big endian value.
+		ULONGLONG qwBitLength = this->m_qwLength * 8;
+		BYTE bLength[8];
+		for (int i = 0; i < 8; i++)
+			bLength[i] = (BYTE)(qwBitLength >> ((7 - i) * 8));
+
+		Update(g_bPadding, PaddingSize(this->m_qwLength));
+		Update(bLength, sizeof(bLength));
+
+		// The digest is the state written out as big endian words.
+		for (int i = 0; i < 5; i++)
+		{
+			pbDigest[i * 4] = (BYTE)(this->m_dwState[i] >> 24);
+			pbDigest[i * 4 + 1] = (BYTE)(this->m_dwState[i] >> 16);
+			pbDigest[i * 4 + 2] = (BYTE)(this->m_dwState[i] >> 8);
+			pbDigest[i * 4 + 3] = (BYTE)this->m_dwState[i];
+		}
+	}
+};
\ No newline at end of file
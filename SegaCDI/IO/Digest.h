@@ -0,0 +1,151 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	Digest.h - CRC32, MD5 and SHA-1 digests used to check images against
+		reference DAT files.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+
+namespace IO
+{
+	// Size of each digest in bytes.
+	#define MD5_DIGEST_SIZE			16
+	#define SHA1_DIGEST_SIZE		20
+
+	// Size of the blocks MD5 and SHA-1 process at a time.
+	#define DIGEST_BLOCK_SIZE		64
+
+	/*
+		Digests a DigestSet can hold.
+	*/
+	enum DigestType : DWORD
+	{
+		DigestNone		= 0,
+		DigestCrc32		= 1,
+		DigestMd5		= 2,
+		DigestSha1		= 4,
+		DigestAll		= DigestCrc32 | DigestMd5 | DigestSha1
+	};
+
+	/*
+		Size and digests of a stream of data.
+	*/
+	struct DigestSet
+	{
+		DWORD dwTypes;					// Combination of DigestType flags for the digests that are set
+		ULONGLONG qwSize;				// Size of the data
+		DWORD dwCrc32;					// CRC32 of the data
+		BYTE bMd5[MD5_DIGEST_SIZE];		// MD5 of the data
+		BYTE bSha1[SHA1_DIGEST_SIZE];	// SHA-1 of the data
+	};
+
+	/*
+		Description: Updates a CRC32 (the zlib/PKZIP polynomial) with more data. Uses carry-less multiplication to
+			fold 64 bytes at a time when the processor supports it, and slice-by-8 tables otherwise.
+
+		Parameters:
+			dwCrc: CRC32 of the data so far, 0 to start a new CRC.
+			pbData: Data to add.
+			dwSize: Size of the data.
+
+		Returns: The CRC32 of the data so far followed by pbData.
+	*/
+	DWORD Crc32Update(DWORD dwCrc, const BYTE *pbData, DWORD dwSize);
+
+	/*
+		Description: Gets a boolean indicating if Crc32Update() uses carry-less multiplication on this processor.
+	*/
+	bool Crc32IsAccelerated();
+
+	/*
+		Description: Formats a digest as lower case hex.
+
+		Parameters:
+			pbDigest: Digest to format.
+			dwSize: Size of the digest.
+			psOutput: Buffer that receives the string, must be at least dwSize * 2 + 1 characters.
+	*/
+	void FormatDigest(const BYTE *pbDigest, DWORD dwSize, CHAR *psOutput);
+
+	/*
+		Description: Parses a digest from hex, upper or lower case.
+
+		Parameters:
+			psInput: String to parse.
+			dwLength: Length of the string.
+			pbDigest: Buffer that receives the digest.
+			dwSize: Size of the digest.
+
+		Returns: True if the string is exactly dwSize * 2 hex digits, false otherwise.
+	*/
+	bool ParseDigest(LPCSTR psInput, DWORD dwLength, PBYTE pbDigest, DWORD dwSize);
+
+	//-----------------------------------------------------
+	// Md5
+	//-----------------------------------------------------
+	class Md5
+	{
+	protected:
+		DWORD		m_dwState[4];					// Chaining values
+		ULONGLONG	m_qwLength;						// Number of bytes added so far
+		BYTE		m_bBuffer[DIGEST_BLOCK_SIZE];	// Partial block waiting for more data
+
+	public:
+		Md5();
+
+		/*
+			Description: Resets the digest to start over.
+		*/
+		void Reset();
+
+		/*
+			Description: Adds dwSize bytes of data to the digest.
+		*/
+		void Update(const BYTE *pbData, DWORD dwSize);
+
+		/*
+			Description: Pads the data and writes out the digest. The digest has to be reset before it is used again.
+
+			Parameters:
+				pbDigest: Buffer that receives MD5_DIGEST_SIZE bytes.
+		*/
+		void Final(PBYTE pbDigest);
+	};
+
+	//-----------------------------------------------------
+	// Sha1
+	//-----------------------------------------------------
+	class Sha1
+	{
+	protected:
+		DWORD		m_dwState[5];					// Chaining values
+		ULONGLONG	m_qwLength;						// Number of bytes added so far
+		BYTE		m_bBuffer[DIGEST_BLOCK_SIZE];	// Partial block waiting for more data
+
+	public:
+		Sha1();
+
+		/*
+			Description: Resets the digest to start over.
+		*/
+		void Reset();
+
+		/*
+			Description: Adds dwSize bytes of data to the digest.
+		*/
+		void Update(const BYTE *pbData, DWORD dwSize);
+
+		/*
+			Description: Pads the data and writes out the digest. The digest has to be reset before it is used again.
+
+			Parameters:
+				pbDigest: Buffer that receives SHA1_DIGEST_SIZE bytes.
+		*/
+		void Final(PBYTE pbDigest);
+	};
+};
\ No newline at end of file
@@ -0,0 +1,297 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	FileBlockDevicePosix.cpp - POSIX file block device using pread/pwrite.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "BlockDevice.h"
+#include "AsyncReadQueue.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+namespace IO
+{
+	FileBlockDevice::FileBlockDevice()
+	{
+		// Initialize fields.
+		this->m_iFile = -1;
+		this->m_pbMappedView = nullptr;
+		this->m_qwMappedSize = 0;
+	}
+
+	FileBlockDevice::~FileBlockDevice()
+	{
+		// Close the file if it is still open.
+		Close();
+	}
+
+	bool FileBlockDevice::Open(LPCSTR psFileName, BlockDeviceAccess eAccess)
+	{
+		// Translate the access mode into open flags.
+		int iFlags = O_RDONLY;
+		if (eAccess == BlockDeviceAccess::ReadWrite)
+			iFlags = O_RDWR;
+		else if (eAccess == BlockDeviceAccess::CreateAlways)
+			iFlags = O_RDWR | O_CREAT | O_TRUNC;
+
+		// Open the file.
+		this->m_iFile = open(psFileName, iFlags | O_CLOEXEC, 0644);
+		return this->m_iFile != -1;
+	}
+
+	void FileBlockDevice::Close()
+	{
+		// Release the mapping if there is one.
+		Unmap();
+
+		// Close the file descriptor.
+		if (this->m_iFile != -1)
+		{
+			close(this->m_iFile);
+			this->m_iFile = -1;
+		}
+	}
+
+	bool FileBlockDevice::ReadAt(ULONGLONG qwOffset, PVOID pBuffer, DWORD dwSize)
+	{
+		// Loop until all of the data has been read, pread can return short counts.
+		PBYTE pbBuffer = (PBYTE)pBuffer;
+		while (dwSize > 0)
+		{
+			// Read the next block of data.
+			ssize_t iBytesRead = pread(this->m_iFile, pbBuffer, dwSize, (off_t)qwOffset);
+			if (iBytesRead < 0 && errno == EINTR)
+				continue;
+			if (iBytesRead <= 0)
+				return false;
+
+			// Next block.
+			pbBuffer += iBytesRead;
+			qwOffset += iBytesRead;
+			dwSize -= (DWORD)iBytesRead;
+		}
+
+		// Successfully read all of the data.
+		return true;
+	}
+
+	bool FileBlockDevice::WriteAt(ULONGLONG qwOffset, const void *pBuffer, DWORD dwSize)
+	{
+		// Loop until all of the data has been written, pwrite can return short counts.
+		const BYTE *pbBuffer = (const BYTE*)pBuffer;
+		while (dwSize > 0)
+		{
+			// Write the next block of data.
+			ssize_t iBytesWritten = pwrite(this->m_iFile, pbBuffer, dwSize, (off_t)qwOffset);
+			if (iBytesWritten < 0 && errno == EINTR)
+				continue;
+			if (iBytesWritten <= 0)
+				return false;
+
+			// Next block.
+			pbBuffer += iBytesWritten;
+			qwOffset += iBytesWritten;
+			dwSize -= (DWORD)iBytesWritten;
+		}
+
+		// Successfully wrote all of the data.
+		return true;
+	}
+
+	bool FileBlockDevice::ReadAtVectored(ULONGLONG qwOffset, const BlockDeviceBuffer *psBuffers, DWORD dwBufferCount)
+	{
+		struct iovec sVectors[64];
+
+		// Loop and submit the buffers in batches that fit in our iovec array.
+		while (dwBufferCount > 0)
+		{
+			// Build the iovec array for this batch.
+			DWORD dwBatchCount = (dwBufferCount < 64 ? dwBufferCount : 64);
+			ssize_t iBatchSize = 0;
+			for (DWORD i = 0; i < dwBatchCount; i++)
+			{
+				sVectors[i].iov_base = psBuffers[i].pBuffer;
+				sVectors[i].iov_len = psBuffers[i].dwSize;
+				iBatchSize += psBuffers[i].dwSize;
+			}
+
+			// Read the batch, falling back to reading each buffer on its own if we get a short read.
+			ssize_t iBytesRead = preadv(this->m_iFile, sVectors, (int)dwBatchCount, (off_t)qwOffset);
+			if (iBytesRead != iBatchSize && BlockDevice::ReadAtVectored(qwOffset, psBuffers, dwBatchCount) == false)
+				return false;
+
+			// Next batch.
+			qwOffset += iBatchSize;
+			psBuffers += dwBatchCount;
+			dwBufferCount -= dwBatchCount;
+		}
+
+		// Successfully read all of the buffers.
+		return true;
+	}
+
+	ULONGLONG FileBlockDevice::Size()
+	{
+		// Get the size of the file.
+		struct stat sStat;
+		if (fstat(this->m_iFile, &sStat) != 0)
+			return 0;
+
+		return (ULONGLONG)sStat.st_size;
+	}
+
+	ULONGLONG FileBlockDevice::ModifiedTime()
+	{
+		// Get the modification time of the file in nanoseconds.
+		struct stat sStat;
+		if (fstat(this->m_iFile, &sStat) != 0)
+			return 0;
+
+		return (ULONGLONG)sStat.st_mtim.tv_sec * 1000000000ULL + sStat.st_mtim.tv_nsec;
+	}
+
+	bool FileBlockDevice::Flush()
+	{
+		// Flush the file to disk.
+		return fsync(this->m_iFile) == 0;
+	}
+
+	void FileBlockDevice::Advise(ULONGLONG qwOffset, ULONGLONG qwLength, BlockDeviceAccessHint eHint)
+	{
+		// Translate the hint and pass it on to the kernel.
+		int iAdvice = POSIX_FADV_NORMAL;
+		switch (eHint)
+		{
+		case BlockDeviceAccessHint::Sequential:	iAdvice = POSIX_FADV_SEQUENTIAL;	break;
+		case BlockDeviceAccessHint::Random:		iAdvice = POSIX_FADV_RANDOM;		break;
+		case BlockDeviceAccessHint::WillNeed:	iAdvice = POSIX_FADV_WILLNEED;		break;
+		default:								iAdvice = POSIX_FADV_NORMAL;		break;
+		}
+		posix_fadvise(this->m_iFile, (off_t)qwOffset, (off_t)qwLength, iAdvice);
+	}
+
+	PBYTE FileBlockDevice::Map()
+	{
+		// Check if the file is already mapped.
+		if (this->m_pbMappedView != nullptr)
+			return this->m_pbMappedView;
+
+		// Get the size of the file, empty files can't be mapped.
+		ULONGLONG qwSize = Size();
+		if (qwSize == 0 || qwSize > (ULONGLONG)SIZE_MAX)
+			return nullptr;
+
+		// Create a read only shared mapping of the whole file.
+		void *pMapping = mmap(NULL, (size_t)qwSize, PROT_READ, MAP_SHARED, this->m_iFile, 0);
+		if (pMapping == MAP_FAILED)
+			return nullptr;
+
+		// Return the base address of the mapping.
+		this->m_pbMappedView = (PBYTE)pMapping;
+		this->m_qwMappedSize = qwSize;
+		return this->m_pbMappedView;
+	}
+
+	void FileBlockDevice::Unmap()
+	{
+		// Unmap the file.
+		if (this->m_pbMappedView != nullptr)
+		{
+			munmap(this->m_pbMappedView, (size_t)this->m_qwMappedSize);
+			this->m_pbMappedView = nullptr;
+			this->m_qwMappedSize = 0;
+		}
+	}
+
+	bool FileBlockDevice::CopyTo(ULONGLONG qwOffset, BlockDevice *pDestination, ULONGLONG qwDestinationOffset, ULONGLONG qwSize)
+	{
+#ifdef __linux__
+		// When both ends are files have the kernel copy the data, it never has to pass through user space and file
+		// systems that support it can share the blocks instead of copying them.
+		FileBlockDevice *pFileDestination = dynamic_cast<FileBlockDevice*>(pDestination);
+		if (pFileDestination != nullptr)
+		{
+			loff_t iSourceOffset = (loff_t)qwOffset;
+			loff_t iDestinationOffset = (loff_t)qwDestinationOffset;
+			bool bUseSendfile = false;
+			while (qwSize > 0)
+			{
+				// Copy the next chunk, copy_file_range and sendfile both copy at most about 2GB per call.
+				size_t dwChunkSize = (size_t)(qwSize < 0x40000000 ? qwSize : 0x40000000);
+				ssize_t iBytesCopied;
+				if (bUseSendfile == false)
+				{
+					// Older kernels can't copy between file systems and some file systems don't support it, fall
+					// back to sendfile if it isn't supported.
+					iBytesCopied = copy_file_range(this->m_iFile, &iSourceOffset, pFileDestination->m_iFile, &iDestinationOffset, dwChunkSize, 0);
+					if (iBytesCopied < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP))
+					{
+						bUseSendfile = true;
+						continue;
+					}
+				}
+				else
+				{
+					// sendfile writes at the file position of the destination.
+					if (lseek(pFileDestination->m_iFile, (off_t)iDestinationOffset, SEEK_SET) == -1)
+						break;
+
+					off_t iSendOffset = (off_t)iSourceOffset;
+					iBytesCopied = sendfile(pFileDestination->m_iFile, this->m_iFile, &iSendOffset, dwChunkSize);
+					if (iBytesCopied > 0)
+					{
+						iSourceOffset += iBytesCopied;
+						iDestinationOffset += iBytesCopied;
+					}
+				}
+				if (iBytesCopied < 0 && errno == EINTR)
+					continue;
+				if (iBytesCopied <= 0)
+					break;
+
+				// Next chunk.
+				qwSize -= (ULONGLONG)iBytesCopied;
+			}
+
+			// Copy anything the kernel couldn't copy through a buffer.
+			qwOffset = (ULONGLONG)iSourceOffset;
+			qwDestinationOffset = (ULONGLONG)iDestinationOffset;
+			if (qwSize == 0)
+				return true;
+		}
+#endif
+
+		// Copy the data through a buffer.
+		return BlockDevice::CopyTo(qwOffset, pDestination, qwDestinationOffset, qwSize);
+	}
+
+	AsyncReadQueue *FileBlockDevice::CreateReadQueue(DWORD dwQueueDepth)
+	{
+#ifdef __linux__
+		// Use io_uring if the kernel supports it.
+		AsyncReadQueue *pQueue = IoUringReadQueue::Create(this, this->m_iFile, dwQueueDepth);
+		if (pQueue != nullptr)
+			return pQueue;
+#endif
+
+		// Fall back to servicing the reads on a pool of threads.
+		return BlockDevice::CreateReadQueue(dwQueueDepth);
+	}
+};
+
+#endif
\ No newline at end of file
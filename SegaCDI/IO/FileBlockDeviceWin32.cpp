@@ -0,0 +1,165 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	FileBlockDeviceWin32.cpp - Win32 file block device.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "BlockDevice.h"
+
+#ifdef _WIN32
+
+namespace IO
+{
+	FileBlockDevice::FileBlockDevice()
+	{
+		// Initialize fields.
+		this->m_hFile = INVALID_HANDLE_VALUE;
+		this->m_hFileMapping = NULL;
+		this->m_pbMappedView = nullptr;
+		this->m_qwMappedSize = 0;
+	}
+
+	FileBlockDevice::~FileBlockDevice()
+	{
+		// Close the file if it is still open.
+		Close();
+	}
+
+	bool FileBlockDevice::Open(LPCSTR psFileName, BlockDeviceAccess eAccess)
+	{
+		// Open the file using the requested access mode.
+		this->m_hFile = CreateFile(psFileName, GENERIC_READ | (eAccess != BlockDeviceAccess::ReadOnly ? GENERIC_WRITE : 0),
+			FILE_SHARE_READ, NULL, (eAccess == BlockDeviceAccess::CreateAlways ? CREATE_ALWAYS : OPEN_EXISTING), FILE_ATTRIBUTE_NORMAL, NULL);
+		return this->m_hFile != INVALID_HANDLE_VALUE;
+	}
+
+	void FileBlockDevice::Close()
+	{
+		// Release the mapping if there is one.
+		Unmap();
+
+		// Close the file handle.
+		if (this->m_hFile != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(this->m_hFile);
+			this->m_hFile = INVALID_HANDLE_VALUE;
+		}
+	}
+
+	bool FileBlockDevice::ReadAt(ULONGLONG qwOffset, PVOID pBuffer, DWORD dwSize)
+	{
+		DWORD dwBytesRead = 0;
+
+		// Use the overlapped structure to pass the offset so we don't depend on the file pointer.
+		OVERLAPPED sOverlapped = { 0 };
+		sOverlapped.Offset = (DWORD)qwOffset;
+		sOverlapped.OffsetHigh = (DWORD)(qwOffset >> 32);
+
+		// Read the data from the file.
+		return ReadFile(this->m_hFile, pBuffer, dwSize, &dwBytesRead, &sOverlapped) != FALSE && dwBytesRead == dwSize;
+	}
+
+	bool FileBlockDevice::WriteAt(ULONGLONG qwOffset, const void *pBuffer, DWORD dwSize)
+	{
+		DWORD dwBytesWritten = 0;
+
+		// Use the overlapped structure to pass the offset so we don't depend on the file pointer.
+		OVERLAPPED sOverlapped = { 0 };
+		sOverlapped.Offset = (DWORD)qwOffset;
+		sOverlapped.OffsetHigh = (DWORD)(qwOffset >> 32);
+
+		// Write the data to the file.
+		return WriteFile(this->m_hFile, pBuffer, dwSize, &dwBytesWritten, &sOverlapped) != FALSE && dwBytesWritten == dwSize;
+	}
+
+	bool FileBlockDevice::ReadAtVectored(ULONGLONG qwOffset, const BlockDeviceBuffer *psBuffers, DWORD dwBufferCount)
+	{
+		// ReadFileScatter requires unbuffered, page aligned I/O so just read each buffer in turn.
+		return BlockDevice::ReadAtVectored(qwOffset, psBuffers, dwBufferCount);
+	}
+
+	ULONGLONG FileBlockDevice::Size()
+	{
+		// Get the size of the file.
+		LARGE_INTEGER liFileSize;
+		if (GetFileSizeEx(this->m_hFile, &liFileSize) == FALSE)
+			return 0;
+
+		return liFileSize.QuadPart;
+	}
+
+	ULONGLONG FileBlockDevice::ModifiedTime()
+	{
+		// Get the last write time of the file in 100ns units.
+		FILETIME sLastWriteTime;
+		if (GetFileTime(this->m_hFile, NULL, NULL, &sLastWriteTime) == FALSE)
+			return 0;
+
+		return ((ULONGLONG)sLastWriteTime.dwHighDateTime << 32) | sLastWriteTime.dwLowDateTime;
+	}
+
+	bool FileBlockDevice::Flush()
+	{
+		// Flush the file buffers to disk.
+		return FlushFileBuffers(this->m_hFile) != FALSE;
+	}
+
+	void FileBlockDevice::Advise(ULONGLONG qwOffset, ULONGLONG qwLength, BlockDeviceAccessHint eHint)
+	{
+		// The access pattern can only be set when the file is opened on Windows, so there is nothing to do here.
+		(void)qwOffset;
+		(void)qwLength;
+		(void)eHint;
+	}
+
+	PBYTE FileBlockDevice::Map()
+	{
+		// Check if the file is already mapped.
+		if (this->m_pbMappedView != nullptr)
+			return this->m_pbMappedView;
+
+		// Create a read only mapping of the whole file. Writes through the file handle are kept coherent with the
+		// mapping by the OS.
+		this->m_hFileMapping = CreateFileMapping(this->m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (this->m_hFileMapping == NULL)
+			return nullptr;
+
+		// Map a view of the whole file.
+		this->m_pbMappedView = (PBYTE)MapViewOfFile(this->m_hFileMapping, FILE_MAP_READ, 0, 0, 0);
+		if (this->m_pbMappedView == nullptr)
+		{
+			// Failed to map the file, most likely there is not enough address space for it.
+			CloseHandle(this->m_hFileMapping);
+			this->m_hFileMapping = NULL;
+			return nullptr;
+		}
+
+		// Return the base address of the mapping.
+		this->m_qwMappedSize = Size();
+		return this->m_pbMappedView;
+	}
+
+	void FileBlockDevice::Unmap()
+	{
+		// Unmap the view of the file.
+		if (this->m_pbMappedView != nullptr)
+		{
+			UnmapViewOfFile(this->m_pbMappedView);
+			this->m_pbMappedView = nullptr;
+			this->m_qwMappedSize = 0;
+		}
+
+		// Close the mapping object.
+		if (this->m_hFileMapping != NULL)
+		{
+			CloseHandle(this->m_hFileMapping);
+			this->m_hFileMapping = NULL;
+		}
+	}
+};
+
+#endif
\ No newline at end of file
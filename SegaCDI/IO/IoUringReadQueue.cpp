@@ -0,0 +1,286 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	IoUringReadQueue.cpp - Asynchronous reads using io_uring on Linux.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "AsyncReadQueue.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+namespace IO
+{
+	// Thin wrappers for the io_uring system calls, we talk to the kernel directly rather than depending on liburing.
+	static int IoUringSetup(unsigned int dwEntries, struct io_uring_params *pParams)
+	{
+		return (int)syscall(__NR_io_uring_setup, dwEntries, pParams);
+	}
+
+	static int IoUringEnter(int iRing, unsigned int dwToSubmit, unsigned int dwMinComplete, unsigned int dwFlags)
+	{
+		return (int)syscall(__NR_io_uring_enter, iRing, dwToSubmit, dwMinComplete, dwFlags, NULL, 0);
+	}
+
+	IoUringReadQueue::IoUringReadQueue()
+	{
+		// Initialize fields.
+		this->m_pDevice = nullptr;
+		this->m_iFile = -1;
+		this->m_iRing = -1;
+		this->m_dwQueueDepth = 0;
+		this->m_pbSqRing = nullptr;
+		this->m_dwSqRingSize = 0;
+		this->m_psSqes = nullptr;
+		this->m_dwSqesSize = 0;
+		this->m_pbCqRing = nullptr;
+		this->m_dwCqRingSize = 0;
+		this->m_dwOutstanding = 0;
+		this->m_dwUnsubmitted = 0;
+	}
+
+	IoUringReadQueue::~IoUringReadQueue()
+	{
+		// Unmap the rings.
+		if (this->m_psSqes != nullptr)
+			munmap(this->m_psSqes, this->m_dwSqesSize);
+		if (this->m_pbCqRing != nullptr && this->m_pbCqRing != this->m_pbSqRing)
+			munmap(this->m_pbCqRing, this->m_dwCqRingSize);
+		if (this->m_pbSqRing != nullptr)
+			munmap(this->m_pbSqRing, this->m_dwSqRingSize);
+
+		// Close the ring.
+		if (this->m_iRing != -1)
+			close(this->m_iRing);
+	}
+
+	IoUringReadQueue *IoUringReadQueue::Create(BlockDevice *pDevice, int iFile, DWORD dwQueueDepth)
+	{
+		// Try to setup the ring, this fails on kernels without io_uring or when it has been disabled.
+		IoUringReadQueue *pQueue = new IoUringReadQueue();
+		if (pQueue->Initialize(pDevice, iFile, dwQueueDepth) == false)
+		{
+			delete pQueue;
+			return nullptr;
+		}
+
+		return pQueue;
+	}
+
+	bool IoUringReadQueue::Initialize(BlockDevice *pDevice, int iFile, DWORD dwQueueDepth)
+	{
+		this->m_pDevice = pDevice;
+		this->m_iFile = iFile;
+
+		// Create the ring.
+		struct io_uring_params sParams;
+		memset(&sParams, 0, sizeof(sParams));
+		this->m_iRing = IoUringSetup((dwQueueDepth == 0 ? 1 : dwQueueDepth), &sParams);
+		if (this->m_iRing < 0)
+		{
+			this->m_iRing = -1;
+			return false;
+		}
+
+		// Compute the size of the rings, newer kernels let us map both of them with a single mapping.
+		this->m_dwSqRingSize = sParams.sq_off.array + sParams.sq_entries * sizeof(DWORD);
+		this->m_dwCqRingSize = sParams.cq_off.cqes + sParams.cq_entries * sizeof(struct io_uring_cqe);
+		if ((sParams.features & IORING_FEAT_SINGLE_MMAP) != 0)
+		{
+			if (this->m_dwCqRingSize > this->m_dwSqRingSize)
+				this->m_dwSqRingSize = this->m_dwCqRingSize;
+			this->m_dwCqRingSize = this->m_dwSqRingSize;
+		}
+
+		// Map the submission queue ring.
+		void *pMapping = mmap(NULL, this->m_dwSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->m_iRing, IORING_OFF_SQ_RING);
+		if (pMapping == MAP_FAILED)
+			return false;
+		this->m_pbSqRing = (PBYTE)pMapping;
+
+		// Map the completion queue ring.
+		if ((sParams.features & IORING_FEAT_SINGLE_MMAP) != 0)
+			this->m_pbCqRing = this->m_pbSqRing;
+		else
+		{
+			pMapping = mmap(NULL, this->m_dwCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->m_iRing, IORING_OFF_CQ_RING);
+			if (pMapping == MAP_FAILED)
+				return false;
+			this->m_pbCqRing = (PBYTE)pMapping;
+		}
+
+		// Map the submission queue entries.
+		this->m_dwSqesSize = sParams.sq_entries * sizeof(struct io_uring_sqe);
+		pMapping = mmap(NULL, this->m_dwSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->m_iRing, IORING_OFF_SQES);
+		if (pMapping == MAP_FAILED)
+			return false;
+		this->m_psSqes = (struct io_uring_sqe*)pMapping;
+
+		// Setup pointers to the ring fields.
+		this->m_pdwSqHead = (DWORD*)(this->m_pbSqRing + sParams.sq_off.head);
+		this->m_pdwSqTail = (DWORD*)(this->m_pbSqRing + sParams.sq_off.tail);
+		this->m_dwSqMask = *(DWORD*)(this->m_pbSqRing + sParams.sq_off.ring_mask);
+		this->m_pdwSqArray = (DWORD*)(this->m_pbSqRing + sParams.sq_off.array);
+		this->m_pdwCqHead = (DWORD*)(this->m_pbCqRing + sParams.cq_off.head);
+		this->m_pdwCqTail = (DWORD*)(this->m_pbCqRing + sParams.cq_off.tail);
+		this->m_dwCqMask = *(DWORD*)(this->m_pbCqRing + sParams.cq_off.ring_mask);
+		this->m_psCqes = (struct io_uring_cqe*)(this->m_pbCqRing + sParams.cq_off.cqes);
+
+		// The completion queue is at least as large as the submission queue, so capping the requests in flight at
+		// the submission queue size means the completion queue can never overflow.
+		this->m_dwQueueDepth = sParams.sq_entries;
+		return true;
+	}
+
+	bool IoUringReadQueue::Submit(AsyncReadRequest **ppRequests, DWORD dwCount)
+	{
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+
+		// Make sure there is room for all of the requests.
+		if (dwCount > this->m_dwQueueDepth - this->m_dwOutstanding)
+			return false;
+
+		// Fill out a submission queue entry for each request.
+		DWORD dwTail = *this->m_pdwSqTail;
+		for (DWORD i = 0; i < dwCount; i++)
+		{
+			DWORD dwIndex = dwTail & this->m_dwSqMask;
+			struct io_uring_sqe *pSqe = &this->m_psSqes[dwIndex];
+			memset(pSqe, 0, sizeof(struct io_uring_sqe));
+			pSqe->opcode = IORING_OP_READ;
+			pSqe->fd = this->m_iFile;
+			pSqe->off = ppRequests[i]->qwOffset;
+			pSqe->addr = (ULONGLONG)(uintptr_t)ppRequests[i]->pBuffer;
+			pSqe->len = ppRequests[i]->dwSize;
+			pSqe->user_data = (ULONGLONG)(uintptr_t)ppRequests[i];
+
+			ppRequests[i]->bSuccess = false;
+			this->m_pdwSqArray[dwIndex] = dwIndex;
+			dwTail++;
+		}
+
+		// Publish the new entries to the kernel.
+		__atomic_store_n(this->m_pdwSqTail, dwTail, __ATOMIC_RELEASE);
+		this->m_dwOutstanding += dwCount;
+		this->m_dwUnsubmitted += dwCount;
+
+		// Submit the entries, if the kernel is busy they will be submitted the next time we wait for completions.
+		int iResult = IoUringEnter(this->m_iRing, this->m_dwUnsubmitted, 0, 0);
+		if (iResult > 0)
+			this->m_dwUnsubmitted -= (DWORD)iResult;
+
+		return true;
+	}
+
+	DWORD IoUringReadQueue::WaitForCompletions(AsyncReadRequest **ppCompleted, DWORD dwMaxCount)
+	{
+		// Only one thread waits on the ring at a time, otherwise a waiter could block in the kernel after another
+		// thread reaped the completion it was waiting for.
+		std::lock_guard<std::mutex> waitLock(this->m_WaitLock);
+		std::unique_lock<std::mutex> lock(this->m_Lock);
+
+		// Check if there is anything to wait for.
+		if (this->m_dwOutstanding == 0 || dwMaxCount == 0)
+			return 0;
+
+		// Loop until at least one request completes.
+		DWORD dwHead = *this->m_pdwCqHead;
+		while (dwHead == __atomic_load_n(this->m_pdwCqTail, __ATOMIC_ACQUIRE))
+		{
+			// Submit anything left over, if the kernel is too busy to take it try again rather than waiting on reads
+			// that were never submitted.
+			if (this->m_dwUnsubmitted > 0)
+			{
+				int iResult = IoUringEnter(this->m_iRing, this->m_dwUnsubmitted, 0, 0);
+				if (iResult > 0)
+					this->m_dwUnsubmitted -= (DWORD)iResult;
+				if (this->m_dwUnsubmitted > 0)
+				{
+					lock.unlock();
+					std::this_thread::yield();
+					lock.lock();
+					continue;
+				}
+			}
+
+			// Wait for a completion without holding the lock, so other threads can keep submitting.
+			lock.unlock();
+			int iResult = IoUringEnter(this->m_iRing, 0, 1, IORING_ENTER_GETEVENTS);
+			int iError = errno;
+			lock.lock();
+			if (iResult < 0)
+			{
+				// Retry if we were interrupted or the kernel is temporarily out of resources.
+				if (iError == EINTR || iError == EAGAIN || iError == EBUSY)
+					continue;
+
+				printf("IoUringReadQueue::WaitForCompletions(): io_uring_enter failed %d!\n", iError);
+				return 0;
+			}
+		}
+
+		// Reap as many completions as we can. Short reads are finished after the lock is released, so keep the index
+		// of each one in ppCompleted and how much of it was already read.
+		std::vector<std::pair<DWORD, DWORD>> vShortReads;
+		DWORD dwCount = 0;
+		DWORD dwTail = __atomic_load_n(this->m_pdwCqTail, __ATOMIC_ACQUIRE);
+		while (dwHead != dwTail && dwCount < dwMaxCount)
+		{
+			struct io_uring_cqe *pCqe = &this->m_psCqes[dwHead & this->m_dwCqMask];
+			AsyncReadRequest *pRequest = (AsyncReadRequest*)(uintptr_t)pCqe->user_data;
+
+			// Check the result of the read.
+			if (pCqe->res == (int)pRequest->dwSize)
+				pRequest->bSuccess = true;
+			else if (pCqe->res >= 0 || pCqe->res == -EINVAL || pCqe->res == -EOPNOTSUPP)
+			{
+				// Short reads and kernels that don't support IORING_OP_READ are finished with a normal positional read.
+				vShortReads.push_back(std::make_pair(dwCount, (DWORD)(pCqe->res > 0 ? pCqe->res : 0)));
+			}
+			else
+				pRequest->bSuccess = false;
+
+			ppCompleted[dwCount++] = pRequest;
+			dwHead++;
+		}
+
+		// Release the completion queue entries back to the kernel.
+		__atomic_store_n(this->m_pdwCqHead, dwHead, __ATOMIC_RELEASE);
+
+		// Finish the short reads without holding the lock so other threads can keep submitting. The wait lock is
+		// still held, so no other thread can reap while we do this.
+		if (vShortReads.size() > 0)
+		{
+			lock.unlock();
+			for (size_t i = 0; i < vShortReads.size(); i++)
+			{
+				AsyncReadRequest *pRequest = ppCompleted[vShortReads[i].first];
+				DWORD dwDone = vShortReads[i].second;
+				pRequest->bSuccess = this->m_pDevice->ReadAt(pRequest->qwOffset + dwDone, (PBYTE)pRequest->pBuffer + dwDone, pRequest->dwSize - dwDone);
+			}
+			lock.lock();
+		}
+
+		// The requests are only done once they are handed back.
+		this->m_dwOutstanding -= dwCount;
+		return dwCount;
+	}
+
+	DWORD IoUringReadQueue::Outstanding()
+	{
+		// Return the number of requests in flight.
+		std::lock_guard<std::mutex> lock(this->m_Lock);
+		return this->m_dwOutstanding;
+	}
+};
+
+#endif
\ No newline at end of file
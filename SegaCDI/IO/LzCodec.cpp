@@ -0,0 +1,204 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	LzCodec.cpp - Small LZ77 block compressor used for compressed images.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "LzCodec.h"
+
+namespace IO
+{
+	/*
+		Description: Reads 4 bytes that may not be aligned.
+	*/
+	static inline DWORD ReadDword(const BYTE *pbData)
+	{
+		DWORD dwValue;
+		memcpy(&dwValue, pbData, sizeof(DWORD));
+		return dwValue;
+	}
+
+	/*
+		Description: Writes the extra bytes of a length that didn't fit in its token nibble.
+
+		Returns: False if the destination buffer is full.
+	*/
+	static bool WriteLength(PBYTE pbDestination, DWORD dwDestinationSize, DWORD *pdwOutput, DWORD dwLength)
+	{
+		// Write 255 until the remaining length fits in a byte.
+		for (; ; dwLength -= 255)
+		{
+			if (*pdwOutput >= dwDestinationSize)
+				return false;
+
+			pbDestination[(*pdwOutput)++] = (BYTE)(dwLength < 255 ? dwLength : 255);
+			if (dwLength < 255)
+				return true;
+		}
+	}
+
+	/*
+		Description: Writes a sequence of literals followed by an optional match.
+
+		Parameters:
+			pbLiterals: Literals of the sequence.
+			dwLiteralCount: Number of literals.
+			dwOffset: Offset of the match, ignored if dwMatchLength is 0.
+			dwMatchLength: Length of the match, 0 for the last sequence of the block.
+
+		Returns: False if the destination buffer is full.
+	*/
+	static bool WriteSequence(PBYTE pbDestination, DWORD dwDestinationSize, DWORD *pdwOutput, const BYTE *pbLiterals,
+		DWORD dwLiteralCount, DWORD dwOffset, DWORD dwMatchLength)
+	{
+		// Write the token.
+		DWORD dwMatchCode = (dwMatchLength != 0 ? dwMatchLength - LZ_MIN_MATCH : 0);
+		if (*pdwOutput >= dwDestinationSize)
+			return false;
+		pbDestination[(*pdwOutput)++] = (BYTE)(((dwLiteralCount < 15 ? dwLiteralCount : 15) << 4) | (dwMatchCode < 15 ? dwMatchCode : 15));
+
+		// Write the literals.
+		if (dwLiteralCount >= 15 && WriteLength(pbDestination, dwDestinationSize, pdwOutput, dwLiteralCount - 15) == false)
+			return false;
+		if (dwLiteralCount > dwDestinationSize - *pdwOutput)
+			return false;
+		memcpy(&pbDestination[*pdwOutput], pbLiterals, dwLiteralCount);
+		*pdwOutput += dwLiteralCount;
+
+		// The last sequence has no match.
+		if (dwMatchLength == 0)
+			return true;
+
+		// Write the match.
+		if (dwDestinationSize - *pdwOutput < 2)
+			return false;
+		pbDestination[(*pdwOutput)++] = (BYTE)(dwOffset & 0xFF);
+		pbDestination[(*pdwOutput)++] = (BYTE)(dwOffset >> 8);
+		if (dwMatchCode >= 15 && WriteLength(pbDestination, dwDestinationSize, pdwOutput, dwMatchCode - 15) == false)
+			return false;
+
+		return true;
+	}
+
+	DWORD LzCompress(const BYTE *pbSource, DWORD dwSourceSize, PBYTE pbDestination, DWORD dwDestinationSize)
+	{
+		// Hash table of the last position each 4 byte sequence was seen at, plus one so 0 means empty.
+		DWORD dwHashTable[1 << LZ_HASH_BITS];
+		memset(dwHashTable, 0, sizeof(dwHashTable));
+
+		DWORD dwOutput = 0;
+		DWORD dwAnchor = 0;
+		DWORD dwPosition = 0;
+		while (dwSourceSize >= LZ_MIN_MATCH && dwPosition <= dwSourceSize - LZ_MIN_MATCH)
+		{
+			// Look up the last position the next 4 bytes were seen at and replace it with this one.
+			DWORD dwSequence = ReadDword(&pbSource[dwPosition]);
+			DWORD dwHash = (dwSequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+			DWORD dwCandidate = dwHashTable[dwHash];
+			dwHashTable[dwHash] = dwPosition + 1;
+
+			// Check if the candidate is a match we can reference.
+			if (dwCandidate == 0 || dwPosition - (dwCandidate - 1) > LZ_MAX_OFFSET || ReadDword(&pbSource[dwCandidate - 1]) != dwSequence)
+			{
+				dwPosition++;
+				continue;
+			}
+
+			// Extend the match as far as it goes.
+			DWORD dwMatch = dwCandidate - 1;
+			DWORD dwLength = LZ_MIN_MATCH;
+			while (dwPosition + dwLength < dwSourceSize && pbSource[dwMatch + dwLength] == pbSource[dwPosition + dwLength])
+				dwLength++;
+
+			// Write the literals before the match and the match.
+			if (WriteSequence(pbDestination, dwDestinationSize, &dwOutput, &pbSource[dwAnchor], dwPosition - dwAnchor,
+				dwPosition - dwMatch, dwLength) == false)
+				return 0;
+
+			dwPosition += dwLength;
+			dwAnchor = dwPosition;
+		}
+
+		// Write the remaining literals as the last sequence.
+		if (WriteSequence(pbDestination, dwDestinationSize, &dwOutput, &pbSource[dwAnchor], dwSourceSize - dwAnchor, 0, 0) == false)
+			return 0;
+
+		return dwOutput;
+	}
+
+	/*
+		Description: Reads the extra bytes of a length that didn't fit in its token nibble.
+
+		Returns: False if the compressed data ends before the length does.
+	*/
+	static bool ReadLength(const BYTE *pbSource, DWORD dwSourceSize, DWORD *pdwInput, DWORD *pdwLength)
+	{
+		BYTE bValue;
+		do
+		{
+			if (*pdwInput >= dwSourceSize)
+				return false;
+
+			bValue = pbSource[(*pdwInput)++];
+			*pdwLength += bValue;
+		} while (bValue == 255);
+
+		return true;
+	}
+
+	bool LzDecompress(const BYTE *pbSource, DWORD dwSourceSize, PBYTE pbDestination, DWORD dwDestinationSize)
+	{
+		DWORD dwInput = 0;
+		DWORD dwOutput = 0;
+		while (dwInput < dwSourceSize)
+		{
+			// Read the token and the literal length.
+			BYTE bToken = pbSource[dwInput++];
+			DWORD dwLiteralCount = bToken >> 4;
+			if (dwLiteralCount == 15 && ReadLength(pbSource, dwSourceSize, &dwInput, &dwLiteralCount) == false)
+				return false;
+
+			// Copy the literals.
+			if (dwLiteralCount > dwSourceSize - dwInput || dwLiteralCount > dwDestinationSize - dwOutput)
+				return false;
+			memcpy(&pbDestination[dwOutput], &pbSource[dwInput], dwLiteralCount);
+			dwInput += dwLiteralCount;
+			dwOutput += dwLiteralCount;
+
+			// The last sequence ends with its literals.
+			if (dwInput == dwSourceSize)
+				break;
+
+			// Read the match offset and length.
+			if (dwSourceSize - dwInput < 2)
+				return false;
+			DWORD dwOffset = pbSource[dwInput] | ((DWORD)pbSource[dwInput + 1] << 8);
+			dwInput += 2;
+
+			DWORD dwLength = bToken & 15;
+			if (dwLength == 15 && ReadLength(pbSource, dwSourceSize, &dwInput, &dwLength) == false)
+				return false;
+			dwLength += LZ_MIN_MATCH;
+
+			if (dwOffset == 0 || dwOffset > dwOutput || dwLength > dwDestinationSize - dwOutput)
+				return false;
+
+			// Copy the match, byte by byte when it overlaps the data being written.
+			const BYTE *pbMatch = &pbDestination[dwOutput - dwOffset];
+			if (dwOffset >= dwLength)
+				memcpy(&pbDestination[dwOutput], pbMatch, dwLength);
+			else
+			{
+				for (DWORD i = 0; i < dwLength; i++)
+					pbDestination[dwOutput + i] = pbMatch[i];
+			}
+			dwOutput += dwLength;
+		}
+
+		return dwOutput == dwDestinationSize;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	LzCodec.h - Small LZ77 block compressor used for compressed images.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+
+namespace IO
+{
+	// Shortest match that is encoded as a back reference.
+	#define LZ_MIN_MATCH			4
+
+	// Farthest back a match can reference, offsets are stored as 16 bit values.
+	#define LZ_MAX_OFFSET			0xFFFF
+
+	// Number of bits used to index the match finder hash table.
+	#define LZ_HASH_BITS			14
+
+	/*
+		Block format:
+			Each sequence starts with a token byte, the high nibble is the number of literals and the low nibble
+			is the match length minus LZ_MIN_MATCH. A nibble of 15 is followed by extra length bytes that are added
+			to it, a byte of 255 means another length byte follows. The literals follow the token and extra literal
+			length bytes, then a 16 bit little endian match offset and the extra match length bytes. The last
+			sequence of a block only has literals, the block ends right after them.
+	*/
+
+	/*
+		Description: Compresses a block of data.
+
+		Parameters:
+			pbSource: Data to compress.
+			dwSourceSize: Size of the data to compress.
+			pbDestination: Buffer that receives the compressed data.
+			dwDestinationSize: Size of the destination buffer.
+
+		Returns: The size of the compressed data, or 0 if it didn't fit in the destination buffer.
+	*/
+	DWORD LzCompress(const BYTE *pbSource, DWORD dwSourceSize, PBYTE pbDestination, DWORD dwDestinationSize);
+
+	/*
+		Description: Decompresses a block of data compressed with LzCompress(). The compressed data is fully
+			bounds checked so corrupt blocks can't read or write outside of the buffers.
+
+		Parameters:
+			pbSource: Compressed data.
+			dwSourceSize: Size of the compressed data.
+			pbDestination: Buffer that receives the decompressed data.
+			dwDestinationSize: Size the data decompresses to.
+
+		Returns: True if the block decompressed to exactly dwDestinationSize bytes, false otherwise.
+	*/
+	bool LzDecompress(const BYTE *pbSource, DWORD dwSourceSize, PBYTE pbDestination, DWORD dwDestinationSize);
+};
\ No newline at end of file
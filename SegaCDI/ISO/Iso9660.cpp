@@ -1,407 +1,826 @@
-/*
-	SegaCDI - Sega Dreamcast cdi image validator.
-
-	Iso9660.cpp - ISO 9660 image support.
-
-	Dec 2nd, 2015
-		- Initial creation.
-
-	Dec 5th, 2015
-		- Added support to read ISO9660 directory entries.
-*/
-
-#include "../stdafx.h"
-#include "Iso9660.h"
-#include "Iso9660Types.h"
-
-namespace ISO
-{
-	ISO9660::ISO9660()
-	{
-		// Initialize fields.
-		this->m_hFileHandle = INVALID_HANDLE_VALUE;
-		this->m_phTrackHandle = nullptr;
-		this->m_dwFileSize = 0;
-		this->m_dwLBA = 0;
-	}
-
-	ISO9660::~ISO9660()
-	{
-		// Check if the file is still open.
-		if (this->m_hFileHandle != INVALID_HANDLE_VALUE)
-		{
-			// Close the file handle.
-			CloseHandle(this->m_hFileHandle);
-			this->m_hFileHandle = INVALID_HANDLE_VALUE;
-		}
-	}
-
-	bool ISO9660::LoadISOFromFile(CString sFileName, DWORD dwLBA, bool bWriteMode, bool bVerbose)
-	{
-		DWORD dwCount = 0;
-		ISO9660_VolumeDescriptor *pVolDesc = NULL;
-		ISO9660_PrimaryVolumeDescriptor *pPrimaryVolDesc = NULL;
-
-		// Save the LBA value.
-		this->m_dwLBA = dwLBA;
-
-		// Save the file name and open the iso image.
-		this->m_sFileName = sFileName;
-		this->m_hFileHandle = CreateFile(this->m_sFileName, GENERIC_READ | (bWriteMode == true ? GENERIC_WRITE : 0),
-			NULL, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-		if (this->m_hFileHandle == INVALID_HANDLE_VALUE)
-		{
-			// Error opening the iso file.
-			printf("ISO9660::LoadISOFromFile(): failed to open file '%s'!\n", this->m_sFileName);
-			return false;
-		}
-
-		// Get the file size of the iso.
-		this->m_dwFileSize = GetFileSize(this->m_hFileHandle, NULL);
-		if (this->m_dwFileSize == 0)
-		{
-			// Invalid file size.
-			printf("ISO9660::LoadISOFromFile(): file '%s' has invalid size!\n", this->m_sFileName);
-			return false;
-		}
-
-		// Allocate a scratch buffer to work with.
-		PBYTE pbScratchBuffer = (PBYTE)VirtualAlloc(NULL, ISO9660_SECTOR_SIZE, MEM_COMMIT, PAGE_READWRITE);
-		if (pbScratchBuffer == NULL)
-		{
-			// Failed to allocate scratch buffer, out of memory.
-			printf("ISO9660::LoadISOFromFile(): failed to allocate scratch buffer!\n");
-			return false;
-		}
-
-		// Initialize the two volume descriptor pointers to point at the scratch buffer.
-		pVolDesc = (ISO9660_VolumeDescriptor*)pbScratchBuffer;
-		pPrimaryVolDesc = (ISO9660_PrimaryVolumeDescriptor*)pbScratchBuffer;
-
-		// Seek to the volume descriptors section, after the reserved area.
-		SetFilePointer(this->m_hFileHandle, ISO9660_VOLUME_DESCRIPTORS_SECTOR * ISO9660_SECTOR_SIZE, NULL, FILE_BEGIN);
-
-		do
-		{
-			// Read the volume descriptor block.
-			if (ReadFile(this->m_hFileHandle, pbScratchBuffer, ISO9660_SECTOR_SIZE, &dwCount, NULL) == false ||
-				dwCount != ISO9660_SECTOR_SIZE)
-			{
-				// Failed to read the volume descriptor block.
-				printf("ISO9660::LoadISOFromFile(): failed to read volume descriptor block, file too short!\n");
-
-				// Free the scratch buffer and return.
-				VirtualFree(pbScratchBuffer, ISO9660_SECTOR_SIZE, MEM_DECOMMIT);
-				return false;
-			}
-		} while (pVolDesc->bType != VolumeDescriptorTypes::PrimaryVolumeDescriptor &&
-			pVolDesc->bType != VolumeDescriptorTypes::VolumeDescriptorSetTerminator);
-
-		// Check if we found the primary descriptor or the terminator.
-		if (pVolDesc->bType != VolumeDescriptorTypes::PrimaryVolumeDescriptor)
-		{
-			// Failed to find the primary volume descriptor.
-			printf("ISO9660::LoadISOFromFile(): failed to find the primary volume descriptor!\n");
-
-			// Free the scratch buffer and return.
-			VirtualFree(pbScratchBuffer, ISO9660_SECTOR_SIZE, MEM_DECOMMIT);
-			return false;
-		}
-
-		// Found the primary volume descriptor.
-		printf("found primary volume descriptor: %.*s\n", sizeof(pPrimaryVolDesc->sVolumeIdentifier), 
-			sizeof(pPrimaryVolDesc->sVolumeIdentifier), pPrimaryVolDesc->sVolumeIdentifier);
-		if (bVerbose == true)
-		{
-			// Print the file table banner.
-			printf("LBA\t\tSize\t\tName\n");
-		}
-
-		// Seek to the root directory and parse the filesystem.
-		if (ReadDirectoryBlock(&pPrimaryVolDesc->sRootDirectoryEntry, nullptr, bVerbose) == false)
-		{
-			// Failed to read the filesystem, free the scratch buffer and return.
-			VirtualFree(pbScratchBuffer, ISO9660_SECTOR_SIZE, MEM_DECOMMIT);
-			return false;
-		}
-
-		// Skip a line.
-		printf("\n");
-
-		// Successfully loaded the ISO file.
-		return true;
-	}
-
-	bool ISO9660::LoadISOFromCDI(DiskJuggler::CdiTrackHandle* pTrackHandle, bool bVerbose)
-	{
-		ISO9660_VolumeDescriptor *pVolDesc = NULL;
-		ISO9660_PrimaryVolumeDescriptor *pPrimaryVolDesc = NULL;
-
-		// Save the track handle and get the size of the ISO image.
-		this->m_phTrackHandle = pTrackHandle;
-		this->m_dwFileSize = this->m_phTrackHandle->TrackSize();
-		this->m_dwLBA = this->m_phTrackHandle->LBA();
-
-		// Allocate a scratch buffer to work with.
-		PBYTE pbScratchBuffer = (PBYTE)VirtualAlloc(NULL, ISO9660_SECTOR_SIZE, MEM_COMMIT, PAGE_READWRITE);
-		if (pbScratchBuffer == NULL)
-		{
-			// Failed to allocate scratch buffer, out of memory.
-			printf("ISO9660::LoadISOFromCDI(): failed to allocate scratch buffer!\n");
-			return false;
-		}
-
-		// Initialize the two volume descriptor pointers to point at the scratch buffer.
-		pVolDesc = (ISO9660_VolumeDescriptor*)pbScratchBuffer;
-		pPrimaryVolDesc = (ISO9660_PrimaryVolumeDescriptor*)pbScratchBuffer;
-
-		DWORD i = 0;
-		do
-		{
-			// Read the volume descriptor block.
-			if (this->m_phTrackHandle->ReadData(ISO9660_VOLUME_DESCRIPTORS_SECTOR + i, pbScratchBuffer, ISO9660_SECTOR_SIZE) == false)
-			{
-				// Failed to read the volume descriptor block.
-				printf("ISO9660::LoadISOFromCDI(): failed to read volume descriptor block!\n");
-
-				// Free the scratch buffer and return.
-				VirtualFree(pbScratchBuffer, ISO9660_SECTOR_SIZE, MEM_DECOMMIT);
-				return false;
-			}
-
-			// Next block.
-			i++;
-		} 
-		while (pVolDesc->bType != VolumeDescriptorTypes::PrimaryVolumeDescriptor &&
-			pVolDesc->bType != VolumeDescriptorTypes::VolumeDescriptorSetTerminator);
-
-		// Check if we found the primary descriptor or the terminator.
-		if (pVolDesc->bType != VolumeDescriptorTypes::PrimaryVolumeDescriptor)
-		{
-			// Failed to find the primary volume descriptor.
-			printf("ISO9660::LoadISOFromCDI(): failed to find the primary volume descriptor!\n");
-
-			// Free the scratch buffer and return.
-			VirtualFree(pbScratchBuffer, ISO9660_SECTOR_SIZE, MEM_DECOMMIT);
-			return false;
-		}
-
-		// Found the primary volume descriptor.
-		printf("found primary volume descriptor: %.*s\n", sizeof(pPrimaryVolDesc->sVolumeIdentifier), pPrimaryVolDesc->sVolumeIdentifier);
-		if (bVerbose == true)
-		{
-			// Print the file table banner.
-			printf("\nLBA\t\tSize\t\tName\n");
-		}
-
-		// Seek to the root directory and parse the filesystem.
-		if (ReadDirectoryBlock(&pPrimaryVolDesc->sRootDirectoryEntry, nullptr, bVerbose) == false)
-		{
-			// Failed to read the filesystem, free the scratch buffer and return.
-			VirtualFree(pbScratchBuffer, ISO9660_SECTOR_SIZE, MEM_DECOMMIT);
-			return false;
-		}
-
-		// Skip a line.
-		printf("\n");
-
-		// Successfully loaded the ISO image.
-		return true;
-	}
-
-	bool ISO9660::ReadDirectoryBlock(ISO9660_DirectoryEntry *pDirectoryEntry, FileSystemDirectoryEntry *pParentDirectory, bool bVerbose)
-	{
-		// Check if this directory entry has already been cached.
-		FileSystemSectorCacheEntry *pCacheEntry = (FileSystemSectorCacheEntry*)FindCacheEntry(pDirectoryEntry->dwExtentLBA.LE);
-		if (pCacheEntry != nullptr)
-		{
-			// The directory entry has already been cached so there is nothing to do here.
-			return true;
-		}
-
-		// Create a new FileSystemDirectoryEntry object for the directory entry provided.
-		FileSystemDirectoryEntry *pFsDirectoryEntry = new FileSystemDirectoryEntry(pDirectoryEntry, pParentDirectory);
-		if (bVerbose == true)
-		{
-			// Print the folder name.
-			if (pFsDirectoryEntry->IsDirectory() == true)
-				printf("%d\t\t%d\t\t%s\\..\n", pFsDirectoryEntry->GetExtentLBA(), pFsDirectoryEntry->GetExtentSize(), pFsDirectoryEntry->GetFullName());
-		}
-
-		// The directory entry has not been cached yet so add it to the directory cache.
-		if (AddToCache(pFsDirectoryEntry, &pCacheEntry) == false)
-		{
-			// Failed to cache directory entry data.
-			delete pDirectoryEntry;
-			return false;
-		}
-
-		// If this is a root entry then add it to our list of root directory entries.
-		if (pParentDirectory == nullptr)
-		{
-			// This is a root entry so add it to the root list.
-			this->lDirectoryEntries.push_back(pFsDirectoryEntry);
-		}
-
-		// Initialize the loop counter and interator.
-		DWORD dwRemainingData = pDirectoryEntry->dwExtentSize.LE;
-		PBYTE pbCacheData = pCacheEntry->pbSectorData;
-
-		// Loop through the directory sectors until we reach the last directory entry.
-		do
-		{
-			// Get the next ISO9660 directory entry from the cache data.
-			ISO9660_DirectoryEntry *pDirEntry = (ISO9660_DirectoryEntry*)pbCacheData;
-
-			// Check if the current directory entry is valid or if we are on a sector boundary.
-			if (pDirEntry->bEntryLength == 0)
-			{
-				// Check if this next entry would cross a sector boundary.
-				DWORD dwRemainder = dwRemainingData % ISO9660_SECTOR_SIZE;
-				if (dwRemainder > 0 && dwRemainder < ISO9660_DIR_ENTRY_MAX_SIZE)
-				{
-					// Skip to the next sector.
-					dwRemainingData -= dwRemainder;
-					pbCacheData += dwRemainder;
-
-					// Check to see if there is any remaining data left to be parsed.
-					if (dwRemainingData <= 0)
-						break;
-
-					// Update the entry pointer.
-					pDirEntry = (ISO9660_DirectoryEntry*)pbCacheData;
-				}
-
-				// Double check we now have a valid entry to work with.
-				if (pDirEntry->bEntryLength == 0)
-					break;
-			}
-
-			// Check if this entry is a directory or a file.
-			if ((pDirEntry->bFileFlags & FileFlags::FileIsDirectory) != 0)
-			{
-				// Make sure we don't print the entry for the "./" file entry.
-				if (pDirEntry->dwExtentLBA.LE != pDirectoryEntry->dwExtentLBA.LE)
-				{
-					// Recursively parse the child directory.
-					if (ReadDirectoryBlock(pDirEntry, pFsDirectoryEntry, bVerbose) == false)
-					{
-						// Failed to read child directory entry data.
-						return false;
-					}
-				}
-			}
-			else
-			{
-				// Setup the fs child entry which will automatically add it to the parent's list of children.
-				FileSystemDirectoryEntry *pEntry = new FileSystemDirectoryEntry(pDirEntry, pFsDirectoryEntry);
-
-				// Check if we should print the file information.
-				if (bVerbose == true)
-					printf("%d\t\t%d\t\t%s\n", pDirEntry->dwExtentLBA.LE, pDirEntry->dwExtentSize.LE, pEntry->GetFullName());
-			}
-
-			// Next entry.
-			dwRemainingData -= pDirEntry->bEntryLength;
-			pbCacheData += pDirEntry->bEntryLength;
-		} while (dwRemainingData > 0);
-
-		// Successfully parsed the file system for this directory entry.
-		return true;
-	}
-
-	bool ISO9660::AddToCache(FileSystemDirectoryEntry *pDirectoryEntry, FileSystemSectorCacheEntry **ppCacheEntry)
-	{
-		DWORD dwBytesRead = 0;
-
-		// Check to see if there is already a cache entry for this directory.
-		*ppCacheEntry = (FileSystemSectorCacheEntry*)FindCacheEntry(pDirectoryEntry->pValue->dwExtentLBA.LE);
-		if (*ppCacheEntry != nullptr)
-		{
-			// There is already a cache entry for this directory entry, so we are done here.
-			return true;
-		}
-
-		// Initialize a new FileSystemSectorCacheEntry object.
-		FileSystemSectorCacheEntry *pCacheEntry = new FileSystemSectorCacheEntry();
-		pCacheEntry->dwExtentLBA = pDirectoryEntry->pValue->dwExtentLBA.LE;
-		pCacheEntry->dwExtentSize = pDirectoryEntry->pValue->dwExtentSize.LE;
-		pCacheEntry->sFileIdentifier = pDirectoryEntry->sName;
-
-		// Allocate the cache buffer for the directory entry.
-		pCacheEntry->pbSectorData = (PBYTE)VirtualAlloc(NULL, pCacheEntry->dwExtentSize, MEM_COMMIT, PAGE_READWRITE);
-		if (pCacheEntry->pbSectorData == NULL)
-		{
-			// Failed to allocate cache buffer.
-			printf("ISO9660::AddToCache(): failed to allocate cache buffer for entry '%s'!\n",
-				pCacheEntry->sFileIdentifier);
-			goto Cleanup;
-		}
-
-		// Check if we are reading from a file or from a CDI image.
-		if (this->m_hFileHandle != INVALID_HANDLE_VALUE)
-		{
-			// Compute the directory entry data offset and seek to it.
-			int dwDataOffset = (pCacheEntry->dwExtentLBA - this->m_dwLBA) * ISO9660_SECTOR_SIZE;
-			SetFilePointer(this->m_hFileHandle, dwDataOffset, NULL, FILE_BEGIN);
-
-			// Read the directory data into the cache buffer.
-			if (ReadFile(this->m_hFileHandle, pCacheEntry->pbSectorData, pCacheEntry->dwExtentSize, &dwBytesRead, NULL) == false ||
-				dwBytesRead != pCacheEntry->dwExtentSize)
-			{
-				// Failed to read the directory data into the cache buffer.
-				printf("ISO9660::AddToCache(): failed to read directory data for entry '%s'!\n",
-					pCacheEntry->sFileIdentifier);
-				goto Cleanup;
-			}
-		}
-		else
-		{
-			// Read the directory data into the cache buffer.
-			if (this->m_phTrackHandle->ReadData(pCacheEntry->dwExtentLBA - this->m_dwLBA, 
-				pCacheEntry->pbSectorData, pCacheEntry->dwExtentSize) == false)
-			{
-				// Failed to read the directory data into the cache buffer.
-				printf("ISO9660::AddToCache(): failed to read directory data for entry '%s'!\n",
-					pCacheEntry->sFileIdentifier);
-				goto Cleanup;
-			}
-		}
-
-		// Add the new cache entry object to the list.
-		this->lSectorCache.push_back(pCacheEntry);
-
-		// Successfully cached the directory data, assign the cache entry pointer and return true.
-		*ppCacheEntry = pCacheEntry;
-		return true;
-
-	Cleanup:
-		if (pCacheEntry)
-		{
-			// Check if the cache buffer was allocated.
-			if (pCacheEntry->pbSectorData)
-				VirtualFree(pCacheEntry->pbSectorData, pCacheEntry->dwExtentSize, MEM_DECOMMIT);
-
-			// Free the cache entry object.
-			delete pCacheEntry;
-		}
-
-		// Done with errors, return false.
-		return false;
-	}
-
-	const FileSystemSectorCacheEntry* ISO9660::FindCacheEntry(DWORD dwLBA)
-	{
-		// Search the directory list for an entry with the target LBA.
-		for (std::list<FileSystemSectorCacheEntry*>::const_iterator iter = this->lSectorCache.begin(); 
-			iter != this->lSectorCache.end(); ++iter)
-		{
-			// Check if the current cache entry has the same LBA as what we are searching for.
-			if ((*iter)->dwExtentLBA == dwLBA)
-				return (*iter);
-		}
-
-		// No cache entry with the target LBA was found.
-		return nullptr;
-	}
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	Iso9660.cpp - ISO 9660 image support.
+
+	Dec 2nd, 2015
+		- Initial creation.
+
+	Dec 5th, 2015
+		- Added support to read ISO9660 directory entries.
+*/
+
+#include "../stdafx.h"
+#include "Iso9660.h"
+#include "Iso9660Types.h"
+#include <algorithm>
+
+namespace ISO
+{
+	ISO9660::ISO9660()
+	{
+		// Initialize fields.
+		this->m_pFileDevice = nullptr;
+		this->m_phTrackHandle = nullptr;
+		this->m_qwFileSize = 0;
+		this->m_dwLBA = 0;
+		this->m_pbIndexRecords = nullptr;
+		this->m_pbVolumeDescriptor = nullptr;
+	}
+
+	ISO9660::~ISO9660()
+	{
+		// Check if the file is still open.
+		if (this->m_pFileDevice != nullptr)
+		{
+			// Close the file device.
+			delete this->m_pFileDevice;
+			this->m_pFileDevice = nullptr;
+		}
+
+		// Free the directory tree.
+		for (auto iter = this->lDirectoryEntries.begin(); iter != this->lDirectoryEntries.end(); iter++)
+			FreeDirectoryEntry(*iter);
+		this->lDirectoryEntries.clear();
+
+		// Free the cached directory sectors.
+		for (auto iter = this->lSectorCache.begin(); iter != this->lSectorCache.end(); iter++)
+		{
+			if ((*iter)->pbSectorData != nullptr && (*iter)->bIsView == false)
+				AlignedFree((*iter)->pbSectorData);
+			delete *iter;
+		}
+		this->lSectorCache.clear();
+
+		// Free the volume descriptor sector.
+		if (this->m_pbVolumeDescriptor != nullptr)
+		{
+			AlignedFree(this->m_pbVolumeDescriptor);
+			this->m_pbVolumeDescriptor = nullptr;
+		}
+
+		// Free the directory records restored from an index.
+		if (this->m_pbIndexRecords != nullptr)
+		{
+			delete[] this->m_pbIndexRecords;
+			this->m_pbIndexRecords = nullptr;
+		}
+	}
+
+	void ISO9660::FreeDirectoryEntry(FileSystemDirectoryEntry *pEntry)
+	{
+		// Free the children first, then the entry itself.
+		for (auto iter = pEntry->lChildEntries.begin(); iter != pEntry->lChildEntries.end(); iter++)
+			FreeDirectoryEntry(*iter);
+		delete pEntry;
+	}
+
+	bool ISO9660::LoadISOFromFile(CString sFileName, DWORD dwLBA, bool bWriteMode, bool bVerbose)
+	{
+		ISO9660_VolumeDescriptor *pVolDesc = NULL;
+		ISO9660_PrimaryVolumeDescriptor *pPrimaryVolDesc = NULL;
+
+		// Save the LBA value.
+		this->m_dwLBA = dwLBA;
+
+		// Save the file name and open the iso image.
+		this->m_sFileName = sFileName;
+		this->m_pFileDevice = IO::OpenFileDevice(this->m_sFileName, (bWriteMode == true ? IO::BlockDeviceAccess::ReadWrite : IO::BlockDeviceAccess::ReadOnly));
+		if (this->m_pFileDevice == nullptr)
+		{
+			// Error opening the iso file.
+			printf("ISO9660::LoadISOFromFile(): failed to open file '%s'!\n", this->m_sFileName);
+			return false;
+		}
+
+		// Get the file size of the iso.
+		this->m_qwFileSize = this->m_pFileDevice->Size();
+		if (this->m_qwFileSize == 0)
+		{
+			// Invalid file size.
+			printf("ISO9660::LoadISOFromFile(): file '%s' has invalid size!\n", this->m_sFileName);
+			return false;
+		}
+
+		// Allocate a scratch buffer to work with.
+		PBYTE pbScratchBuffer = (PBYTE)AlignedAlloc(ISO9660_SECTOR_SIZE);
+		if (pbScratchBuffer == NULL)
+		{
+			// Failed to allocate scratch buffer, out of memory.
+			printf("ISO9660::LoadISOFromFile(): failed to allocate scratch buffer!\n");
+			return false;
+		}
+
+		// Initialize the two volume descriptor pointers to point at the scratch buffer.
+		pVolDesc = (ISO9660_VolumeDescriptor*)pbScratchBuffer;
+		pPrimaryVolDesc = (ISO9660_PrimaryVolumeDescriptor*)pbScratchBuffer;
+
+		// The volume descriptors section starts after the reserved area.
+		ULONGLONG qwDescriptorOffset = ISO9660_VOLUME_DESCRIPTORS_SECTOR * ISO9660_SECTOR_SIZE;
+
+		do
+		{
+			// Read the volume descriptor block.
+			if (this->m_pFileDevice->ReadAt(qwDescriptorOffset, pbScratchBuffer, ISO9660_SECTOR_SIZE) == false)
+			{
+				// Failed to read the volume descriptor block.
+				printf("ISO9660::LoadISOFromFile(): failed to read volume descriptor block, file too short!\n");
+
+				// Free the scratch buffer and return.
+				AlignedFree(pbScratchBuffer);
+				return false;
+			}
+
+			// Next volume descriptor.
+			qwDescriptorOffset += ISO9660_SECTOR_SIZE;
+		} while (pVolDesc->bType != VolumeDescriptorTypes::PrimaryVolumeDescriptor &&
+			pVolDesc->bType != VolumeDescriptorTypes::VolumeDescriptorSetTerminator);
+
+		// Check if we found the primary descriptor or the terminator.
+		if (pVolDesc->bType != VolumeDescriptorTypes::PrimaryVolumeDescriptor)
+		{
+			// Failed to find the primary volume descriptor.
+			printf("ISO9660::LoadISOFromFile(): failed to find the primary volume descriptor!\n");
+
+			// Free the scratch buffer and return.
+			AlignedFree(pbScratchBuffer);
+			return false;
+		}
+
+		// Found the primary volume descriptor.
+		printf("found primary volume descriptor: %.*s\n", sizeof(pPrimaryVolDesc->sVolumeIdentifier), 
+			sizeof(pPrimaryVolDesc->sVolumeIdentifier), pPrimaryVolDesc->sVolumeIdentifier);
+		if (bVerbose == true)
+		{
+			// Print the file table banner.
+			printf("LBA\t\tSize\t\tName\n");
+		}
+
+		// Seek to the root directory and parse the filesystem.
+		if (ReadDirectoryBlock(&pPrimaryVolDesc->sRootDirectoryEntry, nullptr, bVerbose) == false)
+		{
+			// Failed to read the filesystem, free the scratch buffer and return.
+			AlignedFree(pbScratchBuffer);
+			return false;
+		}
+
+		// Skip a line.
+		printf("\n");
+
+		// Keep the volume descriptor around, the root directory entry points into it.
+		this->m_pbVolumeDescriptor = pbScratchBuffer;
+
+		// Successfully loaded the ISO file.
+		return true;
+	}
+
+	bool ISO9660::LoadISOFromCDI(DiskJuggler::CdiTrackHandle* pTrackHandle, bool bVerbose)
+	{
+		ISO9660_VolumeDescriptor *pVolDesc = NULL;
+		ISO9660_PrimaryVolumeDescriptor *pPrimaryVolDesc = NULL;
+
+		// Save the track handle and get the size of the ISO image.
+		this->m_phTrackHandle = pTrackHandle;
+		this->m_qwFileSize = this->m_phTrackHandle->TrackSize();
+		this->m_dwLBA = this->m_phTrackHandle->LBA();
+
+		// Allocate a scratch buffer to work with.
+		PBYTE pbScratchBuffer = (PBYTE)AlignedAlloc(ISO9660_SECTOR_SIZE);
+		if (pbScratchBuffer == NULL)
+		{
+			// Failed to allocate scratch buffer, out of memory.
+			printf("ISO9660::LoadISOFromCDI(): failed to allocate scratch buffer!\n");
+			return false;
+		}
+
+		// Initialize the two volume descriptor pointers to point at the scratch buffer.
+		pVolDesc = (ISO9660_VolumeDescriptor*)pbScratchBuffer;
+		pPrimaryVolDesc = (ISO9660_PrimaryVolumeDescriptor*)pbScratchBuffer;
+
+		DWORD i = 0;
+		do
+		{
+			// If the track is memory mapped parse the volume descriptor in place.
+			DiskJuggler::CdiSectorView sView;
+			if (this->m_phTrackHandle->ReadDataView(ISO9660_VOLUME_DESCRIPTORS_SECTOR + i, 1, &sView) == true)
+			{
+				// Point the volume descriptor pointers at the mapped sector.
+				pVolDesc = (ISO9660_VolumeDescriptor*)sView.pbData;
+				pPrimaryVolDesc = (ISO9660_PrimaryVolumeDescriptor*)sView.pbData;
+			}
+
+			else
+			{
+				// Read the volume descriptor block, a previous block may have left the pointers on a mapped view.
+				pVolDesc = (ISO9660_VolumeDescriptor*)pbScratchBuffer;
+				pPrimaryVolDesc = (ISO9660_PrimaryVolumeDescriptor*)pbScratchBuffer;
+				if (this->m_phTrackHandle->ReadData(ISO9660_VOLUME_DESCRIPTORS_SECTOR + i, pbScratchBuffer, ISO9660_SECTOR_SIZE) == false)
+				{
+					// Failed to read the volume descriptor block.
+					printf("ISO9660::LoadISOFromCDI(): failed to read volume descriptor block!\n");
+
+					// Free the scratch buffer and return.
+					AlignedFree(pbScratchBuffer);
+					return false;
+				}
+			}
+
+			// Next block.
+			i++;
+		} 
+		while (pVolDesc->bType != VolumeDescriptorTypes::PrimaryVolumeDescriptor &&
+			pVolDesc->bType != VolumeDescriptorTypes::VolumeDescriptorSetTerminator);
+
+		// Check if we found the primary descriptor or the terminator.
+		if (pVolDesc->bType != VolumeDescriptorTypes::PrimaryVolumeDescriptor)
+		{
+			// Failed to find the primary volume descriptor.
+			printf("ISO9660::LoadISOFromCDI(): failed to find the primary volume descriptor!\n");
+
+			// Free the scratch buffer and return.
+			AlignedFree(pbScratchBuffer);
+			return false;
+		}
+
+		// Found the primary volume descriptor.
+		printf("found primary volume descriptor: %.*s\n", sizeof(pPrimaryVolDesc->sVolumeIdentifier), pPrimaryVolDesc->sVolumeIdentifier);
+		if (bVerbose == true)
+		{
+			// Print the file table banner.
+			printf("\nLBA\t\tSize\t\tName\n");
+		}
+
+		// Seek to the root directory and parse the filesystem.
+		if (ReadDirectoryBlock(&pPrimaryVolDesc->sRootDirectoryEntry, nullptr, bVerbose) == false)
+		{
+			// Failed to read the filesystem, free the scratch buffer and return.
+			AlignedFree(pbScratchBuffer);
+			return false;
+		}
+
+		// Skip a line.
+		printf("\n");
+
+		// Keep the volume descriptor around, the root directory entry points into it.
+		this->m_pbVolumeDescriptor = pbScratchBuffer;
+
+		// Successfully loaded the ISO image.
+		return true;
+	}
+
+	bool ISO9660::LoadISOFromIndex(DiskJuggler::CdiTrackHandle* pTrackHandle, const BYTE *pbRecords, DWORD dwSize, DWORD dwEntryCount, bool bVerbose)
+	{
+		// Save the track handle and get the size of the ISO image.
+		this->m_phTrackHandle = pTrackHandle;
+		this->m_qwFileSize = this->m_phTrackHandle->TrackSize();
+		this->m_dwLBA = this->m_phTrackHandle->LBA();
+
+		// Keep a copy of the records, the directory entries point into them.
+		this->m_pbIndexRecords = new BYTE[dwSize];
+		memcpy(this->m_pbIndexRecords, pbRecords, dwSize);
+
+		if (bVerbose == true)
+		{
+			// Print the file table banner.
+			printf("\nLBA\t\tSize\t\tName\n");
+		}
+
+		// Loop through all of the entries and rebuild the tree, parents always come before their children.
+		std::vector<FileSystemDirectoryEntry*> vEntries;
+		DWORD dwOffset = 0;
+		for (DWORD i = 0; i < dwEntryCount; i++)
+		{
+			// Make sure the parent index and the directory record are inside of the buffer.
+			DWORD dwParentIndex;
+			if (dwSize - dwOffset < sizeof(DWORD) + ISO9660_DIR_ENTRY_MIN_SIZE)
+				goto Corrupt;
+			memcpy(&dwParentIndex, &this->m_pbIndexRecords[dwOffset], sizeof(DWORD));
+			dwOffset += sizeof(DWORD);
+
+			ISO9660_DirectoryEntry *pDirEntry = (ISO9660_DirectoryEntry*)&this->m_pbIndexRecords[dwOffset];
+			if (pDirEntry->bEntryLength < ISO9660_DIR_ENTRY_MIN_SIZE || pDirEntry->bEntryLength > dwSize - dwOffset ||
+				ISO9660_DIR_ENTRY_MIN_SIZE + (BYTE)pDirEntry->bFileIdentifierLength > pDirEntry->bEntryLength ||
+				(dwParentIndex != ISO9660_NO_PARENT_ENTRY && dwParentIndex >= i))
+				goto Corrupt;
+			dwOffset += pDirEntry->bEntryLength;
+
+			// Create the entry, which will automatically add it to the parent's list of children.
+			FileSystemDirectoryEntry *pEntry = new FileSystemDirectoryEntry(pDirEntry,
+				(dwParentIndex == ISO9660_NO_PARENT_ENTRY ? nullptr : vEntries[dwParentIndex]));
+			vEntries.push_back(pEntry);
+			if (dwParentIndex == ISO9660_NO_PARENT_ENTRY)
+				this->lDirectoryEntries.push_back(pEntry);
+
+			// Check if we should print the entry information.
+			if (bVerbose == true)
+				printf("%d\t\t%d\t\t%s%s\n", pEntry->GetExtentLBA(), pEntry->GetExtentSize(), pEntry->GetFullName(), (pEntry->IsDirectory() == true ? "\\.." : ""));
+		}
+
+		// There should be nothing left over.
+		if (dwOffset != dwSize)
+			goto Corrupt;
+
+		if (bVerbose == true)
+			printf("restored %d directory entries from index\n\n", dwEntryCount);
+		return true;
+
+	Corrupt:
+		// Throw away the partially restored tree.
+		printf("ISO9660::LoadISOFromIndex(): directory records are corrupt!\n");
+		for (size_t i = 0; i < vEntries.size(); i++)
+			delete vEntries[i];
+		this->lDirectoryEntries.clear();
+		delete[] this->m_pbIndexRecords;
+		this->m_pbIndexRecords = nullptr;
+		return false;
+	}
+
+	void ISO9660::ExportDirectoryRecords(std::vector<BYTE> *pvRecords, DWORD *pdwEntryCount)
+	{
+		// Flatten each of the root entries.
+		pvRecords->clear();
+		*pdwEntryCount = 0;
+		for (std::list<FileSystemDirectoryEntry*>::const_iterator iter = this->lDirectoryEntries.begin();
+			iter != this->lDirectoryEntries.end(); ++iter)
+			ExportDirectoryEntry(*iter, ISO9660_NO_PARENT_ENTRY, pvRecords, pdwEntryCount);
+	}
+
+	void ISO9660::ExportDirectoryEntry(FileSystemDirectoryEntry *pEntry, DWORD dwParentIndex, std::vector<BYTE> *pvRecords, DWORD *pdwEntryCount)
+	{
+		// Append the parent index and the raw directory record.
+		DWORD dwIndex = (*pdwEntryCount)++;
+		const BYTE *pbParentIndex = (const BYTE*)&dwParentIndex;
+		const BYTE *pbRecord = (const BYTE*)pEntry->pValue;
+		pvRecords->insert(pvRecords->end(), pbParentIndex, pbParentIndex + sizeof(DWORD));
+		pvRecords->insert(pvRecords->end(), pbRecord, pbRecord + pEntry->pValue->bEntryLength);
+
+		// Append the children after their parent.
+		for (std::list<FileSystemDirectoryEntry*>::const_iterator iter = pEntry->lChildEntries.begin();
+			iter != pEntry->lChildEntries.end(); ++iter)
+			ExportDirectoryEntry(*iter, dwIndex, pvRecords, pdwEntryCount);
+	}
+
+	bool ISO9660::ReadDirectoryBlock(ISO9660_DirectoryEntry *pDirectoryEntry, FileSystemDirectoryEntry *pParentDirectory, bool bVerbose)
+	{
+		// Check if this directory entry has already been cached.
+		FileSystemSectorCacheEntry *pCacheEntry = (FileSystemSectorCacheEntry*)FindCacheEntry(pDirectoryEntry->dwExtentLBA.LE);
+		if (pCacheEntry != nullptr)
+		{
+			// The directory entry has already been cached so there is nothing to do here.
+			return true;
+		}
+
+		// Create a new FileSystemDirectoryEntry object for the directory entry provided.
+		FileSystemDirectoryEntry *pFsDirectoryEntry = new FileSystemDirectoryEntry(pDirectoryEntry, pParentDirectory);
+		if (bVerbose == true)
+		{
+			// Print the folder name.
+			if (pFsDirectoryEntry->IsDirectory() == true)
+				printf("%d\t\t%d\t\t%s\\..\n", pFsDirectoryEntry->GetExtentLBA(), pFsDirectoryEntry->GetExtentSize(), pFsDirectoryEntry->GetFullName());
+		}
+
+		// The directory entry has not been cached yet so add it to the directory cache.
+		if (AddToCache(pFsDirectoryEntry, &pCacheEntry) == false)
+		{
+			// Failed to cache directory entry data.
+			delete pDirectoryEntry;
+			return false;
+		}
+
+		// If this is a root entry then add it to our list of root directory entries.
+		if (pParentDirectory == nullptr)
+		{
+			// This is a root entry so add it to the root list.
+			this->lDirectoryEntries.push_back(pFsDirectoryEntry);
+		}
+
+		// Initialize the loop counter and interator.
+		DWORD dwRemainingData = pDirectoryEntry->dwExtentSize.LE;
+		PBYTE pbCacheData = pCacheEntry->pbSectorData;
+
+		// Loop through the directory sectors until we reach the last directory entry.
+		do
+		{
+			// Get the next ISO9660 directory entry from the cache data.
+			ISO9660_DirectoryEntry *pDirEntry = (ISO9660_DirectoryEntry*)pbCacheData;
+
+			// Check if the current directory entry is valid or if we are on a sector boundary.
+			if (pDirEntry->bEntryLength == 0)
+			{
+				// Check if this next entry would cross a sector boundary.
+				DWORD dwRemainder = dwRemainingData % ISO9660_SECTOR_SIZE;
+				if (dwRemainder > 0 && dwRemainder < ISO9660_DIR_ENTRY_MAX_SIZE)
+				{
+					// Skip to the next sector.
+					dwRemainingData -= dwRemainder;
+					pbCacheData += dwRemainder;
+
+					// Check to see if there is any remaining data left to be parsed.
+					if (dwRemainingData <= 0)
+						break;
+
+					// Update the entry pointer.
+					pDirEntry = (ISO9660_DirectoryEntry*)pbCacheData;
+				}
+
+				// Double check we now have a valid entry to work with.
+				if (pDirEntry->bEntryLength == 0)
+					break;
+			}
+
+			// Check if this entry is a directory or a file.
+			if ((pDirEntry->bFileFlags & FileFlags::FileIsDirectory) != 0)
+			{
+				// Make sure we don't print the entry for the "./" file entry.
+				if (pDirEntry->dwExtentLBA.LE != pDirectoryEntry->dwExtentLBA.LE)
+				{
+					// Recursively parse the child directory.
+					if (ReadDirectoryBlock(pDirEntry, pFsDirectoryEntry, bVerbose) == false)
+					{
+						// Failed to read child directory entry data.
+						return false;
+					}
+				}
+			}
+			else
+			{
+				// Setup the fs child entry which will automatically add it to the parent's list of children.
+				FileSystemDirectoryEntry *pEntry = new FileSystemDirectoryEntry(pDirEntry, pFsDirectoryEntry);
+
+				// Check if we should print the file information.
+				if (bVerbose == true)
+					printf("%d\t\t%d\t\t%s\n", pDirEntry->dwExtentLBA.LE, pDirEntry->dwExtentSize.LE, pEntry->GetFullName());
+			}
+
+			// Next entry.
+			dwRemainingData -= pDirEntry->bEntryLength;
+			pbCacheData += pDirEntry->bEntryLength;
+		} while (dwRemainingData > 0);
+
+		// Successfully parsed the file system for this directory entry.
+		return true;
+	}
+
+	bool ISO9660::AddToCache(FileSystemDirectoryEntry *pDirectoryEntry, FileSystemSectorCacheEntry **ppCacheEntry)
+	{
+
+		// Check to see if there is already a cache entry for this directory.
+		*ppCacheEntry = (FileSystemSectorCacheEntry*)FindCacheEntry(pDirectoryEntry->pValue->dwExtentLBA.LE);
+		if (*ppCacheEntry != nullptr)
+		{
+			// There is already a cache entry for this directory entry, so we are done here.
+			return true;
+		}
+
+		// Initialize a new FileSystemSectorCacheEntry object.
+		FileSystemSectorCacheEntry *pCacheEntry = new FileSystemSectorCacheEntry();
+		pCacheEntry->dwExtentLBA = pDirectoryEntry->pValue->dwExtentLBA.LE;
+		pCacheEntry->dwExtentSize = pDirectoryEntry->pValue->dwExtentSize.LE;
+		pCacheEntry->sFileIdentifier = pDirectoryEntry->sName;
+		pCacheEntry->bIsView = false;
+
+		// Make sure the directory extent is inside of the image, a corrupt directory record could point anywhere.
+		ULONGLONG qwDataOffset = 0;
+		if (pCacheEntry->dwExtentLBA < this->m_dwLBA ||
+			SafeMultiply64(pCacheEntry->dwExtentLBA - this->m_dwLBA, ISO9660_SECTOR_SIZE, &qwDataOffset) == false ||
+			qwDataOffset > this->m_qwFileSize || pCacheEntry->dwExtentSize > this->m_qwFileSize - qwDataOffset)
+		{
+			// The directory extent is invalid.
+			printf("ISO9660::AddToCache(): directory extent for entry '%s' lies outside of the image!\n",
+				pCacheEntry->sFileIdentifier);
+			goto Cleanup;
+		}
+
+		// If the track is memory mapped and the directory sectors are contiguous in the image we can parse the
+		// directory records in place instead of copying them into a cache buffer.
+		if (this->m_phTrackHandle != nullptr)
+		{
+			DiskJuggler::CdiSectorView sView;
+			DWORD dwSectorCount = (pCacheEntry->dwExtentSize + ISO9660_SECTOR_SIZE - 1) / ISO9660_SECTOR_SIZE;
+			if (this->m_phTrackHandle->ReadDataView(pCacheEntry->dwExtentLBA - this->m_dwLBA, dwSectorCount, &sView) == true &&
+				sView.IsContiguous() == true)
+			{
+				// Point the cache entry at the mapped directory data.
+				pCacheEntry->pbSectorData = sView.pbData;
+				pCacheEntry->bIsView = true;
+
+				// Add the new cache entry object to the list.
+				this->lSectorCache.push_back(pCacheEntry);
+				*ppCacheEntry = pCacheEntry;
+				return true;
+			}
+		}
+
+		// Allocate the cache buffer for the directory entry.
+		pCacheEntry->pbSectorData = (PBYTE)AlignedAlloc(pCacheEntry->dwExtentSize);
+		if (pCacheEntry->pbSectorData == NULL)
+		{
+			// Failed to allocate cache buffer.
+			printf("ISO9660::AddToCache(): failed to allocate cache buffer for entry '%s'!\n",
+				pCacheEntry->sFileIdentifier);
+			goto Cleanup;
+		}
+
+		// Check if we are reading from a file or from a CDI image.
+		if (this->m_pFileDevice != nullptr)
+		{
+			// Read the directory data into the cache buffer.
+			if (this->m_pFileDevice->ReadAt(qwDataOffset, pCacheEntry->pbSectorData, pCacheEntry->dwExtentSize) == false)
+			{
+				// Failed to read the directory data into the cache buffer.
+				printf("ISO9660::AddToCache(): failed to read directory data for entry '%s'!\n",
+					pCacheEntry->sFileIdentifier);
+				goto Cleanup;
+			}
+		}
+		else
+		{
+			// Read the directory data into the cache buffer.
+			if (this->m_phTrackHandle->ReadData(pCacheEntry->dwExtentLBA - this->m_dwLBA, 
+				pCacheEntry->pbSectorData, pCacheEntry->dwExtentSize) == false)
+			{
+				// Failed to read the directory data into the cache buffer.
+				printf("ISO9660::AddToCache(): failed to read directory data for entry '%s'!\n",
+					pCacheEntry->sFileIdentifier);
+				goto Cleanup;
+			}
+		}
+
+		// Add the new cache entry object to the list.
+		this->lSectorCache.push_back(pCacheEntry);
+
+		// Successfully cached the directory data, assign the cache entry pointer and return true.
+		*ppCacheEntry = pCacheEntry;
+		return true;
+
+	Cleanup:
+		if (pCacheEntry)
+		{
+			// Check if the cache buffer was allocated.
+			if (pCacheEntry->pbSectorData && pCacheEntry->bIsView == false)
+				AlignedFree(pCacheEntry->pbSectorData);
+
+			// Free the cache entry object.
+			delete pCacheEntry;
+		}
+
+		// Done with errors, return false.
+		return false;
+	}
+
+	const FileSystemSectorCacheEntry* ISO9660::FindCacheEntry(DWORD dwLBA)
+	{
+		// Search the directory list for an entry with the target LBA.
+		for (std::list<FileSystemSectorCacheEntry*>::const_iterator iter = this->lSectorCache.begin(); 
+			iter != this->lSectorCache.end(); ++iter)
+		{
+			// Check if the current cache entry has the same LBA as what we are searching for.
+			if ((*iter)->dwExtentLBA == dwLBA)
+				return (*iter);
+		}
+
+		// No cache entry with the target LBA was found.
+		return nullptr;
+	}
+
+	bool ISO9660::GetExtentOffset(FileSystemDirectoryEntry *pEntry, ULONGLONG *pqwDataOffset)
+	{
+		// Make sure the extent is inside of the image, a corrupt directory record could point anywhere.
+		DWORD dwExtentLBA = pEntry->GetExtentLBA();
+		if (dwExtentLBA < this->m_dwLBA ||
+			SafeMultiply64(dwExtentLBA - this->m_dwLBA, ISO9660_SECTOR_SIZE, pqwDataOffset) == false ||
+			*pqwDataOffset > this->m_qwFileSize || pEntry->GetExtentSize() > this->m_qwFileSize - *pqwDataOffset)
+		{
+			// The extent is invalid.
+			printf("ISO9660: extent for entry '%s' lies outside of the image!\n", pEntry->GetFullName());
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ISO9660::ReadImageData(ULONGLONG qwOffset, PBYTE pbBuffer, DWORD dwSize)
+	{
+		// Check if we are reading from a file or from a CDI image.
+		if (this->m_pFileDevice != nullptr)
+			return this->m_pFileDevice->ReadAt(qwOffset, pbBuffer, dwSize);
+		else
+			return this->m_phTrackHandle->ReadBytes(qwOffset, pbBuffer, dwSize);
+	}
+
+	bool ISO9660::ReadFileBatch(FileSystemReadRequest *psRequests, DWORD dwCount)
+	{
+		// Check the extent of each file, only files inside of the image are read.
+		bool bResult = true;
+		std::vector<DiskJuggler::CdiReadSegment> vSegments;
+		std::vector<DWORD> vSegmentRequests;
+		for (DWORD i = 0; i < dwCount; i++)
+		{
+			ULONGLONG qwDataOffset;
+			psRequests[i].bSuccess = false;
+			if (GetExtentOffset(psRequests[i].pEntry, &qwDataOffset) == false)
+			{
+				bResult = false;
+				continue;
+			}
+
+			// Files in an ISO file are read one at a time, there is nothing to merge.
+			if (this->m_pFileDevice != nullptr)
+			{
+				psRequests[i].bSuccess = this->m_pFileDevice->ReadAt(qwDataOffset, psRequests[i].pbBuffer, psRequests[i].pEntry->GetExtentSize());
+				if (psRequests[i].bSuccess == false)
+					bResult = false;
+				continue;
+			}
+
+			// Add a segment for the file to the vectored read.
+			DiskJuggler::CdiReadSegment sSegment;
+			sSegment.dwLBA = psRequests[i].pEntry->GetExtentLBA() - this->m_dwLBA;
+			sSegment.dwSize = psRequests[i].pEntry->GetExtentSize();
+			sSegment.pbBuffer = psRequests[i].pbBuffer;
+			sSegment.bSuccess = false;
+			vSegments.push_back(sSegment);
+			vSegmentRequests.push_back(i);
+		}
+
+		// Read all of the files on the CDI track in one go.
+		if (vSegments.size() > 0)
+		{
+			if (this->m_phTrackHandle->ReadVector(vSegments.data(), (DWORD)vSegments.size()) == false)
+				bResult = false;
+
+			for (size_t i = 0; i < vSegments.size(); i++)
+				psRequests[vSegmentRequests[i]].bSuccess = vSegments[i].bSuccess;
+		}
+
+		return bResult;
+	}
+
+	bool ISO9660::CreateDirectoryTree(FileSystemDirectoryEntry *pEntry, CString sOutputFolder, std::vector<FileSystemDirectoryEntry*> *pvFiles)
+	{
+		// Files are collected to be extracted later.
+		if (pEntry->IsDirectory() == false)
+		{
+			pvFiles->push_back(pEntry);
+			return true;
+		}
+
+		// Create the folder for the directory, the root directory is the output folder itself.
+		if (pEntry->pParentEntry != nullptr)
+		{
+			CString sFolder = sOutputFolder + pEntry->GetFullName();
+			if (CreateDirectory(sFolder, NULL) == 0 && GetLastError() != ERROR_ALREADY_EXISTS)
+			{
+				// Failed to create the folder.
+				printf("ISO9660::ExtractFileSystem(): error creating folder '%s'!\n", sFolder);
+				return false;
+			}
+		}
+
+		// Create the folders for all of the children.
+		for (std::list<FileSystemDirectoryEntry*>::const_iterator iter = pEntry->lChildEntries.begin();
+			iter != pEntry->lChildEntries.end(); ++iter)
+		{
+			if (CreateDirectoryTree(*iter, sOutputFolder, pvFiles) == false)
+				return false;
+		}
+
+		return true;
+	}
+
+	bool ISO9660::WriteFileData(FileSystemDirectoryEntry *pEntry, CString sOutputFolder, PBYTE pbData, DWORD dwSize)
+	{
+		// Create the output file.
+		CString sFileName = sOutputFolder + pEntry->GetFullName();
+		IO::BlockDevice *pOutputFile = IO::OpenFileDevice(sFileName, IO::BlockDeviceAccess::CreateAlways);
+		if (pOutputFile == nullptr)
+		{
+			// Print error and return.
+			printf("ISO9660::ExtractFileSystem(): failed to create output file '%s'!\n", sFileName);
+			return false;
+		}
+
+		// Write the file data.
+		bool bResult = (dwSize == 0 || pOutputFile->WriteAt(0, pbData, dwSize) == true);
+		if (bResult == false)
+			printf("ISO9660::ExtractFileSystem(): failed to write output file '%s'!\n", sFileName);
+
+		delete pOutputFile;
+		return bResult;
+	}
+
+	bool ISO9660::ExtractFileSystem(CString sOutputFolder, bool bVerbose)
+	{
+		// Create the folder tree and collect all of the files.
+		std::vector<FileSystemDirectoryEntry*> vFiles;
+		for (std::list<FileSystemDirectoryEntry*>::const_iterator iter = this->lDirectoryEntries.begin();
+			iter != this->lDirectoryEntries.end(); ++iter)
+		{
+			if (CreateDirectoryTree(*iter, sOutputFolder, &vFiles) == false)
+				return false;
+		}
+
+		// Sort the files by extent so each batch covers a contiguous part of the disc.
+		std::sort(vFiles.begin(), vFiles.end(), [](FileSystemDirectoryEntry *a, FileSystemDirectoryEntry *b) { return a->GetExtentLBA() < b->GetExtentLBA(); });
+
+		// Allocate the batch buffer.
+		PBYTE pbBatchBuffer = (PBYTE)AlignedAlloc(ISO9660_EXTRACT_BATCH_SIZE);
+		if (pbBatchBuffer == NULL)
+		{
+			// Failed to allocate the batch buffer, out of memory.
+			printf("ISO9660::ExtractFileSystem(): failed to allocate batch buffer!\n");
+			return false;
+		}
+
+		// Loop through all of the files and extract them in batches.
+		bool bResult = true;
+		DWORD dwFilesExtracted = 0;
+		std::vector<FileSystemReadRequest> vBatch;
+		size_t nIndex = 0;
+		while (nIndex < vFiles.size())
+		{
+			// Files too large to share the batch buffer are copied on their own a chunk at a time.
+			FileSystemDirectoryEntry *pEntry = vFiles[nIndex];
+			ULONGLONG qwDataOffset;
+			if (pEntry->GetExtentSize() > ISO9660_EXTRACT_BATCH_SIZE)
+			{
+				IO::BlockDevice *pOutputFile = nullptr;
+				bool bFileResult = (GetExtentOffset(pEntry, &qwDataOffset) == true);
+				if (bFileResult == true)
+				{
+					pOutputFile = IO::OpenFileDevice(sOutputFolder + pEntry->GetFullName(), IO::BlockDeviceAccess::CreateAlways);
+					bFileResult = (pOutputFile != nullptr);
+				}
+
+				for (DWORD dwOffset = 0; dwOffset < pEntry->GetExtentSize() && bFileResult == true; dwOffset += ISO9660_EXTRACT_BATCH_SIZE)
+				{
+					DWORD dwChunkSize = (pEntry->GetExtentSize() - dwOffset < ISO9660_EXTRACT_BATCH_SIZE ? pEntry->GetExtentSize() - dwOffset : ISO9660_EXTRACT_BATCH_SIZE);
+					bFileResult = (ReadImageData(qwDataOffset + dwOffset, pbBatchBuffer, dwChunkSize) == true &&
+						pOutputFile->WriteAt(dwOffset, pbBatchBuffer, dwChunkSize) == true);
+				}
+
+				if (pOutputFile != nullptr)
+					delete pOutputFile;
+
+				if (bFileResult == false)
+				{
+					printf("ISO9660::ExtractFileSystem(): failed to extract file '%s'!\n", pEntry->GetFullName());
+					bResult = false;
+				}
+				else
+				{
+					if (bVerbose == true)
+						printf("%d\t\t%d\t\t%s\n", pEntry->GetExtentLBA(), pEntry->GetExtentSize(), pEntry->GetFullName());
+					dwFilesExtracted++;
+				}
+
+				nIndex++;
+				continue;
+			}
+
+			// Fill the batch buffer with as many files as will fit.
+			DWORD dwBatchSize = 0;
+			vBatch.clear();
+			while (nIndex < vFiles.size() && vFiles[nIndex]->GetExtentSize() <= ISO9660_EXTRACT_BATCH_SIZE - dwBatchSize)
+			{
+				FileSystemReadRequest sRequest;
+				sRequest.pEntry = vFiles[nIndex];
+				sRequest.pbBuffer = &pbBatchBuffer[dwBatchSize];
+				sRequest.bSuccess = false;
+				vBatch.push_back(sRequest);
+
+				dwBatchSize += vFiles[nIndex]->GetExtentSize();
+				nIndex++;
+			}
+
+			// Read the whole batch and write out each file.
+			if (ReadFileBatch(vBatch.data(), (DWORD)vBatch.size()) == false)
+				bResult = false;
+
+			for (size_t i = 0; i < vBatch.size(); i++)
+			{
+				if (vBatch[i].bSuccess == false)
+				{
+					printf("ISO9660::ExtractFileSystem(): failed to read file '%s'!\n", vBatch[i].pEntry->GetFullName());
+					continue;
+				}
+
+				if (WriteFileData(vBatch[i].pEntry, sOutputFolder, vBatch[i].pbBuffer, vBatch[i].pEntry->GetExtentSize()) == false)
+				{
+					bResult = false;
+					continue;
+				}
+
+				if (bVerbose == true)
+					printf("%d\t\t%d\t\t%s\n", vBatch[i].pEntry->GetExtentLBA(), vBatch[i].pEntry->GetExtentSize(), vBatch[i].pEntry->GetFullName());
+				dwFilesExtracted++;
+			}
+		}
+
+		// Free the batch buffer.
+		AlignedFree(pbBatchBuffer);
+
+		printf("extracted %d of %d files\n", dwFilesExtracted, (DWORD)vFiles.size());
+		return bResult;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,347 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	Iso9660Relocator.cpp - Moves an ISO 9660 file system on a CDI track to a new
+		starting LBA while the track is streamed.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#include "../stdafx.h"
+#include "Iso9660Relocator.h"
+#include "../Misc/Utilities.h"
+#include <algorithm>
+
+namespace ISO
+{
+	ISO9660Relocator::ISO9660Relocator()
+	{
+		// Initialize fields.
+		this->m_dwSourceLBA = 0;
+		this->m_dwTargetLBA = 0;
+		this->m_dwTrackLength = 0;
+		this->m_dwHeaderSectorCount = 0;
+		this->m_dwOverlayIndex = 0;
+		this->m_itNextDirectory = this->m_sDirectories.end();
+		this->m_dwDirectoryEnd = 0;
+		this->m_dwNextSector = 0;
+		this->m_dwRelocatedCount = 0;
+	}
+
+	DWORD ISO9660Relocator::RelocateLBA(DWORD dwLBA)
+	{
+		// Leave anything in front of the image alone.
+		if (dwLBA < this->m_dwSourceLBA)
+			return dwLBA;
+
+		this->m_dwRelocatedCount++;
+		return dwLBA - this->m_dwSourceLBA + this->m_dwTargetLBA;
+	}
+
+	bool ISO9660Relocator::RelocateDirectoryRecord(ISO9660_DirectoryEntry *pDirEntry, bool bAddDirectory)
+	{
+		// If this is a sub directory make sure we relocate its records when we get to them.
+		DWORD dwLBA = pDirEntry->dwExtentLBA.LE;
+		if (bAddDirectory == true && (pDirEntry->bFileFlags & FileFlags::FileIsDirectory) != 0 && AddDirectory(dwLBA) == false)
+			return false;
+
+		// Update both copies of the extent LBA.
+		DWORD dwNewLBA = RelocateLBA(dwLBA);
+		pDirEntry->dwExtentLBA.LE = dwNewLBA;
+		pDirEntry->dwExtentLBA.BE = ByteFlip32(dwNewLBA);
+		return true;
+	}
+
+	bool ISO9660Relocator::AddDirectory(DWORD dwLBA)
+	{
+		// Directories have to be on the track we are streaming for us to relocate them.
+		if (dwLBA < this->m_dwSourceLBA || dwLBA - this->m_dwSourceLBA >= this->m_dwTrackLength)
+		{
+			printf("ISO9660Relocator: directory at LBA %d lies outside of the track!\n", dwLBA);
+			return false;
+		}
+
+		// Check if we already know about this directory.
+		DWORD dwSector = dwLBA - this->m_dwSourceLBA;
+		std::pair<std::set<DWORD>::iterator, bool> sResult = this->m_sDirectories.insert(dwSector);
+		if (sResult.second == false)
+			return true;
+
+		// If the directory has already been streamed it's too late to relocate it.
+		if (dwSector < this->m_dwNextSector)
+		{
+			printf("ISO9660Relocator: directory at LBA %d comes before its parent and can't be relocated in a single pass!\n", dwLBA);
+			return false;
+		}
+
+		// Keep the iterator pointing at the closest directory ahead of us.
+		if (this->m_itNextDirectory == this->m_sDirectories.end() || dwSector < *this->m_itNextDirectory)
+			this->m_itNextDirectory = sResult.first;
+
+		return true;
+	}
+
+	bool ISO9660Relocator::LoadPathTable(DiskJuggler::CdiTrackHandle *pTrackHandle, DWORD dwLBA, DWORD dwSize, bool bBigEndian)
+	{
+		// The optional path tables are 0 when they are not present.
+		if (dwLBA == 0)
+			return true;
+
+		// Make sure the path table is a sane size and lies inside of the track.
+		DWORD dwSectorCount = (dwSize + ISO9660_SECTOR_SIZE - 1) / ISO9660_SECTOR_SIZE;
+		if (dwSize == 0 || dwSize > ISO9660_RELOCATOR_MAX_PATH_TABLE_SIZE || dwLBA < this->m_dwSourceLBA ||
+			dwLBA - this->m_dwSourceLBA >= this->m_dwTrackLength || dwSectorCount > this->m_dwTrackLength - (dwLBA - this->m_dwSourceLBA))
+		{
+			printf("ISO9660Relocator::LoadPathTable(): path table at LBA %d is invalid!\n", dwLBA);
+			return false;
+		}
+
+		// Read the whole path table, entries can span sectors so it can't be relocated while it is streamed.
+		OverlayRange sRange;
+		sRange.dwSector = dwLBA - this->m_dwSourceLBA;
+		sRange.dwSectorCount = dwSectorCount;
+		sRange.dwDataOffset = (DWORD)this->m_vOverlayData.size();
+		this->m_vOverlayData.resize(this->m_vOverlayData.size() + dwSectorCount * ISO9660_SECTOR_SIZE);
+
+		PBYTE pbTable = &this->m_vOverlayData[sRange.dwDataOffset];
+		if (pTrackHandle->ReadData(sRange.dwSector, pbTable, dwSectorCount * ISO9660_SECTOR_SIZE) == false)
+		{
+			printf("ISO9660Relocator::LoadPathTable(): failed to read path table at LBA %d!\n", dwLBA);
+			return false;
+		}
+
+		// Loop through all of the entries and relocate them.
+		DWORD dwOffset = 0;
+		while (dwOffset + ISO9660_PATH_TABLE_ENTRY_MIN_SIZE <= dwSize)
+		{
+			// An empty identifier means we hit the padding at the end of the table.
+			ISO9660_PathTableEntry *pEntry = (ISO9660_PathTableEntry*)&pbTable[dwOffset];
+			if (pEntry->bIdentifierLength == 0)
+				break;
+
+			// Every entry in the path table is a directory.
+			DWORD dwEntryLBA = (bBigEndian == true ? ByteFlip32(pEntry->dwExtentLBA) : pEntry->dwExtentLBA);
+			if (AddDirectory(dwEntryLBA) == false)
+				return false;
+
+			DWORD dwNewLBA = RelocateLBA(dwEntryLBA);
+			pEntry->dwExtentLBA = (bBigEndian == true ? ByteFlip32(dwNewLBA) : dwNewLBA);
+
+			// Identifiers are padded to an even length.
+			dwOffset += ISO9660_PATH_TABLE_ENTRY_MIN_SIZE + pEntry->bIdentifierLength + (pEntry->bIdentifierLength & 1);
+		}
+
+		this->m_vOverlays.push_back(sRange);
+		return true;
+	}
+
+	bool ISO9660Relocator::RelocateDirectorySector(DWORD dwSector, PBYTE pbSector)
+	{
+		// Loop through all of the directory records in the sector, records never cross a sector boundary.
+		DWORD dwOffset = 0;
+		while (dwOffset < ISO9660_SECTOR_SIZE)
+		{
+			// A zero length means the rest of the sector is padding.
+			ISO9660_DirectoryEntry *pDirEntry = (ISO9660_DirectoryEntry*)&pbSector[dwOffset];
+			if (pDirEntry->bEntryLength == 0)
+				break;
+
+			// Make sure the record is sane before we touch it.
+			if (pDirEntry->bEntryLength < ISO9660_DIR_ENTRY_MIN_SIZE || pDirEntry->bEntryLength > ISO9660_SECTOR_SIZE - dwOffset ||
+				ISO9660_DIR_ENTRY_MIN_SIZE + (BYTE)pDirEntry->bFileIdentifierLength > pDirEntry->bEntryLength)
+			{
+				printf("ISO9660Relocator: directory record at LBA %d is corrupt!\n", this->m_dwSourceLBA + dwSector);
+				return false;
+			}
+
+			// The '.' and '..' records point at directories we already know about.
+			bool bSelfOrParent = (pDirEntry->bFileIdentifierLength == 1 && (BYTE)pDirEntry->sFileIdentifier[0] <= 1);
+			if (RelocateDirectoryRecord(pDirEntry, bSelfOrParent == false) == false)
+				return false;
+
+			dwOffset += pDirEntry->bEntryLength;
+		}
+
+		return true;
+	}
+
+	bool ISO9660Relocator::Prepare(DiskJuggler::CdiTrackHandle *pTrackHandle, DWORD dwTargetLBA)
+	{
+		// The track LBA is the LBA the image was mastered for.
+		this->m_dwSourceLBA = pTrackHandle->LBA();
+		this->m_dwTargetLBA = dwTargetLBA;
+		this->m_dwTrackLength = (DWORD)(pTrackHandle->TrackSize() / ISO9660_SECTOR_SIZE);
+
+		// Read all of the volume descriptors up to the set terminator.
+		std::vector<BYTE> vDescriptors;
+		DWORD dwDescriptorCount = 0;
+		while (true)
+		{
+			if (dwDescriptorCount == ISO9660_RELOCATOR_MAX_VOLUME_DESCRIPTORS)
+			{
+				printf("ISO9660Relocator::Prepare(): failed to find the volume descriptor set terminator!\n");
+				return false;
+			}
+
+			vDescriptors.resize((dwDescriptorCount + 1) * ISO9660_SECTOR_SIZE);
+			PBYTE pbDescriptor = &vDescriptors[dwDescriptorCount * ISO9660_SECTOR_SIZE];
+			if (pTrackHandle->ReadData(ISO9660_VOLUME_DESCRIPTORS_SECTOR + dwDescriptorCount, pbDescriptor, ISO9660_SECTOR_SIZE) == false)
+			{
+				printf("ISO9660Relocator::Prepare(): failed to read volume descriptor block!\n");
+				return false;
+			}
+
+			dwDescriptorCount++;
+			if (((ISO9660_VolumeDescriptor*)pbDescriptor)->bType == VolumeDescriptorTypes::VolumeDescriptorSetTerminator)
+				break;
+		}
+		this->m_dwHeaderSectorCount = ISO9660_VOLUME_DESCRIPTORS_SECTOR + dwDescriptorCount;
+
+		// Relocate the primary and supplementary volume descriptors, they share the same layout.
+		struct { DWORD dwLBA; DWORD dwSize; bool bBigEndian; } sPathTables[ISO9660_RELOCATOR_MAX_VOLUME_DESCRIPTORS * 4];
+		DWORD dwPathTableCount = 0;
+		for (DWORD i = 0; i < dwDescriptorCount; i++)
+		{
+			ISO9660_PrimaryVolumeDescriptor *pDesc = (ISO9660_PrimaryVolumeDescriptor*)&vDescriptors[i * ISO9660_SECTOR_SIZE];
+			if (pDesc->bType != VolumeDescriptorTypes::PrimaryVolumeDescriptor && pDesc->bType != VolumeDescriptorTypes::SupplementaryVolumeDescriptor)
+				continue;
+
+			// The volume space size counts every sector from LBA 0 when the image was mastered at an offset, which
+			// is the case when it is larger than the track.
+			DWORD dwVolumeSpaceSize = pDesc->dwVolumeSpaceSize.LE;
+			if (dwVolumeSpaceSize > this->m_dwTrackLength && dwVolumeSpaceSize >= this->m_dwSourceLBA)
+			{
+				dwVolumeSpaceSize = dwVolumeSpaceSize - this->m_dwSourceLBA + this->m_dwTargetLBA;
+				pDesc->dwVolumeSpaceSize.LE = dwVolumeSpaceSize;
+				pDesc->dwVolumeSpaceSize.BE = ByteFlip32(dwVolumeSpaceSize);
+			}
+
+			// Relocate the root directory record.
+			if (RelocateDirectoryRecord(&pDesc->sRootDirectoryEntry, true) == false)
+				return false;
+
+			// Relocate the path table LBAs, the tables themselves are loaded once we are done with the descriptors.
+			int *pPathTableLBAs[4] = { &pDesc->dwTypeLPathTableLBA, &pDesc->dwOptionalTypeLPathTableLBA, &pDesc->dwTypeMPathTableLBA, &pDesc->dwOptionalTypeMPathTableLBA };
+			for (DWORD x = 0; x < 4; x++)
+			{
+				bool bBigEndian = (x >= 2);
+				DWORD dwLBA = (bBigEndian == true ? ByteFlip32(*pPathTableLBAs[x]) : *pPathTableLBAs[x]);
+				if (dwLBA == 0)
+					continue;
+
+				sPathTables[dwPathTableCount].dwLBA = dwLBA;
+				sPathTables[dwPathTableCount].dwSize = pDesc->dwPathTableSize.LE;
+				sPathTables[dwPathTableCount++].bBigEndian = bBigEndian;
+
+				DWORD dwNewLBA = RelocateLBA(dwLBA);
+				*pPathTableLBAs[x] = (bBigEndian == true ? ByteFlip32(dwNewLBA) : dwNewLBA);
+			}
+		}
+
+		// The relocated volume descriptors replace the ones on the track.
+		OverlayRange sRange;
+		sRange.dwSector = ISO9660_VOLUME_DESCRIPTORS_SECTOR;
+		sRange.dwSectorCount = dwDescriptorCount;
+		sRange.dwDataOffset = 0;
+		this->m_vOverlays.push_back(sRange);
+		this->m_vOverlayData = vDescriptors;
+
+		// Load and relocate all of the path tables.
+		for (DWORD i = 0; i < dwPathTableCount; i++)
+		{
+			if (LoadPathTable(pTrackHandle, sPathTables[i].dwLBA, sPathTables[i].dwSize, sPathTables[i].bBigEndian) == false)
+				return false;
+		}
+
+		// Sort the overlays by sector and make sure none of them overlap.
+		std::sort(this->m_vOverlays.begin(), this->m_vOverlays.end(), [](const OverlayRange& a, const OverlayRange& b) { return a.dwSector < b.dwSector; });
+		for (size_t i = 1; i < this->m_vOverlays.size(); i++)
+		{
+			if (this->m_vOverlays[i].dwSector < this->m_vOverlays[i - 1].dwSector + this->m_vOverlays[i - 1].dwSectorCount)
+			{
+				printf("ISO9660Relocator::Prepare(): path tables overlap at LBA %d!\n", this->m_dwSourceLBA + this->m_vOverlays[i].dwSector);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool ISO9660Relocator::RelocateSectors(DWORD dwSector, PBYTE pbSectors, DWORD dwSectorCount)
+	{
+		// Sectors have to come in order, directories are found as their parents are streamed.
+		if (dwSector != this->m_dwNextSector)
+		{
+			printf("ISO9660Relocator::RelocateSectors(): expected sector %d but got sector %d!\n", this->m_dwNextSector, dwSector);
+			return false;
+		}
+
+		// Loop through all of the sectors, most of them are file data and are left alone.
+		for (DWORD i = 0; i < dwSectorCount; i++)
+		{
+			DWORD dwCurrentSector = dwSector + i;
+			PBYTE pbSector = &pbSectors[i * ISO9660_SECTOR_SIZE];
+			this->m_dwNextSector = dwCurrentSector + 1;
+
+			// Skip past any overlays that are behind us.
+			while (this->m_dwOverlayIndex < this->m_vOverlays.size() &&
+				this->m_vOverlays[this->m_dwOverlayIndex].dwSector + this->m_vOverlays[this->m_dwOverlayIndex].dwSectorCount <= dwCurrentSector)
+				this->m_dwOverlayIndex++;
+			bool bOverlay = (this->m_dwOverlayIndex < this->m_vOverlays.size() && this->m_vOverlays[this->m_dwOverlayIndex].dwSector <= dwCurrentSector);
+
+			// Check if this sector starts a directory.
+			if (this->m_itNextDirectory != this->m_sDirectories.end() && *this->m_itNextDirectory <= dwCurrentSector)
+			{
+				// Directories must start on their own sectors.
+				ISO9660_DirectoryEntry *pSelf = (ISO9660_DirectoryEntry*)pbSector;
+				if (*this->m_itNextDirectory < dwCurrentSector || dwCurrentSector < this->m_dwDirectoryEnd || bOverlay == true ||
+					pSelf->bEntryLength < ISO9660_DIR_ENTRY_MIN_SIZE)
+				{
+					printf("ISO9660Relocator: directory at LBA %d overlaps other file system structures!\n", this->m_dwSourceLBA + *this->m_itNextDirectory);
+					return false;
+				}
+
+				// The '.' record holds the size of the directory.
+				DWORD dwDirectorySectors = ((DWORD)pSelf->dwExtentSize.LE + ISO9660_SECTOR_SIZE - 1) / ISO9660_SECTOR_SIZE;
+				this->m_dwDirectoryEnd = dwCurrentSector + (dwDirectorySectors > 0 ? dwDirectorySectors : 1);
+				++this->m_itNextDirectory;
+			}
+
+			// Replace volume descriptor and path table sectors with the relocated copies.
+			if (bOverlay == true)
+			{
+				const OverlayRange *pRange = &this->m_vOverlays[this->m_dwOverlayIndex];
+				memcpy(pbSector, &this->m_vOverlayData[pRange->dwDataOffset + (dwCurrentSector - pRange->dwSector) * ISO9660_SECTOR_SIZE], ISO9660_SECTOR_SIZE);
+			}
+
+			// Relocate the records of the directory we are in.
+			else if (dwCurrentSector < this->m_dwDirectoryEnd && RelocateDirectorySector(dwCurrentSector, pbSector) == false)
+				return false;
+		}
+
+		return true;
+	}
+
+	bool ISO9660Relocator::Finish()
+	{
+		// Every directory should have been streamed by now.
+		if (this->m_itNextDirectory != this->m_sDirectories.end())
+		{
+			printf("ISO9660Relocator::Finish(): directory at LBA %d was never relocated!\n", this->m_dwSourceLBA + *this->m_itNextDirectory);
+			return false;
+		}
+
+		return true;
+	}
+
+	DWORD ISO9660Relocator::GetHeaderSectorCount()
+	{
+		return this->m_dwHeaderSectorCount;
+	}
+
+	DWORD ISO9660Relocator::GetRelocatedCount()
+	{
+		return this->m_dwRelocatedCount;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,158 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	Iso9660Relocator.h - Moves an ISO 9660 file system on a CDI track to a new
+		starting LBA while the track is streamed.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+#include "Iso9660Types.h"
+#include "Iso9660.h"
+#include <set>
+#include <vector>
+
+namespace ISO
+{
+	// Maximum number of volume descriptors read before giving up on finding the set terminator.
+#define ISO9660_RELOCATOR_MAX_VOLUME_DESCRIPTORS	32
+
+	// Largest path table that will be loaded, path tables are relocated in memory before the track is streamed.
+#define ISO9660_RELOCATOR_MAX_PATH_TABLE_SIZE		0x400000
+
+	//-----------------------------------------------------
+	// ISO9660Relocator
+	//-----------------------------------------------------
+	/*
+		Relocates the LBAs in the volume descriptors, path tables and directory records of an ISO image so it can
+		be written out at a different starting LBA. The volume descriptors and path tables are read and relocated by
+		Prepare(), directory sectors are relocated in place as the track is streamed through RelocateSectors(), so
+		only the small parts of the file system that can't be patched one sector at a time are held in memory.
+	*/
+	class ISO9660Relocator
+	{
+	protected:
+		/*
+			Run of sectors that is replaced with a relocated copy held in memory.
+		*/
+		struct OverlayRange
+		{
+			DWORD		dwSector;			// First sector of the run, relative to the start of the track
+			DWORD		dwSectorCount;		// Number of sectors in the run
+			DWORD		dwDataOffset;		// Offset of the relocated sectors in m_vOverlayData
+		};
+
+		DWORD		m_dwSourceLBA;			// LBA the ISO image is mastered for
+		DWORD		m_dwTargetLBA;			// LBA the ISO image is being moved to
+		DWORD		m_dwTrackLength;		// Number of sectors in the track
+		DWORD		m_dwHeaderSectorCount;	// Number of sectors up to and including the volume descriptor set terminator
+
+		// Volume descriptors and path tables.
+		std::vector<OverlayRange>	m_vOverlays;		// Runs of relocated sectors, sorted by sector
+		std::vector<BYTE>			m_vOverlayData;		// Relocated sector data for m_vOverlays
+		size_t		m_dwOverlayIndex;		// Index of the first overlay that has not been passed yet
+
+		// Directories.
+		std::set<DWORD>				m_sDirectories;		// First sector of every directory found, relative to the start of the track
+		std::set<DWORD>::iterator	m_itNextDirectory;	// First directory that has not been reached yet
+		DWORD		m_dwDirectoryEnd;		// Sector following the directory being streamed
+
+		DWORD		m_dwNextSector;			// Sector RelocateSectors() expects next
+		DWORD		m_dwRelocatedCount;		// Number of LBAs relocated so far
+
+		/*
+			Description: Moves an LBA that points into the ISO image to the new starting LBA. LBAs in front of the
+				image, such as the zero extent of an empty file, are left alone.
+		*/
+		DWORD RelocateLBA(DWORD dwLBA);
+
+		/*
+			Description: Relocates the extent of a directory record and records the extent as a directory if the
+				record is a sub directory.
+
+			Returns: True if the record was relocated, false if it points at a directory that can't be relocated.
+		*/
+		bool RelocateDirectoryRecord(ISO9660_DirectoryEntry *pDirEntry, bool bAddDirectory);
+
+		/*
+			Description: Records the extent of a directory so its sectors are relocated when they are streamed.
+
+			Parameters:
+				dwLBA: LBA of the directory extent as stored in the ISO image.
+
+			Returns: True if the directory was added, false if it lies outside of the track or has already been streamed.
+		*/
+		bool AddDirectory(DWORD dwLBA);
+
+		/*
+			Description: Reads a path table, relocates every entry in it and adds it to the overlays.
+
+			Parameters:
+				pTrackHandle: Track handle to read the path table from.
+				dwLBA: LBA of the path table as stored in the ISO image, 0 if the volume descriptor has none.
+				dwSize: Size of the path table in bytes.
+				bBigEndian: True for a type M path table, false for a type L path table.
+
+			Returns: True if the path table was relocated, false otherwise.
+		*/
+		bool LoadPathTable(DiskJuggler::CdiTrackHandle *pTrackHandle, DWORD dwLBA, DWORD dwSize, bool bBigEndian);
+
+		/*
+			Description: Relocates every directory record in a directory sector.
+
+			Returns: True if the sector was relocated, false if a directory record is corrupt.
+		*/
+		bool RelocateDirectorySector(DWORD dwSector, PBYTE pbSector);
+
+	public:
+		ISO9660Relocator();
+
+		/*
+			Description: Reads the volume descriptors and path tables of the ISO image on a track and relocates them.
+
+			Parameters:
+				pTrackHandle: Track handle for the ISO image track, the LBA of the track is the LBA the image is
+					mastered for.
+				dwTargetLBA: LBA the image is being moved to.
+
+			Returns: True if the image can be relocated, false otherwise.
+		*/
+		bool Prepare(DiskJuggler::CdiTrackHandle *pTrackHandle, DWORD dwTargetLBA);
+
+		/*
+			Description: Relocates a run of sectors in place. Must be called with every sector of the track in
+				order, once Prepare() succeeded.
+
+			Parameters:
+				dwSector: First sector of the run, relative to the start of the track.
+				pbSectors: User data of the sectors, ISO9660_SECTOR_SIZE bytes each.
+				dwSectorCount: Number of sectors in the run.
+
+			Returns: True if the sectors were relocated, false if the sectors are out of order or the file system is
+				corrupt.
+		*/
+		bool RelocateSectors(DWORD dwSector, PBYTE pbSectors, DWORD dwSectorCount);
+
+		/*
+			Description: Checks every directory found was streamed, call once the whole track went through
+				RelocateSectors().
+
+			Returns: True if every directory was relocated, false otherwise.
+		*/
+		bool Finish();
+
+		/*
+			Description: Gets the number of sectors from the start of the track up to and including the volume
+				descriptor set terminator, which covers the bootstrap and every volume descriptor.
+		*/
+		DWORD GetHeaderSectorCount();
+
+		/*
+			Description: Gets the number of LBAs relocated so far.
+		*/
+		DWORD GetRelocatedCount();
+	};
+};
\ No newline at end of file
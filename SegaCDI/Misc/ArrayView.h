@@ -0,0 +1,70 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	ArrayView.h - Read only view over a collection of objects in a continuous
+		block of memory that is owned by someone else.
+
+	Oct 16th, 2026
+		- Initial creation.
+*/
+
+#pragma once
+#include "../stdafx.h"
+
+template<class T>
+class ArrayView
+{
+private:
+	// Pointer to the first element in the collection.
+	const T *m_pCollection;
+
+	// Number of elements in the collection.
+	size_t m_dwCount;
+
+public:
+	ArrayView()
+	{
+		// Initialize fields.
+		this->m_pCollection = nullptr;
+		this->m_dwCount = 0;
+	}
+
+	ArrayView(const T *pCollection, size_t dwCount)
+	{
+		// Initialize fields, the view does not copy or take ownership of the collection.
+		this->m_pCollection = pCollection;
+		this->m_dwCount = dwCount;
+	}
+
+	size_t size() const
+	{
+		// Return the number of elements in the collection.
+		return this->m_dwCount;
+	}
+
+	const T* operator[](int index) const
+	{
+		// Check to make sure the index is valid.
+		if (index < 0 || (size_t)index >= this->m_dwCount)
+			return nullptr;
+
+		// Return a pointer to the element at the specified index.
+		return &this->m_pCollection[index];
+	}
+
+	const T* get(int index) const
+	{
+		// Use the indexer operator to get the object.
+		return this->operator[](index);
+	}
+
+	const T* begin() const
+	{
+		return this->m_pCollection;
+	}
+
+	const T* end() const
+	{
+		return this->m_pCollection + this->m_dwCount;
+	}
+};
\ No newline at end of file
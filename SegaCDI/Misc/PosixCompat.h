@@ -0,0 +1,96 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	PosixCompat.h - Win32 type definitions for building the platform
+		independent parts of the tool on POSIX systems.
+
+	Oct 16th, 2026
+		- Initial creation.
+
+	Oct 17th, 2026
+		- Added AlignedAlloc()/AlignedFree() so sector buffers are allocated
+			the same way on every platform.
+		- ULONGLONG/LONGLONG are long long like on Win32 so %ll formats
+			don't warn on LP64 systems.
+*/
+
+#pragma once
+
+#ifndef _WIN32
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+typedef uint8_t				BYTE;
+typedef uint16_t			WORD;
+typedef uint32_t			DWORD;
+typedef int32_t				LONG;
+typedef unsigned long long	ULONGLONG;		// Same as Win32 so printf %ll formats match on LP64 systems
+typedef long long			LONGLONG;
+typedef size_t				SIZE_T;
+typedef int					BOOL;
+typedef char				CHAR;
+typedef BYTE				*PBYTE;
+typedef void				*PVOID;
+typedef void				*LPVOID;
+typedef const char			*LPCSTR;
+typedef char				*LPSTR;
+
+#ifndef TRUE
+#define TRUE				1
+#endif
+
+#ifndef FALSE
+#define FALSE				0
+#endif
+
+#ifndef MAX_PATH
+#define MAX_PATH			260
+#endif
+
+#endif
+
+// Page alignment used for sector buffers so they can be handed to unbuffered/direct I/O.
+#define ALIGNED_ALLOC_ALIGNMENT		4096
+
+/*
+	Description: Allocates a zero filled, page aligned buffer for sector data.
+
+	Parameters:
+		dwSize: Size of the buffer in bytes.
+
+	Returns: A pointer to the buffer or NULL if the allocation failed. The buffer must be freed with AlignedFree().
+*/
+static inline PVOID AlignedAlloc(SIZE_T dwSize)
+{
+#ifdef _WIN32
+	// VirtualAlloc hands out page aligned, zero filled memory.
+	return VirtualAlloc(NULL, dwSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+	PVOID pvBuffer = NULL;
+
+	// Allocate the buffer and zero it to match VirtualAlloc.
+	if (posix_memalign(&pvBuffer, ALIGNED_ALLOC_ALIGNMENT, dwSize != 0 ? dwSize : 1) != 0)
+		return NULL;
+
+	memset(pvBuffer, 0, dwSize);
+	return pvBuffer;
+#endif
+}
+
+/*
+	Description: Frees a buffer allocated with AlignedAlloc(). Passing NULL is allowed.
+*/
+static inline void AlignedFree(PVOID pvBuffer)
+{
+	// Check if there is anything to free.
+	if (pvBuffer == NULL)
+		return;
+
+#ifdef _WIN32
+	VirtualFree(pvBuffer, 0, MEM_RELEASE);
+#else
+	free(pvBuffer);
+#endif
+}
\ No newline at end of file
@@ -1,301 +1,794 @@
-// SegaCDI.cpp : Defines the entry point for the console application.
-//
-
-#include "stdafx.h"
-#include "Dreamcast\CdiImage.h"
-#include "ISO/Iso9660.h"
-
-void printUse()
-{
-	// Print the program command line args.
-	printf("SegaCDI.exe <cdi_file> <options>\n\n");
-
-	printf("\tOptions:\n");
-	printf("\t<cdi_file>\t\t.cdi image file\n\n");
-
-	printf("\t-v\t\t\tprintf extended info\n");
-	printf("\t-c\t\tconvert to data/data iso\n");
-	printf("\t-o <output_folder>\toutput folder\n");
-	printf("\t-s <session#:track#>\tdump track from session (value is optional)\n");
-
-	// File extract options
-	printf("\t-e <files>\t\textract files to output folder\n");
-	printf("\t\ta\tdump all files\n");
-	printf("\t\tb\tIP.BIN\n");
-	printf("\t\tl\tboot image\n");
-	printf("\t\tfs\tISO file system\n");
-}
-
-bool getCmdArg(int argc, CHAR* argv[], LPCSTR psCmd)
-{
-	// Loop through all the command line args.
-	for (int i = 0; i < argc; i++)
-	{
-		// Check if this arg is the one we are looking for.
-		if (strcmp(psCmd, argv[i]) == 0)
-		{
-			// Return true.
-			return true;
-		}
-	}
-
-	// The command line arg was not found.
-	return false;
-}
-
-bool getCmdArgHasValue(int argc, CHAR* argv[], LPCSTR psCmd)
-{
-	// Loop through all the command line args.
-	for (int i = 0; i < argc; i++)
-	{
-		// Check if this arg is the one we are looking for.
-		if (strcmp(psCmd, argv[i]) == 0)
-		{
-			// Check there is one more argument after this one.
-			if (i < argc - 1)
-			{
-				// Check if the next arg starts with a '-' character.
-				if (argv[i + 1][0] == '-')
-				{
-					// The next arg is not a value.
-					return false;
-				}
-
-				// Return true.
-				return true;
-			}
-		}
-	}
-
-	// The command line arg was not found.
-	return false;
-}
-
-bool getCmdArgValue(int argc, CHAR* argv[], LPCSTR psCmd, CString *psValue)
-{
-	// Loop through all the command line args.
-	for (int i = 0; i < argc; i++)
-	{
-		// Check if this arg is the one we are looking for.
-		if (strcmp(psCmd, argv[i]) == 0)
-		{
-			// Check there is one more argument after this one.
-			if (i < argc - 1)
-			{
-				// Copy the arg value to the output string.
-				*psValue = argv[i + 1];
-				return true;
-			}
-		}
-	}
-
-	// The command line arg was not found.
-	return false;
-}
-
-bool parseDumpInfoArg(LPCSTR sDumpInfo, DWORD *pdwSessionNum, DWORD *pdwTrackNum)
-{
-	// Get the index of the ':' character in the dump info and check it's valid.
-	const CHAR *index = strrchr(sDumpInfo, ':');
-	if ((int)index == 0 || (int)sDumpInfo - (int)index == strlen(sDumpInfo) - 1)
-		return false;
-
-	// Create two string pointers for the session and track strings.
-	CHAR *psSession = (CHAR*)sDumpInfo;
-	CHAR *psTrack = (CHAR*)&index[1];
-
-	// Parse the session and track number.
-	*pdwSessionNum = atoi(psSession);
-	*pdwTrackNum = atoi(psTrack);
-
-	// Done.
-	return true;
-}
-
-bool extractFilesFropImage(Dreamcast::CdiImage *pImage, CString sOutputFolder, CString sDumpParam, bool bVerbos)
-{
-	// Check the dump param for what we should dump.
-	if (sDumpParam == "a")
-	{
-		// Change the dump param to we dump everything.
-		sDumpParam = "blfs";
-	}
-
-	// Check if we should dump the IP.BIN file.
-	if (sDumpParam.Find("b") > -1)
-	{
-		// Dump the bootstrap file.
-		if (pImage->ExtractIPBin(sOutputFolder) == false)
-			return false;
-	}
-
-	// Check if we should dump the boot logo.
-	if (sDumpParam.Find("l") > -1)
-	{
-		// Dump the boot logo.
-		if (pImage->ExtractMRImage(sOutputFolder) == false)
-			return false;
-	}
-
-	// Check if we should extract the ISO file system.
-	if (sDumpParam.Find("fs") > -1)
-	{
-		// Create a folder for the iso file system.
-		CString sFsFolder = sOutputFolder + "\\FileSystem";
-		if (CreateDirectory(sFsFolder, NULL) == 0)
-		{
-			// Failed to create the directory, find out why.
-			DWORD dwError = GetLastError();
-			if (dwError == ERROR_PATH_NOT_FOUND)
-			{
-				// We couldn't find the full path.
-				printf("error creating folder '%s'!\n", sFsFolder);
-				return false;
-			}
-		}
-
-		// Extract the ISO file system.
-		if (pImage->ExtractISOFileSystem(sFsFolder) == false)
-			return false;
-	}
-
-	// Done, return true.
-	return true;
-}
-
-int main(int argc, CHAR* argv[])
-{
-	//{
-	//	// ISO 9660 sanity checks.
-	//	int size = sizeof(ISO9660_DirectoryEntry);
-	//	size = sizeof(ISO9660_PrimaryVolumeDescriptor);
-	//	size = sizeof(ISO9660_VolumeDescriptor);
-	//	return 0;
-	//}
-
-	// Debug case.
-	if (IsDebuggerPresent())
-	{
-		CHAR* args[8] = 
-		{
-			argv[0],
-			//"X:\\Dreamcast\\Games\\Toy Commander\\Toy Commander.cdi"		// Mode2/Mode2
-			"G:\\Dreamcast\\Games\\Crazy Taxi 2\\Crazy Taxi 2.cdi",		// Audio/Mode2
-			//"G:\\Dreamcast\\Games\\Crazy Taxi 2\\Crazy Taxi 2 Data-Data.cdi",		// Mode2/Mode2
-			//"X:\\Dreamcast\\Games\\Zombie Revenge\\Zombie Revenge.cdi"		// Mode2/Mode2
-			//"X:\\Dreamcast\\Games\\Soul Calibur\\Soul Calibur\\scalibur\\scalibur.cdi",
-			//"G:\\Dreamcast\\Games\\Quake III Arena\\Quake III Arena.cdi",
-			//"Y:\\DEVELOPMENT\\Dreamcast\\Games\\Zombie Revenge\\Zombie Revenge.cdi",
-			//"G:\\Dreamcast\\Games\\GameShark_CDX\\GameShark CDX\\e-gscdx.cdi",
-
-			"-v",
-			"-o",
-			"G:\\Dreamcast\\Games\\Quake III Arena\\extract3",
-			//"Y:\\DEVELOPMENT\\Dreamcast\\Games\\Zombie Revenge\\extract",
-
-			"-s",
-			"-e", "a"
-		};
-
-		argc = 3;
-		argv = args;
-	}
-
-	// Check the arg count.
-	if (argc > 1)
-	{
-		// Check that the cdi file exists.
-		CString sCdiImage = argv[1];
-		if (FileExists(sCdiImage) == true)
-		{
-			// If there is an output folder pull it out.
-			CString sOutputFolder = "";
-			bool bOutput = getCmdArgValue(argc, argv, "-o", &sOutputFolder);
-
-			// Check for the verbos cmd arg.
-			bool bVerbos = getCmdArg(argc, argv, "-v");
-
-			// Print the file name.
-			printf("loading image %s\n", sCdiImage);
-
-			// Create a new CdiImage object and parse the image.
-			Dreamcast::CdiImage *pImage = new Dreamcast::CdiImage();
-			if (pImage->LoadImage(sCdiImage, bVerbos) == false)
-			{
-				// Failed to load the CDI image, nothing else to do here.
-				delete pImage;
-				return 0;
-			}
-
-			// Check if we should dump a session/track to an iso file.
-			if (getCmdArg(argc, argv, "-s") == true && bOutput == true)
-			{
-				// Check if we have indices for the track or if we should dump everything.
-				if (getCmdArgHasValue(argc, argv, "-s") == true)
-				{
-					// Pull out the session and track info string.
-					CString sDumpInfo = "";
-					getCmdArgValue(argc, argv, "-s", &sDumpInfo);
-
-					// Parse the session and track numbers.
-					DWORD dwSessionNum, dwTrackNum;
-					if (parseDumpInfoArg(sDumpInfo.GetString(), &dwSessionNum, &dwTrackNum) == false)
-					{
-						// Print error, close cdi image and return.
-						printf("error parsing session/track numbers!\n");
-						delete pImage;
-						return 0;
-					}
-
-					// Dump the second session to an iso file.
-					pImage->WriteTrackToFile(sOutputFolder, dwSessionNum, dwTrackNum);
-				}
-				else
-				{
-					// Dump all the tracks in the cdi image file.
-					pImage->WriteAllTracks(sOutputFolder);
-				}
-			}
-
-			// Check if we should extract any files.
-			if (getCmdArg(argc, argv, "-e") == true && bOutput == true)
-			{
-				// Pull out the dump info param.
-				CString sDumpInfo = "";
-				getCmdArgValue(argc, argv, "-e", &sDumpInfo);
-
-				// Try to extract the requested files.
-				if (extractFilesFropImage(pImage, sOutputFolder, sDumpInfo, bVerbos) == false)
-				{
-					// Error extracting files.
-					delete pImage;
-					return 0;
-				}
-			}
-
-			// Check if we should convert the image to a data/data image.
-			if (getCmdArg(argc, argv, "-c") == true && bOutput == true)
-			{
-
-			}
-
-			// Done.
-			delete pImage;
-			return 0;
-		}
-		else
-		{
-			// Print file not found error and return.
-			printf("could not find file %s!", sCdiImage);
-			return 0;
-		}
-
-		// Invalid arguments somewhere.
-		printUse();
-	}
-	else
-		printUse();
-
-	return 0;
-}
-
+// SegaCDI.cpp : Defines the entry point for the console application.
+//
+
+#include "stdafx.h"
+#include "Dreamcast\CdiImage.h"
+#include "Dreamcast\CdiBatch.h"
+#include "DiskJuggler\CdiImageWriter.h"
+#include "DiskJuggler\CdiExporter.h"
+#include "DiskJuggler\CdiCompressedImage.h"
+#include "DiskJuggler\CdiChunkStore.h"
+#include "DiskJuggler\CdiHasher.h"
+#include "DiskJuggler\CdiDatFile.h"
+#include "ISO/Iso9660.h"
+
+void printUse()
+{
+	// Print the program command line args.
+	printf("SegaCDI.exe <cdi_file> <options>\n");
+	printf("SegaCDI.exe -batch <list_file|folder|pattern> <batch_options>\n");
+	printf("SegaCDI.exe -build <output_file> <tracks>\n");
+	printf("SegaCDI.exe -pack <store_folder> <cdi_files>\n");
+	printf("SegaCDI.exe -unpack <manifest_file> <output_file>\n");
+	printf("SegaCDI.exe -hash <cdi_files> <hash_options>\n\n");
+
+	printf("\tOptions:\n");
+	printf("\t<cdi_file>\t\t.cdi, compressed .cdz or chunk store .cdm image file\n\n");
+
+	printf("\t-v\t\t\tprintf extended info\n");
+	printf("\t-m\t\t\tmemory map the image file\n");
+	printf("\t-index\t\t\tload/save a sidecar index next to the image\n");
+	printf("\t-c <format>\t\tconvert to output folder (value is optional)\n");
+	printf("\t\tcdi\tdata/data cdi image (default)\n");
+	printf("\t\tiso\tplain iso image at LBA 0\n");
+	printf("\t-export <format>\texport all tracks to output folder (value is optional)\n");
+	printf("\t\tcue\tbin/cue, one file per track (default)\n");
+	printf("\t\tgdi\tgdi sheet with track files\n");
+	printf("\t-compress\t\tcompress the image to a .cdz file in the output folder\n");
+	printf("\t-validate\t\tcheck the EDC/ECC of every sector\n");
+	printf("\t-o <output_folder>\toutput folder\n");
+	printf("\t-s <session#:track#>\tdump track from session (value is optional)\n");
+
+	// File extract options
+	printf("\t-e <files>\t\textract files to output folder\n");
+	printf("\t\ta\tdump all files\n");
+	printf("\t\tb\tIP.BIN\n");
+	printf("\t\tl\tboot image\n");
+	printf("\t\tfs\tISO file system\n\n");
+
+	// Batch options
+	printf("\tBatch options:\n");
+	printf("\t-checks <checks>\tchecks to run on each image (default a)\n");
+	printf("\t\ta\tall checks\n");
+	printf("\t\tb\tIP.BIN\n");
+	printf("\t\tf\tISO file system (implies b)\n");
+	printf("\t\te\tEDC/ECC of every sector\n");
+	printf("\t-j <threads>\t\tnumber of worker threads (default one per processor)\n");
+	printf("\t-mem <MB>\t\tmemory budget of each open image\n");
+	printf("\t-index\t\t\tload/save a sidecar index next to each image\n");
+	printf("\t-report <file>\t\tJSON report file (default " CDI_BATCH_DEFAULT_REPORT_FILE ")\n\n");
+
+	// Build options
+	printf("\tBuild tracks, in disc order:\n");
+	printf("\t<mode>[/<sector_size>]=<file>\ttrack from a WAV/raw audio or ISO file\n");
+	printf("\t\taudio\taudio track, 2352 byte sectors by default\n");
+	printf("\t\tmode1\tmode 1 data track, 2048 byte sectors by default\n");
+	printf("\t\tmode2\tmode 2 data track, 2336 byte sectors by default\n");
+	printf("\tsession[:<lba>]\t\tstart a new session, optionally at a fixed LBA\n\n");
+
+	// Pack options
+	printf("\tPack images:\n");
+	printf("\t<store_folder>\t\tchunk store shared by the images, created if it doesn't exist\n");
+	printf("\t<cdi_files>\t\timages to add, each gets a .cdm manifest in the store folder\n\n");
+
+	// Hash options
+	printf("\tHash options:\n");
+	printf("\t-dat <dat_file>\t\tcheck the images against a XML or clrmamepro DAT\n");
+	printf("\t-j <threads>\t\tnumber of hashing threads (default one per processor)\n");
+}
+
+bool getCmdArg(int argc, CHAR* argv[], LPCSTR psCmd)
+{
+	// Loop through all the command line args.
+	for (int i = 0; i < argc; i++)
+	{
+		// Check if this arg is the one we are looking for.
+		if (strcmp(psCmd, argv[i]) == 0)
+		{
+			// Return true.
+			return true;
+		}
+	}
+
+	// The command line arg was not found.
+	return false;
+}
+
+bool getCmdArgHasValue(int argc, CHAR* argv[], LPCSTR psCmd)
+{
+	// Loop through all the command line args.
+	for (int i = 0; i < argc; i++)
+	{
+		// Check if this arg is the one we are looking for.
+		if (strcmp(psCmd, argv[i]) == 0)
+		{
+			// Check there is one more argument after this one.
+			if (i < argc - 1)
+			{
+				// Check if the next arg starts with a '-' character.
+				if (argv[i + 1][0] == '-')
+				{
+					// The next arg is not a value.
+					return false;
+				}
+
+				// Return true.
+				return true;
+			}
+		}
+	}
+
+	// The command line arg was not found.
+	return false;
+}
+
+bool getCmdArgValue(int argc, CHAR* argv[], LPCSTR psCmd, CString *psValue)
+{
+	// Loop through all the command line args.
+	for (int i = 0; i < argc; i++)
+	{
+		// Check if this arg is the one we are looking for.
+		if (strcmp(psCmd, argv[i]) == 0)
+		{
+			// Check there is one more argument after this one.
+			if (i < argc - 1)
+			{
+				// Copy the arg value to the output string.
+				*psValue = argv[i + 1];
+				return true;
+			}
+		}
+	}
+
+	// The command line arg was not found.
+	return false;
+}
+
+bool parseDumpInfoArg(LPCSTR sDumpInfo, DWORD *pdwSessionNum, DWORD *pdwTrackNum)
+{
+	// Get the index of the ':' character in the dump info and check it's valid.
+	const CHAR *index = strrchr(sDumpInfo, ':');
+	if ((int)index == 0 || (int)sDumpInfo - (int)index == strlen(sDumpInfo) - 1)
+		return false;
+
+	// Create two string pointers for the session and track strings.
+	CHAR *psSession = (CHAR*)sDumpInfo;
+	CHAR *psTrack = (CHAR*)&index[1];
+
+	// Parse the session and track number.
+	*pdwSessionNum = atoi(psSession);
+	*pdwTrackNum = atoi(psTrack);
+
+	// Done.
+	return true;
+}
+
+bool extractFilesFropImage(Dreamcast::CdiImage *pImage, CString sOutputFolder, CString sDumpParam, bool bVerbos)
+{
+	// Check the dump param for what we should dump.
+	if (sDumpParam == "a")
+	{
+		// Change the dump param to we dump everything.
+		sDumpParam = "blfs";
+	}
+
+	// Check if we should dump the IP.BIN file.
+	if (sDumpParam.Find("b") > -1)
+	{
+		// Dump the bootstrap file.
+		if (pImage->ExtractIPBin(sOutputFolder) == false)
+			return false;
+	}
+
+	// Check if we should dump the boot logo.
+	if (sDumpParam.Find("l") > -1)
+	{
+		// Dump the boot logo.
+		if (pImage->ExtractMRImage(sOutputFolder) == false)
+			return false;
+	}
+
+	// Check if we should extract the ISO file system.
+	if (sDumpParam.Find("fs") > -1)
+	{
+		// Create a folder for the iso file system.
+		CString sFsFolder = sOutputFolder + "\\FileSystem";
+		if (CreateDirectory(sFsFolder, NULL) == 0)
+		{
+			// Failed to create the directory, find out why.
+			DWORD dwError = GetLastError();
+			if (dwError == ERROR_PATH_NOT_FOUND)
+			{
+				// We couldn't find the full path.
+				printf("error creating folder '%s'!\n", sFsFolder);
+				return false;
+			}
+		}
+
+		// Extract the ISO file system.
+		if (pImage->ExtractISOFileSystem(sFsFolder) == false)
+			return false;
+	}
+
+	// Done, return true.
+	return true;
+}
+
+int runBatch(int argc, CHAR* argv[])
+{
+	// Parse the checks to run.
+	DWORD dwChecks = Dreamcast::BatchCheckAll;
+	CString sChecks = "";
+	if (getCmdArgValue(argc, argv, "-checks", &sChecks) == true)
+	{
+		dwChecks = Dreamcast::BatchCheckDescriptor;
+		for (int i = 0; i < sChecks.GetLength(); i++)
+		{
+			switch (sChecks[i])
+			{
+			case 'a': dwChecks |= Dreamcast::BatchCheckAll; break;
+			case 'b': dwChecks |= Dreamcast::BatchCheckBootstrap; break;
+			case 'f': dwChecks |= Dreamcast::BatchCheckFileSystem; break;
+			case 'e': dwChecks |= Dreamcast::BatchCheckSectors; break;
+			default:
+				{
+					printf("unknown check '%c'!\n", sChecks[i]);
+					return 1;
+				}
+			}
+		}
+	}
+
+	// Pull out the thread count and memory budget.
+	CString sValue = "";
+	DWORD dwThreadCount = 0;
+	if (getCmdArgValue(argc, argv, "-j", &sValue) == true)
+		dwThreadCount = atoi(sValue);
+
+	Dreamcast::CdiBatchValidator validator(dwChecks, dwThreadCount);
+	if (getCmdArgValue(argc, argv, "-mem", &sValue) == true && atoi(sValue) > 0)
+		validator.SetMemoryLimits((ULONGLONG)atoi(sValue) * 1024 * 1024);
+
+	// Check if the sidecar index should be used.
+	validator.EnableSidecarIndex(getCmdArg(argc, argv, "-index"));
+
+	// Add the images, a bad list or pattern fails the batch so scripts don't mistake it for a clean run.
+	if (validator.AddImages(argv[2]) == false)
+		return 1;
+
+	// Validate all of the images.
+	printf("validating %d images...\n", validator.ImageCount());
+	bool bPassed = validator.Run();
+
+	// Write out the report.
+	CString sReportFile = CDI_BATCH_DEFAULT_REPORT_FILE;
+	getCmdArgValue(argc, argv, "-report", &sReportFile);
+	if (validator.WriteReport(sReportFile) == true)
+		printf("wrote report to %s\n", sReportFile);
+
+	// Return non-zero if any image failed so scripts can check the result.
+	return (bPassed == true ? 0 : 1);
+}
+
+int runBuild(int argc, CHAR* argv[])
+{
+	// Create the new image.
+	DiskJuggler::CdiImageWriter writer;
+	if (writer.Create(argv[2]) == false)
+		return 1;
+
+	// Loop through the track list and write each one.
+	for (int i = 3; i < argc; i++)
+	{
+		CString sTrack = argv[i];
+
+		// Check if this starts a new session.
+		if (strncmp(sTrack, "session", 7) == 0)
+		{
+			DWORD dwLBA = (sTrack.GetLength() > 8 && sTrack[7] == ':' ? (DWORD)atoi(sTrack.Mid(8)) : CDI_WRITER_NEXT_LBA);
+			if (writer.BeginSession(dwLBA) == false)
+				return 1;
+			continue;
+		}
+
+		// Split the track into the mode, sector size and file.
+		int dwSeparator = sTrack.Find('=');
+		if (dwSeparator == -1)
+		{
+			printf("invalid track '%s'!\n", sTrack);
+			return 1;
+		}
+		CString sMode = sTrack.Left(dwSeparator);
+		CString sFileName = sTrack.Mid(dwSeparator + 1);
+
+		// Parse the sector size.
+		DWORD dwSectorSize = 0;
+		if (sMode.Find('/') != -1)
+		{
+			dwSectorSize = atoi(sMode.Mid(sMode.Find('/') + 1));
+			sMode = sMode.Left(sMode.Find('/'));
+		}
+
+		// Parse the mode.
+		DiskJuggler::CdiTrackMode eMode;
+		if (sMode == "audio")
+		{
+			eMode = DiskJuggler::CdiTrackMode::Audio;
+			dwSectorSize = (dwSectorSize == 0 ? DiskJuggler::CdiSectorSize::Size_2352 : dwSectorSize);
+		}
+		else if (sMode == "mode1")
+		{
+			eMode = DiskJuggler::CdiTrackMode::Mode1;
+			dwSectorSize = (dwSectorSize == 0 ? DiskJuggler::CdiSectorSize::Size_2048 : dwSectorSize);
+		}
+		else if (sMode == "mode2")
+		{
+			eMode = DiskJuggler::CdiTrackMode::Mode2;
+			dwSectorSize = (dwSectorSize == 0 ? DiskJuggler::CdiSectorSize::Size_2336 : dwSectorSize);
+		}
+		else
+		{
+			printf("unknown track mode '%s'!\n", sMode);
+			return 1;
+		}
+
+		// Convert the sector size to the sector type stored in the image.
+		DiskJuggler::CdiSectorType eSectorType;
+		switch (dwSectorSize)
+		{
+		case DiskJuggler::CdiSectorSize::Size_2048: eSectorType = DiskJuggler::CdiSectorType::Type_2048; break;
+		case DiskJuggler::CdiSectorSize::Size_2336: eSectorType = DiskJuggler::CdiSectorType::Type_2336; break;
+		case DiskJuggler::CdiSectorSize::Size_2352: eSectorType = DiskJuggler::CdiSectorType::Type_2352; break;
+		case DiskJuggler::CdiSectorSize::Size_2368: eSectorType = DiskJuggler::CdiSectorType::Type_2368; break;
+		case DiskJuggler::CdiSectorSize::Size_2448: eSectorType = DiskJuggler::CdiSectorType::Type_2448; break;
+		default:
+			{
+				printf("invalid sector size %d!\n", dwSectorSize);
+				return 1;
+			}
+		}
+
+		// Write the track.
+		printf("writing track %s\n", sFileName);
+		if (writer.WriteTrackFromFile(sFileName, eMode, eSectorType) == false)
+			return 1;
+	}
+
+	// Write the session descriptor.
+	if (writer.Close() == false)
+		return 1;
+
+	printf("wrote %lld bytes to %s\n", writer.BytesWritten(), argv[2]);
+	return 0;
+}
+
+int runPack(int argc, CHAR* argv[])
+{
+	// Open the store, creating it if it doesn't exist yet.
+	DiskJuggler::CdiChunkStore store;
+	if (store.Open(argv[2], true) == false)
+		return 1;
+
+	// Add each of the images.
+	for (int i = 3; i < argc; i++)
+	{
+		// Name the manifest after the image, without the folder or the extension.
+		CString sImageName = argv[i];
+		int iSeparator = sImageName.ReverseFind('\\');
+		if (iSeparator != -1)
+			sImageName = sImageName.Mid(iSeparator + 1);
+		int iExtension = sImageName.ReverseFind('.');
+		if (iExtension != -1)
+			sImageName = sImageName.Left(iExtension);
+
+		CString sManifestFile;
+		sManifestFile.Format("%s\\%s" CDI_STORE_MANIFEST_EXTENSION, argv[2], sImageName);
+
+		// Add the image.
+		DiskJuggler::CdiStoreStats sBefore, sAfter;
+		store.GetStats(&sBefore);
+		printf("packing %s...\n", argv[i]);
+		if (store.AddImage(argv[i], sManifestFile) == false)
+		{
+			printf("ERROR: failed to pack image %s!\n", argv[i]);
+			store.Close();
+			return 1;
+		}
+
+		store.GetStats(&sAfter);
+		printf("split %lld bytes into %lld chunks, %lld new chunks stored in %lld bytes\n", sAfter.qwImageBytes - sBefore.qwImageBytes,
+			sAfter.qwChunkCount - sBefore.qwChunkCount, sAfter.qwNewChunkCount - sBefore.qwNewChunkCount, sAfter.qwStoredBytes - sBefore.qwStoredBytes);
+	}
+
+	// Write out the index.
+	DiskJuggler::CdiStoreStats sStats;
+	store.GetStats(&sStats);
+	ULONGLONG qwPackSize = store.PackSize();
+	DWORD dwChunkCount = store.ChunkCount();
+	if (store.Close() == false)
+		return 1;
+
+	// Print the totals, the dedup ratio counts chunks and the size ratio includes the compression of the new chunks.
+	printf("packed %d images, %lld bytes in %.2f seconds (%.1f MB/s)\n", argc - 3, sStats.qwImageBytes, sStats.dSeconds,
+		(sStats.dSeconds > 0 ? (double)sStats.qwImageBytes / (1024 * 1024) / sStats.dSeconds : 0.0));
+	if (sStats.qwNewChunkCount > 0)
+		printf("dedup ratio %.2f:1 (%lld of %lld chunks new), size ratio %.2f:1 (%lld bytes stored)\n",
+			(double)sStats.qwChunkCount / sStats.qwNewChunkCount, sStats.qwNewChunkCount, sStats.qwChunkCount,
+			(double)sStats.qwImageBytes / sStats.qwStoredBytes, sStats.qwStoredBytes);
+	else
+		printf("every chunk was already in the store\n");
+	printf("store now has %d chunks in %lld bytes\n", dwChunkCount, qwPackSize);
+
+	return 0;
+}
+
+int runUnpack(int argc, CHAR* argv[])
+{
+	// Open the manifest, the store is the folder it is in.
+	IO::BlockDevice *pManifestFile = IO::OpenFileDevice(argv[2], IO::BlockDeviceAccess::ReadOnly);
+	if (pManifestFile == nullptr)
+	{
+		printf("could not find file %s!\n", argv[2]);
+		return 1;
+	}
+
+	DiskJuggler::CdiStoreDevice device;
+	if (device.Open(pManifestFile, argv[2]) == false)
+	{
+		delete pManifestFile;
+		return 1;
+	}
+
+	// Rebuild the image.
+	IO::BlockDevice *pOutputFile = IO::OpenFileDevice(argv[3], IO::BlockDeviceAccess::CreateAlways);
+	if (pOutputFile == nullptr)
+	{
+		printf("failed to create %s!\n", argv[3]);
+		return 1;
+	}
+
+	bool bResult = (device.CopyTo(0, pOutputFile, 0, device.Size()) == true && pOutputFile->Flush() == true);
+	delete pOutputFile;
+	if (bResult == false)
+	{
+		printf("ERROR: failed to unpack image!\n");
+		return 1;
+	}
+
+	printf("wrote %lld bytes to %s\n", device.Size(), argv[3]);
+	return 0;
+}
+
+int runHash(int argc, CHAR* argv[])
+{
+	// Pull out the thread count.
+	CString sValue = "";
+	DWORD dwThreadCount = 0;
+	if (getCmdArgValue(argc, argv, "-j", &sValue) == true)
+		dwThreadCount = atoi(sValue);
+
+	// Load the DAT file if there is one.
+	DiskJuggler::CdiDatFile datFile;
+	CString sDatFile = "";
+	bool bUseDat = getCmdArgValue(argc, argv, "-dat", &sDatFile);
+	if (bUseDat == true)
+	{
+		if (datFile.Load(sDatFile) == false)
+			return 1;
+
+		printf("loaded %d roms from %s (%d skipped)\n", datFile.RomCount(), sDatFile, datFile.SkippedRomCount());
+	}
+
+	// Hash each of the images.
+	int iResult = 0;
+	for (int i = 2; i < argc; i++)
+	{
+		// Skip over the options and their values.
+		if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "-dat") == 0)
+		{
+			i++;
+			continue;
+		}
+
+		DiskJuggler::CdiFileHandle cdiFile;
+		DiskJuggler::CdiHashReport sReport;
+		printf("hashing %s...\n", argv[i]);
+		if (cdiFile.Open(argv[i], false, false) == false)
+		{
+			printf("ERROR: failed to open image %s!\n", argv[i]);
+			iResult = 1;
+			continue;
+		}
+
+		DiskJuggler::CdiHasher hasher(&cdiFile, dwThreadCount);
+		if (hasher.HashImage(&sReport) == false)
+		{
+			printf("ERROR: failed to hash image %s!\n", argv[i]);
+			iResult = 1;
+			continue;
+		}
+		sReport.Print();
+
+		// Check the image against the DAT, a mismatch is only reported if nothing failed outright.
+		if (bUseDat == true && datFile.CheckImage(&sReport) == false && iResult == 0)
+			iResult = 2;
+	}
+
+	// Return 0 if every image was hashed and matched, 1 if any image failed to hash, 2 if any image is not in the DAT.
+	return iResult;
+}
+
+int main(int argc, CHAR* argv[])
+{
+	//{
+	//	// ISO 9660 sanity checks.
+	//	int size = sizeof(ISO9660_DirectoryEntry);
+	//	size = sizeof(ISO9660_PrimaryVolumeDescriptor);
+	//	size = sizeof(ISO9660_VolumeDescriptor);
+	//	return 0;
+	//}
+
+	// Debug case.
+	if (IsDebuggerPresent())
+	{
+		CHAR* args[8] = 
+		{
+			argv[0],
+			//"X:\\Dreamcast\\Games\\Toy Commander\\Toy Commander.cdi"		// Mode2/Mode2
+			"G:\\Dreamcast\\Games\\Crazy Taxi 2\\Crazy Taxi 2.cdi",		// Audio/Mode2
+			//"G:\\Dreamcast\\Games\\Crazy Taxi 2\\Crazy Taxi 2 Data-Data.cdi",		// Mode2/Mode2
+			//"X:\\Dreamcast\\Games\\Zombie Revenge\\Zombie Revenge.cdi"		// Mode2/Mode2
+			//"X:\\Dreamcast\\Games\\Soul Calibur\\Soul Calibur\\scalibur\\scalibur.cdi",
+			//"G:\\Dreamcast\\Games\\Quake III Arena\\Quake III Arena.cdi",
+			//"Y:\\DEVELOPMENT\\Dreamcast\\Games\\Zombie Revenge\\Zombie Revenge.cdi",
+			//"G:\\Dreamcast\\Games\\GameShark_CDX\\GameShark CDX\\e-gscdx.cdi",
+
+			"-v",
+			"-o",
+			"G:\\Dreamcast\\Games\\Quake III Arena\\extract3",
+			//"Y:\\DEVELOPMENT\\Dreamcast\\Games\\Zombie Revenge\\extract",
+
+			"-s",
+			"-e", "a"
+		};
+
+		argc = 3;
+		argv = args;
+	}
+
+	// Check the arg count.
+	if (argc > 2 && strcmp(argv[1], "-batch") == 0)
+	{
+		// Validate a batch of images.
+		return runBatch(argc, argv);
+	}
+	else if (argc > 3 && strcmp(argv[1], "-build") == 0)
+	{
+		// Build a new image from track files.
+		return runBuild(argc, argv);
+	}
+	else if (argc > 3 && strcmp(argv[1], "-pack") == 0)
+	{
+		// Add images to a chunk store.
+		return runPack(argc, argv);
+	}
+	else if (argc > 3 && strcmp(argv[1], "-unpack") == 0)
+	{
+		// Rebuild an image from a chunk store.
+		return runUnpack(argc, argv);
+	}
+	else if (argc > 2 && strcmp(argv[1], "-hash") == 0)
+	{
+		// Hash images and check them against a DAT.
+		return runHash(argc, argv);
+	}
+	else if (argc > 1)
+	{
+		// Check that the cdi file exists.
+		CString sCdiImage = argv[1];
+		if (FileExists(sCdiImage) == true)
+		{
+			// If there is an output folder pull it out.
+			CString sOutputFolder = "";
+			bool bOutput = getCmdArgValue(argc, argv, "-o", &sOutputFolder);
+
+			// Check for the verbos cmd arg.
+			bool bVerbos = getCmdArg(argc, argv, "-v");
+
+			// Check if the image should be memory mapped.
+			bool bMemoryMap = getCmdArg(argc, argv, "-m");
+
+			// Check if the sidecar index should be used.
+			bool bUseIndex = getCmdArg(argc, argv, "-index");
+
+			// Print the file name.
+			printf("loading image %s\n", sCdiImage);
+
+			// Create a new CdiImage object and parse the image.
+			Dreamcast::CdiImage *pImage = new Dreamcast::CdiImage();
+			if (pImage->LoadImage(sCdiImage, bVerbos, bMemoryMap, bUseIndex) == false)
+			{
+				// Failed to load the CDI image, nothing else to do here.
+				delete pImage;
+				return 0;
+			}
+
+			// Check if we should verify every sector in the image.
+			if (getCmdArg(argc, argv, "-validate") == true)
+			{
+				// Validate the image, the report is printed as we go.
+				printf("validating image...\n");
+				pImage->ValidateImage(bVerbos);
+			}
+
+			// Check if we should dump a session/track to an iso file.
+			if (getCmdArg(argc, argv, "-s") == true && bOutput == true)
+			{
+				// Check if we have indices for the track or if we should dump everything.
+				if (getCmdArgHasValue(argc, argv, "-s") == true)
+				{
+					// Pull out the session and track info string.
+					CString sDumpInfo = "";
+					getCmdArgValue(argc, argv, "-s", &sDumpInfo);
+
+					// Parse the session and track numbers.
+					DWORD dwSessionNum, dwTrackNum;
+					if (parseDumpInfoArg(sDumpInfo.GetString(), &dwSessionNum, &dwTrackNum) == false)
+					{
+						// Print error, close cdi image and return.
+						printf("error parsing session/track numbers!\n");
+						delete pImage;
+						return 0;
+					}
+
+					// Dump the second session to an iso file.
+					pImage->WriteTrackToFile(sOutputFolder, dwSessionNum, dwTrackNum);
+				}
+				else
+				{
+					// Dump all the tracks in the cdi image file.
+					pImage->WriteAllTracks(sOutputFolder);
+				}
+			}
+
+			// Check if we should extract any files.
+			if (getCmdArg(argc, argv, "-e") == true && bOutput == true)
+			{
+				// Pull out the dump info param.
+				CString sDumpInfo = "";
+				getCmdArgValue(argc, argv, "-e", &sDumpInfo);
+
+				// Try to extract the requested files.
+				if (extractFilesFropImage(pImage, sOutputFolder, sDumpInfo, bVerbos) == false)
+				{
+					// Error extracting files.
+					delete pImage;
+					return 0;
+				}
+			}
+
+			// Check if we should convert the image to a data/data image.
+			if (getCmdArg(argc, argv, "-c") == true && bOutput == true)
+			{
+				// Check which format to convert to, data/data by default.
+				CString sFormat = "cdi";
+				if (getCmdArgHasValue(argc, argv, "-c") == true)
+					getCmdArgValue(argc, argv, "-c", &sFormat);
+
+				Dreamcast::CdiConvertFormat eFormat;
+				if (sFormat.CompareNoCase("cdi") == 0)
+					eFormat = Dreamcast::CdiConvertFormat::ConvertDataData;
+				else if (sFormat.CompareNoCase("iso") == 0)
+					eFormat = Dreamcast::CdiConvertFormat::ConvertIso;
+				else
+				{
+					// Print error, close cdi image and return.
+					printf("unknown conversion format %s!\n", sFormat);
+					delete pImage;
+					return 0;
+				}
+
+				// Name the output image after the input image, without the folder or the extension.
+				CString sImageName = sCdiImage;
+				int iSeparator = sImageName.ReverseFind('\\');
+				if (iSeparator != -1)
+					sImageName = sImageName.Mid(iSeparator + 1);
+				int iExtension = sImageName.ReverseFind('.');
+				if (iExtension != -1)
+					sImageName = sImageName.Left(iExtension);
+
+				CString sOutputFile;
+				if (eFormat == Dreamcast::CdiConvertFormat::ConvertIso)
+					sOutputFile.Format("%s\\%s.iso", sOutputFolder, sImageName);
+				else
+					sOutputFile.Format("%s\\%s Data-Data.cdi", sOutputFolder, sImageName);
+
+				// Convert the image.
+				printf("converting image to %s...\n", sOutputFile);
+				pImage->ConvertImage(sOutputFile, eFormat);
+			}
+
+			// Check if we should compress the image.
+			if (getCmdArg(argc, argv, "-compress") == true && bOutput == true)
+			{
+				// Name the compressed image after the input image, without the folder or the extension.
+				CString sImageName = sCdiImage;
+				int iSeparator = sImageName.ReverseFind('\\');
+				if (iSeparator != -1)
+					sImageName = sImageName.Mid(iSeparator + 1);
+				int iExtension = sImageName.ReverseFind('.');
+				if (iExtension != -1)
+					sImageName = sImageName.Left(iExtension);
+
+				CString sOutputFile;
+				sOutputFile.Format("%s\\%s" CDI_COMPRESSED_EXTENSION, sOutputFolder, sImageName);
+
+				// Compress the image.
+				printf("compressing image to %s...\n", sOutputFile);
+				DiskJuggler::CdiImageCompressor sCompressor;
+				if (sCompressor.Compress(sCdiImage, sOutputFile) == true)
+					printf("compressed %lld bytes to %lld bytes, %lld zero sectors and %lld regenerated sectors\n", sCompressor.ImageSize(),
+						sCompressor.CompressedSize(), sCompressor.ZeroSectors(), sCompressor.RegeneratedSectors());
+				else
+					printf("ERROR: failed to compress image!\n");
+			}
+
+			// Check if we should export the tracks to a bin/cue or gdi layout.
+			if (getCmdArg(argc, argv, "-export") == true && bOutput == true)
+			{
+				// Check which layout to export to, bin/cue by default.
+				CString sFormat = "cue";
+				if (getCmdArgHasValue(argc, argv, "-export") == true)
+					getCmdArgValue(argc, argv, "-export", &sFormat);
+
+				DiskJuggler::CdiExportFormat eFormat;
+				if (sFormat.CompareNoCase("cue") == 0)
+					eFormat = DiskJuggler::CdiExportFormat::ExportBinCue;
+				else if (sFormat.CompareNoCase("gdi") == 0)
+					eFormat = DiskJuggler::CdiExportFormat::ExportGdi;
+				else
+				{
+					// Print error, close cdi image and return.
+					printf("unknown export format %s!\n", sFormat);
+					delete pImage;
+					return 0;
+				}
+
+				// Name the sheet and track files after the input image, without the folder or the extension.
+				CString sImageName = sCdiImage;
+				int iSeparator = sImageName.ReverseFind('\\');
+				if (iSeparator != -1)
+					sImageName = sImageName.Mid(iSeparator + 1);
+				int iExtension = sImageName.ReverseFind('.');
+				if (iExtension != -1)
+					sImageName = sImageName.Left(iExtension);
+
+				// Export the tracks.
+				DiskJuggler::CdiExporter sExporter(pImage->GetFileHandle());
+				if (sExporter.Export(sOutputFolder, sImageName, eFormat) == true)
+					printf("exported %lld bytes, %lld copied and %lld re-encoded\n", sExporter.BytesCopied() + sExporter.BytesEncoded(),
+						sExporter.BytesCopied(), sExporter.BytesEncoded());
+				else
+					printf("ERROR: failed to export image!\n");
+			}
+
+			// Done.
+			delete pImage;
+			return 0;
+		}
+		else
+		{
+			// Print file not found error and return.
+			printf("could not find file %s!", sCdiImage);
+			return 0;
+		}
+
+		// Invalid arguments somewhere.
+		printUse();
+	}
+	else
+		printUse();
+
+	return 0;
+}
+
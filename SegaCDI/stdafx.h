@@ -1,16 +1,21 @@
-// stdafx.h : include file for standard system include files,
-// or project specific include files that are used frequently, but
-// are changed infrequently
-//
-
-#pragma once
-
-#include <stdio.h>
-#include <tchar.h>
-
-// TODO: reference additional headers your program requires here
-
-#define _AFXDLL
-#include <afx.h>
-
+// stdafx.h : include file for standard system include files,
+// or project specific include files that are used frequently, but
+// are changed infrequently
+//
+
+#pragma once
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <tchar.h>
+
+// TODO: reference additional headers your program requires here
+
+#define _AFXDLL
+#include <afx.h>
+#endif
+
+#include "Misc/PosixCompat.h"
+
 #include "Misc/Utilities.h"
\ No newline at end of file
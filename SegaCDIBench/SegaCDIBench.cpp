@@ -0,0 +1,610 @@
+/*
+	SegaCDI - Sega Dreamcast cdi image validator.
+
+	SegaCDIBench.cpp - Stress tests and benchmarks for the image I/O layer.
+
+	Oct 17th, 2026
+		- Initial creation.
+*/
+
+#include "../SegaCDI/stdafx.h"
+#include "../SegaCDI/DiskJuggler/CdiFileHandle.h"
+#include "../SegaCDI/DiskJuggler/CdiImageWriter.h"
+#include "../SegaCDI/IO/Digest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace DiskJuggler;
+
+// Number of sectors read and checked at a time by the stress test.
+#define STRESS_CHUNK_SECTORS			32
+
+// Number of chunks each thread keeps in flight when reading asynchronously.
+#define STRESS_ASYNC_CHUNKS				4
+
+// Default size of the sparse image in MB, large enough that the tail of the image is past 4GB.
+#define SPARSE_DEFAULT_SIZE_MB			4608
+
+// Number of sectors written at the start and end of the sparse image track, everything in between is a hole.
+#define SPARSE_HEAD_SECTORS				64
+#define SPARSE_TAIL_SECTORS				8192
+
+// Default layout of the metadata benchmark image and number of times its metadata is walked.
+#define METADATA_DEFAULT_SESSIONS		20
+#define METADATA_DEFAULT_TRACKS			99
+#define METADATA_DEFAULT_PASSES			2000
+
+struct StressTrack
+{
+	DWORD dwSessionNumber;				// Session number the track is located in
+	DWORD dwTrackNumber;				// Track number in the session
+	DWORD dwLBA;						// First LBA of the track
+	DWORD dwLength;						// Number of sectors in the track
+	DWORD dwSectorDataSize;				// Number of bytes ReadSectors() returns for each sector
+	std::vector<DWORD> vChunkCrcs;		// CRC32 of each chunk from the single threaded read
+};
+
+void printUse()
+{
+	// Print the program command line args.
+	printf("SegaCDIBench.exe -stress <cdi_file> [-j <threads>] [-n <passes>]\n");
+	printf("SegaCDIBench.exe -sparse <new_cdi_file> [-size <MB>] [-n <passes>]\n");
+	printf("SegaCDIBench.exe -metadata <new_cdi_file> [-s <sessions>] [-t <tracks>] [-n <passes>]\n\n");
+
+	printf("\t-stress\t\t\tread every track from many threads at once and check the data against a single threaded read\n");
+	printf("\t-j <threads>\t\tnumber of threads (default 8)\n");
+	printf("\t-n <passes>\t\tnumber of times each thread reads every track (default 4)\n\n");
+
+	printf("\t-sparse\t\t\tcreate a sparse image larger than 4GB, then time and check reads of its tail\n");
+	printf("\t-size <MB>\t\tsize of the image (default %d)\n", SPARSE_DEFAULT_SIZE_MB);
+	printf("\t-n <passes>\t\tnumber of times the tail is read (default 4)\n\n");
+
+	printf("\t-metadata\t\tcreate an image with many sessions and tracks, then time walking its metadata\n");
+	printf("\t-s <sessions>\t\tnumber of sessions (default %d)\n", METADATA_DEFAULT_SESSIONS);
+	printf("\t-t <tracks>\t\tnumber of tracks in each session (default %d)\n", METADATA_DEFAULT_TRACKS);
+	printf("\t-n <passes>\t\tnumber of times every track is looked up (default %d)\n", METADATA_DEFAULT_PASSES);
+}
+
+bool getCmdArgValue(int argc, CHAR* argv[], LPCSTR psCmd, DWORD *pdwValue)
+{
+	// Loop through all the command line args and pull out the value after the one we are looking for.
+	for (int i = 0; i < argc - 1; i++)
+	{
+		if (strcmp(psCmd, argv[i]) == 0)
+		{
+			*pdwValue = (DWORD)atoi(argv[i + 1]);
+			return true;
+		}
+	}
+
+	// The command line arg was not found.
+	return false;
+}
+
+struct StressContext
+{
+	CdiFileHandle *pCdiFile;			// Image every thread reads from
+	std::vector<StressTrack> *pvTracks;	// Tracks to read
+	DWORD dwPassCount;					// Number of times each thread reads every track
+	std::atomic<DWORD> dwErrors;		// Number of chunks that failed to read or didn't match
+};
+
+/*
+	Description: Gets the number of sectors in a chunk, the last chunk of a track may be short.
+*/
+DWORD chunkSectorCount(DWORD dwTrackLength, DWORD dwChunk)
+{
+	DWORD dwRemaining = dwTrackLength - (dwChunk * STRESS_CHUNK_SECTORS);
+	return (dwRemaining < STRESS_CHUNK_SECTORS ? dwRemaining : STRESS_CHUNK_SECTORS);
+}
+
+/*
+	Description: Checks a chunk of sectors against the single threaded read of the track.
+*/
+bool checkChunk(const StressTrack *pTrack, DWORD dwChunk, const BYTE *pbData, DWORD dwSectorCount, LPCSTR psMethod, DWORD dwThread)
+{
+	DWORD dwCrc32 = IO::Crc32Update(0, pbData, dwSectorCount * pTrack->dwSectorDataSize);
+	if (dwCrc32 == pTrack->vChunkCrcs[dwChunk])
+		return true;
+
+	printf("thread %d: session %d track %d LBA %d mismatch reading with %s!\n", dwThread, pTrack->dwSessionNumber + 1,
+		pTrack->dwTrackNumber + 1, pTrack->dwLBA + (dwChunk * STRESS_CHUNK_SECTORS), psMethod);
+	return false;
+}
+
+/*
+	Description: Reads a track with CdiFileHandle::ReadSectors(), from the last chunk to the first so the reads
+		are never sequential.
+*/
+DWORD stressReadSectors(CdiFileHandle *pCdiFile, const StressTrack *pTrack, DWORD dwThread)
+{
+	std::vector<BYTE> vBuffer(STRESS_CHUNK_SECTORS * pTrack->dwSectorDataSize);
+	DWORD dwErrors = 0;
+
+	for (DWORD i = (DWORD)pTrack->vChunkCrcs.size(); i > 0; i--)
+	{
+		DWORD dwChunk = i - 1;
+		DWORD dwSectorCount = chunkSectorCount(pTrack->dwLength, dwChunk);
+		if (pCdiFile->ReadSectors(pTrack->dwSessionNumber, pTrack->dwTrackNumber, pTrack->dwLBA + (dwChunk * STRESS_CHUNK_SECTORS),
+			vBuffer.data(), dwSectorCount) == false || checkChunk(pTrack, dwChunk, vBuffer.data(), dwSectorCount, "ReadSectors", dwThread) == false)
+			dwErrors++;
+	}
+
+	return dwErrors;
+}
+
+/*
+	Description: Reads a track front to back through the read cursor of a track handle of its own.
+*/
+DWORD stressReadNext(CdiFileHandle *pCdiFile, const StressTrack *pTrack, DWORD dwThread)
+{
+	std::vector<BYTE> vBuffer(STRESS_CHUNK_SECTORS * pTrack->dwSectorDataSize);
+	DWORD dwErrors = 0;
+
+	CdiTrackHandle *pTrackHandle = pCdiFile->OpenTrackHandle(pTrack->dwSessionNumber, pTrack->dwTrackNumber);
+	if (pTrackHandle == nullptr)
+		return 1;
+
+	pTrackHandle->Seek(0);
+	for (DWORD i = 0; i < pTrack->vChunkCrcs.size(); i++)
+	{
+		DWORD dwSectorCount = chunkSectorCount(pTrack->dwLength, i);
+		if (pTrackHandle->ReadNext(vBuffer.data(), dwSectorCount) == false ||
+			checkChunk(pTrack, i, vBuffer.data(), dwSectorCount, "ReadNext", dwThread) == false)
+			dwErrors++;
+	}
+
+	pCdiFile->CloseTrackHandle(pTrackHandle);
+	return dwErrors;
+}
+
+/*
+	Description: Reads a track with asynchronous reads, keeping a few chunks in flight on the read queue that is
+		shared with every other thread.
+*/
+DWORD stressReadAsync(CdiFileHandle *pCdiFile, const StressTrack *pTrack, DWORD dwThread)
+{
+	CdiSectorReadRequest sRequests[STRESS_ASYNC_CHUNKS];
+	CdiSectorReadRequest *pFreeRequests[STRESS_ASYNC_CHUNKS];
+	CdiSectorReadRequest *pCompleted[STRESS_ASYNC_CHUNKS];
+	std::vector<BYTE> vBuffer(STRESS_ASYNC_CHUNKS * STRESS_CHUNK_SECTORS * pTrack->dwSectorDataSize);
+	DWORD dwFreeCount = STRESS_ASYNC_CHUNKS;
+	DWORD dwNextChunk = 0;
+	DWORD dwErrors = 0;
+
+	for (DWORD i = 0; i < STRESS_ASYNC_CHUNKS; i++)
+	{
+		sRequests[i] = { };
+		sRequests[i].dwSessionNumber = pTrack->dwSessionNumber;
+		sRequests[i].dwTrackNumber = pTrack->dwTrackNumber;
+		sRequests[i].pbBuffer = &vBuffer[i * STRESS_CHUNK_SECTORS * pTrack->dwSectorDataSize];
+		pFreeRequests[i] = &sRequests[i];
+	}
+
+	while (dwNextChunk < pTrack->vChunkCrcs.size() || dwFreeCount < STRESS_ASYNC_CHUNKS)
+	{
+		// Submit a read for the next chunk, if the queue is full of other threads' reads wait for our own.
+		if (dwNextChunk < pTrack->vChunkCrcs.size() && dwFreeCount > 0)
+		{
+			CdiSectorReadRequest *pRequest = pFreeRequests[dwFreeCount - 1];
+			pRequest->dwLBA = pTrack->dwLBA + (dwNextChunk * STRESS_CHUNK_SECTORS);
+			pRequest->dwSectorCount = chunkSectorCount(pTrack->dwLength, dwNextChunk);
+			pRequest->pContext = (PVOID)(uintptr_t)dwNextChunk;
+			if (pCdiFile->SubmitSectorReads(&pRequest, 1) == true)
+			{
+				dwFreeCount--;
+				dwNextChunk++;
+				continue;
+			}
+
+			if (dwFreeCount == STRESS_ASYNC_CHUNKS)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+		}
+
+		// Wait for some of our reads to complete and check them.
+		DWORD dwCount = pCdiFile->CompleteSectorReads(pCompleted, STRESS_ASYNC_CHUNKS);
+		if (dwCount == 0)
+		{
+			printf("thread %d: CompleteSectorReads returned nothing with %d reads in flight!\n", dwThread, STRESS_ASYNC_CHUNKS - dwFreeCount);
+			return dwErrors + 1;
+		}
+
+		for (DWORD i = 0; i < dwCount; i++)
+		{
+			CdiSectorReadRequest *pRequest = pCompleted[i];
+			if (pRequest < &sRequests[0] || pRequest >= &sRequests[STRESS_ASYNC_CHUNKS])
+			{
+				printf("thread %d: CompleteSectorReads returned a request from another thread!\n", dwThread);
+				dwErrors++;
+				continue;
+			}
+
+			if (pRequest->bSuccess == false ||
+				checkChunk(pTrack, (DWORD)(uintptr_t)pRequest->pContext, pRequest->pbBuffer, pRequest->dwSectorCount, "SubmitSectorReads", dwThread) == false)
+				dwErrors++;
+
+			pFreeRequests[dwFreeCount++] = pRequest;
+		}
+	}
+
+	return dwErrors;
+}
+
+/*
+	Description: Stress test thread routine. Each thread starts on a different track and cycles through the ways
+		of reading a track, so different threads hit the same track with different APIs at the same time.
+*/
+void stressThread(StressContext *pContext, DWORD dwThread)
+{
+	std::vector<StressTrack> *pvTracks = pContext->pvTracks;
+	for (DWORD dwPass = 0; dwPass < pContext->dwPassCount; dwPass++)
+	{
+		for (DWORD i = 0; i < pvTracks->size(); i++)
+		{
+			const StressTrack *pTrack = &(*pvTracks)[(i + dwThread) % pvTracks->size()];
+			switch ((i + dwThread + dwPass) % 3)
+			{
+			case 0: pContext->dwErrors += stressReadSectors(pContext->pCdiFile, pTrack, dwThread); break;
+			case 1: pContext->dwErrors += stressReadNext(pContext->pCdiFile, pTrack, dwThread); break;
+			case 2: pContext->dwErrors += stressReadAsync(pContext->pCdiFile, pTrack, dwThread); break;
+			}
+		}
+	}
+}
+
+int runStress(int argc, CHAR* argv[])
+{
+	CdiFileHandle cdiFile;
+	std::vector<StressTrack> vTracks;
+	std::vector<BYTE> vBuffer;
+	DWORD dwThreadCount = 8;
+	DWORD dwPassCount = 4;
+
+	getCmdArgValue(argc, argv, "-j", &dwThreadCount);
+	getCmdArgValue(argc, argv, "-n", &dwPassCount);
+	if (dwThreadCount == 0)
+		dwThreadCount = 1;
+
+	// Open the image.
+	if (cdiFile.Open(argv[2], false, false) == false)
+		return 1;
+
+	// Read every track on a single thread to get the data the other threads should see.
+	ArrayView<CdiSession> sessionCollection = cdiFile.GetSessions();
+	for (DWORD i = 0; i < sessionCollection.size(); i++)
+	{
+		for (DWORD x = 0; x < sessionCollection[i]->wTrackCount; x++)
+		{
+			CdiTrack *pTrack = &sessionCollection[i]->psTracks[x];
+			StressTrack sTrack;
+			sTrack.dwSessionNumber = i;
+			sTrack.dwTrackNumber = x;
+			sTrack.dwLBA = pTrack->dwLba;
+			sTrack.dwLength = pTrack->dwLength;
+			sTrack.dwSectorDataSize = (pTrack->eMode == CdiTrackMode::Audio ? cdiFile.GetTrackOffsetInfo(i, x)->dwSectorStride : RAW_SECTOR_SIZE);
+
+			vBuffer.resize(STRESS_CHUNK_SECTORS * sTrack.dwSectorDataSize);
+			for (DWORD dwSector = 0; dwSector < sTrack.dwLength; dwSector += STRESS_CHUNK_SECTORS)
+			{
+				DWORD dwSectorCount = chunkSectorCount(sTrack.dwLength, dwSector / STRESS_CHUNK_SECTORS);
+				if (cdiFile.ReadSectors(i, x, sTrack.dwLBA + dwSector, vBuffer.data(), dwSectorCount) == false)
+				{
+					printf("failed to read session %d track %d LBA %d!\n", i + 1, x + 1, sTrack.dwLBA + dwSector);
+					return 1;
+				}
+
+				sTrack.vChunkCrcs.push_back(IO::Crc32Update(0, vBuffer.data(), dwSectorCount * sTrack.dwSectorDataSize));
+			}
+
+			vTracks.push_back(sTrack);
+		}
+	}
+
+	// Read every track from every thread at once.
+	printf("reading %d tracks from %d threads, %d passes...\n", (DWORD)vTracks.size(), dwThreadCount, dwPassCount);
+	StressContext sContext;
+	sContext.pCdiFile = &cdiFile;
+	sContext.pvTracks = &vTracks;
+	sContext.dwPassCount = dwPassCount;
+	sContext.dwErrors = 0;
+
+	std::vector<std::thread> vThreads;
+	auto tStart = std::chrono::steady_clock::now();
+	for (DWORD i = 0; i < dwThreadCount; i++)
+		vThreads.push_back(std::thread(stressThread, &sContext, i));
+	for (size_t i = 0; i < vThreads.size(); i++)
+		vThreads[i].join();
+
+	double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+	printf("done in %.2f seconds, %d errors\n", dSeconds, sContext.dwErrors.load());
+	cdiFile.Close();
+
+	// Return non-zero if any read failed or returned the wrong data.
+	return (sContext.dwErrors.load() == 0 ? 0 : 1);
+}
+
+/*
+	Image writer with shortcuts for building large synthetic images without writing all of their sectors.
+*/
+class BenchImageWriter : public CdiImageWriter
+{
+public:
+	/*
+		Description: Extends the open track by dwSectorCount sectors without writing them. On file systems that
+			support sparse files the skipped range takes no space, the sectors read back as zeros.
+
+		Returns: True if the sectors were skipped, false otherwise.
+	*/
+	bool SkipTrackSectors(DWORD dwSectorCount)
+	{
+		// Only whole sectors can be skipped, write out everything before the hole.
+		if (this->m_bTrackOpen == false || this->m_dwPartialSize != 0 || FlushSectors() == false)
+			return false;
+
+		this->m_qwOffset += (ULONGLONG)dwSectorCount * this->m_dwSectorSize;
+		this->m_sTrack.dwLength += dwSectorCount;
+		return true;
+	}
+
+	/*
+		Description: Adds a mode 1 track with no pregap and dwSectorCount unwritten sectors to the current session.
+			Unlike BeginTrack() this isn't limited to the 99 tracks a real disc can hold, so images with any
+			number of tracks can be built.
+
+		Returns: True if the track was added, false otherwise.
+	*/
+	bool AddEmptyTrack(DWORD dwSectorCount)
+	{
+		// Tracks can only be added between other tracks.
+		if (this->m_pDevice == nullptr || this->m_bTrackOpen == true || this->m_vSessionTracks.size() == 0 || dwSectorCount == 0)
+			return false;
+
+		WrittenTrack sTrack;
+		sTrack.eMode = CdiTrackMode::Mode1;
+		sTrack.eSectorType = CdiSectorType::Type_2048;
+		sTrack.dwPregapLength = 0;
+		sTrack.dwLength = dwSectorCount;
+		sTrack.dwLba = this->m_dwNextLBA;
+
+		this->m_vTracks.push_back(sTrack);
+		this->m_vSessionTracks.back()++;
+		this->m_dwNextLBA += dwSectorCount;
+		this->m_qwOffset += (ULONGLONG)dwSectorCount * CdiSectorSize::Size_2048;
+		return true;
+	}
+};
+
+/*
+	Description: Fills the user data of a sector of the sparse image with a pattern unique to its LBA.
+*/
+void fillSparseSector(DWORD dwLBA, PBYTE pbSector)
+{
+	DWORD *pdwSector = (DWORD*)pbSector;
+	for (DWORD i = 0; i < RAW_SECTOR_SIZE / sizeof(DWORD); i++)
+		pdwSector[i] = (dwLBA * 2654435761u) ^ i;
+}
+
+/*
+	Description: Writes dwSectorCount sectors of the sparse image pattern to the open track.
+*/
+bool writeSparseSectors(BenchImageWriter *pWriter, DWORD dwLBA, DWORD dwSectorCount)
+{
+	BYTE bSector[RAW_SECTOR_SIZE];
+	for (DWORD i = 0; i < dwSectorCount; i++)
+	{
+		fillSparseSector(dwLBA + i, bSector);
+		if (pWriter->WriteTrackData(bSector, RAW_SECTOR_SIZE) == false)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+	Description: Reads dwSectorCount sectors from the sparse image and checks them against the pattern.
+
+	Returns: The number of sectors that failed to read or didn't match.
+*/
+DWORD checkSparseSectors(CdiFileHandle *pCdiFile, DWORD dwLBA, DWORD dwSectorCount)
+{
+	std::vector<BYTE> vBuffer(STRESS_CHUNK_SECTORS * RAW_SECTOR_SIZE);
+	BYTE bExpected[RAW_SECTOR_SIZE];
+	DWORD dwErrors = 0;
+
+	for (DWORD dwSector = 0; dwSector < dwSectorCount; dwSector += STRESS_CHUNK_SECTORS)
+	{
+		DWORD dwChunkSectors = chunkSectorCount(dwSectorCount, dwSector / STRESS_CHUNK_SECTORS);
+		if (pCdiFile->ReadSectors(0, 0, dwLBA + dwSector, vBuffer.data(), dwChunkSectors) == false)
+		{
+			printf("failed to read LBA %d!\n", dwLBA + dwSector);
+			dwErrors += dwChunkSectors;
+			continue;
+		}
+
+		for (DWORD i = 0; i < dwChunkSectors; i++)
+		{
+			fillSparseSector(dwLBA + dwSector + i, bExpected);
+			if (memcmp(&vBuffer[i * RAW_SECTOR_SIZE], bExpected, RAW_SECTOR_SIZE) != 0)
+			{
+				printf("LBA %d does not match!\n", dwLBA + dwSector + i);
+				dwErrors++;
+			}
+		}
+	}
+
+	return dwErrors;
+}
+
+int runSparse(int argc, CHAR* argv[])
+{
+	BenchImageWriter writer;
+	DWORD dwSizeMB = SPARSE_DEFAULT_SIZE_MB;
+	DWORD dwPassCount = 4;
+	DWORD dwErrors = 0;
+
+	getCmdArgValue(argc, argv, "-size", &dwSizeMB);
+	getCmdArgValue(argc, argv, "-n", &dwPassCount);
+
+	// Work out how many sectors the data track needs for the image to be the requested size.
+	ULONGLONG qwTrackSectors = ((ULONGLONG)dwSizeMB * 1024 * 1024) / CdiSectorSize::Size_2352;
+	if (qwTrackSectors < SPARSE_HEAD_SECTORS + SPARSE_TAIL_SECTORS || qwTrackSectors > 0x7FFFFFFF)
+	{
+		printf("invalid image size %dMB!\n", dwSizeMB);
+		return 1;
+	}
+
+	// Create a single mode 1 track that only has data at the start and end.
+	printf("creating %dMB sparse image %s...\n", dwSizeMB, argv[2]);
+	DWORD dwTailLBA = (DWORD)qwTrackSectors - SPARSE_TAIL_SECTORS;
+	if (writer.Create(argv[2]) == false || writer.BeginSession() == false || writer.BeginTrack(CdiTrackMode::Mode1, CdiSectorType::Type_2352) == false ||
+		writeSparseSectors(&writer, 0, SPARSE_HEAD_SECTORS) == false || writer.SkipTrackSectors(dwTailLBA - SPARSE_HEAD_SECTORS) == false ||
+		writeSparseSectors(&writer, dwTailLBA, SPARSE_TAIL_SECTORS) == false || writer.Close() == false)
+	{
+		printf("failed to create sparse image!\n");
+		return 1;
+	}
+
+	// Read the tail through the file first, then through a memory mapping of the image.
+	for (int i = 0; i < 2; i++)
+	{
+		bool bMemoryMap = (i == 1);
+		CdiFileHandle cdiFile;
+		if (cdiFile.Open(argv[2], false, false, bMemoryMap) == false)
+		{
+			dwErrors++;
+			break;
+		}
+
+		// Sector numbers in the pattern are relative to the start of the track, the track itself starts after its pregap.
+		CdiTrack *pTrack = &cdiFile.GetSessions()[0]->psTracks[0];
+		ULONGLONG qwTailOffset = cdiFile.GetTrackOffsetInfo(0, 0)->qwDataOffset + (ULONGLONG)dwTailLBA * CdiSectorSize::Size_2352;
+		printf("\n%s: image is %lluMB, tail starts at offset 0x%llx\n", (bMemoryMap == true ? "memory mapped" : "file reads"),
+			cdiFile.ImageSize() / (1024 * 1024), qwTailOffset);
+
+		// Make sure the sectors on both sides of the hole read back.
+		dwErrors += checkSparseSectors(&cdiFile, pTrack->dwLba, SPARSE_HEAD_SECTORS);
+		dwErrors += checkSparseSectors(&cdiFile, pTrack->dwLba + dwTailLBA, SPARSE_TAIL_SECTORS);
+
+		// Time reading the tail.
+		auto tStart = std::chrono::steady_clock::now();
+		for (DWORD dwPass = 0; dwPass < dwPassCount; dwPass++)
+			dwErrors += checkSparseSectors(&cdiFile, pTrack->dwLba + dwTailLBA, SPARSE_TAIL_SECTORS);
+
+		double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+		double dMegabytes = ((double)dwPassCount * SPARSE_TAIL_SECTORS * RAW_SECTOR_SIZE) / (1024 * 1024);
+		printf("read %.1fMB from the tail in %.3f seconds (%.1f MB/s)\n", dMegabytes, dSeconds, (dSeconds > 0 ? dMegabytes / dSeconds : 0));
+
+		cdiFile.Close();
+	}
+
+	// Remove the image, it is only useful to this test.
+	remove(argv[2]);
+
+	printf("\n%d errors\n", dwErrors);
+	return (dwErrors == 0 ? 0 : 1);
+}
+
+int runMetadata(int argc, CHAR* argv[])
+{
+	BenchImageWriter writer;
+	CdiFileHandle cdiFile;
+	DWORD dwSessionCount = METADATA_DEFAULT_SESSIONS;
+	DWORD dwTrackCount = METADATA_DEFAULT_TRACKS;
+	DWORD dwPassCount = METADATA_DEFAULT_PASSES;
+
+	getCmdArgValue(argc, argv, "-s", &dwSessionCount);
+	getCmdArgValue(argc, argv, "-t", &dwTrackCount);
+	getCmdArgValue(argc, argv, "-n", &dwPassCount);
+	if (dwSessionCount == 0 || dwSessionCount > 0xFFFF || dwTrackCount == 0 || dwTrackCount > 0xFFFF)
+	{
+		printf("invalid session or track count!\n");
+		return 1;
+	}
+
+	// Create an image with one sector in each track, only the session descriptor matters here.
+	printf("creating image %s with %d sessions of %d tracks...\n", argv[2], dwSessionCount, dwTrackCount);
+	bool bResult = writer.Create(argv[2]);
+	for (DWORD i = 0; i < dwSessionCount && bResult == true; i++)
+	{
+		bResult = writer.BeginSession();
+		for (DWORD x = 0; x < dwTrackCount && bResult == true; x++)
+			bResult = writer.AddEmptyTrack(1);
+	}
+	if (bResult == false || writer.Close() == false)
+	{
+		printf("failed to create image!\n");
+		return 1;
+	}
+
+	// Time parsing the session descriptor.
+	auto tStart = std::chrono::steady_clock::now();
+	bResult = cdiFile.Open(argv[2], false, false);
+	double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+	if (bResult == false)
+	{
+		remove(argv[2]);
+		return 1;
+	}
+	printf("opened image in %.3f ms\n", dSeconds * 1000);
+
+	// Time taking a view of the sessions and looking at every track through it, the way CdiImage and the tools
+	// walk the metadata.
+	ULONGLONG qwLookups = 0;
+	ULONGLONG qwSectors = 0;
+	tStart = std::chrono::steady_clock::now();
+	for (DWORD dwPass = 0; dwPass < dwPassCount; dwPass++)
+	{
+		ArrayView<CdiSession> sessionCollection = cdiFile.GetSessions();
+		for (DWORD i = 0; i < sessionCollection.size(); i++)
+		{
+			for (DWORD x = 0; x < sessionCollection[i]->wTrackCount; x++)
+			{
+				CdiTrack *pTrack = &sessionCollection[i]->psTracks[x];
+				qwSectors += pTrack->dwLength + (pTrack->psFileName[0] == 0 ? 1 : 0);
+				qwLookups++;
+			}
+		}
+	}
+	dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+	cdiFile.Close();
+	remove(argv[2]);
+
+	// Every track is one sector long with a file name, so the sector count must match the number of lookups.
+	printf("%llu track lookups in %.3f ms, %.2f ns per lookup\n", qwLookups, dSeconds * 1000, (qwLookups > 0 ? dSeconds * 1e9 / qwLookups : 0));
+	if (qwLookups != (ULONGLONG)dwPassCount * dwSessionCount * dwTrackCount || qwSectors != qwLookups)
+	{
+		printf("metadata does not match the image that was written!\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, CHAR* argv[])
+{
+	// Check the arg count.
+	if (argc > 2 && strcmp(argv[1], "-stress") == 0)
+	{
+		// Read an image from many threads at once.
+		return runStress(argc, argv);
+	}
+	else if (argc > 2 && strcmp(argv[1], "-sparse") == 0)
+	{
+		// Read the tail of an image larger than 4GB.
+		return runSparse(argc, argv);
+	}
+	else if (argc > 2 && strcmp(argv[1], "-metadata") == 0)
+	{
+		// Time access to the metadata of an image with many sessions and tracks.
+		return runMetadata(argc, argv);
+	}
+
+	// Invalid args.
+	printUse();
+	return 1;
+}
\ No newline at end of file